@@ -0,0 +1,431 @@
+/**
+ * This file is part of groufix.
+ * Copyright (c) Stef Velzel. All rights reserved.
+ *
+ * groufix : graphics engine produced by Stef Velzel.
+ * www     : <www.vuzzel.nl>
+ *
+ * This file contains the header-only benchmarking utility.
+ * Use the following macros to describe and run a benchmark:
+ *
+ * BENCH_DESCRIBE(name, base)
+ *   Describe a new benchmark, the syntax is similar to a function:
+ *   BENCH_DESCRIBE(basic_bench, b) { BENCH_LOOP("noop", 100) {} }
+ *   Where `b` is equivalent to (&BENCH_BASE),
+ *   i.e. a pointer to the global BenchBase struct.
+ *
+ * BENCH_FAIL()
+ *   Forces the benchmark to fail and exits the program.
+ *
+ * BENCH_RUN(name)
+ *   Call from within a benchmark, run another benchmark by name.
+ *
+ * BENCH_LOOP(label, iters)
+ *   Loop header that runs its body BENCH_ITERS(iters) times, timing the
+ *   loop as a whole and reporting it under label when done.
+ *   The current iteration is BENCH_INDEX, loops cannot be nested.
+ *
+ * BENCH_ITERS(iters)
+ *   Scales an iteration count by the scale given on the command line.
+ *
+ * BENCH_USE(value)
+ *   Consumes an integer or pointer value, so the compiler cannot optimize
+ *   away the work that produced it.
+ *
+ * BENCH_MAIN(name)
+ *   Main entry point of the program by benchmark name, use as follows:
+ *   BENCH_MAIN(basic_bench);
+ *   The program takes an optional argument: a factor (e.g. 0.1) to scale
+ *   all iteration counts with, for quick runs.
+ *
+ * For anything that does not fit a loop, bench_time() returns a monotonic
+ * time in nanoseconds, to be reported with bench_report or, for individually
+ * timed samples (e.g. frames), with bench_report_samples.
+ *
+ * All results are written to stdout, one JSON object per line, so they can
+ * be collected and compared across releases; all logging goes to stderr.
+ * The objects look like either of:
+ *  {"bench":"<label>","iters":<n>,"ns":<total>,"ns_per_op":<avg>}
+ *  {"bench":"<label>","samples":<n>,"min":..,"mean":..,"p50":..,"p90":..,
+ *   "p99":..,"max":..} (all in nanoseconds)
+ *
+ * The benchmarking utility initializes groufix headless, with a heap,
+ * dependency and a renderer with a single recorder. To override default behaviour, define one of the
+ * following before including this file:
+ *
+ * BENCH_SKIP_INIT
+ *   Do not initialize groufix at all, e.g. to benchmark containers only.
+ *
+ * This file must be included before any other (system) header.
+ *
+ * Lastly, the created renderer will have 2 virtual frames by default.
+ * To override this behaviour, BENCH_NUM_FRAMES can be defined.
+ */
+
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#if !defined (_WIN32) && !defined (_POSIX_C_SOURCE)
+	#define _POSIX_C_SOURCE 199309L // For clock_gettime.
+#endif
+
+#include <groufix.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined (GFX_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <time.h>
+#endif
+
+
+// Failure & success printing.
+#define _BENCH_PRINT_FAIL(name) \
+	fprintf(stderr, "\n** %s benchmark failed\n\n", name)
+
+#define _BENCH_PRINT_SUCCESS(name) \
+	fprintf(stderr, "\n** %s benchmark done\n\n", name)
+
+
+// Describes a benchmark function that can be called.
+#define BENCH_DESCRIBE(bName, base) \
+	static BenchState _bench_state_##bName = { .running = 0, .name = #bName }; \
+	void _bench_func_##bName(BenchBase* base, BenchState* _bench_state)
+
+
+// Forces the benchmark to fail.
+#define BENCH_FAIL() \
+	_bench_fail(_bench_state)
+
+
+// Runs a benchmark function from within another benchmark function.
+#define BENCH_RUN(bName) \
+	do { \
+		if (!_bench_state_##bName.running) { \
+			_bench_state_##bName.running = 1; \
+			_bench_func_##bName(&_bench_base, &_bench_state_##bName); \
+			_BENCH_PRINT_SUCCESS(#bName); \
+			_bench_state_##bName.running = 0; \
+		} \
+	} while (0)
+
+
+// Timed loop running its body a scaled number of times.
+#define BENCH_LOOP(label, iters) \
+	for (BenchLoop _bench_loop = _bench_loop_start(label, BENCH_ITERS(iters)); \
+		_bench_loop_cond(&_bench_loop); ++_bench_loop.i)
+
+#define BENCH_INDEX (_bench_loop.i)
+
+
+// Scales an iteration count, at least 1.
+#define BENCH_ITERS(iters) \
+	_bench_iters((size_t)(iters))
+
+
+// Consumes a value.
+#define BENCH_USE(value) \
+	(_bench_sink += (uintptr_t)(value))
+
+
+// Main entry point for a benchmark program, runs the given benchmark name.
+#define BENCH_MAIN(bName) \
+	int main(int argc, char** argv) { \
+		_bench_init(&_bench_state_##bName, argc, argv); \
+		_bench_state_##bName.running = 1; \
+		_bench_func_##bName(&_bench_base, &_bench_state_##bName); \
+		_bench_state_##bName.running = 0; \
+		_bench_end(&_bench_state_##bName); \
+	} \
+	int _bench_unused_for_semicolon
+
+
+/**
+ * Global BenchBase struct and
+ * number of frames to create.
+ */
+#define BENCH_BASE _bench_base
+
+#ifndef BENCH_NUM_FRAMES
+	#define BENCH_NUM_FRAMES 2
+#endif
+
+
+/**
+ * Base benchmarking state, read/write at your leisure :)
+ */
+typedef struct BenchBase
+{
+	GFXDevice*     device;
+	GFXHeap*       heap;
+	GFXDependency* dep;
+	GFXRenderer*   renderer;
+	GFXRecorder*   recorder;
+
+	double scale; // Iteration scale, from the command line.
+
+} BenchBase;
+
+
+/**
+ * Benchmark handle.
+ */
+typedef struct BenchState
+{
+	bool        running;
+	const char* name;
+
+} BenchState;
+
+
+/**
+ * Timed loop state.
+ */
+typedef struct BenchLoop
+{
+	const char* label;
+	size_t      i;
+	size_t      n;
+	uint64_t    start;
+
+} BenchLoop;
+
+
+/**
+ * 'Global' instance of the benchmark base state & value sink.
+ */
+static BenchBase _bench_base =
+{
+	.device = NULL,
+	.heap = NULL,
+	.dep = NULL,
+	.renderer = NULL,
+	.recorder = NULL,
+	.scale = 1.0
+};
+
+static volatile uintptr_t _bench_sink = 0;
+
+
+/****************************
+ * All timing & reporting functions.
+ ****************************/
+
+/**
+ * Returns a monotonic time in nanoseconds.
+ */
+static inline uint64_t bench_time(void)
+{
+#if defined (GFX_WIN32)
+	LARGE_INTEGER freq, ticks;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&ticks);
+
+	const uint64_t f = (uint64_t)freq.QuadPart;
+	const uint64_t t = (uint64_t)ticks.QuadPart;
+
+	return
+		t / f * UINT64_C(1000000000) +
+		t % f * UINT64_C(1000000000) / f;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return
+		(uint64_t)ts.tv_sec * UINT64_C(1000000000) +
+		(uint64_t)ts.tv_nsec;
+#endif
+}
+
+/**
+ * Reports the total time of a number of iterations of some operation.
+ */
+static inline void bench_report(const char* label, size_t iters, uint64_t ns)
+{
+	printf(
+		"{\"bench\":\"%s\",\"iters\":%zu,\"ns\":%llu,\"ns_per_op\":%.3f}\n",
+		label, iters,
+		(unsigned long long)ns,
+		iters > 0 ? (double)ns / (double)iters : 0.0);
+
+	fflush(stdout);
+}
+
+/**
+ * qsort comparison for uint64_t.
+ */
+static int _bench_cmp(const void* l, const void* r)
+{
+	const uint64_t ul = *(const uint64_t*)l;
+	const uint64_t ur = *(const uint64_t*)r;
+
+	return (ul > ur) - (ul < ur);
+}
+
+/**
+ * Retrieves a percentile (nearest rank) from sorted samples.
+ */
+static uint64_t _bench_percentile(size_t num, const uint64_t* sorted,
+                                  unsigned int percent)
+{
+	size_t rank = (num * percent + 99) / 100;
+	return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+/**
+ * Reports the distribution of individually timed samples.
+ * Sorts the samples in-place!
+ */
+static inline void bench_report_samples(const char* label,
+                                        size_t num, uint64_t* samples)
+{
+	if (num == 0) return;
+
+	qsort(samples, num, sizeof(uint64_t), _bench_cmp);
+
+	double mean = 0.0;
+	for (size_t s = 0; s < num; ++s)
+		mean += (double)samples[s] / (double)num;
+
+	printf(
+		"{\"bench\":\"%s\",\"samples\":%zu,"
+		"\"min\":%llu,\"mean\":%.1f,"
+		"\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,"
+		"\"max\":%llu}\n",
+		label, num,
+		(unsigned long long)samples[0],
+		mean,
+		(unsigned long long)_bench_percentile(num, samples, 50),
+		(unsigned long long)_bench_percentile(num, samples, 90),
+		(unsigned long long)_bench_percentile(num, samples, 99),
+		(unsigned long long)samples[num-1]);
+
+	fflush(stdout);
+}
+
+
+/****************************
+ * All internal benchmarking functions.
+ ****************************/
+
+/**
+ * Scales an iteration count.
+ */
+static size_t _bench_iters(size_t iters)
+{
+	const double scaled = (double)iters * _bench_base.scale;
+	return scaled < 1.0 ? 1 : (size_t)scaled;
+}
+
+/**
+ * Starts a timed loop.
+ */
+static BenchLoop _bench_loop_start(const char* label, size_t iters)
+{
+	return (BenchLoop){
+		.label = label,
+		.i = 0,
+		.n = iters,
+		.start = bench_time()
+	};
+}
+
+/**
+ * Checks whether a timed loop should continue, reports when it should not.
+ */
+static bool _bench_loop_cond(BenchLoop* loop)
+{
+	if (loop->i < loop->n)
+		return 1;
+
+	bench_report(loop->label, loop->n, bench_time() - loop->start);
+	return 0;
+}
+
+/**
+ * Clears the base benchmark state.
+ */
+static void _bench_clear(void)
+{
+#if !defined (BENCH_SKIP_INIT)
+	gfx_destroy_renderer(_bench_base.renderer);
+	gfx_destroy_heap(_bench_base.heap);
+	gfx_destroy_dep(_bench_base.dep);
+	gfx_terminate();
+#endif
+
+	// Don't bother resetting _bench_base as we will exit() anyway.
+}
+
+/**
+ * Forces the benchmark to fail and exits the program.
+ */
+static void _bench_fail(BenchState* bench)
+{
+	_bench_clear();
+
+	_BENCH_PRINT_FAIL(bench->name);
+	exit(EXIT_FAILURE);
+}
+
+/**
+ * End (i.e. exit) the benchmark program.
+ */
+static void _bench_end(BenchState* bench)
+{
+	_bench_clear();
+
+	_BENCH_PRINT_SUCCESS(bench->name);
+	exit(EXIT_SUCCESS);
+}
+
+/**
+ * Initializes the benchmark base program.
+ */
+static void _bench_init(BenchState* _bench_state, int argc, char** argv)
+{
+	// Parse the iteration scale.
+	if (argc > 1)
+	{
+		_bench_base.scale = strtod(argv[1], NULL);
+		if (_bench_base.scale <= 0.0)
+			BENCH_FAIL();
+	}
+
+#if !defined (BENCH_SKIP_INIT)
+	// Initialize without a display, keep the log quiet-ish.
+	gfx_set_headless(1);
+	gfx_log_set_level(GFX_LOG_WARN);
+
+	if (!gfx_init())
+		BENCH_FAIL();
+
+	// Create a heap & dependency.
+	_bench_base.heap = gfx_create_heap(_bench_base.device);
+	if (_bench_base.heap == NULL)
+		BENCH_FAIL();
+
+	_bench_base.dep = gfx_create_dep(_bench_base.device, BENCH_NUM_FRAMES);
+	if (_bench_base.dep == NULL)
+		BENCH_FAIL();
+
+	// Create a renderer.
+	_bench_base.renderer =
+		gfx_create_renderer(_bench_base.heap, BENCH_NUM_FRAMES);
+
+	if (_bench_base.renderer == NULL)
+		BENCH_FAIL();
+
+	// Add a single recorder.
+	_bench_base.recorder = gfx_renderer_add_recorder(_bench_base.renderer);
+	if (_bench_base.recorder == NULL)
+		BENCH_FAIL();
+#endif
+}
+
+
+#endif
@@ -0,0 +1,200 @@
+/**
+ * This file is part of groufix.
+ * Copyright (c) Stef Velzel. All rights reserved.
+ *
+ * groufix : graphics engine produced by Stef Velzel.
+ * www     : <www.vuzzel.nl>
+ */
+
+#define BENCH_SKIP_INIT
+#include "bench.h"
+#include "groufix/containers/map.h"
+#include "groufix/containers/tree.h"
+#include "groufix/containers/vec.h"
+
+
+#define NUM_ELEMS 1000000
+
+
+/****************************
+ * Key hashing & comparison, keys are uint64_t.
+ */
+static uint64_t hash(const void* key)
+{
+	// splitmix64 finalizer.
+	uint64_t x = *(const uint64_t*)key;
+	x = (x ^ (x >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+	x = (x ^ (x >> 27)) * UINT64_C(0x94d049bb133111eb);
+
+	return x ^ (x >> 31);
+}
+
+static int cmp_map(const void* l, const void* r)
+{
+	return *(const uint64_t*)l != *(const uint64_t*)r;
+}
+
+static int cmp_tree(const void* l, const void* r)
+{
+	const uint64_t ul = *(const uint64_t*)l;
+	const uint64_t ur = *(const uint64_t*)r;
+
+	return (ul > ur) - (ul < ur);
+}
+
+
+/****************************
+ * Shuffled key, visits all keys < NUM_ELEMS exactly once for i < NUM_ELEMS.
+ * Multiplies with a prime coprime to NUM_ELEMS, modulo NUM_ELEMS.
+ */
+static uint64_t key(size_t i)
+{
+	return (uint64_t)i * UINT64_C(2654435761) % NUM_ELEMS;
+}
+
+
+/****************************
+ * Vector benchmark.
+ */
+BENCH_DESCRIBE(vec, b)
+{
+	GFXVec vec;
+	gfx_vec_init(&vec, sizeof(uint64_t));
+
+	BENCH_LOOP("vec_push", NUM_ELEMS)
+	{
+		const uint64_t elem = BENCH_INDEX;
+		if (!gfx_vec_push(&vec, 1, &elem)) BENCH_FAIL();
+	}
+
+	// Memory is kept, measures pushing without growth.
+	gfx_vec_release(&vec);
+
+	BENCH_LOOP("vec_push_reserved", NUM_ELEMS)
+	{
+		const uint64_t elem = BENCH_INDEX;
+		if (!gfx_vec_push(&vec, 1, &elem)) BENCH_FAIL();
+	}
+
+	BENCH_LOOP("vec_read", NUM_ELEMS)
+		BENCH_USE(*(uint64_t*)gfx_vec_at(&vec, BENCH_INDEX % vec.size));
+
+	BENCH_LOOP("vec_pop", NUM_ELEMS)
+		if (vec.size > 0) gfx_vec_pop(&vec, 1);
+
+	gfx_vec_clear(&vec);
+}
+
+
+/****************************
+ * Map benchmark.
+ */
+BENCH_DESCRIBE(map, b)
+{
+	GFXMap map;
+	gfx_map_init(&map, sizeof(uint64_t), hash, cmp_map);
+
+	BENCH_LOOP("map_insert", NUM_ELEMS)
+	{
+		const uint64_t k = key(BENCH_INDEX);
+		if (!gfx_map_insert(&map, &k, sizeof(uint64_t), &k)) BENCH_FAIL();
+	}
+
+	BENCH_LOOP("map_search_hit", NUM_ELEMS)
+	{
+		const uint64_t k = key(BENCH_INDEX);
+		BENCH_USE(gfx_map_search(&map, &k));
+	}
+
+	BENCH_LOOP("map_search_miss", NUM_ELEMS)
+	{
+		const uint64_t k = key(BENCH_INDEX) + NUM_ELEMS;
+		BENCH_USE(gfx_map_search(&map, &k));
+	}
+
+	BENCH_LOOP("map_iterate", 10)
+		for (void* n = gfx_map_first(&map); n != NULL; n = gfx_map_next(&map, n))
+			BENCH_USE(n);
+
+	BENCH_LOOP("map_erase", NUM_ELEMS)
+	{
+		const uint64_t k = key(BENCH_INDEX);
+		void* node = gfx_map_search(&map, &k);
+		if (node != NULL) gfx_map_erase(&map, node);
+	}
+
+	gfx_map_clear(&map);
+
+	// Interleaved insert/erase at a fixed capacity, as caches do.
+	gfx_map_init(&map, sizeof(uint64_t), hash, cmp_map);
+	if (!gfx_map_reserve(&map, 1024)) BENCH_FAIL();
+
+	BENCH_LOOP("map_churn", NUM_ELEMS)
+	{
+		const uint64_t k = BENCH_INDEX;
+		if (!gfx_map_insert(&map, &k, sizeof(uint64_t), &k)) BENCH_FAIL();
+
+		if (map.size >= 512)
+		{
+			const uint64_t e = k - 511;
+			void* node = gfx_map_search(&map, &e);
+			if (node != NULL) gfx_map_ferase(&map, node);
+		}
+	}
+
+	gfx_map_clear(&map);
+}
+
+
+/****************************
+ * Tree benchmark.
+ */
+BENCH_DESCRIBE(tree, b)
+{
+	GFXTree tree;
+	gfx_tree_init(&tree, sizeof(uint64_t), cmp_tree);
+
+	BENCH_LOOP("tree_insert", NUM_ELEMS)
+	{
+		const uint64_t k = key(BENCH_INDEX);
+		if (!gfx_tree_insert(&tree, sizeof(uint64_t), &k, &k)) BENCH_FAIL();
+	}
+
+	BENCH_LOOP("tree_search", NUM_ELEMS)
+	{
+		const uint64_t k = key(BENCH_INDEX);
+		BENCH_USE(gfx_tree_search(&tree, &k, GFX_TREE_MATCH_STRICT));
+	}
+
+	BENCH_LOOP("tree_search_left", NUM_ELEMS)
+	{
+		const uint64_t k = key(BENCH_INDEX) + NUM_ELEMS;
+		BENCH_USE(gfx_tree_search(&tree, &k, GFX_TREE_MATCH_LEFT));
+	}
+
+	BENCH_LOOP("tree_erase", NUM_ELEMS)
+	{
+		const uint64_t k = key(BENCH_INDEX);
+		void* node = gfx_tree_search(&tree, &k, GFX_TREE_MATCH_STRICT);
+		if (node != NULL) gfx_tree_erase(&tree, node);
+	}
+
+	gfx_tree_clear(&tree);
+}
+
+
+/****************************
+ * Run all container benchmarks.
+ */
+BENCH_DESCRIBE(containers, b)
+{
+	BENCH_RUN(vec);
+	BENCH_RUN(map);
+	BENCH_RUN(tree);
+}
+
+
+/****************************
+ * Run the containers benchmark.
+ */
+BENCH_MAIN(containers);
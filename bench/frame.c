@@ -0,0 +1,191 @@
+/**
+ * This file is part of groufix.
+ * Copyright (c) Stef Velzel. All rights reserved.
+ *
+ * groufix : graphics engine produced by Stef Velzel.
+ * www     : <www.vuzzel.nl>
+ */
+
+#include "bench.h"
+
+
+#define NUM_FRAMES 1000
+#define NUM_WARMUP 10
+#define NUM_DRAWS  1000
+
+
+/****************************
+ * Shaders, a single triangle without any vertex input.
+ */
+static const char* glsl_vertex =
+	"#version 450\n"
+	"out gl_PerVertex {\n"
+	"  vec4 gl_Position;\n"
+	"};\n"
+	"void main() {\n"
+	"  vec2 pos = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);\n"
+	"  gl_Position = vec4(pos * 0.01 - 1.0, 0.0, 1.0);\n"
+	"}\n";
+
+
+static const char* glsl_fragment =
+	"#version 450\n"
+	"layout(location = 0) out vec4 oColor;\n"
+	"void main() {\n"
+	"  oColor = vec4(1.0);\n"
+	"}\n";
+
+
+/****************************
+ * Render callback context.
+ */
+typedef struct Context
+{
+	GFXRenderable renderable;
+	uint32_t      draws;
+
+} Context;
+
+
+/****************************
+ * Render callback.
+ */
+static void render(GFXRecorder* recorder, unsigned int frame, void* ptr)
+{
+	// Record many tiny draws.
+	Context* ctx = ptr;
+	for (uint32_t d = 0; d < ctx->draws; ++d)
+		gfx_cmd_draw(recorder, &ctx->renderable, 3, 1, 0, d);
+}
+
+
+/****************************
+ * Headless frame benchmark.
+ */
+BENCH_DESCRIBE(frame, b)
+{
+	bool success = 0;
+
+	const size_t numFrames = BENCH_ITERS(NUM_FRAMES);
+	uint64_t* frames = malloc(sizeof(uint64_t) * numFrames * 2);
+	uint64_t* records = frames + numFrames;
+
+	GFXShader* vert = gfx_create_shader(GFX_STAGE_VERTEX, b->device);
+	GFXShader* frag = gfx_create_shader(GFX_STAGE_FRAGMENT, b->device);
+
+	if (frames == NULL || vert == NULL || frag == NULL)
+		goto clean;
+
+	// Compile GLSL into the shaders.
+	GFXStringReader str;
+
+	if (!gfx_shader_compile(vert, GFX_GLSL, 1,
+		gfx_string_reader(&str, glsl_vertex), NULL, NULL, NULL))
+	{
+		goto clean;
+	}
+
+	if (!gfx_shader_compile(frag, GFX_GLSL, 1,
+		gfx_string_reader(&str, glsl_fragment), NULL, NULL, NULL))
+	{
+		goto clean;
+	}
+
+	// Render into an image attachment, no window.
+	if (!gfx_renderer_attach(b->renderer, 0,
+		(GFXAttachment){
+			.type  = GFX_IMAGE_2D,
+			.flags = GFX_MEMORY_NONE,
+			.usage = GFX_IMAGE_OUTPUT,
+
+			.format  = GFX_FORMAT_R8G8B8A8_UNORM,
+			.samples = 1,
+			.mipmaps = 1,
+			.layers  = 1,
+
+			.size = GFX_SIZE_ABSOLUTE,
+			.width = 1920,
+			.height = 1080,
+			.depth = 1
+		}))
+	{
+		goto clean;
+	}
+
+	GFXPass* pass = gfx_renderer_add_pass(
+		b->renderer, GFX_PASS_RENDER, 0, NULL);
+
+	if (pass == NULL)
+		goto clean;
+
+	if (!gfx_pass_consume(pass, 0,
+		GFX_ACCESS_ATTACHMENT_WRITE, GFX_STAGE_ANY))
+	{
+		goto clean;
+	}
+
+	gfx_pass_clear(pass, 0,
+		GFX_IMAGE_COLOR, (GFXClear){{ 0.0f, 0.0f, 0.0f, 0.0f }});
+
+	// Create a technique & renderable.
+	GFXTechnique* tech = gfx_renderer_add_tech(
+		b->renderer, 2, (GFXShader*[]){ vert, frag });
+
+	if (tech == NULL)
+		goto clean;
+
+	Context ctx = { .draws = NUM_DRAWS };
+	if (!gfx_renderable(&ctx.renderable, pass, tech, NULL, NULL))
+		goto clean;
+
+	// Warm up, builds the graph & pipeline.
+	for (size_t f = 0; f < NUM_WARMUP; ++f)
+	{
+		GFXFrame* frame = gfx_renderer_acquire(b->renderer);
+		gfx_frame_start(frame);
+		gfx_recorder_render(b->recorder, pass, render, &ctx);
+		gfx_frame_submit(frame);
+	}
+
+	// Time each frame from acquire to submit, which includes waiting for
+	// the GPU to finish the frame previously rendered in the acquired slot.
+	for (size_t f = 0; f < numFrames; ++f)
+	{
+		const uint64_t start = bench_time();
+
+		GFXFrame* frame = gfx_renderer_acquire(b->renderer);
+		gfx_frame_start(frame);
+
+		const uint64_t record = bench_time();
+		gfx_recorder_render(b->recorder, pass, render, &ctx);
+		records[f] = bench_time() - record;
+
+		gfx_frame_submit(frame);
+		frames[f] = bench_time() - start;
+	}
+
+	uint64_t total = 0;
+	for (size_t f = 0; f < numFrames; ++f)
+		total += records[f];
+
+	bench_report("recorder_draw", numFrames * NUM_DRAWS, total);
+	bench_report_samples("frame_record", numFrames, records);
+	bench_report_samples("frame_cpu", numFrames, frames);
+
+	success = 1;
+
+
+	// Cleanup.
+clean:
+	gfx_destroy_shader(vert);
+	gfx_destroy_shader(frag);
+	free(frames);
+
+	if (!success) BENCH_FAIL();
+}
+
+
+/****************************
+ * Run the frame benchmark.
+ */
+BENCH_MAIN(frame);
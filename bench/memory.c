@@ -0,0 +1,327 @@
+/**
+ * This file is part of groufix.
+ * Copyright (c) Stef Velzel. All rights reserved.
+ *
+ * groufix : graphics engine produced by Stef Velzel.
+ * www     : <www.vuzzel.nl>
+ */
+
+#include "bench.h"
+#include "groufix/core/objects.h"
+#include <string.h>
+
+
+#define NUM_ALLOCS   10000
+#define NUM_LOOKUPS  100000
+#define NUM_SETS     1000
+#define NUM_WRITES   10000
+#define NUM_UPLOADS  100
+#define LARGE_SIZE   (UINT64_C(16) << 20)
+
+
+/****************************
+ * Mirrors _GFXHashKey, containing one _GFXCacheElem* and one index.
+ */
+typedef union Key
+{
+	_GFXHashKey hash;
+
+	struct {
+		size_t len;
+		char bytes[sizeof(_GFXCacheElem*) + sizeof(size_t)];
+	};
+
+} Key;
+
+
+/****************************
+ * Memory allocator benchmark, goes straight to the heap's allocator.
+ */
+BENCH_DESCRIBE(alloc, b)
+{
+	const size_t num = BENCH_ITERS(NUM_ALLOCS);
+	_GFXMemAlloc* mems = malloc(sizeof(_GFXMemAlloc) * num);
+	if (mems == NULL) BENCH_FAIL();
+
+	// Sizes ranging from 256 bytes to 64 KiB, mimicking buffers & images.
+	VkMemoryRequirements reqs = {
+		.size = 0,
+		.alignment = 256,
+		.memoryTypeBits = ~(uint32_t)0
+	};
+
+	_GFXAllocator* alloc = &b->heap->allocator;
+	uint64_t t = bench_time();
+
+	for (size_t i = 0; i < num; ++i)
+	{
+		reqs.size = (VkDeviceSize)256 << (i % 9);
+		if (!_gfx_alloc(alloc, mems + i, 1,
+			0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, reqs))
+		{
+			free(mems);
+			BENCH_FAIL();
+		}
+	}
+
+	bench_report("alloc", num, bench_time() - t);
+
+	// Free every other allocation, then re-allocate into the holes.
+	t = bench_time();
+
+	for (size_t i = 0; i < num; i += 2)
+		_gfx_free(alloc, mems + i);
+
+	for (size_t i = 0; i < num; i += 2)
+	{
+		reqs.size = (VkDeviceSize)256 << ((i + 3) % 9);
+		if (!_gfx_alloc(alloc, mems + i, 1,
+			0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, reqs))
+		{
+			free(mems);
+			BENCH_FAIL();
+		}
+	}
+
+	bench_report("alloc_fragmented", num, bench_time() - t);
+
+	t = bench_time();
+
+	for (size_t i = 0; i < num; ++i)
+		_gfx_free(alloc, mems + i);
+
+	bench_report("free", num, bench_time() - t);
+
+	free(mems);
+}
+
+
+/****************************
+ * Vulkan object cache benchmark, all lookups hit.
+ */
+BENCH_DESCRIBE(cache, b)
+{
+	VkSamplerCreateInfo sci = {
+		.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+
+		.pNext            = NULL,
+		.flags            = 0,
+		.magFilter        = VK_FILTER_LINEAR,
+		.minFilter        = VK_FILTER_LINEAR,
+		.mipmapMode       = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+		.addressModeU     = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		.addressModeV     = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		.addressModeW     = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		.mipLodBias       = 0.0f,
+		.anisotropyEnable = VK_FALSE,
+		.maxAnisotropy    = 1.0f,
+		.compareEnable    = VK_FALSE,
+		.compareOp        = VK_COMPARE_OP_ALWAYS,
+		.minLod           = 0.0f,
+		.maxLod           = 1.0f,
+		.borderColor      = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK,
+
+		.unnormalizedCoordinates = VK_FALSE
+	};
+
+	VkDescriptorSetLayoutBinding dslb[] = {
+		{
+			.binding            = 0,
+			.descriptorType     = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+			.descriptorCount    = 1,
+			.stageFlags         = VK_SHADER_STAGE_ALL,
+			.pImmutableSamplers = NULL
+		}, {
+			.binding            = 1,
+			.descriptorType     = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.descriptorCount    = 4,
+			.stageFlags         = VK_SHADER_STAGE_FRAGMENT_BIT,
+			.pImmutableSamplers = NULL
+		}
+	};
+
+	VkDescriptorSetLayoutCreateInfo dslci = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+
+		.pNext        = NULL,
+		.flags        = 0,
+		.bindingCount = 2,
+		.pBindings    = dslb
+	};
+
+	_GFXCache* cache = &b->renderer->cache;
+
+	// Warm up, creating the objects.
+	if (
+		_gfx_cache_get(cache, &sci.sType, NULL) == NULL ||
+		_gfx_cache_get(cache, &dslci.sType, NULL) == NULL)
+	{
+		BENCH_FAIL();
+	}
+
+	BENCH_LOOP("cache_get_sampler", NUM_LOOKUPS)
+		BENCH_USE(_gfx_cache_get(cache, &sci.sType, NULL));
+
+	BENCH_LOOP("cache_get_set_layout", NUM_LOOKUPS)
+		BENCH_USE(_gfx_cache_get(cache, &dslci.sType, NULL));
+}
+
+
+/****************************
+ * Descriptor pool benchmark.
+ */
+BENCH_DESCRIBE(pool, b)
+{
+	VkDescriptorSetLayoutCreateInfo dslci = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+
+		.pNext        = NULL,
+		.flags        = 0,
+		.bindingCount = 1,
+		.pBindings    = (VkDescriptorSetLayoutBinding[]){{
+			.binding            = 0,
+			.descriptorType     = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+			.descriptorCount    = 1,
+			.stageFlags         = VK_SHADER_STAGE_ALL,
+			.pImmutableSamplers = NULL
+		}}
+	};
+
+	_GFXCacheElem* setLayout =
+		_gfx_cache_get(&b->renderer->cache, &dslci.sType, NULL);
+
+	GFXBuffer* buffer = gfx_alloc_buffer(b->heap,
+		GFX_MEMORY_WRITE, GFX_BUFFER_UNIFORM, 256);
+
+	if (setLayout == NULL || buffer == NULL)
+	{
+		gfx_free_buffer(buffer);
+		BENCH_FAIL();
+	}
+
+	// Template-formatted update data, as the renderer's sets use.
+	_GFXSetEntry entry;
+	entry.vk.update.buffer = (VkDescriptorBufferInfo){
+		.buffer = ((_GFXBuffer*)buffer)->vk.buffer,
+		.offset = 0,
+		.range  = 256
+	};
+
+	Key key;
+	key.len = sizeof(key.bytes);
+	memcpy(key.bytes, &setLayout, sizeof(_GFXCacheElem*));
+
+	_GFXPool* pool = &b->renderer->pool;
+	_GFXPoolSub sub;
+	_gfx_pool_sub(pool, &sub);
+
+	// Each new key allocates & writes a descriptor set.
+	bool success = 1;
+
+	BENCH_LOOP("pool_get_new", NUM_SETS)
+	{
+		const size_t index = BENCH_INDEX;
+		memcpy(key.bytes + sizeof(_GFXCacheElem*), &index, sizeof(size_t));
+
+		success = success &&
+			_gfx_pool_get(pool, &sub, setLayout,
+				&key.hash, &entry.vk.update) != NULL;
+	}
+
+	// Then repeatedly ask for the same set, before & after a flush.
+	BENCH_LOOP("pool_get_hit", NUM_LOOKUPS)
+		success = success &&
+			_gfx_pool_get(pool, &sub, setLayout,
+				&key.hash, &entry.vk.update) != NULL;
+
+	uint64_t t = bench_time();
+	success = success && _gfx_pool_flush(pool);
+	bench_report("pool_flush", 1, bench_time() - t);
+
+	BENCH_LOOP("pool_get_flushed", NUM_LOOKUPS)
+		success = success &&
+			_gfx_pool_get(pool, &sub, setLayout,
+				&key.hash, &entry.vk.update) != NULL;
+
+	_gfx_pool_unsub(pool, &sub);
+	gfx_free_buffer(buffer);
+
+	if (!success) BENCH_FAIL();
+}
+
+
+/****************************
+ * Heap write benchmark.
+ */
+BENCH_DESCRIBE(write, b)
+{
+	char small[64];
+	memset(small, 1, sizeof(small));
+
+	char* large = malloc(LARGE_SIZE);
+	if (large == NULL) BENCH_FAIL();
+	memset(large, 1, LARGE_SIZE);
+
+	GFXBuffer* mapped = gfx_alloc_buffer(b->heap,
+		GFX_MEMORY_HOST_VISIBLE | GFX_MEMORY_WRITE, GFX_BUFFER_UNIFORM,
+		sizeof(small));
+
+	GFXBuffer* local = gfx_alloc_buffer(b->heap,
+		GFX_MEMORY_WRITE, GFX_BUFFER_VERTEX,
+		LARGE_SIZE);
+
+	bool success = mapped != NULL && local != NULL;
+
+	const GFXRegion smallRegion = { .offset = 0, .size = sizeof(small) };
+	const GFXRegion largeRegion = { .offset = 0, .size = LARGE_SIZE };
+
+	// Host visible, mapped & copied on the host.
+	if (success) BENCH_LOOP("write_small_mapped", NUM_WRITES)
+		success = success &&
+			gfx_write(small, gfx_ref_buffer(mapped), GFX_TRANSFER_NONE,
+				1, 0, &smallRegion, &smallRegion, NULL);
+
+	// Device local, staged & recorded, flushed at the end.
+	if (success)
+	{
+		uint64_t t = bench_time();
+		const size_t num = BENCH_ITERS(NUM_WRITES);
+
+		for (size_t i = 0; success && i < num; ++i)
+			success = gfx_write(small, gfx_ref_buffer(local), GFX_TRANSFER_ASYNC,
+				1, 0, &smallRegion, &smallRegion, NULL);
+
+		success = success && gfx_heap_flush(b->heap);
+		bench_report("write_small_staged", num, bench_time() - t);
+	}
+
+	// Device local, staged & blocking until done.
+	if (success) BENCH_LOOP("write_large_blocking", NUM_UPLOADS)
+		success = success &&
+			gfx_write(large, gfx_ref_buffer(local), GFX_TRANSFER_BLOCK,
+				1, 0, &largeRegion, &largeRegion, NULL);
+
+	gfx_free_buffer(mapped);
+	gfx_free_buffer(local);
+	free(large);
+
+	if (!success) BENCH_FAIL();
+}
+
+
+/****************************
+ * Run all memory benchmarks.
+ */
+BENCH_DESCRIBE(memory, b)
+{
+	BENCH_RUN(alloc);
+	BENCH_RUN(cache);
+	BENCH_RUN(pool);
+	BENCH_RUN(write);
+}
+
+
+/****************************
+ * Run the memory benchmark.
+ */
+BENCH_MAIN(memory);
@@ -23,6 +23,36 @@
 #include "groufix/def.h"
 
 
+/**
+ * Default number of job system worker threads,
+ * one for each logical processor, minus the calling thread.
+ */
+#define GFX_WORKERS_AUTO (~0u)
+
+
+/**
+ * Sets the number of worker threads gfx_init will start for the engine's
+ * parallel work (e.g. loading, pipeline warmup and recording).
+ * @param workers Number of worker threads, or GFX_WORKERS_AUTO (the default).
+ *
+ * Must be called before gfx_init to take effect, calls after are ignored.
+ * Lower this if the application runs its own thread pool alongside,
+ * with 0 workers all parallel work is done by the calling threads.
+ */
+GFX_API void gfx_set_workers(unsigned int workers);
+
+/**
+ * Sets whether gfx_init initializes the engine without a display.
+ * @param headless Non-zero to run headless, zero by default.
+ *
+ * Must be called before gfx_init to take effect, calls after are ignored.
+ * When headless, GLFW is initialized on its null platform (if GLFW supports
+ * it) and the Vulkan instance does not require any surface to be available,
+ * windows and monitors are then not functional. Renderers can still render
+ * to image attachments, see gfx_frame_read and gfx_renderer_set_interval.
+ */
+GFX_API void gfx_set_headless(bool headless);
+
 /**
  * Initializes the engine, attaching the calling thread as the main thread.
  * This call MUST be made before any groufix calls can be made.
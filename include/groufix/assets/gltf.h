@@ -216,6 +216,24 @@ typedef struct GFXGltfResult
 } GFXGltfResult;
 
 
+/**
+ * glTF import-time geometry processing flags.
+ */
+typedef enum GFXGltfOptimizeFlags
+{
+	GFX_GLTF_OPTIMIZE_NONE         = 0x0000,
+	GFX_GLTF_OPTIMIZE_VERTEX_CACHE = 0x0001, // Reorders triangles.
+	GFX_GLTF_OPTIMIZE_OVERDRAW     = 0x0003, // Implies VERTEX_CACHE.
+	GFX_GLTF_OPTIMIZE_VERTEX_FETCH = 0x0004, // Reorders vertices.
+	GFX_GLTF_OPTIMIZE_QUANTIZE     = 0x0008, // Normals, tangents & texcoords.
+	GFX_GLTF_OPTIMIZE_SHRINK_INDEX = 0x0010, // 16-bit indices where possible.
+	GFX_GLTF_OPTIMIZE_ALL          = 0x001f
+
+} GFXGltfOptimizeFlags;
+
+GFX_BIT_FIELD(GFXGltfOptimizeFlags)
+
+
 /**
  * glTF 2.0 parsing options.
  */
@@ -225,6 +243,9 @@ typedef struct GFXGltfOptions
 	const char** attributeOrder; // Name index -> attribute location.
 	size_t       maxAttributes;  // Per primitive, 0 for no limit.
 
+	GFXGltfOptimizeFlags optimize; // Geometry processing, 0 to upload as is.
+	bool                 readable; // Allocate with GFX_MEMORY_READ (to cook).
+
 } GFXGltfOptions;
 
 
@@ -239,6 +260,25 @@ typedef struct GFXGltfOptions
  * @param inc     Optional stream includer.
  * @param result  Cannot be NULL, output parsing results.
  * @return Non-zero on success.
+ *
+ * Streams that expose their data (see gfx_io_data) are parsed and uploaded
+ * straight from that memory, without intermediate buffers. Use a
+ * GFXMappedFile and GFXMappedIncluder to load large scenes this way.
+ *
+ * If options->optimize is non-zero, the geometry of each primitive is
+ * processed on the host and written to its own (interleaved) vertex and
+ * index buffers, owned by the primitive instead of referencing `buffers`:
+ *  GFX_GLTF_OPTIMIZE_VERTEX_CACHE reorders triangles (of triangle lists)
+ *   for the post-transform vertex cache.
+ *  GFX_GLTF_OPTIMIZE_OVERDRAW additionally reorders clusters of triangles
+ *   so outward facing triangles are drawn first.
+ *  GFX_GLTF_OPTIMIZE_VERTEX_FETCH reorders vertices in order of first use,
+ *   dropping unreferenced vertices.
+ *  GFX_GLTF_OPTIMIZE_QUANTIZE stores floating point normals & tangents as
+ *   (packed) snorm and texture coordinates as 16-bit unorm or half floats,
+ *   if supported by the device. All still read as floats in shaders.
+ *  GFX_GLTF_OPTIMIZE_SHRINK_INDEX uses 16-bit indices where possible.
+ * Primitives with sparse accessors are never processed.
  */
 GFX_API bool gfx_load_gltf(GFXHeap* heap, GFXDependency* dep,
                            const GFXGltfOptions* options,
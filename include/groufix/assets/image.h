@@ -17,7 +17,7 @@
 
 
 /**
- * Image loading format restrictions.
+ * Image loading format restrictions and options.
  */
 typedef enum GFXImageFlags
 {
@@ -27,7 +27,10 @@ typedef enum GFXImageFlags
 	GFX_IMAGE_KEEP_FORMAT = 0x0003, // Both KEEP_TYPE and KEEP_ORDER.
 
 	GFX_IMAGE_TYPE_BEFORE_ORDER = 0x0004,
-	GFX_IMAGE_ORDER_BEFORE_TYPE = 0x0008
+	GFX_IMAGE_ORDER_BEFORE_TYPE = 0x0008,
+
+	GFX_IMAGE_GENERATE_MIPMAPS = 0x0010, // Allocates & generates all mipmaps.
+	GFX_IMAGE_READABLE         = 0x0020  // Allocates with GFX_MEMORY_READ.
 
 } GFXImageFlags;
 
@@ -41,10 +44,52 @@ GFX_BIT_FIELD(GFXImageFlags)
  * @param flags Flags to influence the format of the allocated image.
  * @param src   Source stream, cannot be NULL.
  * @return NULL on failure.
+ *
+ * If GFX_IMAGE_GENERATE_MIPMAPS is given, the image has a full mipmap chain,
+ * generated on the device after upload, see GFX_TRANSFER_MIPMAPS.
+ * The signal commands are then injected in the synchronous (graphics) set,
+ * otherwise they are injected in the asynchronous set.
  */
 GFX_API GFXImage* gfx_load_image(GFXHeap* heap, GFXDependency* dep,
                                  GFXImageFlags flags, GFXImageUsage usage,
                                  const GFXReader* src);
 
+/**
+ * Parses multiple image streams into groufix images, decoding in parallel.
+ * @see gfx_load_image.
+ * @param numImages Number of images to load.
+ * @param srcs      Cannot be NULL if numImages > 0, source streams.
+ * @param images    Cannot be NULL if numImages > 0, output images.
+ * @return Zero on failure, no images are output.
+ *
+ * Images are decoded by a pool of threads, the calling thread included.
+ * The calling thread allocates and (asynchronously) writes each image as
+ * soon as it is decoded, so decoding overlaps with the transfers.
+ * A NULL source stream is skipped, its output image is NULL.
+ * All source streams must be distinct objects.
+ */
+GFX_API bool gfx_load_images(GFXHeap* heap, GFXDependency* dep,
+                             GFXImageFlags flags, GFXImageUsage usage,
+                             size_t numImages, const GFXReader** srcs,
+                             GFXImage** images);
+
+/**
+ * Parses a KTX2 stream into a groufix image, uploading its data as is.
+ * @see gfx_load_image.
+ *
+ * All mipmaps, array layers and cube faces are uploaded, block-compressed
+ * formats (BCn, ETC2, EAC, ASTC) are written to the device without decoding.
+ * The stored format is never converted, use gfx_format_support to pick
+ * which KTX2 file (i.e. block format) to load for a device.
+ * Supercompressed (including Basis Universal) streams are not supported.
+ *
+ * GFX_IMAGE_GENERATE_MIPMAPS only applies if the stream holds no mipmaps
+ * and its format is uncompressed, GFX_IMAGE_READABLE applies as usual,
+ * all other flags are ignored.
+ */
+GFX_API GFXImage* gfx_load_ktx2(GFXHeap* heap, GFXDependency* dep,
+                                GFXImageFlags flags, GFXImageUsage usage,
+                                const GFXReader* src);
+
 
 #endif
@@ -0,0 +1,65 @@
+/**
+ * This file is part of groufix.
+ * Copyright (c) Stef Velzel. All rights reserved.
+ *
+ * groufix : graphics engine produced by Stef Velzel.
+ * www     : <www.vuzzel.nl>
+ */
+
+
+#ifndef GFX_ASSETS_SCENE_H
+#define GFX_ASSETS_SCENE_H
+
+#include "groufix/assets/gltf.h"
+#include "groufix/containers/io.h"
+#include "groufix/core/deps.h"
+#include "groufix/core/heap.h"
+#include "groufix/def.h"
+
+
+/**
+ * Cooks a glTF parsing result into a binary scene stream.
+ * @param heap   Heap to allocate a readback buffer from, cannot be NULL.
+ * @param result Cannot be NULL, result to cook.
+ * @param deps   Cannot be NULL if numDeps > 0.
+ * @param dst    Destination stream, cannot be NULL.
+ * @return Non-zero on success.
+ *
+ * All images and primitives of result are read back from the device in
+ * one blocking operation, they must have been allocated with GFX_MEMORY_READ,
+ * i.e. result must be loaded with the `readable` option set.
+ * Pass wait commands in deps for the dependency result was loaded with,
+ * otherwise the resources may not be written to yet (or be discarded).
+ *
+ * The stream contains all descriptors, followed by GPU-ready data blobs:
+ * each image in its own format (compressed images stay compressed),
+ * each primitive as one interleaved vertex buffer and an index buffer.
+ * Primitives with instance rate attributes cannot be cooked.
+ *
+ * The stream is only valid for builds with an identical struct layout,
+ * it is meant as a cache, not as an interchange format.
+ */
+GFX_API bool gfx_cook_gltf(GFXHeap* heap, const GFXGltfResult* result,
+                           size_t numDeps, const GFXInject* deps,
+                           const GFXWriter* dst);
+
+/**
+ * Loads a binary scene stream into groufix objects.
+ * @param heap   Heap to allocate resources from, cannot be NULL.
+ * @param dep    Dependency to inject signal commands in, cannot be NULL.
+ * @param src    Source stream, cannot be NULL.
+ * @param result Cannot be NULL, output loading results.
+ * @return Non-zero on success, no resources are allocated on failure.
+ *
+ * The source is used directly if it exposes its data (e.g. memory-mapped),
+ * all data is uploaded in a single (asynchronous) batched write.
+ * The result is identical to the cooked result, except that it holds no
+ * buffers, each primitive owns its own vertex & index buffer.
+ * Release with gfx_release_gltf(), resources must be freed manually.
+ */
+GFX_API bool gfx_load_scene(GFXHeap* heap, GFXDependency* dep,
+                            const GFXReader* src,
+                            GFXGltfResult* result);
+
+
+#endif
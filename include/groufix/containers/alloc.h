@@ -0,0 +1,123 @@
+/**
+ * This file is part of groufix.
+ * Copyright (c) Stef Velzel. All rights reserved.
+ *
+ * groufix : graphics engine produced by Stef Velzel.
+ * www     : <www.vuzzel.nl>
+ */
+
+
+#ifndef GFX_CONTAINERS_ALLOC_H
+#define GFX_CONTAINERS_ALLOC_H
+
+#include "groufix/def.h"
+
+
+/**
+ * Host memory allocator definition.
+ * All functions must be thread-safe, semantics equal those of the C library.
+ */
+typedef struct GFXAllocator
+{
+	void* (*alloc)(size_t size, void* user);
+	void* (*realloc)(void* ptr, size_t size, void* user);
+	void  (*free)(void* ptr, void* user);
+
+	void* user; // Passed to all functions.
+
+} GFXAllocator;
+
+
+/**
+ * Linear (arena) allocator definition.
+ */
+typedef struct GFXArena
+{
+	size_t blockSize; // Minimum size of each block.
+	void*  blocks;    // Current block, links to all previous blocks.
+	size_t used;      // Bytes used in the current block.
+	size_t total;     // Total bytes used since last reset.
+
+	void* last; // Last allocation, can be resized in place.
+
+} GFXArena;
+
+
+/**
+ * Sets the allocator used by all containers (and groufix at large).
+ * @param allocator NULL to reset to the C library's malloc/realloc/free.
+ *
+ * The allocator is copied, not referenced.
+ * Must be called before any memory is allocated (i.e. before gfx_init),
+ * memory allocated with one allocator cannot be freed by another!
+ */
+GFX_API void gfx_set_allocator(const GFXAllocator* allocator);
+
+/**
+ * Allocates memory using the allocator set by gfx_set_allocator.
+ * @return NULL when out of memory.
+ */
+GFX_API void* gfx_malloc(size_t size);
+
+/**
+ * Reallocates memory using the allocator set by gfx_set_allocator.
+ * @param ptr May be NULL to allocate new memory.
+ * @return NULL when out of memory, in which case ptr is not freed.
+ */
+GFX_API void* gfx_realloc(void* ptr, size_t size);
+
+/**
+ * Frees memory using the allocator set by gfx_set_allocator.
+ * @param ptr May be NULL.
+ */
+GFX_API void gfx_free(void* ptr);
+
+/**
+ * Initializes an arena.
+ * @param arena     Cannot be NULL.
+ * @param blockSize Minimum size of each memory block, must be > 0.
+ */
+GFX_API void gfx_arena_init(GFXArena* arena, size_t blockSize);
+
+/**
+ * Clears an arena, freeing all memory.
+ * @param arena Cannot be NULL.
+ */
+GFX_API void gfx_arena_clear(GFXArena* arena);
+
+/**
+ * Resets an arena, invalidating all allocations but keeping its memory.
+ * @param arena Cannot be NULL.
+ *
+ * If more than one block was in use, they are merged into one block that
+ * fits everything used since the last reset, so an arena that sees
+ * the same allocations (e.g. every frame) stops allocating entirely.
+ */
+GFX_API void gfx_arena_reset(GFXArena* arena);
+
+/**
+ * Allocates memory from an arena, aligned for any scalar type.
+ * @param arena Cannot be NULL.
+ * @param size  Must be > 0.
+ * @return NULL when out of memory.
+ *
+ * The memory is valid until the arena is reset or cleared.
+ */
+GFX_API void* gfx_arena_alloc(GFXArena* arena, size_t size);
+
+/**
+ * Reallocates memory from an arena.
+ * @param arena   Cannot be NULL.
+ * @param ptr     May be NULL, must be allocated from arena otherwise.
+ * @param oldSize Number of bytes of (the start of) ptr to preserve.
+ * @param size    Must be > 0.
+ * @return NULL when out of memory, in which case ptr is left untouched.
+ *
+ * Resizes in place if ptr was the last allocation, copies otherwise.
+ * The old memory is never reused before the arena is reset.
+ */
+GFX_API void* gfx_arena_realloc(GFXArena* arena, void* ptr,
+                                size_t oldSize, size_t size);
+
+
+#endif
@@ -26,6 +26,9 @@ typedef struct GFXReader
 	// Read function.
 	long long (*read)(const struct GFXReader*, void* data, size_t len);
 
+	// Direct pointer to the entire stream, optional (may be NULL).
+	const void* (*data)(const struct GFXReader*);
+
 } GFXReader;
 
 
@@ -91,6 +94,19 @@ typedef struct GFXFile
 } GFXFile;
 
 
+/**
+ * Memory-mapped file reader stream definition.
+ */
+typedef struct GFXMappedFile
+{
+	GFXReader reader;
+	size_t len;
+	size_t pos;
+	const void* map;
+
+} GFXMappedFile;
+
+
 /**
  * File stream includer definition.
  */
@@ -102,6 +118,45 @@ typedef struct GFXFileIncluder
 } GFXFileIncluder;
 
 
+/**
+ * Memory-mapped file stream includer definition.
+ */
+typedef struct GFXMappedIncluder
+{
+	GFXIncluder includer;
+	char* path;
+
+} GFXMappedIncluder;
+
+
+/**
+ * Asynchronous file reader definition.
+ */
+typedef struct GFXAsyncFile
+{
+	uintptr_t handle; // Native file descriptor or handle.
+	uint64_t  len;
+
+} GFXAsyncFile;
+
+
+/**
+ * Asynchronous read completion definition.
+ */
+typedef struct GFXReadResult
+{
+	void*     ptr; // As passed to gfx_read_queue_push.
+	long long len; // Number of bytes read, -1 on failure.
+
+} GFXReadResult;
+
+
+/**
+ * Asynchronous read queue definition.
+ */
+typedef struct GFXReadQueue GFXReadQueue;
+
+
 /**
  * stdout/stderr constants.
  */
@@ -142,6 +197,17 @@ static inline long long gfx_io_read(const GFXReader* str, void* data, size_t len
 	return str->read(str, data, len);
 }
 
+/**
+ * Shorthand to call the data function.
+ * @return Pointer to all gfx_io_len bytes of the stream, NULL if not available.
+ *
+ * Independent of the current read position, valid as long as the stream is.
+ */
+static inline const void* gfx_io_data(const GFXReader* str)
+{
+	return str->data != NULL ? str->data(str) : NULL;
+}
+
 /**
  * Shorthand to call the write function.
  * @return Number of bytes written, negative on failure.
@@ -223,6 +289,22 @@ GFX_API bool gfx_file_init(GFXFile* file, const char* name, const char* mode);
  */
 GFX_API void gfx_file_clear(GFXFile* file);
 
+/**
+ * Initializes a memory-mapped file stream (i.e. opens & maps it).
+ * @param file Cannot be NULL.
+ * @param name Filename, cannot be NULL, must be NULL-terminated.
+ * @return Non-zero on success.
+ *
+ * The file is mapped read-only, gfx_io_data returns the mapped memory.
+ */
+GFX_API bool gfx_mapped_file_init(GFXMappedFile* file, const char* name);
+
+/**
+ * Clears a memory-mapped file stream (i.e. unmaps & closes it).
+ * @param file Cannot be NULL.
+ */
+GFX_API void gfx_mapped_file_clear(GFXMappedFile* file);
+
 /**
  * Initializes a file stream includer.
  * @param inc  Cannot be NULL.
@@ -237,5 +319,89 @@ GFX_API bool gfx_file_includer_init(GFXFileIncluder* inc, const char* path);
  */
 GFX_API void gfx_file_includer_clear(GFXFileIncluder* inc);
 
+/**
+ * Initializes a memory-mapped file stream includer.
+ * Resolved streams are memory-mapped files, see gfx_mapped_file_init.
+ * @param inc  Cannot be NULL.
+ * @param path Path to search in, cannot be NULL, must be NULL-terminated.
+ * @return Non-zero on success.
+ */
+GFX_API bool gfx_mapped_includer_init(GFXMappedIncluder* inc, const char* path);
+
+/**
+ * Clears a memory-mapped file stream includer.
+ * @param inc Cannot be NULL.
+ */
+GFX_API void gfx_mapped_includer_clear(GFXMappedIncluder* inc);
+
+/**
+ * Initializes an asynchronous file reader (i.e. opens it for reading).
+ * @param file Cannot be NULL.
+ * @param name Filename, cannot be NULL, must be NULL-terminated.
+ * @return Non-zero on success.
+ *
+ * The file can only be read from using a read queue,
+ * it is not a stream and has no position.
+ */
+GFX_API bool gfx_async_file_init(GFXAsyncFile* file, const char* name);
+
+/**
+ * Clears an asynchronous file reader (i.e. closes it).
+ * @param file Cannot be NULL.
+ *
+ * All reads from the file must have completed.
+ */
+GFX_API void gfx_async_file_clear(GFXAsyncFile* file);
+
+/**
+ * Creates an asynchronous read queue.
+ * @param capacity Maximum number of reads in flight, must be > 0.
+ * @return NULL on failure.
+ *
+ * Reads are performed by the OS while the calling thread continues,
+ * using io_uring on Linux and overlapped I/O on Windows.
+ * If neither is available, reads are performed on push instead.
+ * Not thread-safe, use a queue per thread (e.g. per asset thread).
+ */
+GFX_API GFXReadQueue* gfx_create_read_queue(unsigned int capacity);
+
+/**
+ * Destroys an asynchronous read queue.
+ * Blocks until all reads in flight have completed, discarding their results.
+ * @param queue May be NULL.
+ */
+GFX_API void gfx_destroy_read_queue(GFXReadQueue* queue);
+
+/**
+ * Pushes a read from an asynchronous file into a read queue.
+ * @param queue  Cannot be NULL.
+ * @param file   Cannot be NULL, must remain open until completed.
+ * @param offset Offset into the file to read from, in bytes.
+ * @param len    Number of bytes to read.
+ * @param data   Cannot be NULL, must remain valid until completed.
+ * @param ptr    User pointer to identify the completion with.
+ * @return Zero if the queue is full or on failure.
+ *
+ * Like gfx_io_read, fewer bytes than len may be read,
+ * in which case the remainder should be pushed again.
+ */
+GFX_API bool gfx_read_queue_push(GFXReadQueue* queue, const GFXAsyncFile* file,
+                                 uint64_t offset, size_t len, void* data,
+                                 void* ptr);
+
+/**
+ * Retrieves completed reads from a read queue.
+ * @param queue   Cannot be NULL.
+ * @param wait    Non-zero to block until at least one read has completed.
+ * @param max     Maximum number of completions to retrieve.
+ * @param results Cannot be NULL if max > 0, output completions.
+ * @return Number of completions written to results.
+ *
+ * Does not block if no reads are in flight.
+ * Completions are retrieved in any order.
+ */
+GFX_API size_t gfx_read_queue_poll(GFXReadQueue* queue, bool wait,
+                                   size_t max, GFXReadResult* results);
+
 
 #endif
@@ -19,10 +19,11 @@
 typedef struct GFXMap
 {
 	size_t size;     // Number of stored elements.
-	size_t capacity; // Number of buckets.
+	size_t capacity; // Number of slots (power of two).
+	size_t deleted;  // Number of deleted slots.
 	size_t elementSize;
 
-	void** buckets;
+	void** slots; // Followed by a control byte for each slot.
 
 	// Hash function.
 	uint64_t (*hash)(const void*);
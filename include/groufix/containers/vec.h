@@ -10,6 +10,7 @@
 #ifndef GFX_CONTAINERS_VEC_H
 #define GFX_CONTAINERS_VEC_H
 
+#include "groufix/containers/alloc.h"
 #include "groufix/def.h"
 
 
@@ -76,7 +77,7 @@ GFX_API void gfx_vec_release(GFXVec* vec);
  * Claims ownership over the data of a vector.
  * The vector itself will act as if gfx_vec_clear() has been called.
  * @param vec Cannot be NULL.
- * @return Data previously owned by vec, must call free() if not NULL.
+ * @return Data previously owned by vec, must call gfx_free() if not NULL.
  */
 GFX_API void* gfx_vec_claim(GFXVec* vec);
 
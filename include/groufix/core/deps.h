@@ -102,6 +102,12 @@ typedef struct GFXDependency GFXDependency;
  *
  * capacity can be 0 (infinite) to _never_ recycle any internal semaphores,
  * their memory will be stale until the dependency object is destroyed!
+ *
+ * However, if the device supports timeline semaphores, a capacity of 0 uses
+ * timeline semaphores instead. Each signal command signals an increasing
+ * value, which can be re-signaled as soon as it is waited upon.
+ * This allows any number of concurrent wait commands without
+ * growing the internal semaphore pool.
  */
 GFX_API GFXDependency* gfx_create_dep(GFXDevice* device, unsigned int capacity);
 
@@ -74,6 +74,9 @@ typedef struct GFXDevice
 		bool samplerAnisotropy;
 		bool samplerClampToEdgeMirror;
 		bool samplerMinmax;
+		bool pipelineStatistics;
+		bool multiDrawIndirect;
+		bool drawIndirectCount;
 
 	} features;
 
@@ -101,6 +104,7 @@ typedef struct GFXDevice
 		uint32_t maxAttachmentHeight;
 		uint32_t maxAttachmentLayers;
 		uint32_t maxAttachmentOutputs; // Non-depth/stencil r/w attachments.
+		uint32_t maxIndirectCount;     // Draws per indirect command.
 
 		uint32_t maxStageUniformBuffers;
 		uint32_t maxStageStorageBuffers;
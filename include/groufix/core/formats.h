@@ -221,7 +221,7 @@ GFX_API GFXFormat gfx_format_fuzzy(GFXFormat fmt, GFXFuzzyFlags flags,
 		(fmt).comps[0] == 6 ? (unsigned int)128 : \
 		(fmt).comps[0] == 7 ? (unsigned int)128 : (unsigned int)0) : \
 	(fmt).order == GFX_ORDER_ETC2 ? \
-		(unsigned int)64 : \
+		((fmt).comps[3] == 8 ? (unsigned int)128 : (unsigned int)64) : \
 	(fmt).order == GFX_ORDER_EAC ? \
 		((fmt).comps[1] == 0 ? (unsigned int)64 : (unsigned int)128) : \
 	(fmt).order == GFX_ORDER_ASTC ? \
@@ -67,7 +67,15 @@ typedef enum GFXMemoryFlags
 
 	// To allow concurrent async access.
 	GFX_MEMORY_COMPUTE_CONCURRENT  = 0x0010,
-	GFX_MEMORY_TRANSFER_CONCURRENT = 0x0020
+	GFX_MEMORY_TRANSFER_CONCURRENT = 0x0020,
+
+	// Prefer host cached memory, for fast host reads (implies host visible).
+	GFX_MEMORY_READBACK = 0x0041,
+
+	// Prefer device local memory that is also host visible (buffers only).
+	// If it was available (e.g. on ReBAR or UMA devices), the buffer
+	// becomes GFX_MEMORY_HOST_VISIBLE and is directly written to by the host.
+	GFX_MEMORY_DYNAMIC = 0x0080
 
 } GFXMemoryFlags;
 
@@ -186,6 +194,41 @@ typedef struct GFXBinding
 } GFXBinding;
 
 
+/**
+ * Memory budget of a physical device memory heap.
+ */
+typedef struct GFXMemoryBudget
+{
+	GFXMemoryFlags flags; // GFX_MEMORY_DEVICE_LOCAL if device local memory.
+
+	uint64_t size;      // Total size of the memory heap, in bytes.
+	uint64_t budget;    // Estimated budget of the entire process, in bytes.
+	uint64_t usage;     // Estimated usage of the entire process, in bytes.
+	uint64_t allocated; // Allocated by the heap (excluding others), in bytes.
+
+} GFXMemoryBudget;
+
+
+/**
+ * Memory statistics of a heap.
+ */
+typedef struct GFXMemoryStats
+{
+	uint32_t numTypes;   // Number of physical device memory types.
+	uint64_t blocks[32]; // Number of memory blocks, for each memory type.
+
+	uint64_t allocated; // Allocated from the device, in bytes.
+	uint64_t used;      // Used by resources, in bytes.
+	uint64_t largest;   // Largest contiguous free range, in bytes.
+	float    fragmentation; // 1 - largest / (allocated - used), in [0,1].
+
+	uint64_t allocs;    // Live allocations (a slab counts as one).
+	uint64_t cells;     // Live allocations sub-allocated from slabs.
+	uint64_t fallbacks; // Allocations not placed in their optimal memory type.
+
+} GFXMemoryStats;
+
+
 /****************************
  * Heap definition & allocatables.
  ****************************/
@@ -315,7 +358,8 @@ GFX_API bool gfx_heap_flush(GFXHeap* heap);
 GFX_API bool gfx_heap_block(GFXHeap* heap);
 
 /**
- * Purges all resources of operations that have finished.
+ * Purges all resources of operations that have finished
+ * and frees empty memory blocks, see gfx_heap_keep_blocks.
  * Will _NOT_ block for operations to be done!
  * @param heap Cannot be NULL.
  *
@@ -325,6 +369,87 @@ GFX_API bool gfx_heap_block(GFXHeap* heap);
  */
 GFX_API void gfx_heap_purge(GFXHeap* heap);
 
+/**
+ * Sets the number of empty memory blocks a heap keeps for each memory type.
+ * Any other empty memory blocks are freed by gfx_heap_purge.
+ * @param heap Cannot be NULL.
+ * @param num  Number of empty memory blocks to keep, defaults to 1.
+ *
+ * Thread-safe with respect to heap!
+ * Keeping empty memory blocks avoids reallocating device memory when
+ * resources are repeatedly freed and allocated again (e.g. level transitions).
+ */
+GFX_API void gfx_heap_keep_blocks(GFXHeap* heap, uint32_t num);
+
+/**
+ * Limits the number of memory blocks a heap frees per gfx_heap_purge call.
+ * When limited, memory blocks emptied by freeing a resource (e.g. dedicated
+ * allocations of large images) are retired instead of freed immediately.
+ * @param heap Cannot be NULL.
+ * @param num  Maximum blocks freed per purge, 0 for no limit (the default).
+ *
+ * Thread-safe with respect to heap!
+ * Renderers purge their heap every frame, so this spreads the cost of
+ * freeing device memory (e.g. unloading a scene) over multiple frames.
+ */
+GFX_API void gfx_heap_limit_frees(GFXHeap* heap, uint32_t num);
+
+/**
+ * Retrieves the number of physical device memory heaps a heap allocates from.
+ * @param heap Cannot be NULL.
+ */
+GFX_API size_t gfx_heap_get_num_budgets(GFXHeap* heap);
+
+/**
+ * Retrieves the current memory budget of a physical device memory heap.
+ * @param heap  Cannot be NULL.
+ * @param index Memory heap index, must be < gfx_heap_get_num_budgets(heap).
+ *
+ * Thread-safe with respect to heap!
+ * If the device does not support querying budgets, the budget is estimated
+ * from the memory heap size and usage only includes memory allocated by heap.
+ *
+ * Allocations will prefer to fallback to other memory heaps (i.e. device
+ * local memory to host visible memory) if the budget would be exceeded.
+ */
+GFX_API GFXMemoryBudget gfx_heap_get_budget(GFXHeap* heap, size_t index);
+
+/**
+ * Retrieves the current memory statistics of a heap.
+ * @param heap  Cannot be NULL.
+ * @param stats Output statistics, cannot be NULL.
+ *
+ * Thread-safe with respect to heap!
+ * All counters are kept up to date by the heap, only the largest free range
+ * (and thus fragmentation) is computed by this call.
+ * The fallbacks counter is never decreased, it counts all allocations ever
+ * made from a required, but not optimal, memory type.
+ */
+GFX_API void gfx_heap_get_stats(GFXHeap* heap, GFXMemoryStats* stats);
+
+/**
+ * Incrementally defragments the memory of a heap, moving buffers out of
+ * sparsely used memory blocks into more densely used ones.
+ * Emptied memory blocks are freed once the moves are done on the GPU.
+ * @param heap   Cannot be NULL.
+ * @param budget Maximum number of bytes to move.
+ * @param dep    Cannot be NULL, signaled with respect to each moved buffer.
+ * @return Number of bytes moved, 0 if nothing was moved.
+ *
+ * Not thread-safe with respect to the buffers of heap!
+ * Only moves buffers allocated with GFX_MEMORY_READ and without
+ * GFX_MEMORY_HOST_VISIBLE, primitives, groups and images are never moved.
+ * Nor are buffers referenced by any primitive, group or set, they are
+ * only moved once all of those are freed, erased or no longer reference it.
+ *
+ * A moved buffer must not be used by any operation before dep is waited upon,
+ * nor may it be referenced by any pending signal command at the time of calling.
+ * Any command recorded with a moved buffer (e.g. indirect draws) is invalid,
+ * this includes retained recordings, gfx_recorder_invalidate must be called!
+ */
+GFX_API uint64_t gfx_heap_defragment(GFXHeap* heap, uint64_t budget,
+                                     GFXDependency* dep);
+
 /**
  * Allocates a buffer from a heap.
  * @param heap  Cannot be NULL.
@@ -387,6 +512,10 @@ GFX_API void gfx_free_image(GFXImage* image);
  * @param attribs     Array of numAttribs GFXAttribute structs, cannot be NULL.
  * @return NULL on failure.
  *
+ * Small primitives whose attributes are all interleaved in a newly allocated
+ * buffer, and whose indices are newly allocated (if any), are sub-allocated
+ * from large vertex/index buffers shared with other primitives of the heap,
+ * so consecutive draws of them do not rebind any buffers.
  * Thread-safe with respect to heap!
  */
 GFX_API GFXPrimitive* gfx_alloc_prim(GFXHeap* heap,
@@ -466,10 +595,11 @@ GFX_API GFXBinding gfx_group_get_binding(GFXGroup* group, size_t binding);
  */
 typedef enum GFXTransferFlags
 {
-	GFX_TRANSFER_NONE  = 0x0000,
-	GFX_TRANSFER_ASYNC = 0x0001,
-	GFX_TRANSFER_FLUSH = 0x0002,
-	GFX_TRANSFER_BLOCK = 0x0004 // Implies GFX_TRANSFER_FLUSH.
+	GFX_TRANSFER_NONE    = 0x0000,
+	GFX_TRANSFER_ASYNC   = 0x0001,
+	GFX_TRANSFER_FLUSH   = 0x0002,
+	GFX_TRANSFER_BLOCK   = 0x0004, // Implies GFX_TRANSFER_FLUSH.
+	GFX_TRANSFER_MIPMAPS = 0x0008  // Ignores GFX_TRANSFER_ASYNC.
 
 } GFXTransferFlags;
 
@@ -516,9 +646,22 @@ typedef enum GFXFilter
  *  One of a pair can have a size of zero and it will be ignored.
  *  Likewise, with two images, one can have a width/height/depth of zero.
  *
+ * gfx_read and gfx_write on buffers with GFX_MEMORY_HOST_VISIBLE (including
+ * buffers that became host visible, see GFX_MEMORY_DYNAMIC) map the buffer
+ * and copy on the host, no staging, no submission and no dependencies.
+ *
+ * If GFX_TRANSFER_MIPMAPS is passed, all mipmaps except the first of each
+ * destination image (excluding attachments) are generated afterwards by
+ * successively downsampling from mipmap 0, recorded in the same operation.
+ * This requires blitting, so the operation is always performed on the
+ * graphics queue, as if GFX_TRANSFER_ASYNC was not passed.
+ * The image cannot be compressed or have a depth/stencil format and must
+ * have been allocated with both GFX_MEMORY_READ and GFX_MEMORY_WRITE.
+ *
  * gfx_read only:
  *  Will act as if GFX_TRANSFER_BLOCK is always passed!
  *  Note this means gfx_read will _always_ trigger a flush.
+ *  GFX_TRANSFER_MIPMAPS is ignored.
  */
 GFX_API bool gfx_read(GFXReference src, void* dst,
                       GFXTransferFlags flags,
@@ -526,6 +669,53 @@ GFX_API bool gfx_read(GFXReference src, void* dst,
                       const GFXRegion* srcRegions, const GFXRegion* dstRegions,
                       const GFXInject* deps);
 
+/**
+ * Asynchronous read operation (readback) definition.
+ */
+typedef struct GFXReadback GFXReadback;
+
+/**
+ * Reads data from a memory resource reference without blocking.
+ * @see gfx_read.
+ * @return NULL on failure.
+ *
+ * Acts as if GFX_TRANSFER_FLUSH is always passed, GFX_TRANSFER_BLOCK is ignored.
+ * The data is only written to dst by gfx_readback_(poll|wait) once the device
+ * is done, dst (not the regions) must remain valid until then.
+ * Must be freed with gfx_readback_free before the heap of src is destroyed.
+ */
+GFX_API GFXReadback* gfx_read_async(GFXReference src, void* dst,
+                                    GFXTransferFlags flags,
+                                    size_t numRegions, size_t numDeps,
+                                    const GFXRegion* srcRegions,
+                                    const GFXRegion* dstRegions,
+                                    const GFXInject* deps);
+
+/**
+ * Polls whether a readback is done, without blocking.
+ * @param readback Cannot be NULL.
+ * @return Non-zero if done, i.e. the data is written to dst.
+ *
+ * Not thread-safe with respect to the readback!
+ */
+GFX_API bool gfx_readback_poll(GFXReadback* readback);
+
+/**
+ * Blocks until a readback is done.
+ * @param readback Cannot be NULL.
+ * @return Zero on failure, the data is not written to dst.
+ *
+ * Not thread-safe with respect to the readback!
+ */
+GFX_API bool gfx_readback_wait(GFXReadback* readback);
+
+/**
+ * Frees a readback, if not done yet, its data will never be written.
+ * Blocks until the device is done with it if it was not done yet.
+ * @param readback May be NULL.
+ */
+GFX_API void gfx_readback_free(GFXReadback* readback);
+
 /**
  * Writes data to a memory resource reference.
  * @see gfx_read.
@@ -579,6 +769,123 @@ GFX_API bool gfx_resolve(GFXImageRef src, GFXImageRef dst,
                          const GFXRegion* srcRegions, const GFXRegion* dstRegions,
                          const GFXInject* deps);
 
+/**
+ * Generates all mipmaps of an image from its first mipmap.
+ * @param ref  Cannot be GFX_REF_NULL, must reference a heap image.
+ * @param deps Cannot be NULL if numDeps > 0.
+ * @see gfx_read.
+ *
+ * Equivalent to a transfer operation with GFX_TRANSFER_MIPMAPS that writes
+ * no regions, every mipmap is blitted from the previous one using a linear
+ * filter if the format supports it (nearest otherwise).
+ * Mipmap 0 of the image is only preserved if the operation waits on
+ * whatever wrote to it before, i.e. with a wait command in deps.
+ */
+GFX_API bool gfx_image_generate_mips(GFXImageRef ref,
+                                     GFXTransferFlags flags,
+                                     size_t numDeps, const GFXInject* deps);
+
+/**
+ * Write operation, to be performed in a batch.
+ */
+typedef struct GFXWriteOp
+{
+	const void*      src;
+	GFXReference     dst;
+	size_t           numRegions;
+	const GFXRegion* srcRegions;
+	const GFXRegion* dstRegions;
+
+} GFXWriteOp;
+
+
+/**
+ * Copy operation, to be performed in a batch.
+ */
+typedef struct GFXCopyOp
+{
+	GFXReference     src;
+	GFXReference     dst;
+	size_t           numRegions;
+	const GFXRegion* srcRegions;
+	const GFXRegion* dstRegions;
+
+} GFXCopyOp;
+
+
+/**
+ * Writes data to multiple memory resource references at once.
+ * @param numOps Must be > 0.
+ * @param ops    Cannot be NULL, all fields are as in gfx_write.
+ * @param deps   Cannot be NULL if numDeps > 0.
+ * @return Non-zero on success.
+ * @see gfx_write.
+ *
+ * All destinations must be allocated from the same heap.
+ * The batch is recorded as a single operation with one staging buffer,
+ * dependencies are injected once for the entire batch.
+ * Host visible buffers are still written to by mapping them.
+ */
+GFX_API bool gfx_write_batch(GFXTransferFlags flags,
+                             size_t numOps, size_t numDeps,
+                             const GFXWriteOp* ops, const GFXInject* deps);
+
+/**
+ * Copies data between multiple pairs of memory resource references at once.
+ * @param numOps Must be > 0.
+ * @param ops    Cannot be NULL, all fields are as in gfx_copy.
+ * @param deps   Cannot be NULL if numDeps > 0.
+ * @return Non-zero on success.
+ * @see gfx_copy.
+ *
+ * All sources must be allocated from the same heap.
+ * The batch is recorded as a single operation,
+ * dependencies are injected once for the entire batch.
+ */
+GFX_API bool gfx_copy_batch(GFXTransferFlags flags,
+                            size_t numOps, size_t numDeps,
+                            const GFXCopyOp* ops, const GFXInject* deps);
+
+/**
+ * Queues a prioritized streaming upload to a memory resource reference.
+ * @param heap     Cannot be NULL, must be the heap dst is allocated from.
+ * @param priority Uploads of higher priority are submitted first.
+ * @return Non-zero on success.
+ * @see gfx_write for all other parameters.
+ *
+ * The source data is copied, it does not need to remain valid after this call.
+ * Uploads are only submitted (asynchronously) by gfx_heap_stream.
+ * Freeing the destination resource drops all of its queued uploads.
+ * Wait commands are submitted with the first part of the upload and signal
+ * commands with the last part, so they can be used to know when it has
+ * completed.
+ */
+GFX_API bool gfx_heap_stream_write(GFXHeap* heap, unsigned int priority,
+                                   const void* src, GFXReference dst,
+                                   size_t numRegions, size_t numDeps,
+                                   const GFXRegion* srcRegions,
+                                   const GFXRegion* dstRegions,
+                                   const GFXInject* deps);
+
+/**
+ * Submits queued streaming uploads of a heap, highest priority first.
+ * @param heap   Cannot be NULL.
+ * @param budget Maximum number of bytes to submit, 0 for no maximum.
+ * @return Zero on failure, uploads stay queued.
+ *
+ * Call once per frame to spread large uploads over multiple frames.
+ * Each region is submitted as a separate part, regions are split further to
+ * fit the budget: buffer regions at any byte, image regions into ranges of
+ * rows (of blocks) within a single layer or depth slice, 1D image regions
+ * into ranges of layers. As long as any upload is queued, at least one
+ * part is submitted, even if it exceeds the budget.
+ * All parts are submitted as one batch, @see gfx_write_batch.
+ *
+ * Uploads can be queued while submitting, freeing the destination resource
+ * of an upload that is being submitted blocks until it is submitted.
+ */
+GFX_API bool gfx_heap_stream(GFXHeap* heap, uint64_t budget);
+
 /**
  * Maps a buffer reference to a host virtual address pointer.
  * @param ref Cannot be GFX_REF_NULL.
@@ -586,6 +893,10 @@ GFX_API bool gfx_resolve(GFXImageRef src, GFXImageRef dst,
  *
  * This function is reentrant, meaning any buffer can be mapped any number
  * of times, from any thread!
+ *
+ * Memory of GFX_MEMORY_READBACK buffers may not be coherent, it is invalidated
+ * by this call and flushed by gfx_unmap. Therefore device writes must be done
+ * before mapping and host writes are only visible to the device after unmapping.
  */
 GFX_API void* gfx_map(GFXBufferRef ref);
 
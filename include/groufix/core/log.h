@@ -60,6 +60,74 @@ typedef enum GFXLogLevel
 #endif
 
 
+/**
+ * Trace zone, static source location of a traced scope.
+ * Mirrors Tracy's ___tracy_source_location_data, so it can be passed as is.
+ */
+typedef struct GFXTraceZone
+{
+	const char* name;
+	const char* function;
+	const char* file;
+	uint32_t    line;
+	uint32_t    color; // 0 for the default color.
+
+} GFXTraceZone;
+
+
+/**
+ * Trace zone context, returned when beginning a zone.
+ */
+typedef struct GFXTraceCtx
+{
+	const struct GFXTracer* tracer; // NULL if not traced.
+	uint64_t                id;     // Returned by tracer->begin.
+
+} GFXTraceCtx;
+
+
+/**
+ * Tracer definition, receives all zones of all threads.
+ * Functions are called from the thread the zone is in, they must be thread-safe.
+ *
+ * Zones are strictly nested per thread, end is always called on the same
+ * thread as its begin, with the value it returned (e.g. a TracyCZoneCtx).
+ */
+typedef struct GFXTracer
+{
+	uint64_t (*begin)(const GFXTraceZone* zone, void* user);
+	void     (*end)(uint64_t ctx, void* user);
+
+	void* user; // Passed to all functions.
+
+} GFXTracer;
+
+
+/**
+ * Tracing macros, define GFX_TRACE to enable them (TRACE=ON in the Makefile).
+ * Use as follows, begin and end must be within the same scope:
+ *  gfx_trace_begin(zone, "Name");
+ *  ...
+ *  gfx_trace_end(zone);
+ *
+ * When GFX_TRACE is not defined, they compile to nothing at all.
+ * The library itself traces frame, resource and lock-wait hot paths.
+ */
+#if defined (GFX_TRACE)
+	#define gfx_trace_begin(zName, str) \
+		static const GFXTraceZone _gfx_trace_zone_##zName = { \
+			.name = str, .function = __func__, \
+			.file = __FILE__, .line = __LINE__, .color = 0 }; \
+		const GFXTraceCtx _gfx_trace_ctx_##zName = \
+			gfx_trace_begin_zone(&_gfx_trace_zone_##zName)
+	#define gfx_trace_end(zName) \
+		gfx_trace_end_zone(_gfx_trace_ctx_##zName)
+#else
+	#define gfx_trace_begin(zName, str)
+	#define gfx_trace_end(zName)
+#endif
+
+
 /**
  * Logs a new line to the log output of the calling thread.
  * @param level Must be > GFX_LOG_NONE and < GFX_LOG_ALL.
@@ -95,5 +163,119 @@ GFX_API bool gfx_log_set_level(GFXLogLevel level);
  */
 GFX_API bool gfx_log_set(const GFXWriter* out);
 
+/**
+ * Sets the tracer that receives all trace zones, of all threads.
+ * @param tracer NULL to disable tracing.
+ *
+ * Can be called from any thread at any time, the tracer is referenced, not
+ * copied, and must remain valid until all zones begun with it have ended.
+ * Zones are only ever emitted if groufix was built with GFX_TRACE defined.
+ */
+GFX_API void gfx_trace_set(const GFXTracer* tracer);
+
+/**
+ * Begins a trace zone, use gfx_trace_begin instead.
+ * @param zone Cannot be NULL, must remain valid (i.e. static).
+ * @return Context to pass to gfx_trace_end_zone.
+ */
+GFX_API GFXTraceCtx gfx_trace_begin_zone(const GFXTraceZone* zone);
+
+/**
+ * Ends a trace zone, use gfx_trace_end instead.
+ * @param ctx Returned by gfx_trace_begin_zone on the calling thread.
+ */
+GFX_API void gfx_trace_end_zone(GFXTraceCtx ctx);
+
+
+/****************************
+ * Asynchronous logging.
+ ****************************/
+
+/**
+ * Asynchronous logging output definition.
+ */
+typedef struct GFXAsyncLog GFXAsyncLog;
+
+
+/**
+ * Creates an asynchronous logging output.
+ * @param out      Writer stream to output to, cannot be NULL.
+ * @param capacity Maximum number of records buffered per thread, 0 for default.
+ * @return NULL on failure.
+ *
+ * Every thread logging to it formats its records into its own lock-free
+ * ring buffer, which is drained to out by a background writer thread.
+ * A thread's ring is freed once drained after the thread detaches.
+ * Records that do not fit in a thread's ring are dropped and counted,
+ * records longer than a fixed maximum are truncated.
+ * Must be called after gfx_init (to be used by attached threads).
+ */
+GFX_API GFXAsyncLog* gfx_create_async_log(const GFXWriter* out, size_t capacity);
+
+/**
+ * Destroys an asynchronous logging output, writing all remaining records.
+ * @param log May be NULL.
+ *
+ * No thread may log to it anymore, i.e. reset their output with gfx_log_set.
+ * Must be called before gfx_terminate.
+ */
+GFX_API void gfx_destroy_async_log(GFXAsyncLog* log);
+
+/**
+ * Retrieves the writer stream of an asynchronous logging output.
+ * @param log Cannot be NULL.
+ * @return Writer to pass to gfx_log_set, valid as long as log exists.
+ *
+ * Writes through this writer from threads that are not attached are dropped.
+ */
+GFX_API const GFXWriter* gfx_async_log_get_writer(GFXAsyncLog* log);
+
+/**
+ * Retrieves the number of records dropped by an asynchronous logging output.
+ * @param log Cannot be NULL.
+ *
+ * Can be called from any thread.
+ */
+GFX_API uint64_t gfx_async_log_get_dropped(GFXAsyncLog* log);
+
+
+/****************************
+ * Chrome trace output.
+ ****************************/
+
+/**
+ * Chrome trace output definition.
+ */
+typedef struct GFXTraceWriter GFXTraceWriter;
+
+
+/**
+ * Creates a tracer that writes all zones as Chrome trace JSON.
+ * @param out Writer stream to output to, cannot be NULL.
+ * @return NULL on failure.
+ *
+ * The output is in Chrome's JSON array format, viewable with Perfetto or
+ * chrome://tracing. Writes are synchronized with all other logging output,
+ * pass the writer of a GFXAsyncLog for lower overhead.
+ * Must be called after gfx_init (to name threads by their id).
+ */
+GFX_API GFXTraceWriter* gfx_create_trace_writer(const GFXWriter* out);
+
+/**
+ * Destroys a Chrome trace output, terminating the JSON array.
+ * @param trace May be NULL.
+ *
+ * Its tracer must be reset with gfx_trace_set and no zones begun with it
+ * may still be in progress. Must be called before gfx_terminate.
+ */
+GFX_API void gfx_destroy_trace_writer(GFXTraceWriter* trace);
+
+/**
+ * Retrieves the tracer of a Chrome trace output.
+ * @param trace Cannot be NULL.
+ * @return Tracer to pass to gfx_trace_set, valid as long as trace exists.
+ */
+GFX_API const GFXTracer* gfx_trace_writer_get_tracer(GFXTraceWriter* trace);
+
 
 #endif
@@ -469,8 +469,11 @@ typedef struct GFXRenderable
 	GFXPrimitive* primitive;
 
 	const GFXRenderState* state;
+	GFXTechnique*         fallback;
+	size_t                variant;
 
 	GFX_ATOMIC(bool) lock;
+	GFX_ATOMIC(bool) pending;
 
 	uintptr_t pipeline;
 	uint32_t  gen;
@@ -485,6 +488,7 @@ typedef struct GFXComputable
 {
 	// All read-only.
 	GFXTechnique* technique;
+	size_t        variant;
 
 	GFX_ATOMIC(uintptr_t) pipeline;
 
@@ -529,6 +533,40 @@ GFX_API bool gfx_renderable(GFXRenderable* renderable,
  */
 GFX_API bool gfx_renderable_warmup(GFXRenderable* renderable);
 
+/**
+ * Selects the variant of the renderable's technique (technique must be locked).
+ * @param renderable Cannot be NULL.
+ * @param variant    Must be < gfx_tech_get_num_variants(renderable->technique).
+ * @return Zero if the technique is not locked or variant is out of bounds.
+ *
+ * Must be called after gfx_renderable, which resets the variant to 0.
+ * Same thread-safety rules as gfx_renderable. Changing the variant drops the
+ * current pipeline, warmup (or draw) to build the selected variant.
+ */
+GFX_API bool gfx_renderable_variant(GFXRenderable* renderable, size_t variant);
+
+/**
+ * Sets the fallback technique of a renderable (technique must be locked).
+ * When the renderer compiles pipelines in the background, this technique is
+ * drawn with while the renderable's own pipeline is not yet available.
+ * @param renderable Cannot be NULL.
+ * @param tech       NULL to skip draw commands instead, the default.
+ *
+ * Must be called after gfx_renderable, which resets the fallback.
+ * The fallback should be cheap to compile, preferably warmed up.
+ */
+GFX_API void gfx_renderable_fallback(GFXRenderable* renderable,
+                                     GFXTechnique* tech);
+
+/**
+ * Returns whether the pipeline of a renderable is compiled and up-to-date.
+ * @param renderable Cannot be NULL.
+ *
+ * Can be called from any thread at any time!
+ * If the associated pass is changed, the renderable becomes not-ready again.
+ */
+GFX_API bool gfx_renderable_is_ready(GFXRenderable* renderable);
+
 /**
  * Initializes a computable.
  * The object pointed to by computable _CAN_ be moved or copied!
@@ -540,6 +578,13 @@ GFX_API bool gfx_renderable_warmup(GFXRenderable* renderable);
 GFX_API bool gfx_computable(GFXComputable* computable,
                             GFXTechnique* tech);
 
+/**
+ * Selects the variant of the computable's technique (technique must be locked).
+ * @param computable Cannot be NULL.
+ * @see gfx_renderable_variant.
+ */
+GFX_API bool gfx_computable_variant(GFXComputable* computable, size_t variant);
+
 /**
  * Warms up the internal pipeline cache (technique must be locked).
  * @param computable Cannot be NULL.
@@ -547,11 +592,73 @@ GFX_API bool gfx_computable(GFXComputable* computable,
  */
 GFX_API bool gfx_computable_warmup(GFXComputable* computable);
 
+/**
+ * Warms up the internal pipeline cache for a batch of renderables and
+ * computables in parallel (all techniques must be locked).
+ * @param renderer       Cannot be NULL.
+ * @param numRenderables Number of renderables to warmup.
+ * @param renderables    Cannot be NULL if numRenderables > 0.
+ * @param numComputables Number of computables to warmup.
+ * @param computables    Cannot be NULL if numComputables > 0.
+ * @return Non-zero if all pipelines were built.
+ *
+ * All renderables and computables must be associated with renderer.
+ * Identical pipelines are only built once.
+ *
+ * Same thread-safety rules as gfx_renderable_warmup and gfx_computable_warmup,
+ * blocks until all pipelines are built, using multiple threads to build them.
+ */
+GFX_API bool gfx_renderer_warmup_batch(GFXRenderer* renderer,
+                                       size_t numRenderables,
+                                       GFXRenderable** renderables,
+                                       size_t numComputables,
+                                       GFXComputable** computables);
+
 
 /****************************
  * Renderer handling.
  ****************************/
 
+/**
+ * Descriptor pool statistics of a renderer.
+ * Sizes of new descriptor pools follow the moving average of the
+ * descriptors of all sets allocated from the renderer.
+ */
+typedef struct GFXDescriptorStats
+{
+	uint64_t pools;   // Number of allocated descriptor pools.
+	uint32_t maxSets; // Max number of sets in a new descriptor pool.
+
+	// Number of descriptors of each type in a new descriptor pool.
+	uint32_t samplers;
+	uint32_t combinedImageSamplers;
+	uint32_t sampledImages;
+	uint32_t storageImages;
+	uint32_t uniformTexelBuffers;
+	uint32_t storageTexelBuffers;
+	uint32_t uniformBuffers;
+	uint32_t storageBuffers;
+	uint32_t dynamicUniformBuffers;
+	uint32_t dynamicStorageBuffers;
+	uint32_t inputAttachments;
+
+} GFXDescriptorStats;
+
+
+/**
+ * Renderer presentation pacing statistics.
+ * All intervals are in nanoseconds, measured between presentations.
+ */
+typedef struct GFXPacingStats
+{
+	uint64_t last;    // Most recent interval.
+	uint64_t average; // Moving average of all intervals.
+	uint64_t jitter;  // Moving average deviation from the average.
+	uint64_t count;   // Number of measured intervals.
+
+} GFXPacingStats;
+
+
 /**
  * Creates a renderer.
  * @param heap   Cannot be NULL, heap to allocate attachments from.
@@ -593,6 +700,9 @@ GFX_API unsigned int gfx_renderer_get_num_frames(GFXRenderer* renderer);
  * @return Zero on failure.
  *
  * Cannot run concurrently with _ANY_ function of the renderer's descendants!
+ * Data is only accepted if stored by the same groufix version, for the same
+ * device and driver version. If src provides direct access to its data,
+ * i.e. a GFXMappedFile, no data is read or copied.
  */
 GFX_API bool gfx_renderer_load_cache(GFXRenderer* renderer,
                                      const GFXReader* src);
@@ -604,10 +714,196 @@ GFX_API bool gfx_renderer_load_cache(GFXRenderer* renderer,
  * @return Zero on failure.
  *
  * Cannot run concurrently with _ANY_ function of the renderer's descendants!
+ * Always writes all data, see gfx_renderer_save_cache to skip unchanged data.
  */
 GFX_API bool gfx_renderer_store_cache(GFXRenderer* renderer,
                                       const GFXWriter* dst);
 
+/**
+ * Saves the current groufix pipeline cache data to a file, only writes
+ * anything if pipelines were added since it was last loaded or stored.
+ * @param renderer Cannot be NULL.
+ * @param path     NULL-terminated file path, cannot be NULL.
+ * @return Zero on failure.
+ *
+ * Cannot run concurrently with _ANY_ function of the renderer's descendants!
+ * The file is overwritten atomically (via a temporary file that is renamed),
+ * so it never holds partial data, nor does it grow over multiple saves.
+ */
+GFX_API bool gfx_renderer_save_cache(GFXRenderer* renderer, const char* path);
+
+/**
+ * Enables or disables GPU profiling of a renderer, disabled by default.
+ * When enabled, virtual frames write timestamps around each pass and
+ * around the output of each recorder within, see gfx_frame_get_timings.
+ * @param renderer Cannot be NULL.
+ *
+ * Cannot be called inbetween gfx_frame_start and gfx_frame_submit!
+ * Passes on a queue without timestamp support are not profiled.
+ */
+GFX_API void gfx_renderer_set_profiling(GFXRenderer* renderer, bool enabled);
+
+/**
+ * Returns whether GPU profiling of a renderer is enabled.
+ * @param renderer Cannot be NULL.
+ */
+GFX_API bool gfx_renderer_is_profiling(GFXRenderer* renderer);
+
+/**
+ * Enables or disables background pipeline compilation, disabled by default.
+ * When enabled, draw commands whose pipeline is not present in the cache
+ * queue it for compilation on a background thread and draw using the
+ * renderable's fallback technique meanwhile, or are skipped.
+ * @param renderer Cannot be NULL.
+ *
+ * Cannot be called inbetween gfx_frame_start and gfx_frame_submit!
+ * As long as a renderable is not ready (see gfx_renderable_is_ready) after
+ * being drawn, it must not be moved, re-initialized or freed, and its
+ * technique and primitive must not be modified or erased.
+ */
+GFX_API void gfx_renderer_set_async(GFXRenderer* renderer, bool async);
+
+/**
+ * Returns whether background pipeline compilation of a renderer is enabled.
+ * @param renderer Cannot be NULL.
+ */
+GFX_API bool gfx_renderer_is_async(GFXRenderer* renderer);
+
+/**
+ * Enables or disables live swapchain recreation, disabled by default.
+ * When enabled, recreating a window's swapchain (e.g. when resized) does
+ * not wait for pending virtual frames, they keep presenting to the old
+ * swapchain while the new one and all its dependent resources are built.
+ * @param renderer Cannot be NULL.
+ *
+ * Cannot be called inbetween gfx_frame_start and gfx_frame_submit!
+ * Old resources are destroyed once no virtual frame can reference them,
+ * temporarily keeping more memory alive during continuous resizes.
+ */
+GFX_API void gfx_renderer_set_live_recreate(GFXRenderer* renderer, bool live);
+
+/**
+ * Returns whether live swapchain recreation of a renderer is enabled.
+ * @param renderer Cannot be NULL.
+ */
+GFX_API bool gfx_renderer_is_live_recreate(GFXRenderer* renderer);
+
+/**
+ * Limits the number of frames the GPU may fall behind, 0 by default.
+ * When set, gfx_renderer_acquire blocks until the GPU finished all virtual
+ * frames but the last `frames` submitted ones and, if the device supports
+ * VK_KHR_present_wait, until all but the last `frames` presentations to
+ * each window were displayed.
+ * @param renderer Cannot be NULL.
+ * @param frames   Maximum frames in flight, 0 for no limit (i.e. #frames).
+ *
+ * Cannot be called inbetween gfx_frame_start and gfx_frame_submit!
+ * Trades throughput for input-to-photon latency, a limit of 1 keeps at
+ * most one frame queued. Combine with GFX_WINDOW_RELAXED for minimal
+ * stutter when a frame misses a vertical blank.
+ */
+GFX_API void gfx_renderer_set_latency(GFXRenderer* renderer, unsigned int frames);
+
+/**
+ * Retrieves the latency limit of a renderer, 0 if not limited.
+ * @param renderer Cannot be NULL.
+ */
+GFX_API unsigned int gfx_renderer_get_latency(GFXRenderer* renderer);
+
+/**
+ * Limits the number of stale Vulkan objects a renderer destroys per frame.
+ * Objects replaced while rendering (e.g. by rebuilding the render graph or
+ * destroying sets) are kept until the frames using them are done, after
+ * which gfx_renderer_acquire destroys at most `num` of them.
+ * @param renderer Cannot be NULL.
+ * @param num      Maximum objects destroyed per frame, 0 for no limit.
+ *
+ * Cannot be called inbetween gfx_frame_start and gfx_frame_submit!
+ * Spreads the destruction of many objects (e.g. unloading a scene) over
+ * multiple frames, to avoid a hitch, at the cost of keeping them longer.
+ */
+GFX_API void gfx_renderer_set_destroy_budget(GFXRenderer* renderer,
+                                             unsigned int num);
+
+/**
+ * Retrieves the destroy budget of a renderer, 0 if not limited.
+ * @param renderer Cannot be NULL.
+ */
+GFX_API unsigned int gfx_renderer_get_destroy_budget(GFXRenderer* renderer);
+
+/**
+ * Sets the virtual presentation interval of a renderer.
+ * A submission that presents no window presents 'virtually', which blocks
+ * gfx_frame_submit until at least `interval` passed since the previous.
+ * @param renderer Cannot be NULL.
+ * @param interval In nanoseconds, 0 to never block (the default).
+ *
+ * Cannot be called inbetween gfx_frame_start and gfx_frame_submit!
+ * Paces headless rendering (e.g. offscreen image attachments only) as if
+ * presenting to a display, combine with gfx_frame_read for output.
+ */
+GFX_API void gfx_renderer_set_interval(GFXRenderer* renderer, uint64_t interval);
+
+/**
+ * Retrieves the virtual presentation interval of a renderer in nanoseconds.
+ * @param renderer Cannot be NULL.
+ */
+GFX_API uint64_t gfx_renderer_get_interval(GFXRenderer* renderer);
+
+/**
+ * Retrieves the number of physical devices a renderer renders with,
+ * i.e. the size of the device group of its device, at least 1.
+ * @param renderer Cannot be NULL.
+ */
+GFX_API unsigned int gfx_renderer_get_num_devices(GFXRenderer* renderer);
+
+/**
+ * Sets whether a renderer uses alternate frame rendering (AFR).
+ * Each submission that presents no window is then rendered by the next
+ * physical device of the device group in turn.
+ * @param renderer Cannot be NULL.
+ *
+ * Cannot be called inbetween gfx_frame_start and gfx_frame_submit!
+ * No-op for device groups of a single device. Each device has its own
+ * instance of the attachments (and device memory) and readbacks issued by
+ * gfx_frame_read are performed by the device that rendered the frame,
+ * passes must not depend on attachment contents of previous frames.
+ * Presentation is never alternated, frames that do present are rendered
+ * by all devices. Combine with gfx_renderer_set_interval when headless.
+ */
+GFX_API void gfx_renderer_set_afr(GFXRenderer* renderer, bool afr);
+
+/**
+ * Retrieves whether a renderer uses alternate frame rendering.
+ * @param renderer Cannot be NULL.
+ */
+GFX_API bool gfx_renderer_is_afr(GFXRenderer* renderer);
+
+/**
+ * Retrieves presentation pacing statistics of a renderer.
+ * @param renderer Cannot be NULL.
+ * @param stats    Cannot be NULL, output statistics.
+ *
+ * Intervals are measured on the host, every time gfx_frame_submit presents
+ * to at least one window or presents virtually (if it presents no window).
+ * With a latency limit these follow the actual pacing of the display,
+ * as submission is throttled by it.
+ * Cannot be called inbetween gfx_frame_start and gfx_frame_submit!
+ */
+GFX_API void gfx_renderer_get_pacing(GFXRenderer* renderer, GFXPacingStats* stats);
+
+/**
+ * Retrieves descriptor pool statistics of a renderer.
+ * @param renderer Cannot be NULL.
+ * @param stats    Cannot be NULL, output statistics.
+ *
+ * Pool sizes are re-evaluated every gfx_frame_submit, a pool holds at least
+ * a few sets of the set layout that caused it to be allocated.
+ * Cannot be called inbetween gfx_frame_start and gfx_frame_submit!
+ */
+GFX_API void gfx_renderer_get_descriptor_stats(GFXRenderer* renderer,
+                                               GFXDescriptorStats* stats);
+
 /**
  * Describes the properties of an image attachment of a renderer.
  * If the attachment already exists, it will be detached and overwritten.
@@ -671,6 +967,19 @@ GFX_API void gfx_renderer_detach(GFXRenderer* renderer, size_t index);
  * Frame operations.
  ****************************/
 
+/**
+ * GPU timing of a pass or of a recorder within a pass.
+ * The pointers are for identification only, they may no longer exist.
+ */
+typedef struct GFXTiming
+{
+	GFXPass*     pass;
+	GFXRecorder* recorder; // NULL for the entire pass.
+	uint64_t     time;     // In nanoseconds.
+
+} GFXTiming;
+
+
 /**
  * Acquires the next virtual frame of a renderer, blocks until available!
  * Implicitly starts and/or submits if not yet done after the previous call.
@@ -689,6 +998,21 @@ GFX_API GFXFrame* gfx_renderer_acquire(GFXRenderer* renderer);
  */
 GFX_API unsigned int gfx_frame_get_index(GFXFrame* frame);
 
+/**
+ * Retrieves the GPU timings of the previous submission of a virtual frame.
+ * Only available if the renderer was profiling during that submission.
+ * @param frame      Cannot be NULL.
+ * @param numTimings Outputs the number of timings, cannot be NULL.
+ * @return Array of numTimings timings, NULL if none.
+ *
+ * Timings are resolved when the frame is acquired (without stalling, as
+ * the frame is done rendering) and remain valid until it is acquired again.
+ * Passes that were skipped or culled have no timings, neither do
+ * recorders that did not record anything for a pass.
+ */
+GFX_API const GFXTiming* gfx_frame_get_timings(GFXFrame* frame,
+                                               size_t* numTimings);
+
 /**
  * Prepares the acquired virtual frame to start recording.
  * Can only be called inbetween gfx_renderer_acquire and gfx_frame_submit!
@@ -702,6 +1026,50 @@ GFX_API unsigned int gfx_frame_get_index(GFXFrame* frame);
  */
 GFX_API void gfx_frame_start(GFXFrame* frame);
 
+/**
+ * Allocates transient host visible memory from the acquired virtual frame.
+ * Can only be called inbetween gfx_renderer_acquire and gfx_frame_submit!
+ * @param frame Cannot be NULL.
+ * @param size  Must be > 0.
+ * @param align Must be a power of two or 0 (for no alignment).
+ * @param ref   Output reference to the allocated memory, cannot be NULL.
+ * @return Mapped pointer to the memory, NULL on failure.
+ *
+ * Thread-safe with respect to the frame!
+ * The memory can be used as vertex, index, uniform, storage or indirect
+ * buffer by the frame and is recycled the next time this frame is acquired.
+ * Memory grown beyond what recent frames used is eventually released.
+ * Host visible device local memory is only preferred if its heap is large.
+ * Dynamic uniform/storage offsets should respect the alignment limits of
+ * the device, combine with gfx_tech_dynamic to avoid updating sets.
+ */
+GFX_API void* gfx_frame_alloc(GFXFrame* frame,
+                              uint64_t size, uint64_t align, GFXBufferRef* ref);
+
+/**
+ * Reads back an image attachment after the acquired virtual frame is rendered.
+ * Can only be called inbetween gfx_renderer_acquire and gfx_frame_submit!
+ * @param frame Cannot be NULL.
+ * @param index Index of the image attachment to read.
+ * @param dst   Host memory to write to, must remain valid (see below).
+ * @param deps  Cannot be NULL if numDeps > 0.
+ * @return Zero on failure.
+ *
+ * The first mipmap (all layers, tightly packed) is read asynchronously with
+ * gfx_read_async, issued when the frame is submitted, with deps. To read
+ * what the frame rendered, deps must wait on a signal command injected in a
+ * pass of the frame. To not overwrite the attachment before its read,
+ * deps can signal whatever pass writes to it next.
+ *
+ * The attachment must be allocated with GFX_MEMORY_READ.
+ * dst is written by the time this frame is acquired again, so the virtual
+ * frames form a readback ring of #frames images that does not stall, the
+ * device is done reading by then unless it is behind by #frames submissions.
+ * Failure to read is logged and leaves dst untouched.
+ */
+GFX_API bool gfx_frame_read(GFXFrame* frame, size_t index, void* dst,
+                            size_t numDeps, const GFXInject* deps);
+
 /**
  * Submits the acquired virtual frame of a renderer.
  * Can only be called once after gfx_frame_acquire.
@@ -780,6 +1148,9 @@ typedef union GFXClear
  * asynchronous execution.
  *
  * All asynchronous passes are after all others in submission order.
+ *
+ * Inline compute passes can be made promotable to the asynchronous compute
+ * queue, @see gfx_pass_set_promotable.
  */
 GFX_API GFXPass* gfx_renderer_add_pass(GFXRenderer* renderer, GFXPassType type,
                                        size_t numParents, GFXPass** parents);
@@ -884,6 +1255,73 @@ GFX_API void gfx_pass_set_state(GFXPass* pass, GFXRenderState state);
  */
 GFX_API GFXRenderState gfx_pass_get_state(GFXPass* pass);
 
+/**
+ * Enables or disables a pass, disabled passes are not recorded or submitted.
+ * @param pass Cannot be NULL.
+ *
+ * Any pass that only contributes to disabled passes is culled as well,
+ * i.e. when all its children are culled and it writes to no window.
+ * This does not invalidate the renderer's graph, only the passes
+ * affected by the change are rebuilt.
+ * Injected dependencies of culled passes are still processed.
+ * CANNOT be called during or inbetween gfx_frame_start and gfx_frame_submit.
+ */
+GFX_API void gfx_pass_set_enabled(GFXPass* pass, bool enabled);
+
+/**
+ * Retrieves whether a pass is enabled, passes are enabled by default.
+ * @param pass Cannot be NULL.
+ */
+GFX_API bool gfx_pass_is_enabled(GFXPass* pass);
+
+/**
+ * Retrieves whether a pass is culled, i.e. not recorded or submitted.
+ * @param pass Cannot be NULL.
+ *
+ * Only up to date after a call to gfx_frame_start.
+ */
+GFX_API bool gfx_pass_is_culled(GFXPass* pass);
+
+/**
+ * Allows an inline compute pass to be scheduled on the compute queue.
+ * @param pass    Cannot be NULL.
+ * @param promote Non-zero to allow, passes are not promotable by default.
+ *
+ * No-op if not an inline compute pass.
+ * Only passes without parents, children or consumed attachments are
+ * actually moved, as they have no data dependency on any render pass.
+ * They are then executed on the queue family of asynchronous compute passes
+ * (if it is a different queue), dependencies injected into a promotable
+ * pass should therefore be as for asynchronous passes.
+ * CANNOT be called during or inbetween gfx_frame_start and gfx_frame_submit.
+ */
+GFX_API void gfx_pass_set_promotable(GFXPass* pass, bool promote);
+
+/**
+ * Retrieves whether an inline compute pass is promotable.
+ * @param pass Cannot be NULL.
+ */
+GFX_API bool gfx_pass_is_promotable(GFXPass* pass);
+
+/**
+ * Restricts a pass to some physical devices of the renderer's device group.
+ * @param pass    Cannot be NULL.
+ * @param devices Device mask (bit i for device i), 0 for all (the default).
+ *
+ * Only the recorded commands of the pass are executed by the devices of
+ * the mask that render the frame, if none do, by all devices of the frame.
+ * Each device writes to its own instance of the attachments (and device
+ * memory), other devices never see the result.
+ * CANNOT be called during or inbetween gfx_frame_start and gfx_frame_submit.
+ */
+GFX_API void gfx_pass_set_devices(GFXPass* pass, uint32_t devices);
+
+/**
+ * Retrieves the device mask of a pass, 0 for all devices.
+ * @param pass Cannot be NULL.
+ */
+GFX_API uint32_t gfx_pass_get_devices(GFXPass* pass);
+
 /**
  * Retrieves the number of sink passes of a renderer.
  * A sink pass is one that is not a parent of any pass (last in the path).
@@ -991,6 +1429,39 @@ GFX_API bool gfx_tech_constant(GFXTechnique* technique,
                                uint32_t id, GFXShaderStage stage,
                                size_t size, GFXConstant value);
 
+/**
+ * Declares a variant dimension of the technique, a specialization constant
+ * that takes each of the given values in a different variant.
+ * @param technique Cannot be NULL.
+ * @param id        ID of the specialization constant in SPIR-V.
+ * @param stage     Shader stages to set the specialization constant of.
+ * @param size      Must be sizeof(value.(i32|u32|f)) of the correct data-type.
+ * @param numValues Must be > 0.
+ * @param values    Cannot be NULL, values[0] is used by variant 0.
+ * @return Zero on failure.
+ *
+ * Fails if the technique is already locked or if the technique would
+ * exceed 4096 variants. Declaring the same id and stage again replaces
+ * its values. The variant index is a mixed-radix number of value indices,
+ * the first declared dimension varying fastest. The constants of all
+ * variants are tabulated once on locking, so selecting a variant is a
+ * table index. Select it with gfx_renderable_variant and warmup the
+ * variants that are used, each is cached as a separate pipeline.
+ *
+ * Preprocessor permutations cannot be expressed as a variant, as they
+ * produce different SPIR-V; compile them as separate shaders (e.g. with
+ * gfx_shader_compile_batch) and add a technique for each.
+ */
+GFX_API bool gfx_tech_variant(GFXTechnique* technique,
+                              uint32_t id, GFXShaderStage stage, size_t size,
+                              size_t numValues, const GFXConstant* values);
+
+/**
+ * Retrieves the number of variants of a technique, 1 if none declared.
+ * @param technique Cannot be NULL.
+ */
+GFX_API size_t gfx_tech_get_num_variants(GFXTechnique* technique);
+
 /**
  * Sets immutable samplers of the technique.
  * @param technique   Cannot be NULL.
@@ -1027,6 +1498,44 @@ GFX_API bool gfx_tech_immutable(GFXTechnique* technique,
 GFX_API bool gfx_tech_dynamic(GFXTechnique* technique,
                               size_t set, size_t binding);
 
+/**
+ * Sets a sampled image or storage buffer binding of the technique to be
+ * bindless, making the entire set an update-after-bind set.
+ * @see gfx_tech_immutable.
+ * @param count Number of descriptors, 0 for the shader array size.
+ * @return Non-zero if the binding can be made bindless.
+ *
+ * Fails if descriptor indexing (Vulkan 1.2) is not supported by the device.
+ * count must be at least the shader array size, it must be > 0 if the
+ * shader array is unsized (i.e. a runtime array).
+ * Sets of a bindless set layout can only contain samplers, sampled images
+ * and non-dynamic storage buffers, this is validated on locking.
+ *
+ * Bindless sets own a single Vulkan descriptor set, all modifications
+ * are written to it in-place, so it only needs to be bound once per frame.
+ * Unset descriptors are left unbound, they cannot be accessed by shaders.
+ * In-place modifications cannot touch descriptors still in use by
+ * in-flight virtual frames!
+ */
+GFX_API bool gfx_tech_bindless(GFXTechnique* technique,
+                               size_t set, size_t binding, size_t count);
+
+/**
+ * Sets a descriptor set of the technique to be pushed (VK_KHR_push_descriptor).
+ * @param technique Cannot be NULL.
+ * @param set       Must be < gfx_tech_get_num_sets(technique).
+ * @return Non-zero if the set can be pushed.
+ *
+ * Fails if the technique is already locked or if push descriptors are not
+ * supported by the device. Meant for sets that change every draw:
+ * binding them records their descriptors directly into the command buffer,
+ * no descriptor sets are allocated or recycled.
+ * A pushed set cannot be bindless, cannot contain dynamic buffers and cannot
+ * exceed the device's push descriptor limit, this is validated on locking.
+ * Binding a pushed set within a deferred callback flushes all deferred draws.
+ */
+GFX_API bool gfx_tech_push(GFXTechnique* technique, size_t set);
+
 /**
  * Locks the technique, preparing it for rendering & making it immutable.
  * Creating sets from a technique automatically locks the technique.
@@ -1210,6 +1719,30 @@ GFX_API bool gfx_set_views(GFXSet* set,
 GFX_API bool gfx_set_samplers(GFXSet* set,
                               size_t numSamplers, const GFXSampler* samplers);
 
+/**
+ * Claims an unused descriptor index of a binding of the set.
+ * @param set     Cannot be NULL.
+ * @param binding Must be < gfx_set_get_num_bindings(set).
+ * @return The claimed index, SIZE_MAX if no indices are left.
+ *
+ * Indices are stable until released, meant to manage slots in large
+ * (i.e. bindless) arrays. Released indices are reused first.
+ * Fails for immutable or empty bindings.
+ */
+GFX_API size_t gfx_set_claim(GFXSet* set, size_t binding);
+
+/**
+ * Releases a claimed descriptor index of a binding of the set,
+ * clearing its resource (views are kept).
+ * @param set     Cannot be NULL.
+ * @param binding Must be < gfx_set_get_num_bindings(set).
+ * @param index   Must be an index claimed with gfx_set_claim.
+ *
+ * The index must not be released more than once and must not be used by
+ * any in-flight virtual frame anymore.
+ */
+GFX_API void gfx_set_release(GFXSet* set, size_t binding, size_t index);
+
 
 /****************************
  * Recorder & recording commands.
@@ -1254,6 +1787,50 @@ typedef struct GFXDispatchCmd
 } GFXDispatchCmd;
 
 
+/**
+ * Recorder query type.
+ */
+typedef enum GFXQueryType
+{
+	GFX_QUERY_OCCLUSION,
+	GFX_QUERY_PIPELINE_STATISTICS
+
+} GFXQueryType;
+
+
+/**
+ * Recorder query result.
+ * Only the fields relevant to the query type are written.
+ */
+typedef struct GFXQueryResult
+{
+	bool available;
+
+	uint64_t samples; // Occlusion, number of samples passed.
+
+	// Pipeline statistics.
+	uint64_t vertices;
+	uint64_t primitives;
+	uint64_t vertexInvocations;
+	uint64_t fragmentInvocations;
+	uint64_t computeInvocations;
+
+} GFXQueryResult;
+
+
+/**
+ * Recorder statistics, number of redundant commands not recorded.
+ */
+typedef struct GFXRecorderStats
+{
+	uint64_t pipelines;  // Pipeline binds.
+	uint64_t primitives; // Vertex & index buffer binds.
+	uint64_t sets;       // Descriptor set binds (per set).
+	uint64_t pushes;     // Push constant updates.
+
+} GFXRecorderStats;
+
+
 /**
  * Adds a new recorder to the renderer.
  * @param renderer Cannot be NULL.
@@ -1274,6 +1851,71 @@ GFX_API GFXRecorder* gfx_renderer_add_recorder(GFXRenderer* renderer);
  */
 GFX_API void gfx_erase_recorder(GFXRecorder* recorder);
 
+/**
+ * Sets whether a recorder defers & sorts the draws of its render commands.
+ * @param recorder Cannot be NULL.
+ * @param deferred Non-zero to enable deferred recording.
+ *
+ * Cannot be called within a callback of gfx_recorder_(render|compute).
+ *
+ * When deferred, all draw commands within a single callback of
+ * gfx_recorder_render are sorted on { pipeline, sets, primitive, depth }
+ * before being recorded, minimizing state switches. Bound sets and push
+ * constants are captured per draw, so the result is as if the draws were
+ * issued in sorted order to begin with.
+ *
+ * Sets are only remembered across binds of the same pipeline layout.
+ * Query commands and binds that exceed what can be remembered
+ * (many sets, dynamic offsets or push constant bytes) record all
+ * deferred draws before them, sorting only happens inbetween.
+ */
+GFX_API void gfx_recorder_set_deferred(GFXRecorder* recorder, bool deferred);
+
+/**
+ * Retrieves whether a recorder defers & sorts its draws.
+ * @param recorder Cannot be NULL.
+ */
+GFX_API bool gfx_recorder_is_deferred(GFXRecorder* recorder);
+
+/**
+ * Sets whether a recorder retains its recordings across frames.
+ * @param recorder Cannot be NULL.
+ * @param retained Non-zero to enable retained recording.
+ *
+ * Cannot be called within a callback of gfx_recorder_(render|compute).
+ *
+ * When retained, each call to gfx_recorder_(render|compute) is matched
+ * against the recording of the same { pass, cb, ptr } of the previous
+ * use of the same virtual frame. If still valid, that recording is
+ * re-executed and the callback is NOT called.
+ *
+ * A recording is invalidated by gfx_recorder_invalidate, by a rebuild or
+ * resize of its pass, by modifying any of its bound sets or when it was not
+ * re-executed in the previous use of the virtual frame. Recordings with
+ * queries or batch draw commands are never re-executed.
+ *
+ * The callback should only depend on the virtual frame index, any other
+ * change must be signaled: gfx_recorder_invalidate MUST be called when
+ * modifying or erasing any other recorded object (e.g. sets, buffers,
+ * renderables or computables) that a recording depends on.
+ * Memory allocated with gfx_frame_alloc must not be referenced.
+ */
+GFX_API void gfx_recorder_set_retained(GFXRecorder* recorder, bool retained);
+
+/**
+ * Retrieves whether a recorder retains its recordings.
+ * @param recorder Cannot be NULL.
+ */
+GFX_API bool gfx_recorder_is_retained(GFXRecorder* recorder);
+
+/**
+ * Invalidates all retained recordings of a recorder.
+ * @param recorder Cannot be NULL.
+ *
+ * Cannot be called within a callback of gfx_recorder_(render|compute).
+ */
+GFX_API void gfx_recorder_invalidate(GFXRecorder* recorder);
+
 /**
  * Records render commands within a given render pass.
  * The callback takes this recorder and the current virtual frame index.
@@ -1285,11 +1927,43 @@ GFX_API void gfx_erase_recorder(GFXRecorder* recorder);
  * Must be called inbetween gfx_frame_start and gfx_frame_submit!
  * Different recorders can always call gfx_recorder_(render|compute)
  * concurrently, with any arguments!
+ *
+ * No-op if the pass is culled, cb will not be called.
  */
 GFX_API void gfx_recorder_render(GFXRecorder* recorder, GFXPass* pass,
                                  void (*cb)(GFXRecorder*, unsigned int, void*),
                                  void* ptr);
 
+/**
+ * Records render commands within a given render pass, in parallel.
+ * The callback takes a recorder, the current virtual frame index and
+ * a range of items { first, num } to record, then the user pointer.
+ * @param recorder Cannot be NULL.
+ * @param pass     Cannot be NULL, must be a render pass.
+ * @param numItems Number of items to partition over all callbacks.
+ * @param cb       Callback, cannot be NULL.
+ * @param ptr      User pointer as fifth argument of cb.
+ * @see gfx_recorder_render.
+ *
+ * The items are partitioned over internal helper recorders owned by this
+ * recorder, each partition is recorded on a different thread (the calling
+ * thread included), so cb MUST be thread-safe. The partitions are executed
+ * in item order, as if recorded by this recorder in one callback. However,
+ * when deferred, draws are only sorted within each partition!
+ *
+ * The recorder passed to cb is only valid within that callback, its
+ * deferred mode is taken from this recorder, partitions are never retained
+ * and no queries may be begun. Statistics are accumulated in this recorder.
+ * Cannot be called within a callback of this recorder.
+ *
+ * No-op if the pass is culled or numItems is 0, cb will not be called.
+ */
+GFX_API void gfx_recorder_render_parallel(GFXRecorder* recorder, GFXPass* pass,
+                                          size_t numItems,
+                                          void (*cb)(GFXRecorder*, unsigned int,
+                                                     size_t, size_t, void*),
+                                          void* ptr);
+
 /**
  * Records compute commands within a given compute pass.
  * The callback takes this recorder and the current virtual frame index.
@@ -1314,6 +1988,34 @@ GFX_API void gfx_recorder_compute(GFXRecorder* recorder, GFXPass* pass,
 GFX_API void gfx_recorder_get_size(GFXRecorder* recorder,
                                    uint32_t* width, uint32_t* height, uint32_t* layers);
 
+/**
+ * Retrieves the number of redundant commands that were not recorded.
+ * @param recorder Cannot be NULL.
+ * @param stats    Cannot be NULL, output statistics.
+ *
+ * Counts accumulate over the lifetime of the recorder.
+ * Bound descriptor sets, dynamic offsets, push constants, pipelines and
+ * primitives are remembered for the duration of a single callback of
+ * gfx_recorder_(render|compute), identical commands are skipped.
+ */
+GFX_API void gfx_recorder_get_stats(GFXRecorder* recorder, GFXRecorderStats* stats);
+
+/**
+ * Retrieves the result of a query from the previous recording
+ * of this recorder with the same virtual frame index.
+ * @param recorder Cannot be NULL.
+ * @param query    Query as returned by gfx_cmd_query_begin.
+ * @param result   Cannot be NULL, output result.
+ * @return Zero if the result is not (yet) available.
+ *
+ * Query identifiers are opaque and only valid for the recorder
+ * and virtual frame index they were begun in, they are reused every frame.
+ * Results of a virtual frame are resolved when it is acquired again,
+ * so call this within a callback of gfx_recorder_(render|compute).
+ */
+GFX_API bool gfx_recorder_get_query(GFXRecorder* recorder, uint32_t query,
+                                    GFXQueryResult* result);
+
 /**
  * Retrieves the virtual frame size associated with a render pass.
  * @param pass   Cannot be NULL.
@@ -1377,6 +2079,18 @@ GFX_API void gfx_cmd_push(GFXRecorder* recorder, GFXTechnique* technique,
                           uint32_t offset,
                           uint32_t size, const void* data);
 
+/**
+ * Sets the depth sort key of all following draw commands.
+ * Can only be called within a callback of gfx_recorder_(render|compute)!
+ * @param recorder Cannot be NULL.
+ * @param depth    Lower depths are drawn first, defaults to zero.
+ *
+ * Only has effect when deferred, it is the least significant sort key,
+ * i.e. draws are ordered by depth if pipeline, sets and primitive are equal.
+ * @see gfx_recorder_set_deferred.
+ */
+GFX_API void gfx_cmd_sort(GFXRecorder* recorder, uint16_t depth);
+
 /**
  * Render command to record a non-indexed draw.
  * Can only be called within a callback of gfx_recorder_render!
@@ -1434,6 +2148,66 @@ GFX_API void gfx_cmd_draw_indexed_from(GFXRecorder* recorder, GFXRenderable* ren
                                        uint32_t count,
                                        uint32_t stride, GFXBufferRef ref);
 
+/**
+ * Render command to indirectly (from buffer) record non-indexed draws,
+ * with the number of draws read from a buffer as well.
+ * Can only be called within a callback of gfx_recorder_render!
+ * @param recorder   Cannot be NULL.
+ * @param renderable Cannot be NULL.
+ * @param maxCount   Maximum number of draws to execute, can be zero.
+ * @param stride     Must be a multiple of 4, zero for tight packing.
+ * @param ref        Cannot be GFX_REF_NULL.
+ * @param countRef   Cannot be GFX_REF_NULL, must be 4-byte aligned.
+ *
+ * The count buffer must contain a single uint32_t, the number of
+ * GFXDrawCmd structures (clamped to maxCount) to read from ref.
+ * Requires the drawIndirectCount device feature, maxCount > 1 requires
+ * the multiDrawIndirect device feature.
+ */
+GFX_API void gfx_cmd_draw_count_from(GFXRecorder* recorder, GFXRenderable* renderable,
+                                     uint32_t maxCount,
+                                     uint32_t stride, GFXBufferRef ref,
+                                     GFXBufferRef countRef);
+
+/**
+ * Render command to indirectly (from buffer) record indexed draws,
+ * with the number of draws read from a buffer as well.
+ * Can only be called within a callback of gfx_recorder_render!
+ * @see gfx_cmd_draw_count_from.
+ *
+ * The count buffer must contain a single uint32_t, the number of
+ * GFXDrawIndexedCmd structures (clamped to maxCount) to read from ref.
+ */
+GFX_API void gfx_cmd_draw_indexed_count_from(GFXRecorder* recorder, GFXRenderable* renderable,
+                                             uint32_t maxCount,
+                                             uint32_t stride, GFXBufferRef ref,
+                                             GFXBufferRef countRef);
+
+/**
+ * Render command to record many non-indexed draws of the same renderable.
+ * Can only be called within a callback of gfx_recorder_render!
+ * @param recorder   Cannot be NULL.
+ * @param renderable Cannot be NULL.
+ * @param numDraws   Number of draws, can be zero.
+ * @param draws      Array of numDraws GFXDrawCmd structures.
+ *
+ * The draws are packed into transient memory of the current virtual frame
+ * and recorded as a single indirect draw (within device limits).
+ * Useful to draw many sub-ranges of one (merged) primitive at once.
+ * Falls back to separate draws without the multiDrawIndirect device feature.
+ */
+GFX_API void gfx_cmd_draw_batch(GFXRecorder* recorder, GFXRenderable* renderable,
+                                size_t numDraws, const GFXDrawCmd* draws);
+
+/**
+ * Render command to record many indexed draws of the same renderable.
+ * Can only be called within a callback of gfx_recorder_render!
+ * @param draws Array of numDraws GFXDrawIndexedCmd structures.
+ * @see gfx_cmd_draw_batch.
+ */
+GFX_API void gfx_cmd_draw_indexed_batch(GFXRecorder* recorder, GFXRenderable* renderable,
+                                        size_t numDraws, const GFXDrawIndexedCmd* draws);
+
 /**
  * Compute command to record a compute dispatch.
  * Can only be called within a callback of gfx_recorder_compute!
@@ -1467,5 +2241,29 @@ GFX_API void gfx_cmd_dispatch_base(GFXRecorder* recorder, GFXComputable * comput
 GFX_API void gfx_cmd_dispatch_from(GFXRecorder* recorder, GFXComputable* computable,
                                    GFXBufferRef ref);
 
+/**
+ * Command to begin a query.
+ * Can only be called within a callback of gfx_recorder_(render|compute)!
+ * @param recorder Cannot be NULL.
+ * @param type     Type of the query to begin.
+ * @return Opaque query identifier, UINT32_MAX on failure.
+ *
+ * Only one query of each type can be active at a time,
+ * it must be ended within the same callback.
+ * Occlusion queries can only be used within gfx_recorder_render.
+ * Pipeline statistics require the pipelineStatistics device feature.
+ */
+GFX_API uint32_t gfx_cmd_query_begin(GFXRecorder* recorder, GFXQueryType type);
+
+/**
+ * Command to end a query.
+ * Can only be called within a callback of gfx_recorder_(render|compute)!
+ * @param recorder Cannot be NULL.
+ * @param query    Query as returned by gfx_cmd_query_begin.
+ *
+ * No-op if query is UINT32_MAX.
+ */
+GFX_API void gfx_cmd_query_end(GFXRecorder* recorder, uint32_t query);
+
 
 #endif
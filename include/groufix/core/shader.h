@@ -86,6 +86,61 @@ GFX_API bool gfx_shader_compile(GFXShader* shader, GFXShaderLanguage language,
                                 const GFXReader* src, const GFXIncluder* inc,
                                 const GFXWriter* out, const GFXWriter* err);
 
+/**
+ * Compiles a shader through an on-disk shader cache.
+ * @see gfx_shader_compile.
+ * @param cache Path to an existing directory, NULL to not use a cache.
+ *
+ * The cache is content-addressed, keyed on the source, stage, language,
+ * optimization flag, compiler version and target device. All resolved
+ * include contents are stored as well and are compared on lookup.
+ * A hit loads SPIR-V bytecode and reflection metadata from disk,
+ * without invoking the compiler. A miss compiles & stores the result.
+ * Failure to store a cache entry is not an error, only a warning.
+ */
+GFX_API bool gfx_shader_compile_cached(GFXShader* shader,
+                                       GFXShaderLanguage language,
+                                       bool optimize,
+                                       const GFXReader* src,
+                                       const GFXIncluder* inc,
+                                       const char* cache,
+                                       const GFXWriter* out,
+                                       const GFXWriter* err);
+
+/**
+ * Shader compilation entry of a batch.
+ */
+typedef struct GFXShaderCompile
+{
+	GFXShader*         shader;
+	GFXShaderLanguage  language;
+	const GFXReader*   src;
+	const GFXIncluder* inc; // May be NULL.
+	const GFXWriter*   out; // May be NULL.
+	const GFXWriter*   err; // May be NULL.
+
+	// Output, non-zero if this entry compiled successfully.
+	bool success;
+
+} GFXShaderCompile;
+
+
+/**
+ * Compiles multiple shaders in parallel, spread over a pool of threads.
+ * @see gfx_shader_compile_cached.
+ * @param shaders Cannot be NULL if numShaders > 0.
+ * @return Non-zero if all shaders compiled successfully.
+ *
+ * The calling thread participates, each thread initializes one compiler
+ * and reuses it for all shaders it compiles. The `success` field of each
+ * entry is set, so failures can be reported per shader.
+ * All shaders and source/output streams must be distinct objects,
+ * includers may be shared between entries but must then be thread-safe.
+ */
+GFX_API bool gfx_shader_compile_batch(size_t numShaders,
+                                      GFXShaderCompile* shaders,
+                                      bool optimize, const char* cache);
+
 /**
  * Loads SPIR-V bytecode for use.
  * @param shader Cannot be NULL.
@@ -94,5 +149,28 @@ GFX_API bool gfx_shader_compile(GFXShader* shader, GFXShaderLanguage language,
  */
 GFX_API bool gfx_shader_load(GFXShader* shader, const GFXReader* src);
 
+/**
+ * Loads SPIR-V bytecode for use, with precomputed reflection metadata.
+ * @see gfx_shader_load.
+ * @param reflect Reflection metadata stream, NULL to reflect the bytecode.
+ *
+ * The metadata must be written by gfx_shader_store_reflection for the
+ * exact same bytecode, it is validated against the bytecode's size & hash.
+ * If it does not match, a warning is logged and the bytecode is reflected.
+ * Otherwise no SPIR-V reflection is performed at all.
+ */
+GFX_API bool gfx_shader_load_reflected(GFXShader* shader,
+                                       const GFXReader* src,
+                                       const GFXReader* reflect);
+
+/**
+ * Stores the reflection metadata of a shader as a compact binary blob,
+ * to be loaded alongside its SPIR-V bytecode by gfx_shader_load_reflected.
+ * @param shader Cannot be NULL.
+ * @param dst    Destination stream, cannot be NULL.
+ * @return Zero on failure or if the shader stores no SPIR-V bytecode.
+ */
+GFX_API bool gfx_shader_store_reflection(GFXShader* shader, const GFXWriter* dst);
+
 
 #endif
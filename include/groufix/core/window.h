@@ -29,7 +29,8 @@ typedef enum GFXWindowFlags
 	GFX_WINDOW_CAPTURE_MOUSE = 0x0020, // Implies GFX_WINDOW_HIDE_MOUSE.
 	GFX_WINDOW_HIDE_MOUSE    = 0x0040,
 	GFX_WINDOW_DOUBLE_BUFFER = 0x0080,
-	GFX_WINDOW_TRIPLE_BUFFER = 0x0100  // Overrules GFX_WINDOW_DOUBLE_BUFFER.
+	GFX_WINDOW_TRIPLE_BUFFER = 0x0100, // Overrules GFX_WINDOW_DOUBLE_BUFFER.
+	GFX_WINDOW_RELAXED       = 0x0200  // Late frames tear when double buffered.
 
 } GFXWindowFlags;
 
@@ -20,6 +20,22 @@ static void _gfx_glfw_error(int error, const char* description)
 	gfx_log_error("GLFW: %s", description);
 }
 
+/****************************/
+GFX_API void gfx_set_workers(unsigned int workers)
+{
+	// Only a pre-gfx_init() setting.
+	if (!atomic_load(&_groufix.initialized))
+		_groufix.workersDef = workers;
+}
+
+/****************************/
+GFX_API void gfx_set_headless(bool headless)
+{
+	// Only a pre-gfx_init() setting.
+	if (!atomic_load(&_groufix.initialized))
+		_groufix.headlessDef = headless;
+}
+
 /****************************/
 GFX_API bool gfx_init(void)
 {
@@ -47,6 +63,16 @@ GFX_API bool gfx_init(void)
 	gfx_log_set(GFX_IO_STDERR);
 	glfwSetErrorCallback(_gfx_glfw_error);
 
+	// When headless, don't even try to connect to a display.
+	if (_groufix.headlessDef)
+	{
+#if defined (GLFW_PLATFORM_NULL)
+		glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#else
+		gfx_log_warn("GLFW has no null platform, headless needs a display.");
+#endif
+	}
+
 	if (!glfwInit())
 		goto terminate;
 
@@ -65,6 +91,9 @@ GFX_API bool gfx_init(void)
 	if (!_gfx_monitors_init())
 		goto terminate;
 
+	if (!_gfx_jobs_init())
+		goto terminate;
+
 	gfx_log_info("All internal state initialized succesfully, ready.");
 
 	// If not in debug mode, disable logging to stderr again.
@@ -91,6 +120,8 @@ GFX_API void gfx_terminate(void)
 		return;
 
 	// Terminate the contents of the engine.
+	// Stop the job system first, so no jobs run during termination.
+	_gfx_jobs_terminate();
 	_gfx_monitors_terminate();
 	_gfx_devices_terminate();
 	_gfx_vulkan_terminate();
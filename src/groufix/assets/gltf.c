@@ -11,6 +11,8 @@
 #include "groufix/core/log.h"
 #include <assert.h>
 #include <ctype.h>
+#include <limits.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -18,6 +20,10 @@
 #include "cgltf.h"
 
 
+// Post-transform vertex cache size assumed when reordering triangles.
+#define _GFX_GLTF_CACHE_SIZE 16
+
+
 #define _GFX_GLTF_ERROR_STRING(result) \
 	((result) == cgltf_result_success ? \
 		"success" : \
@@ -310,10 +316,12 @@ static void* _gfx_gltf_decode_base64(size_t size, const char* src)
 
 /****************************
  * Allocates a new buffer and fills it with given data.
- * @param size Must be > 0.
+ * @param flags Memory flags to allocate with, must include GFX_MEMORY_WRITE.
+ * @param size  Must be > 0.
  * @return NULL on failure.
  */
 static GFXBuffer* _gfx_gltf_alloc_buffer(GFXHeap* heap, GFXDependency* dep,
+                                         GFXMemoryFlags flags,
                                          size_t size, const void* bin)
 {
 	assert(heap != NULL);
@@ -323,7 +331,7 @@ static GFXBuffer* _gfx_gltf_alloc_buffer(GFXHeap* heap, GFXDependency* dep,
 
 	// Allocate.
 	GFXBuffer* buffer = gfx_alloc_buffer(heap,
-		GFX_MEMORY_WRITE,
+		flags,
 		GFX_BUFFER_VERTEX | GFX_BUFFER_INDEX,
 		size);
 
@@ -354,10 +362,13 @@ static GFXBuffer* _gfx_gltf_alloc_buffer(GFXHeap* heap, GFXDependency* dep,
  * Resolves and reads a buffer URI.
  * @param inc  Includer to use, may be NULL.
  * @param uri  Data URI to resolve, cannot be NULL, must be NULL-terminated.
+ * @param host Output host copy of the data (must call free()), may be NULL.
  * @return NULL on failure.
+ * @see _gfx_gltf_alloc_buffer.
  */
 static GFXBuffer* _gfx_gltf_include_buffer(const GFXIncluder* inc, const char* uri,
-                                           GFXHeap* heap, GFXDependency* dep)
+                                           GFXHeap* heap, GFXDependency* dep,
+                                           GFXMemoryFlags flags, void** host)
 {
 	assert(uri != NULL);
 	assert(heap != NULL);
@@ -398,88 +409,842 @@ static GFXBuffer* _gfx_gltf_include_buffer(const GFXIncluder* inc, const char* u
 		return NULL;
 	}
 
-	void* bin = malloc((size_t)len);
-	if (bin == NULL)
+	// If the stream exposes its data (e.g. memory-mapped),
+	// upload straight from it, without an intermediate copy.
+	const void* data = gfx_io_data(src);
+	void* bin = NULL;
+
+	if (data == NULL)
 	{
-		gfx_log_error(
-			"Could not allocate buffer to load URI: %s.", uri);
+		bin = malloc((size_t)len);
+		if (bin == NULL)
+		{
+			gfx_log_error(
+				"Could not allocate buffer to load URI: %s.", uri);
 
-		gfx_io_release(inc, src);
-		return NULL;
+			gfx_io_release(inc, src);
+			return NULL;
+		}
+
+		// Read source.
+		len = gfx_io_read(src, bin, (size_t)len);
+		if (len <= 0)
+		{
+			gfx_log_error(
+				"Could not read data from stream to load URI: %s.", uri);
+
+			gfx_io_release(inc, src);
+			free(bin);
+			return NULL;
+		}
+
+		data = bin;
 	}
 
-	// Read source.
-	len = gfx_io_read(src, bin, (size_t)len);
-	if (len <= 0)
+	// Keep a host copy if asked, claim the read buffer if we have one.
+	void* copy = NULL;
+	if (host != NULL)
 	{
-		gfx_log_error(
-			"Could not read data from stream to load URI: %s.", uri);
+		copy = (bin != NULL) ? bin : malloc((size_t)len);
+		if (copy == NULL)
+		{
+			gfx_log_error(
+				"Could not allocate host copy to load URI: %s.", uri);
 
-		gfx_io_release(inc, src);
-		free(bin);
-		return NULL;
-	}
+			gfx_io_release(inc, src);
+			return NULL;
+		}
 
-	// Release the stream & allocate buffer.
-	gfx_io_release(inc, src);
+		if (copy != bin) memcpy(copy, data, (size_t)len);
+		bin = NULL;
+	}
 
-	GFXBuffer* buffer = _gfx_gltf_alloc_buffer(heap, dep, (size_t)len, bin);
+	// Allocate buffer, then release the stream.
+	GFXBuffer* buffer = _gfx_gltf_alloc_buffer(
+		heap, dep, flags, (size_t)len, data);
 	if (buffer == NULL)
-		gfx_log_error("Failed to load buffer URI: %s", uri);
+		gfx_log_error("Failed to load buffer URI: %s", uri),
+		free(copy),
+		copy = NULL;
 
-	// Free memory & output.
+	// Release & free memory & output.
+	gfx_io_release(inc, src);
 	free(bin);
 
+	if (host != NULL) *host = copy;
+
 	return buffer;
 }
 
 /****************************
- * Resolves and reads an image URI.
- * @param inc Includer to use, may be NULL.
- * @param uri Data URI to resolve, cannot be NULL, must be NULL-terminated.
+ * Resolves all image URIs and loads them, decoding them in parallel.
+ * @param inc    Includer to use, may be NULL.
+ * @param images Output vector, receives data->images_count images.
+ * @return Zero on failure, no images are output.
+ *
+ * Images without URI are output as NULL.
+ */
+static bool _gfx_gltf_include_images(const GFXIncluder* inc, cgltf_data* data,
+                                     GFXHeap* heap, GFXDependency* dep,
+                                     GFXImageFlags flags, GFXImageUsage usage,
+                                     GFXVec* images)
+{
+	assert(data != NULL);
+	assert(heap != NULL);
+	assert(dep != NULL);
+	assert(images != NULL);
+
+	const size_t numImages = data->images_count;
+	if (numImages == 0) return 1;
+
+	// Allocate source stream & output memory.
+	const GFXReader** srcs = malloc(sizeof(const GFXReader*) * numImages);
+	GFXImage** imgs = malloc(sizeof(GFXImage*) * numImages);
+
+	if (srcs == NULL || imgs == NULL)
+	{
+		gfx_log_error("Could not allocate memory to load images.");
+		goto clean;
+	}
+
+	// Resolve all URIs first.
+	size_t resolved;
+	for (resolved = 0; resolved < numImages; ++resolved)
+	{
+		const char* uri = data->images[resolved].uri;
+		srcs[resolved] = NULL;
+
+		// Check if data URI.
+		if (uri != NULL && strncmp(uri, "data:", 5) == 0)
+		{
+			gfx_log_error("Data URIs are not allowed for images.");
+			goto release;
+		}
+
+		// Check if actual URI.
+		else if (uri != NULL)
+		{
+			// Cannot do anything without an includer.
+			if (inc == NULL)
+			{
+				gfx_log_error("Cannot load image URIs without an includer.");
+				goto release;
+			}
+
+			// Resolve the URI.
+			char* dec = _gfx_gltf_decode_uri(uri);
+			if (dec == NULL)
+			{
+				gfx_log_error("Could not decode image URI: %s.", uri);
+				goto release;
+			}
+
+			srcs[resolved] = gfx_io_resolve(inc, dec);
+			free(dec); // Immediately free.
+
+			if (srcs[resolved] == NULL)
+			{
+				gfx_log_error("Could not resolve image URI: %s.", uri);
+				goto release;
+			}
+		}
+	}
+
+	// Load them all, decoding in parallel.
+	if (!gfx_load_images(heap, dep, flags, usage, numImages, srcs, imgs))
+		goto release;
+
+	// Release the streams & output.
+	for (size_t i = 0; i < numImages; ++i)
+		if (srcs[i] != NULL) gfx_io_release(inc, srcs[i]);
+
+	if (!gfx_vec_push(images, numImages, imgs))
+	{
+		gfx_heap_flush(heap);
+		gfx_heap_block(heap);
+
+		for (size_t i = 0; i < numImages; ++i)
+			gfx_free_image(imgs[i]);
+
+		goto clean;
+	}
+
+	free(srcs);
+	free(imgs);
+
+	return 1;
+
+
+	// Cleanup on failure.
+release:
+	for (size_t i = 0; i < resolved; ++i)
+		if (srcs[i] != NULL) gfx_io_release(inc, srcs[i]);
+clean:
+	free(srcs);
+	free(imgs);
+
+	return 0;
+}
+
+/****************************
+ * Converts a float to a half float, rounding to nearest.
+ */
+static uint16_t _gfx_gltf_half(float f)
+{
+	uint32_t x;
+	memcpy(&x, &f, sizeof(x));
+
+	const uint32_t sign = (x >> 16) & 0x8000;
+	const int32_t exp = (int32_t)((x >> 23) & 0xff) - 127 + 15;
+	uint32_t mant = x & 0x7fffff;
+
+	// Too small, becomes a subnormal or zero.
+	if (exp <= 0)
+	{
+		if (exp < -10) return (uint16_t)sign;
+
+		const uint32_t shift = (uint32_t)(14 - exp);
+		mant |= 0x800000;
+
+		return (uint16_t)(sign | ((mant + (1u << (shift - 1))) >> shift));
+	}
+
+	// Too large, becomes infinity.
+	if (exp >= 31)
+		return (uint16_t)(sign | 0x7c00);
+
+	// Rounding may carry into the exponent, which is still correct.
+	return (uint16_t)(
+		(sign | ((uint32_t)exp << 10) | (mant >> 13)) + ((mant >> 12) & 1));
+}
+
+/****************************
+ * Encodes a float in [-1,1] as an n-bit snorm integer.
+ */
+static int32_t _gfx_gltf_snorm(float f, int32_t max)
+{
+	f = f < -1.0f ? -1.0f : f > 1.0f ? 1.0f : f;
+	return (int32_t)(f * (float)max + (f < 0.0f ? -0.5f : 0.5f));
+}
+
+/****************************
+ * Quantization of a vertex attribute.
+ */
+typedef enum _GFXGltfQuant
+{
+	_GFX_GLTF_QUANT_NONE,
+	_GFX_GLTF_QUANT_PACKED, // A2B10G10R10 snorm.
+	_GFX_GLTF_QUANT_SNORM16,
+	_GFX_GLTF_QUANT_UNORM16,
+	_GFX_GLTF_QUANT_HALF
+
+} _GFXGltfQuant;
+
+
+/****************************
+ * Cluster of triangles with its overdraw sort key.
+ */
+typedef struct _GFXGltfCluster
+{
+	float  key;
+	size_t start; // In triangles.
+	size_t end;
+
+} _GFXGltfCluster;
+
+
+/****************************
+ * Sorts clusters by descending key, for qsort.
+ */
+static int _gfx_gltf_cmp_clusters(const void* l, const void* r)
+{
+	const float kl = ((const _GFXGltfCluster*)l)->key;
+	const float kr = ((const _GFXGltfCluster*)r)->key;
+
+	return (kl < kr) - (kl > kr);
+}
+
+/****************************
+ * Reorders triangles for the post-transform vertex cache (Tipsify),
+ * optionally followed by sorting clusters of triangles to reduce overdraw.
+ * @param indices   numIndices triangle list indices, reordered in-place.
+ * @param positions numVertices * 3 floats, NULL to not reduce overdraw.
+ * @return Zero on failure, indices are untouched.
+ *
+ * All indices must be < numVertices.
+ */
+static bool _gfx_gltf_optimize_cache(size_t numIndices, uint32_t* indices,
+                                     size_t numVertices, const float* positions)
+{
+	assert(indices != NULL);
+
+	const size_t numTris = numIndices / 3;
+	if (numTris < 2) return 1;
+
+	// Allocate all scratch memory.
+	size_t* offsets   = calloc(numVertices + 1, sizeof(size_t));
+	size_t* times     = calloc(numVertices, sizeof(size_t));
+	uint32_t* live    = malloc(sizeof(uint32_t) * numVertices);
+	uint32_t* adj     = malloc(sizeof(uint32_t) * numTris * 3);
+	uint32_t* dead    = malloc(sizeof(uint32_t) * numTris * 3);
+	uint32_t* cands   = malloc(sizeof(uint32_t) * numTris * 3);
+	uint32_t* out     = malloc(sizeof(uint32_t) * numTris * 3);
+	size_t* bounds    = malloc(sizeof(size_t) * (numTris + 1));
+	bool* emitted     = calloc(numTris, sizeof(bool));
+
+	bool success = 0;
+
+	if (
+		offsets == NULL || times == NULL || live == NULL ||
+		adj == NULL || dead == NULL || cands == NULL ||
+		out == NULL || bounds == NULL || emitted == NULL)
+	{
+		goto clean;
+	}
+
+	// Build vertex -> triangle adjacency,
+	// use times as insertion cursor, then reset it.
+	for (size_t i = 0; i < numTris * 3; ++i)
+		++offsets[indices[i] + 1];
+
+	for (size_t v = 0; v < numVertices; ++v)
+		live[v] = (uint32_t)offsets[v + 1],
+		offsets[v + 1] += offsets[v];
+
+	for (size_t i = 0; i < numTris * 3; ++i)
+		adj[offsets[indices[i]] + times[indices[i]]++] = (uint32_t)(i / 3);
+
+	for (size_t v = 0; v < numVertices; ++v)
+		times[v] = 0;
+
+	// Fan around vertices, emitting all their unemitted triangles, then
+	// pick the next fanning vertex from the candidates of this fan.
+	// When it has to fall back to the dead-end stack or the input order,
+	// start a new cluster (a hard boundary of the cache state).
+	size_t time = _GFX_GLTF_CACHE_SIZE + 1;
+	size_t cursor = 0;
+	size_t numOut = 0;
+	size_t numDead = 0;
+	size_t numClusters = 0;
+	size_t fan = indices[0];
+	bool hard = 1;
+
+	while (fan != SIZE_MAX)
+	{
+		if (hard) bounds[numClusters++] = numOut / 3;
+
+		size_t numCands = 0;
+
+		for (size_t a = offsets[fan]; a < offsets[fan + 1]; ++a)
+		{
+			const uint32_t t = adj[a];
+			if (emitted[t]) continue;
+
+			for (size_t c = 0; c < 3; ++c)
+			{
+				const uint32_t v = indices[t * 3 + c];
+
+				out[numOut++] = v;
+				dead[numDead++] = v;
+				cands[numCands++] = v;
+				--live[v];
+
+				if (time - times[v] > _GFX_GLTF_CACHE_SIZE)
+					times[v] = time++;
+			}
+
+			emitted[t] = 1;
+		}
+
+		// Pick the candidate that is still in the cache after fanning,
+		// the longest, i.e. with the highest priority.
+		size_t priority = 0;
+		fan = SIZE_MAX;
+
+		for (size_t c = 0; c < numCands; ++c)
+		{
+			const uint32_t v = cands[c];
+			if (live[v] == 0) continue;
+
+			size_t p = 0;
+			if (time - times[v] + 2 * (size_t)live[v] <= _GFX_GLTF_CACHE_SIZE)
+				p = time - times[v];
+
+			if (fan == SIZE_MAX || p > priority)
+				fan = v, priority = p;
+		}
+
+		hard = (fan == SIZE_MAX);
+
+		while (fan == SIZE_MAX && numDead > 0)
+			if (live[dead[--numDead]] > 0) fan = dead[numDead];
+
+		while (fan == SIZE_MAX && cursor < numVertices)
+			if (live[cursor++] > 0) fan = cursor - 1;
+	}
+
+	bounds[numClusters] = numTris;
+
+	// Without positions or clusters, we are done.
+	if (positions == NULL || numClusters < 2)
+	{
+		memcpy(indices, out, sizeof(uint32_t) * numTris * 3);
+		success = 1;
+		goto clean;
+	}
+
+	// Otherwise sort clusters so ones facing away from the mesh's center
+	// are drawn first, they are most likely to occlude other clusters.
+	_GFXGltfCluster* clusters = malloc(sizeof(_GFXGltfCluster) * numClusters);
+	if (clusters == NULL) goto clean;
+
+	float center[3] = { 0.0f, 0.0f, 0.0f };
+
+	for (size_t i = 0; i < numTris * 3; ++i)
+		center[0] += positions[out[i] * 3 + 0],
+		center[1] += positions[out[i] * 3 + 1],
+		center[2] += positions[out[i] * 3 + 2];
+
+	for (size_t k = 0; k < 3; ++k)
+		center[k] /= (float)(numTris * 3);
+
+	for (size_t c = 0; c < numClusters; ++c)
+	{
+		float centroid[3] = { 0.0f, 0.0f, 0.0f };
+		float normal[3] = { 0.0f, 0.0f, 0.0f };
+
+		for (size_t t = bounds[c]; t < bounds[c + 1]; ++t)
+		{
+			const float* p0 = positions + out[t * 3 + 0] * 3;
+			const float* p1 = positions + out[t * 3 + 1] * 3;
+			const float* p2 = positions + out[t * 3 + 2] * 3;
+
+			const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+
+			// Area weighted normal.
+			normal[0] += e1[1] * e2[2] - e1[2] * e2[1];
+			normal[1] += e1[2] * e2[0] - e1[0] * e2[2];
+			normal[2] += e1[0] * e2[1] - e1[1] * e2[0];
+
+			for (size_t k = 0; k < 3; ++k)
+				centroid[k] += p0[k] + p1[k] + p2[k];
+		}
+
+		const float n = (float)((bounds[c + 1] - bounds[c]) * 3);
+		const float len = sqrtf(
+			normal[0] * normal[0] +
+			normal[1] * normal[1] +
+			normal[2] * normal[2]);
+
+		clusters[c] = (_GFXGltfCluster){
+			.key = len <= 0.0f ? 0.0f :
+				((centroid[0] / n - center[0]) * normal[0] +
+				(centroid[1] / n - center[1]) * normal[1] +
+				(centroid[2] / n - center[2]) * normal[2]) / len,
+			.start = bounds[c],
+			.end = bounds[c + 1]
+		};
+	}
+
+	qsort(clusters, numClusters, sizeof(_GFXGltfCluster), _gfx_gltf_cmp_clusters);
+
+	for (size_t c = 0, i = 0; c < numClusters; ++c)
+	{
+		const size_t num = (clusters[c].end - clusters[c].start) * 3;
+		memcpy(indices + i, out + clusters[c].start * 3, sizeof(uint32_t) * num);
+		i += num;
+	}
+
+	free(clusters);
+	success = 1;
+
+
+	// Cleanup.
+clean:
+	free(offsets);
+	free(times);
+	free(live);
+	free(adj);
+	free(dead);
+	free(cands);
+	free(out);
+	free(bounds);
+	free(emitted);
+
+	return success;
+}
+
+/****************************
+ * Checks whether an accessor can be read on the host by the geometry
+ * processing of _gfx_gltf_process_prim.
+ */
+static bool _gfx_gltf_is_host_readable(const cgltf_accessor* accessor)
+{
+	return
+		accessor != NULL &&
+		!accessor->is_sparse &&
+		accessor->buffer_view != NULL &&
+		accessor->buffer_view->buffer->data != NULL;
+}
+
+/****************************
+ * Processes the geometry of a primitive on the host
+ * and allocates a primitive with its own buffers from it.
+ * @param memFlags    Memory flags to allocate with, must include GFX_MEMORY_WRITE.
+ * @param attribOrder numAttributes attribute indices, cannot be NULL.
+ * @param numVertices Must be > 0.
  * @return NULL on failure.
+ *
+ * All accessors used must be host readable (_gfx_gltf_is_host_readable).
  */
-static GFXImage* _gfx_gltf_include_image(const GFXIncluder* inc, const char* uri,
-                                         GFXHeap* heap, GFXDependency* dep,
-                                         GFXImageFlags flags, GFXImageUsage usage)
+static GFXPrimitive* _gfx_gltf_process_prim(GFXHeap* heap, GFXDependency* dep,
+                                            GFXGltfOptimizeFlags flags,
+                                            GFXMemoryFlags memFlags,
+                                            const cgltf_primitive* cprim,
+                                            size_t numAttributes,
+                                            const size_t* attribOrder,
+                                            size_t numVertices)
 {
-	assert(uri != NULL);
 	assert(heap != NULL);
 	assert(dep != NULL);
+	assert(cprim != NULL);
+	assert(attribOrder != NULL);
+	assert(numVertices > 0);
 
-	// Cannot do anything without an includer.
-	if (inc == NULL)
+	const size_t numIndices =
+		cprim->indices != NULL ? cprim->indices->count : 0;
+
+	GFXPrimitive* prim = NULL;
+	uint32_t* indices = NULL;
+	uint32_t* remap = NULL;
+	float* positions = NULL;
+	unsigned char* vertices = NULL;
+
+	// Read all indices.
+	if (numIndices > 0)
 	{
-		gfx_log_error("Cannot load image URIs without an includer.");
-		return NULL;
+		indices = malloc(sizeof(uint32_t) * numIndices);
+		if (indices == NULL) goto clean;
+
+		for (size_t i = 0; i < numIndices; ++i)
+		{
+			const cgltf_size index =
+				cgltf_accessor_read_index(cprim->indices, i);
+
+			if (index >= numVertices)
+			{
+				gfx_log_error("Primitive index out of bounds.");
+				goto clean;
+			}
+
+			indices[i] = (uint32_t)index;
+		}
 	}
 
-	// Resolve the URI.
-	char* dec = _gfx_gltf_decode_uri(uri);
-	if (dec == NULL)
+	// Reorder triangles, reading positions if reducing overdraw.
+	if (
+		(flags & GFX_GLTF_OPTIMIZE_VERTEX_CACHE) &&
+		cprim->type == cgltf_primitive_type_triangles && numIndices >= 3)
 	{
-		gfx_log_error("Could not decode image URI: %s.", uri);
-		return NULL;
+		const cgltf_accessor* pos = NULL;
+		for (size_t a = 0; a < cprim->attributes_count; ++a)
+			if (cprim->attributes[a].type == cgltf_attribute_type_position)
+				pos = cprim->attributes[a].data;
+
+		if (
+			(flags & GFX_GLTF_OPTIMIZE_OVERDRAW) == GFX_GLTF_OPTIMIZE_OVERDRAW &&
+			pos != NULL && pos->count >= numVertices &&
+			cgltf_num_components(pos->type) == 3 &&
+			_gfx_gltf_is_host_readable(pos))
+		{
+			positions = malloc(sizeof(float) * 3 * numVertices);
+			if (positions == NULL) goto clean;
+
+			for (size_t v = 0; v < numVertices; ++v)
+				cgltf_accessor_read_float(pos, v, positions + v * 3, 3);
+		}
+
+		if (!_gfx_gltf_optimize_cache(
+			numIndices, indices, numVertices, positions))
+		{
+			goto clean;
+		}
 	}
 
-	const GFXReader* src = gfx_io_resolve(inc, dec);
-	free(dec); // Immediately free.
+	// Remap vertices in order of first use or keep them as is.
+	remap = malloc(sizeof(uint32_t) * numVertices);
+	if (remap == NULL) goto clean;
 
-	if (src == NULL)
+	size_t numOutput = numVertices;
+
+	if ((flags & GFX_GLTF_OPTIMIZE_VERTEX_FETCH) && numIndices > 0)
 	{
-		gfx_log_error("Could not resolve image URI: %s.", uri);
-		return NULL;
+		numOutput = 0;
+		for (size_t v = 0; v < numVertices; ++v)
+			remap[v] = UINT32_MAX;
+
+		for (size_t i = 0; i < numIndices; ++i)
+		{
+			if (remap[indices[i]] == UINT32_MAX)
+				remap[indices[i]] = (uint32_t)(numOutput++);
+
+			indices[i] = remap[indices[i]];
+		}
 	}
+	else
+		for (size_t v = 0; v < numVertices; ++v)
+			remap[v] = (uint32_t)v;
 
-	// Simply load the image.
-	GFXImage* image = gfx_load_image(heap, dep, flags, usage, src);
-	if (image == NULL)
-		gfx_log_error("Failed to load image URI: %s", uri);
+	// Compute the interleaved vertex layout, quantizing if possible.
+	// Scoped, so we can jump to cleanup from before.
+	{
+		// Each attribute is aligned to 4 bytes.
+		GFXDevice* device = gfx_heap_get_device(heap);
+		GFXAttribute attributes[numAttributes];
+		_GFXGltfQuant quants[numAttributes];
+		uint32_t sizes[numAttributes];
+		uint32_t stride = 0;
+		uint32_t end = 0;
+
+		for (size_t a = 0; a < numAttributes; ++a)
+		{
+			const cgltf_attribute* cattr = &cprim->attributes[attribOrder[a]];
+			const cgltf_accessor* acc = cattr->data;
 
-	// Release the stream & output.
-	gfx_io_release(inc, src);
+			GFXFormat fmt = _gfx_gltf_attribute_fmt(
+				acc->component_type, acc->type, acc->normalized);
+
+			quants[a] = _GFX_GLTF_QUANT_NONE;
+
+			if (
+				(flags & GFX_GLTF_OPTIMIZE_QUANTIZE) &&
+				acc->component_type == cgltf_component_type_r_32f)
+			{
+				// Normals & tangents, pick packed if supported.
+				if (
+					(cattr->type == cgltf_attribute_type_normal &&
+					acc->type == cgltf_type_vec3) ||
+					(cattr->type == cgltf_attribute_type_tangent &&
+					acc->type == cgltf_type_vec4))
+				{
+					if (gfx_format_support(GFX_FORMAT_A2B10G10R10_SNORM, device) &
+						GFX_FORMAT_VERTEX_BUFFER)
+					{
+						quants[a] = _GFX_GLTF_QUANT_PACKED;
+						fmt = GFX_FORMAT_A2B10G10R10_SNORM;
+					}
+					else if (
+						gfx_format_support(GFX_FORMAT_R16G16B16A16_SNORM, device) &
+						GFX_FORMAT_VERTEX_BUFFER)
+					{
+						quants[a] = _GFX_GLTF_QUANT_SNORM16;
+						fmt = GFX_FORMAT_R16G16B16A16_SNORM;
+					}
+				}
+
+				// Texture coordinates, unorm if in [0,1], half if in range.
+				else if (
+					cattr->type == cgltf_attribute_type_texcoord &&
+					acc->type == cgltf_type_vec2)
+				{
+					float min = 0.0f, max = 0.0f;
+					for (size_t v = 0; v < numVertices; ++v)
+					{
+						float uv[2];
+						cgltf_accessor_read_float(acc, v, uv, 2);
+						min = GFX_MIN(min, GFX_MIN(uv[0], uv[1]));
+						max = GFX_MAX(max, GFX_MAX(uv[0], uv[1]));
+					}
+
+					if (
+						min >= 0.0f && max <= 1.0f &&
+						(gfx_format_support(GFX_FORMAT_R16G16_UNORM, device) &
+						GFX_FORMAT_VERTEX_BUFFER))
+					{
+						quants[a] = _GFX_GLTF_QUANT_UNORM16;
+						fmt = GFX_FORMAT_R16G16_UNORM;
+					}
+					else if (
+						min >= -65504.0f && max <= 65504.0f &&
+						(gfx_format_support(GFX_FORMAT_R16G16_SFLOAT, device) &
+						GFX_FORMAT_VERTEX_BUFFER))
+					{
+						quants[a] = _GFX_GLTF_QUANT_HALF;
+						fmt = GFX_FORMAT_R16G16_SFLOAT;
+					}
+				}
+			}
+
+			sizes[a] = (uint32_t)(GFX_FORMAT_BLOCK_SIZE(fmt) / CHAR_BIT);
+
+			attributes[a] = (GFXAttribute){
+				.format = fmt,
+				.offset = stride,
+				.stride = 0, // Set below.
+				.buffer = GFX_REF_NULL,
+				.rate = GFX_RATE_VERTEX
+			};
+
+			end = stride + sizes[a];
+			stride = GFX_ALIGN_UP(end, (uint32_t)4);
+		}
+
+		for (size_t a = 0; a < numAttributes; ++a)
+			attributes[a].stride = stride;
+
+		// Fill the vertex buffer.
+		const size_t verSize = stride * (numOutput - 1) + end;
+
+		vertices = malloc(verSize);
+		if (vertices == NULL) goto clean;
 
-	return image;
+		for (size_t v = 0; v < numVertices; ++v)
+		{
+			if (remap[v] == UINT32_MAX) continue;
+			unsigned char* vertex = vertices + (size_t)remap[v] * stride;
+
+			for (size_t a = 0; a < numAttributes; ++a)
+			{
+				const cgltf_accessor* acc = cprim->attributes[attribOrder[a]].data;
+				unsigned char* elem = vertex + attributes[a].offset;
+
+				if (quants[a] == _GFX_GLTF_QUANT_NONE)
+				{
+					// Copy verbatim.
+					const cgltf_buffer_view* view = acc->buffer_view;
+					const size_t aStride = (view->stride == 0) ?
+						acc->stride : view->stride;
+
+					memcpy(elem,
+						(const char*)view->buffer->data +
+							view->offset + acc->offset + v * aStride,
+						sizes[a]);
+
+					continue;
+				}
+
+				float f[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+				cgltf_accessor_read_float(
+					acc, v, f, cgltf_num_components(acc->type));
+
+				if (quants[a] == _GFX_GLTF_QUANT_PACKED)
+				{
+					const uint32_t packed =
+						((uint32_t)_gfx_gltf_snorm(f[0], 511) & 0x3ff) |
+						((uint32_t)_gfx_gltf_snorm(f[1], 511) & 0x3ff) << 10 |
+						((uint32_t)_gfx_gltf_snorm(f[2], 511) & 0x3ff) << 20 |
+						((uint32_t)_gfx_gltf_snorm(f[3], 1) & 0x3) << 30;
+
+					memcpy(elem, &packed, sizeof(packed));
+				}
+				else if (quants[a] == _GFX_GLTF_QUANT_SNORM16)
+				{
+					const int16_t snorm[4] = {
+						(int16_t)_gfx_gltf_snorm(f[0], 32767),
+						(int16_t)_gfx_gltf_snorm(f[1], 32767),
+						(int16_t)_gfx_gltf_snorm(f[2], 32767),
+						(int16_t)_gfx_gltf_snorm(f[3], 32767)
+					};
+
+					memcpy(elem, snorm, sizeof(snorm));
+				}
+				else if (quants[a] == _GFX_GLTF_QUANT_UNORM16)
+				{
+					const uint16_t unorm[2] = {
+						(uint16_t)(f[0] * 65535.0f + 0.5f),
+						(uint16_t)(f[1] * 65535.0f + 0.5f)
+					};
+
+					memcpy(elem, unorm, sizeof(unorm));
+				}
+				else
+				{
+					const uint16_t half[2] = {
+						_gfx_gltf_half(f[0]),
+						_gfx_gltf_half(f[1])
+					};
+
+					memcpy(elem, half, sizeof(half));
+				}
+			}
+		}
+
+		// Pick the index size, shrink in-place if possible.
+		// Keep UINT16_MAX free, it is the primitive restart value.
+		const char indexSize =
+			numIndices == 0 ? 0 :
+			((flags & GFX_GLTF_OPTIMIZE_SHRINK_INDEX) && numOutput < UINT16_MAX) ||
+			_GFX_GLTF_INDEX_SIZE(cprim->indices->component_type) == sizeof(uint16_t) ?
+				sizeof(uint16_t) : sizeof(uint32_t);
+
+		if (indexSize == sizeof(uint16_t))
+			for (size_t i = 0; i < numIndices; ++i)
+				((uint16_t*)indices)[i] = (uint16_t)indices[i];
+
+		// Allocate the primitive & write its data.
+		prim = gfx_alloc_prim(heap,
+			memFlags, 0, _GFX_GLTF_TOPOLOGY(cprim->type),
+			(uint32_t)numIndices, indexSize,
+			(uint32_t)numOutput,
+			GFX_REF_NULL,
+			numAttributes, attributes);
+
+		if (prim == NULL) goto clean;
+
+		const GFXInject inject =
+			gfx_dep_sig(dep,
+				GFX_ACCESS_VERTEX_READ | GFX_ACCESS_INDEX_READ, GFX_STAGE_ANY);
+
+		const GFXRegion verRegion = {
+			.offset = 0,
+			.size = verSize
+		};
+
+		const GFXRegion indRegion = {
+			.offset = 0,
+			.size = numIndices * (uint64_t)indexSize
+		};
+
+		if (!gfx_write(vertices, gfx_ref_prim_vertices(prim, 0),
+			GFX_TRANSFER_ASYNC,
+			1, 1, &verRegion, &verRegion, &inject))
+		{
+			goto clean_prim;
+		}
+
+		if (numIndices > 0 && !gfx_write(indices, gfx_ref_prim_indices(prim),
+			GFX_TRANSFER_ASYNC,
+			1, 1, &indRegion, &indRegion, &inject))
+		{
+			goto clean_prim;
+		}
+	}
+
+	free(indices);
+	free(remap);
+	free(positions);
+	free(vertices);
+
+	return prim;
+
+
+	// Cleanup on failure.
+clean_prim:
+	// The primitive may already be referenced by a transfer,
+	// make sure it is done before freeing it.
+	gfx_heap_flush(heap);
+	gfx_heap_block(heap);
+	gfx_free_prim(prim);
+	prim = NULL;
+clean:
+	free(indices);
+	free(remap);
+	free(positions);
+	free(vertices);
+	gfx_log_error("Failed to process primitive geometry.");
+
+	return NULL;
 }
 
 /****************************/
@@ -506,24 +1271,34 @@ GFX_API bool gfx_load_gltf(GFXHeap* heap, GFXDependency* dep,
 		return 0;
 	}
 
-	void* source = malloc((size_t)len);
+	// If the stream exposes its data (e.g. memory-mapped),
+	// parse straight from it, without an intermediate copy.
+	const void* source = gfx_io_data(src);
+	void* alloc = NULL;
+
 	if (source == NULL)
 	{
-		gfx_log_error(
-			"Could not allocate source buffer to load glTF source.");
+		alloc = malloc((size_t)len);
+		if (alloc == NULL)
+		{
+			gfx_log_error(
+				"Could not allocate source buffer to load glTF source.");
 
-		return 0;
-	}
+			return 0;
+		}
 
-	// Read source.
-	len = gfx_io_read(src, source, (size_t)len);
-	if (len <= 0)
-	{
-		gfx_log_error(
-			"Could not read glTF source from stream.");
+		// Read source.
+		len = gfx_io_read(src, alloc, (size_t)len);
+		if (len <= 0)
+		{
+			gfx_log_error(
+				"Could not read glTF source from stream.");
 
-		free(source);
-		return 0;
+			free(alloc);
+			return 0;
+		}
+
+		source = alloc;
 	}
 
 	// Parse the glTF source.
@@ -531,7 +1306,7 @@ GFX_API bool gfx_load_gltf(GFXHeap* heap, GFXDependency* dep,
 	cgltf_data* data = NULL;
 
 	cgltf_result res = cgltf_parse(&opts, source, (size_t)len, &data);
-	free(source); // Immediately free source buffer.
+	free(alloc); // Immediately free source buffer.
 
 	// Some extra validation.
 	if (res == cgltf_result_success) res = cgltf_validate(data);
@@ -570,6 +1345,15 @@ GFX_API bool gfx_load_gltf(GFXHeap* heap, GFXDependency* dep,
 	gfx_vec_reserve(&meshes, data->meshes_count);
 
 	// Create all buffers.
+	// If processing geometry, keep host copies of all buffers,
+	// hand them to cgltf so they are freed by cgltf_free.
+	const bool process = options != NULL && options->optimize != 0;
+
+	// Make everything readable if asked, e.g. to cook the result.
+	const bool readable = options != NULL && options->readable;
+	const GFXMemoryFlags memFlags =
+		GFX_MEMORY_WRITE | (readable ? GFX_MEMORY_READ : 0);
+
 	for (size_t b = 0; b < data->buffers_count; ++b)
 	{
 		GFXBuffer* buffer = NULL;
@@ -600,17 +1384,31 @@ GFX_API bool gfx_load_gltf(GFXHeap* heap, GFXDependency* dep,
 
 			// Allocate buffer.
 			buffer = _gfx_gltf_alloc_buffer(
-				heap, dep, data->buffers[b].size, bin);
+				heap, dep, memFlags, data->buffers[b].size, bin);
+
+			if (process && buffer != NULL)
+				data->buffers[b].data = bin,
+				data->buffers[b].data_free_method =
+					cgltf_data_free_method_memory_free;
+			else
+				free(bin);
 
-			free(bin);
 			if (buffer == NULL) goto clean;
 		}
 
 		// Check if actual URI.
 		else if (uri != NULL)
 		{
-			buffer = _gfx_gltf_include_buffer(inc, uri, heap, dep);
+			void* host = NULL;
+			buffer = _gfx_gltf_include_buffer(
+				inc, uri, heap, dep, memFlags, process ? &host : NULL);
+
 			if (buffer == NULL) goto clean;
+
+			if (host != NULL)
+				data->buffers[b].data = host,
+				data->buffers[b].data_free_method =
+					cgltf_data_free_method_memory_free;
 		}
 
 		// Insert the buffer.
@@ -622,32 +1420,9 @@ GFX_API bool gfx_load_gltf(GFXHeap* heap, GFXDependency* dep,
 	}
 
 	// Create all images.
-	for (size_t i = 0; i < data->images_count; ++i)
-	{
-		GFXImage* image = NULL;
-		const char* uri = data->images[i].uri;
-
-		// Check if data URI.
-		if (uri != NULL && strncmp(uri, "data:", 5) == 0)
-		{
-			gfx_log_error("Data URIs are not allowed for images.");
-			goto clean;
-		}
-
-		// Check if actual URI.
-		else if (uri != NULL)
-		{
-			image = _gfx_gltf_include_image(inc, uri, heap, dep, flags, usage);
-			if (image == NULL) goto clean;
-		}
-
-		// Insert the image.
-		if (!gfx_vec_push(&images, 1, &image))
-		{
-			gfx_free_image(image);
-			goto clean;
-		}
-	}
+	if (!_gfx_gltf_include_images(inc, data, heap, dep,
+		flags | (readable ? GFX_IMAGE_READABLE : 0), usage, &images))
+		goto clean;
 
 	// Create all samplers.
 	for (size_t s = 0; s < data->samplers_count; ++s)
@@ -939,16 +1714,30 @@ GFX_API bool gfx_load_gltf(GFXHeap* heap, GFXDependency* dep,
 				goto clean;
 			}
 
+			// Check if we can process the geometry on the host.
+			bool hostReadable =
+				process &&
+				(cprim->indices == NULL ||
+				_gfx_gltf_is_host_readable(cprim->indices));
+
+			for (size_t a = 0; hostReadable && a < numAttributes; ++a)
+				hostReadable = _gfx_gltf_is_host_readable(
+					cprim->attributes[attribOrder[a]].data);
+
 			// Allocate primitive.
-			GFXPrimitive* prim = gfx_alloc_prim(heap,
-				0, 0, _GFX_GLTF_TOPOLOGY(cprim->type),
-				(uint32_t)numIndices, indexSize,
-				(uint32_t)numVertices,
-				indexBuffer != NULL ?
-					gfx_ref_buffer_at(
-						indexBuffer, cprim->indices->buffer_view->offset) :
-					GFX_REF_NULL,
-				numAttributes, attributes);
+			GFXPrimitive* prim = hostReadable ?
+				_gfx_gltf_process_prim(heap, dep,
+					options->optimize, memFlags, cprim,
+					numAttributes, attribOrder, numVertices) :
+				gfx_alloc_prim(heap,
+					0, 0, _GFX_GLTF_TOPOLOGY(cprim->type),
+					(uint32_t)numIndices, indexSize,
+					(uint32_t)numVertices,
+					indexBuffer != NULL ?
+						gfx_ref_buffer_at(
+							indexBuffer, cprim->indices->buffer_view->offset) :
+						GFX_REF_NULL,
+					numAttributes, attributes);
 
 			if (prim == NULL) goto clean;
 
@@ -1041,12 +1830,12 @@ GFX_API void gfx_release_gltf(GFXGltfResult* result)
 {
 	assert(result != NULL);
 
-	free(result->buffers);
-	free(result->images);
-	free(result->samplers);
-	free(result->materials);
-	free(result->primitives);
-	free(result->meshes);
+	gfx_free(result->buffers);
+	gfx_free(result->images);
+	gfx_free(result->samplers);
+	gfx_free(result->materials);
+	gfx_free(result->primitives);
+	gfx_free(result->meshes);
 
 	// Leave all values, result is invalidated.
 }
@@ -7,8 +7,12 @@
  */
 
 #include "groufix/assets/image.h"
+#include "groufix/core/jobs.h"
 #include "groufix/core/log.h"
 #include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #define STBI_FAILURE_USERMSG
@@ -20,8 +24,9 @@
 
 
 // Checks if the format has features to support the requested usage.
-#define _GFX_STB_FMT_SUPPORTED(usage, feats) \
+#define _GFX_STB_FMT_SUPPORTED(flags, usage, feats) \
 	((feats & GFX_FORMAT_IMAGE_WRITE) && \
+	((feats & GFX_FORMAT_IMAGE_READ) || !(flags & GFX_IMAGE_GENERATE_MIPMAPS)) && \
 	((feats & GFX_FORMAT_SAMPLED_IMAGE) || !(usage & GFX_IMAGE_SAMPLED)) && \
 	((feats & GFX_FORMAT_SAMPLED_IMAGE_LINEAR) || !(usage & GFX_IMAGE_SAMPLED_LINEAR)) && \
 	((feats & GFX_FORMAT_SAMPLED_IMAGE_MINMAX) || !(usage & GFX_IMAGE_SAMPLED_MINMAX)) && \
@@ -31,6 +36,63 @@
 		!((GFX_IMAGE_INPUT | GFX_IMAGE_OUTPUT | GFX_IMAGE_TRANSIENT) & usage)))
 
 
+// Minimum number of images decoded by a single worker.
+#define _GFX_DECODE_MIN_IMAGES 2
+
+// Maximum number of workers decoding a single batch.
+#define _GFX_DECODE_MAX_WORKERS 64
+
+
+// KTX2 header size in bytes, excluding the level index.
+#define _GFX_KTX2_HEADER_SIZE 80
+
+// KTX2 level index entry size in bytes.
+#define _GFX_KTX2_LEVEL_SIZE 24
+
+// Reads a little-endian 32/64-bit KTX2 header field.
+#define _GFX_KTX2_U32(ptr) \
+	((uint32_t)(ptr)[0] | \
+	((uint32_t)(ptr)[1] << 8) | \
+	((uint32_t)(ptr)[2] << 16) | \
+	((uint32_t)(ptr)[3] << 24))
+
+#define _GFX_KTX2_U64(ptr) \
+	((uint64_t)_GFX_KTX2_U32(ptr) | \
+	((uint64_t)_GFX_KTX2_U32((ptr) + 4) << 32))
+
+
+/****************************
+ * Decoded image, output of a decode (worker), input of an upload.
+ */
+typedef struct _GFXImageDecode
+{
+	void*     img; // NULL if not decoded or failed.
+	GFXFormat fmt;
+	uint32_t  width;
+	uint32_t  height;
+
+	atomic_bool done; // Only used by batches.
+
+} _GFXImageDecode;
+
+
+/****************************
+ * Batch of images to decode in parallel, shared by all workers.
+ */
+typedef struct _GFXDecodeBatch
+{
+	GFXDevice*        device;
+	GFXImageFlags     flags;
+	GFXImageUsage     usage;
+	size_t            numImages;
+	const GFXReader** srcs;
+	_GFXImageDecode*  decodes;
+
+	atomic_size_t next; // Next image to decode.
+
+} _GFXDecodeBatch;
+
+
 /****************************
  * Constructs an image format based on:
  *  - If it is HDR (float).
@@ -63,14 +125,18 @@ static GFXFormat _gfx_stb_image_fmt(bool ishdr, bool is16, int comps)
 	};
 }
 
-/****************************/
-GFX_API GFXImage* gfx_load_image(GFXHeap* heap, GFXDependency* dep,
-                                 GFXImageFlags flags, GFXImageUsage usage,
-                                 const GFXReader* src)
+/****************************
+ * Decodes an image stream into host memory, selecting a supported format.
+ * @param decode Output decoded image, `img` is NULL on failure.
+ * @return Zero on failure.
+ *
+ * Thread-safe, does not touch any heap.
+ */
+static bool _gfx_decode_image(GFXDevice* device,
+                              GFXImageFlags flags, GFXImageUsage usage,
+                              const GFXReader* src, _GFXImageDecode* decode)
 {
-	assert(heap != NULL);
-	assert(dep != NULL);
-	assert(src != NULL);
+	decode->img = NULL;
 
 	// Allocate source buffer.
 	long long len = gfx_io_len(src);
@@ -79,27 +145,37 @@ GFX_API GFXImage* gfx_load_image(GFXHeap* heap, GFXDependency* dep,
 		gfx_log_error(
 			"Zero or unknown stream length, cannot load image source.");
 
-		return NULL;
+		return 0;
 	}
 
-	void* source = malloc((size_t)len);
+	// If the stream exposes its data (e.g. memory-mapped),
+	// decode straight from it, without an intermediate copy.
+	const void* source = gfx_io_data(src);
+	void* alloc = NULL;
+
 	if (source == NULL)
 	{
-		gfx_log_error(
-			"Could not allocate source buffer to load image source.");
+		alloc = malloc((size_t)len);
+		if (alloc == NULL)
+		{
+			gfx_log_error(
+				"Could not allocate source buffer to load image source.");
 
-		return NULL;
-	}
+			return 0;
+		}
 
-	// Read source.
-	len = gfx_io_read(src, source, (size_t)len);
-	if (len <= 0)
-	{
-		gfx_log_error(
-			"Could not read image source from stream.");
+		// Read source.
+		len = gfx_io_read(src, alloc, (size_t)len);
+		if (len <= 0)
+		{
+			gfx_log_error(
+				"Could not read image source from stream.");
 
-		free(source);
-		return NULL;
+			free(alloc);
+			return 0;
+		}
+
+		source = alloc;
 	}
 
 	// Get image properties.
@@ -113,8 +189,8 @@ GFX_API GFXImage* gfx_load_image(GFXHeap* heap, GFXDependency* dep,
 			"Failed to retrieve image dimensions & components from stream: %s.",
 			stbi_failure_reason());
 
-		free(source);
-		return NULL;
+		free(alloc);
+		return 0;
 	}
 
 	// Get appropriate format from properties.
@@ -122,7 +198,6 @@ GFX_API GFXImage* gfx_load_image(GFXHeap* heap, GFXDependency* dep,
 	// firstly try out bigger orders and secondly try out smaller types.
 	// This will eventually result in an 8-bit format with 4 components,
 	// which is required to be supported by Vulkan!
-	GFXDevice* device = gfx_heap_get_device(heap);
 	GFXFormat fmt = _gfx_stb_image_fmt(sIshdr, sIs16, sComps);
 	GFXFormatFeatures feats = gfx_format_support(fmt, device);
 
@@ -130,7 +205,7 @@ GFX_API GFXImage* gfx_load_image(GFXHeap* heap, GFXDependency* dep,
 	bool ishdr = sIshdr;
 	bool is16 = sIs16;
 
-	while (!_GFX_STB_FMT_SUPPORTED(usage, feats))
+	while (!_GFX_STB_FMT_SUPPORTED(flags, usage, feats))
 	{
 		// Try smaller type first, then bigger order.
 		if (flags & GFX_IMAGE_TYPE_BEFORE_ORDER)
@@ -172,13 +247,13 @@ GFX_API GFXImage* gfx_load_image(GFXHeap* heap, GFXDependency* dep,
 	}
 
 	// Uh oh.
-	if (!_GFX_STB_FMT_SUPPORTED(usage, feats))
+	if (!_GFX_STB_FMT_SUPPORTED(flags, usage, feats))
 	{
 		gfx_log_error(
 			"No suitable supported format to load image from stream.");
 
-		free(source);
-		return NULL;
+		free(alloc);
+		return 0;
 	}
 
 	// Load/parse the image from memory.
@@ -191,7 +266,7 @@ GFX_API GFXImage* gfx_load_image(GFXHeap* heap, GFXDependency* dep,
 	else
 		img = stbi_load_from_memory(source, (int)len, &x, &y, &comps, comps);
 
-	free(source); // Immediately free source buffer.
+	free(alloc); // Immediately free source buffer.
 
 	if (img == NULL)
 	{
@@ -199,13 +274,42 @@ GFX_API GFXImage* gfx_load_image(GFXHeap* heap, GFXDependency* dep,
 			"Failed to load image from stream: %s.",
 			stbi_failure_reason());
 
-		return NULL;
+		return 0;
 	}
 
+	decode->img = img;
+	decode->fmt = fmt;
+	decode->width = (uint32_t)x;
+	decode->height = (uint32_t)y;
+
+	return 1;
+}
+
+/****************************
+ * Allocates an image from a decoded image and writes its data to it,
+ * then frees the decoded image.
+ * @param decode Cannot be NULL, `img` cannot be NULL.
+ * @return NULL on failure.
+ */
+static GFXImage* _gfx_upload_image(GFXHeap* heap, GFXDependency* dep,
+                                   GFXImageFlags flags, GFXImageUsage usage,
+                                   _GFXImageDecode* decode)
+{
+	const bool mipmapped = flags & GFX_IMAGE_GENERATE_MIPMAPS;
+
+	// Get the length of the full mipmap chain if we generate it.
+	uint32_t mipmaps = 1;
+	if (mipmapped)
+		for (uint32_t s = GFX_MAX(decode->width, decode->height);
+			s > 1; s >>= 1) ++mipmaps;
+
 	// Allocate image.
+	// We need to read from it as well when generating mipmaps (blitting).
 	GFXImage* image = gfx_alloc_image(heap,
-		GFX_IMAGE_2D, GFX_MEMORY_WRITE,
-		usage, fmt, 1, 1, (uint32_t)x, (uint32_t)y, 1);
+		GFX_IMAGE_2D,
+		GFX_MEMORY_WRITE |
+		(mipmapped || (flags & GFX_IMAGE_READABLE) ? GFX_MEMORY_READ : 0),
+		usage, decode->fmt, mipmaps, 1, decode->width, decode->height, 1);
 
 	if (image == NULL) goto clean;
 
@@ -224,8 +328,8 @@ GFX_API GFXImage* gfx_load_image(GFXHeap* heap, GFXDependency* dep,
 		.x = 0,
 		.y = 0,
 		.z = 0,
-		.width = (uint32_t)x,
-		.height = (uint32_t)y,
+		.width = decode->width,
+		.height = decode->height,
 		.depth = 1
 	};
 
@@ -240,8 +344,10 @@ GFX_API GFXImage* gfx_load_image(GFXHeap* heap, GFXDependency* dep,
 	const GFXInject inject =
 		gfx_dep_sig(dep, mask, GFX_STAGE_ANY);
 
-	if (!gfx_write(img, gfx_ref_image(image),
-		GFX_TRANSFER_ASYNC,
+	// Generating mipmaps happens within the same operation,
+	// although it does force it to be performed on the graphics queue.
+	if (!gfx_write(decode->img, gfx_ref_image(image),
+		GFX_TRANSFER_ASYNC | (mipmapped ? GFX_TRANSFER_MIPMAPS : 0),
 		1, 1, &srcRegion, &dstRegion, &inject))
 	{
 		gfx_free_image(image);
@@ -249,15 +355,487 @@ GFX_API GFXImage* gfx_load_image(GFXHeap* heap, GFXDependency* dep,
 	}
 
 	// Free the parsed data and return.
-	stbi_image_free(img);
+	stbi_image_free(decode->img);
+	decode->img = NULL;
 
 	return image;
 
 
 	// Cleanup on failure.
 clean:
-	stbi_image_free(img);
+	stbi_image_free(decode->img);
+	decode->img = NULL;
 	gfx_log_error("Failed to load image from stream.");
 
 	return NULL;
 }
+
+/****************************
+ * Job entry point, decodes images of a batch until none are left.
+ */
+static void _gfx_decode_worker(void* arg)
+{
+	_GFXDecodeBatch* batch = arg;
+
+	// Keep grabbing the next image, to balance the load.
+	while (1)
+	{
+		const size_t i =
+			atomic_fetch_add_explicit(&batch->next, 1, memory_order_relaxed);
+
+		if (i >= batch->numImages)
+			break;
+
+		if (batch->srcs[i] != NULL)
+			_gfx_decode_image(batch->device,
+				batch->flags, batch->usage, batch->srcs[i], batch->decodes + i);
+
+		// Publish the decoded image to the uploading thread.
+		atomic_store_explicit(&batch->decodes[i].done, 1, memory_order_release);
+	}
+}
+
+/****************************/
+GFX_API GFXImage* gfx_load_image(GFXHeap* heap, GFXDependency* dep,
+                                 GFXImageFlags flags, GFXImageUsage usage,
+                                 const GFXReader* src)
+{
+	assert(heap != NULL);
+	assert(dep != NULL);
+	assert(src != NULL);
+
+	// Decode and upload it right here.
+	_GFXImageDecode decode;
+
+	if (!_gfx_decode_image(gfx_heap_get_device(heap), flags, usage, src, &decode))
+		return NULL;
+
+	return _gfx_upload_image(heap, dep, flags, usage, &decode);
+}
+
+/****************************/
+GFX_API bool gfx_load_images(GFXHeap* heap, GFXDependency* dep,
+                             GFXImageFlags flags, GFXImageUsage usage,
+                             size_t numImages, const GFXReader** srcs,
+                             GFXImage** images)
+{
+	assert(heap != NULL);
+	assert(dep != NULL);
+	assert(numImages == 0 || srcs != NULL);
+	assert(numImages == 0 || images != NULL);
+
+	if (numImages == 0) return 1;
+
+	_GFXImageDecode* decodes = malloc(sizeof(_GFXImageDecode) * numImages);
+	if (decodes == NULL)
+	{
+		gfx_log_error("Could not allocate decode state to load images.");
+		return 0;
+	}
+
+	for (size_t i = 0; i < numImages; ++i)
+		decodes[i].img = NULL,
+		atomic_store_explicit(&decodes[i].done, 0, memory_order_relaxed),
+		images[i] = NULL;
+
+	// Decode all images, spread over all workers.
+	_GFXDecodeBatch batch = {
+		.device = gfx_heap_get_device(heap),
+		.flags = flags,
+		.usage = usage,
+		.numImages = numImages,
+		.srcs = srcs,
+		.decodes = decodes
+	};
+
+	atomic_store_explicit(&batch.next, 0, memory_order_relaxed);
+
+	const size_t numWorkers = GFX_MAX(1, GFX_MIN(
+		_gfx_jobs_concurrency(),
+		GFX_MIN(_GFX_DECODE_MAX_WORKERS, numImages / _GFX_DECODE_MIN_IMAGES)));
+
+	_GFXJobCounter counter;
+	_gfx_job_counter(&counter, NULL);
+
+	_GFXJob jobs[numWorkers];
+
+	for (size_t w = 0; w < numWorkers; ++w)
+		jobs[w] = (_GFXJob){ .func = _gfx_decode_worker, .arg = &batch };
+
+	_gfx_jobs_submit(&counter, numWorkers - 1, jobs + 1);
+
+	// This thread uploads every image that is decoded, in order.
+	// While images are being decoded elsewhere, it decodes one itself,
+	// so decoding overlaps with the (asynchronous) transfers.
+	// Once no images are left to decode, wait for all workers.
+	bool success = 1;
+	bool joined = 0;
+	size_t uploaded = 0;
+
+	while (uploaded < numImages)
+	{
+		// Upload all decoded images, up to the first that is not.
+		while (
+			uploaded < numImages &&
+			atomic_load_explicit(&decodes[uploaded].done, memory_order_acquire))
+		{
+			_GFXImageDecode* decode = decodes + uploaded;
+
+			if (decode->img != NULL)
+				images[uploaded] = _gfx_upload_image(heap, dep, flags, usage, decode);
+
+			if (images[uploaded] == NULL && srcs[uploaded] != NULL)
+				success = 0;
+
+			++uploaded;
+		}
+
+		if (uploaded >= numImages || joined)
+			continue;
+
+		// Decode the next image ourselves.
+		const size_t i =
+			atomic_fetch_add_explicit(&batch.next, 1, memory_order_relaxed);
+
+		if (i < numImages)
+		{
+			if (srcs[i] != NULL)
+				_gfx_decode_image(batch.device,
+					flags, usage, srcs[i], decodes + i);
+
+			atomic_store_explicit(&decodes[i].done, 1, memory_order_release);
+		}
+		else
+		{
+			// None left, block until the workers are done decoding.
+			_gfx_jobs_wait(&counter);
+			joined = 1;
+		}
+	}
+
+	if (!joined)
+		_gfx_jobs_wait(&counter);
+
+	// On failure, free all images that did load.
+	// Flush & block the heap so no transfers reference them anymore.
+	if (!success)
+	{
+		gfx_log_error("Could not load all %"GFX_PRIs" images.", numImages);
+
+		gfx_heap_flush(heap);
+		gfx_heap_block(heap);
+
+		for (size_t i = 0; i < numImages; ++i)
+			gfx_free_image(images[i]),
+			images[i] = NULL;
+	}
+
+	free(decodes);
+
+	return success;
+}
+
+/****************************
+ * Maps a KTX2 (Vulkan) format value to a groufix format.
+ * @return GFX_FORMAT_EMPTY if not recognized.
+ */
+static GFXFormat _gfx_ktx2_fmt(uint32_t vkFormat)
+{
+	// Block-compressed formats are laid out in one contiguous range,
+	// ASTC alternates UNORM/SRGB for increasing block sizes.
+	static const unsigned char astc[14][2] = {
+		{4,4}, {5,4}, {5,5}, {6,5}, {6,6}, {8,5}, {8,6},
+		{8,8}, {10,5}, {10,6}, {10,8}, {10,10}, {12,10}, {12,12}
+	};
+
+	if (vkFormat >= 157 && vkFormat <= 184)
+	{
+		const uint32_t i = (vkFormat - 157) >> 1;
+		return (GFXFormat){
+			{ astc[i][0], astc[i][1], 0, 0 },
+			(vkFormat - 157) & 1 ? GFX_SRGB : GFX_UNORM,
+			GFX_ORDER_ASTC
+		};
+	}
+
+	switch (vkFormat)
+	{
+	// Uncompressed formats most commonly stored in KTX2.
+	case 9:   return GFX_FORMAT_R8_UNORM;
+	case 15:  return GFX_FORMAT_R8_SRGB;
+	case 16:  return GFX_FORMAT_R8G8_UNORM;
+	case 22:  return GFX_FORMAT_R8G8_SRGB;
+	case 37:  return GFX_FORMAT_R8G8B8A8_UNORM;
+	case 43:  return GFX_FORMAT_R8G8B8A8_SRGB;
+	case 44:  return GFX_FORMAT_B8G8R8A8_UNORM;
+	case 50:  return GFX_FORMAT_B8G8R8A8_SRGB;
+	case 76:  return GFX_FORMAT_R16_SFLOAT;
+	case 83:  return GFX_FORMAT_R16G16_SFLOAT;
+	case 97:  return GFX_FORMAT_R16G16B16A16_SFLOAT;
+	case 100: return GFX_FORMAT_R32_SFLOAT;
+	case 103: return GFX_FORMAT_R32G32_SFLOAT;
+	case 109: return GFX_FORMAT_R32G32B32A32_SFLOAT;
+
+	// BCn.
+	case 131: return GFX_FORMAT_BC1_RGB_UNORM;
+	case 132: return GFX_FORMAT_BC1_RGB_SRGB;
+	case 133: return GFX_FORMAT_BC1_RGBA_UNORM;
+	case 134: return GFX_FORMAT_BC1_RGBA_SRGB;
+	case 135: return GFX_FORMAT_BC2_UNORM;
+	case 136: return GFX_FORMAT_BC2_SRGB;
+	case 137: return GFX_FORMAT_BC3_UNORM;
+	case 138: return GFX_FORMAT_BC3_SRGB;
+	case 139: return GFX_FORMAT_BC4_UNORM;
+	case 140: return GFX_FORMAT_BC4_SNORM;
+	case 141: return GFX_FORMAT_BC5_UNORM;
+	case 142: return GFX_FORMAT_BC5_SNORM;
+	case 143: return GFX_FORMAT_BC6_UFLOAT;
+	case 144: return GFX_FORMAT_BC6_SFLOAT;
+	case 145: return GFX_FORMAT_BC7_UNORM;
+	case 146: return GFX_FORMAT_BC7_SRGB;
+
+	// ETC2 & EAC.
+	case 147: return GFX_FORMAT_ETC2_R8G8B8_UNORM;
+	case 148: return GFX_FORMAT_ETC2_R8G8B8_SRGB;
+	case 149: return GFX_FORMAT_ETC2_R8G8B8A1_UNORM;
+	case 150: return GFX_FORMAT_ETC2_R8G8B8A1_SRGB;
+	case 151: return GFX_FORMAT_ETC2_R8G8B8A8_UNORM;
+	case 152: return GFX_FORMAT_ETC2_R8G8B8A8_SRGB;
+	case 153: return GFX_FORMAT_EAC_R11_UNORM;
+	case 154: return GFX_FORMAT_EAC_R11_SNORM;
+	case 155: return GFX_FORMAT_EAC_R11G11_UNORM;
+	case 156: return GFX_FORMAT_EAC_R11G11_SNORM;
+
+	default:
+		return GFX_FORMAT_EMPTY;
+	}
+}
+
+/****************************/
+GFX_API GFXImage* gfx_load_ktx2(GFXHeap* heap, GFXDependency* dep,
+                                GFXImageFlags flags, GFXImageUsage usage,
+                                const GFXReader* src)
+{
+	assert(heap != NULL);
+	assert(dep != NULL);
+	assert(src != NULL);
+
+	// Allocate source buffer.
+	long long len = gfx_io_len(src);
+	if (len <= 0)
+	{
+		gfx_log_error(
+			"Zero or unknown stream length, cannot load KTX2 source.");
+
+		return NULL;
+	}
+
+	// Again, use the stream's data directly if exposed.
+	const unsigned char* source = gfx_io_data(src);
+	void* alloc = NULL;
+
+	if (source == NULL)
+	{
+		alloc = malloc((size_t)len);
+		if (alloc == NULL)
+		{
+			gfx_log_error(
+				"Could not allocate source buffer to load KTX2 source.");
+
+			return NULL;
+		}
+
+		// Read source.
+		len = gfx_io_read(src, alloc, (size_t)len);
+		if (len <= 0)
+		{
+			gfx_log_error(
+				"Could not read KTX2 source from stream.");
+
+			free(alloc);
+			return NULL;
+		}
+
+		source = alloc;
+	}
+
+	GFXImage* image = NULL;
+	const uint64_t size = (uint64_t)len;
+
+	// Validate the identifier & header.
+	static const unsigned char ident[12] = {
+		0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+	};
+
+	if (size < _GFX_KTX2_HEADER_SIZE || memcmp(source, ident, 12) != 0)
+	{
+		gfx_log_error("Stream is not a KTX2 file.");
+		goto clean;
+	}
+
+	const uint32_t vkFormat = _GFX_KTX2_U32(source + 12);
+	const uint32_t width    = _GFX_KTX2_U32(source + 20);
+	const uint32_t height   = _GFX_KTX2_U32(source + 24);
+	const uint32_t depth    = _GFX_KTX2_U32(source + 28);
+	const uint32_t layers   = _GFX_KTX2_U32(source + 32);
+	const uint32_t faces    = _GFX_KTX2_U32(source + 36);
+	const uint32_t levels   = _GFX_KTX2_U32(source + 40);
+	const uint32_t scheme   = _GFX_KTX2_U32(source + 44);
+
+	// Supercompressed or Basis Universal data needs transcoding first.
+	if (scheme != 0 || vkFormat == 0)
+	{
+		gfx_log_error(
+			"Supercompressed or Basis Universal KTX2 data is not "
+			"supported, it must be transcoded to a block format first.");
+
+		goto clean;
+	}
+
+	if (width == 0 || (faces != 1 && faces != 6) ||
+		(faces == 6 && (depth > 0 || width != height)) ||
+		(depth > 0 && layers > 0))
+	{
+		gfx_log_error("Invalid or unsupported KTX2 image dimensions.");
+		goto clean;
+	}
+
+	// Levels of zero means mipmaps should be generated,
+	// we can only do so for uncompressed formats.
+	const GFXFormat fmt = _gfx_ktx2_fmt(vkFormat);
+	const bool generate = (levels == 0) &&
+		(flags & GFX_IMAGE_GENERATE_MIPMAPS) &&
+		!GFX_FORMAT_IS_COMPRESSED(fmt);
+
+	const uint32_t numLevels = GFX_MAX(1, levels);
+	const uint32_t numLayers = GFX_MAX(1, layers) * faces;
+
+	if (size < _GFX_KTX2_HEADER_SIZE +
+		(uint64_t)numLevels * _GFX_KTX2_LEVEL_SIZE)
+	{
+		gfx_log_error("KTX2 level index exceeds the stream.");
+		goto clean;
+	}
+
+	// Check the format is supported, it cannot be converted!
+	// The file is meant to ship in the format best suited for the device,
+	// store one KTX2 file per block format family to pick from.
+	const GFXFormatFeatures feats =
+		gfx_format_support(fmt, gfx_heap_get_device(heap));
+
+	if (GFX_FORMAT_IS_EMPTY(fmt) || !_GFX_STB_FMT_SUPPORTED(
+		(generate ? GFX_IMAGE_GENERATE_MIPMAPS : 0), usage, feats))
+	{
+		gfx_log_error(
+			"KTX2 image format (VkFormat %"PRIu32") is not supported.",
+			vkFormat);
+
+		goto clean;
+	}
+
+	// Get the length of the full mipmap chain if we generate it.
+	uint32_t mipmaps = numLevels;
+	if (generate)
+		for (uint32_t s = GFX_MAX(width, GFX_MAX(height, depth));
+			s > 1; s >>= 1) ++mipmaps;
+
+	// Allocate image.
+	const GFXImageType type =
+		(faces == 6) ? GFX_IMAGE_CUBE :
+		(depth > 0) ? GFX_IMAGE_3D :
+		(height == 0) ? GFX_IMAGE_1D : GFX_IMAGE_2D;
+
+	image = gfx_alloc_image(heap,
+		type, GFX_MEMORY_WRITE |
+		(generate || (flags & GFX_IMAGE_READABLE) ? GFX_MEMORY_READ : 0),
+		usage, fmt, mipmaps, numLayers,
+		width, GFX_MAX(1, height), GFX_MAX(1, depth));
+
+	if (image == NULL) goto clean;
+
+	// Write all levels (with all layers & faces) in one operation.
+	// Each level is tightly packed, so no row size or count is required.
+	{
+		GFXRegion srcRegions[numLevels];
+		GFXRegion dstRegions[numLevels];
+
+		const uint32_t blockSize = GFX_FORMAT_BLOCK_SIZE(fmt) / CHAR_BIT;
+		const uint32_t blockWidth = GFX_FORMAT_BLOCK_WIDTH(fmt);
+		const uint32_t blockHeight = GFX_FORMAT_BLOCK_HEIGHT(fmt);
+
+		for (uint32_t l = 0; l < numLevels; ++l)
+		{
+			const unsigned char* entry =
+				source + _GFX_KTX2_HEADER_SIZE + l * _GFX_KTX2_LEVEL_SIZE;
+
+			const uint64_t offset = _GFX_KTX2_U64(entry);
+			const uint64_t length = _GFX_KTX2_U64(entry + 8);
+
+			const uint32_t w = GFX_MAX(1, width >> l);
+			const uint32_t h = GFX_MAX(1, GFX_MAX(1, height) >> l);
+			const uint32_t d = GFX_MAX(1, GFX_MAX(1, depth) >> l);
+
+			const uint64_t expected = (uint64_t)blockSize * numLayers * d *
+				((w + blockWidth - 1) / blockWidth) *
+				((h + blockHeight - 1) / blockHeight);
+
+			if (length < expected || offset > size || size - offset < expected)
+			{
+				gfx_log_error("KTX2 mipmap level %"PRIu32" is truncated.", l);
+				goto clean_image;
+			}
+
+			srcRegions[l] = (GFXRegion){
+				.offset = offset,
+				.rowSize = 0,
+				.numRows = 0
+			};
+
+			dstRegions[l] = (GFXRegion){
+				.aspect = GFX_IMAGE_COLOR,
+				.mipmap = l,
+				.layer = 0,
+				.numLayers = numLayers,
+				.x = 0,
+				.y = 0,
+				.z = 0,
+				.width = w,
+				.height = h,
+				.depth = d
+			};
+		}
+
+		const GFXAccessMask mask =
+			((image->usage & GFX_IMAGE_SAMPLED) ||
+			(image->usage & GFX_IMAGE_SAMPLED_LINEAR) ||
+			(image->usage & GFX_IMAGE_SAMPLED_MINMAX) ?
+				GFX_ACCESS_SAMPLED_READ : 0) |
+			((image->usage & GFX_IMAGE_STORAGE) ?
+				GFX_ACCESS_STORAGE_READ_WRITE : 0);
+
+		const GFXInject inject =
+			gfx_dep_sig(dep, mask, GFX_STAGE_ANY);
+
+		if (!gfx_write(source, gfx_ref_image(image),
+			GFX_TRANSFER_ASYNC | (generate ? GFX_TRANSFER_MIPMAPS : 0),
+			numLevels, 1, srcRegions, dstRegions, &inject))
+		{
+			goto clean_image;
+		}
+	}
+
+	// Free the source buffer and return.
+	free(alloc);
+
+	return image;
+
+
+	// Cleanup on failure.
+clean_image:
+	gfx_free_image(image);
+clean:
+	free(alloc);
+	gfx_log_error("Failed to load KTX2 image from stream.");
+
+	return NULL;
+}
@@ -0,0 +1,1109 @@
+/**
+ * This file is part of groufix.
+ * Copyright (c) Stef Velzel. All rights reserved.
+ *
+ * groufix : graphics engine produced by Stef Velzel.
+ * www     : <www.vuzzel.nl>
+ */
+
+#include "groufix/assets/scene.h"
+#include "groufix/containers/alloc.h"
+#include "groufix/core/log.h"
+#include <assert.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// Cooked scene stream identification.
+#define _GFX_SCENE_MAGIC   "GFXS"
+#define _GFX_SCENE_VERSION 1
+
+// Alignment of all sections and data blobs, in bytes.
+#define _GFX_SCENE_ALIGN ((uint64_t)16)
+
+
+// Number of textures in a material.
+#define _GFX_SCENE_NUM_TEXTURES \
+	(sizeof(_gfx_scene_textures) / sizeof(_gfx_scene_textures[0]))
+
+// Retrieves a texture of a material.
+#define _GFX_SCENE_TEXTURE(material, t) \
+	((GFXGltfTexture*)((char*)(material) + _gfx_scene_textures[t]))
+
+
+/****************************
+ * Offsets of all textures within a material.
+ */
+static const size_t _gfx_scene_textures[] = {
+	offsetof(GFXGltfMaterial, pbr.baseColor),
+	offsetof(GFXGltfMaterial, pbr.metallicRoughness),
+	offsetof(GFXGltfMaterial, pbr.diffuse),
+	offsetof(GFXGltfMaterial, pbr.specularGlossiness),
+	offsetof(GFXGltfMaterial, normal),
+	offsetof(GFXGltfMaterial, occlusion),
+	offsetof(GFXGltfMaterial, emissive),
+	offsetof(GFXGltfMaterial, clearcoat),
+	offsetof(GFXGltfMaterial, clearcoatRoughness),
+	offsetof(GFXGltfMaterial, clearcoatNormal),
+	offsetof(GFXGltfMaterial, iridescence),
+	offsetof(GFXGltfMaterial, iridescenceThickness),
+	offsetof(GFXGltfMaterial, sheenColor),
+	offsetof(GFXGltfMaterial, sheenRoughness),
+	offsetof(GFXGltfMaterial, specular),
+	offsetof(GFXGltfMaterial, specularColor),
+	offsetof(GFXGltfMaterial, transmission),
+	offsetof(GFXGltfMaterial, thickness)
+};
+
+
+/****************************
+ * Cooked scene stream header, followed by all sections in order:
+ *  images, samplers, materials, textures, primitives, attributes, meshes,
+ * each aligned to _GFX_SCENE_ALIGN, followed by all data at dataOffset.
+ */
+typedef struct _GFXSceneHeader
+{
+	char     magic[4];
+	uint32_t version;
+
+	// Layout checks, streams are only valid for an identical build.
+	uint32_t materialSize;
+	uint32_t samplerSize;
+
+	uint32_t numImages;
+	uint32_t numSamplers;
+	uint32_t numMaterials;
+	uint32_t numPrimitives;
+	uint32_t numAttributes;
+	uint32_t numMeshes;
+
+	uint64_t dataOffset;
+	uint64_t dataSize;
+
+} _GFXSceneHeader;
+
+
+/****************************
+ * Cooked image descriptor, data holds all mipmaps tightly packed.
+ */
+typedef struct _GFXSceneImage
+{
+	GFXFormat format;
+	uint32_t  type;
+	uint32_t  usage;
+
+	uint32_t mipmaps;
+	uint32_t layers;
+	uint32_t width;
+	uint32_t height;
+	uint32_t depth;
+
+	uint64_t offset; // Into data.
+	uint64_t size;
+
+} _GFXSceneImage;
+
+
+/****************************
+ * Cooked material texture, _GFX_SCENE_NUM_TEXTURES for each material.
+ */
+typedef struct _GFXSceneTexture
+{
+	uint32_t image;   // Index + 1, 0 for none.
+	uint32_t sampler; // Index + 1, 0 for none.
+
+} _GFXSceneTexture;
+
+
+/****************************
+ * Cooked primitive descriptor, data holds interleaved vertices & indices.
+ */
+typedef struct _GFXScenePrimitive
+{
+	uint32_t topology;
+	uint32_t material; // Index + 1, 0 for none.
+
+	uint32_t numVertices;
+	uint32_t numIndices;
+	uint32_t indexSize;
+	uint32_t stride;
+
+	uint32_t firstAttribute;
+	uint32_t numAttributes;
+
+	uint64_t verOffset; // Into data.
+	uint64_t indOffset; // Into data.
+
+} _GFXScenePrimitive;
+
+
+/****************************
+ * Cooked vertex attribute, offset into an interleaved vertex.
+ */
+typedef struct _GFXSceneAttribute
+{
+	GFXFormat format;
+	uint32_t  offset;
+
+} _GFXSceneAttribute;
+
+
+/****************************
+ * Cooked mesh descriptor.
+ */
+typedef struct _GFXSceneMesh
+{
+	uint32_t firstPrimitive;
+	uint32_t numPrimitives;
+
+} _GFXSceneMesh;
+
+
+/****************************
+ * Offsets of all sections in a cooked scene stream.
+ */
+typedef struct _GFXSceneLayout
+{
+	uint64_t images;
+	uint64_t samplers;
+	uint64_t materials;
+	uint64_t textures;
+	uint64_t primitives;
+	uint64_t attributes;
+	uint64_t meshes;
+	uint64_t end; // Minimum data offset.
+
+} _GFXSceneLayout;
+
+
+/****************************
+ * Computes the section offsets of a cooked scene stream.
+ * @param header Cannot be NULL, all counts must be set.
+ */
+static _GFXSceneLayout _gfx_scene_layout(const _GFXSceneHeader* header)
+{
+	assert(header != NULL);
+
+	_GFXSceneLayout layout;
+	uint64_t off = GFX_ALIGN_UP(sizeof(_GFXSceneHeader), _GFX_SCENE_ALIGN);
+
+#define _GFX_SCENE_SECTION(field, count, size) \
+	layout.field = off; \
+	off = GFX_ALIGN_UP(off + (uint64_t)(count) * (size), _GFX_SCENE_ALIGN);
+
+	_GFX_SCENE_SECTION(images,
+		header->numImages, sizeof(_GFXSceneImage));
+	_GFX_SCENE_SECTION(samplers,
+		header->numSamplers, sizeof(GFXGltfSampler));
+	_GFX_SCENE_SECTION(materials,
+		header->numMaterials, sizeof(GFXGltfMaterial));
+	_GFX_SCENE_SECTION(textures,
+		header->numMaterials, sizeof(_GFXSceneTexture) * _GFX_SCENE_NUM_TEXTURES);
+	_GFX_SCENE_SECTION(primitives,
+		header->numPrimitives, sizeof(_GFXScenePrimitive));
+	_GFX_SCENE_SECTION(attributes,
+		header->numAttributes, sizeof(_GFXSceneAttribute));
+	_GFX_SCENE_SECTION(meshes,
+		header->numMeshes, sizeof(_GFXSceneMesh));
+
+#undef _GFX_SCENE_SECTION
+
+	layout.end = off;
+
+	return layout;
+}
+
+/****************************
+ * Fills the regions of all mipmaps of a cooked image.
+ * @param image      Cannot be NULL.
+ * @param bufRegions Output buffer regions, image->mipmaps in total.
+ * @param imgRegions Output image regions, image->mipmaps in total.
+ * @return Total size of all mipmaps, tightly packed from image->offset.
+ */
+static uint64_t _gfx_scene_image_regions(const _GFXSceneImage* image,
+                                         GFXRegion* bufRegions,
+                                         GFXRegion* imgRegions)
+{
+	assert(image != NULL);
+	assert(bufRegions != NULL);
+	assert(imgRegions != NULL);
+
+	const uint64_t blockSize = GFX_FORMAT_BLOCK_SIZE(image->format) / CHAR_BIT;
+	const uint32_t blockWidth = GFX_FORMAT_BLOCK_WIDTH(image->format);
+	const uint32_t blockHeight = GFX_FORMAT_BLOCK_HEIGHT(image->format);
+
+	uint64_t size = 0;
+
+	for (uint32_t m = 0; m < image->mipmaps; ++m)
+	{
+		const uint32_t w = GFX_MAX(1, image->width >> m);
+		const uint32_t h = GFX_MAX(1, image->height >> m);
+		const uint32_t d = GFX_MAX(1, image->depth >> m);
+
+		bufRegions[m] = (GFXRegion){
+			.offset = image->offset + size,
+			.size = 0,
+			.rowSize = 0,
+			.numRows = 0
+		};
+
+		imgRegions[m] = (GFXRegion){
+			.aspect = GFX_IMAGE_COLOR,
+			.mipmap = m,
+			.layer = 0,
+			.numLayers = image->layers,
+			.x = 0,
+			.y = 0,
+			.z = 0,
+			.width = w,
+			.height = h,
+			.depth = d
+		};
+
+		size += blockSize * image->layers * d *
+			((w + blockWidth - 1) / blockWidth) *
+			((h + blockHeight - 1) / blockHeight);
+	}
+
+	return size;
+}
+
+/****************************
+ * Computes the vertex buffer size of a cooked primitive,
+ * this is the size gfx_alloc_prim claims for interleaved vertices.
+ * @param prim   Cannot be NULL, numVertices must be > 0.
+ * @param attribs Cannot be NULL, prim->numAttributes in total.
+ */
+static uint64_t _gfx_scene_vertices_size(const _GFXScenePrimitive* prim,
+                                         const _GFXSceneAttribute* attribs)
+{
+	assert(prim != NULL);
+	assert(attribs != NULL);
+
+	uint64_t size = 0;
+
+	for (uint32_t a = 0; a < prim->numAttributes; ++a)
+		size = GFX_MAX(size,
+			attribs[a].offset +
+			(uint64_t)prim->stride * (prim->numVertices - 1) +
+			GFX_FORMAT_BLOCK_SIZE(attribs[a].format) / CHAR_BIT);
+
+	return size;
+}
+
+/****************************
+ * Finds the index + 1 of an image in a glTF result, 0 if not found.
+ */
+static uint32_t _gfx_scene_find_image(const GFXGltfResult* result,
+                                      const GFXImage* image)
+{
+	if (image != NULL)
+		for (size_t i = 0; i < result->numImages; ++i)
+			if (result->images[i] == image) return (uint32_t)(i + 1);
+
+	return 0;
+}
+
+/****************************/
+GFX_API bool gfx_cook_gltf(GFXHeap* heap, const GFXGltfResult* result,
+                           size_t numDeps, const GFXInject* deps,
+                           const GFXWriter* dst)
+{
+	assert(heap != NULL);
+	assert(result != NULL);
+	assert(numDeps == 0 || deps != NULL);
+	assert(dst != NULL);
+
+	// Count all attributes, every descriptor count must fit in 32 bits.
+	size_t numAttributes = 0;
+	size_t numMipmaps = 0;
+
+	for (size_t p = 0; p < result->numPrimitives; ++p)
+		numAttributes +=
+			gfx_prim_get_num_attribs(result->primitives[p].primitive);
+
+	for (size_t i = 0; i < result->numImages; ++i)
+		numMipmaps += result->images[i]->mipmaps;
+
+	if (
+		result->numImages > UINT32_MAX ||
+		result->numSamplers > UINT32_MAX ||
+		result->numMaterials > UINT32_MAX ||
+		result->numPrimitives > UINT32_MAX ||
+		numAttributes > UINT32_MAX ||
+		result->numMeshes > UINT32_MAX)
+	{
+		gfx_log_error("Cannot cook a glTF result that large.");
+		return 0;
+	}
+
+	// Build the header and compute the stream layout.
+	_GFXSceneHeader header = {
+		.magic = _GFX_SCENE_MAGIC,
+		.version = _GFX_SCENE_VERSION,
+		.materialSize = (uint32_t)sizeof(GFXGltfMaterial),
+		.samplerSize = (uint32_t)sizeof(GFXGltfSampler),
+		.numImages = (uint32_t)result->numImages,
+		.numSamplers = (uint32_t)result->numSamplers,
+		.numMaterials = (uint32_t)result->numMaterials,
+		.numPrimitives = (uint32_t)result->numPrimitives,
+		.numAttributes = (uint32_t)numAttributes,
+		.numMeshes = (uint32_t)result->numMeshes
+	};
+
+	const _GFXSceneLayout layout = _gfx_scene_layout(&header);
+	header.dataOffset = layout.end;
+
+	// Allocate all descriptors as they appear in the stream,
+	// next to all transfer operations to read back data with.
+	// Each attribute and index buffer is read back as one operation.
+	const size_t numOps =
+		result->numImages + numAttributes + result->numPrimitives;
+	const size_t numRegions =
+		numMipmaps * 2 + (numAttributes + result->numPrimitives) * 2;
+
+	unsigned char* meta = calloc(1, (size_t)layout.end);
+	GFXCopyOp* ops = malloc(
+		sizeof(GFXCopyOp) * numOps +
+		sizeof(GFXRegion) * numRegions +
+		sizeof(uint64_t) * numAttributes);
+
+	if (meta == NULL || ops == NULL)
+	{
+		gfx_log_error("Could not allocate descriptors to cook glTF result.");
+		goto clean;
+	}
+
+	GFXRegion* regions = (GFXRegion*)(ops + numOps);
+	uint64_t* spans = (uint64_t*)(regions + numRegions);
+
+	_GFXSceneImage* images =
+		(_GFXSceneImage*)(meta + layout.images);
+	GFXGltfSampler* samplers =
+		(GFXGltfSampler*)(meta + layout.samplers);
+	GFXGltfMaterial* materials =
+		(GFXGltfMaterial*)(meta + layout.materials);
+	_GFXSceneTexture* textures =
+		(_GFXSceneTexture*)(meta + layout.textures);
+	_GFXScenePrimitive* prims =
+		(_GFXScenePrimitive*)(meta + layout.primitives);
+	_GFXSceneAttribute* attribs =
+		(_GFXSceneAttribute*)(meta + layout.attributes);
+	_GFXSceneMesh* meshes =
+		(_GFXSceneMesh*)(meta + layout.meshes);
+
+	// Describe all images, place their data first.
+	size_t numOpsUsed = 0;
+	size_t numRegionsUsed = 0;
+	uint64_t dataSize = 0;
+
+	for (size_t i = 0; i < result->numImages; ++i)
+	{
+		const GFXImage* image = result->images[i];
+
+		if (GFX_FORMAT_HAS_DEPTH_OR_STENCIL(image->format))
+		{
+			gfx_log_error(
+				"Cannot cook a glTF result with a depth/stencil image.");
+			goto clean;
+		}
+
+		images[i] = (_GFXSceneImage){
+			.format = image->format,
+			.type = (uint32_t)image->type,
+			.usage = (uint32_t)image->usage,
+			.mipmaps = image->mipmaps,
+			.layers = image->layers,
+			.width = image->width,
+			.height = image->height,
+			.depth = image->depth,
+			.offset = dataSize
+		};
+
+		GFXRegion* bufRegions = regions + numRegionsUsed;
+		GFXRegion* imgRegions = bufRegions + image->mipmaps;
+		numRegionsUsed += image->mipmaps * 2;
+
+		images[i].size =
+			_gfx_scene_image_regions(images + i, bufRegions, imgRegions);
+
+		ops[numOpsUsed++] = (GFXCopyOp){
+			.src = gfx_ref_image(result->images[i]),
+			.dst = GFX_REF_NULL, // Set once allocated.
+			.numRegions = image->mipmaps,
+			.srcRegions = imgRegions,
+			.dstRegions = bufRegions
+		};
+
+		dataSize = GFX_ALIGN_UP(dataSize + images[i].size, _GFX_SCENE_ALIGN);
+	}
+
+	// Describe samplers & materials, swizzle all pointers to indices.
+	if (result->numSamplers > 0)
+		memcpy(samplers, result->samplers,
+			sizeof(GFXGltfSampler) * result->numSamplers);
+
+	for (size_t m = 0; m < result->numMaterials; ++m)
+	{
+		materials[m] = result->materials[m];
+
+		for (size_t t = 0; t < _GFX_SCENE_NUM_TEXTURES; ++t)
+		{
+			GFXGltfTexture* tex = _GFX_SCENE_TEXTURE(materials + m, t);
+
+			textures[m * _GFX_SCENE_NUM_TEXTURES + t] = (_GFXSceneTexture){
+				.image = _gfx_scene_find_image(result, tex->image),
+				.sampler = tex->sampler == NULL ? 0 :
+					(uint32_t)(tex->sampler - result->samplers + 1)
+			};
+
+			tex->image = NULL;
+			tex->sampler = NULL;
+		}
+	}
+
+	// Describe all primitives, each gets one interleaved vertex buffer.
+	// Attributes are read back into spans after all data, to interleave.
+	size_t numSpans = 0;
+
+	for (size_t p = 0, firstAttribute = 0; p < result->numPrimitives; ++p)
+	{
+		GFXPrimitive* prim = result->primitives[p].primitive;
+		const size_t numPrimAttribs = gfx_prim_get_num_attribs(prim);
+
+		prims[p] = (_GFXScenePrimitive){
+			.topology = (uint32_t)prim->topology,
+			.material = result->primitives[p].material == NULL ? 0 :
+				(uint32_t)(result->primitives[p].material -
+					result->materials + 1),
+			.numVertices = prim->numVertices,
+			.numIndices = prim->numIndices,
+			.indexSize = (uint32_t)prim->indexSize,
+			.stride = 0,
+			.firstAttribute = (uint32_t)firstAttribute,
+			.numAttributes = (uint32_t)numPrimAttribs
+		};
+
+		for (size_t a = 0; a < numPrimAttribs; ++a)
+		{
+			const GFXAttribute attrib = gfx_prim_get_attrib(prim, a);
+			const uint32_t elemSize =
+				GFX_FORMAT_BLOCK_SIZE(attrib.format) / CHAR_BIT;
+
+			if (attrib.rate == GFX_RATE_INSTANCE)
+			{
+				gfx_log_error(
+					"Cannot cook a glTF result with instance rate attributes.");
+				goto clean;
+			}
+
+			attribs[firstAttribute + a] = (_GFXSceneAttribute){
+				.format = attrib.format,
+				.offset = prims[p].stride
+			};
+
+			prims[p].stride = GFX_ALIGN_UP(
+				prims[p].stride + elemSize, (uint32_t)4);
+
+			// Read back the span this attribute occupies.
+			spans[numSpans] =
+				(uint64_t)attrib.stride * (prim->numVertices - 1) + elemSize;
+
+			GFXRegion* srcRegion = regions + (numRegionsUsed++);
+			GFXRegion* dstRegion = regions + (numRegionsUsed++);
+
+			*srcRegion = (GFXRegion){ .offset = 0, .size = spans[numSpans] };
+			*dstRegion = (GFXRegion){ .offset = 0, .size = spans[numSpans] };
+
+			ops[numOpsUsed++] = (GFXCopyOp){
+				.src = gfx_ref_prim_vertices_at(prim, a, attrib.offset),
+				.dst = GFX_REF_NULL,
+				.numRegions = 1,
+				.srcRegions = srcRegion,
+				.dstRegions = dstRegion
+			};
+
+			++numSpans;
+		}
+
+		prims[p].verOffset = dataSize;
+		dataSize = GFX_ALIGN_UP(
+			dataSize + _gfx_scene_vertices_size(prims + p, attribs + firstAttribute),
+			_GFX_SCENE_ALIGN);
+
+		// Read back the index buffer straight into place.
+		if (prim->numIndices > 0)
+		{
+			const uint64_t size =
+				(uint64_t)prim->indexSize * prim->numIndices;
+
+			GFXRegion* srcRegion = regions + (numRegionsUsed++);
+			GFXRegion* dstRegion = regions + (numRegionsUsed++);
+
+			*srcRegion = (GFXRegion){ .offset = 0, .size = size };
+			*dstRegion = (GFXRegion){ .offset = dataSize, .size = size };
+
+			ops[numOpsUsed++] = (GFXCopyOp){
+				.src = gfx_ref_prim_indices(prim),
+				.dst = GFX_REF_NULL,
+				.numRegions = 1,
+				.srcRegions = srcRegion,
+				.dstRegions = dstRegion
+			};
+
+			prims[p].indOffset = dataSize;
+			dataSize = GFX_ALIGN_UP(dataSize + size, _GFX_SCENE_ALIGN);
+		}
+
+		firstAttribute += numPrimAttribs;
+	}
+
+	// Describe all meshes, they reference consecutive primitives.
+	for (size_t m = 0; m < result->numMeshes; ++m)
+		meshes[m] = (_GFXSceneMesh){
+			.firstPrimitive = result->meshes[m].numPrimitives == 0 ? 0 :
+				(uint32_t)(result->meshes[m].primitives - result->primitives),
+			.numPrimitives = (uint32_t)result->meshes[m].numPrimitives
+		};
+
+	header.dataSize = dataSize;
+	memcpy(meta, &header, sizeof(header));
+
+	// Place all attribute spans after the data, now that its size is known.
+	uint64_t bufferSize = dataSize;
+
+	for (size_t o = result->numImages, s = 0; o < numOpsUsed; ++o)
+		if (ops[o].src.type == GFX_REF_PRIMITIVE_VERTICES)
+		{
+			GFXRegion* dstRegion = (GFXRegion*)ops[o].dstRegions;
+			dstRegion->offset = bufferSize;
+
+			bufferSize = GFX_ALIGN_UP(bufferSize + spans[s++], _GFX_SCENE_ALIGN);
+		}
+
+	// Read everything back in one blocking operation.
+	GFXBuffer* buffer = NULL;
+	unsigned char* data = NULL;
+
+	if (bufferSize > 0)
+	{
+		buffer = gfx_alloc_buffer(heap,
+			GFX_MEMORY_READBACK | GFX_MEMORY_WRITE, GFX_BUFFER_NONE,
+			bufferSize);
+
+		if (buffer == NULL) goto clean;
+
+		for (size_t o = 0; o < numOpsUsed; ++o)
+			ops[o].dst = gfx_ref_buffer(buffer);
+
+		if (!gfx_copy_batch(GFX_TRANSFER_BLOCK,
+			numOpsUsed, numDeps, ops, deps))
+		{
+			goto clean_buffer;
+		}
+
+		data = gfx_map(gfx_ref_buffer(buffer));
+		if (data == NULL) goto clean_buffer;
+
+		// Interleave all vertices into place.
+		for (size_t p = 0, o = result->numImages; p < result->numPrimitives; ++p)
+		{
+			GFXPrimitive* prim = result->primitives[p].primitive;
+
+			for (uint32_t a = 0; a < prims[p].numAttributes; ++a, ++o)
+			{
+				const GFXAttribute attrib = gfx_prim_get_attrib(prim, a);
+				const uint32_t elemSize =
+					GFX_FORMAT_BLOCK_SIZE(attrib.format) / CHAR_BIT;
+
+				const unsigned char* span =
+					data + ops[o].dstRegions->offset;
+				unsigned char* vertices =
+					data + prims[p].verOffset +
+					attribs[prims[p].firstAttribute + a].offset;
+
+				for (uint32_t v = 0; v < prims[p].numVertices; ++v)
+					memcpy(vertices + (size_t)v * prims[p].stride,
+						span + (size_t)v * attrib.stride, elemSize);
+			}
+
+			// Skip the index buffer operation.
+			if (prims[p].numIndices > 0) ++o;
+		}
+	}
+
+	// Write the stream.
+	if (
+		gfx_io_write(dst, meta, (size_t)layout.end) != (long long)layout.end ||
+		(dataSize > 0 &&
+		gfx_io_write(dst, data, (size_t)dataSize) != (long long)dataSize))
+	{
+		gfx_log_error("Could not write cooked glTF result to stream.");
+		goto clean_map;
+	}
+
+	if (buffer != NULL)
+	{
+		gfx_unmap(gfx_ref_buffer(buffer));
+		gfx_free_buffer(buffer);
+	}
+
+	free(meta);
+	free(ops);
+
+	return 1;
+
+
+	// Cleanup on failure.
+clean_map:
+	if (data != NULL)
+		gfx_unmap(gfx_ref_buffer(buffer));
+clean_buffer:
+	// The copy blocked, so the buffer is not in use anymore.
+	if (buffer != NULL)
+		gfx_free_buffer(buffer);
+clean:
+	free(meta);
+	free(ops);
+
+	gfx_log_error("Failed to cook glTF result.");
+
+	return 0;
+}
+
+/****************************/
+GFX_API bool gfx_load_scene(GFXHeap* heap, GFXDependency* dep,
+                            const GFXReader* src,
+                            GFXGltfResult* result)
+{
+	assert(heap != NULL);
+	assert(dep != NULL);
+	assert(src != NULL);
+	assert(result != NULL);
+
+	// Allocate source buffer.
+	long long len = gfx_io_len(src);
+	if (len <= 0)
+	{
+		gfx_log_error(
+			"Zero or unknown stream length, cannot load scene source.");
+
+		return 0;
+	}
+
+	// Use the stream's data directly if exposed (e.g. memory-mapped).
+	const unsigned char* source = gfx_io_data(src);
+	void* alloc = NULL;
+
+	if (source == NULL)
+	{
+		alloc = malloc((size_t)len);
+		if (alloc == NULL)
+		{
+			gfx_log_error(
+				"Could not allocate source buffer to load scene source.");
+
+			return 0;
+		}
+
+		// Read source.
+		len = gfx_io_read(src, alloc, (size_t)len);
+		if (len <= 0)
+		{
+			gfx_log_error(
+				"Could not read scene source from stream.");
+
+			free(alloc);
+			return 0;
+		}
+
+		source = alloc;
+	}
+
+	// Validate the header, the source may not be aligned so copy it out.
+	// Note that all descriptors are copied out for the same reason.
+	const uint64_t size = (uint64_t)len;
+	_GFXSceneHeader header;
+
+	if (size < sizeof(header))
+		goto error;
+
+	memcpy(&header, source, sizeof(header));
+
+	if (memcmp(header.magic, _GFX_SCENE_MAGIC, sizeof(header.magic)) != 0)
+		goto error;
+
+	if (
+		header.version != _GFX_SCENE_VERSION ||
+		header.materialSize != sizeof(GFXGltfMaterial) ||
+		header.samplerSize != sizeof(GFXGltfSampler))
+	{
+		gfx_log_error(
+			"Scene source was cooked by an incompatible build.");
+
+		free(alloc);
+		return 0;
+	}
+
+	const _GFXSceneLayout layout = _gfx_scene_layout(&header);
+
+	if (
+		header.dataOffset < layout.end ||
+		header.dataOffset > size ||
+		header.dataSize > size - header.dataOffset)
+	{
+		goto error;
+	}
+
+	// Allocate all output arrays & transfer operations.
+	// Every image is written as one operation,
+	// vertices and indices of each primitive as one operation each.
+	const unsigned char* data = source + header.dataOffset;
+
+	GFXImage** images = NULL;
+	GFXGltfSampler* samplers = NULL;
+	GFXGltfMaterial* materials = NULL;
+	GFXGltfPrimitive* primitives = NULL;
+	GFXGltfMesh* meshes = NULL;
+	GFXWriteOp* ops = NULL;
+
+	size_t numImages = 0;
+	size_t numPrimitives = 0;
+	size_t numMipmaps = 0;
+
+	for (uint32_t i = 0; i < header.numImages; ++i)
+	{
+		_GFXSceneImage image;
+		memcpy(&image,
+			source + layout.images + sizeof(image) * i, sizeof(image));
+
+		numMipmaps += image.mipmaps;
+	}
+
+	const size_t numOps = header.numImages + (size_t)header.numPrimitives * 2;
+	const size_t numRegions = numMipmaps * 2 + (size_t)header.numPrimitives * 4;
+	const size_t numDeps = header.numImages + (size_t)header.numPrimitives;
+
+	if (header.numImages > 0)
+		images = gfx_malloc(sizeof(GFXImage*) * header.numImages);
+	if (header.numSamplers > 0)
+		samplers = gfx_malloc(sizeof(GFXGltfSampler) * header.numSamplers);
+	if (header.numMaterials > 0)
+		materials = gfx_malloc(sizeof(GFXGltfMaterial) * header.numMaterials);
+	if (header.numPrimitives > 0)
+		primitives = gfx_malloc(sizeof(GFXGltfPrimitive) * header.numPrimitives);
+	if (header.numMeshes > 0)
+		meshes = gfx_malloc(sizeof(GFXGltfMesh) * header.numMeshes);
+
+	ops = malloc(
+		sizeof(GFXWriteOp) * numOps +
+		sizeof(GFXRegion) * numRegions +
+		sizeof(GFXInject) * numDeps);
+
+	if (
+		(header.numImages > 0 && images == NULL) ||
+		(header.numSamplers > 0 && samplers == NULL) ||
+		(header.numMaterials > 0 && materials == NULL) ||
+		(header.numPrimitives > 0 && primitives == NULL) ||
+		(header.numMeshes > 0 && meshes == NULL) ||
+		ops == NULL)
+	{
+		gfx_log_error("Could not allocate arrays to load scene source.");
+		goto clean;
+	}
+
+	GFXRegion* regions = (GFXRegion*)(ops + numOps);
+	GFXInject* injs = (GFXInject*)(regions + numRegions);
+
+	size_t numOpsUsed = 0;
+	size_t numRegionsUsed = 0;
+
+	// Allocate all images.
+	for (; numImages < header.numImages; ++numImages)
+	{
+		_GFXSceneImage image;
+		memcpy(&image,
+			source + layout.images + sizeof(image) * numImages, sizeof(image));
+
+		if (
+			GFX_FORMAT_IS_EMPTY(image.format) ||
+			GFX_FORMAT_HAS_DEPTH_OR_STENCIL(image.format) ||
+			image.mipmaps == 0 || image.layers == 0 ||
+			image.width == 0 || image.height == 0 || image.depth == 0)
+		{
+			goto clean_invalid;
+		}
+
+		GFXRegion* bufRegions = regions + numRegionsUsed;
+		GFXRegion* imgRegions = bufRegions + image.mipmaps;
+		numRegionsUsed += image.mipmaps * 2;
+
+		const uint64_t imgSize =
+			_gfx_scene_image_regions(&image, bufRegions, imgRegions);
+
+		if (
+			image.size != imgSize ||
+			image.offset > header.dataSize ||
+			image.size > header.dataSize - image.offset)
+		{
+			goto clean_invalid;
+		}
+
+		GFXImage* img = gfx_alloc_image(heap,
+			(GFXImageType)image.type, GFX_MEMORY_WRITE,
+			(GFXImageUsage)image.usage, image.format,
+			image.mipmaps, image.layers,
+			image.width, image.height, image.depth);
+
+		if (img == NULL) goto clean;
+		images[numImages] = img;
+
+		ops[numOpsUsed++] = (GFXWriteOp){
+			.src = data,
+			.dst = gfx_ref_image(img),
+			.numRegions = image.mipmaps,
+			.srcRegions = bufRegions,
+			.dstRegions = imgRegions
+		};
+
+		const GFXAccessMask mask =
+			((img->usage & GFX_IMAGE_SAMPLED) ||
+			(img->usage & GFX_IMAGE_SAMPLED_LINEAR) ||
+			(img->usage & GFX_IMAGE_SAMPLED_MINMAX) ?
+				GFX_ACCESS_SAMPLED_READ : 0) |
+			((img->usage & GFX_IMAGE_STORAGE) ?
+				GFX_ACCESS_STORAGE_READ_WRITE : 0);
+
+		injs[numImages] =
+			gfx_dep_sigr(dep, mask, GFX_STAGE_ANY, gfx_ref_image(img));
+	}
+
+	// Copy out all samplers & materials, swizzle indices to pointers.
+	if (header.numSamplers > 0)
+		memcpy(samplers, source + layout.samplers,
+			sizeof(GFXGltfSampler) * header.numSamplers);
+
+	for (uint32_t m = 0; m < header.numMaterials; ++m)
+	{
+		memcpy(materials + m,
+			source + layout.materials + sizeof(GFXGltfMaterial) * m,
+			sizeof(GFXGltfMaterial));
+
+		for (size_t t = 0; t < _GFX_SCENE_NUM_TEXTURES; ++t)
+		{
+			_GFXSceneTexture tex;
+			memcpy(&tex,
+				source + layout.textures +
+				sizeof(tex) * (m * _GFX_SCENE_NUM_TEXTURES + t),
+				sizeof(tex));
+
+			if (tex.image > header.numImages || tex.sampler > header.numSamplers)
+				goto clean_invalid;
+
+			*_GFX_SCENE_TEXTURE(materials + m, t) = (GFXGltfTexture){
+				.image = tex.image == 0 ? NULL : images[tex.image - 1],
+				.sampler = tex.sampler == 0 ? NULL : samplers + (tex.sampler - 1)
+			};
+		}
+	}
+
+	// Allocate all primitives, each owns its own buffer.
+	for (; numPrimitives < header.numPrimitives; ++numPrimitives)
+	{
+		_GFXScenePrimitive prim;
+		memcpy(&prim,
+			source + layout.primitives + sizeof(prim) * numPrimitives,
+			sizeof(prim));
+
+		if (
+			prim.numVertices == 0 || prim.numAttributes == 0 ||
+			prim.firstAttribute > header.numAttributes ||
+			prim.numAttributes > header.numAttributes - prim.firstAttribute ||
+			prim.material > header.numMaterials ||
+			(prim.numIndices > 0 &&
+			prim.indexSize != sizeof(uint16_t) &&
+			prim.indexSize != sizeof(uint32_t)))
+		{
+			goto clean_invalid;
+		}
+
+		// Get all attributes, they are interleaved in one buffer.
+		GFXPrimitive* gPrim = NULL;
+
+		{
+			_GFXSceneAttribute attribs[prim.numAttributes];
+			GFXAttribute attributes[prim.numAttributes];
+
+			memcpy(attribs,
+				source + layout.attributes +
+				sizeof(_GFXSceneAttribute) * prim.firstAttribute,
+				sizeof(attribs));
+
+			for (uint32_t a = 0; a < prim.numAttributes; ++a)
+				attributes[a] = (GFXAttribute){
+					.format = attribs[a].format,
+					.offset = attribs[a].offset,
+					.stride = prim.stride,
+					.buffer = GFX_REF_NULL
+				};
+
+			const uint64_t verSize = _gfx_scene_vertices_size(&prim, attribs);
+			const uint64_t indSize = (uint64_t)prim.indexSize * prim.numIndices;
+
+			if (
+				prim.verOffset > header.dataSize ||
+				verSize > header.dataSize - prim.verOffset ||
+				(indSize > 0 &&
+				(prim.indOffset > header.dataSize ||
+				indSize > header.dataSize - prim.indOffset)))
+			{
+				goto clean_invalid;
+			}
+
+			gPrim = gfx_alloc_prim(heap,
+				GFX_MEMORY_WRITE, 0, (GFXTopology)prim.topology,
+				prim.numIndices, (char)prim.indexSize,
+				prim.numVertices,
+				GFX_REF_NULL,
+				prim.numAttributes, attributes);
+
+			if (gPrim == NULL) goto clean;
+
+			primitives[numPrimitives] = (GFXGltfPrimitive){
+				.primitive = gPrim,
+				.material = prim.material == 0 ? NULL :
+					materials + (prim.material - 1)
+			};
+
+			// Write vertices & indices.
+			regions[numRegionsUsed] =
+				(GFXRegion){ .offset = prim.verOffset, .size = verSize };
+			regions[numRegionsUsed + 1] =
+				(GFXRegion){ .offset = 0, .size = verSize };
+
+			ops[numOpsUsed++] = (GFXWriteOp){
+				.src = data,
+				.dst = gfx_ref_prim_vertices(gPrim, 0),
+				.numRegions = 1,
+				.srcRegions = regions + numRegionsUsed,
+				.dstRegions = regions + numRegionsUsed + 1
+			};
+
+			numRegionsUsed += 2;
+
+			if (indSize > 0)
+			{
+				regions[numRegionsUsed] =
+					(GFXRegion){ .offset = prim.indOffset, .size = indSize };
+				regions[numRegionsUsed + 1] =
+					(GFXRegion){ .offset = 0, .size = indSize };
+
+				ops[numOpsUsed++] = (GFXWriteOp){
+					.src = data,
+					.dst = gfx_ref_prim_indices(gPrim),
+					.numRegions = 1,
+					.srcRegions = regions + numRegionsUsed,
+					.dstRegions = regions + numRegionsUsed + 1
+				};
+
+				numRegionsUsed += 2;
+			}
+		}
+
+		// Vertices & indices live in the same buffer.
+		injs[header.numImages + numPrimitives] =
+			gfx_dep_sigr(dep,
+				GFX_ACCESS_VERTEX_READ | GFX_ACCESS_INDEX_READ, GFX_STAGE_ANY,
+				gfx_ref_prim_vertices(gPrim, 0));
+	}
+
+	// Build all meshes.
+	for (uint32_t m = 0; m < header.numMeshes; ++m)
+	{
+		_GFXSceneMesh mesh;
+		memcpy(&mesh,
+			source + layout.meshes + sizeof(mesh) * m, sizeof(mesh));
+
+		if (
+			mesh.firstPrimitive > header.numPrimitives ||
+			mesh.numPrimitives > header.numPrimitives - mesh.firstPrimitive)
+		{
+			goto clean_invalid;
+		}
+
+		meshes[m] = (GFXGltfMesh){
+			.numPrimitives = mesh.numPrimitives,
+			.primitives = mesh.numPrimitives == 0 ? NULL :
+				primitives + mesh.firstPrimitive
+		};
+	}
+
+	// Upload everything in one batch.
+	if (numOpsUsed > 0 && !gfx_write_batch(GFX_TRANSFER_ASYNC,
+		numOpsUsed, numDeps, ops, injs))
+	{
+		goto clean;
+	}
+
+	// Free the source buffer and output the result.
+	free(alloc);
+	free(ops);
+
+	result->numBuffers = 0;
+	result->buffers = NULL;
+
+	result->numImages = header.numImages;
+	result->images = images;
+
+	result->numSamplers = header.numSamplers;
+	result->samplers = samplers;
+
+	result->numMaterials = header.numMaterials;
+	result->materials = materials;
+
+	result->numPrimitives = header.numPrimitives;
+	result->primitives = primitives;
+
+	result->numMeshes = header.numMeshes;
+	result->meshes = meshes;
+
+	return 1;
+
+
+	// Cleanup on failure.
+clean_invalid:
+	gfx_log_error("Scene source is corrupt.");
+clean:
+	// Flush & block the heap so all memory transfers have been completed
+	// and no command buffers reference the resources anymore!
+	gfx_heap_flush(heap);
+	gfx_heap_block(heap);
+
+	for (size_t i = 0; i < numImages; ++i)
+		gfx_free_image(images[i]);
+
+	for (size_t p = 0; p < numPrimitives; ++p)
+		gfx_free_prim(primitives[p].primitive);
+
+	gfx_free(images);
+	gfx_free(samplers);
+	gfx_free(materials);
+	gfx_free(primitives);
+	gfx_free(meshes);
+	free(ops);
+	free(alloc);
+
+	gfx_log_error("Failed to load scene from stream.");
+
+	return 0;
+
+
+	// Invalid source, nothing is allocated.
+error:
+	gfx_log_error("Scene source is not a cooked scene.");
+	free(alloc);
+
+	return 0;
+}
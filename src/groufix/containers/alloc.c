@@ -0,0 +1,239 @@
+/**
+ * This file is part of groufix.
+ * Copyright (c) Stef Velzel. All rights reserved.
+ *
+ * groufix : graphics engine produced by Stef Velzel.
+ * www     : <www.vuzzel.nl>
+ */
+
+#include "groufix/containers/alloc.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// Retrieve the data of a _GFXArenaBlock.
+#define _GFX_GET_DATA(block) \
+	((char*)block + \
+		GFX_ALIGN_UP(sizeof(_GFXArenaBlock), _Alignof(max_align_t)))
+
+
+/****************************
+ * Arena memory block definition.
+ */
+typedef struct _GFXArenaBlock
+{
+	struct _GFXArenaBlock* prev;
+	size_t                 size; // Excluding this header.
+
+} _GFXArenaBlock;
+
+
+/****************************
+ * C library stand-ins for the default allocator.
+ */
+static void* _gfx_std_alloc(size_t size, void* user)
+{
+	(void)user;
+	return malloc(size);
+}
+
+static void* _gfx_std_realloc(void* ptr, size_t size, void* user)
+{
+	(void)user;
+	return realloc(ptr, size);
+}
+
+static void _gfx_std_free(void* ptr, void* user)
+{
+	(void)user;
+	free(ptr);
+}
+
+
+/****************************
+ * The global allocator.
+ */
+static GFXAllocator _gfx_allocator = {
+	.alloc = _gfx_std_alloc,
+	.realloc = _gfx_std_realloc,
+	.free = _gfx_std_free,
+	.user = NULL
+};
+
+
+/****************************
+ * Allocates a new block for an arena, making it the current block.
+ * @return Zero when out of memory.
+ */
+static bool _gfx_arena_block(GFXArena* arena, size_t size)
+{
+	_GFXArenaBlock* block = gfx_malloc(
+		GFX_ALIGN_UP(sizeof(_GFXArenaBlock), _Alignof(max_align_t)) + size);
+
+	if (block == NULL)
+		return 0;
+
+	block->prev = arena->blocks;
+	block->size = size;
+	arena->blocks = block;
+	arena->used = 0;
+
+	return 1;
+}
+
+/****************************
+ * Frees all blocks of an arena.
+ */
+static void _gfx_arena_free(GFXArena* arena)
+{
+	while (arena->blocks != NULL)
+	{
+		_GFXArenaBlock* block = arena->blocks;
+		arena->blocks = block->prev;
+		gfx_free(block);
+	}
+}
+
+/****************************/
+GFX_API void gfx_set_allocator(const GFXAllocator* allocator)
+{
+	if (allocator == NULL)
+		_gfx_allocator = (GFXAllocator){
+			.alloc = _gfx_std_alloc,
+			.realloc = _gfx_std_realloc,
+			.free = _gfx_std_free,
+			.user = NULL
+		};
+	else
+	{
+		assert(allocator->alloc != NULL);
+		assert(allocator->realloc != NULL);
+		assert(allocator->free != NULL);
+
+		_gfx_allocator = *allocator;
+	}
+}
+
+/****************************/
+GFX_API void* gfx_malloc(size_t size)
+{
+	return (_gfx_allocator.alloc)(size, _gfx_allocator.user);
+}
+
+/****************************/
+GFX_API void* gfx_realloc(void* ptr, size_t size)
+{
+	return (_gfx_allocator.realloc)(ptr, size, _gfx_allocator.user);
+}
+
+/****************************/
+GFX_API void gfx_free(void* ptr)
+{
+	(_gfx_allocator.free)(ptr, _gfx_allocator.user);
+}
+
+/****************************/
+GFX_API void gfx_arena_init(GFXArena* arena, size_t blockSize)
+{
+	assert(arena != NULL);
+	assert(blockSize > 0);
+
+	arena->blockSize = GFX_ALIGN_UP(blockSize, _Alignof(max_align_t));
+	arena->blocks = NULL;
+	arena->used = 0;
+	arena->total = 0;
+	arena->last = NULL;
+}
+
+/****************************/
+GFX_API void gfx_arena_clear(GFXArena* arena)
+{
+	assert(arena != NULL);
+
+	_gfx_arena_free(arena);
+	arena->used = 0;
+	arena->total = 0;
+	arena->last = NULL;
+}
+
+/****************************/
+GFX_API void gfx_arena_reset(GFXArena* arena)
+{
+	assert(arena != NULL);
+
+	// If we needed more than one block, merge them into one.
+	// On failure we just end up with no blocks.
+	_GFXArenaBlock* block = arena->blocks;
+	if (block != NULL && block->prev != NULL)
+	{
+		_gfx_arena_free(arena);
+		_gfx_arena_block(arena, GFX_MAX(arena->blockSize, arena->total));
+	}
+
+	arena->used = 0;
+	arena->total = 0;
+	arena->last = NULL;
+}
+
+/****************************/
+GFX_API void* gfx_arena_alloc(GFXArena* arena, size_t size)
+{
+	assert(arena != NULL);
+	assert(size > 0);
+
+	size = GFX_ALIGN_UP(size, _Alignof(max_align_t));
+
+	// Get a new block if it does not fit in the current.
+	_GFXArenaBlock* block = arena->blocks;
+	if (block == NULL || block->size - arena->used < size)
+	{
+		if (!_gfx_arena_block(arena, GFX_MAX(arena->blockSize, size)))
+			return NULL;
+
+		block = arena->blocks;
+	}
+
+	void* ptr = _GFX_GET_DATA(block) + arena->used;
+	arena->used += size;
+	arena->total += size;
+	arena->last = ptr;
+
+	return ptr;
+}
+
+/****************************/
+GFX_API void* gfx_arena_realloc(GFXArena* arena, void* ptr,
+                                size_t oldSize, size_t size)
+{
+	assert(arena != NULL);
+	assert(size > 0);
+
+	if (ptr == NULL)
+		return gfx_arena_alloc(arena, size);
+
+	// If it is the last allocation, try to resize it in place.
+	if (ptr == arena->last)
+	{
+		_GFXArenaBlock* block = arena->blocks;
+		const size_t offset = (size_t)((char*)ptr - _GFX_GET_DATA(block));
+		const size_t aligned = GFX_ALIGN_UP(size, _Alignof(max_align_t));
+
+		if (aligned <= block->size - offset)
+		{
+			arena->total -= arena->used - offset;
+			arena->used = offset + aligned;
+			arena->total += aligned;
+
+			return ptr;
+		}
+	}
+
+	// Otherwise allocate new memory & copy.
+	void* new = gfx_arena_alloc(arena, size);
+	if (new == NULL) return NULL;
+
+	memcpy(new, ptr, GFX_MIN(oldSize, size));
+
+	return new;
+}
@@ -7,8 +7,8 @@
  */
 
 #include "groufix/containers/deque.h"
+#include "groufix/containers/alloc.h"
 #include <assert.h>
-#include <stdlib.h>
 #include <string.h>
 
 
@@ -34,7 +34,7 @@ static bool _gfx_deque_realloc(GFXDeque* deque, size_t capacity)
 	}
 
 	// Actual reallocation sandwiched between the moves.
-	void* new = realloc(deque->data, capacity * deque->elementSize);
+	void* new = gfx_realloc(deque->data, capacity * deque->elementSize);
 	if (new == NULL)
 	{
 		// If we already moved data, move it back...
@@ -123,7 +123,7 @@ GFX_API void gfx_deque_clear(GFXDeque* deque)
 {
 	assert(deque != NULL);
 
-	free(deque->data);
+	gfx_free(deque->data);
 	deque->front = 0;
 	deque->size = 0;
 	deque->capacity = 0;
@@ -6,11 +6,106 @@
  * www     : <www.vuzzel.nl>
  */
 
+#if defined (__linux__)
+	#define _DEFAULT_SOURCE // For pread & syscall.
+#endif
+
 #include "groufix/containers/io.h"
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if defined (GFX_WIN32)
+	#include <windows.h>
+#else
+	#include <errno.h>
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#if defined (__linux__)
+	#include <linux/io_uring.h>
+	#include <sys/syscall.h>
+	#define _GFX_IO_URING
+#endif
+
+
+// Invalid asynchronous file handle.
+#define _GFX_ASYNC_FILE_INVALID ((uintptr_t)-1)
+
+// Maximum number of bytes a single asynchronous read can read.
+#if defined (GFX_WIN32)
+	#define _GFX_READ_MAX ((size_t)MAXDWORD)
+#else
+	#define _GFX_READ_MAX ((size_t)0x7ffff000) // Linux limit.
+#endif
+
+
+#if defined (GFX_WIN32)
+
+/****************************
+ * Overlapped read slot, one for each read in flight.
+ */
+typedef struct _GFXReadSlot
+{
+	OVERLAPPED overlapped; // Owns its event.
+	HANDLE     handle;     // NULL if unused.
+	void*      ptr;
+
+} _GFXReadSlot;
+
+#elif defined (_GFX_IO_URING)
+
+/****************************
+ * io_uring submission & completion rings.
+ */
+typedef struct _GFXRing
+{
+	int fd; // Negative if not available.
+
+	void*  sqMap;
+	void*  cqMap; // May equal sqMap.
+	size_t sqSize;
+	size_t cqSize;
+
+	struct io_uring_sqe* sqes;
+	size_t               sqesSize;
+
+	unsigned* sqTail;
+	unsigned* sqMask;
+	unsigned* sqArray;
+
+	unsigned*            cqHead;
+	unsigned*            cqTail;
+	unsigned*            cqMask;
+	struct io_uring_cqe* cqes;
+
+} _GFXRing;
+
+#endif
+
+
+/****************************
+ * Asynchronous read queue definition.
+ */
+struct GFXReadQueue
+{
+	unsigned int capacity;
+	unsigned int inFlight; // Including numDone.
+
+	// Completions of reads that were performed on push.
+	unsigned int   numDone;
+	GFXReadResult* done;
+
+#if defined (GFX_WIN32)
+	_GFXReadSlot* slots; // Capacity in total.
+#elif defined (_GFX_IO_URING)
+	_GFXRing ring;
+#endif
+};
+
 
 /****************************
  * gfx_io_stdout implementation of the write function.
@@ -57,6 +152,15 @@ static long long _gfx_bin_reader_read(const GFXReader* str, void* data, size_t l
 	return (long long)len;
 }
 
+/****************************
+ * GFXBinReader implementation of the data function.
+ */
+static const void* _gfx_bin_reader_data(const GFXReader* str)
+{
+	GFXBinReader* reader = GFX_IO_OBJ(str, GFXBinReader, reader);
+	return reader->bin;
+}
+
 /****************************
  * GFXStringReader implementation of the len function.
  */
@@ -128,6 +232,40 @@ static long long _gfx_file_read(const GFXReader* str, void* data, size_t len)
 	return ferror(file->handle) ? -1 : (long long)ret;
 }
 
+/****************************
+ * GFXMappedFile implementation of the len function.
+ */
+static long long _gfx_mapped_file_len(const GFXReader* str)
+{
+	GFXMappedFile* file = GFX_IO_OBJ(str, GFXMappedFile, reader);
+	return (long long)file->len;
+}
+
+/****************************
+ * GFXMappedFile implementation of the read function.
+ */
+static long long _gfx_mapped_file_read(const GFXReader* str, void* data, size_t len)
+{
+	GFXMappedFile* file = GFX_IO_OBJ(str, GFXMappedFile, reader);
+
+	// Read all bytes, same as GFXBinReader, but without position reset.
+	len = GFX_MIN(len, file->len - file->pos);
+
+	memcpy(data, ((const char*)file->map) + file->pos, len);
+	file->pos += len;
+
+	return (long long)len;
+}
+
+/****************************
+ * GFXMappedFile implementation of the data function.
+ */
+static const void* _gfx_mapped_file_data(const GFXReader* str)
+{
+	GFXMappedFile* file = GFX_IO_OBJ(str, GFXMappedFile, reader);
+	return file->map;
+}
+
 /****************************
  * GFXFile implementation of the write function.
  */
@@ -141,30 +279,42 @@ static long long _gfx_file_write(const GFXWriter* str, const void* data, size_t
 }
 
 /****************************
- * GFXFileIncluder implementation of the resolve function.
+ * Appends a URI to the directory of an includer's path.
+ * @return Must call free() on success!
  */
-static const GFXReader* _gfx_file_includer_resolve(const GFXIncluder* inc, const char* uri)
+static char* _gfx_includer_path(const char* base, const char* uri)
 {
-	GFXFileIncluder* includer = GFX_IO_OBJ(inc, GFXFileIncluder, includer);
-
-	// Append the URI to the includer's path.
-	char* path = malloc(strlen(includer->path) + strlen(uri) + 1);
+	char* path = malloc(strlen(base) + strlen(uri) + 1);
 	if (path == NULL) return NULL;
 
-	const char* s0 = strrchr(includer->path, '/');
-	const char* s1 = strrchr(includer->path, '\\');
+	const char* s0 = strrchr(base, '/');
+	const char* s1 = strrchr(base, '\\');
 	const char* s = s0 ? (s1 && s1 > s0 ? s1 : s0) : s1;
 
 	if (!s)
 		strcpy(path, uri);
 	else
 	{
-		size_t prefix = (size_t)(s - includer->path) + 1;
+		size_t prefix = (size_t)(s - base) + 1;
 
-		strncpy(path, includer->path, prefix);
+		strncpy(path, base, prefix);
 		strcpy(path + prefix, uri);
 	}
 
+	return path;
+}
+
+/****************************
+ * GFXFileIncluder implementation of the resolve function.
+ */
+static const GFXReader* _gfx_file_includer_resolve(const GFXIncluder* inc, const char* uri)
+{
+	GFXFileIncluder* includer = GFX_IO_OBJ(inc, GFXFileIncluder, includer);
+
+	// Append the URI to the includer's path.
+	char* path = _gfx_includer_path(includer->path, uri);
+	if (path == NULL) return NULL;
+
 	// Allocate & initialize the file reader stream.
 	GFXFile* file = malloc(sizeof(GFXFile));
 	if (file == NULL || !gfx_file_init(file, path, "r"))
@@ -189,6 +339,253 @@ static void _gfx_file_includer_release(const GFXIncluder* inc, const GFXReader*
 	free(file);
 }
 
+/****************************
+ * GFXMappedIncluder implementation of the resolve function.
+ */
+static const GFXReader* _gfx_mapped_includer_resolve(const GFXIncluder* inc, const char* uri)
+{
+	GFXMappedIncluder* includer = GFX_IO_OBJ(inc, GFXMappedIncluder, includer);
+
+	// Append the URI to the includer's path.
+	char* path = _gfx_includer_path(includer->path, uri);
+	if (path == NULL) return NULL;
+
+	// Allocate & initialize the memory-mapped file reader stream.
+	GFXMappedFile* file = malloc(sizeof(GFXMappedFile));
+	if (file == NULL || !gfx_mapped_file_init(file, path))
+	{
+		free(file);
+		free(path);
+		return NULL;
+	}
+
+	free(path);
+	return &file->reader;
+}
+
+/****************************
+ * GFXMappedIncluder implementation of the release function.
+ */
+static void _gfx_mapped_includer_release(const GFXIncluder* inc, const GFXReader* str)
+{
+	GFXMappedFile* file = GFX_IO_OBJ(str, GFXMappedFile, reader);
+
+	gfx_mapped_file_clear(file);
+	free(file);
+}
+
+
+#if defined (_GFX_IO_URING)
+
+/****************************
+ * Sets up io_uring rings.
+ * @param ring    Cannot be NULL, fd is negative on failure.
+ * @param entries Must be > 0.
+ * @return Non-zero on success.
+ */
+static bool _gfx_ring_init(_GFXRing* ring, unsigned int entries)
+{
+	assert(ring != NULL);
+	assert(entries > 0);
+
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+
+	ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+	if (ring->fd < 0) return 0;
+
+	ring->sqMap = MAP_FAILED;
+	ring->cqMap = MAP_FAILED;
+	ring->sqes = MAP_FAILED;
+
+	// Map the rings, they can share a mapping if the kernel allows.
+	ring->sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring->cqSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+
+	const bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+	if (single)
+		ring->sqSize = ring->cqSize = GFX_MAX(ring->sqSize, ring->cqSize);
+
+	ring->sqMap = mmap(NULL, ring->sqSize,
+		PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, IORING_OFF_SQ_RING);
+
+	if (ring->sqMap == MAP_FAILED) goto clean;
+
+	ring->cqMap = single ? ring->sqMap : mmap(NULL, ring->cqSize,
+		PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, IORING_OFF_CQ_RING);
+
+	if (ring->cqMap == MAP_FAILED) goto clean;
+
+	ring->sqes = mmap(NULL, ring->sqesSize,
+		PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, IORING_OFF_SQES);
+
+	if (ring->sqes == MAP_FAILED) goto clean;
+
+	// Get all ring pointers.
+	char* sq = ring->sqMap;
+	char* cq = ring->cqMap;
+
+	ring->sqTail = (unsigned*)(sq + params.sq_off.tail);
+	ring->sqMask = (unsigned*)(sq + params.sq_off.ring_mask);
+	ring->sqArray = (unsigned*)(sq + params.sq_off.array);
+
+	ring->cqHead = (unsigned*)(cq + params.cq_off.head);
+	ring->cqTail = (unsigned*)(cq + params.cq_off.tail);
+	ring->cqMask = (unsigned*)(cq + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+	return 1;
+
+
+	// Cleanup on failure.
+clean:
+	if (ring->cqMap != MAP_FAILED && ring->cqMap != ring->sqMap)
+		munmap(ring->cqMap, ring->cqSize);
+	if (ring->sqMap != MAP_FAILED)
+		munmap(ring->sqMap, ring->sqSize);
+
+	close(ring->fd);
+	ring->fd = -1;
+
+	return 0;
+}
+
+/****************************
+ * Tears down io_uring rings.
+ * @param ring Cannot be NULL, fd must not be negative.
+ */
+static void _gfx_ring_clear(_GFXRing* ring)
+{
+	assert(ring != NULL);
+	assert(ring->fd >= 0);
+
+	munmap(ring->sqes, ring->sqesSize);
+
+	if (ring->cqMap != ring->sqMap)
+		munmap(ring->cqMap, ring->cqSize);
+
+	munmap(ring->sqMap, ring->sqSize);
+	close(ring->fd);
+}
+
+#endif
+
+#if !defined (GFX_WIN32)
+
+/****************************
+ * Reads from an asynchronous file on the calling thread.
+ * @return Number of bytes read, -1 on failure.
+ */
+static long long _gfx_async_file_read(const GFXAsyncFile* file,
+                                      uint64_t offset, size_t len, void* data)
+{
+	ssize_t ret;
+
+	do ret = pread((int)file->handle, data, len, (off_t)offset);
+	while (ret < 0 && errno == EINTR);
+
+	return ret < 0 ? -1 : (long long)ret;
+}
+
+#endif
+
+/****************************
+ * Retrieves completed reads that were performed by the OS.
+ * @param wait Non-zero to block until at least one read has completed.
+ * @return Number of completions written to results.
+ */
+static size_t _gfx_read_queue_poll(GFXReadQueue* queue, bool wait,
+                                   size_t max, GFXReadResult* results)
+{
+	size_t num = 0;
+
+#if defined (GFX_WIN32)
+	while (num == 0 && max > 0 && queue->inFlight > queue->numDone)
+	{
+		// Check all slots in flight.
+		for (unsigned int s = 0; s < queue->capacity && num < max; ++s)
+		{
+			_GFXReadSlot* slot = queue->slots + s;
+			if (slot->handle == NULL) continue;
+
+			DWORD ret;
+			long long len;
+
+			if (GetOverlappedResult(slot->handle, &slot->overlapped, &ret, FALSE))
+				len = (long long)ret;
+			else if (GetLastError() == ERROR_IO_INCOMPLETE)
+				continue;
+			else
+				len = (GetLastError() == ERROR_HANDLE_EOF) ? 0 : -1;
+
+			results[num++] = (GFXReadResult){ .ptr = slot->ptr, .len = len };
+			slot->handle = NULL;
+			--queue->inFlight;
+		}
+
+		if (num > 0 || !wait) break;
+
+		// Nothing completed, wait on (at most) the maximum number of events.
+		HANDLE events[MAXIMUM_WAIT_OBJECTS];
+		DWORD numEvents = 0;
+
+		for (unsigned int s = 0;
+			s < queue->capacity && numEvents < MAXIMUM_WAIT_OBJECTS; ++s)
+		{
+			if (queue->slots[s].handle != NULL)
+				events[numEvents++] = queue->slots[s].overlapped.hEvent;
+		}
+
+		WaitForMultipleObjects(numEvents, events, FALSE, INFINITE);
+	}
+
+#elif defined (_GFX_IO_URING)
+	_GFXRing* ring = &queue->ring;
+
+	while (ring->fd >= 0 && max > 0 && queue->inFlight > queue->numDone)
+	{
+		// Consume all completion queue entries up to max.
+		unsigned head = *ring->cqHead;
+		const unsigned tail = atomic_load_explicit(
+			(_Atomic unsigned*)ring->cqTail, memory_order_acquire);
+
+		for (; head != tail && num < max; ++head)
+		{
+			const struct io_uring_cqe* cqe = ring->cqes + (head & *ring->cqMask);
+
+			results[num++] = (GFXReadResult){
+				.ptr = (void*)(uintptr_t)cqe->user_data,
+				.len = cqe->res < 0 ? -1 : (long long)cqe->res
+			};
+
+			--queue->inFlight;
+		}
+
+		atomic_store_explicit(
+			(_Atomic unsigned*)ring->cqHead, head, memory_order_release);
+
+		if (num > 0 || !wait) break;
+
+		// Nothing completed, wait for at least one completion.
+		if (syscall(__NR_io_uring_enter, ring->fd,
+			0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR)
+		{
+			break;
+		}
+	}
+
+#else
+	// No OS reads in flight, everything is performed on push.
+	(void)queue;
+	(void)wait;
+	(void)max;
+	(void)results;
+#endif
+
+	return num;
+}
+
 
 /****************************/
 const GFXWriter gfx_io_stdout =
@@ -275,6 +672,7 @@ GFX_API GFXReader* gfx_bin_reader(GFXBinReader* str, size_t len, const void* bin
 
 	str->reader.len = _gfx_bin_reader_len;
 	str->reader.read = _gfx_bin_reader_read;
+	str->reader.data = _gfx_bin_reader_data;
 
 	str->len = len;
 	str->pos = 0;
@@ -291,6 +689,7 @@ GFX_API GFXReader* gfx_string_reader(GFXStringReader* str, const char* string)
 
 	str->reader.len = _gfx_string_reader_len;
 	str->reader.read = _gfx_string_reader_read;
+	str->reader.data = NULL;
 
 	str->pos = 0;
 	str->str = string;
@@ -307,6 +706,7 @@ GFX_API bool gfx_file_init(GFXFile* file, const char* name, const char* mode)
 
 	file->reader.len = _gfx_file_len;
 	file->reader.read = _gfx_file_read;
+	file->reader.data = NULL;
 	file->writer.write = _gfx_file_write;
 
 	file->handle = fopen(name, mode);
@@ -326,6 +726,107 @@ GFX_API void gfx_file_clear(GFXFile* file)
 	}
 }
 
+/****************************/
+GFX_API bool gfx_mapped_file_init(GFXMappedFile* file, const char* name)
+{
+	assert(file != NULL);
+	assert(name != NULL);
+
+	file->reader.len = _gfx_mapped_file_len;
+	file->reader.read = _gfx_mapped_file_read;
+	file->reader.data = _gfx_mapped_file_data;
+
+	file->len = 0;
+	file->pos = 0;
+	file->map = NULL;
+
+	// Open the file, get its length & map it.
+	// Once mapped, the file itself can be closed, the mapping stays.
+	// Empty files cannot be mapped, so we leave map at NULL.
+#if defined (GFX_WIN32)
+	HANDLE handle = CreateFileA(
+		name, GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (handle == INVALID_HANDLE_VALUE)
+		return 0;
+
+	LARGE_INTEGER len;
+	if (!GetFileSizeEx(handle, &len) || len.QuadPart < 0)
+	{
+		CloseHandle(handle);
+		return 0;
+	}
+
+	file->len = (size_t)len.QuadPart;
+
+	if (file->len > 0)
+	{
+		HANDLE mapping = CreateFileMappingA(
+			handle, NULL, PAGE_READONLY, 0, 0, NULL);
+
+		if (mapping != NULL)
+			file->map = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0),
+			CloseHandle(mapping);
+
+		if (file->map == NULL)
+		{
+			CloseHandle(handle);
+			return 0;
+		}
+	}
+
+	CloseHandle(handle);
+#else
+	int fd = open(name, O_RDONLY);
+	if (fd < 0) return 0;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < 0)
+	{
+		close(fd);
+		return 0;
+	}
+
+	file->len = (size_t)st.st_size;
+
+	if (file->len > 0)
+	{
+		void* map = mmap(NULL, file->len, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map == MAP_FAILED)
+		{
+			close(fd);
+			return 0;
+		}
+
+		file->map = map;
+	}
+
+	close(fd);
+#endif
+
+	return 1;
+}
+
+/****************************/
+GFX_API void gfx_mapped_file_clear(GFXMappedFile* file)
+{
+	assert(file != NULL);
+
+	if (file->map != NULL)
+	{
+#if defined (GFX_WIN32)
+		UnmapViewOfFile(file->map);
+#else
+		munmap((void*)file->map, file->len);
+#endif
+		file->map = NULL;
+	}
+
+	file->len = 0;
+	file->pos = 0;
+}
+
 /****************************/
 GFX_API bool gfx_file_includer_init(GFXFileIncluder* inc, const char* path)
 {
@@ -356,3 +857,297 @@ GFX_API void gfx_file_includer_clear(GFXFileIncluder* inc)
 		inc->path = NULL;
 	}
 }
+
+/****************************/
+GFX_API bool gfx_mapped_includer_init(GFXMappedIncluder* inc, const char* path)
+{
+	assert(inc != NULL);
+	assert(path != NULL);
+
+	inc->includer.resolve = _gfx_mapped_includer_resolve;
+	inc->includer.release = _gfx_mapped_includer_release;
+
+	// Allocate new memory to store the path.
+	inc->path = malloc(strlen(path) + 1);
+	if (inc->path == NULL) return 0;
+
+	// Copy path into it.
+	strcpy(inc->path, path);
+
+	return 1;
+}
+
+/****************************/
+GFX_API void gfx_mapped_includer_clear(GFXMappedIncluder* inc)
+{
+	assert(inc != NULL);
+
+	if (inc->path != NULL)
+	{
+		free(inc->path);
+		inc->path = NULL;
+	}
+}
+
+/****************************/
+GFX_API bool gfx_async_file_init(GFXAsyncFile* file, const char* name)
+{
+	assert(file != NULL);
+	assert(name != NULL);
+
+	file->handle = _GFX_ASYNC_FILE_INVALID;
+	file->len = 0;
+
+	// Open the file for overlapped access where required & get its length.
+#if defined (GFX_WIN32)
+	HANDLE handle = CreateFileA(
+		name, GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, NULL);
+
+	if (handle == INVALID_HANDLE_VALUE)
+		return 0;
+
+	LARGE_INTEGER len;
+	if (!GetFileSizeEx(handle, &len) || len.QuadPart < 0)
+	{
+		CloseHandle(handle);
+		return 0;
+	}
+
+	file->handle = (uintptr_t)handle;
+	file->len = (uint64_t)len.QuadPart;
+#else
+	int fd = open(name, O_RDONLY);
+	if (fd < 0) return 0;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < 0)
+	{
+		close(fd);
+		return 0;
+	}
+
+	file->handle = (uintptr_t)fd;
+	file->len = (uint64_t)st.st_size;
+#endif
+
+	return 1;
+}
+
+/****************************/
+GFX_API void gfx_async_file_clear(GFXAsyncFile* file)
+{
+	assert(file != NULL);
+
+	if (file->handle != _GFX_ASYNC_FILE_INVALID)
+	{
+#if defined (GFX_WIN32)
+		CloseHandle((HANDLE)file->handle);
+#else
+		close((int)file->handle);
+#endif
+		file->handle = _GFX_ASYNC_FILE_INVALID;
+	}
+
+	file->len = 0;
+}
+
+/****************************/
+GFX_API GFXReadQueue* gfx_create_read_queue(unsigned int capacity)
+{
+	assert(capacity > 0);
+
+	// Allocate a new queue with its completion storage.
+	GFXReadQueue* queue = malloc(
+		sizeof(GFXReadQueue) + sizeof(GFXReadResult) * capacity);
+
+	if (queue == NULL)
+		return NULL;
+
+	queue->capacity = capacity;
+	queue->inFlight = 0;
+	queue->numDone = 0;
+	queue->done = (GFXReadResult*)(queue + 1);
+
+	// Set up OS reads, io_uring can be absent or disallowed,
+	// in which case we silently fall back to reading on push.
+#if defined (GFX_WIN32)
+	queue->slots = malloc(sizeof(_GFXReadSlot) * capacity);
+	if (queue->slots == NULL)
+	{
+		free(queue);
+		return NULL;
+	}
+
+	for (unsigned int s = 0; s < capacity; ++s)
+	{
+		memset(&queue->slots[s].overlapped, 0, sizeof(OVERLAPPED));
+		queue->slots[s].handle = NULL;
+		queue->slots[s].ptr = NULL;
+
+		queue->slots[s].overlapped.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+		if (queue->slots[s].overlapped.hEvent == NULL)
+		{
+			while (s > 0) CloseHandle(queue->slots[--s].overlapped.hEvent);
+			free(queue->slots);
+			free(queue);
+			return NULL;
+		}
+	}
+#elif defined (_GFX_IO_URING)
+	_gfx_ring_init(&queue->ring, capacity);
+#endif
+
+	return queue;
+}
+
+/****************************/
+GFX_API void gfx_destroy_read_queue(GFXReadQueue* queue)
+{
+	if (queue == NULL)
+		return;
+
+	// Wait for all reads in flight, the OS might still write to them.
+	GFXReadResult results[16];
+	while (queue->inFlight > queue->numDone)
+		if (_gfx_read_queue_poll(queue, 1, 16, results) == 0)
+			break;
+
+#if defined (GFX_WIN32)
+	for (unsigned int s = 0; s < queue->capacity; ++s)
+		CloseHandle(queue->slots[s].overlapped.hEvent);
+
+	free(queue->slots);
+#elif defined (_GFX_IO_URING)
+	if (queue->ring.fd >= 0)
+		_gfx_ring_clear(&queue->ring);
+#endif
+
+	free(queue);
+}
+
+/****************************/
+GFX_API bool gfx_read_queue_push(GFXReadQueue* queue, const GFXAsyncFile* file,
+                                 uint64_t offset, size_t len, void* data,
+                                 void* ptr)
+{
+	assert(queue != NULL);
+	assert(file != NULL);
+	assert(file->handle != _GFX_ASYNC_FILE_INVALID);
+	assert(data != NULL);
+
+	if (queue->inFlight >= queue->capacity)
+		return 0;
+
+	len = GFX_MIN(len, _GFX_READ_MAX);
+
+#if defined (GFX_WIN32)
+	// Find a free slot & issue an overlapped read.
+	_GFXReadSlot* slot = queue->slots;
+	while (slot->handle != NULL) ++slot;
+
+	slot->overlapped.Internal = 0;
+	slot->overlapped.InternalHigh = 0;
+	slot->overlapped.Offset = (DWORD)offset;
+	slot->overlapped.OffsetHigh = (DWORD)(offset >> 32);
+	ResetEvent(slot->overlapped.hEvent);
+
+	if (
+		!ReadFile((HANDLE)file->handle, data, (DWORD)len, NULL, &slot->overlapped) &&
+		GetLastError() != ERROR_IO_PENDING)
+	{
+		// Reading past the end completes immediately.
+		if (GetLastError() != ERROR_HANDLE_EOF)
+			return 0;
+
+		queue->done[queue->numDone++] = (GFXReadResult){ .ptr = ptr, .len = 0 };
+		++queue->inFlight;
+
+		return 1;
+	}
+
+	slot->handle = (HANDLE)file->handle;
+	slot->ptr = ptr;
+	++queue->inFlight;
+
+	return 1;
+
+#else
+#if defined (_GFX_IO_URING)
+	_GFXRing* ring = &queue->ring;
+
+	if (ring->fd >= 0)
+	{
+		// Fill a submission queue entry, we are the only producer.
+		const unsigned tail = *ring->sqTail;
+		const unsigned index = tail & *ring->sqMask;
+
+		struct io_uring_sqe* sqe = ring->sqes + index;
+		memset(sqe, 0, sizeof(struct io_uring_sqe));
+
+		sqe->opcode = IORING_OP_READ;
+		sqe->fd = (int)file->handle;
+		sqe->addr = (uint64_t)(uintptr_t)data;
+		sqe->len = (uint32_t)len;
+		sqe->off = offset;
+		sqe->user_data = (uint64_t)(uintptr_t)ptr;
+
+		ring->sqArray[index] = index;
+		atomic_store_explicit(
+			(_Atomic unsigned*)ring->sqTail, tail + 1, memory_order_release);
+
+		// Submit it, on failure the kernel did not consume the entry.
+		long ret;
+		do ret = syscall(__NR_io_uring_enter, ring->fd, 1, 0, 0, NULL, 0);
+		while (ret < 0 && errno == EINTR);
+
+		if (ret != 1)
+		{
+			atomic_store_explicit(
+				(_Atomic unsigned*)ring->sqTail, tail, memory_order_release);
+
+			return 0;
+		}
+
+		++queue->inFlight;
+
+		return 1;
+	}
+#endif
+
+	// Fall back to reading right now.
+	const long long ret = _gfx_async_file_read(file, offset, len, data);
+
+	queue->done[queue->numDone++] = (GFXReadResult){ .ptr = ptr, .len = ret };
+	++queue->inFlight;
+
+	return 1;
+#endif
+}
+
+/****************************/
+GFX_API size_t gfx_read_queue_poll(GFXReadQueue* queue, bool wait,
+                                   size_t max, GFXReadResult* results)
+{
+	assert(queue != NULL);
+	assert(max == 0 || results != NULL);
+
+	// First output reads that were performed on push.
+	size_t num = GFX_MIN(max, queue->numDone);
+
+	if (num > 0)
+	{
+		queue->numDone -= (unsigned int)num;
+		queue->inFlight -= (unsigned int)num;
+
+		memcpy(results, queue->done + queue->numDone,
+			sizeof(GFXReadResult) * num);
+	}
+
+	// Then output whatever the OS has completed.
+	// Only wait if nothing was output yet.
+	num += _gfx_read_queue_poll(
+		queue, wait && num == 0, max - num, results + num);
+
+	return num;
+}
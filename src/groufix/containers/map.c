@@ -7,12 +7,38 @@
  */
 
 #include "groufix/containers/map.h"
+#include "groufix/containers/alloc.h"
 #include <assert.h>
-#include <stdlib.h>
 #include <string.h>
 
+#if defined (__SSE2__) || defined (_M_X64) || \
+	(defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define _GFX_MAP_SSE2
+#elif defined (__ARM_NEON) && defined (__aarch64__)
+	#include <arm_neon.h>
+	#define _GFX_MAP_NEON
+#endif
 
-#define _GFX_MAP_LOAD_FACTOR 0.75 // Must be reasonably > 0.5 .. !
+
+// Control byte values, full slots store the lower 7 bits of the hash.
+// Empty & deleted both have their top bit set, full slots never do.
+#define _GFX_MAP_EMPTY   0x80
+#define _GFX_MAP_DELETED 0xfe
+
+// Number of slots probed at once, capacity is always a multiple of this.
+#define _GFX_MAP_GROUP 16
+
+// Maximum load (including deleted slots) = _GFX_MAP_LOAD / 8.
+#define _GFX_MAP_LOAD 7
+
+// Get the 'index' hash (H1) and 'control' hash (H2) from a full hash.
+#define _GFX_MAP_H1(hash) ((size_t)((hash) >> 7))
+#define _GFX_MAP_H2(hash) ((uint8_t)((hash) & 0x7f))
+
+// Retrieve the control bytes of a map.
+#define _GFX_MAP_CTRL(map) \
+	((uint8_t*)(map->slots + map->capacity))
 
 // Retrieve the _GFXMapNode from a public element pointer.
 #define _GFX_GET_NODE(map, element) \
@@ -31,66 +57,239 @@
 
 
 /****************************
- * Hashtable bucket's node definition.
+ * Hashtable node definition.
+ * Nodes are still allocated individually, as their address must be constant,
+ * the table itself only stores control bytes and pointers to the nodes.
  */
 typedef struct _GFXMapNode
 {
-	struct _GFXMapNode* next;
-	uint64_t            hash;
+	uint64_t hash;
+	size_t   slot; // Index into the table it is currently stored in.
 
 } _GFXMapNode;
 
 
 /****************************
- * Allocates a new block of memory with a given capacity and moves
- * the content of the entire map to this new block of memory.
+ * Returns the index of the lowest set bit of a non-zero mask.
  */
-static bool _gfx_map_realloc(GFXMap* map, size_t capacity)
+static inline unsigned _gfx_map_ctz(uint32_t mask)
 {
-	assert(capacity > 0);
+	assert(mask != 0);
+
+#if defined (__GNUC__) || defined (__clang__)
+	return (unsigned)__builtin_ctz(mask);
+#else
+	unsigned i = 0;
+	while (!(mask & 1)) mask >>= 1, ++i;
+	return i;
+#endif
+}
 
-	void** new = malloc(capacity * sizeof(void*));
-	if (new == NULL) return 0;
+/****************************
+ * Matches a group of control bytes against a single byte value.
+ * @param ctrl Must point to _GFX_MAP_GROUP control bytes.
+ * @return Bitmask, bit i is set if control byte i equals byte.
+ */
+static inline uint32_t _gfx_map_match(const uint8_t* ctrl, uint8_t byte)
+{
+#if defined (_GFX_MAP_SSE2)
+	const __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+	return (uint32_t)_mm_movemask_epi8(
+		_mm_cmpeq_epi8(group, _mm_set1_epi8((char)byte)));
+
+#elif defined (_GFX_MAP_NEON)
+	static const uint8_t bits[16] = {
+		1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
 
-	// Firstly, set all buckets to NULL.
-	for (size_t i = 0; i < capacity; ++i) new[i] = NULL;
+	const uint8x16_t eq = vandq_u8(
+		vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(byte)), vld1q_u8(bits));
 
-	// Move all nodes to the new memory block.
-	for (size_t i = 0; i < map->capacity; ++i)
-		while (map->buckets[i] != NULL)
+	return
+		(uint32_t)vaddv_u8(vget_low_u8(eq)) |
+		((uint32_t)vaddv_u8(vget_high_u8(eq)) << 8);
+
+#else
+	uint32_t mask = 0;
+	for (unsigned i = 0; i < _GFX_MAP_GROUP; ++i)
+		mask |= (uint32_t)(ctrl[i] == byte) << i;
+
+	return mask;
+#endif
+}
+
+/****************************
+ * Matches a group of control bytes against all free (empty or deleted) slots.
+ * @see _gfx_map_match.
+ */
+static inline uint32_t _gfx_map_match_free(const uint8_t* ctrl)
+{
+#if defined (_GFX_MAP_SSE2)
+	// Free slots are exactly those with the top bit set.
+	return (uint32_t)_mm_movemask_epi8(
+		_mm_loadu_si128((const __m128i*)ctrl));
+
+#elif defined (_GFX_MAP_NEON)
+	static const uint8_t bits[16] = {
+		1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+
+	const uint8x16_t top = vandq_u8(
+		vcltzq_s8(vreinterpretq_s8_u8(vld1q_u8(ctrl))), vld1q_u8(bits));
+
+	return
+		(uint32_t)vaddv_u8(vget_low_u8(top)) |
+		((uint32_t)vaddv_u8(vget_high_u8(top)) << 8);
+
+#else
+	uint32_t mask = 0;
+	for (unsigned i = 0; i < _GFX_MAP_GROUP; ++i)
+		mask |= (uint32_t)(ctrl[i] >> 7) << i;
+
+	return mask;
+#endif
+}
+
+/****************************
+ * Computes the slot index to start probing at for the i-th probe,
+ * uses triangular probing over aligned groups, which visits all groups
+ * exactly once within the first (capacity / _GFX_MAP_GROUP) probes.
+ */
+static inline size_t _gfx_map_probe(GFXMap* map, uint64_t hash, size_t i)
+{
+	const size_t groups = map->capacity / _GFX_MAP_GROUP;
+	return ((_GFX_MAP_H1(hash) + ((i * (i + 1)) >> 1)) & (groups - 1)) *
+		_GFX_MAP_GROUP;
+}
+
+/****************************
+ * Stores a node in the first free slot of its probe sequence.
+ * Does not check the load of the map (or any other bookkeeping but deleted)!
+ */
+static void _gfx_map_place(GFXMap* map, _GFXMapNode* mNode)
+{
+	assert(map->capacity > 0);
+
+	uint8_t* ctrl = _GFX_MAP_CTRL(map);
+	const size_t groups = map->capacity / _GFX_MAP_GROUP;
+
+	for (size_t i = 0; i < groups; ++i)
+	{
+		const size_t g = _gfx_map_probe(map, mNode->hash, i);
+		const uint32_t avail = _gfx_map_match_free(ctrl + g);
+
+		if (avail)
 		{
-			// Remove it from the map.
-			_GFXMapNode* mNode = map->buckets[i];
-			map->buckets[i] = mNode->next;
-
-			// Stick it in new.
-			const uint64_t hInd = mNode->hash % capacity;
-			mNode->next = new[hInd];
-			new[hInd] = mNode;
+			const size_t s = g + _gfx_map_ctz(avail);
+			map->deleted -= (ctrl[s] == _GFX_MAP_DELETED);
+
+			ctrl[s] = _GFX_MAP_H2(mNode->hash);
+			map->slots[s] = mNode;
+			mNode->slot = s;
+
+			return;
 		}
+	}
+
+	// The load factor guarantees a free slot.
+	assert(0);
+}
+
+/****************************
+ * Finds the first full slot at or after a given slot index.
+ * @return Slot index, map->capacity if none found.
+ */
+static size_t _gfx_map_find_full(GFXMap* map, size_t slot)
+{
+	if (slot >= map->capacity)
+		return map->capacity;
+
+	const uint8_t* ctrl = _GFX_MAP_CTRL(map);
+
+	// Finish the group slot is in (by masking out the lower slots),
+	// then continue group by group.
+	size_t g = GFX_ALIGN_DOWN(slot, (size_t)_GFX_MAP_GROUP);
+	uint32_t skip = ((uint32_t)1 << (slot - g)) - 1;
+
+	for (; g < map->capacity; g += _GFX_MAP_GROUP, skip = 0)
+	{
+		const uint32_t full =
+			~(_gfx_map_match_free(ctrl + g) | skip) &
+			(((uint32_t)1 << _GFX_MAP_GROUP) - 1);
+
+		if (full) return g + _gfx_map_ctz(full);
+	}
+
+	return map->capacity;
+}
+
+/****************************
+ * Marks the slot of a node as deleted, without touching any other slot.
+ */
+static inline void _gfx_map_unplace(GFXMap* map, _GFXMapNode* mNode)
+{
+	_GFX_MAP_CTRL(map)[mNode->slot] = _GFX_MAP_DELETED;
+	map->slots[mNode->slot] = NULL;
+	++map->deleted;
+}
+
+/****************************
+ * Allocates a new table with a given capacity and moves
+ * the content of the entire map to this new table, dropping deleted slots.
+ */
+static bool _gfx_map_realloc(GFXMap* map, size_t capacity)
+{
+	assert(capacity >= _GFX_MAP_GROUP);
+	assert(GFX_IS_POWER_OF_TWO(capacity));
+
+	// Allocate slots and control bytes in one block.
+	void** new = gfx_malloc(capacity * (sizeof(void*) + sizeof(uint8_t)));
+	if (new == NULL) return 0;
+
+	void** oldSlots = map->slots;
+	const size_t oldCapacity = map->capacity;
 
-	free(map->buckets);
 	map->capacity = capacity;
-	map->buckets = new;
+	map->deleted = 0;
+	map->slots = new;
+
+	// Firstly, set all slots to empty.
+	memset(_GFX_MAP_CTRL(map), _GFX_MAP_EMPTY, capacity);
+
+	// Move all nodes to the new table.
+	for (size_t s = 0; s < oldCapacity; ++s)
+		if (!(((const uint8_t*)(oldSlots + oldCapacity))[s] & 0x80))
+			_gfx_map_place(map, oldSlots[s]);
+
+	gfx_free(oldSlots);
 
 	return 1;
 }
 
 /****************************
- * Increases the capacity such that it satisfies a minimum.
+ * Computes the minimum capacity that can hold a number of nodes.
+ */
+static size_t _gfx_map_capacity(size_t numNodes)
+{
+	size_t cap = _GFX_MAP_GROUP;
+	while (numNodes > (cap / 8) * _GFX_MAP_LOAD) cap <<= 1;
+
+	return cap;
+}
+
+/****************************
+ * Increases the capacity such that it satisfies a minimum,
+ * also purges deleted slots if only they would exceed the load.
  */
 static bool _gfx_map_grow(GFXMap* map, size_t minNodes)
 {
 	// Calculate the maximum load we can bare and check against it...
-	if (minNodes <= ((double)map->capacity * _GFX_MAP_LOAD_FACTOR))
+	// Deleted slots count towards the load, as they lengthen probing.
+	if (minNodes + map->deleted <= (map->capacity / 8) * _GFX_MAP_LOAD)
 		return 1;
 
-	// Keep multiplying capacity by 2 until we have enough.
-	// We start at enough nodes for a minimum load factor of 1/4th!
-	size_t cap = (map->capacity > 0) ? map->capacity << 1 : 4;
-	while (minNodes > ((double)cap * _GFX_MAP_LOAD_FACTOR)) cap <<= 1;
-
-	return _gfx_map_realloc(map, cap);
+	// Rehash to at least the current capacity,
+	// this is where we get rid of our deleted slots.
+	return _gfx_map_realloc(map,
+		GFX_MAX(_gfx_map_capacity(minNodes), map->capacity));
 }
 
 /****************************
@@ -106,16 +305,21 @@ static void _gfx_map_shrink(GFXMap* map)
 	}
 
 	// If we have more nodes than capacity/4, don't shrink.
+	// Unless more than a quarter of all slots are deleted.
 	size_t cap = map->capacity >> 1;
 
-	if (map->size < (cap >> 1))
+	if (map->size < (cap >> 1) && cap >= _GFX_MAP_GROUP)
 	{
 		// Otherwise, shrink back down to capacity/2.
 		// Keep dividing by 2 if we can, much like a vector :)
-		while (map->size < (cap >> 2)) cap >>= 1;
+		while (map->size < (cap >> 2) && (cap >> 1) >= _GFX_MAP_GROUP)
+			cap >>= 1;
 
 		_gfx_map_realloc(map, cap);
 	}
+
+	else if (map->deleted > (map->capacity >> 2))
+		_gfx_map_realloc(map, map->capacity);
 }
 
 /****************************
@@ -139,28 +343,9 @@ static bool _gfx_map_move(GFXMap* map, GFXMap* dst, const void* node,
 	if (map != dst && !_gfx_map_grow(dst, dst->size + 1))
 		return 0;
 
-	// Use stored hash to get index to the bucket!
-	uint64_t hInd = mNode->hash % map->capacity;
-
-	// Remove it from the source map similarly to gfx_map_erase.
-	// By finding the node BEFORE the one to erase.
-	_GFXMapNode* bNode = map->buckets[hInd];
-
-	if (bNode == mNode)
-		map->buckets[hInd] = mNode->next;
-
-	else for (
-		// Note: bNode cannot be NULL, as node must be valid!
-		_GFXMapNode* curr = bNode->next;
-		curr != NULL;
-		bNode = curr, curr = bNode->next)
-	{
-		if (curr == mNode)
-		{
-			bNode->next = mNode->next;
-			break;
-		}
-	}
+	// Remove it from the source map, only marks its slot as deleted,
+	// so the position of all other nodes remains the same.
+	_gfx_map_unplace(map, mNode);
 
 	--map->size;
 	++dst->size;
@@ -177,16 +362,17 @@ static bool _gfx_map_move(GFXMap* map, GFXMap* dst, const void* node,
 		// API does not allow passing a hash, but meh.
 		mNode->hash = dst->hash(_GFX_GET_KEY(dst, mNode));
 
-	hInd = mNode->hash % dst->capacity;
-	mNode->next = dst->buckets[hInd];
-	dst->buckets[hInd] = mNode;
+	// If moving within the same map, this may reuse the slot just deleted,
+	// which is fine, there is always one free.
+	_gfx_map_place(dst, mNode);
 
 	// We do actually deallocate the source if it's empty.
 	if (map->size == 0)
 	{
-		free(map->buckets);
+		gfx_free(map->slots);
 		map->capacity = 0;
-		map->buckets = NULL;
+		map->deleted = 0;
+		map->slots = NULL;
 	}
 
 	return 1;
@@ -203,8 +389,9 @@ GFX_API void gfx_map_init(GFXMap* map, size_t elemSize,
 
 	map->size = 0;
 	map->capacity = 0;
+	map->deleted = 0;
 	map->elementSize = elemSize;
-	map->buckets = NULL;
+	map->slots = NULL;
 
 	map->hash = hash;
 	map->cmp = cmp;
@@ -216,19 +403,14 @@ GFX_API void gfx_map_clear(GFXMap* map)
 	assert(map != NULL);
 
 	// Free all nodes.
-	for (size_t i = 0; i < map->capacity; ++i)
-		while (map->buckets[i] != NULL)
-		{
-			_GFXMapNode* mNode = map->buckets[i];
-			map->buckets[i] = mNode->next;
+	for (size_t s = 0; s < map->capacity; ++s)
+		if (!(_GFX_MAP_CTRL(map)[s] & 0x80)) gfx_free(map->slots[s]);
 
-			free(mNode);
-		}
-
-	free(map->buckets);
+	gfx_free(map->slots);
 	map->size = 0;
 	map->capacity = 0;
-	map->buckets = NULL;
+	map->deleted = 0;
+	map->slots = NULL;
 }
 
 /****************************/
@@ -261,29 +443,26 @@ GFX_API bool gfx_map_merge(GFXMap* map, GFXMap* src)
 		return 0;
 
 	// Move all nodes from the source to the destination map.
-	for (size_t i = 0; i < src->capacity; ++i)
-		while (src->buckets[i] != NULL)
+	for (size_t s = 0; s < src->capacity; ++s)
+		if (!(_GFX_MAP_CTRL(src)[s] & 0x80))
 		{
-			// Remove it from the map.
-			_GFXMapNode* mNode = src->buckets[i];
-			src->buckets[i] = mNode->next;
+			_GFXMapNode* mNode = src->slots[s];
 
 			// Stick it in destination.
 			// We rehash if we use a different hash function!
 			if (src->hash != map->hash)
 				mNode->hash = map->hash(_GFX_GET_KEY(map, mNode));
 
-			const uint64_t hInd = mNode->hash % map->capacity;
-			mNode->next = map->buckets[hInd];
-			map->buckets[hInd] = mNode;
+			_gfx_map_place(map, mNode);
 		}
 
 	map->size += src->size;
 
-	free(src->buckets);
+	gfx_free(src->slots);
 	src->size = 0;
 	src->capacity = 0;
-	src->buckets = NULL;
+	src->deleted = 0;
+	src->slots = NULL;
 
 	return 1;
 }
@@ -356,7 +535,7 @@ GFX_API void* gfx_map_hinsert(GFXMap* map, const void* elem,
 	// Allocate a new node.
 	// We allocate a _GFXMapNode appended with the element and key data,
 	// make sure to align for any scalar type!
-	_GFXMapNode* mNode = malloc(
+	_GFXMapNode* mNode = gfx_malloc(
 		GFX_ALIGN_UP(sizeof(_GFXMapNode), _Alignof(max_align_t)) +
 		GFX_ALIGN_UP(map->elementSize, _Alignof(max_align_t)) +
 		keySize);
@@ -368,7 +547,7 @@ GFX_API void* gfx_map_hinsert(GFXMap* map, const void* elem,
 	// We do this last of all to avoid unnecessary growth.
 	if (!_gfx_map_grow(map, map->size + 1))
 	{
-		free(mNode);
+		gfx_free(mNode);
 		return NULL;
 	}
 
@@ -381,10 +560,8 @@ GFX_API void* gfx_map_hinsert(GFXMap* map, const void* elem,
 	memcpy(_GFX_GET_KEY(map, mNode), key, keySize);
 
 	// Insert node.
-	const uint64_t hInd = hash % map->capacity;
-	mNode->next = map->buckets[hInd];
 	mNode->hash = hash;
-	map->buckets[hInd] = mNode;
+	_gfx_map_place(map, mNode);
 
 	return _GFX_GET_ELEMENT(map, mNode);
 }
@@ -406,21 +583,35 @@ GFX_API void* gfx_map_hsearch(GFXMap* map, const void* key, uint64_t hash)
 
 	if (map->capacity == 0) return NULL;
 
-	// Hash & search :)
-	const uint64_t hInd = hash % map->capacity;
+	// Hash & probe group by group :)
+	// Only slots with matching control bytes are ever dereferenced.
+	const uint8_t* ctrl = _GFX_MAP_CTRL(map);
+	const size_t groups = map->capacity / _GFX_MAP_GROUP;
+	const uint8_t h2 = _GFX_MAP_H2(hash);
 
-	for (
-		_GFXMapNode* mNode = map->buckets[hInd];
-		mNode != NULL;
-		mNode = mNode->next)
+	for (size_t i = 0; i < groups; ++i)
 	{
-		if (
-			// First compare raw hash for faster comparisons.
-			hash == mNode->hash &&
-			map->cmp(key, _GFX_GET_KEY(map, mNode)) == 0)
+		const size_t g = _gfx_map_probe(map, hash, i);
+
+		for (
+			uint32_t match = _gfx_map_match(ctrl + g, h2);
+			match != 0;
+			match &= match - 1)
 		{
-			return _GFX_GET_ELEMENT(map, mNode);
+			_GFXMapNode* mNode = map->slots[g + _gfx_map_ctz(match)];
+
+			if (
+				// First compare raw hash for faster comparisons.
+				hash == mNode->hash &&
+				map->cmp(key, _GFX_GET_KEY(map, mNode)) == 0)
+			{
+				return _GFX_GET_ELEMENT(map, mNode);
+			}
 		}
+
+		// An empty slot terminates the probe sequence.
+		if (_gfx_map_match(ctrl + g, _GFX_MAP_EMPTY))
+			break;
 	}
 
 	return NULL;
@@ -431,12 +622,11 @@ GFX_API void* gfx_map_first(GFXMap* map)
 {
 	assert(map != NULL);
 
-	// First the first non-empty bucket.
-	for (size_t i = 0; i < map->capacity; ++i)
-		if (map->buckets[i] != NULL)
-			return _GFX_GET_ELEMENT(map, map->buckets[i]);
+	// Find the first full slot.
+	const size_t s = _gfx_map_find_full(map, 0);
 
-	return NULL;
+	return s < map->capacity ?
+		_GFX_GET_ELEMENT(map, (_GFXMapNode*)map->slots[s]) : NULL;
 }
 
 /****************************/
@@ -448,18 +638,11 @@ GFX_API void* gfx_map_next(GFXMap* map, const void* node)
 
 	_GFXMapNode* mNode = _GFX_GET_NODE(map, node);
 
-	// First see if there's a next node in the bucket.
-	if (mNode->next != NULL)
-		return _GFX_GET_ELEMENT(map, mNode->next);
-
-	// Use stored hash to get index to the bucket!
-	const uint64_t hInd = mNode->hash % map->capacity;
+	// Use stored slot to continue from!
+	const size_t s = _gfx_map_find_full(map, mNode->slot + 1);
 
-	for (size_t i = (size_t)hInd + 1; i < map->capacity; ++i)
-		if (map->buckets[i] != NULL)
-			return _GFX_GET_ELEMENT(map, map->buckets[i]);
-
-	return NULL;
+	return s < map->capacity ?
+		_GFX_GET_ELEMENT(map, (_GFXMapNode*)map->slots[s]) : NULL;
 }
 
 /****************************/
@@ -467,23 +650,45 @@ GFX_API void* gfx_map_next_equal(GFXMap* map, const void* node)
 {
 	assert(map != NULL);
 	assert(node != NULL);
+	assert(map->capacity > 0);
 
 	_GFXMapNode* mNode = _GFX_GET_NODE(map, node);
 
 	// To compare equal, hash must be equal.
-	// Which means we only need to look in the same bucket.
-	for (
-		_GFXMapNode* curr = mNode->next;
-		curr != NULL;
-		curr = curr->next)
+	// Which means we only need to follow the same probe sequence,
+	// returning the first match found after the node itself.
+	const uint8_t* ctrl = _GFX_MAP_CTRL(map);
+	const size_t groups = map->capacity / _GFX_MAP_GROUP;
+	const uint8_t h2 = _GFX_MAP_H2(mNode->hash);
+	bool found = 0;
+
+	for (size_t i = 0; i < groups; ++i)
 	{
-		if (
-			// First compare raw hash for faster comparisons.
-			curr->hash == mNode->hash &&
-			map->cmp(_GFX_GET_KEY(map, curr), _GFX_GET_KEY(map, mNode)) == 0)
+		const size_t g = _gfx_map_probe(map, mNode->hash, i);
+
+		for (
+			uint32_t match = _gfx_map_match(ctrl + g, h2);
+			match != 0;
+			match &= match - 1)
 		{
-			return _GFX_GET_ELEMENT(map, curr);
+			const size_t s = g + _gfx_map_ctz(match);
+			_GFXMapNode* curr = map->slots[s];
+
+			if (!found)
+				found = (s == mNode->slot);
+
+			else if (
+				// First compare raw hash for faster comparisons.
+				curr->hash == mNode->hash &&
+				map->cmp(_GFX_GET_KEY(map, curr), _GFX_GET_KEY(map, mNode)) == 0)
+			{
+				return _GFX_GET_ELEMENT(map, curr);
+			}
 		}
+
+		// An empty slot terminates the probe sequence.
+		if (_gfx_map_match(ctrl + g, _GFX_MAP_EMPTY))
+			break;
 	}
 
 	return NULL;
@@ -509,36 +714,10 @@ GFX_API void gfx_map_ferase(GFXMap* map, const void* node)
 
 	_GFXMapNode* mNode = _GFX_GET_NODE(map, node);
 
-	// Use stored hash to get index again.
-	const uint64_t hInd = mNode->hash % map->capacity;
-
-	// So this is a bit annoying,
-	// we need to find the node BEFORE the one we want to erase.
-	// If it happens to be the first, just replace with the next.
-	_GFXMapNode* bNode = map->buckets[hInd];
-	if (bNode == mNode)
-	{
-		map->buckets[hInd] = mNode->next;
-		free(mNode);
-
-		--map->size;
-	}
-
-	// Otherwise, keep walking the chain to find it.
-	// Note: bNode cannot be NULL, as node (and therefore hInd) must be valid!
-	else for (
-		_GFXMapNode* curr = bNode->next;
-		curr != NULL;
-		bNode = curr, curr = bNode->next)
-	{
-		// When found, make the node before it point to the next.
-		if (curr == mNode)
-		{
-			bNode->next = mNode->next;
-			free(mNode);
+	// Only mark its slot as deleted,
+	// so the position of all other nodes remains the same.
+	_gfx_map_unplace(map, mNode);
+	gfx_free(mNode);
 
-			--map->size;
-			break;
-		}
-	}
+	--map->size;
 }
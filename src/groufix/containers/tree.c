@@ -7,8 +7,8 @@
  */
 
 #include "groufix/containers/tree.h"
+#include "groufix/containers/alloc.h"
 #include <assert.h>
-#include <stdlib.h>
 #include <string.h>
 
 
@@ -402,7 +402,7 @@ GFX_API void* gfx_tree_insert(GFXTree* tree, size_t elemSize, const void* elem,
 	// Allocate a new node.
 	// We allocate a _GFXTreeNode appended with the key and element data,
 	// make sure to align for any scalar type!
-	_GFXTreeNode* tNode = malloc(
+	_GFXTreeNode* tNode = gfx_malloc(
 		GFX_ALIGN_UP(sizeof(_GFXTreeNode), _Alignof(max_align_t)) +
 		GFX_ALIGN_UP(tree->keySize, _Alignof(max_align_t)) +
 		elemSize);
@@ -563,5 +563,5 @@ GFX_API void gfx_tree_erase(GFXTree* tree, void* node)
 	_GFXTreeNode* tNode = _GFX_GET_NODE(tree, node);
 	_gfx_tree_erase(tree, tNode);
 
-	free(tNode);
+	gfx_free(tNode);
 }
@@ -8,7 +8,6 @@
 
 #include "groufix/containers/vec.h"
 #include <assert.h>
-#include <stdlib.h>
 #include <string.h>
 
 
@@ -24,7 +23,7 @@ static bool _gfx_vec_grow(GFXVec* vec, size_t minCapacity)
 		size_t cap = (vec->capacity > 0) ? vec->capacity << 1 : 1;
 		while (cap < minCapacity) cap <<= 1;
 
-		void* new = realloc(vec->data, cap * vec->elementSize);
+		void* new = gfx_realloc(vec->data, cap * vec->elementSize);
 		if (new == NULL) return 0;
 
 		vec->capacity = cap;
@@ -56,7 +55,7 @@ static void _gfx_vec_shrink(GFXVec* vec)
 		// Each division we check if we have less elements than capacity/4.
 		while (vec->size <= (cap >> 2)) cap >>= 1;
 
-		void* new = realloc(vec->data, cap * vec->elementSize);
+		void* new = gfx_realloc(vec->data, cap * vec->elementSize);
 		if (new == NULL) return;
 
 		vec->capacity = cap;
@@ -82,7 +81,7 @@ GFX_API void gfx_vec_clear(GFXVec* vec)
 {
 	assert(vec != NULL);
 
-	free(vec->data);
+	gfx_free(vec->data);
 	vec->size = 0;
 	vec->capacity = 0;
 	vec->data = NULL;
@@ -98,7 +97,7 @@ GFX_API bool gfx_vec_reserve(GFXVec* vec, size_t numElems)
 		// Here we actually allocate the given size exactly,
 		// we do not round up to a power of 2.
 		// In case it never grows beyond this requested capacity.
-		void* new = realloc(vec->data, numElems * vec->elementSize);
+		void* new = gfx_realloc(vec->data, numElems * vec->elementSize);
 		if (new == NULL) return 0;
 
 		vec->capacity = numElems;
@@ -10,9 +10,11 @@
 #ifndef _GFX_CORE_H
 #define _GFX_CORE_H
 
+#include "groufix/containers/deque.h"
 #include "groufix/containers/io.h"
 #include "groufix/containers/list.h"
 #include "groufix/containers/vec.h"
+#include "groufix/core/jobs.h"
 #include "groufix/core/threads.h"
 #include "groufix.h"
 
@@ -56,6 +58,10 @@
 			action; \
 	} while (0)
 
+// Device mask of all physical devices in the device group of a context.
+#define _GFX_CONTEXT_DEVICES(context) \
+	((uint32_t)(((uint64_t)1 << (context)->numDevices) - 1))
+
 // Resolves a constrained input/output format and assigns it to another lvalue.
 #define _GFX_RESOLVE_FORMAT(ioFmt, vkFmt, device, props, action) \
 	do { \
@@ -66,6 +72,28 @@
 	} while (0)
 
 
+/**
+ * Thread local sub-allocation cache of a heap.
+ */
+typedef struct _GFXThreadSlabs
+{
+	uintmax_t heap;  // Unique heap id.
+	void*     cache; // Of type _GFXSlabCache*, owned by the heap.
+
+} _GFXThreadSlabs;
+
+
+/**
+ * Thread local ring of an asynchronous log.
+ */
+typedef struct _GFXThreadRing
+{
+	uintmax_t log;  // Unique asynchronous log id.
+	void*     ring; // Of type _GFXLogRing*, owned by the log.
+
+} _GFXThreadRing;
+
+
 /**
  * Thread local data.
  */
@@ -74,12 +102,32 @@ typedef struct _GFXThreadState
 	uintmax_t id;
 
 
+	// Heap data.
+	struct
+	{
+		GFXVec slabs; // Stores _GFXThreadSlabs, most recently created last.
+
+	} heap;
+
+
+	// Job system data.
+	struct
+	{
+		_GFXJobWorker* worker; // NULL if not a worker thread.
+
+	} jobs;
+
+
 	// Logging data.
 	struct
 	{
 		GFXLogLevel level;
 		const GFXWriter* out;
 
+		// Rings of the asynchronous logs written to.
+		GFXVec rings; // Stores _GFXThreadRing, most recently created last.
+		void*  life;  // Of type _GFXLogLife*, NULL if no rings yet.
+
 	} log;
 
 } _GFXThreadState;
@@ -92,8 +140,10 @@ typedef struct _GFXState
 {
 	atomic_bool initialized;
 
-	// Only pre-initialized field besides `initialized`.
-	GFXLogLevel logDef;
+	// Only pre-initialized fields besides `initialized`.
+	GFXLogLevel  logDef;
+	unsigned int workersDef;
+	bool         headlessDef;
 
 	GFXVec  devices;  // Stores _GFXDevice (never changes, so not dynamic).
 	GFXList contexts; // References _GFXContext.
@@ -117,6 +167,26 @@ typedef struct _GFXState
 	} thread;
 
 
+	// Job system.
+	struct
+	{
+		size_t         numWorkers;
+		size_t         started; // Workers [0, started) have a thread.
+		_GFXJobWorker* workers;
+
+		GFXDeque  queue; // Stores _GFXJob*, submitted by non-workers.
+		_GFXMutex lock;  // For queue & wake.
+		_GFXCond  wake;  // Signaled when epoch changes.
+
+		atomic_size_t queued;   // Jobs in all deques & queue.
+		atomic_size_t shared;   // Jobs in queue.
+		atomic_size_t epoch;    // Increased on job push, counter zero & stop.
+		atomic_size_t sleepers; // Threads blocked on wake.
+		atomic_bool   stop;
+
+	} jobs;
+
+
 	// Vulkan fields.
 	struct
 	{
@@ -135,9 +205,7 @@ typedef struct _GFXState
 		_GFX_VK_PFN(CreateDevice);
 		_GFX_VK_PFN(DestroyInstance);
 		_GFX_VK_PFN(DestroySurfaceKHR);
-#if defined (GFX_USE_VK_SUBSET_DEVICES)
 		_GFX_VK_PFN(EnumerateDeviceExtensionProperties);
-#endif
 		_GFX_VK_PFN(EnumeratePhysicalDeviceGroups);
 		_GFX_VK_PFN(EnumeratePhysicalDevices);
 		_GFX_VK_PFN(GetDeviceProcAddr);
@@ -145,6 +213,7 @@ typedef struct _GFXState
 		_GFX_VK_PFN(GetPhysicalDeviceFeatures2);
 		_GFX_VK_PFN(GetPhysicalDeviceFormatProperties);
 		_GFX_VK_PFN(GetPhysicalDeviceMemoryProperties);
+		_GFX_VK_PFN(GetPhysicalDeviceMemoryProperties2);
 		_GFX_VK_PFN(GetPhysicalDeviceProperties);
 		_GFX_VK_PFN(GetPhysicalDeviceProperties2);
 		_GFX_VK_PFN(GetPhysicalDeviceQueueFamilyProperties);
@@ -213,7 +282,17 @@ typedef struct _GFXContext
 	enum
 	{
 		_GFX_SUPPORT_GEOMETRY_SHADER     = 0x0001,
-		_GFX_SUPPORT_TESSELLATION_SHADER = 0x0002
+		_GFX_SUPPORT_TESSELLATION_SHADER = 0x0002,
+		_GFX_SUPPORT_MEMORY_BUDGET       = 0x0004,
+		_GFX_SUPPORT_TIMELINE_SEMAPHORE  = 0x0008,
+		_GFX_SUPPORT_SYNCHRONIZATION2    = 0x0010,
+		_GFX_SUPPORT_PIPELINE_STATISTICS = 0x0020,
+		_GFX_SUPPORT_DRAW_INDIRECT_COUNT = 0x0040,
+		_GFX_SUPPORT_EXTENDED_DYNAMIC_STATE = 0x0080,
+		_GFX_SUPPORT_PIPELINE_LIBRARY       = 0x0100,
+		_GFX_SUPPORT_DESCRIPTOR_INDEXING    = 0x0200,
+		_GFX_SUPPORT_PUSH_DESCRIPTOR        = 0x0400,
+		_GFX_SUPPORT_PRESENT_WAIT           = 0x0800
 
 	} features;
 
@@ -236,9 +315,24 @@ typedef struct _GFXContext
 		// Allocated shaders.
 		atomic_uintptr_t shaders;
 
+		// Push descriptor limit, 0 if not supported.
+		uint32_t maxPushDescriptors;
+
 	} limits;
 
 
+#if !defined (NDEBUG)
+	// Barrier statistics (debug only), logged on destruction.
+	struct
+	{
+		atomic_uintmax_t pushed;  // #memory barriers pushed.
+		atomic_uintmax_t merged;  // #memory barriers merged into another.
+		atomic_uintmax_t flushes; // #vkCmdPipelineBarrier calls.
+
+	} barriers;
+#endif
+
+
 	// Vulkan fields.
 	struct
 	{
@@ -251,6 +345,7 @@ typedef struct _GFXContext
 		_GFX_VK_PFN(BeginCommandBuffer);
 		_GFX_VK_PFN(BindBufferMemory);
 		_GFX_VK_PFN(BindImageMemory);
+		_GFX_VK_PFN(CmdBeginQuery);
 		_GFX_VK_PFN(CmdBeginRenderPass);
 		_GFX_VK_PFN(CmdBindDescriptorSets);
 		_GFX_VK_PFN(CmdBindIndexBuffer);
@@ -267,14 +362,39 @@ typedef struct _GFXContext
 		_GFX_VK_PFN(CmdDraw);
 		_GFX_VK_PFN(CmdDrawIndexed);
 		_GFX_VK_PFN(CmdDrawIndexedIndirect);
+		_GFX_VK_PFN(CmdDrawIndexedIndirectCount); // May be NULL.
 		_GFX_VK_PFN(CmdDrawIndirect);
+		_GFX_VK_PFN(CmdDrawIndirectCount); // May be NULL.
+		_GFX_VK_PFN(CmdEndQuery);
 		_GFX_VK_PFN(CmdEndRenderPass);
 		_GFX_VK_PFN(CmdExecuteCommands);
+		_GFX_VK_PFN(CmdNextSubpass);
 		_GFX_VK_PFN(CmdPipelineBarrier);
+		_GFX_VK_PFN(CmdPipelineBarrier2KHR); // May be NULL.
 		_GFX_VK_PFN(CmdPushConstants);
+		_GFX_VK_PFN(CmdPushDescriptorSetWithTemplateKHR); // May be NULL.
+		_GFX_VK_PFN(CmdResetEvent);
+		_GFX_VK_PFN(CmdResetQueryPool);
 		_GFX_VK_PFN(CmdResolveImage);
+		_GFX_VK_PFN(CmdSetBlendConstants);
+		_GFX_VK_PFN(CmdSetCullModeEXT);              // May be NULL.
+		_GFX_VK_PFN(CmdSetDepthBounds);
+		_GFX_VK_PFN(CmdSetDepthBoundsTestEnableEXT); // May be NULL.
+		_GFX_VK_PFN(CmdSetDepthCompareOpEXT);        // May be NULL.
+		_GFX_VK_PFN(CmdSetDepthTestEnableEXT);       // May be NULL.
+		_GFX_VK_PFN(CmdSetDepthWriteEnableEXT);      // May be NULL.
+		_GFX_VK_PFN(CmdSetDeviceMask);
+		_GFX_VK_PFN(CmdSetEvent);
+		_GFX_VK_PFN(CmdSetFrontFaceEXT);             // May be NULL.
 		_GFX_VK_PFN(CmdSetViewport);
 		_GFX_VK_PFN(CmdSetScissor);
+		_GFX_VK_PFN(CmdSetStencilCompareMask);
+		_GFX_VK_PFN(CmdSetStencilOpEXT);             // May be NULL.
+		_GFX_VK_PFN(CmdSetStencilReference);
+		_GFX_VK_PFN(CmdSetStencilTestEnableEXT);     // May be NULL.
+		_GFX_VK_PFN(CmdSetStencilWriteMask);
+		_GFX_VK_PFN(CmdWaitEvents);
+		_GFX_VK_PFN(CmdWriteTimestamp);
 		_GFX_VK_PFN(CreateBuffer);
 		_GFX_VK_PFN(CreateBufferView);
 		_GFX_VK_PFN(CreateCommandPool);
@@ -282,6 +402,7 @@ typedef struct _GFXContext
 		_GFX_VK_PFN(CreateDescriptorPool);
 		_GFX_VK_PFN(CreateDescriptorSetLayout);
 		_GFX_VK_PFN(CreateDescriptorUpdateTemplate);
+		_GFX_VK_PFN(CreateEvent);
 		_GFX_VK_PFN(CreateFence);
 		_GFX_VK_PFN(CreateFramebuffer);
 		_GFX_VK_PFN(CreateGraphicsPipelines);
@@ -289,6 +410,7 @@ typedef struct _GFXContext
 		_GFX_VK_PFN(CreateImageView);
 		_GFX_VK_PFN(CreatePipelineCache);
 		_GFX_VK_PFN(CreatePipelineLayout);
+		_GFX_VK_PFN(CreateQueryPool);
 		_GFX_VK_PFN(CreateRenderPass);
 		_GFX_VK_PFN(CreateSampler);
 		_GFX_VK_PFN(CreateSemaphore);
@@ -301,6 +423,7 @@ typedef struct _GFXContext
 		_GFX_VK_PFN(DestroyDescriptorSetLayout);
 		_GFX_VK_PFN(DestroyDescriptorUpdateTemplate);
 		_GFX_VK_PFN(DestroyDevice);
+		_GFX_VK_PFN(DestroyEvent);
 		_GFX_VK_PFN(DestroyFence);
 		_GFX_VK_PFN(DestroyFramebuffer);
 		_GFX_VK_PFN(DestroyImage);
@@ -308,6 +431,7 @@ typedef struct _GFXContext
 		_GFX_VK_PFN(DestroyPipeline);
 		_GFX_VK_PFN(DestroyPipelineCache);
 		_GFX_VK_PFN(DestroyPipelineLayout);
+		_GFX_VK_PFN(DestroyQueryPool);
 		_GFX_VK_PFN(DestroyRenderPass);
 		_GFX_VK_PFN(DestroySampler);
 		_GFX_VK_PFN(DestroySemaphore);
@@ -315,6 +439,7 @@ typedef struct _GFXContext
 		_GFX_VK_PFN(DestroySwapchainKHR);
 		_GFX_VK_PFN(DeviceWaitIdle);
 		_GFX_VK_PFN(EndCommandBuffer);
+		_GFX_VK_PFN(FlushMappedMemoryRanges);
 		_GFX_VK_PFN(FreeCommandBuffers);
 		_GFX_VK_PFN(FreeMemory);
 		_GFX_VK_PFN(GetBufferMemoryRequirements);
@@ -324,7 +449,10 @@ typedef struct _GFXContext
 		_GFX_VK_PFN(GetImageMemoryRequirements);
 		_GFX_VK_PFN(GetImageMemoryRequirements2);
 		_GFX_VK_PFN(GetPipelineCacheData);
+		_GFX_VK_PFN(GetQueryPoolResults);
+		_GFX_VK_PFN(GetSemaphoreCounterValue); // May be NULL.
 		_GFX_VK_PFN(GetSwapchainImagesKHR);
+		_GFX_VK_PFN(InvalidateMappedMemoryRanges);
 		_GFX_VK_PFN(MapMemory);
 		_GFX_VK_PFN(MergePipelineCaches);
 		_GFX_VK_PFN(QueuePresentKHR);
@@ -333,8 +461,11 @@ typedef struct _GFXContext
 		_GFX_VK_PFN(ResetDescriptorPool);
 		_GFX_VK_PFN(ResetFences);
 		_GFX_VK_PFN(UnmapMemory);
+		_GFX_VK_PFN(UpdateDescriptorSets);
 		_GFX_VK_PFN(UpdateDescriptorSetWithTemplate);
 		_GFX_VK_PFN(WaitForFences);
+		_GFX_VK_PFN(WaitForPresentKHR); // May be NULL.
+		_GFX_VK_PFN(WaitSemaphores); // May be NULL.
 
 	} vk;
 
@@ -363,6 +494,19 @@ typedef struct _GFXDevice
 	bool         subset; // If it is a non-conformant Vulkan implementation.
 #endif
 
+	// Supported optional device extensions.
+	enum
+	{
+		_GFX_EXT_MEMORY_BUDGET       = 0x0001,
+		_GFX_EXT_SYNCHRONIZATION2    = 0x0002,
+		_GFX_EXT_DRAW_INDIRECT_COUNT = 0x0004,
+		_GFX_EXT_EXTENDED_DYNAMIC_STATE = 0x0008,
+		_GFX_EXT_PIPELINE_LIBRARY       = 0x0010, // Both KHR & EXT.
+		_GFX_EXT_PUSH_DESCRIPTOR        = 0x0020,
+		_GFX_EXT_PRESENT_WAIT           = 0x0040  // Both id & wait.
+
+	} extensions;
+
 	_GFXContext* context;
 	_GFXMutex    lock; // For initial context access.
 
@@ -394,6 +538,17 @@ typedef struct _GFXMonitor
 } _GFXMonitor;
 
 
+/**
+ * Retired swapchain (left behind when recreated).
+ */
+typedef struct _GFXRetired
+{
+	VkSwapchainKHR swapchain;
+	unsigned int   frame; // Virtual frame index to purge at, UINT_MAX if any.
+
+} _GFXRetired;
+
+
 /**
  * Internal window.
  */
@@ -417,6 +572,7 @@ typedef struct _GFXWindow
 		VkFormat format;
 		uint32_t width;
 		uint32_t height;
+		uint64_t present; // Last present id of vk.swapchain (0 for none).
 
 		// Recreate signal.
 		atomic_bool recreate;
@@ -436,7 +592,7 @@ typedef struct _GFXWindow
 		VkSurfaceKHR   surface;
 		VkSwapchainKHR swapchain;
 		VkSwapchainKHR oldSwapchain; // Must be VK_NULL_HANDLE if swapchain is not.
-		GFXVec         retired;      // Stores VkSwapchainKHR.
+		GFXVec         retired;      // Stores _GFXRetired.
 
 	} vk;
 
@@ -494,6 +650,15 @@ void _gfx_destroy_local(void);
  */
 _GFXThreadState* _gfx_get_local(void);
 
+/**
+ * Detaches thread local state from all asynchronous logs,
+ * so they can retire its rings once drained.
+ * @param state Cannot be NULL.
+ *
+ * Called by _gfx_destroy_local, the state may not log afterwards.
+ */
+void _gfx_log_detach(_GFXThreadState* state);
+
 
 /****************************
  * Devices, monitors and Vulkan contexts.
@@ -696,6 +861,7 @@ uint32_t _gfx_swapchain_acquire(_GFXWindow* window, VkSemaphore available,
  * @param num      Number of input and output params, must be > 0.
  * @param windows  Must all share the same Vulkan context.
  * @param indices  Must be indices retrieved by _gfx_swapchain_acquire.
+ * @param ids      Outputs the present id of each swapchain (if supported).
  * @param flags    Outputs how the swapchains have been recreated.
  *
  * Not thread-affine, but also not thread-safe.
@@ -704,7 +870,7 @@ uint32_t _gfx_swapchain_acquire(_GFXWindow* window, VkSemaphore available,
 void _gfx_swapchains_present(_GFXQueue present, VkSemaphore rendered,
                              size_t num,
                              _GFXWindow** windows, const uint32_t* indices,
-                             _GFXRecreateFlags* flags);
+                             uint64_t* ids, _GFXRecreateFlags* flags);
 
 /**
  * Destroys all retired swapchain images that are left behind when the
@@ -716,6 +882,24 @@ void _gfx_swapchains_present(_GFXQueue present, VkSemaphore rendered,
  */
 void _gfx_swapchain_purge(_GFXWindow* window);
 
+/**
+ * Defers the destruction of all retired swapchains not yet deferred,
+ * instead of destroying them with _gfx_swapchain_purge.
+ * @param window Cannot be NULL.
+ * @param frame  Virtual frame index to pass to _gfx_swapchain_purge_frame.
+ *
+ * Not thread-affine, but also not thread-safe.
+ */
+void _gfx_swapchain_defer(_GFXWindow* window, unsigned int frame);
+
+/**
+ * Destroys all retired swapchains deferred with the given frame index.
+ * @param window Cannot be NULL.
+ *
+ * Not thread-affine, but also not thread-safe.
+ */
+void _gfx_swapchain_purge_frame(_GFXWindow* window, unsigned int frame);
+
 
 /****************************
  * String manipulation helpers.
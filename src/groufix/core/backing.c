@@ -12,6 +12,22 @@
 #include <stdlib.h>
 
 
+/****************************
+ * Attachment that may share memory, while linking backings.
+ */
+typedef struct _GFXBackingAlias
+{
+	size_t       index;   // Attachment index.
+	_GFXBacking* backing; // Created, no memory bound yet.
+	size_t       group;   // First alias of the group, SIZE_MAX if bound.
+	bool         share;   // Whether it can share memory at all.
+
+	VkMemoryRequirements reqs; // Of the backing itself.
+	VkMemoryRequirements mem;  // Of the group, if first in it.
+
+} _GFXBackingAlias;
+
+
 /****************************
  * Compares two user defined attachment descriptions.
  * @return Non-zero if equal.
@@ -64,7 +80,212 @@ static inline void _gfx_attach_gen(_GFXAttach* attach)
 }
 
 /****************************
- * Allocates a new backing image and links it into an attachment.
+ * Checks whether an image attachment can be transient (lazily allocated),
+ * i.e. its contents never need to be stored in or loaded from memory.
+ * @param index Must be the index of an image attachment.
+ */
+static bool _gfx_attach_is_transient(GFXRenderer* renderer, size_t index)
+{
+	assert(renderer != NULL);
+	assert(index < renderer->backing.attachs.size);
+
+	const _GFXAttach* attach = gfx_vec_at(&renderer->backing.attachs, index);
+	assert(attach->type == _GFX_ATTACH_IMAGE);
+
+	// May not have any non-attachment usages.
+	const VkImageUsageFlags usage = _GFX_GET_VK_IMAGE_USAGE(
+		attach->image.base.flags,
+		attach->image.base.usage,
+		attach->image.base.format);
+
+	if (usage & (VkImageUsageFlags)~(
+		VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT |
+		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+		VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT))
+	{
+		return 0;
+	}
+
+	// And all its consumptions must be discarded attachment accesses.
+	const GFXAccessMask allowed =
+		GFX_ACCESS_ATTACHMENT_INPUT |
+		GFX_ACCESS_ATTACHMENT_READ |
+		GFX_ACCESS_ATTACHMENT_WRITE |
+		GFX_ACCESS_ATTACHMENT_RESOLVE |
+		GFX_ACCESS_MODIFIERS;
+
+	bool consumed = 0;
+
+	for (size_t p = 0; p < renderer->graph.passes.size; ++p)
+	{
+		GFXPass* pass = *(GFXPass**)gfx_vec_at(&renderer->graph.passes, p);
+
+		for (size_t c = 0; c < pass->consumes.size; ++c)
+		{
+			const _GFXConsume* con = gfx_vec_at(&pass->consumes, c);
+			if (con->view.index != index) continue;
+
+			if (
+				!(con->mask & GFX_ACCESS_DISCARD) ||
+				(con->mask & ~allowed))
+			{
+				return 0;
+			}
+
+			consumed = 1;
+		}
+	}
+
+	return consumed;
+}
+
+/****************************
+ * Computes the lifetime of an image attachment within the render graph,
+ * i.e. the first and last pass (in submission order) consuming it.
+ * @param index Must be the index of an image attachment.
+ * @param first Outputs the first pass, UINT_MAX if never consumed.
+ * @param last  Outputs the last pass.
+ * @return Whether the attachment may share memory with others.
+ */
+static bool _gfx_attach_get_life(GFXRenderer* renderer, size_t index,
+                                 unsigned int* first, unsigned int* last)
+{
+	assert(renderer != NULL);
+	assert(index < renderer->backing.attachs.size);
+	assert(first != NULL);
+	assert(last != NULL);
+
+	const _GFXAttach* attach = gfx_vec_at(&renderer->backing.attachs, index);
+	assert(attach->type == _GFX_ATTACH_IMAGE);
+
+	*first = UINT_MAX;
+	*last = 0;
+
+	// Host accessible contents must stay intact outside the graph.
+	bool alias = !(attach->image.base.flags &
+		(GFX_MEMORY_READ | GFX_MEMORY_WRITE));
+
+	for (size_t p = 0; p < renderer->graph.passes.size; ++p)
+	{
+		GFXPass* pass = *(GFXPass**)gfx_vec_at(&renderer->graph.passes, p);
+
+		for (size_t c = 0; c < pass->consumes.size; ++c)
+		{
+			const _GFXConsume* con = gfx_vec_at(&pass->consumes, c);
+			if (con->view.index != index) continue;
+
+			// Only the graphics queue is synchronized with aliases.
+			if (
+				pass->async ||
+				(con->mask & (GFX_ACCESS_COMPUTE_ASYNC | GFX_ACCESS_TRANSFER_ASYNC)))
+			{
+				alias = 0;
+			}
+
+			// The first pass cannot load previous contents.
+			if (*first == UINT_MAX || *first == (unsigned int)p)
+			{
+				*first = (unsigned int)p;
+				if (con->cleared == 0 && GFX_ACCESS_READS(con->mask))
+					alias = 0;
+			}
+
+			*last = (unsigned int)p;
+		}
+	}
+
+	return alias && *first != UINT_MAX;
+}
+
+/****************************
+ * Finds a backing to share memory with for an image attachment.
+ * @param index Must be the index of an unbuilt image attachment.
+ * @return NULL if none found.
+ *
+ * Only considers backings whose memory is bound to backings that all have
+ * a lifetime disjoint from the attachment at index.
+ */
+static _GFXBacking* _gfx_attach_find_alias(GFXRenderer* renderer, size_t index)
+{
+	assert(renderer != NULL);
+	assert(index < renderer->backing.attachs.size);
+
+	const _GFXAttach* attach = gfx_vec_at(&renderer->backing.attachs, index);
+	assert(attach->type == _GFX_ATTACH_IMAGE);
+
+	if (!attach->image.life.alias || attach->image.transient)
+		return NULL;
+
+	for (size_t i = 0; i < renderer->backing.attachs.size; ++i)
+	{
+		const _GFXAttach* owner = gfx_vec_at(&renderer->backing.attachs, i);
+		if (
+			i == index ||
+			owner->type != _GFX_ATTACH_IMAGE ||
+			owner->image.vk.image == VK_NULL_HANDLE ||
+			owner->image.transient ||
+			!owner->image.life.alias)
+		{
+			continue;
+		}
+
+		_GFXBacking* backing = (_GFXBacking*)owner->image.backings.head;
+
+		// Check the lifetime of all users of its memory.
+		bool disjoint = 1;
+
+		for (size_t j = 0; disjoint && j < renderer->backing.attachs.size; ++j)
+		{
+			const _GFXAttach* user = gfx_vec_at(&renderer->backing.attachs, j);
+			if (
+				j == index ||
+				user->type != _GFX_ATTACH_IMAGE ||
+				user->image.vk.image == VK_NULL_HANDLE)
+			{
+				continue;
+			}
+
+			const _GFXBacking* uBacking =
+				(const _GFXBacking*)user->image.backings.head;
+
+			if (uBacking->mem != backing->mem)
+				continue;
+
+			disjoint =
+				user->image.life.last < attach->image.life.first ||
+				attach->image.life.last < user->image.life.first;
+		}
+
+		if (disjoint)
+			return backing;
+	}
+
+	return NULL;
+}
+
+/****************************
+ * Links a backing image into an attachment as most recent.
+ * @param attach  Must be an image attachment.
+ * @param backing Cannot be NULL, must have memory bound to it.
+ */
+static void _gfx_insert_backing(_GFXAttach* attach, _GFXBacking* backing)
+{
+	assert(attach != NULL);
+	assert(attach->type == _GFX_ATTACH_IMAGE);
+	assert(backing != NULL);
+	assert(backing->mem != NULL);
+
+	// We set its purge index to UINT_MAX so it never gets purged, yet.
+	backing->purge = UINT_MAX;
+
+	gfx_list_insert_before(&attach->image.backings, &backing->list, NULL);
+	attach->image.vk.image = backing->vk.image;
+}
+
+/****************************
+ * Allocates a new backing image with its own memory
+ * and links it into an attachment.
  * @param attach Must be an image attachment of non-zero size.
  * @return Non-zero on success.
  */
@@ -78,15 +299,20 @@ static bool _gfx_link_backing(GFXRenderer* renderer, _GFXAttach* attach)
 	assert(attach->image.depth > 0);
 
 	// Allocate a new backing image.
-	_GFXBacking* backing = _gfx_alloc_backing(renderer->heap, &attach->image);
+	VkMemoryRequirements reqs;
+	bool share;
+
+	_GFXBacking* backing =
+		_gfx_create_backing(renderer->heap, &attach->image, &reqs, &share);
 	if (backing == NULL) return 0;
 
-	// We set its purge index to UINT_MAX so it never gets purged, yet.
-	backing->purge = UINT_MAX;
+	if (!_gfx_bind_backings(renderer->heap, &attach->image, &reqs, 1, &backing))
+	{
+		_gfx_free_backing(renderer->heap, backing);
+		return 0;
+	}
 
-	// Link the backing into the attachment as most recent.
-	gfx_list_insert_before(&attach->image.backings, &backing->list, NULL);
-	attach->image.vk.image = backing->vk.image;
+	_gfx_insert_backing(attach, backing);
 
 	return 1;
 }
@@ -107,7 +333,8 @@ static void _gfx_unlink_backing(GFXRenderer* renderer, _GFXAttach* attach,
 	// Unlink it from its attachment.
 	gfx_list_erase(&attach->image.backings, &backing->list);
 
-	// Free the memory.
+	// Evict all cached views of its image, then free the memory.
+	_gfx_render_graph_evict(renderer, backing);
 	_gfx_free_backing(renderer->heap, backing);
 }
 
@@ -205,9 +432,10 @@ static bool _gfx_detach_attachment(GFXRenderer* renderer, _GFXAttach* attach,
 		// If not an image, unlock.
 		_gfx_mutex_unlock(&renderer->lock);
 
-	// Finally, if it is a window, unlock the window.
+	// Finally, if it is a window, evict its cached views & unlock it.
 	if (attach->type == _GFX_ATTACH_WINDOW)
 	{
+		_gfx_render_graph_evict(renderer, attach->window.window);
 		_gfx_swapchain_unlock(attach->window.window);
 		attach->window.window = NULL;
 	}
@@ -339,7 +567,8 @@ static bool _gfx_render_backing_resolve(GFXRenderer* renderer)
 					// Some operation might still use the resource.
 					// So we set its purge state so it gets purged whenever
 					// not active anymore (i.e. not most recent anymore).
-					if (attach->image.signaled)
+					// Same if recreating live, frames might still use it.
+					if (attach->image.signaled || renderer->backing.live)
 						backing->purge = renderer->current;
 					else
 						// If not signaled, just unlink & free the backing.
@@ -386,19 +615,77 @@ static bool _gfx_render_backing_resolve(GFXRenderer* renderer)
 }
 
 /****************************
- * Allocates a new backing image for all attachments that need one.
- * @param renderer Cannot be NULL, its backing state must be validated.
+ * Checks whether an image attachment can share memory with a group
+ * of backings in the alias scratch of _gfx_render_backing_link.
+ * @param alias Index of the candidate to check.
+ * @param group Index of the first candidate of the group.
+ */
+static bool _gfx_alias_fits(GFXRenderer* renderer,
+                            const _GFXBackingAlias* aliases,
+                            size_t alias, size_t group)
+{
+	const _GFXBackingAlias* cand = &aliases[alias];
+	const _GFXBackingAlias* first = &aliases[group];
+
+	const _GFXAttach* attach =
+		gfx_vec_at(&renderer->backing.attachs, cand->index);
+	const _GFXAttach* other =
+		gfx_vec_at(&renderer->backing.attachs, first->index);
+
+	// Must be able to agree on a memory type and memory flags.
+	if (
+		!(first->mem.memoryTypeBits & cand->reqs.memoryTypeBits) ||
+		attach->image.base.flags != other->image.base.flags)
+	{
+		return 0;
+	}
+
+	// And its lifetime must be disjoint from all others in the group.
+	for (size_t a = group; a < alias; ++a)
+	{
+		if (aliases[a].group != group)
+			continue;
+
+		const _GFXAttach* user =
+			gfx_vec_at(&renderer->backing.attachs, aliases[a].index);
+
+		if (
+			user->image.life.last >= attach->image.life.first &&
+			attach->image.life.last >= user->image.life.first)
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/****************************
+ * Links a new backing image into all attachments that need one.
+ * @param renderer Cannot be NULL.
  * @return Number of failed allocations (0 means success).
+ *
+ * Attachments that may share memory are created first, then linked
+ * largest first (by their actual memory requirements), so smaller images
+ * can alias the memory of built or larger images.
+ * Images that share new memory must agree on a memory type,
+ * the memory is allocated with the largest size and alignment.
  */
-static size_t _gfx_render_backing_alloc(GFXRenderer* renderer)
+static size_t _gfx_render_backing_link(GFXRenderer* renderer)
 {
 	assert(renderer != NULL);
-	assert(renderer->backing.state == _GFX_BACKING_VALIDATED);
 
-	// So yeah go and make sure all attachments have an image.
+	const size_t numAttachs = renderer->backing.attachs.size;
+
+	// Scratch for all attachments that may share memory,
+	// if we cannot allocate it, they just get their own memory.
+	_GFXBackingAlias* aliases = NULL;
+	_GFXBacking** group = NULL;
+	size_t numAliases = 0;
+
 	size_t failed = 0;
 
-	for (size_t i = 0; i < renderer->backing.attachs.size; ++i)
+	for (size_t i = 0; i < numAttachs; ++i)
 	{
 		_GFXAttach* attach = gfx_vec_at(&renderer->backing.attachs, i);
 		if (
@@ -413,10 +700,144 @@ static size_t _gfx_render_backing_alloc(GFXRenderer* renderer)
 			continue;
 		}
 
+		attach->image.transient = _gfx_attach_is_transient(renderer, i);
+
+		if (attach->image.life.alias && !attach->image.transient && !aliases)
+		{
+			aliases = malloc(sizeof(_GFXBackingAlias) * numAttachs);
+			group = malloc(sizeof(_GFXBacking*) * numAttachs);
+
+			if (aliases == NULL || group == NULL)
+			{
+				free(aliases);
+				free(group);
+				aliases = NULL;
+				group = NULL;
+			}
+		}
+
 		// Allocate & link the backing image!
-		failed += !_gfx_link_backing(renderer, attach);
+		if (!attach->image.life.alias || attach->image.transient || !aliases)
+		{
+			failed += !_gfx_link_backing(renderer, attach);
+			continue;
+		}
+
+		// Or create it and remember it for later, sorted by size.
+		VkMemoryRequirements reqs;
+		bool share;
+
+		_GFXBacking* backing =
+			_gfx_create_backing(renderer->heap, &attach->image, &reqs, &share);
+
+		if (backing == NULL)
+		{
+			++failed;
+			continue;
+		}
+
+		size_t a = numAliases++;
+		for (; a > 0 && aliases[a-1].reqs.size < reqs.size; --a)
+			aliases[a] = aliases[a-1];
+
+		aliases[a] = (_GFXBackingAlias){
+			.index = i,
+			.backing = backing,
+			.share = share,
+			.reqs = reqs,
+			.mem = reqs
+		};
+	}
+
+	// Now group them, first try to share memory of built backings,
+	// then try to join a group of new memory, or start a new group.
+	for (size_t a = 0; a < numAliases; ++a)
+	{
+		_GFXBackingAlias* cand = &aliases[a];
+		_GFXAttach* attach = gfx_vec_at(&renderer->backing.attachs, cand->index);
+		_GFXBacking* alias = _gfx_attach_find_alias(renderer, cand->index);
+
+		if (cand->share && alias != NULL && _gfx_bind_backing_alias(
+			renderer->heap, cand->backing, &cand->reqs, alias))
+		{
+			_gfx_insert_backing(attach, cand->backing);
+			cand->group = SIZE_MAX;
+			continue;
+		}
+
+		cand->group = a;
+
+		if (cand->share)
+			for (size_t g = 0; g < a; ++g)
+			{
+				_GFXBackingAlias* first = &aliases[g];
+				if (
+					first->group != g || !first->share ||
+					!_gfx_alias_fits(renderer, aliases, a, g))
+				{
+					continue;
+				}
+
+				first->mem.size =
+					GFX_MAX(first->mem.size, cand->reqs.size);
+				first->mem.alignment =
+					GFX_MAX(first->mem.alignment, cand->reqs.alignment);
+				first->mem.memoryTypeBits &=
+					cand->reqs.memoryTypeBits;
+
+				cand->group = g;
+				break;
+			}
+	}
+
+	// Then allocate memory for each group & link all its backings.
+	for (size_t g = 0; g < numAliases; ++g)
+	{
+		if (aliases[g].group != g)
+			continue;
+
+		size_t num = 0;
+		for (size_t a = g; a < numAliases; ++a)
+			if (aliases[a].group == g) group[num++] = aliases[a].backing;
+
+		_GFXAttach* attach =
+			gfx_vec_at(&renderer->backing.attachs, aliases[g].index);
+
+		if (!_gfx_bind_backings(
+			renderer->heap, &attach->image, &aliases[g].mem, num, group))
+		{
+			for (size_t b = 0; b < num; ++b)
+				_gfx_free_backing(renderer->heap, group[b]);
+
+			failed += num;
+			continue;
+		}
+
+		for (size_t a = g; a < numAliases; ++a)
+			if (aliases[a].group == g) _gfx_insert_backing(
+				gfx_vec_at(&renderer->backing.attachs, aliases[a].index),
+				aliases[a].backing);
 	}
 
+	free(aliases);
+	free(group);
+
+	return failed;
+}
+
+/****************************
+ * Allocates a new backing image for all attachments that need one.
+ * @param renderer Cannot be NULL, its backing state must be validated.
+ * @return Number of failed allocations (0 means success).
+ */
+static size_t _gfx_render_backing_alloc(GFXRenderer* renderer)
+{
+	assert(renderer != NULL);
+	assert(renderer->backing.state == _GFX_BACKING_VALIDATED);
+
+	// So yeah go and make sure all attachments have an image.
+	size_t failed = _gfx_render_backing_link(renderer);
+
 	if (failed == 0)
 		// Yey built.
 		renderer->backing.state = _GFX_BACKING_BUILT;
@@ -430,6 +851,7 @@ void _gfx_render_backing_init(GFXRenderer* renderer)
 	assert(renderer != NULL);
 
 	gfx_vec_init(&renderer->backing.attachs, sizeof(_GFXAttach));
+	renderer->backing.live = 0;
 
 	// No backing is a valid backing.
 	renderer->backing.state = _GFX_BACKING_BUILT;
@@ -544,6 +966,94 @@ void _gfx_render_backing_purge(GFXRenderer* renderer)
 	}
 }
 
+/****************************/
+void _gfx_render_backing_analyze(GFXRenderer* renderer)
+{
+	assert(renderer != NULL);
+
+	// First re-evaluate all lifetimes, remember if any sharing changed.
+	const size_t numAttachs = renderer->backing.attachs.size;
+
+	bool stale[numAttachs > 0 ? numAttachs : 1];
+	bool reshare = 0;
+
+	for (size_t i = 0; i < numAttachs; ++i)
+	{
+		_GFXAttach* attach = gfx_vec_at(&renderer->backing.attachs, i);
+		stale[i] = 0;
+
+		if (attach->type != _GFX_ATTACH_IMAGE)
+			continue;
+
+		unsigned int first, last;
+		const bool alias = _gfx_attach_get_life(renderer, i, &first, &last);
+
+		// Unbuilt attachments are evaluated when building.
+		if (attach->image.vk.image != VK_NULL_HANDLE)
+		{
+			stale[i] = _gfx_attach_is_transient(renderer, i) !=
+				attach->image.transient;
+
+			reshare = reshare ||
+				alias != attach->image.life.alias ||
+				(alias && (
+					first != attach->image.life.first ||
+					last != attach->image.life.last));
+		}
+
+		attach->image.life.first = first;
+		attach->image.life.last = last;
+		attach->image.life.alias = alias;
+	}
+
+	// If any sharing changed, all shared memory is reconsidered.
+	for (size_t i = 0; reshare && i < numAttachs; ++i)
+	{
+		_GFXAttach* attach = gfx_vec_at(&renderer->backing.attachs, i);
+		if (
+			attach->type == _GFX_ATTACH_IMAGE &&
+			attach->image.vk.image != VK_NULL_HANDLE)
+		{
+			const _GFXBacking* backing =
+				(const _GFXBacking*)attach->image.backings.head;
+
+			stale[i] = stale[i] ||
+				attach->image.life.alias ||
+				backing->mem->refs > 1;
+		}
+	}
+
+	// Frames might still be using the current backings,
+	// so they become stale and are purged when this frame comes around.
+	for (size_t i = 0; i < numAttachs; ++i)
+	{
+		if (!stale[i]) continue;
+		_GFXAttach* attach = gfx_vec_at(&renderer->backing.attachs, i);
+
+		((_GFXBacking*)attach->image.backings.head)->purge = renderer->current;
+		attach->image.vk.image = VK_NULL_HANDLE;
+		_gfx_attach_gen(attach);
+	}
+
+	// Then replace them with new backings.
+	// If not resolved, they are rebuilt when building the backing.
+	if (renderer->backing.state < _GFX_BACKING_VALIDATED)
+		return;
+
+	size_t failed = _gfx_render_backing_link(renderer);
+
+	if (failed > 0)
+	{
+		gfx_log_error(
+			"Failed to rebuild %"GFX_PRIs" analyzed attachment(s) of a renderer.",
+			failed);
+
+		// Makes sure it is tried again.
+		if (renderer->backing.state == _GFX_BACKING_BUILT)
+			renderer->backing.state = _GFX_BACKING_VALIDATED;
+	}
+}
+
 /****************************/
 GFX_API bool gfx_renderer_attach(GFXRenderer* renderer,
                                  size_t index, GFXAttachment attachment)
@@ -620,6 +1130,12 @@ GFX_API bool gfx_renderer_attach(GFXRenderer* renderer,
 		.height = 0,
 		.depth = 0,
 		.signaled = 0,
+		.transient = 0,
+		.life = {
+			.first = UINT_MAX,
+			.last = 0,
+			.alias = 0
+		},
 		.vk = {
 			.format = vkFmt,
 			.image = VK_NULL_HANDLE
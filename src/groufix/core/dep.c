@@ -30,11 +30,20 @@
 	((inj).type == GFX_DEP_WAIT)
 
 
+// Number of barriers converted at once when flushing without synchronization2.
+#define _GFX_INJ_LEGACY_CHUNK 64
+
+// Number of operation references tracked on the stack when catching.
+#define _GFX_INJ_STACK_REFS 64
+
+
 // Outputs an injection element & auto log, num and elems are lvalues.
+// Allocates from `injection`, which must be in scope.
 #define _GFX_INJ_OUTPUT(num, elems, size, insert, action) \
 	do { \
 		if (GFX_IS_POWER_OF_TWO(num)) { \
-			void* _gfx_inj_ptr = realloc(elems, \
+			void* _gfx_inj_ptr = _gfx_injection_realloc(injection, \
+				elems, size * (num), \
 				size * ((num) == 0 ? 2 : (num) << 1)); \
 			if (_gfx_inj_ptr == NULL) { \
 				gfx_log_error( \
@@ -70,9 +79,9 @@ static void _gfx_unpack(_GFXContext* context,
                         const GFXRange* range, uint64_t size,
                         GFXAccessMask mask, GFXShaderStage stage,
                         GFXRange* unpacked,
-                        VkAccessFlags* flags,
+                        VkAccessFlags2KHR* flags,
                         VkImageLayout* layout,
-                        VkPipelineStageFlags* stages)
+                        VkPipelineStageFlags2KHR* stages)
 {
 	assert(context != NULL);
 	assert(ref != NULL);
@@ -89,9 +98,9 @@ static void _gfx_unpack(_GFXContext* context,
 	{
 		// Resolve access flags, image layout and pipeline stage.
 		GFXFormat fmt = GFX_FORMAT_EMPTY;
-		*flags = _GFX_GET_VK_ACCESS_FLAGS(mask, fmt);
+		*flags = _GFX_GET_VK_ACCESS_FLAGS2(mask, fmt);
 		*layout = VK_IMAGE_LAYOUT_UNDEFINED; // It's a buffer.
-		*stages = _GFX_GET_VK_PIPELINE_STAGE(mask, stage, fmt);
+		*stages = _GFX_GET_VK_PIPELINE_STAGE2(mask, stage, fmt);
 		*stages = _GFX_MOD_VK_PIPELINE_STAGE(*stages, context);
 
 		// Normalize offset to be independent of references.
@@ -118,9 +127,9 @@ static void _gfx_unpack(_GFXContext* context,
 		// Note that zero image mipmaps/layers do not need to be resolved,
 		// from user-land we cannot reference part of an image, only the whole,
 		// meaning we can use the Vulkan 'remaining mipmaps/layers' flags.
-		*flags = _GFX_GET_VK_ACCESS_FLAGS(mask, fmt);
+		*flags = _GFX_GET_VK_ACCESS_FLAGS2(mask, fmt);
 		*layout = _GFX_GET_VK_IMAGE_LAYOUT(mask, fmt);
-		*stages = _GFX_GET_VK_PIPELINE_STAGE(mask, stage, fmt);
+		*stages = _GFX_GET_VK_PIPELINE_STAGE2(mask, stage, fmt);
 		*stages = _GFX_MOD_VK_PIPELINE_STAGE(*stages, context);
 
 		if (range == NULL)
@@ -182,8 +191,16 @@ static _GFXSync* _gfx_dep_claim(GFXDependency* dep, bool semaphore,
 
 			// Never break, always prefer objects closer to the center,
 			// such that shrinking is easier.
-			if (sync->stage == _GFX_SYNC_UNUSED)
+			// A timeline semaphore can only be re-signaled from the queue
+			// that last signaled it, as its previous signal might not have
+			// executed yet and its value must strictly increase.
+			if (sync->stage == _GFX_SYNC_UNUSED &&
+				(!dep->timeline || sync->vk.value == 0 ||
+				(sync->vk.sigQueue.family == injection->inp.queue.family &&
+				sync->vk.sigQueue.index == injection->inp.queue.index)))
+			{
 				unused = sync;
+			}
 
 			// We know it has a semaphore because of its position in syncs.
 			if (sync->stage == _GFX_SYNC_PREPARE &&
@@ -209,10 +226,21 @@ static _GFXSync* _gfx_dep_claim(GFXDependency* dep, bool semaphore,
 			unused = gfx_deque_at(&dep->syncs, 0);
 			unused->stage = _GFX_SYNC_UNUSED;
 			unused->flags = _GFX_SYNC_SEMAPHORE;
+			unused->vk.value = 0;
+			unused->vk.sigQueue.family = 0;
+			unused->vk.sigQueue.index = 0;
+
+			VkSemaphoreTypeCreateInfo stci = {
+				.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+
+				.pNext         = NULL,
+				.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+				.initialValue  = 0
+			};
 
 			VkSemaphoreCreateInfo sci = {
 				.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
-				.pNext = NULL,
+				.pNext = dep->timeline ? &stci : NULL,
 				.flags = 0
 			};
 
@@ -258,6 +286,9 @@ static _GFXSync* _gfx_dep_claim(GFXDependency* dep, bool semaphore,
 	sync->stage = _GFX_SYNC_UNUSED;
 	sync->flags = 0;
 	sync->vk.signaled = VK_NULL_HANDLE;
+	sync->vk.value = 0;
+	sync->vk.sigQueue.family = 0;
+	sync->vk.sigQueue.index = 0;
 
 	return sync;
 }
@@ -289,7 +320,12 @@ GFX_API GFXDependency* gfx_create_dep(GFXDevice* device, unsigned int capacity)
 	dep->compute.index = _gfx_queue_index(compute, VK_QUEUE_COMPUTE_BIT, 0);
 	dep->transfer.index = _gfx_queue_index(transfer, VK_QUEUE_TRANSFER_BIT, 0);
 
+	// Use timeline semaphores if there is no capacity, so we can still
+	// recycle semaphores, they can be re-signaled with a higher value.
 	dep->waitCapacity = capacity;
+	dep->timeline = (capacity == 0) &&
+		(dep->context->features & _GFX_SUPPORT_TIMELINE_SEMAPHORE);
+
 	dep->sems = 0;
 	gfx_deque_init(&dep->syncs, sizeof(_GFXSync));
 
@@ -335,6 +371,342 @@ GFX_API GFXDevice* gfx_dep_get_device(GFXDependency* dep)
 	return (GFXDevice*)dep->device;
 }
 
+/****************************
+ * Merges range [*base, *base + *count) with [oBase, oBase + oCount) if they
+ * overlap or touch, a count of `remaining` extends to the end (of anything).
+ * @return Non-zero if merged, *base and *count are updated.
+ */
+static bool _gfx_merge_range(uint64_t* base, uint64_t* count,
+                             uint64_t oBase, uint64_t oCount,
+                             uint64_t remaining)
+{
+	assert(base != NULL);
+	assert(count != NULL);
+
+	const uint64_t end = (*count == remaining) ? remaining : *base + *count;
+	const uint64_t oEnd = (oCount == remaining) ? remaining : oBase + oCount;
+
+	if (*base > oEnd || oBase > end)
+		return 0;
+
+	const uint64_t mBase = GFX_MIN(*base, oBase);
+	const uint64_t mEnd = GFX_MAX(end, oEnd);
+
+	*base = mBase;
+	*count = (mEnd == remaining) ? remaining : mEnd - mBase;
+
+	return 1;
+}
+
+/****************************
+ * Attempts to merge a buffer memory barrier into an already pushed one.
+ * @return Non-zero if merged.
+ */
+static bool _gfx_injection_merge_buffer(const VkBufferMemoryBarrier2KHR* bmb,
+                                        _GFXInjection* injection)
+{
+	assert(bmb != NULL);
+	assert(injection != NULL);
+
+	for (size_t b = 0; b < injection->bars.numBufs; ++b)
+	{
+		VkBufferMemoryBarrier2KHR* bar = injection->bars.bufs + b;
+
+		if (
+			bar->buffer != bmb->buffer ||
+			bar->srcQueueFamilyIndex != bmb->srcQueueFamilyIndex ||
+			bar->dstQueueFamilyIndex != bmb->dstQueueFamilyIndex)
+		{
+			continue;
+		}
+
+		uint64_t offset = bar->offset;
+		uint64_t size = bar->size;
+
+		if (!_gfx_merge_range(
+			&offset, &size, bmb->offset, bmb->size, VK_WHOLE_SIZE))
+		{
+			continue;
+		}
+
+		bar->srcStageMask |= bmb->srcStageMask;
+		bar->dstStageMask |= bmb->dstStageMask;
+		bar->srcAccessMask |= bmb->srcAccessMask;
+		bar->dstAccessMask |= bmb->dstAccessMask;
+		bar->offset = offset;
+		bar->size = size;
+
+		return 1;
+	}
+
+	return 0;
+}
+
+/****************************
+ * Attempts to merge an image memory barrier into an already pushed one.
+ * Only merges if either the mipmap or layer ranges are equal,
+ * as the union of both would otherwise not be a single range.
+ * @return Non-zero if merged.
+ */
+static bool _gfx_injection_merge_image(const VkImageMemoryBarrier2KHR* imb,
+                                       _GFXInjection* injection)
+{
+	assert(imb != NULL);
+	assert(injection != NULL);
+
+	const VkImageSubresourceRange* range = &imb->subresourceRange;
+
+	for (size_t i = 0; i < injection->bars.numImgs; ++i)
+	{
+		VkImageMemoryBarrier2KHR* bar = injection->bars.imgs + i;
+		VkImageSubresourceRange* bRange = &bar->subresourceRange;
+
+		if (
+			bar->image != imb->image ||
+			bar->oldLayout != imb->oldLayout ||
+			bar->newLayout != imb->newLayout ||
+			bar->srcQueueFamilyIndex != imb->srcQueueFamilyIndex ||
+			bar->dstQueueFamilyIndex != imb->dstQueueFamilyIndex ||
+			bRange->aspectMask != range->aspectMask)
+		{
+			continue;
+		}
+
+		const bool sameMips =
+			bRange->baseMipLevel == range->baseMipLevel &&
+			bRange->levelCount == range->levelCount;
+		const bool sameLayers =
+			bRange->baseArrayLayer == range->baseArrayLayer &&
+			bRange->layerCount == range->layerCount;
+
+		uint64_t base, count;
+
+		if (sameMips)
+		{
+			base = bRange->baseArrayLayer;
+			count = bRange->layerCount;
+
+			if (!_gfx_merge_range(
+				&base, &count, range->baseArrayLayer, range->layerCount,
+				VK_REMAINING_ARRAY_LAYERS))
+			{
+				continue;
+			}
+
+			bRange->baseArrayLayer = (uint32_t)base;
+			bRange->layerCount = (uint32_t)count;
+		}
+		else if (sameLayers)
+		{
+			base = bRange->baseMipLevel;
+			count = bRange->levelCount;
+
+			if (!_gfx_merge_range(
+				&base, &count, range->baseMipLevel, range->levelCount,
+				VK_REMAINING_MIP_LEVELS))
+			{
+				continue;
+			}
+
+			bRange->baseMipLevel = (uint32_t)base;
+			bRange->levelCount = (uint32_t)count;
+		}
+		else continue;
+
+		bar->srcStageMask |= imb->srcStageMask;
+		bar->dstStageMask |= imb->dstStageMask;
+		bar->srcAccessMask |= imb->srcAccessMask;
+		bar->dstAccessMask |= imb->dstAccessMask;
+
+		return 1;
+	}
+
+	return 0;
+}
+
+/****************************
+ * Pushes (or merges) a buffer memory barrier as injection metadata.
+ * The barrier's own stage masks are overwritten by srcStage and dstStage.
+ * @return Zero on failure.
+ */
+static bool _gfx_injection_push_buffer(VkPipelineStageFlags2KHR srcStage,
+                                       VkPipelineStageFlags2KHR dstStage,
+                                       const VkBufferMemoryBarrier2KHR* bmb,
+                                       _GFXInjection* injection)
+{
+	assert(bmb != NULL);
+	assert(injection != NULL);
+
+	VkBufferMemoryBarrier2KHR bar = *bmb;
+	bar.srcStageMask = srcStage;
+	bar.dstStageMask = dstStage;
+
+#if !defined (NDEBUG)
+	++injection->bars.numPushed;
+#endif
+
+	if (_gfx_injection_merge_buffer(&bar, injection))
+	{
+#if !defined (NDEBUG)
+		++injection->bars.numMerged;
+#endif
+		return 1;
+	}
+
+	_GFX_INJ_OUTPUT(
+		injection->bars.numBufs, injection->bars.bufs,
+		sizeof(VkBufferMemoryBarrier2KHR), bar,
+		return 0);
+
+	return 1;
+}
+
+/****************************
+ * Pushes (or merges) an image memory barrier as injection metadata.
+ * The barrier's own stage masks are overwritten by srcStage and dstStage.
+ * @return Zero on failure.
+ */
+static bool _gfx_injection_push_image(VkPipelineStageFlags2KHR srcStage,
+                                      VkPipelineStageFlags2KHR dstStage,
+                                      const VkImageMemoryBarrier2KHR* imb,
+                                      _GFXInjection* injection)
+{
+	assert(imb != NULL);
+	assert(injection != NULL);
+
+	VkImageMemoryBarrier2KHR bar = *imb;
+	bar.srcStageMask = srcStage;
+	bar.dstStageMask = dstStage;
+
+#if !defined (NDEBUG)
+	++injection->bars.numPushed;
+#endif
+
+	if (_gfx_injection_merge_image(&bar, injection))
+	{
+#if !defined (NDEBUG)
+		++injection->bars.numMerged;
+#endif
+		return 1;
+	}
+
+	_GFX_INJ_OUTPUT(
+		injection->bars.numImgs, injection->bars.imgs,
+		sizeof(VkImageMemoryBarrier2KHR), bar,
+		return 0);
+
+	return 1;
+}
+
+/****************************
+ * Records all stored barriers using vkCmdPipelineBarrier2KHR,
+ * each barrier carries its own stage masks.
+ */
+static void _gfx_injection_flush2(_GFXContext* context, VkCommandBuffer cmd,
+                                  _GFXInjection* injection)
+{
+	// Execution dependencies go in a single global barrier.
+	VkMemoryBarrier2KHR mb = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2_KHR,
+
+		.pNext         = NULL,
+		.srcStageMask  = injection->bars.srcExec,
+		.srcAccessMask = 0,
+		.dstStageMask  = injection->bars.dstExec,
+		.dstAccessMask = 0
+	};
+
+	const bool exec =
+		injection->bars.srcExec != 0 && injection->bars.dstExec != 0;
+
+	VkDependencyInfoKHR di = {
+		.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR,
+
+		.pNext                    = NULL,
+		.dependencyFlags          = 0,
+		.memoryBarrierCount       = exec ? 1 : 0,
+		.pMemoryBarriers          = exec ? &mb : NULL,
+		.bufferMemoryBarrierCount = (uint32_t)injection->bars.numBufs,
+		.pBufferMemoryBarriers    = injection->bars.bufs,
+		.imageMemoryBarrierCount  = (uint32_t)injection->bars.numImgs,
+		.pImageMemoryBarriers     = injection->bars.imgs
+	};
+
+	context->vk.CmdPipelineBarrier2KHR(cmd, &di);
+}
+
+/****************************
+ * Records all stored barriers using vkCmdPipelineBarrier,
+ * converts them to legacy barriers using the batch-wide stage masks.
+ */
+static void _gfx_injection_flush_legacy(_GFXContext* context,
+                                        VkCommandBuffer cmd,
+                                        _GFXInjection* injection)
+{
+	const VkPipelineStageFlags srcStage =
+		_GFX_GET_VK_PIPELINE_STAGE_LEGACY(injection->bars.srcStage);
+	const VkPipelineStageFlags dstStage =
+		_GFX_GET_VK_PIPELINE_STAGE_LEGACY(injection->bars.dstStage);
+
+	// Convert in fixed size chunks so we don't have to allocate.
+	// Always record at least once, as we may only have stages.
+	VkBufferMemoryBarrier bmbs[_GFX_INJ_LEGACY_CHUNK];
+	VkImageMemoryBarrier imbs[_GFX_INJ_LEGACY_CHUNK];
+
+	size_t b = 0, i = 0;
+
+	do
+	{
+		uint32_t numBufs = 0, numImgs = 0;
+
+		for (; b < injection->bars.numBufs &&
+			numBufs < _GFX_INJ_LEGACY_CHUNK; ++b, ++numBufs)
+		{
+			const VkBufferMemoryBarrier2KHR* bar = injection->bars.bufs + b;
+
+			bmbs[numBufs] = (VkBufferMemoryBarrier){
+				.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+
+				.pNext               = NULL,
+				.srcAccessMask       = _GFX_GET_VK_ACCESS_FLAGS_LEGACY(bar->srcAccessMask),
+				.dstAccessMask       = _GFX_GET_VK_ACCESS_FLAGS_LEGACY(bar->dstAccessMask),
+				.srcQueueFamilyIndex = bar->srcQueueFamilyIndex,
+				.dstQueueFamilyIndex = bar->dstQueueFamilyIndex,
+				.buffer              = bar->buffer,
+				.offset              = bar->offset,
+				.size                = bar->size
+			};
+		}
+
+		for (; i < injection->bars.numImgs &&
+			numImgs < _GFX_INJ_LEGACY_CHUNK; ++i, ++numImgs)
+		{
+			const VkImageMemoryBarrier2KHR* bar = injection->bars.imgs + i;
+
+			imbs[numImgs] = (VkImageMemoryBarrier){
+				.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+
+				.pNext               = NULL,
+				.srcAccessMask       = _GFX_GET_VK_ACCESS_FLAGS_LEGACY(bar->srcAccessMask),
+				.dstAccessMask       = _GFX_GET_VK_ACCESS_FLAGS_LEGACY(bar->dstAccessMask),
+				.oldLayout           = bar->oldLayout,
+				.newLayout           = bar->newLayout,
+				.srcQueueFamilyIndex = bar->srcQueueFamilyIndex,
+				.dstQueueFamilyIndex = bar->dstQueueFamilyIndex,
+				.image               = bar->image,
+				.subresourceRange    = bar->subresourceRange
+			};
+		}
+
+		context->vk.CmdPipelineBarrier(cmd,
+			srcStage, dstStage,
+			0, 0, NULL,
+			numBufs, bmbs,
+			numImgs, imbs);
+	}
+	while (b < injection->bars.numBufs || i < injection->bars.numImgs);
+}
+
 /****************************/
 void _gfx_injection_flush(_GFXContext* context, VkCommandBuffer cmd,
                           _GFXInjection* injection)
@@ -347,27 +719,36 @@ void _gfx_injection_flush(_GFXContext* context, VkCommandBuffer cmd,
 	if (injection->bars.srcStage != 0 && injection->bars.dstStage != 0)
 	{
 		// Flush all barriers.
-		context->vk.CmdPipelineBarrier(cmd,
-			injection->bars.srcStage,
-			injection->bars.dstStage,
-			0, 0, NULL,
-			(uint32_t)injection->bars.numBufs, injection->bars.bufs,
-			(uint32_t)injection->bars.numImgs, injection->bars.imgs);
+		if (context->features & _GFX_SUPPORT_SYNCHRONIZATION2)
+			_gfx_injection_flush2(context, cmd, injection);
+		else
+			_gfx_injection_flush_legacy(context, cmd, injection);
 
 		// And reset for next batch.
 		// Don't free the memory, it'll be realloc'd or free'd later on.
 		injection->bars.srcStage = 0;
 		injection->bars.dstStage = 0;
+		injection->bars.srcExec = 0;
+		injection->bars.dstExec = 0;
 		injection->bars.numBufs = 0;
 		injection->bars.numImgs = 0;
+
+#if !defined (NDEBUG)
+		atomic_fetch_add(&context->barriers.flushes, 1);
+		atomic_fetch_add(&context->barriers.pushed, injection->bars.numPushed);
+		atomic_fetch_add(&context->barriers.merged, injection->bars.numMerged);
+
+		injection->bars.numPushed = 0;
+		injection->bars.numMerged = 0;
+#endif
 	}
 }
 
 /****************************/
-bool _gfx_injection_push(VkPipelineStageFlags srcStage,
-                         VkPipelineStageFlags dstStage,
-                         const VkBufferMemoryBarrier* bmb,
-                         const VkImageMemoryBarrier* imb,
+bool _gfx_injection_push(VkPipelineStageFlags2KHR srcStage,
+                         VkPipelineStageFlags2KHR dstStage,
+                         const VkBufferMemoryBarrier2KHR* bmb,
+                         const VkImageMemoryBarrier2KHR* imb,
                          _GFXInjection* injection)
 {
 	assert(bmb == NULL || imb == NULL);
@@ -375,16 +756,21 @@ bool _gfx_injection_push(VkPipelineStageFlags srcStage,
 
 	// Push one of the two barriers.
 	if (bmb != NULL)
-		_GFX_INJ_OUTPUT(
-			injection->bars.numBufs, injection->bars.bufs,
-			sizeof(VkBufferMemoryBarrier), *bmb,
-			return 0);
-
+	{
+		if (!_gfx_injection_push_buffer(srcStage, dstStage, bmb, injection))
+			return 0;
+	}
 	else if (imb != NULL)
-		_GFX_INJ_OUTPUT(
-			injection->bars.numImgs, injection->bars.imgs,
-			sizeof(VkImageMemoryBarrier), *imb,
-			return 0);
+	{
+		if (!_gfx_injection_push_image(srcStage, dstStage, imb, injection))
+			return 0;
+	}
+	else
+	{
+		// Execution-only dependency, flushed as a global barrier.
+		injection->bars.srcExec |= srcStage;
+		injection->bars.dstExec |= dstStage;
+	}
 
 	// Always add pipeline flags.
 	injection->bars.srcStage |= srcStage;
@@ -416,8 +802,8 @@ static bool _gfx_dep_push_barrier(const _GFXSync* sync,
 		// Output either a buffer or image memory barrier.
 		if (sync->ref.obj.buffer != NULL)
 		{
-			VkBufferMemoryBarrier bmb = {
-				.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+			VkBufferMemoryBarrier2KHR bmb = {
+				.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2_KHR,
 
 				.pNext               = NULL,
 				.srcAccessMask       = sync->vk.srcAccess,
@@ -429,15 +815,14 @@ static bool _gfx_dep_push_barrier(const _GFXSync* sync,
 				.size                = sync->range.size
 			};
 
-			_GFX_INJ_OUTPUT(
-				injection->bars.numBufs, injection->bars.bufs,
-				sizeof(VkBufferMemoryBarrier), bmb,
-				return 0);
+			return _gfx_injection_push(
+				sync->vk.srcStage, sync->vk.dstStage,
+				&bmb, NULL, injection);
 		}
 		else
 		{
-			VkImageMemoryBarrier imb = {
-				.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			VkImageMemoryBarrier2KHR imb = {
+				.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR,
 
 				.pNext               = NULL,
 				.srcAccessMask       = sync->vk.srcAccess,
@@ -459,18 +844,16 @@ static bool _gfx_dep_push_barrier(const _GFXSync* sync,
 				}
 			};
 
-			_GFX_INJ_OUTPUT(
-				injection->bars.numImgs, injection->bars.imgs,
-				sizeof(VkImageMemoryBarrier), imb,
-				return 0);
+			return _gfx_injection_push(
+				sync->vk.srcStage, sync->vk.dstStage,
+				NULL, &imb, injection);
 		}
 	}
 
-	// In all cases (execution or memory barrier), add pipeline flags.
-	injection->bars.srcStage |= sync->vk.srcStage;
-	injection->bars.dstStage |= sync->vk.dstStage;
-
-	return 1;
+	// Otherwise it is an execution barrier only.
+	return _gfx_injection_push(
+		sync->vk.srcStage, sync->vk.dstStage,
+		NULL, NULL, injection);
 }
 
 /****************************/
@@ -486,10 +869,26 @@ bool _gfx_deps_catch(_GFXContext* context, VkCommandBuffer cmd,
 	assert(injection->inp.numRefs == 0 || injection->inp.masks != NULL);
 	assert(injection->inp.numRefs == 0 || injection->inp.sizes != NULL);
 
+	gfx_trace_begin(catch, "_gfx_deps_catch");
+
 	// We keep track of whether all operation references have been
 	// transitioned. So we can do initial layout transitions for images.
-	const size_t vlaRefs = injection->inp.numRefs > 0 ? injection->inp.numRefs : 1;
-	unsigned char transitioned[vlaRefs];
+	// Only allocate if they do not fit on the stack.
+	unsigned char stack[_GFX_INJ_STACK_REFS];
+	unsigned char* transitioned = stack;
+
+	if (injection->inp.numRefs > _GFX_INJ_STACK_REFS)
+	{
+		transitioned = _gfx_injection_realloc(
+			injection, NULL, 0, injection->inp.numRefs);
+
+		if (transitioned == NULL)
+		{
+			gfx_trace_end(catch);
+			return 0;
+		}
+	}
+
 	memset(transitioned, 0, injection->inp.numRefs);
 
 	// During a catch, we loop over all injections and filter out the
@@ -577,46 +976,54 @@ bool _gfx_deps_catch(_GFXContext* context, VkCommandBuffer cmd,
 				if (!_gfx_dep_push_barrier(sync, injection))
 				{
 					_gfx_mutex_unlock(&injs[i].dep->lock);
-					return 0;
+					goto error;
 				}
 
 			// Output the wait semaphore and stage if necessary.
 			if (sync->flags & _GFX_SYNC_SEMAPHORE)
 			{
 				size_t numWaits = injection->out.numWaits; // Placeholder.
+				size_t numValues = numWaits; // Placeholder.
 
 				_GFX_INJ_OUTPUT(
 					injection->out.numWaits, injection->out.waits,
 					sizeof(VkSemaphore), sync->vk.signaled,
 					{
 						_gfx_mutex_unlock(&injs[i].dep->lock);
-						return 0;
+						goto error;
 					});
 
 				_GFX_INJ_OUTPUT(
 					numWaits, injection->out.stages,
-					sizeof(VkPipelineStageFlagBits), sync->vk.semStages,
+					sizeof(VkPipelineStageFlags),
+					_GFX_GET_VK_PIPELINE_STAGE_LEGACY(sync->vk.semStages),
 					{
 						_gfx_mutex_unlock(&injs[i].dep->lock);
-						return 0;
+						goto error;
 					});
+
+				_GFX_INJ_OUTPUT(
+					numValues, injection->out.waitValues,
+					sizeof(uint64_t),
+					injs[i].dep->timeline ? sync->vk.value : 0,
+					{
+						_gfx_mutex_unlock(&injs[i].dep->lock);
+						goto error;
+					});
+
+				if (injs[i].dep->timeline)
+					injection->out.timeline = 1;
 			}
 		}
 
 		_gfx_mutex_unlock(&injs[i].dep->lock);
 	}
 
-	// Then flush all pushed barriers!
-	_gfx_injection_flush(context, cmd, injection);
-
 	// At this point we have processed all wait commands.
 	// For each operation reference, check if it has been transitioned.
-	// If not, record an initial layout transition for images.
-	// Merge them all into a single pipeline barrier command :)
-	uint32_t numImbs = 0;
-	VkImageMemoryBarrier imbs[vlaRefs];
-	VkPipelineStageFlagBits imbStages = 0;
-
+	// If not, push an initial layout transition for images.
+	// These never overlap with caught barriers, so we push them into the
+	// same batch, flushing everything with a single pipeline barrier :)
 	for (size_t r = 0; r < injection->inp.numRefs; ++r)
 	{
 		// If transitioned or a buffer, nothing to do.
@@ -628,9 +1035,9 @@ bool _gfx_deps_catch(_GFXContext* context, VkCommandBuffer cmd,
 			_GFX_UNPACK_REF_ATTACH(injection->inp.refs[r]);
 
 		GFXRange range;
-		VkAccessFlags flags;
+		VkAccessFlags2KHR flags;
 		VkImageLayout layout;
-		VkPipelineStageFlags stages;
+		VkPipelineStageFlags2KHR stages;
 
 		_gfx_unpack(context,
 			injection->inp.refs + r, attach,
@@ -638,8 +1045,8 @@ bool _gfx_deps_catch(_GFXContext* context, VkCommandBuffer cmd,
 			injection->inp.masks[r], GFX_STAGE_ANY,
 			&range, &flags, &layout, &stages);
 
-		imbs[numImbs++] = (VkImageMemoryBarrier){
-			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		const VkImageMemoryBarrier2KHR imb = {
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR,
 
 			.pNext               = NULL,
 			.srcAccessMask       = 0,
@@ -665,16 +1072,32 @@ bool _gfx_deps_catch(_GFXContext* context, VkCommandBuffer cmd,
 			}
 		};
 
-		imbStages |= stages;
+		if (!_gfx_injection_push(
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, stages, NULL, &imb, injection))
+		{
+			goto error;
+		}
 	}
 
-	if (numImbs > 0)
-		context->vk.CmdPipelineBarrier(cmd,
-			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-			imbStages,
-			0, 0, NULL, 0, NULL, numImbs, imbs);
+	// Then flush all pushed barriers!
+	_gfx_injection_flush(context, cmd, injection);
+
+	if (transitioned != stack && injection->arena == NULL)
+		free(transitioned);
+
+	gfx_trace_end(catch);
 
 	return 1;
+
+
+	// Error on failure.
+error:
+	if (transitioned != stack && injection->arena == NULL)
+		free(transitioned);
+
+	gfx_trace_end(catch);
+
+	return 0;
 }
 
 /****************************/
@@ -691,6 +1114,8 @@ bool _gfx_deps_prepare(_GFXContext* context, VkCommandBuffer cmd,
 	assert(injection->inp.numRefs == 0 || injection->inp.masks != NULL);
 	assert(injection->inp.numRefs == 0 || injection->inp.sizes != NULL);
 
+	gfx_trace_begin(prepare, "_gfx_deps_prepare");
+
 	// During a prepare, we again loop over all injections and filter out the
 	// signal commands. For each signal command we find the resources it is
 	// supposed to signal, claim a new synchronization object and 'prepare'
@@ -903,19 +1328,37 @@ bool _gfx_deps_prepare(_GFXContext* context, VkCommandBuffer cmd,
 					"could not claim synchronization object.");
 
 				_gfx_mutex_unlock(&injs[i].dep->lock);
-				return 0;
+				goto error;
 			}
 
 			// Output the signal semaphore if present.
+			// Timeline semaphores signal the next value.
 			if (sync->flags & _GFX_SYNC_SEMAPHORE)
+			{
+				size_t numValues = injection->out.numSigs; // Placeholder.
+
 				_GFX_INJ_OUTPUT(
 					injection->out.numSigs, injection->out.sigs,
 					sizeof(VkSemaphore), sync->vk.signaled,
 					{
 						_gfx_mutex_unlock(&injs[i].dep->lock);
-						return 0;
+						goto error;
 					});
 
+				if (injs[i].dep->timeline)
+					++sync->vk.value,
+					injection->out.timeline = 1;
+
+				_GFX_INJ_OUTPUT(
+					numValues, injection->out.sigValues,
+					sizeof(uint64_t),
+					injs[i].dep->timeline ? sync->vk.value : 0,
+					{
+						_gfx_mutex_unlock(&injs[i].dep->lock);
+						goto error;
+					});
+			}
+
 			// Now 'claim' the sync object & put it in the prepare stage.
 			sync->ref = refs[r];
 			sync->waits = injs[i].dep->waitCapacity; // Preemptively set.
@@ -995,9 +1438,9 @@ bool _gfx_deps_prepare(_GFXContext* context, VkCommandBuffer cmd,
 
 			// Set all destination operation values.
 			sync->vk.dstAccess =
-				_GFX_GET_VK_ACCESS_FLAGS(dstMask, fmt);
+				_GFX_GET_VK_ACCESS_FLAGS2(dstMask, fmt);
 			sync->vk.dstStage =
-				_GFX_GET_VK_PIPELINE_STAGE(dstMask, injs[i].stage, fmt);
+				_GFX_GET_VK_PIPELINE_STAGE2(dstMask, injs[i].stage, fmt);
 			sync->vk.dstStage =
 				_GFX_MOD_VK_PIPELINE_STAGE(sync->vk.dstStage, context);
 			sync->vk.newLayout =
@@ -1066,8 +1509,8 @@ bool _gfx_deps_prepare(_GFXContext* context, VkCommandBuffer cmd,
 
 			if (transfer || flushToHost)
 			{
-				const VkAccessFlags dstAccess = sync->vk.dstAccess;
-				const VkPipelineStageFlags dstStage = sync->vk.dstStage;
+				const VkAccessFlags2KHR dstAccess = sync->vk.dstAccess;
+				const VkPipelineStageFlags2KHR dstStage = sync->vk.dstStage;
 				const int flags = sync->flags;
 
 				// If we are transferring ownership:
@@ -1083,9 +1526,9 @@ bool _gfx_deps_prepare(_GFXContext* context, VkCommandBuffer cmd,
 				//  Remove barrier at the catch if not transferring.
 				if (flushToHost)
 					sync->vk.dstAccess |=
-						_GFX_GET_VK_ACCESS_FLAGS(hostMask, fmt),
+						_GFX_GET_VK_ACCESS_FLAGS2(hostMask, fmt),
 					sync->vk.dstStage |=
-						_GFX_GET_VK_PIPELINE_STAGE(hostMask, 0, fmt),
+						_GFX_GET_VK_PIPELINE_STAGE2(hostMask, 0, fmt),
 					sync->flags |=
 						_GFX_SYNC_BARRIER | _GFX_SYNC_MEM_HAZARD;
 
@@ -1093,7 +1536,7 @@ bool _gfx_deps_prepare(_GFXContext* context, VkCommandBuffer cmd,
 				{
 					// Just bail out, _gfx_deps_abort will clean!
 					_gfx_mutex_unlock(&injs[i].dep->lock);
-					return 0;
+					goto error;
 				}
 
 				if (flushToHost)
@@ -1121,7 +1564,16 @@ bool _gfx_deps_prepare(_GFXContext* context, VkCommandBuffer cmd,
 	// we flush _all_ pushed barriers from this prepare call.
 	_gfx_injection_flush(context, cmd, injection);
 
+	gfx_trace_end(prepare);
+
 	return 1;
+
+
+	// Error on failure.
+error:
+	gfx_trace_end(prepare);
+
+	return 0;
 }
 
 /****************************
@@ -1136,16 +1588,25 @@ static void _gfx_deps_finalize(size_t numInjs, const GFXInject* injs,
 	assert(injection != NULL);
 
 	// Free the injection metadata (always free() to allow external reallocs!).
-	free(injection->bars.bufs);
-	free(injection->bars.imgs);
-	free(injection->out.waits);
-	free(injection->out.sigs);
-	free(injection->out.stages);
+	// Unless it was allocated from an arena, it is released with the arena.
+	if (injection->arena == NULL)
+	{
+		free(injection->bars.bufs);
+		free(injection->bars.imgs);
+		free(injection->out.waits);
+		free(injection->out.sigs);
+		free(injection->out.stages);
+		free(injection->out.waitValues);
+		free(injection->out.sigValues);
+	}
+
 	injection->bars.bufs = NULL;
 	injection->bars.imgs = NULL;
 	injection->out.waits = NULL;
 	injection->out.sigs = NULL;
 	injection->out.stages = NULL;
+	injection->out.waitValues = NULL;
+	injection->out.sigValues = NULL;
 
 	// To finalize an injection, we loop over all synchronization objects of
 	// each command's dependency object. If it contains objects claimed by the
@@ -1181,15 +1642,28 @@ static void _gfx_deps_finalize(size_t numInjs, const GFXInject* injs,
 						_GFX_UNPACK_REF_ATTACH(sync->ref)->signaled = 0;
 				}
 
+				// Remember which queue signals a timeline semaphore,
+				// it can only be re-signaled from that queue.
+				if (success && dep->timeline &&
+					(sync->flags & _GFX_SYNC_SEMAPHORE) &&
+					(sync->stage == _GFX_SYNC_PREPARE ||
+					sync->stage == _GFX_SYNC_PREPARE_CATCH))
+				{
+					sync->vk.sigQueue.family = injection->inp.queue.family;
+					sync->vk.sigQueue.index = injection->inp.queue.index;
+				}
+
 				// If the object was only prepared, it is now pending.
 				// Otherwise it _must_ have been caught, in which case we
 				// advance it to used or unused.
-				// It only needs to be used if it has a semaphore,
+				// It only needs to be used if it has a binary semaphore,
 				// in which case we cannot reclaim this object yet...
+				// Timeline semaphores can be re-signaled immediately,
+				// but only from the same queue, see _gfx_dep_claim.
 				if (success) sync->stage =
 					(sync->stage == _GFX_SYNC_PREPARE) ?
 						_GFX_SYNC_PENDING :
-					(sync->flags & _GFX_SYNC_SEMAPHORE) ?
+					(sync->flags & _GFX_SYNC_SEMAPHORE) && !dep->timeline ?
 						_GFX_SYNC_USED :
 						_GFX_SYNC_UNUSED;
 
@@ -1226,8 +1700,10 @@ static void _gfx_deps_finalize(size_t numInjs, const GFXInject* injs,
 
 		// And now to the same for all sync objects with a semaphore.
 		// In the opposite direction.
+		// Timeline semaphores are never destroyed, waits might still be
+		// pending, instead they stay around for reuse.
 		move = 0;
-		for (size_t s = dep->sems; s > 0; --s)
+		for (size_t s = dep->timeline ? 0 : dep->sems; s > 0; --s)
 		{
 			_GFXSync* sync = gfx_deque_at(&dep->syncs, s - 1);
 			if (sync->stage == _GFX_SYNC_UNUSED)
@@ -103,49 +103,92 @@ static bool _gfx_contains_substr(const char* str, const char* substr)
 }
 
 
-#if defined (GFX_USE_VK_SUBSET_DEVICES)
-
 /****************************
- * Checks whether a given physical Vulkan device exposes the
+ * Retrieves all optional extensions a physical Vulkan device exposes.
+ * @param device Cannot be NULL, only device->vk.device needs to be set.
+ *
+ * Sets device->extensions, and device->subset if it exposes the
  * VK_KHR_portability_subset extension.
  */
-static bool _gfx_device_is_subset(VkPhysicalDevice device)
+static void _gfx_device_get_extensions(_GFXDevice* device)
 {
-	bool subset = 0;
+	assert(device != NULL);
+	assert(device->vk.device != NULL);
+
+	device->extensions = 0;
+#if defined (GFX_USE_VK_SUBSET_DEVICES)
+	device->subset = 0;
+#endif
 
 	uint32_t extCount;
 	_GFX_VK_CHECK(_groufix.vk.EnumerateDeviceExtensionProperties(
-		device, NULL, &extCount, NULL), extCount = 0);
+		device->vk.device, NULL, &extCount, NULL), extCount = 0);
 
-	if (extCount > 0)
+	if (extCount == 0)
+		return;
+
+	// May be many extensions, allocate on heap!
+	VkExtensionProperties* extProps =
+		calloc(extCount, sizeof(VkExtensionProperties));
+
+	if (extProps == NULL)
+		return;
+
+	_GFX_VK_CHECK(_groufix.vk.EnumerateDeviceExtensionProperties(
+		device->vk.device, NULL, &extCount, extProps), extCount = 0);
+
+	bool pipelineLibrary = 0;
+	bool graphicsLibrary = 0;
+	bool presentId = 0;
+	bool presentWait = 0;
+
+	for (uint32_t e = 0; e < extCount; ++e)
 	{
-		// May be many extensions, allocate on heap!
-		VkExtensionProperties* extProps =
-			calloc(extCount, sizeof(VkExtensionProperties));
+		const char* name = extProps[e].extensionName;
 
-		if (extProps != NULL)
-		{
-			_GFX_VK_CHECK(_groufix.vk.EnumerateDeviceExtensionProperties(
-				device, NULL, &extCount, extProps), extCount = 0);
+		if (strcmp(name, "VK_EXT_memory_budget") == 0)
+			device->extensions |= _GFX_EXT_MEMORY_BUDGET;
 
-			for (uint32_t e = 0; e < extCount; ++e)
-				if (strcmp(
-					extProps[e].extensionName,
-					"VK_KHR_portability_subset") == 0)
-				{
-					subset = 1;
-					break;
-				}
+		else if (strcmp(name, "VK_KHR_synchronization2") == 0)
+			device->extensions |= _GFX_EXT_SYNCHRONIZATION2;
 
-			free(extProps);
-		}
-	}
+		else if (strcmp(name, "VK_KHR_draw_indirect_count") == 0)
+			device->extensions |= _GFX_EXT_DRAW_INDIRECT_COUNT;
 
-	return subset;
-}
+		else if (strcmp(name, "VK_EXT_extended_dynamic_state") == 0)
+			device->extensions |= _GFX_EXT_EXTENDED_DYNAMIC_STATE;
+
+		else if (strcmp(name, "VK_KHR_push_descriptor") == 0)
+			device->extensions |= _GFX_EXT_PUSH_DESCRIPTOR;
+
+		else if (strcmp(name, "VK_KHR_pipeline_library") == 0)
+			pipelineLibrary = 1;
+
+		else if (strcmp(name, "VK_EXT_graphics_pipeline_library") == 0)
+			graphicsLibrary = 1;
+
+		else if (strcmp(name, "VK_KHR_present_id") == 0)
+			presentId = 1;
 
+		else if (strcmp(name, "VK_KHR_present_wait") == 0)
+			presentWait = 1;
+
+#if defined (GFX_USE_VK_SUBSET_DEVICES)
+		else if (strcmp(name, "VK_KHR_portability_subset") == 0)
+			device->subset = 1;
 #endif
+	}
+
+	// VK_EXT_graphics_pipeline_library depends on VK_KHR_pipeline_library.
+	if (pipelineLibrary && graphicsLibrary)
+		device->extensions |= _GFX_EXT_PIPELINE_LIBRARY;
 
+	// VK_KHR_present_wait depends on VK_KHR_present_id.
+	if (presentId && presentWait)
+		device->extensions |= _GFX_EXT_PRESENT_WAIT;
+
+	free(extProps);
+}
 
 /****************************
  * Fills a VkPhysicalDeviceFeatures struct with features to enable,
@@ -197,7 +240,6 @@ static void _gfx_get_device_features(_GFXDevice* device,
 #endif
 	pdf->sampleRateShading                       = VK_FALSE;
 	pdf->dualSrcBlend                            = VK_FALSE;
-	pdf->multiDrawIndirect                       = VK_FALSE;
 	pdf->depthClamp                              = VK_FALSE;
 	pdf->depthBiasClamp                          = VK_FALSE;
 	pdf->wideLines                               = VK_FALSE;
@@ -205,7 +247,6 @@ static void _gfx_get_device_features(_GFXDevice* device,
 	pdf->alphaToOne                              = VK_FALSE;
 	pdf->multiViewport                           = VK_FALSE;
 	pdf->occlusionQueryPrecise                   = VK_FALSE;
-	pdf->pipelineStatisticsQuery                 = VK_FALSE;
 	pdf->vertexPipelineStoresAndAtomics          = VK_FALSE;
 	pdf->fragmentStoresAndAtomics                = VK_FALSE;
 	pdf->shaderTessellationAndGeometryPointSize  = VK_FALSE;
@@ -215,8 +256,6 @@ static void _gfx_get_device_features(_GFXDevice* device,
 	pdf->shaderStorageImageReadWithoutFormat     = VK_FALSE;
 	pdf->shaderStorageImageWriteWithoutFormat    = VK_FALSE;
 	pdf->shaderUniformBufferArrayDynamicIndexing = VK_FALSE;
-	pdf->shaderSampledImageArrayDynamicIndexing  = VK_FALSE;
-	pdf->shaderStorageBufferArrayDynamicIndexing = VK_FALSE;
 	pdf->shaderStorageImageArrayDynamicIndexing  = VK_FALSE;
 	pdf->shaderResourceResidency                 = VK_FALSE;
 	pdf->shaderResourceMinLod                    = VK_FALSE;
@@ -248,39 +287,29 @@ static void _gfx_get_device_features(_GFXDevice* device,
 
 	if (pdv12f)
 	{
-		pdv12f->drawIndirectCount                                  = VK_FALSE;
 		pdv12f->storageBuffer8BitAccess                            = VK_FALSE;
 		pdv12f->uniformAndStorageBuffer8BitAccess                  = VK_FALSE;
 		pdv12f->shaderBufferInt64Atomics                           = VK_FALSE;
 		pdv12f->shaderSharedInt64Atomics                           = VK_FALSE;
-		pdv12f->descriptorIndexing                                 = VK_FALSE;
 		pdv12f->shaderInputAttachmentArrayDynamicIndexing          = VK_FALSE;
 		pdv12f->shaderUniformTexelBufferArrayDynamicIndexing       = VK_FALSE;
 		pdv12f->shaderStorageTexelBufferArrayDynamicIndexing       = VK_FALSE;
 		pdv12f->shaderUniformBufferArrayNonUniformIndexing         = VK_FALSE;
-		pdv12f->shaderSampledImageArrayNonUniformIndexing          = VK_FALSE;
-		pdv12f->shaderStorageBufferArrayNonUniformIndexing         = VK_FALSE;
 		pdv12f->shaderStorageImageArrayNonUniformIndexing          = VK_FALSE;
 		pdv12f->shaderInputAttachmentArrayNonUniformIndexing       = VK_FALSE;
 		pdv12f->shaderUniformTexelBufferArrayNonUniformIndexing    = VK_FALSE;
 		pdv12f->shaderStorageTexelBufferArrayNonUniformIndexing    = VK_FALSE;
 		pdv12f->descriptorBindingUniformBufferUpdateAfterBind      = VK_FALSE;
-		pdv12f->descriptorBindingSampledImageUpdateAfterBind       = VK_FALSE;
 		pdv12f->descriptorBindingStorageImageUpdateAfterBind       = VK_FALSE;
-		pdv12f->descriptorBindingStorageBufferUpdateAfterBind      = VK_FALSE;
 		pdv12f->descriptorBindingUniformTexelBufferUpdateAfterBind = VK_FALSE;
 		pdv12f->descriptorBindingStorageTexelBufferUpdateAfterBind = VK_FALSE;
-		pdv12f->descriptorBindingUpdateUnusedWhilePending          = VK_FALSE;
-		pdv12f->descriptorBindingPartiallyBound                    = VK_FALSE;
 		pdv12f->descriptorBindingVariableDescriptorCount           = VK_FALSE;
-		pdv12f->runtimeDescriptorArray                             = VK_FALSE;
 		pdv12f->scalarBlockLayout                                  = VK_FALSE;
 		pdv12f->imagelessFramebuffer                               = VK_FALSE;
 		pdv12f->uniformBufferStandardLayout                        = VK_FALSE;
 		pdv12f->shaderSubgroupExtendedTypes                        = VK_FALSE;
 		pdv12f->separateDepthStencilLayouts                        = VK_FALSE;
 		pdv12f->hostQueryReset                                     = VK_FALSE;
-		pdv12f->timelineSemaphore                                  = VK_FALSE;
 		pdv12f->bufferDeviceAddress                                = VK_FALSE;
 		pdv12f->bufferDeviceAddressCaptureReplay                   = VK_FALSE;
 		pdv12f->bufferDeviceAddressMultiDevice                     = VK_FALSE;
@@ -702,6 +731,17 @@ static void _gfx_destroy_context(_GFXContext* context)
 	if (context->vk.DestroyDevice != NULL)
 		context->vk.DestroyDevice(context->vk.device, NULL);
 
+#if !defined (NDEBUG)
+	gfx_log_debug(
+		"Logical Vulkan device destroyed, barrier statistics:\n"
+		"    #memory barriers pushed: %"PRIuMAX".\n"
+		"    #memory barriers merged: %"PRIuMAX".\n"
+		"    #pipeline barrier commands: %"PRIuMAX".\n",
+		(uintmax_t)atomic_load(&context->barriers.pushed),
+		(uintmax_t)atomic_load(&context->barriers.merged),
+		(uintmax_t)atomic_load(&context->barriers.flushes));
+#endif
+
 	_gfx_mutex_clear(&context->limits.samplerLock);
 	_gfx_mutex_clear(&context->limits.allocLock);
 	gfx_list_clear(&context->sets);
@@ -757,10 +797,16 @@ static void _gfx_create_context(_GFXDevice* device)
 
 	// Get supported feature flags.
 	context->features =
-		device->base.features.geometryShader ?
-			_GFX_SUPPORT_GEOMETRY_SHADER : 0 |
-		device->base.features.tessellationShader ?
-			_GFX_SUPPORT_TESSELLATION_SHADER : 0;
+		(device->base.features.geometryShader ?
+			_GFX_SUPPORT_GEOMETRY_SHADER : 0) |
+		(device->base.features.tessellationShader ?
+			_GFX_SUPPORT_TESSELLATION_SHADER : 0) |
+		(device->base.features.pipelineStatistics ?
+			_GFX_SUPPORT_PIPELINE_STATISTICS : 0) |
+		(device->base.features.drawIndirectCount ?
+			_GFX_SUPPORT_DRAW_INDIRECT_COUNT : 0) |
+		(device->extensions & _GFX_EXT_MEMORY_BUDGET ?
+			_GFX_SUPPORT_MEMORY_BUDGET : 0);
 
 	{
 		// Get allocation limits in a scope so pdp gets freed :)
@@ -792,6 +838,12 @@ static void _gfx_create_context(_GFXDevice* device)
 		atomic_store(&context->limits.shaders, 0);
 	}
 
+#if !defined (NDEBUG)
+	atomic_store(&context->barriers.pushed, 0);
+	atomic_store(&context->barriers.merged, 0);
+	atomic_store(&context->barriers.flushes, 0);
+#endif
+
 	// Insert itself in the context list.
 	gfx_list_insert_after(&_groufix.contexts, &context->list, NULL);
 	gfx_list_init(&context->sets);
@@ -827,22 +879,218 @@ static void _gfx_create_context(_GFXDevice* device)
 	VkPhysicalDeviceVulkan12Features pdv12f;
 	_GFX_GET_DEVICE_FEATURES(device, vk11, vk12, pdf, pdv11f, pdv12f);
 
-	// Enable VK_KHR_swapchain so we can interact with surfaces from GLFW.
-	// TODO: Enable VK_EXT_memory_budget?
-	const char* extensions[] = {
-		"VK_KHR_swapchain",
+	// Timeline semaphores are core since Vulkan 1.2, we do not bother
+	// with VK_KHR_timeline_semaphore, fences are used as fallback.
+	if (vk12 && pdv12f.timelineSemaphore)
+		context->features |= _GFX_SUPPORT_TIMELINE_SEMAPHORE;
 
-		// If a portability subset device, add VK_KHR_portability_subset.
-#if defined (GFX_USE_VK_SUBSET_DEVICES)
-		"VK_KHR_portability_subset"
-#endif
+	// Same for descriptor indexing, we do not bother with
+	// VK_EXT_descriptor_indexing, bindless sets are simply unavailable.
+	// Only check the features that bindless sets actually use.
+	if (
+		vk12 &&
+		pdf.shaderSampledImageArrayDynamicIndexing &&
+		pdf.shaderStorageBufferArrayDynamicIndexing &&
+		pdv12f.shaderSampledImageArrayNonUniformIndexing &&
+		pdv12f.shaderStorageBufferArrayNonUniformIndexing &&
+		pdv12f.descriptorBindingSampledImageUpdateAfterBind &&
+		pdv12f.descriptorBindingStorageBufferUpdateAfterBind &&
+		pdv12f.descriptorBindingUpdateUnusedWhilePending &&
+		pdv12f.descriptorBindingPartiallyBound &&
+		pdv12f.runtimeDescriptorArray)
+	{
+		context->features |= _GFX_SUPPORT_DESCRIPTOR_INDEXING;
+	}
+
+	// Synchronization2 is queried separately as it is an extension,
+	// without it we fall back to legacy barriers.
+	VkPhysicalDeviceSynchronization2FeaturesKHR pds2f = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR,
+		.pNext = NULL,
+		.synchronization2 = VK_FALSE
 	};
 
-	const uint32_t extensionCount =
+	if (device->extensions & _GFX_EXT_SYNCHRONIZATION2)
+	{
+		VkPhysicalDeviceFeatures2 pdf2 = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+			.pNext = &pds2f
+		};
+
+		_groufix.vk.GetPhysicalDeviceFeatures2(device->vk.device, &pdf2);
+
+		if (pds2f.synchronization2)
+			context->features |= _GFX_SUPPORT_SYNCHRONIZATION2;
+	}
+
+	// Same for extended dynamic state,
+	// without it we bake all state in the pipelines.
+	VkPhysicalDeviceExtendedDynamicStateFeaturesEXT pedsf = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT,
+		.pNext = NULL,
+		.extendedDynamicState = VK_FALSE
+	};
+
+	if (device->extensions & _GFX_EXT_EXTENDED_DYNAMIC_STATE)
+	{
+		VkPhysicalDeviceFeatures2 pdf2 = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+			.pNext = &pedsf
+		};
+
+		_groufix.vk.GetPhysicalDeviceFeatures2(device->vk.device, &pdf2);
+
+		if (pedsf.extendedDynamicState)
+			context->features |= _GFX_SUPPORT_EXTENDED_DYNAMIC_STATE;
+	}
+
+	// Same for graphics pipeline libraries, without it we compile every
+	// pipeline as a whole. Only use them if linking is actually fast.
+	VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pgplf = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT,
+		.pNext = NULL,
+		.graphicsPipelineLibrary = VK_FALSE
+	};
+
+	if (device->extensions & _GFX_EXT_PIPELINE_LIBRARY)
+	{
+		VkPhysicalDeviceFeatures2 pdf2 = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+			.pNext = &pgplf
+		};
+
+		VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT pgplp = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT,
+			.pNext = NULL,
+			.graphicsPipelineLibraryFastLinking = VK_FALSE
+		};
+
+		VkPhysicalDeviceProperties2 pdp2 = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+			.pNext = &pgplp
+		};
+
+		_groufix.vk.GetPhysicalDeviceFeatures2(device->vk.device, &pdf2);
+		_groufix.vk.GetPhysicalDeviceProperties2(device->vk.device, &pdp2);
+
+		if (pgplf.graphicsPipelineLibrary && pgplp.graphicsPipelineLibraryFastLinking)
+			context->features |= _GFX_SUPPORT_PIPELINE_LIBRARY;
+	}
+
+	// Push descriptors have no features, only a limit,
+	// without them every set is allocated from a descriptor pool.
+	context->limits.maxPushDescriptors = 0;
+
+	if (device->extensions & _GFX_EXT_PUSH_DESCRIPTOR)
+	{
+		VkPhysicalDevicePushDescriptorPropertiesKHR ppdp = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PUSH_DESCRIPTOR_PROPERTIES_KHR,
+			.pNext = NULL,
+			.maxPushDescriptors = 0
+		};
+
+		VkPhysicalDeviceProperties2 pdp2 = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+			.pNext = &ppdp
+		};
+
+		_groufix.vk.GetPhysicalDeviceProperties2(device->vk.device, &pdp2);
+
+		if (ppdp.maxPushDescriptors > 0)
+			context->features |= _GFX_SUPPORT_PUSH_DESCRIPTOR,
+			context->limits.maxPushDescriptors = ppdp.maxPushDescriptors;
+	}
+
+	// Same for present waits, without them frame pacing can only
+	// limit latency by waiting on the virtual frames themselves.
+	VkPhysicalDevicePresentIdFeaturesKHR ppif = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+		.pNext = NULL,
+		.presentId = VK_FALSE
+	};
+
+	VkPhysicalDevicePresentWaitFeaturesKHR ppwf = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+		.pNext = &ppif,
+		.presentWait = VK_FALSE
+	};
+
+	if (device->extensions & _GFX_EXT_PRESENT_WAIT)
+	{
+		VkPhysicalDeviceFeatures2 pdf2 = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+			.pNext = &ppwf
+		};
+
+		_groufix.vk.GetPhysicalDeviceFeatures2(device->vk.device, &pdf2);
+
+		if (ppif.presentId && ppwf.presentWait)
+			context->features |= _GFX_SUPPORT_PRESENT_WAIT;
+	}
+
+	// Chain them in front of the core feature structs.
+	void* featureChain = (vk11 ? (void*)&pdv11f : NULL);
+
+	if (context->features & _GFX_SUPPORT_SYNCHRONIZATION2)
+		pds2f.pNext = featureChain,
+		featureChain = &pds2f;
+
+	if (context->features & _GFX_SUPPORT_EXTENDED_DYNAMIC_STATE)
+		pedsf.pNext = featureChain,
+		featureChain = &pedsf;
+
+	if (context->features & _GFX_SUPPORT_PIPELINE_LIBRARY)
+		pgplf.pNext = featureChain,
+		featureChain = &pgplf;
+
+	if (context->features & _GFX_SUPPORT_PRESENT_WAIT)
+		ppif.pNext = featureChain,
+		featureChain = &ppwf;
+
+	// Indirect count draws are core since Vulkan 1.2,
+	// otherwise we need VK_KHR_draw_indirect_count.
+	const bool coreDrawCount = vk12 && pdv12f.drawIndirectCount;
+
+	// Enable VK_KHR_swapchain so we can interact with surfaces from GLFW.
+	// Enable VK_EXT_memory_budget if available so we can track heap budgets.
+	// Enable VK_KHR_synchronization2 if available for per-barrier stages.
+	// Enable VK_KHR_draw_indirect_count if available and not core.
+	// Enable VK_EXT_extended_dynamic_state if available for less pipelines.
+	// Enable VK_EXT_graphics_pipeline_library if available for fast linking.
+	// Enable VK_KHR_push_descriptor if available for per-draw sets.
+	// Enable VK_KHR_present_wait if available for frame pacing.
+	// The array must fit all extensions we could possibly enable.
+	const char* extensions[11];
+	uint32_t extensionCount = 0;
+	extensions[extensionCount++] = "VK_KHR_swapchain";
+
+	if (context->features & _GFX_SUPPORT_MEMORY_BUDGET)
+		extensions[extensionCount++] = "VK_EXT_memory_budget";
+
+	if (context->features & _GFX_SUPPORT_SYNCHRONIZATION2)
+		extensions[extensionCount++] = "VK_KHR_synchronization2";
+
+	if ((context->features & _GFX_SUPPORT_DRAW_INDIRECT_COUNT) && !coreDrawCount)
+		extensions[extensionCount++] = "VK_KHR_draw_indirect_count";
+
+	if (context->features & _GFX_SUPPORT_EXTENDED_DYNAMIC_STATE)
+		extensions[extensionCount++] = "VK_EXT_extended_dynamic_state";
+
+	if (context->features & _GFX_SUPPORT_PIPELINE_LIBRARY)
+		extensions[extensionCount++] = "VK_KHR_pipeline_library",
+		extensions[extensionCount++] = "VK_EXT_graphics_pipeline_library";
+
+	if (context->features & _GFX_SUPPORT_PUSH_DESCRIPTOR)
+		extensions[extensionCount++] = "VK_KHR_push_descriptor";
+
+	if (context->features & _GFX_SUPPORT_PRESENT_WAIT)
+		extensions[extensionCount++] = "VK_KHR_present_id",
+		extensions[extensionCount++] = "VK_KHR_present_wait";
+
+	// If a portability subset device, add VK_KHR_portability_subset.
 #if defined (GFX_USE_VK_SUBSET_DEVICES)
-		sizeof(extensions)/sizeof(char*) - (device->subset ? 0 : 1);
-#else
-		sizeof(extensions)/sizeof(char*);
+	if (device->subset)
+		extensions[extensionCount++] = "VK_KHR_portability_subset";
 #endif
 
 	// Enable VK_LAYER_KHRONOS_validation if debug,
@@ -855,7 +1103,7 @@ static void _gfx_create_context(_GFXDevice* device)
 	VkDeviceGroupDeviceCreateInfo dgdci = {
 		.sType = VK_STRUCTURE_TYPE_DEVICE_GROUP_DEVICE_CREATE_INFO,
 
-		.pNext               = (vk11 ? &pdv11f : NULL),
+		.pNext               = featureChain,
 		.physicalDeviceCount = (uint32_t)context->numDevices,
 		.pPhysicalDevices    = context->devices
 	};
@@ -950,6 +1198,7 @@ static void _gfx_create_context(_GFXDevice* device)
 	_GFX_GET_DEVICE_PROC_ADDR(BindBufferMemory);
 	_GFX_GET_DEVICE_PROC_ADDR(BindImageMemory);
 	_GFX_GET_DEVICE_PROC_ADDR(BeginCommandBuffer);
+	_GFX_GET_DEVICE_PROC_ADDR(CmdBeginQuery);
 	_GFX_GET_DEVICE_PROC_ADDR(CmdBeginRenderPass);
 	_GFX_GET_DEVICE_PROC_ADDR(CmdBindDescriptorSets);
 	_GFX_GET_DEVICE_PROC_ADDR(CmdBindIndexBuffer);
@@ -967,13 +1216,26 @@ static void _gfx_create_context(_GFXDevice* device)
 	_GFX_GET_DEVICE_PROC_ADDR(CmdDrawIndexed);
 	_GFX_GET_DEVICE_PROC_ADDR(CmdDrawIndexedIndirect);
 	_GFX_GET_DEVICE_PROC_ADDR(CmdDrawIndirect);
+	_GFX_GET_DEVICE_PROC_ADDR(CmdEndQuery);
 	_GFX_GET_DEVICE_PROC_ADDR(CmdEndRenderPass);
 	_GFX_GET_DEVICE_PROC_ADDR(CmdExecuteCommands);
+	_GFX_GET_DEVICE_PROC_ADDR(CmdNextSubpass);
 	_GFX_GET_DEVICE_PROC_ADDR(CmdPipelineBarrier);
 	_GFX_GET_DEVICE_PROC_ADDR(CmdPushConstants);
+	_GFX_GET_DEVICE_PROC_ADDR(CmdResetEvent);
+	_GFX_GET_DEVICE_PROC_ADDR(CmdResetQueryPool);
 	_GFX_GET_DEVICE_PROC_ADDR(CmdResolveImage);
+	_GFX_GET_DEVICE_PROC_ADDR(CmdSetBlendConstants);
+	_GFX_GET_DEVICE_PROC_ADDR(CmdSetDepthBounds);
+	_GFX_GET_DEVICE_PROC_ADDR(CmdSetDeviceMask);
+	_GFX_GET_DEVICE_PROC_ADDR(CmdSetEvent);
 	_GFX_GET_DEVICE_PROC_ADDR(CmdSetViewport);
 	_GFX_GET_DEVICE_PROC_ADDR(CmdSetScissor);
+	_GFX_GET_DEVICE_PROC_ADDR(CmdSetStencilCompareMask);
+	_GFX_GET_DEVICE_PROC_ADDR(CmdSetStencilReference);
+	_GFX_GET_DEVICE_PROC_ADDR(CmdSetStencilWriteMask);
+	_GFX_GET_DEVICE_PROC_ADDR(CmdWaitEvents);
+	_GFX_GET_DEVICE_PROC_ADDR(CmdWriteTimestamp);
 	_GFX_GET_DEVICE_PROC_ADDR(CreateBuffer);
 	_GFX_GET_DEVICE_PROC_ADDR(CreateBufferView);
 	_GFX_GET_DEVICE_PROC_ADDR(CreateCommandPool);
@@ -981,6 +1243,7 @@ static void _gfx_create_context(_GFXDevice* device)
 	_GFX_GET_DEVICE_PROC_ADDR(CreateDescriptorPool);
 	_GFX_GET_DEVICE_PROC_ADDR(CreateDescriptorSetLayout);
 	_GFX_GET_DEVICE_PROC_ADDR(CreateDescriptorUpdateTemplate);
+	_GFX_GET_DEVICE_PROC_ADDR(CreateEvent);
 	_GFX_GET_DEVICE_PROC_ADDR(CreateFence);
 	_GFX_GET_DEVICE_PROC_ADDR(CreateFramebuffer);
 	_GFX_GET_DEVICE_PROC_ADDR(CreateGraphicsPipelines);
@@ -988,6 +1251,7 @@ static void _gfx_create_context(_GFXDevice* device)
 	_GFX_GET_DEVICE_PROC_ADDR(CreateImageView);
 	_GFX_GET_DEVICE_PROC_ADDR(CreatePipelineCache);
 	_GFX_GET_DEVICE_PROC_ADDR(CreatePipelineLayout);
+	_GFX_GET_DEVICE_PROC_ADDR(CreateQueryPool);
 	_GFX_GET_DEVICE_PROC_ADDR(CreateRenderPass);
 	_GFX_GET_DEVICE_PROC_ADDR(CreateSampler);
 	_GFX_GET_DEVICE_PROC_ADDR(CreateSemaphore);
@@ -999,6 +1263,7 @@ static void _gfx_create_context(_GFXDevice* device)
 	_GFX_GET_DEVICE_PROC_ADDR(DestroyDescriptorPool);
 	_GFX_GET_DEVICE_PROC_ADDR(DestroyDescriptorSetLayout);
 	_GFX_GET_DEVICE_PROC_ADDR(DestroyDescriptorUpdateTemplate);
+	_GFX_GET_DEVICE_PROC_ADDR(DestroyEvent);
 	_GFX_GET_DEVICE_PROC_ADDR(DestroyFence);
 	_GFX_GET_DEVICE_PROC_ADDR(DestroyFramebuffer);
 	_GFX_GET_DEVICE_PROC_ADDR(DestroyImage);
@@ -1006,12 +1271,14 @@ static void _gfx_create_context(_GFXDevice* device)
 	_GFX_GET_DEVICE_PROC_ADDR(DestroyPipeline);
 	_GFX_GET_DEVICE_PROC_ADDR(DestroyPipelineCache);
 	_GFX_GET_DEVICE_PROC_ADDR(DestroyPipelineLayout);
+	_GFX_GET_DEVICE_PROC_ADDR(DestroyQueryPool);
 	_GFX_GET_DEVICE_PROC_ADDR(DestroyRenderPass);
 	_GFX_GET_DEVICE_PROC_ADDR(DestroySampler);
 	_GFX_GET_DEVICE_PROC_ADDR(DestroySemaphore);
 	_GFX_GET_DEVICE_PROC_ADDR(DestroyShaderModule);
 	_GFX_GET_DEVICE_PROC_ADDR(DestroySwapchainKHR);
 	_GFX_GET_DEVICE_PROC_ADDR(EndCommandBuffer);
+	_GFX_GET_DEVICE_PROC_ADDR(FlushMappedMemoryRanges);
 	_GFX_GET_DEVICE_PROC_ADDR(FreeCommandBuffers);
 	_GFX_GET_DEVICE_PROC_ADDR(FreeMemory);
 	_GFX_GET_DEVICE_PROC_ADDR(GetBufferMemoryRequirements);
@@ -1021,7 +1288,9 @@ static void _gfx_create_context(_GFXDevice* device)
 	_GFX_GET_DEVICE_PROC_ADDR(GetImageMemoryRequirements);
 	_GFX_GET_DEVICE_PROC_ADDR(GetImageMemoryRequirements2);
 	_GFX_GET_DEVICE_PROC_ADDR(GetPipelineCacheData);
+	_GFX_GET_DEVICE_PROC_ADDR(GetQueryPoolResults);
 	_GFX_GET_DEVICE_PROC_ADDR(GetSwapchainImagesKHR);
+	_GFX_GET_DEVICE_PROC_ADDR(InvalidateMappedMemoryRanges);
 	_GFX_GET_DEVICE_PROC_ADDR(MapMemory);
 	_GFX_GET_DEVICE_PROC_ADDR(MergePipelineCaches);
 	_GFX_GET_DEVICE_PROC_ADDR(QueuePresentKHR);
@@ -1030,9 +1299,81 @@ static void _gfx_create_context(_GFXDevice* device)
 	_GFX_GET_DEVICE_PROC_ADDR(ResetDescriptorPool);
 	_GFX_GET_DEVICE_PROC_ADDR(ResetFences);
 	_GFX_GET_DEVICE_PROC_ADDR(UnmapMemory);
+	_GFX_GET_DEVICE_PROC_ADDR(UpdateDescriptorSets);
 	_GFX_GET_DEVICE_PROC_ADDR(UpdateDescriptorSetWithTemplate);
 	_GFX_GET_DEVICE_PROC_ADDR(WaitForFences);
 
+	// Load optional Vulkan functions.
+	context->vk.GetSemaphoreCounterValue = NULL;
+	context->vk.WaitSemaphores = NULL;
+	context->vk.CmdPipelineBarrier2KHR = NULL;
+	context->vk.CmdPushDescriptorSetWithTemplateKHR = NULL;
+	context->vk.CmdDrawIndexedIndirectCount = NULL;
+	context->vk.CmdDrawIndirectCount = NULL;
+	context->vk.CmdSetCullModeEXT = NULL;
+	context->vk.CmdSetDepthBoundsTestEnableEXT = NULL;
+	context->vk.CmdSetDepthCompareOpEXT = NULL;
+	context->vk.CmdSetDepthTestEnableEXT = NULL;
+	context->vk.CmdSetDepthWriteEnableEXT = NULL;
+	context->vk.CmdSetFrontFaceEXT = NULL;
+	context->vk.CmdSetStencilOpEXT = NULL;
+	context->vk.CmdSetStencilTestEnableEXT = NULL;
+	context->vk.WaitForPresentKHR = NULL;
+
+	if (context->features & _GFX_SUPPORT_TIMELINE_SEMAPHORE)
+	{
+		_GFX_GET_DEVICE_PROC_ADDR(GetSemaphoreCounterValue);
+		_GFX_GET_DEVICE_PROC_ADDR(WaitSemaphores);
+	}
+
+	if (context->features & _GFX_SUPPORT_SYNCHRONIZATION2)
+		_GFX_GET_DEVICE_PROC_ADDR(CmdPipelineBarrier2KHR);
+
+	if (context->features & _GFX_SUPPORT_PUSH_DESCRIPTOR)
+		_GFX_GET_DEVICE_PROC_ADDR(CmdPushDescriptorSetWithTemplateKHR);
+
+	if (context->features & _GFX_SUPPORT_PRESENT_WAIT)
+		_GFX_GET_DEVICE_PROC_ADDR(WaitForPresentKHR);
+
+	if (context->features & _GFX_SUPPORT_EXTENDED_DYNAMIC_STATE)
+	{
+		_GFX_GET_DEVICE_PROC_ADDR(CmdSetCullModeEXT);
+		_GFX_GET_DEVICE_PROC_ADDR(CmdSetDepthBoundsTestEnableEXT);
+		_GFX_GET_DEVICE_PROC_ADDR(CmdSetDepthCompareOpEXT);
+		_GFX_GET_DEVICE_PROC_ADDR(CmdSetDepthTestEnableEXT);
+		_GFX_GET_DEVICE_PROC_ADDR(CmdSetDepthWriteEnableEXT);
+		_GFX_GET_DEVICE_PROC_ADDR(CmdSetFrontFaceEXT);
+		_GFX_GET_DEVICE_PROC_ADDR(CmdSetStencilOpEXT);
+		_GFX_GET_DEVICE_PROC_ADDR(CmdSetStencilTestEnableEXT);
+	}
+
+	if (context->features & _GFX_SUPPORT_DRAW_INDIRECT_COUNT)
+	{
+		if (coreDrawCount)
+		{
+			_GFX_GET_DEVICE_PROC_ADDR(CmdDrawIndexedIndirectCount);
+			_GFX_GET_DEVICE_PROC_ADDR(CmdDrawIndirectCount);
+		}
+		else
+		{
+			// Load the extension aliases into the core function pointers.
+			context->vk.CmdDrawIndexedIndirectCount =
+				(PFN_vkCmdDrawIndexedIndirectCount)_groufix.vk.GetDeviceProcAddr(
+					context->vk.device, "vkCmdDrawIndexedIndirectCountKHR");
+			context->vk.CmdDrawIndirectCount =
+				(PFN_vkCmdDrawIndirectCount)_groufix.vk.GetDeviceProcAddr(
+					context->vk.device, "vkCmdDrawIndirectCountKHR");
+
+			if (
+				context->vk.CmdDrawIndexedIndirectCount == NULL ||
+				context->vk.CmdDrawIndirectCount == NULL)
+			{
+				gfx_log_error("Could not load vkCmdDraw*IndirectCountKHR.");
+				goto clean;
+			}
+		}
+	}
+
 	// Set device's reference to this context.
 	device->context = context;
 
@@ -1105,12 +1446,11 @@ bool _gfx_devices_init(void)
 			dev.name, pdp->deviceName,
 			VK_MAX_PHYSICAL_DEVICE_NAME_SIZE);
 
-#if defined (GFX_USE_VK_SUBSET_DEVICES)
-		// If we're including portability subset devices, we need to check if
-		// the device exposes VK_KHR_portability_subset.
+		// Check for optional extensions, if we're including portability
+		// subset devices, this also checks if the device exposes
+		// VK_KHR_portability_subset.
 		// If it does, we need to enable the extension in the device.
-		dev.subset = _gfx_device_is_subset(devices[i]);
-#endif
+		_gfx_device_get_extensions(&dev);
 
 		// Get all Vulkan device features as well.
 		bool vk11, vk12;
@@ -1188,6 +1528,11 @@ bool _gfx_devices_init(void)
 				.samplerAnisotropy        = pdf.samplerAnisotropy,
 				.samplerClampToEdgeMirror = (vk12 ? pdv12f.samplerMirrorClampToEdge : 0),
 				.samplerMinmax            = (vk12 ? pdv12f.samplerFilterMinmax : 0),
+				.pipelineStatistics       = pdf.pipelineStatisticsQuery,
+				.multiDrawIndirect        = pdf.multiDrawIndirect,
+				.drawIndirectCount        =
+					(vk12 && pdv12f.drawIndirectCount) ||
+					(dev.extensions & _GFX_EXT_DRAW_INDIRECT_COUNT),
 
 				.inlineCompute = available && (props[families[0]].queueFlags & VK_QUEUE_COMPUTE_BIT)
 			},
@@ -1213,6 +1558,8 @@ bool _gfx_devices_init(void)
 				.maxAttachmentHeight   = pdp->limits.maxFramebufferHeight,
 				.maxAttachmentLayers   = pdp->limits.maxFramebufferLayers,
 				.maxAttachmentOutputs  = pdp->limits.maxColorAttachments,
+				.maxIndirectCount      = pdf.multiDrawIndirect ?
+					pdp->limits.maxDrawIndirectCount : 1,
 
 				.maxStageUniformBuffers   = pdp->limits.maxPerStageDescriptorUniformBuffers,
 				.maxStageStorageBuffers   = pdp->limits.maxPerStageDescriptorStorageBuffers,
@@ -8,13 +8,26 @@
 
 #include "groufix/core/objects.h"
 #include <assert.h>
+#include <limits.h>
 #include <stdlib.h>
 
 
+// Minimum number of passes recorded by a single worker.
+#define _GFX_FRAME_MIN_PASSES 8
+
+// Minimum block size of the transient host memory of a virtual frame.
+#define _GFX_FRAME_ARENA_SIZE 16384
+
+// Number of resets after which unused transient memory ring chunks are freed.
+#define _GFX_FRAME_RING_TRIM 64
+
+
 // Grows an injection output array & auto log, elems is an lvalue.
-#define _GFX_INJ_GROW(elems, size, num, action) \
+// Preserves the first `old` elements.
+#define _GFX_INJ_GROW(injection, elems, size, old, num, action) \
 	do { \
-		void* _gfx_inj_ptr = realloc(elems, size * (num)); \
+		void* _gfx_inj_ptr = _gfx_injection_realloc( \
+			injection, elems, size * (old), size * (num)); \
 		if (_gfx_inj_ptr == NULL) { \
 			gfx_log_error("Could not grow injection metadata output."); \
 			action; \
@@ -100,6 +113,89 @@ clean:
 	return 0;
 }
 
+/****************************
+ * Allocates a new pass range and pushes it into the frame's ranges.
+ * @param renderer Cannot be NULL.
+ * @param frame    Cannot be NULL.
+ * @return Zero on failure.
+ */
+static bool _gfx_frame_push_range(GFXRenderer* renderer, GFXFrame* frame)
+{
+	assert(renderer != NULL);
+	assert(frame != NULL);
+
+	_GFXContext* context = renderer->cache.context;
+	_GFXFrameRange range;
+
+	// Each range gets its own command pool,
+	// so multiple threads can record to different ranges.
+	// These buffers will be reset and re-recorded every frame.
+	VkCommandPoolCreateInfo cpci = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+
+		.pNext            = NULL,
+		.queueFamilyIndex = renderer->graphics.family,
+		.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT
+	};
+
+	_GFX_VK_CHECK(
+		context->vk.CreateCommandPool(
+			context->vk.device, &cpci, NULL, &range.vk.pool),
+		goto error);
+
+	VkCommandBufferAllocateInfo cbai = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+
+		.pNext              = NULL,
+		.commandPool        = range.vk.pool,
+		.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+		.commandBufferCount = 2
+	};
+
+	VkCommandBuffer cmds[2];
+	_GFX_VK_CHECK(
+		context->vk.AllocateCommandBuffers(
+			context->vk.device, &cbai, cmds),
+		goto clean);
+
+	range.vk.cmd = cmds[0];
+	range.vk.post = cmds[1];
+
+	if (!gfx_vec_push(&frame->ranges, 1, &range))
+		goto clean;
+
+	return 1;
+
+
+	// Cleanup on failure.
+clean:
+	context->vk.DestroyCommandPool(
+		context->vk.device, range.vk.pool, NULL);
+error:
+	gfx_log_error("Could not allocate a pass range of a virtual frame.");
+
+	return 0;
+}
+
+/****************************
+ * Destroys all pass ranges of a virtual frame.
+ * @param renderer Cannot be NULL.
+ * @param frame    Cannot be NULL.
+ */
+static void _gfx_frame_clear_ranges(GFXRenderer* renderer, GFXFrame* frame)
+{
+	assert(renderer != NULL);
+	assert(frame != NULL);
+
+	_GFXContext* context = renderer->cache.context;
+
+	for (size_t r = 0; r < frame->ranges.size; ++r)
+		context->vk.DestroyCommandPool(context->vk.device,
+			((_GFXFrameRange*)gfx_vec_at(&frame->ranges, r))->vk.pool, NULL);
+
+	gfx_vec_clear(&frame->ranges);
+}
+
 /****************************/
 bool _gfx_frame_init(GFXRenderer* renderer, GFXFrame* frame, unsigned int index)
 {
@@ -110,13 +206,38 @@ bool _gfx_frame_init(GFXRenderer* renderer, GFXFrame* frame, unsigned int index)
 
 	// Initialize things.
 	frame->index = index;
+	frame->devices = _GFX_CONTEXT_DEVICES(context);
 	frame->submitted = 0;
 
 	gfx_vec_init(&frame->refs, sizeof(size_t));
 	gfx_vec_init(&frame->syncs, sizeof(_GFXFrameSync));
+	gfx_vec_init(&frame->events, sizeof(VkEvent));
+	gfx_vec_init(&frame->ranges, sizeof(_GFXFrameRange));
+	gfx_vec_init(&frame->ring.chunks, sizeof(_GFXFrameChunk));
+	gfx_vec_init(&frame->timer.timers, sizeof(_GFXFrameTimer));
+	gfx_vec_init(&frame->timer.timings, sizeof(GFXTiming));
+	gfx_vec_init(&frame->reads.pending, sizeof(_GFXFrameRead));
+	gfx_vec_init(&frame->reads.active, sizeof(GFXReadback*));
+	gfx_arena_init(&frame->arena, _GFX_FRAME_ARENA_SIZE);
+
+	for (size_t w = 0; w < _GFX_FRAME_MAX_WORKERS - 1; ++w)
+		gfx_arena_init(&frame->workers[w], _GFX_FRAME_ARENA_SIZE);
+
+	frame->ring.current = 0;
+	frame->ring.offset = 0;
+	frame->ring.peak = 0;
+	frame->ring.resets = 0;
+	frame->timer.count = 0;
+	frame->timer.block = 0;
+
+	if (!_gfx_mutex_init(&frame->ring.lock))
+	{
+		gfx_log_error("Could not create virtual frame.");
+		return 0;
+	}
 
 	frame->vk.rendered = VK_NULL_HANDLE;
-	frame->vk.graphics.pool = VK_NULL_HANDLE;
+	frame->vk.queries = VK_NULL_HANDLE;
 	frame->vk.graphics.done = VK_NULL_HANDLE;
 	frame->vk.compute.pool = VK_NULL_HANDLE;
 	frame->vk.compute.done = VK_NULL_HANDLE;
@@ -150,16 +271,8 @@ bool _gfx_frame_init(GFXRenderer* renderer, GFXFrame* frame, unsigned int index)
 			context->vk.device, &fci, NULL, &frame->vk.compute.done),
 		goto clean);
 
-	// Create command pools.
+	// Create the compute command pool.
 	// These buffers will be reset and re-recorded every frame.
-	VkCommandPoolCreateInfo gcpci = {
-		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-
-		.pNext            = NULL,
-		.queueFamilyIndex = renderer->graphics.family,
-		.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT
-	};
-
 	VkCommandPoolCreateInfo ccpci = {
 		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
 
@@ -168,25 +281,16 @@ bool _gfx_frame_init(GFXRenderer* renderer, GFXFrame* frame, unsigned int index)
 		.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT
 	};
 
-	_GFX_VK_CHECK(
-		context->vk.CreateCommandPool(
-			context->vk.device, &gcpci, NULL, &frame->vk.graphics.pool),
-		goto clean);
-
 	_GFX_VK_CHECK(
 		context->vk.CreateCommandPool(
 			context->vk.device, &ccpci, NULL, &frame->vk.compute.pool),
 		goto clean);
 
 	// Lastly, allocate the command buffers for this frame.
-	VkCommandBufferAllocateInfo gcbai = {
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-
-		.pNext              = NULL,
-		.commandPool        = frame->vk.graphics.pool,
-		.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-		.commandBufferCount = 1
-	};
+	// Graphics command buffers are allocated per pass range,
+	// we always have at least one.
+	if (!_gfx_frame_push_range(renderer, frame))
+		goto clean;
 
 	VkCommandBufferAllocateInfo ccbai = {
 		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
@@ -197,11 +301,6 @@ bool _gfx_frame_init(GFXRenderer* renderer, GFXFrame* frame, unsigned int index)
 		.commandBufferCount = 1
 	};
 
-	_GFX_VK_CHECK(
-		context->vk.AllocateCommandBuffers(
-			context->vk.device, &gcbai, &frame->vk.graphics.cmd),
-		goto clean);
-
 	_GFX_VK_CHECK(
 		context->vk.AllocateCommandBuffers(
 			context->vk.device, &ccbai, &frame->vk.compute.cmd),
@@ -216,8 +315,6 @@ clean:
 
 	context->vk.DestroySemaphore(
 		context->vk.device, frame->vk.rendered, NULL);
-	context->vk.DestroyCommandPool(
-		context->vk.device, frame->vk.graphics.pool, NULL);
 	context->vk.DestroyFence(
 		context->vk.device, frame->vk.graphics.done, NULL);
 	context->vk.DestroyCommandPool(
@@ -225,8 +322,21 @@ clean:
 	context->vk.DestroyFence(
 		context->vk.device, frame->vk.compute.done, NULL);
 
+	_gfx_frame_clear_ranges(renderer, frame);
 	gfx_vec_clear(&frame->refs);
 	gfx_vec_clear(&frame->syncs);
+	gfx_vec_clear(&frame->events);
+	gfx_vec_clear(&frame->ring.chunks);
+	gfx_vec_clear(&frame->timer.timers);
+	gfx_vec_clear(&frame->timer.timings);
+	gfx_vec_clear(&frame->reads.pending);
+	gfx_vec_clear(&frame->reads.active);
+	gfx_arena_clear(&frame->arena);
+
+	for (size_t w = 0; w < _GFX_FRAME_MAX_WORKERS - 1; ++w)
+		gfx_arena_clear(&frame->workers[w]);
+
+	_gfx_mutex_clear(&frame->ring.lock);
 
 	return 0;
 }
@@ -241,8 +351,8 @@ void _gfx_frame_clear(GFXRenderer* renderer, GFXFrame* frame)
 
 	// First wait for the frame to be done.
 	const uint32_t numFences =
-		(frame->submitted & _GFX_FRAME_GRAPHICS) ? 1 : 0 +
-		(frame->submitted & _GFX_FRAME_COMPUTE) ? 1 : 0;
+		((frame->submitted & _GFX_FRAME_GRAPHICS) ? 1 : 0) +
+		((frame->submitted & _GFX_FRAME_COMPUTE) ? 1 : 0);
 
 	if (numFences > 0)
 	{
@@ -259,18 +369,49 @@ void _gfx_frame_clear(GFXRenderer* renderer, GFXFrame* frame)
 	// Then destroy.
 	context->vk.DestroySemaphore(
 		context->vk.device, frame->vk.rendered, NULL);
-	context->vk.DestroyCommandPool(
-		context->vk.device, frame->vk.graphics.pool, NULL);
 	context->vk.DestroyFence(
 		context->vk.device, frame->vk.graphics.done, NULL);
 	context->vk.DestroyCommandPool(
 		context->vk.device, frame->vk.compute.pool, NULL);
 	context->vk.DestroyFence(
 		context->vk.device, frame->vk.compute.done, NULL);
+	context->vk.DestroyQueryPool(
+		context->vk.device, frame->vk.queries, NULL);
 
+	for (size_t e = 0; e < frame->events.size; ++e)
+		context->vk.DestroyEvent(context->vk.device,
+			*(VkEvent*)gfx_vec_at(&frame->events, e), NULL);
+
+	_gfx_frame_clear_ranges(renderer, frame);
 	_gfx_free_syncs(renderer, frame, frame->syncs.size);
 	gfx_vec_clear(&frame->refs);
 	gfx_vec_clear(&frame->syncs);
+	gfx_vec_clear(&frame->events);
+
+	// Free the transient memory ring.
+	for (size_t c = 0; c < frame->ring.chunks.size; ++c)
+	{
+		_GFXFrameChunk* chunk = gfx_vec_at(&frame->ring.chunks, c);
+		gfx_unmap(gfx_ref_buffer(chunk->buffer));
+		gfx_free_buffer(chunk->buffer);
+	}
+
+	gfx_vec_clear(&frame->ring.chunks);
+	_gfx_mutex_clear(&frame->ring.lock);
+
+	// Free all readbacks, blocks until the device is done with them.
+	for (size_t r = 0; r < frame->reads.active.size; ++r)
+		gfx_readback_free(*(GFXReadback**)gfx_vec_at(&frame->reads.active, r));
+
+	gfx_vec_clear(&frame->reads.pending);
+	gfx_vec_clear(&frame->reads.active);
+
+	gfx_vec_clear(&frame->timer.timers);
+	gfx_vec_clear(&frame->timer.timings);
+	gfx_arena_clear(&frame->arena);
+
+	for (size_t w = 0; w < _GFX_FRAME_MAX_WORKERS - 1; ++w)
+		gfx_arena_clear(&frame->workers[w]);
 }
 
 /****************************/
@@ -290,12 +431,178 @@ uint32_t _gfx_frame_get_swapchain_index(GFXFrame* frame, size_t index)
 	return sync->image;
 }
 
+/****************************
+ * Retrieves the host time in nanoseconds.
+ */
+static inline uint64_t _gfx_frame_time(void)
+{
+	const uint64_t freq = glfwGetTimerFrequency();
+	const uint64_t ticks = glfwGetTimerValue();
+
+	return
+		ticks / freq * UINT64_C(1000000000) +
+		ticks % freq * UINT64_C(1000000000) / freq;
+}
+
+/****************************
+ * Measures the interval since the previous presentation of a renderer.
+ * @param renderer Cannot be NULL, must have just presented.
+ * @param virtual  Non-zero if presenting virtually, blocks for the interval.
+ */
+static void _gfx_frame_pace(GFXRenderer* renderer, bool virtual)
+{
+	assert(renderer != NULL);
+
+	uint64_t time = _gfx_frame_time();
+	const uint64_t prev = renderer->pacing.time;
+
+	// When presenting virtually, we are the display,
+	// sleep (in whole milliseconds) until the interval has passed.
+	if (virtual && prev != 0)
+		while (time >= prev && time - prev < renderer->pacing.interval)
+		{
+			const uint64_t left = renderer->pacing.interval - (time - prev);
+			_gfx_thread_sleep((unsigned int)GFX_MIN(
+				(left + UINT64_C(999999)) / UINT64_C(1000000), UINT_MAX));
+
+			time = _gfx_frame_time();
+		}
+
+	renderer->pacing.time = time;
+
+	if (prev == 0 || time < prev) return;
+
+	// Moving averages over roughly the last 16 intervals,
+	// the first interval simply initializes them.
+	GFXPacingStats* stats = &renderer->pacing.stats;
+	const uint64_t interval = time - prev;
+
+	if (stats->count == 0)
+		stats->average = interval,
+		stats->jitter = 0;
+	else
+	{
+		const uint64_t deviation = interval > stats->average ?
+			interval - stats->average : stats->average - interval;
+
+		stats->average = stats->average - stats->average / 16 + interval / 16;
+		stats->jitter = stats->jitter - stats->jitter / 16 + deviation / 16;
+	}
+
+	stats->last = interval;
+	++stats->count;
+}
+
+/****************************
+ * Resolves all written timestamps of a virtual frame into timings,
+ * previous timings are discarded.
+ * @param renderer Cannot be NULL.
+ * @param frame    Cannot be NULL, must be done rendering.
+ * @return Zero on failure.
+ */
+static bool _gfx_frame_resolve_timers(GFXRenderer* renderer, GFXFrame* frame)
+{
+	assert(renderer != NULL);
+	assert(frame != NULL);
+
+	assert(frame->timer.timers.size > 0);
+
+	_GFXContext* context = renderer->cache.context;
+	GFXVec* timers = &frame->timer.timers;
+
+	if (frame->timer.timings.size > 0)
+		gfx_vec_pop(&frame->timer.timings, frame->timer.timings.size);
+
+	// Unwritten timers may not have been reset,
+	// so we get the results of each run of written timers at once.
+	// Do not wait, the frame is done, if not available it was never
+	// written, in which case we have no timing for it.
+	for (size_t t = 0, run; t < timers->size; t += run)
+	{
+		run = 0;
+		while (
+			t + run < timers->size &&
+			((_GFXFrameTimer*)gfx_vec_at(timers, t + run))->pass != NULL)
+		{
+			++run;
+		}
+
+		if (run == 0)
+		{
+			run = 1;
+			continue;
+		}
+
+		// Each query outputs its timestamp and availability.
+		uint64_t* stamps =
+			gfx_arena_alloc(&frame->arena, sizeof(uint64_t) * run * 4);
+
+		if (stamps == NULL)
+			goto error;
+
+		// Not ready is expected if some timers were not written,
+		// e.g. if the frame did not record all passes, those are skipped.
+		const VkResult result = context->vk.GetQueryPoolResults(
+			context->vk.device, frame->vk.queries,
+			(uint32_t)(t * 2), (uint32_t)(run * 2),
+			sizeof(uint64_t) * run * 4, stamps, sizeof(uint64_t) * 2,
+			VK_QUERY_RESULT_64_BIT |
+			VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+		if (result != VK_SUCCESS && result != VK_NOT_READY)
+		{
+			_GFX_VK_CHECK(result, {});
+			goto error;
+		}
+
+		for (size_t r = 0; r < run; ++r)
+		{
+			const _GFXFrameTimer* timer = gfx_vec_at(timers, t + r);
+			const uint64_t* stamp = stamps + r * 4;
+
+			if (stamp[1] == 0 || stamp[3] == 0)
+				continue;
+
+			if (!gfx_vec_push(&frame->timer.timings, 1, NULL))
+				goto error;
+
+			GFXTiming* timing = gfx_vec_at(&frame->timer.timings,
+				frame->timer.timings.size - 1);
+
+			// Mask out the invalid bits to deal with wrapping.
+			const uint64_t ticks = (stamp[2] - stamp[0]) &
+				(timer->compute ?
+					renderer->profile.compute : renderer->profile.graphics);
+
+			timing->pass = timer->pass;
+			timing->recorder = timer->recorder;
+			timing->time = (uint64_t)
+				((double)ticks * (double)renderer->profile.period);
+		}
+	}
+
+	gfx_vec_pop(timers, timers->size);
+
+	return 1;
+
+
+	// Error on failure.
+error:
+	gfx_log_warn("Could not resolve timestamps of a virtual frame.");
+
+	gfx_vec_pop(timers, timers->size);
+
+	return 0;
+}
+
 /****************************/
 bool _gfx_frame_sync(GFXRenderer* renderer, GFXFrame* frame, bool reset)
 {
 	assert(renderer != NULL);
 	assert(frame != NULL);
 
+	gfx_trace_begin(sync, "_gfx_frame_sync");
+
 	_GFXContext* context = renderer->cache.context;
 
 	// We wait for the frame to be done, so all its resource are
@@ -303,8 +610,8 @@ bool _gfx_frame_sync(GFXRenderer* renderer, GFXFrame* frame, bool reset)
 	// Also immediately reset it, luckily the renderer does not sync this
 	// frame whenever we call _gfx_sync_frames so it's fine.
 	const uint32_t numFences =
-		(frame->submitted & _GFX_FRAME_GRAPHICS) ? 1 : 0 +
-		(frame->submitted & _GFX_FRAME_COMPUTE) ? 1 : 0;
+		((frame->submitted & _GFX_FRAME_GRAPHICS) ? 1 : 0) +
+		((frame->submitted & _GFX_FRAME_COMPUTE) ? 1 : 0);
 
 	if (numFences > 0)
 	{
@@ -334,11 +641,17 @@ bool _gfx_frame_sync(GFXRenderer* renderer, GFXFrame* frame, bool reset)
 	// If resetting, reset all resources.
 	if (reset)
 	{
+		// Resolve timestamps before anything is recorded again.
+		// Failure is not fatal, we just lose the timings.
+		if (frame->timer.timers.size > 0)
+			_gfx_frame_resolve_timers(renderer, frame);
+
 		// Immediately reset the relevant command pools, release the memory!
-		_GFX_VK_CHECK(
-			context->vk.ResetCommandPool(
-				context->vk.device, frame->vk.graphics.pool, 0),
-			goto error);
+		for (size_t r = 0; r < frame->ranges.size; ++r)
+			_GFX_VK_CHECK(
+				context->vk.ResetCommandPool(context->vk.device,
+					((_GFXFrameRange*)gfx_vec_at(&frame->ranges, r))->vk.pool, 0),
+				goto error);
 
 		_GFX_VK_CHECK(
 			context->vk.ResetCommandPool(
@@ -354,14 +667,69 @@ bool _gfx_frame_sync(GFXRenderer* renderer, GFXFrame* frame, bool reset)
 			if (!_gfx_recorder_reset(rec))
 				goto error;
 		}
+
+		// Finish all readbacks of the last submission, these were submitted
+		// right after it, so any blocking is brief.
+		// Failure is not fatal, the data is just never written.
+		for (size_t r = 0; r < frame->reads.active.size; ++r)
+		{
+			GFXReadback* readback =
+				*(GFXReadback**)gfx_vec_at(&frame->reads.active, r);
+
+			if (!gfx_readback_wait(readback))
+				gfx_log_warn("Could not read attachment of virtual frame.");
+
+			gfx_readback_free(readback);
+		}
+
+		gfx_vec_release(&frame->reads.pending);
+		gfx_vec_release(&frame->reads.active);
+
+		// And the transient memory ring, all memory is available again.
+		// Every so often, free all chunks above the most used since,
+		// so memory grown for a peak frame is not kept around forever.
+		const size_t used = GFX_MIN(
+			frame->ring.current + (frame->ring.offset > 0),
+			frame->ring.chunks.size);
+
+		frame->ring.peak = GFX_MAX(frame->ring.peak, used);
+
+		if (++frame->ring.resets >= _GFX_FRAME_RING_TRIM)
+		{
+			for (size_t c = frame->ring.peak; c < frame->ring.chunks.size; ++c)
+			{
+				_GFXFrameChunk* chunk = gfx_vec_at(&frame->ring.chunks, c);
+				gfx_unmap(gfx_ref_buffer(chunk->buffer));
+				gfx_free_buffer(chunk->buffer);
+			}
+
+			gfx_vec_pop(
+				&frame->ring.chunks,
+				frame->ring.chunks.size - frame->ring.peak);
+
+			frame->ring.peak = 0;
+			frame->ring.resets = 0;
+		}
+
+		frame->ring.current = 0;
+		frame->ring.offset = 0;
+
+		// Same for all transient host memory of the last submission.
+		gfx_arena_reset(&frame->arena);
+
+		for (size_t w = 0; w < _GFX_FRAME_MAX_WORKERS - 1; ++w)
+			gfx_arena_reset(&frame->workers[w]);
 	}
 
+	gfx_trace_end(sync);
+
 	return 1;
 
 
 	// Error on failure.
 error:
 	gfx_log_fatal("Synchronization of virtual frame failed.");
+	gfx_trace_end(sync);
 
 	return 0;
 }
@@ -432,29 +800,65 @@ bool _gfx_frame_acquire(GFXRenderer* renderer, GFXFrame* frame)
 
 		// Also add in the flags from the previous submission,
 		// that could have postponed a rebuild to now.
-		allFlags |= flags | at->window.flags;
+		// Store them in the attachment so passes know what to rebuild.
+		at->window.flags |= flags;
+		allFlags |= at->window.flags;
 	}
 
+	// Pipelines being compiled in the background read from the
+	// render graph, block compilation while (re)building it.
+	// If nothing needs to be built, do not wait for the compiler.
+	const bool build =
+		(allFlags & _GFX_RECREATE) ||
+		renderer->backing.state != _GFX_BACKING_BUILT ||
+		renderer->graph.state != _GFX_GRAPH_BUILT;
+
+	if (build) _gfx_mutex_lock(&renderer->compiler.compile);
+
 	// Recreate swapchain-dependent resources as per recreate flags.
+	// When recreating live, pending frames keep using (and presenting)
+	// the old resources, which are destroyed once no frame can reference
+	// them anymore, so we do not wait for anything.
 	if (allFlags & _GFX_RECREATE)
 	{
+		const bool live = renderer->backing.live;
+
 		// First try to synchronize all frames.
-		if (!_gfx_sync_frames(renderer))
-			goto error;
+		if (!live && !_gfx_sync_frames(renderer))
+			goto unlock;
 
 		// Then reset the pool, no attachments may be referenced!
 		// We check for the resize flag, as only then would a referenceable
-		// attachment be recreated.
+		// attachment be recreated. If live, recycle once unused instead.
 		if (allFlags & _GFX_RESIZE)
-			_gfx_pool_reset(&renderer->pool);
+		{
+			if (live)
+				_gfx_pool_recycle_all(&renderer->pool, renderer->numFrames);
+			else
+				_gfx_pool_reset(&renderer->pool);
+		}
 
 		// Then rebuild & purge the swapchain stuff.
 		_gfx_render_backing_rebuild(renderer, allFlags);
 		_gfx_render_graph_rebuild(renderer, allFlags);
 
 		for (size_t s = 0; s < frame->syncs.size; ++s)
-			_gfx_swapchain_purge(
-				((_GFXFrameSync*)gfx_vec_at(&frame->syncs, s))->window);
+		{
+			_GFXWindow* window =
+				((_GFXFrameSync*)gfx_vec_at(&frame->syncs, s))->window;
+
+			if (live)
+				_gfx_swapchain_defer(window, renderer->current);
+			else
+				_gfx_swapchain_purge(window);
+		}
+
+		// All recreate flags are handled.
+		for (size_t i = 0; i < attachs->size; ++i)
+		{
+			_GFXAttach* at = gfx_vec_at(attachs, i);
+			if (at->type == _GFX_ATTACH_WINDOW) at->window.flags = 0;
+		}
 	}
 
 	// Ok so before actually recording stuff we need everything to be built.
@@ -463,13 +867,17 @@ bool _gfx_frame_acquire(GFXRenderer* renderer, GFXFrame* frame)
 		!_gfx_render_backing_build(renderer) ||
 		!_gfx_render_graph_build(renderer))
 	{
-		goto error;
+		goto unlock;
 	}
 
+	if (build) _gfx_mutex_unlock(&renderer->compiler.compile);
+
 	return 1;
 
 
 	// Error on failure.
+unlock:
+	if (build) _gfx_mutex_unlock(&renderer->compiler.compile);
 error:
 	gfx_log_fatal("Acquisition of virtual frame failed.");
 
@@ -477,22 +885,34 @@ error:
 }
 
 /****************************
- * Pushes an execution/memory barrier, just as stored in a _GFXConsume object.
- * Assumes `con` and `con->out.prev` to be fully initialized.
- * @return Zero on failure.
+ * Split barrier wait metadata of a single pass,
+ * all events are waited upon with a single vkCmdWaitEvents call.
  */
-static bool _gfx_frame_push_barrier(GFXRenderer* renderer, GFXFrame* frame,
-                                    const _GFXConsume* con,
-                                    _GFXInjection* injection)
+typedef struct _GFXFrameWaits
+{
+	VkPipelineStageFlags srcStage;
+	VkPipelineStageFlags dstStage;
+
+	size_t   numEvents;
+	VkEvent* events;
+
+	size_t                numImgs;
+	VkImageMemoryBarrier* imgs;
+
+} _GFXFrameWaits;
+
+
+/****************************
+ * Retrieves the pipeline stages of a consumption.
+ * Both the barrier and its split event must use the exact same stages.
+ */
+static VkPipelineStageFlags2KHR _gfx_frame_get_stage(GFXRenderer* renderer,
+                                                     const _GFXConsume* con)
 {
 	assert(renderer != NULL);
-	assert(frame != NULL);
 	assert(con != NULL);
-	assert(con->out.prev != NULL);
-	assert(injection != NULL);
 
 	_GFXContext* context = renderer->cache.context;
-	const _GFXConsume* prev = con->out.prev;
 	const _GFXAttach* at = gfx_vec_at(&renderer->backing.attachs, con->view.index);
 
 	const GFXFormat fmt = (at->type == _GFX_ATTACH_IMAGE) ?
@@ -500,30 +920,280 @@ static bool _gfx_frame_push_barrier(GFXRenderer* renderer, GFXFrame* frame,
 		// access flags and pipeline stages, which is what we want :)
 		at->image.base.format : GFX_FORMAT_EMPTY;
 
-	const VkPipelineStageFlags srcStageMask =
-		_GFX_GET_VK_PIPELINE_STAGE(prev->mask, prev->stage, fmt);
-	const VkPipelineStageFlags dstStageMask =
-		_GFX_GET_VK_PIPELINE_STAGE(con->mask, con->stage, fmt);
+	return _GFX_MOD_VK_PIPELINE_STAGE(
+		_GFX_GET_VK_PIPELINE_STAGE2(con->mask, con->stage, fmt), context);
+}
 
-	// If no memory hazard, just inject an execution barrier...
-	const bool srcWrites = GFX_ACCESS_WRITES(prev->mask);
-	const bool transition = prev->out.final != con->out.initial;
+/****************************
+ * Converts pipeline stages to legacy stages to set or wait on an event with.
+ * Events cannot use an empty stage mask, so fall back to all commands.
+ */
+static inline VkPipelineStageFlags _gfx_frame_event_stage(
+	VkPipelineStageFlags2KHR stage)
+{
+	const VkPipelineStageFlags legacy =
+		_GFX_GET_VK_PIPELINE_STAGE_LEGACY(stage);
 
-	if (!srcWrites && !transition)
-	{
-		// ... and be done with it.
-		return _gfx_injection_push(
-			_GFX_MOD_VK_PIPELINE_STAGE(srcStageMask, context),
-			_GFX_MOD_VK_PIPELINE_STAGE(dstStageMask, context),
-			NULL, NULL, injection);
-	}
+	return legacy != 0 ? legacy : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+}
 
-	// Otherwise, inject full memory barrier.
-	// To do this, get us the Vulkan image handle first.
-	VkImage image;
+/****************************
+ * Allocates enough events for all split barriers of the render graph.
+ * @return Zero on failure.
+ */
+static bool _gfx_frame_alloc_events(GFXRenderer* renderer, GFXFrame* frame)
+{
+	assert(renderer != NULL);
+	assert(frame != NULL);
 
-	if (at->type == _GFX_ATTACH_IMAGE)
-		image = at->image.vk.image;
+	_GFXContext* context = renderer->cache.context;
+
+	// Events are only allocated, never freed until the frame is cleared.
+	// They are always reset after being waited upon.
+	VkEventCreateInfo eci = {
+		.sType = VK_STRUCTURE_TYPE_EVENT_CREATE_INFO,
+		.pNext = NULL,
+		.flags = 0
+	};
+
+	while (frame->events.size < renderer->graph.numEvents)
+	{
+		VkEvent event;
+		_GFX_VK_CHECK(
+			context->vk.CreateEvent(
+				context->vk.device, &eci, NULL, &event),
+			goto error);
+
+		if (!gfx_vec_push(&frame->events, 1, &event))
+		{
+			context->vk.DestroyEvent(context->vk.device, event, NULL);
+			goto error;
+		}
+	}
+
+	return 1;
+
+
+	// Error on failure.
+error:
+	gfx_log_error("Could not allocate split barrier events of virtual frame.");
+
+	return 0;
+}
+
+/****************************
+ * Prepares timers for all passes and recorders if profiling,
+ * (re)creating the query pool of the frame if it is too small.
+ * Timer (p * block + r) belongs to pass p and recorder r - 1 (0 = the pass).
+ * @return Zero if not profiling (or on failure).
+ */
+static bool _gfx_frame_prepare_timers(GFXRenderer* renderer, GFXFrame* frame)
+{
+	assert(renderer != NULL);
+	assert(frame != NULL);
+
+	_GFXContext* context = renderer->cache.context;
+
+	if (frame->timer.timers.size > 0)
+		gfx_vec_pop(&frame->timer.timers, frame->timer.timers.size);
+
+	if (!renderer->profile.enabled)
+		return 0;
+
+	// Count the recorders, we use one timer for each pass and
+	// one for each recorder within each pass.
+	size_t block = 1;
+
+	for (
+		GFXListNode* node = renderer->recorders.head;
+		node != NULL;
+		node = node->next)
+	{
+		++block;
+	}
+
+	const size_t numTimers = block * renderer->graph.passes.size;
+	if (numTimers == 0)
+		return 0;
+
+	if (numTimers > UINT32_MAX / 2)
+		goto error;
+
+	// Each timer is a pair of queries.
+	// Only recreate the pool if it is too small,
+	// the frame is done rendering so the old pool is not in use.
+	if (frame->timer.count < numTimers * 2)
+	{
+		context->vk.DestroyQueryPool(
+			context->vk.device, frame->vk.queries, NULL);
+
+		frame->vk.queries = VK_NULL_HANDLE;
+		frame->timer.count = 0;
+
+		VkQueryPoolCreateInfo qpci = {
+			.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+
+			.pNext              = NULL,
+			.flags              = 0,
+			.queryType          = VK_QUERY_TYPE_TIMESTAMP,
+			.queryCount         = (uint32_t)(numTimers * 2),
+			.pipelineStatistics = 0
+		};
+
+		_GFX_VK_CHECK(
+			context->vk.CreateQueryPool(
+				context->vk.device, &qpci, NULL, &frame->vk.queries),
+			goto error);
+
+		frame->timer.count = (uint32_t)(numTimers * 2);
+	}
+
+	// Mark all timers as not written.
+	if (!gfx_vec_push(&frame->timer.timers, numTimers, NULL))
+		goto error;
+
+	for (size_t t = 0; t < numTimers; ++t)
+		((_GFXFrameTimer*)gfx_vec_at(&frame->timer.timers, t))->pass = NULL;
+
+	frame->timer.block = (uint32_t)block;
+
+	return 1;
+
+
+	// Error on failure.
+error:
+	gfx_log_warn("Could not prepare timestamps of a virtual frame.");
+
+	return 0;
+}
+
+/****************************
+ * Records commands to reset the queries of all recorders,
+ * must be recorded before any recorder output of the queue.
+ * @param compute Non-zero to reset the queries of the compute queue.
+ */
+static void _gfx_frame_reset_queries(GFXRenderer* renderer,
+                                     VkCommandBuffer cmd, bool compute)
+{
+	assert(renderer != NULL);
+	assert(cmd != VK_NULL_HANDLE);
+
+	for (
+		GFXRecorder* rec = (GFXRecorder*)renderer->recorders.head;
+		rec != NULL;
+		rec = (GFXRecorder*)rec->list.next)
+	{
+		_gfx_recorder_reset_queries(rec, compute, cmd);
+	}
+}
+
+/****************************
+ * Marks a timer of a virtual frame as written.
+ */
+static inline void _gfx_frame_set_timer(GFXFrame* frame, size_t timer,
+                                        GFXPass* pass, GFXRecorder* recorder)
+{
+	*(_GFXFrameTimer*)gfx_vec_at(&frame->timer.timers, timer) =
+		(_GFXFrameTimer){
+			.pass = pass,
+			.recorder = recorder,
+			.compute = pass->async
+		};
+}
+
+/****************************
+ * Pushes a split barrier to wait upon, converted to legacy flags.
+ * @param imb May be NULL to only wait for the event.
+ */
+static void _gfx_frame_push_wait(GFXFrame* frame, const _GFXConsume* prev,
+                                 VkPipelineStageFlags2KHR srcStage,
+                                 VkPipelineStageFlags2KHR dstStage,
+                                 const VkImageMemoryBarrier2KHR* imb,
+                                 _GFXFrameWaits* waits)
+{
+	assert(frame != NULL);
+	assert(prev != NULL);
+	assert(prev->out.event < frame->events.size);
+	assert(waits != NULL);
+
+	waits->srcStage |= _gfx_frame_event_stage(srcStage);
+	waits->dstStage |= _gfx_frame_event_stage(dstStage);
+	waits->events[waits->numEvents++] =
+		*(VkEvent*)gfx_vec_at(&frame->events, prev->out.event);
+
+	if (imb != NULL)
+		waits->imgs[waits->numImgs++] = (VkImageMemoryBarrier){
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+
+			.pNext               = NULL,
+			.srcAccessMask       = _GFX_GET_VK_ACCESS_FLAGS_LEGACY(imb->srcAccessMask),
+			.dstAccessMask       = _GFX_GET_VK_ACCESS_FLAGS_LEGACY(imb->dstAccessMask),
+			.oldLayout           = imb->oldLayout,
+			.newLayout           = imb->newLayout,
+			.srcQueueFamilyIndex = imb->srcQueueFamilyIndex,
+			.dstQueueFamilyIndex = imb->dstQueueFamilyIndex,
+			.image               = imb->image,
+			.subresourceRange    = imb->subresourceRange
+		};
+}
+
+/****************************
+ * Pushes an execution/memory barrier, just as stored in a _GFXConsume object.
+ * If the dependency is split, it is pushed into waits instead of injection.
+ * Assumes `con` and `con->out.prev` to be fully initialized.
+ * @return Zero on failure.
+ */
+static bool _gfx_frame_push_barrier(GFXRenderer* renderer, GFXFrame* frame,
+                                    const _GFXConsume* con,
+                                    _GFXFrameWaits* waits,
+                                    _GFXInjection* injection)
+{
+	assert(renderer != NULL);
+	assert(frame != NULL);
+	assert(con != NULL);
+	assert(con->out.prev != NULL);
+	assert(waits != NULL);
+	assert(injection != NULL);
+
+	const _GFXConsume* prev = con->out.prev;
+	const _GFXAttach* at = gfx_vec_at(&renderer->backing.attachs, con->view.index);
+	const bool split = prev->out.event != SIZE_MAX;
+
+	const GFXFormat fmt = (at->type == _GFX_ATTACH_IMAGE) ?
+		// Pick empty format for windows, which results in non-depth/stencil
+		// access flags and pipeline stages, which is what we want :)
+		at->image.base.format : GFX_FORMAT_EMPTY;
+
+	const VkPipelineStageFlags2KHR srcStageMask =
+		_gfx_frame_get_stage(renderer, prev);
+	const VkPipelineStageFlags2KHR dstStageMask =
+		_gfx_frame_get_stage(renderer, con);
+
+	// If no memory hazard, just inject an execution barrier...
+	const bool srcWrites = GFX_ACCESS_WRITES(prev->mask);
+	const bool transition = prev->out.final != con->out.initial;
+
+	if (!srcWrites && !transition)
+	{
+		// ... and be done with it.
+		if (split)
+		{
+			_gfx_frame_push_wait(
+				frame, prev, srcStageMask, dstStageMask, NULL, waits);
+
+			return 1;
+		}
+
+		return _gfx_injection_push(
+			srcStageMask, dstStageMask, NULL, NULL, injection);
+	}
+
+	// Otherwise, inject full memory barrier.
+	// To do this, get us the Vulkan image handle first.
+	VkImage image;
+
+	if (at->type == _GFX_ATTACH_IMAGE)
+		image = at->image.vk.image;
 	else
 	{
 		// Query the swapchain image index.
@@ -531,8 +1201,14 @@ static bool _gfx_frame_push_barrier(GFXRenderer* renderer, GFXFrame* frame,
 			_gfx_frame_get_swapchain_index(frame, con->view.index);
 
 		// Validate & set, silently ignore non-existent.
+		// Except we must still wait for (and reset) a split event.
 		if (at->window.window->frame.images.size <= imageInd)
+		{
+			if (split) _gfx_frame_push_wait(
+				frame, prev, srcStageMask, dstStageMask, NULL, waits);
+
 			return 1;
+		}
 
 		image = *(VkImage*)gfx_vec_at(
 			&at->window.window->frame.images, imageInd);
@@ -545,12 +1221,12 @@ static bool _gfx_frame_push_barrier(GFXRenderer* renderer, GFXFrame* frame,
 			(GFX_FORMAT_HAS_STENCIL(fmt) ? GFX_IMAGE_STENCIL : 0) :
 			GFX_IMAGE_COLOR;
 
-	VkImageMemoryBarrier imb = {
-		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+	VkImageMemoryBarrier2KHR imb = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR,
 
 		.pNext               = NULL,
-		.srcAccessMask       = _GFX_GET_VK_ACCESS_FLAGS(prev->mask, fmt),
-		.dstAccessMask       = _GFX_GET_VK_ACCESS_FLAGS(con->mask, fmt),
+		.srcAccessMask       = _GFX_GET_VK_ACCESS_FLAGS2(prev->mask, fmt),
+		.dstAccessMask       = _GFX_GET_VK_ACCESS_FLAGS2(con->mask, fmt),
 		.oldLayout           = prev->out.final,
 		.newLayout           = con->out.initial,
 		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
@@ -581,22 +1257,451 @@ static bool _gfx_frame_push_barrier(GFXRenderer* renderer, GFXFrame* frame,
 			con->view.range.numMipmaps +
 			(con->view.range.mipmap - imb.subresourceRange.baseMipLevel));
 
-	imb.subresourceRange.layerCount =
-		(prev->view.range.numLayers == 0 || con->view.range.numLayers == 0) ?
-		VK_REMAINING_ARRAY_LAYERS : GFX_MAX(
-			prev->view.range.numLayers +
-			(prev->view.range.layer - imb.subresourceRange.baseArrayLayer),
-			con->view.range.numLayers +
-			(con->view.range.layer - imb.subresourceRange.baseArrayLayer));
+	imb.subresourceRange.layerCount =
+		(prev->view.range.numLayers == 0 || con->view.range.numLayers == 0) ?
+		VK_REMAINING_ARRAY_LAYERS : GFX_MAX(
+			prev->view.range.numLayers +
+			(prev->view.range.layer - imb.subresourceRange.baseArrayLayer),
+			con->view.range.numLayers +
+			(con->view.range.layer - imb.subresourceRange.baseArrayLayer));
+
+	if (split)
+	{
+		_gfx_frame_push_wait(
+			frame, prev, srcStageMask, dstStageMask, &imb, waits);
+
+		return 1;
+	}
+
+	return _gfx_injection_push(
+		srcStageMask, dstStageMask, NULL, &imb, injection);
+}
+
+/****************************
+ * Pushes a memory barrier if an image attachment shares its memory
+ * with other attachments and `con` is its first non-culled consumption.
+ * Assumes `con` to be fully initialized.
+ * @return Zero on failure.
+ */
+static bool _gfx_frame_push_alias_barrier(GFXRenderer* renderer,
+                                          const _GFXConsume* con,
+                                          _GFXInjection* injection)
+{
+	assert(renderer != NULL);
+	assert(con != NULL);
+	assert(injection != NULL);
+
+	_GFXContext* context = renderer->cache.context;
+	const _GFXAttach* at = gfx_vec_at(&renderer->backing.attachs, con->view.index);
+
+	if (
+		at->type != _GFX_ATTACH_IMAGE ||
+		at->image.vk.image == VK_NULL_HANDLE ||
+		!con->out.first)
+	{
+		return 1;
+	}
+
+	const _GFXBacking* backing = (const _GFXBacking*)at->image.backings.head;
+	if (backing->mem->refs <= 1)
+		return 1;
+
+	// Contents are not loaded, so the previous contents are discarded,
+	// but we must wait for all previous writes to the memory (WAW) and
+	// transition the entire image to the layout of its first consumer.
+	const GFXFormat fmt = at->image.base.format;
+	const VkPipelineStageFlags2KHR dstStageMask =
+		_GFX_GET_VK_PIPELINE_STAGE2(con->mask, con->stage, fmt);
+
+	const GFXImageAspect aspect =
+		GFX_FORMAT_HAS_DEPTH_OR_STENCIL(fmt) ?
+			(GFX_FORMAT_HAS_DEPTH(fmt) ? GFX_IMAGE_DEPTH : 0) |
+			(GFX_FORMAT_HAS_STENCIL(fmt) ? GFX_IMAGE_STENCIL : 0) :
+			GFX_IMAGE_COLOR;
+
+	VkImageMemoryBarrier2KHR imb = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR,
+
+		.pNext               = NULL,
+		.srcAccessMask       = VK_ACCESS_2_MEMORY_WRITE_BIT_KHR,
+		.dstAccessMask       = _GFX_GET_VK_ACCESS_FLAGS2(con->mask, fmt),
+		.oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED,
+		.newLayout           = con->out.final,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image               = at->image.vk.image,
+
+		.subresourceRange = {
+			.aspectMask     = _GFX_GET_VK_IMAGE_ASPECT(aspect),
+			.baseMipLevel   = 0,
+			.levelCount     = VK_REMAINING_MIP_LEVELS,
+			.baseArrayLayer = 0,
+			.layerCount     = VK_REMAINING_ARRAY_LAYERS
+		}
+	};
+
+	return _gfx_injection_push(
+		VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR,
+		_GFX_MOD_VK_PIPELINE_STAGE(dstStageMask, context),
+		NULL, &imb, injection);
+}
+
+/****************************
+ * Retrieves the number of passes recorded at once, starting at a given pass.
+ * This is the length of the subpass chain, or 1 if not a master.
+ * @param p Index into the renderer's passes, must be a master.
+ */
+static size_t _gfx_frame_chain(GFXRenderer* renderer, size_t p)
+{
+	assert(renderer != NULL);
+	assert(p < renderer->graph.passes.size);
+
+	GFXPass* pass = *(GFXPass**)gfx_vec_at(&renderer->graph.passes, p);
+	size_t chain = 1;
+
+	if (pass->type == GFX_PASS_RENDER)
+		for (
+			GFXPass* next = ((_GFXRenderPass*)pass)->out.next;
+			next != NULL;
+			next = ((_GFXRenderPass*)next)->out.next)
+		{
+			++chain;
+		}
+
+	return chain;
+}
+
+/****************************
+ * Checks whether any of the given passes has a wait command injected.
+ */
+static bool _gfx_frame_waits(GFXRenderer* renderer, size_t first, size_t num)
+{
+	assert(renderer != NULL);
+
+	for (size_t p = first; p < first + num; ++p)
+	{
+		GFXPass* pass = *(GFXPass**)gfx_vec_at(&renderer->graph.passes, p);
+
+		for (size_t d = 0; d < pass->deps.size; ++d)
+			if (((GFXInject*)gfx_vec_at(&pass->deps, d))->type == GFX_DEP_WAIT)
+				return 1;
+	}
+
+	return 0;
+}
+
+/****************************
+ * Checks whether any of the given passes has a signal command injected.
+ */
+static bool _gfx_frame_signals(GFXRenderer* renderer, size_t first, size_t num)
+{
+	assert(renderer != NULL);
+
+	for (size_t p = first; p < first + num; ++p)
+	{
+		GFXPass* pass = *(GFXPass**)gfx_vec_at(&renderer->graph.passes, p);
+
+		for (size_t d = 0; d < pass->deps.size; ++d)
+			if (((GFXInject*)gfx_vec_at(&pass->deps, d))->type != GFX_DEP_WAIT)
+				return 1;
+	}
+
+	return 0;
+}
+
+/****************************
+ * Records the dependency injections of a number of passes.
+ * @param cmd     To record to, cannot be VK_NULL_HANDLE.
+ * @param prepare Non-zero to prepare signal commands, zero to catch waits.
+ * @return Zero on failure.
+ *
+ * Must be called in submission order, by a single thread!
+ */
+static bool _gfx_frame_record_deps(VkCommandBuffer cmd,
+                                   GFXRenderer* renderer,
+                                   size_t first, size_t num, bool prepare,
+                                   _GFXInjection* injection)
+{
+	assert(cmd != VK_NULL_HANDLE);
+	assert(renderer != NULL);
+	assert(injection != NULL);
+
+	_GFXContext* context = renderer->cache.context;
+
+	for (size_t p = first; p < first + num; ++p)
+	{
+		GFXPass* pass =
+			*(GFXPass**)gfx_vec_at(&renderer->graph.passes, p);
+
+		injection->inp.pass = pass; // Update injection.
+
+		if (!(prepare ?
+			_gfx_deps_prepare(
+				context, cmd, 0,
+				pass->deps.size, gfx_vec_at(&pass->deps, 0),
+				injection) :
+			_gfx_deps_catch(
+				context, cmd,
+				pass->deps.size, gfx_vec_at(&pass->deps, 0),
+				injection)))
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/****************************
+ * Records a number of render and inline compute passes,
+ * excluding their dependency injections.
+ * @param cmd       To record to, cannot be VK_NULL_HANDLE.
+ * @param first     First pass to start recording at, must be a master.
+ * @param num       Number of passes to record, cannot split subpass chains.
+ * @param injection Only used to batch barriers, cannot be NULL.
+ * @return Zero on failure.
+ *
+ * The injection must have an arena, all scratch memory is allocated from it.
+ * Can be called concurrently for disjoint passes and command buffers,
+ * as long as each call uses its own arena.
+ * The frame's events must be allocated beforehand!
+ */
+static bool _gfx_frame_record_passes(VkCommandBuffer cmd,
+                                     GFXRenderer* renderer, GFXFrame* frame,
+                                     size_t first, size_t num,
+                                     _GFXInjection* injection)
+{
+	assert(cmd != VK_NULL_HANDLE);
+	assert(renderer != NULL);
+	assert(frame != NULL);
+	assert(injection != NULL);
+	assert(injection->arena != NULL);
+	assert(frame->events.size >= renderer->graph.numEvents);
+
+	_GFXContext* context = renderer->cache.context;
+
+	// Record all requested passes.
+	// Subpass chains are contiguous in submission order,
+	// so we record an entire chain at once, starting at its master.
+	size_t chain = 1;
+
+	for (size_t p = first; p < first + num; p += chain)
+	{
+		GFXPass* pass =
+			*(GFXPass**)gfx_vec_at(&renderer->graph.passes, p);
+
+		// Gather the passes in the chain.
+		// Culled passes are never merged, skip them entirely.
+		chain = _gfx_frame_chain(renderer, p);
+		if (pass->culled) continue;
+
+		// All scratch memory comes from the injection's arena.
+		GFXPass** subs =
+			gfx_arena_alloc(injection->arena, sizeof(GFXPass*) * chain);
+
+		if (subs == NULL)
+			return 0;
+
+		size_t numConsumes = 0;
+
+		for (size_t s = 0; s < chain; ++s)
+			subs[s] = *(GFXPass**)gfx_vec_at(&renderer->graph.passes, p + s),
+			numConsumes += subs[s]->consumes.size;
+
+		// Inject & flush consumption barriers.
+		// Split barriers are gathered separately, to wait on their events.
+		// Dependencies within the chain are formed by the render pass.
+		VkEvent* events = NULL;
+		VkImageMemoryBarrier* imbs = NULL;
+
+		if (numConsumes > 0)
+		{
+			events = gfx_arena_alloc(injection->arena,
+				sizeof(VkEvent) * numConsumes);
+			imbs = gfx_arena_alloc(injection->arena,
+				sizeof(VkImageMemoryBarrier) * numConsumes);
+
+			if (events == NULL || imbs == NULL)
+				return 0;
+		}
+
+		_GFXFrameWaits waits = {
+			.srcStage = 0,
+			.dstStage = 0,
+			.numEvents = 0,
+			.events = events,
+			.numImgs = 0,
+			.imgs = imbs
+		};
+
+		for (size_t s = 0; s < chain; ++s)
+			for (size_t c = 0; c < subs[s]->consumes.size; ++c)
+			{
+				const _GFXConsume* con = gfx_vec_at(&subs[s]->consumes, c);
+				if (con->out.prev == NULL)
+				{
+					if (!_gfx_frame_push_alias_barrier(
+						renderer, con, injection))
+					{
+						return 0;
+					}
+				}
+				else if (!con->out.local)
+				{
+					if (!_gfx_frame_push_barrier(
+						renderer, frame, con, &waits, injection))
+					{
+						return 0;
+					}
+				}
+			}
+
+		_gfx_injection_flush(context, cmd, injection);
+
+		// Wait on all split barriers & immediately reset the events,
+		// the same event is never waited upon twice within a frame.
+		if (waits.numEvents > 0)
+		{
+			context->vk.CmdWaitEvents(cmd,
+				(uint32_t)waits.numEvents, waits.events,
+				waits.srcStage, waits.dstStage,
+				0, NULL, 0, NULL,
+				(uint32_t)waits.numImgs, waits.imgs);
+
+			for (size_t e = 0; e < waits.numEvents; ++e)
+				context->vk.CmdResetEvent(cmd,
+					waits.events[e], waits.dstStage);
+		}
+
+		// Reset the timestamp queries of the chain if profiling,
+		// this must happen outside the render pass.
+		// Each pass owns a contiguous block of timers.
+		const VkQueryPool queries =
+			(frame->timer.timers.size > 0 &&
+			(pass->async ?
+				renderer->profile.compute :
+				renderer->profile.graphics) != 0) ?
+			frame->vk.queries : VK_NULL_HANDLE;
+
+		const size_t block = frame->timer.block;
+
+		if (queries != VK_NULL_HANDLE)
+			context->vk.CmdResetQueryPool(cmd, queries,
+				(uint32_t)(p * block * 2), (uint32_t)(chain * block * 2));
+
+		// Begin render pass.
+		if (pass->type == GFX_PASS_RENDER)
+		{
+			_GFXRenderPass* rPass = (_GFXRenderPass*)pass;
+
+			// Check if it is built.
+			if (rPass->build.pass == NULL)
+				goto skip_pass;
+
+			// Check for the presence of a framebuffer.
+			VkFramebuffer framebuffer = _gfx_pass_framebuffer(rPass, frame);
+			if (framebuffer == VK_NULL_HANDLE)
+				goto skip_pass;
+
+			// Gather all necessary render pass info to record.
+			VkRenderPassBeginInfo rpbi = {
+				.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+
+				.pNext           = NULL,
+				.renderPass      = rPass->vk.pass,
+				.framebuffer     = framebuffer,
+				.clearValueCount = (uint32_t)rPass->vk.clears.size,
+				.pClearValues    = gfx_vec_at(&rPass->vk.clears, 0),
+
+				.renderArea = {
+					.offset = { 0, 0 },
+					.extent = {
+						rPass->build.fWidth,
+						rPass->build.fHeight
+					}
+				}
+			};
+
+			context->vk.CmdBeginRenderPass(cmd,
+				&rpbi, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		}
+
+		// Record all recorders, for each subpass.
+		for (size_t s = 0; s < chain; ++s)
+		{
+			if (s > 0) context->vk.CmdNextSubpass(cmd,
+				VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+			// Restrict the subpass to its devices that render the frame,
+			// all else (render pass, barriers) is for all of them.
+			uint32_t devices = subs[s]->devices & frame->devices;
+			devices = (devices == 0) ? frame->devices : devices;
+
+			if (devices != frame->devices)
+				context->vk.CmdSetDeviceMask(cmd, devices);
+
+			const size_t timer = (p + s) * block;
+
+			if (queries != VK_NULL_HANDLE)
+				context->vk.CmdWriteTimestamp(cmd,
+					VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+					queries, (uint32_t)(timer * 2));
+
+			size_t r = timer + 1;
+
+			for (
+				GFXRecorder* rec = (GFXRecorder*)renderer->recorders.head;
+				rec != NULL;
+				rec = (GFXRecorder*)rec->list.next, ++r)
+			{
+				if (
+					_gfx_recorder_record(rec, subs[s]->order, cmd,
+						queries, (uint32_t)(r * 2)) &&
+					queries != VK_NULL_HANDLE)
+				{
+					_gfx_frame_set_timer(frame, r, subs[s], rec);
+				}
+			}
+
+			if (queries != VK_NULL_HANDLE)
+			{
+				context->vk.CmdWriteTimestamp(cmd,
+					VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+					queries, (uint32_t)(timer * 2 + 1));
+
+				_gfx_frame_set_timer(frame, timer, subs[s], NULL);
+			}
+
+			if (devices != frame->devices)
+				context->vk.CmdSetDeviceMask(cmd, frame->devices);
+		}
+
+		// End render pass.
+		if (pass->type == GFX_PASS_RENDER)
+			context->vk.CmdEndRenderPass(cmd);
+
+		// Jump to here if for any reason we do not record the pass.
+	skip_pass:
+
+		// Signal split barriers, always, even if skipped,
+		// as their consumers will always wait & reset.
+		for (size_t s = 0; s < chain; ++s)
+			for (size_t c = 0; c < subs[s]->consumes.size; ++c)
+			{
+				const _GFXConsume* con = gfx_vec_at(&subs[s]->consumes, c);
+				if (con->out.event != SIZE_MAX)
+					context->vk.CmdSetEvent(cmd,
+						*(VkEvent*)gfx_vec_at(&frame->events, con->out.event),
+						_gfx_frame_event_stage(
+							_gfx_frame_get_stage(renderer, con)));
+			}
+	}
 
-	return _gfx_injection_push(
-		_GFX_MOD_VK_PIPELINE_STAGE(srcStageMask, context),
-		_GFX_MOD_VK_PIPELINE_STAGE(dstStageMask, context),
-		NULL, &imb, injection);
+	return 1;
 }
 
 /****************************
- * Records all render and inline compute passes of a virtual frame.
+ * Records passes of a virtual frame into a single command buffer.
  * @param cmd   To record to, cannot be VK_NULL_HANDLE.
  * @param first First pass to start recording at.
  * @param num   Number of passes to record.
@@ -616,10 +1721,17 @@ static bool _gfx_frame_record(VkCommandBuffer cmd,
 
 	// Go and record all requested passes in submission order.
 	// We wrap a loop over all passes inbetween a begin and end command.
+	// Only the devices that render the frame execute its commands.
+	VkDeviceGroupCommandBufferBeginInfo dgcbbi = {
+		.sType = VK_STRUCTURE_TYPE_DEVICE_GROUP_COMMAND_BUFFER_BEGIN_INFO,
+		.pNext = NULL,
+		.deviceMask = frame->devices
+	};
+
 	VkCommandBufferBeginInfo cbbi = {
 		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
 
-		.pNext            = NULL,
+		.pNext            = &dgcbbi,
 		.flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
 		.pInheritanceInfo = NULL
 	};
@@ -628,110 +1740,280 @@ static bool _gfx_frame_record(VkCommandBuffer cmd,
 		context->vk.BeginCommandBuffer(cmd, &cbbi),
 		return 0);
 
-	// Record all requested passes.
-	for (size_t p = first; p < first + num; ++p)
-	{
-		GFXPass* pass =
-			*(GFXPass**)gfx_vec_at(&renderer->graph.passes, p);
+	// Make sure we have all events for split barriers.
+	if (!_gfx_frame_alloc_events(renderer, frame))
+		return 0;
 
-		injection->inp.pass = pass; // Update injection.
+	// Reset all recorder queries of the queue we are recording for.
+	_gfx_frame_reset_queries(renderer, cmd, first >= renderer->graph.numRender);
 
-		// TODO:GRA: If a pass is the last, record master and all next passes
-		// and handle the whole VK subpass structure like that.
-		// Note: this means a subpass chain cannot have passes in it,
-		// except for the last, that are a child pass of another.
+	// Record all passes, including their wait & signal commands.
+	for (size_t p = first, chain; p < first + num; p += chain)
+	{
+		chain = _gfx_frame_chain(renderer, p);
 
-		// Inject wait commands.
-		if (!_gfx_deps_catch(
-			context, cmd,
-			pass->deps.size, gfx_vec_at(&pass->deps, 0),
-			injection))
+		if (
+			!_gfx_frame_record_deps(cmd, renderer, p, chain, 0, injection) ||
+			!_gfx_frame_record_passes(cmd, renderer, frame, p, chain, injection) ||
+			!_gfx_frame_record_deps(cmd, renderer, p, chain, 1, injection))
 		{
 			return 0;
 		}
+	}
 
-		// Inject & flush consumption barriers.
-		for (size_t c = 0; c < pass->consumes.size; ++c)
+	// End recording.
+	_GFX_VK_CHECK(
+		context->vk.EndCommandBuffer(cmd),
+		return 0);
+
+	return 1;
+}
+
+/****************************
+ * Pass span, passes recorded into a single pass range.
+ */
+typedef struct _GFXFrameSpan
+{
+	size_t first;
+	size_t num;
+	size_t thread; // Index of the worker recording it.
+
+} _GFXFrameSpan;
+
+
+/****************************
+ * Worker recording pass ranges in parallel.
+ */
+typedef struct _GFXFrameWorker
+{
+	GFXRenderer*         renderer;
+	GFXFrame*            frame;
+	GFXArena*            arena; // Transient memory of this worker.
+	const _GFXFrameSpan* spans;
+	size_t               first; // First span to record.
+	size_t               num;   // Number of spans to record.
+	bool                 success;
+
+} _GFXFrameWorker;
+
+
+/****************************
+ * Job entry point, records the passes of all its spans and ends their
+ * pass ranges, sets `success` to zero on failure.
+ * The span at index s in spans is recorded into frame->ranges[s].
+ */
+static void _gfx_frame_worker(void* arg)
+{
+	_GFXFrameWorker* worker = arg;
+	GFXRenderer* renderer = worker->renderer;
+	_GFXContext* context = renderer->cache.context;
+
+	worker->success = 1;
+
+	for (size_t s = worker->first; s < worker->first + worker->num; ++s)
+	{
+		const _GFXFrameSpan* span = worker->spans + s;
+		const _GFXFrameRange* range = gfx_vec_at(&worker->frame->ranges, s);
+
+		// Each worker needs its own barrier batch, from its own arena.
+		_GFXInjection injection;
+		_gfx_injection(&injection);
+		injection.arena = worker->arena;
+
+		const bool success = _gfx_frame_record_passes(
+			range->vk.cmd, renderer, worker->frame,
+			span->first, span->num, &injection);
+
+		if (!success)
 		{
-			const _GFXConsume* con = gfx_vec_at(&pass->consumes, c);
-			if (con->out.prev != NULL)
-			{
-				if (!_gfx_frame_push_barrier(renderer, frame, con, injection))
-					return 0;
-			}
+			worker->success = 0;
+			break;
 		}
 
-		_gfx_injection_flush(context, cmd, injection);
+		_GFX_VK_CHECK(
+			context->vk.EndCommandBuffer(range->vk.cmd),
+			{
+				worker->success = 0;
+				break;
+			});
+	}
+}
 
-		// Begin render pass.
-		if (pass->type == GFX_PASS_RENDER)
-		{
-			_GFXRenderPass* rPass = (_GFXRenderPass*)pass;
+/****************************
+ * Records all render and inline compute passes of a virtual frame into
+ * multiple pass ranges, recorded in parallel by multiple threads.
+ * @param num    Number of passes to record, starting at the first pass.
+ * @param ranges Outputs the number of used pass ranges, cannot be NULL.
+ * @return Zero if the frame could not be recorded.
+ *
+ * The used ranges must be submitted in order, for each range first
+ * its `cmd` and then its `post` command buffer.
+ */
+static bool _gfx_frame_record_ranges(GFXRenderer* renderer, GFXFrame* frame,
+                                     size_t num, size_t* ranges,
+                                     _GFXInjection* injection)
+{
+	assert(renderer != NULL);
+	assert(frame != NULL);
+	assert(num > 0);
+	assert(ranges != NULL);
+	assert(injection != NULL);
 
-			// Check if it is built.
-			if (rPass->build.pass == NULL)
-				goto skip_pass;
+	_GFXContext* context = renderer->cache.context;
 
-			// Check for the presence of a framebuffer.
-			VkFramebuffer framebuffer = _gfx_pass_framebuffer(rPass, frame);
-			if (framebuffer == VK_NULL_HANDLE)
-				goto skip_pass;
+	// Split all passes into a share for each worker,
+	// never splitting a subpass chain, with a minimum number of passes.
+	// Each share is split up into spans at every pass that waits on a
+	// dependency, so wait commands are only caught at the start of a span.
+	// Spans also end at every pass that signals a dependency, so signal
+	// commands are recorded before any later pass can consume the resource.
+	// This way all dependency injection happens on this thread,
+	// in submission order, before any worker starts recording.
+	const size_t numWorkers = GFX_MAX(1, GFX_MIN(
+		_gfx_jobs_concurrency(),
+		GFX_MIN(_GFX_FRAME_MAX_WORKERS, num / _GFX_FRAME_MIN_PASSES)));
 
-			// Gather all necessary render pass info to record.
-			VkRenderPassBeginInfo rpbi = {
-				.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+	const size_t share = (num + numWorkers - 1) / numWorkers;
 
-				.pNext           = NULL,
-				.renderPass      = rPass->vk.pass,
-				.framebuffer     = framebuffer,
-				.clearValueCount = (uint32_t)rPass->vk.clears.size,
-				.pClearValues    = gfx_vec_at(&rPass->vk.clears, 0),
+	_GFXFrameSpan* spans =
+		gfx_arena_alloc(&frame->arena, sizeof(_GFXFrameSpan) * num);
 
-				.renderArea = {
-					.offset = { 0, 0 },
-					.extent = {
-						rPass->build.fWidth,
-						rPass->build.fHeight
-					}
-				}
-			};
+	if (spans == NULL)
+	{
+		gfx_log_error("Could not allocate pass spans of a virtual frame.");
+		return 0;
+	}
 
-			context->vk.CmdBeginRenderPass(cmd,
-				&rpbi, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
-		}
+	size_t numSpans = 0;
+	bool signaled = 0;
 
-		// Record all recorders.
-		for (
-			GFXRecorder* rec = (GFXRecorder*)renderer->recorders.head;
-			rec != NULL;
-			rec = (GFXRecorder*)rec->list.next)
+	for (size_t p = 0, chain; p < num; p += chain)
+	{
+		chain = _gfx_frame_chain(renderer, p);
+		const size_t thread = GFX_MIN(p / share, numWorkers - 1);
+
+		if (
+			numSpans == 0 || signaled ||
+			spans[numSpans-1].thread != thread ||
+			_gfx_frame_waits(renderer, p, chain))
 		{
-			_gfx_recorder_record(rec, pass->order, cmd);
+			spans[numSpans++] = (_GFXFrameSpan){
+				.first = p,
+				.num = 0,
+				.thread = thread
+			};
 		}
 
-		// End render pass.
-		if (pass->type == GFX_PASS_RENDER)
-			context->vk.CmdEndRenderPass(cmd);
+		spans[numSpans-1].num += chain;
+		signaled = _gfx_frame_signals(renderer, p, chain);
+	}
 
-		// Jump to here if for any reason we do not record the pass.
-	skip_pass:
+	*ranges = numSpans;
+
+	// Make sure we have enough pass ranges.
+	// And make sure we have all events for split barriers.
+	while (frame->ranges.size < numSpans)
+		if (!_gfx_frame_push_range(renderer, frame))
+			return 0;
+
+	if (!_gfx_frame_alloc_events(renderer, frame))
+		return 0;
+
+	// Begin all ranges & inject all dependencies.
+	// Wait commands of a span are caught by its first (chain of) pass(es),
+	// all signal commands go in its post command buffer, which is submitted
+	// right after the span, as only its last (chain of) pass(es) signals.
+	// Only the devices that render the frame execute its commands.
+	VkDeviceGroupCommandBufferBeginInfo dgcbbi = {
+		.sType = VK_STRUCTURE_TYPE_DEVICE_GROUP_COMMAND_BUFFER_BEGIN_INFO,
+		.pNext = NULL,
+		.deviceMask = frame->devices
+	};
+
+	VkCommandBufferBeginInfo cbbi = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+
+		.pNext            = &dgcbbi,
+		.flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+		.pInheritanceInfo = NULL
+	};
 
-		// Inject signal commands.
-		if (!_gfx_deps_prepare(
-			context, cmd, 0,
-			pass->deps.size, gfx_vec_at(&pass->deps, 0),
-			injection))
+	for (size_t s = 0; s < numSpans; ++s)
+	{
+		_GFXFrameRange* range = gfx_vec_at(&frame->ranges, s);
+
+		_GFX_VK_CHECK(
+			context->vk.BeginCommandBuffer(range->vk.cmd, &cbbi),
+			return 0);
+
+		_GFX_VK_CHECK(
+			context->vk.BeginCommandBuffer(range->vk.post, &cbbi),
+			return 0);
+
+		// The first range resets all recorder queries of the graphics queue,
+		// as it is submitted before all others.
+		if (s == 0)
+			_gfx_frame_reset_queries(renderer, range->vk.cmd, 0);
+
+		if (
+			!_gfx_frame_record_deps(range->vk.cmd, renderer,
+				spans[s].first, _gfx_frame_chain(renderer, spans[s].first),
+				0, injection) ||
+			!_gfx_frame_record_deps(range->vk.post, renderer,
+				spans[s].first, spans[s].num,
+				1, injection))
 		{
 			return 0;
 		}
+
+		_GFX_VK_CHECK(
+			context->vk.EndCommandBuffer(range->vk.post),
+			return 0);
 	}
 
-	// End recording.
-	_GFX_VK_CHECK(
-		context->vk.EndCommandBuffer(cmd),
-		return 0);
+	// Now record all passes, spread over all workers.
+	// This thread acts as the first worker, using the frame's arena.
+	_GFXFrameWorker workers[_GFX_FRAME_MAX_WORKERS];
 
-	return 1;
+	for (size_t w = 0, s = 0; w < numWorkers; ++w)
+	{
+		workers[w] = (_GFXFrameWorker){
+			.renderer = renderer,
+			.frame = frame,
+			.arena = (w == 0) ? &frame->arena : &frame->workers[w-1],
+			.spans = spans,
+			.first = s,
+			.num = 0,
+			.success = 1
+		};
+
+		while (s < numSpans && spans[s].thread == w)
+			++workers[w].num, ++s;
+	}
+
+	_GFXJobCounter counter;
+	_gfx_job_counter(&counter, NULL);
+
+	_GFXJob jobs[_GFX_FRAME_MAX_WORKERS];
+	size_t numJobs = 0;
+
+	for (size_t w = 1; w < numWorkers; ++w)
+		if (workers[w].num > 0) jobs[numJobs++] = (_GFXJob){
+			.func = _gfx_frame_worker,
+			.arg = workers + w
+		};
+
+	// Do our own share, then wait for (or help with) all others.
+	_gfx_jobs_submit(&counter, numJobs, jobs);
+	_gfx_frame_worker(workers);
+	_gfx_jobs_wait(&counter);
+
+	bool success = 1;
+
+	for (size_t w = 0; w < numWorkers; ++w)
+		success = success && workers[w].success;
+
+	return success;
 }
 
 /****************************
@@ -774,14 +2056,167 @@ static void _gfx_frame_finalize(GFXRenderer* renderer, bool success,
 	}
 }
 
+/****************************
+ * Issues all pending attachment readbacks of a virtual frame,
+ * must be called after the frame is submitted.
+ * @param renderer Cannot be NULL.
+ * @param frame    Cannot be NULL.
+ *
+ * Failure is logged but not fatal, the data is just never written.
+ */
+static void _gfx_frame_issue_reads(GFXRenderer* renderer, GFXFrame* frame)
+{
+	assert(renderer != NULL);
+	assert(frame != NULL);
+
+	GFXVec* attachs = &renderer->backing.attachs;
+
+	for (size_t r = 0; r < frame->reads.pending.size; ++r)
+	{
+		_GFXFrameRead* read = gfx_vec_at(&frame->reads.pending, r);
+
+		// The attachment may have been detached since.
+		_GFXAttach* at = read->index < attachs->size ?
+			gfx_vec_at(attachs, read->index) : NULL;
+
+		if (at == NULL || at->type != _GFX_ATTACH_IMAGE)
+		{
+			gfx_log_warn(
+				"Could not read attachment at index %"GFX_PRIs" of a "
+				"virtual frame, it was detached.",
+				read->index);
+
+			continue;
+		}
+
+		// Read the entire first mipmap, tightly packed.
+		const GFXFormat fmt = at->image.base.format;
+		const GFXRegion srcRegion = {
+			.aspect =
+				GFX_FORMAT_HAS_DEPTH(fmt) ? GFX_IMAGE_DEPTH :
+				GFX_FORMAT_HAS_STENCIL(fmt) ? GFX_IMAGE_STENCIL :
+				GFX_IMAGE_COLOR,
+			.mipmap = 0,
+			.layer = 0,
+			.numLayers = at->image.base.layers,
+			.x = 0,
+			.y = 0,
+			.z = 0,
+			.width = at->image.width,
+			.height = at->image.height,
+			.depth = at->image.depth
+		};
+
+		const GFXRegion dstRegion = {
+			.offset = 0,
+			.rowSize = 0,
+			.numRows = 0
+		};
+
+		// Read on the devices that rendered it.
+		GFXReadback* readback = _gfx_read_async(
+			gfx_ref_attach(renderer, read->index), read->dst, 0,
+			frame->devices,
+			1, read->numDeps, &srcRegion, &dstRegion, read->deps);
+
+		if (
+			readback == NULL ||
+			!gfx_vec_push(&frame->reads.active, 1, &readback))
+		{
+			gfx_readback_free(readback);
+			gfx_log_warn(
+				"Could not read attachment at index %"GFX_PRIs" of a "
+				"virtual frame, the data is never written.",
+				read->index);
+		}
+	}
+
+	gfx_vec_release(&frame->reads.pending);
+}
+
+/****************************
+ * Chains device group submission info if a virtual frame is not rendered
+ * by all devices of the device group, all semaphores are then waited upon
+ * and signaled by the first device that renders it.
+ * @param renderer Cannot be NULL.
+ * @param frame    Cannot be NULL.
+ * @param dgsi     Cannot be NULL, output device group submission info.
+ * @param next     Cannot be NULL, pNext chain to prepend dgsi to.
+ * @return Zero on failure.
+ */
+static bool _gfx_frame_device_group(GFXRenderer* renderer, GFXFrame* frame,
+                                    VkDeviceGroupSubmitInfo* dgsi,
+                                    const void** next,
+                                    size_t numWaits, size_t numCmds,
+                                    size_t numSigs)
+{
+	assert(renderer != NULL);
+	assert(frame != NULL);
+	assert(dgsi != NULL);
+	assert(next != NULL);
+
+	_GFXContext* context = renderer->cache.context;
+	if (frame->devices == _GFX_CONTEXT_DEVICES(context))
+		return 1;
+
+	uint32_t device = 0;
+	while (!(frame->devices & ((uint32_t)1 << device))) ++device;
+
+	// Allocate device indices & masks from the frame, only for this submission.
+	uint32_t* indices = gfx_arena_alloc(&frame->arena,
+		sizeof(uint32_t) * (numWaits + numSigs + numCmds + 1));
+
+	if (indices == NULL)
+		return 0;
+
+	uint32_t* masks = indices + numWaits + numSigs;
+
+	for (size_t i = 0; i < numWaits + numSigs; ++i)
+		indices[i] = device;
+
+	for (size_t c = 0; c < numCmds; ++c)
+		masks[c] = frame->devices;
+
+	*dgsi = (VkDeviceGroupSubmitInfo){
+		.sType = VK_STRUCTURE_TYPE_DEVICE_GROUP_SUBMIT_INFO,
+
+		.pNext                         = *next,
+		.waitSemaphoreCount            = (uint32_t)numWaits,
+		.pWaitSemaphoreDeviceIndices   = indices,
+		.commandBufferCount            = (uint32_t)numCmds,
+		.pCommandBufferDeviceMasks     = masks,
+		.signalSemaphoreCount          = (uint32_t)numSigs,
+		.pSignalSemaphoreDeviceIndices = indices + numWaits
+	};
+
+	*next = dgsi;
+
+	return 1;
+}
+
 /****************************/
 bool _gfx_frame_submit(GFXRenderer* renderer, GFXFrame* frame)
 {
 	assert(renderer != NULL);
 	assert(frame != NULL);
 
+	gfx_trace_begin(submit, "_gfx_frame_submit");
+
 	_GFXContext* context = renderer->cache.context;
 
+	// Pick the devices that render this submission, with alternate frame
+	// rendering, the next device in turn if it presents no window.
+	frame->devices = _GFX_CONTEXT_DEVICES(context);
+
+	if (
+		renderer->afr.enabled &&
+		context->numDevices > 1 && frame->syncs.size == 0)
+	{
+		frame->devices = (uint32_t)1 << renderer->afr.next;
+		renderer->afr.next =
+			(renderer->afr.next + 1) % (unsigned int)context->numDevices;
+	}
+
 	// Figure out what we need to record.
 	const size_t numGraphics =
 		renderer->graph.numRender;
@@ -790,6 +2225,9 @@ bool _gfx_frame_submit(GFXRenderer* renderer, GFXFrame* frame)
 
 	_GFXInjection injection;
 
+	// Prepare timestamps for profiling, failure just means no profiling.
+	_gfx_frame_prepare_timers(renderer, frame);
+
 	// Record & submit to the graphics queue.
 	if (numGraphics > 0)
 	{
@@ -807,35 +2245,67 @@ bool _gfx_frame_submit(GFXRenderer* renderer, GFXFrame* frame)
 		};
 
 		_gfx_injection(&injection);
+		injection.arena = &frame->arena;
+
+		// Record graphics, into multiple pass ranges.
+		size_t numRanges;
 
-		// Record graphics.
-		if (!_gfx_frame_record(frame->vk.graphics.cmd,
-			renderer, frame, 0, numGraphics, &injection))
+		if (!_gfx_frame_record_ranges(
+			renderer, frame, numGraphics, &numRanges, &injection))
 		{
 			goto clean_graphics;
 		}
 
-		// Get all the available semaphores & metadata.
-		// If there are no sync objects, make VLAs of size 1 for legality.
-		// Then we count the presentable swapchains and go off of that.
-		size_t vlaSyncs = frame->syncs.size > 0 ? frame->syncs.size : 1;
+		// Gather the command buffers of all used ranges, in order.
+		// Then get all the available semaphores & metadata, we count the
+		// presentable swapchains and go off of that.
+		// All of this is transient, so allocate it from the frame's arena.
+		// If there are no sync objects, allocate arrays of size 1.
+		const size_t numSyncs = frame->syncs.size;
+		const size_t arrSyncs = numSyncs > 0 ? numSyncs : 1;
 		size_t presentable = 0;
 
-		_GFXWindow* windows[vlaSyncs];
-		uint32_t indices[vlaSyncs];
-		_GFXRecreateFlags flags[vlaSyncs];
+		VkCommandBuffer* cmds = gfx_arena_alloc(&frame->arena,
+			sizeof(VkCommandBuffer) * numRanges * 2);
+		_GFXWindow** windows = gfx_arena_alloc(&frame->arena,
+			sizeof(_GFXWindow*) * arrSyncs);
+		uint32_t* indices = gfx_arena_alloc(&frame->arena,
+			sizeof(uint32_t) * arrSyncs);
+		uint64_t* ids = gfx_arena_alloc(&frame->arena,
+			sizeof(uint64_t) * arrSyncs);
+		_GFXRecreateFlags* flags = gfx_arena_alloc(&frame->arena,
+			sizeof(_GFXRecreateFlags) * arrSyncs);
+
+		if (
+			cmds == NULL || windows == NULL || indices == NULL ||
+			ids == NULL || flags == NULL)
+		{
+			gfx_log_error("Could not allocate virtual frame submission metadata.");
+			goto clean_graphics;
+		}
+
+		for (size_t r = 0; r < numRanges; ++r)
+		{
+			_GFXFrameRange* range = gfx_vec_at(&frame->ranges, r);
+			cmds[r * 2] = range->vk.cmd;
+			cmds[r * 2 + 1] = range->vk.post;
+		}
 
 		// Append available semaphores and stages to the injection output.
-		if (frame->syncs.size > 0)
+		if (numSyncs > 0)
 		{
-			const size_t numWaits = injection.out.numWaits + frame->syncs.size;
+			const size_t numWaits = injection.out.numWaits + numSyncs;
+
+			_GFX_INJ_GROW(&injection, injection.out.waits,
+				sizeof(VkSemaphore), injection.out.numWaits, numWaits,
+				goto clean_graphics);
 
-			_GFX_INJ_GROW(injection.out.waits,
-				sizeof(VkSemaphore), numWaits,
+			_GFX_INJ_GROW(&injection, injection.out.stages,
+				sizeof(VkPipelineStageFlags), injection.out.numWaits, numWaits,
 				goto clean_graphics);
 
-			_GFX_INJ_GROW(injection.out.stages,
-				sizeof(VkPipelineStageFlags), numWaits,
+			_GFX_INJ_GROW(&injection, injection.out.waitValues,
+				sizeof(uint64_t), injection.out.numWaits, numWaits,
 				goto clean_graphics);
 		}
 
@@ -849,6 +2319,8 @@ bool _gfx_frame_submit(GFXRenderer* renderer, GFXFrame* frame)
 			injection.out.stages[injection.out.numWaits + presentable] =
 				// Swapchain images are only written to as color attachment.
 				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+			injection.out.waitValues[injection.out.numWaits + presentable] =
+				0; // Binary semaphore.
 
 			windows[presentable] = sync->window;
 			indices[presentable] = sync->image;
@@ -859,11 +2331,18 @@ bool _gfx_frame_submit(GFXRenderer* renderer, GFXFrame* frame)
 		// Append rendered semaphore to injection output.
 		if (injection.out.numSigs > 0 && presentable > 0)
 		{
-			_GFX_INJ_GROW(injection.out.sigs,
-				sizeof(VkSemaphore), injection.out.numSigs + 1,
+			_GFX_INJ_GROW(&injection, injection.out.sigs,
+				sizeof(VkSemaphore),
+				injection.out.numSigs, injection.out.numSigs + 1,
+				goto clean_graphics);
+
+			_GFX_INJ_GROW(&injection, injection.out.sigValues,
+				sizeof(uint64_t),
+				injection.out.numSigs, injection.out.numSigs + 1,
 				goto clean_graphics);
 
 			injection.out.sigs[injection.out.numSigs] = frame->vk.rendered;
+			injection.out.sigValues[injection.out.numSigs] = 0;
 		}
 
 		// Submit & present graphics.
@@ -876,16 +2355,39 @@ bool _gfx_frame_submit(GFXRenderer* renderer, GFXFrame* frame)
 		// And lastly get the signal semaphores.
 		const size_t numSigs = injection.out.numSigs + (presentable > 0 ? 1 : 0);
 
+		// Timeline values, if the rendered semaphore is the only signal
+		// semaphore, it is binary and needs no values.
+		VkTimelineSemaphoreSubmitInfo tssi = {
+			.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+
+			.pNext                     = NULL,
+			.waitSemaphoreValueCount   = (uint32_t)numWaits,
+			.pWaitSemaphoreValues      = injection.out.waitValues,
+			.signalSemaphoreValueCount =
+				(uint32_t)(injection.out.numSigs > 0 ? numSigs : 0),
+			.pSignalSemaphoreValues    = injection.out.sigValues
+		};
+
+		// Device group info, if not submitting to all devices.
+		const void* next = injection.out.timeline ? &tssi : NULL;
+		VkDeviceGroupSubmitInfo dgsi;
+
+		if (!_gfx_frame_device_group(renderer, frame,
+			&dgsi, &next, numWaits, numRanges * 2, numSigs))
+		{
+			goto clean_graphics;
+		}
+
 		// Lock queue and submit.
 		VkSubmitInfo si = {
 			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
 
-			.pNext                = NULL,
+			.pNext                = next,
 			.waitSemaphoreCount   = (uint32_t)numWaits,
 			.pWaitSemaphores      = injection.out.waits,
 			.pWaitDstStageMask    = injection.out.stages,
-			.commandBufferCount   = 1,
-			.pCommandBuffers      = &frame->vk.graphics.cmd,
+			.commandBufferCount   = (uint32_t)(numRanges * 2),
+			.pCommandBuffers      = cmds,
 			.signalSemaphoreCount = (uint32_t)numSigs,
 
 			// Take the rendered semaphore if not signaling anything else.
@@ -910,7 +2412,10 @@ bool _gfx_frame_submit(GFXRenderer* renderer, GFXFrame* frame)
 			_gfx_swapchains_present(
 				renderer->present, frame->vk.rendered,
 				presentable,
-				windows, indices, flags);
+				windows, indices, ids, flags),
+			_gfx_frame_pace(renderer, 0);
+		else
+			_gfx_frame_pace(renderer, 1);
 
 		// Loop over all sync objects to set the recreate flags of all
 		// associated window attachments. We add the results of all
@@ -954,6 +2459,7 @@ bool _gfx_frame_submit(GFXRenderer* renderer, GFXFrame* frame)
 		};
 
 		_gfx_injection(&injection);
+		injection.arena = &frame->arena;
 
 		// Record compute.
 		if (!_gfx_frame_record(frame->vk.compute.cmd,
@@ -962,11 +2468,32 @@ bool _gfx_frame_submit(GFXRenderer* renderer, GFXFrame* frame)
 			goto clean_compute;
 		}
 
+		// Timeline values of all semaphores.
+		VkTimelineSemaphoreSubmitInfo tssi = {
+			.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+
+			.pNext                     = NULL,
+			.waitSemaphoreValueCount   = (uint32_t)injection.out.numWaits,
+			.pWaitSemaphoreValues      = injection.out.waitValues,
+			.signalSemaphoreValueCount = (uint32_t)injection.out.numSigs,
+			.pSignalSemaphoreValues    = injection.out.sigValues
+		};
+
+		// Device group info, if not submitting to all devices.
+		const void* next = injection.out.timeline ? &tssi : NULL;
+		VkDeviceGroupSubmitInfo dgsi;
+
+		if (!_gfx_frame_device_group(renderer, frame, &dgsi, &next,
+			injection.out.numWaits, 1, injection.out.numSigs))
+		{
+			goto clean_compute;
+		}
+
 		// Lock queue and submit.
 		VkSubmitInfo si = {
 			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
 
-			.pNext                = NULL,
+			.pNext                = next,
 			.waitSemaphoreCount   = (uint32_t)injection.out.numWaits,
 			.pWaitSemaphores      = injection.out.waits,
 			.pWaitDstStageMask    = injection.out.stages,
@@ -997,15 +2524,27 @@ bool _gfx_frame_submit(GFXRenderer* renderer, GFXFrame* frame)
 
 	// Post submission things:
 	// When all is submitted, spend some time flushing the cache & pool.
-	if (!_gfx_cache_flush(&renderer->cache))
-		gfx_log_warn(
-			"Failed to flush the Vulkan object cache "
-			"during virtual frame submission.");
+	// Skip flushing the cache if a pipeline is being compiled in the
+	// background, it will be flushed next frame instead.
+	if (_gfx_mutex_try_lock(&renderer->compiler.compile))
+	{
+		if (!_gfx_cache_flush(&renderer->cache))
+			gfx_log_warn(
+				"Failed to flush the Vulkan object cache "
+				"during virtual frame submission.");
+
+		_gfx_mutex_unlock(&renderer->compiler.compile);
+	}
 
 	// This one actually has pretty decent logging already.
 	// Note: we do not flush the pool after synchronization to spare time!
 	_gfx_pool_flush(&renderer->pool);
 
+	// And issue all readbacks, now they come after the frame.
+	_gfx_frame_issue_reads(renderer, frame);
+
+	gfx_trace_end(submit);
+
 	return 1;
 
 
@@ -1022,6 +2561,7 @@ clean_compute:
 	// Error on failure.
 error:
 	gfx_log_fatal("Submission of virtual frame failed.");
+	gfx_trace_end(submit);
 
 	return 0;
 }
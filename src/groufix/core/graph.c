@@ -8,8 +8,179 @@
 
 #include "groufix/core/objects.h"
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 
 
+// Detect whether a consumption accesses its attachment as attachment.
+#define _GFX_CONSUME_IS_ATTACHMENT(con) \
+	((con)->mask & \
+		(GFX_ACCESS_ATTACHMENT_INPUT | \
+		GFX_ACCESS_ATTACHMENT_READ | \
+		GFX_ACCESS_ATTACHMENT_WRITE | \
+		GFX_ACCESS_ATTACHMENT_RESOLVE))
+
+// Detect whether a consumption ONLY accesses its attachment as attachment.
+#define _GFX_CONSUME_IS_ATTACHMENT_ONLY(con) \
+	(((con)->mask & ~(GFXAccessMask)( \
+		GFX_ACCESS_ATTACHMENT_INPUT | \
+		GFX_ACCESS_ATTACHMENT_READ | \
+		GFX_ACCESS_ATTACHMENT_WRITE | \
+		GFX_ACCESS_ATTACHMENT_RESOLVE | \
+		GFX_ACCESS_DISCARD)) == 0)
+
+
+/****************************
+ * Image view cache element definition.
+ */
+typedef struct _GFXViewEntry
+{
+	const void* owner; // Backing or window the image belongs to.
+	VkImageView view;
+
+} _GFXViewEntry;
+
+
+/****************************
+ * Compares the (to be resolved) framebuffer dimensions of two consumptions.
+ * Relative sizes are compared by reference, as their actual size
+ * is not known until the attachments are built.
+ * @return Non-zero if they are guaranteed to be equal.
+ */
+static bool _gfx_cmp_consume_dims(GFXRenderer* renderer,
+                                  const _GFXConsume* l, const _GFXConsume* r)
+{
+	const _GFXAttach* lAt = gfx_vec_at(&renderer->backing.attachs, l->view.index);
+	const _GFXAttach* rAt = gfx_vec_at(&renderer->backing.attachs, r->view.index);
+
+	// Represent windows as 'relative to themselves'.
+	const GFXAttachment win = {
+		.size = GFX_SIZE_RELATIVE, .layers = 1,
+		.xScale = 1.0f, .yScale = 1.0f
+	};
+
+	GFXAttachment lBase = (lAt->type == _GFX_ATTACH_WINDOW) ? win : lAt->image.base;
+	GFXAttachment rBase = (rAt->type == _GFX_ATTACH_WINDOW) ? win : rAt->image.base;
+
+	if (lAt->type == _GFX_ATTACH_WINDOW) lBase.ref = l->view.index;
+	if (rAt->type == _GFX_ATTACH_WINDOW) rBase.ref = r->view.index;
+
+	// Compute the number of layers of the framebuffer views.
+	const uint32_t lLayers = (lAt->type == _GFX_ATTACH_WINDOW) ? 1 :
+		(l->view.range.numLayers == 0) ?
+			lBase.layers - l->view.range.layer : l->view.range.numLayers;
+
+	const uint32_t rLayers = (rAt->type == _GFX_ATTACH_WINDOW) ? 1 :
+		(r->view.range.numLayers == 0) ?
+			rBase.layers - r->view.range.layer : r->view.range.numLayers;
+
+	const bool abs =
+		(lBase.size == GFX_SIZE_ABSOLUTE) && (rBase.size == GFX_SIZE_ABSOLUTE) &&
+		(lBase.width == rBase.width) &&
+		(lBase.height == rBase.height);
+
+	const bool rel =
+		(lBase.size == GFX_SIZE_RELATIVE) && (rBase.size == GFX_SIZE_RELATIVE) &&
+		(lBase.ref == rBase.ref) &&
+		(lBase.xScale == rBase.xScale) &&
+		(lBase.yScale == rBase.yScale);
+
+	return (abs || rel) && (lLayers == rLayers);
+}
+
+/****************************
+ * Checks if a pass can be appended to the chain of a candidate,
+ * i.e. whether all attachments can be part of a single framebuffer.
+ * @param rPass      Cannot be NULL.
+ * @param rCandidate Cannot be NULL, last subpass of its chain.
+ * @return Non-zero if compatible.
+ */
+static bool _gfx_pass_merge_compatible(_GFXRenderPass* rPass,
+                                       _GFXRenderPass* rCandidate)
+{
+	GFXRenderer* rend = rPass->base.renderer;
+
+	// Check all attachment consumptions against all subpasses in the chain.
+	for (
+		_GFXRenderPass* rSub = _GFX_PASS_MASTER(rCandidate);
+		rSub != NULL;
+		rSub = (_GFXRenderPass*)rSub->out.next)
+	{
+		for (size_t i = 0; i < rPass->base.consumes.size; ++i)
+		{
+			const _GFXConsume* con = gfx_vec_at(&rPass->base.consumes, i);
+			const _GFXAttach* at;
+
+			if (
+				con->view.index >= rend->backing.attachs.size ||
+				(at = gfx_vec_at(&rend->backing.attachs, con->view.index),
+					at->type == _GFX_ATTACH_EMPTY))
+			{
+				continue;
+			}
+
+			for (size_t j = 0; j < rSub->base.consumes.size; ++j)
+			{
+				const _GFXConsume* cCon = gfx_vec_at(&rSub->base.consumes, j);
+				const _GFXAttach* cAt;
+
+				if (
+					cCon->view.index >= rend->backing.attachs.size ||
+					(cAt = gfx_vec_at(&rend->backing.attachs, cCon->view.index),
+						cAt->type == _GFX_ATTACH_EMPTY))
+				{
+					continue;
+				}
+
+				// Shared attachments must be accessed as attachment only,
+				// otherwise we cannot form a (by-region) subpass dependency.
+				// They must also result in the exact same image view.
+				if (con->view.index == cCon->view.index)
+				{
+					if (
+						!_GFX_CONSUME_IS_ATTACHMENT_ONLY(con) ||
+						!_GFX_CONSUME_IS_ATTACHMENT_ONLY(cCon) ||
+						(con->flags & _GFX_CONSUME_VIEWED) !=
+							(cCon->flags & _GFX_CONSUME_VIEWED) ||
+						((con->flags & _GFX_CONSUME_VIEWED) &&
+							con->view.type != cCon->view.type) ||
+						con->view.range.aspect != cCon->view.range.aspect ||
+						con->view.range.mipmap != cCon->view.range.mipmap ||
+						con->view.range.numMipmaps != cCon->view.range.numMipmaps ||
+						con->view.range.layer != cCon->view.range.layer ||
+						con->view.range.numLayers != cCon->view.range.numLayers)
+					{
+						return 0;
+					}
+				}
+
+				// Only consider framebuffer views from here on.
+				if (
+					!_GFX_CONSUME_IS_ATTACHMENT(con) ||
+					!_GFX_CONSUME_IS_ATTACHMENT(cCon))
+				{
+					continue;
+				}
+
+				// A framebuffer can only hold a single window.
+				if (
+					at->type == _GFX_ATTACH_WINDOW &&
+					cAt->type == _GFX_ATTACH_WINDOW &&
+					con->view.index != cCon->view.index)
+				{
+					return 0;
+				}
+
+				// And all views must have equal dimensions.
+				if (!_gfx_cmp_consume_dims(rend, con, cCon))
+					return 0;
+			}
+		}
+	}
+
+	return 1;
+}
+
 /****************************
  * Checks if a given parent is a possible merge candidate for a render pass.
  * Meaning its parent _can_ be submitted as subpass before the pass itself,
@@ -36,8 +207,8 @@ static uint64_t _gfx_pass_merge_score(_GFXRenderPass* rPass,
 	// The candidate cannot already be merged with one of its children.
 	if (rCandidate->out.next != NULL) return 0;
 
-	// TODO:GRA: Determine further; reject if incompatible attachments/others.
-	return 0;
+	// All attachments must fit in a single framebuffer.
+	if (!_gfx_pass_merge_compatible(rPass, rCandidate)) return 0;
 
 	// Hooray we have an actual candidate!
 	// Now to calculate their score...
@@ -48,22 +219,27 @@ static uint64_t _gfx_pass_merge_score(_GFXRenderPass* rPass,
 
 /****************************
  * Resolves a pass, setting the `out` field of all its consumptions.
- * consumes must hold `pass->renderer->backing.attachs.size` pointers.
- * @param pass     Cannot be NULL.
+ * consumes and owners must hold `pass->renderer->backing.attachs.size` pointers.
+ * @param pass     Cannot be NULL, its `order` field must be set.
  * @param consumes Cannot be NULL, must be initialized to all NULL on first call.
+ * @param owners   Cannot be NULL, pass of each element in consumes.
  *
  * Must be called for all passes in submission order!
  */
-static void _gfx_pass_resolve(GFXPass* pass, _GFXConsume** consumes)
+static void _gfx_pass_resolve(GFXPass* pass,
+                              _GFXConsume** consumes, GFXPass** owners)
 {
 	assert(pass != NULL);
 	assert(consumes != NULL);
+	assert(owners != NULL);
 
 	GFXRenderer* rend = pass->renderer;
 
-	// TODO:GRA: If this is the last pass, do this for master and all next passes
-	// and skip if this is not the last.
-	// This because a subpass chain will be submitted at the order of the last.
+	// Subpass chains are contiguous in submission order,
+	// so we can resolve each subpass as if it were a separate pass.
+	// Only dependencies within the chain are formed differently.
+	const _GFXRenderPass* master = (pass->type != GFX_PASS_RENDER) ? NULL :
+		_GFX_PASS_MASTER((_GFXRenderPass*)pass);
 
 	// Start looping over all consumptions & resolve them.
 	for (size_t i = 0; i < pass->consumes.size; ++i)
@@ -73,9 +249,14 @@ static void _gfx_pass_resolve(GFXPass* pass, _GFXConsume** consumes)
 
 		// Default of NULL (no dependency) in case we skip this consumption.
 		con->out.prev = NULL;
+		con->out.first = 0;
+		con->out.local = 0;
+		con->out.event = SIZE_MAX;
 
 		// Validate existence of the attachment.
+		// Culled passes are skipped entirely, they form no dependencies.
 		if (
+			pass->culled ||
 			con->view.index >= rend->backing.attachs.size ||
 			at->type == _GFX_ATTACH_EMPTY)
 		{
@@ -84,6 +265,7 @@ static void _gfx_pass_resolve(GFXPass* pass, _GFXConsume** consumes)
 
 		// Get previous consumption from the previous resolve calls.
 		_GFXConsume* prev = consumes[con->view.index];
+		con->out.first = (prev == NULL);
 
 		// Compute initial/final layout based on neighbours.
 		if (at->type == _GFX_ATTACH_WINDOW)
@@ -101,10 +283,14 @@ static void _gfx_pass_resolve(GFXPass* pass, _GFXConsume** consumes)
 			VkImageLayout layout =
 				_GFX_GET_VK_IMAGE_LAYOUT(con->mask, at->image.base.format);
 
-			if (prev == NULL)
+			// If the previous pass discards, there is nothing to load.
+			// Keeps transient attachments from being loaded from memory.
+			if (prev == NULL || (prev->mask & GFX_ACCESS_DISCARD))
 				con->out.initial = VK_IMAGE_LAYOUT_UNDEFINED;
 			else
-				con->out.initial = layout,
+				con->out.initial = layout;
+
+			if (prev != NULL)
 				prev->out.final = layout; // Previous pass transitions!
 
 			con->out.final = layout;
@@ -122,19 +308,225 @@ static void _gfx_pass_resolve(GFXPass* pass, _GFXConsume** consumes)
 
 			con->out.prev =
 				(srcWrites || dstWrites || transition) ? prev : NULL;
+
+			// Check if the previous pass is in the same subpass chain.
+			const GFXPass* owner = owners[con->view.index];
+
+			con->out.local =
+				master != NULL && owner->type == GFX_PASS_RENDER &&
+				_GFX_PASS_MASTER((_GFXRenderPass*)owner) == master;
+
+			// Split the barrier with an event if there are passes
+			// inbetween, so they can overlap with the dependency.
+			// Only if both are recorded in the same command buffer.
+			// Dependencies within a subpass chain are never split.
+			const size_t numRender = rend->graph.numRender;
+
+			if (
+				con->out.prev != NULL && !con->out.local &&
+				pass->order > owner->order + 1 &&
+				(pass->order < numRender) == (owner->order < numRender))
+			{
+				prev->out.event = rend->graph.numEvents++;
+			}
 		}
 
 		// Store the consumption for this attachment so the next
 		// resolve calls have this data.
 		// Each index only occurs one for each pass so it's fine.
 		consumes[con->view.index] = con;
+		owners[con->view.index] = pass;
+	}
+}
+
+/****************************
+ * Moves a pass within the render graph's submission order.
+ * All passes inbetween shift by one to make room.
+ * @param renderer Cannot be NULL.
+ * @param from     Current index of the pass to move.
+ * @param to       Index to move it to.
+ */
+static void _gfx_render_graph_move(GFXRenderer* renderer,
+                                   size_t from, size_t to)
+{
+	assert(renderer != NULL);
+	assert(from < renderer->graph.passes.size);
+	assert(to < renderer->graph.passes.size);
+
+	GFXPass** passes = gfx_vec_at(&renderer->graph.passes, 0);
+	GFXPass* pass = passes[from];
+
+	if (from < to)
+		memmove(passes + from, passes + from + 1,
+			sizeof(GFXPass*) * (to - from));
+	else
+		memmove(passes + to + 1, passes + to,
+			sizeof(GFXPass*) * (from - to));
+
+	passes[to] = pass;
+}
+
+/****************************
+ * Decides which inline compute passes can be scheduled on the compute queue.
+ * Such a pass is made promotable by the user and has no data dependency on
+ * any concurrently running graphics pass: it has no parents, no children
+ * and consumes no attachments.
+ * @param renderer Cannot be NULL.
+ *
+ * Passes are moved in between the graphics and asynchronous compute passes,
+ * keeping both parts of the submission order sorted on level.
+ */
+static void _gfx_render_graph_schedule(GFXRenderer* renderer)
+{
+	assert(renderer != NULL);
+
+	GFXVec* passes = &renderer->graph.passes;
+
+	// Only worth it if the compute queue is an actual different queue.
+	const bool overlap =
+		renderer->compute.family != renderer->graphics.family ||
+		renderer->compute.index != renderer->graphics.index;
+
+	// Detect whether an inline compute pass is independent.
+	#define _GFX_PASS_IS_INDEPENDENT(pass) \
+		(overlap && \
+		(pass)->type == GFX_PASS_COMPUTE_INLINE && (pass)->promote && \
+		(pass)->level == 0 && (pass)->childs == 0 && \
+		(pass)->consumes.size == 0)
+
+	// First move all previously scheduled passes that are not independent
+	// anymore back to the graphics queue, after all passes of <= level.
+	// When moved, the next pass to consider shifts into i + 1.
+	for (size_t i = renderer->graph.numRender; i < passes->size; ++i)
+	{
+		GFXPass* pass = *(GFXPass**)gfx_vec_at(passes, i);
+		if (pass->type != GFX_PASS_COMPUTE_INLINE) continue;
+		if (_GFX_PASS_IS_INDEPENDENT(pass)) continue;
+
+		size_t loc = renderer->graph.numRender;
+		for (; loc > 0; --loc)
+		{
+			GFXPass** prev = gfx_vec_at(passes, loc-1);
+			if ((*prev)->level <= pass->level) break;
+		}
+
+		_gfx_render_graph_move(renderer, i, loc);
+		++renderer->graph.numRender;
+		pass->async = 0;
+	}
+
+	// Then move all independent passes to the compute queue.
+	// Loop in reverse so their relative submission order is preserved,
+	// they all have level 0, so they go in front of all async passes.
+	for (size_t i = renderer->graph.numRender; i > 0; --i)
+	{
+		GFXPass* pass = *(GFXPass**)gfx_vec_at(passes, i-1);
+		if (!_GFX_PASS_IS_INDEPENDENT(pass)) continue;
+
+		_gfx_render_graph_move(renderer, i-1, renderer->graph.numRender-1);
+		--renderer->graph.numRender;
+		pass->async = 1;
+	}
+
+	#undef _GFX_PASS_IS_INDEPENDENT
+}
+
+/****************************
+ * Sets the `culled` field of all passes in the render graph.
+ * A pass is culled if it is disabled, or if it has children that are all
+ * culled and it does not write to any window.
+ * @param renderer Cannot be NULL.
+ */
+static void _gfx_render_graph_mark(GFXRenderer* renderer)
+{
+	assert(renderer != NULL);
+
+	GFXVec* passes = &renderer->graph.passes;
+
+	// First assume only enabled sinks and window writers contribute.
+	for (size_t i = 0; i < passes->size; ++i)
+	{
+		GFXPass* pass = *(GFXPass**)gfx_vec_at(passes, i);
+		bool live = pass->childs == 0;
+
+		for (size_t c = 0; !live && c < pass->consumes.size; ++c)
+		{
+			const _GFXConsume* con = gfx_vec_at(&pass->consumes, c);
+			const _GFXAttach* at;
+
+			live =
+				con->view.index < renderer->backing.attachs.size &&
+				(at = gfx_vec_at(&renderer->backing.attachs, con->view.index),
+					at->type == _GFX_ATTACH_WINDOW) &&
+				GFX_ACCESS_WRITES(con->mask);
+		}
+
+		pass->culled = !(pass->enabled && live);
+	}
+
+	// Then propagate contribution from children to their parents.
+	// All parents of a pass are to its left in submission order,
+	// so we loop in reverse to visit all children before their parents.
+	for (size_t i = passes->size; i > 0; --i)
+	{
+		GFXPass* pass = *(GFXPass**)gfx_vec_at(passes, i-1);
+		if (pass->culled) continue;
+
+		const size_t numParents = (pass->type == GFX_PASS_RENDER) ?
+			((_GFXRenderPass*)pass)->numParents :
+			((_GFXComputePass*)pass)->numParents;
+
+		for (size_t p = 0; p < numParents; ++p)
+		{
+			GFXPass* parent = (pass->type == GFX_PASS_RENDER) ?
+				((_GFXRenderPass*)pass)->parents[p] :
+				((_GFXComputePass*)pass)->parents[p];
+
+			if (parent->enabled) parent->culled = 0;
+		}
+	}
+}
+
+/****************************
+ * Checks whether two passes consume any of the same attachments.
+ */
+static bool _gfx_pass_shares(const GFXPass* l, const GFXPass* r)
+{
+	for (size_t i = 0; i < l->consumes.size; ++i)
+	{
+		const _GFXConsume* lCon = gfx_vec_at(&l->consumes, i);
+
+		for (size_t j = 0; j < r->consumes.size; ++j)
+		{
+			const _GFXConsume* rCon = gfx_vec_at(&r->consumes, j);
+			if (lCon->view.index == rCon->view.index) return 1;
+		}
+	}
+
+	return 0;
+}
+
+/****************************
+ * Destructs all passes in the subpass chain of a render pass.
+ * No-op if not a render pass.
+ */
+static void _gfx_pass_destruct_chain(GFXPass* pass)
+{
+	if (pass->type != GFX_PASS_RENDER) return;
+
+	for (
+		_GFXRenderPass* rSub = _GFX_PASS_MASTER((_GFXRenderPass*)pass);
+		rSub != NULL;
+		rSub = (_GFXRenderPass*)rSub->out.next)
+	{
+		_gfx_pass_destruct(rSub);
 	}
 }
 
 /****************************
  * Analyzes the render graph to setup all passes for correct builds.
  * Meaning the `out` field of all consumptions and each render pass are set.
- * Also sets the `order` field of all passes :)
+ * Also sets the `order`, `async` and `culled` fields of all passes :)
  * @param renderer Cannot be NULL, its graph state must not yet be validated.
  */
 static void _gfx_render_graph_analyze(GFXRenderer* renderer)
@@ -142,6 +534,12 @@ static void _gfx_render_graph_analyze(GFXRenderer* renderer)
 	assert(renderer != NULL);
 	assert(renderer->graph.state < _GFX_GRAPH_VALIDATED);
 
+	// First decide which queue each inline compute pass goes to,
+	// as this modifies the submission order.
+	// Then decide which passes are culled, they are ignored from here on.
+	_gfx_render_graph_schedule(renderer);
+	_gfx_render_graph_mark(renderer);
+
 	// We want to see if we can merge render passes into a chain of
 	// subpasses, useful for tiled renderers n such :)
 	// So for each pass, check its parents for possible merge candidates.
@@ -149,10 +547,32 @@ static void _gfx_render_graph_analyze(GFXRenderer* renderer)
 	// indicated through the user API.
 	// We loop in submission order so we can propogate the master pass,
 	// and also so all parents are processed before their children.
+	// Only the directly preceding pass is considered, which keeps all
+	// subpass chains contiguous in submission order.
+	// When re-culled, remember the chains, as they may still be built.
+	const bool culled = renderer->graph.state == _GFX_GRAPH_CULLED;
+	const size_t numRender = renderer->graph.numRender;
+
+	// If we cannot remember them, destruct all chains instead.
+	GFXPass** masters = (culled && numRender > 0) ?
+		malloc(sizeof(GFXPass*) * numRender * 2) : NULL;
+	GFXPass** nexts = (masters != NULL) ? masters + numRender : NULL;
+
+	for (size_t i = 0; masters != NULL && i < numRender; ++i)
+	{
+		GFXPass* pass = *(GFXPass**)gfx_vec_at(&renderer->graph.passes, i);
+		masters[i] = (pass->type != GFX_PASS_RENDER) ? NULL :
+			((_GFXRenderPass*)pass)->out.master;
+		nexts[i] = (pass->type != GFX_PASS_RENDER) ? NULL :
+			((_GFXRenderPass*)pass)->out.next;
+	}
+
 	for (size_t i = 0; i < renderer->graph.numRender; ++i)
 	{
 		_GFXRenderPass* rPass = (_GFXRenderPass*)(
 			*(GFXPass**)gfx_vec_at(&renderer->graph.passes, i));
+		GFXPass* prev = (i == 0) ? NULL :
+			*(GFXPass**)gfx_vec_at(&renderer->graph.passes, i-1);
 
 		// No need to merge non-render passes.
 		if (rPass->base.type != GFX_PASS_RENDER) continue;
@@ -161,6 +581,9 @@ static void _gfx_render_graph_analyze(GFXRenderer* renderer)
 		rPass->out.next = NULL;
 		rPass->out.subpass = 0;
 
+		// Culled passes are not merged.
+		if (rPass->base.culled) continue;
+
 		// Take the parent with the highest merge score.
 		_GFXRenderPass* merge = NULL;
 		uint64_t score = 0;
@@ -171,7 +594,9 @@ static void _gfx_render_graph_analyze(GFXRenderer* renderer)
 				(_GFXRenderPass*)rPass->parents[p];
 
 			// Again, ignore non-render passes.
+			// And ignore anything not directly preceding this pass.
 			if (rCandidate->base.type != GFX_PASS_RENDER) continue;
+			if ((GFXPass*)rCandidate != prev || prev->culled) continue;
 
 			// Calculate score.
 			uint64_t pScore = _gfx_pass_merge_score(rPass, rCandidate);
@@ -191,6 +616,28 @@ static void _gfx_render_graph_analyze(GFXRenderer* renderer)
 		}
 	}
 
+	// Destruct the (new) chain of all passes of which the chain changed.
+	// If a chain changed, at least one of each of the old and new chain's
+	// passes has a different master or next pass.
+	for (size_t i = 0; culled && i < numRender; ++i)
+	{
+		GFXPass* pass = *(GFXPass**)gfx_vec_at(&renderer->graph.passes, i);
+		if (
+			pass->type == GFX_PASS_RENDER && (masters == NULL ||
+			((_GFXRenderPass*)pass)->out.master != masters[i] ||
+			((_GFXRenderPass*)pass)->out.next != nexts[i]))
+		{
+			_gfx_pass_destruct_chain(pass);
+		}
+	}
+
+	free(masters);
+
+	// Consumptions may have changed, so re-evaluate which attachments
+	// can be lazily allocated as transient attachments and which
+	// attachments can share memory.
+	_gfx_render_backing_analyze(renderer);
+
 	// We loop over all passes in submission order whilst
 	// keeping track of the last consumption of each attachment.
 	// This way we propogate transition and synchronization data per
@@ -198,19 +645,23 @@ static void _gfx_render_graph_analyze(GFXRenderer* renderer)
 	const size_t numAttachs = renderer->backing.attachs.size;
 
 	_GFXConsume* consumes[numAttachs > 0 ? numAttachs : 1];
+	GFXPass* owners[numAttachs > 0 ? numAttachs : 1];
 	for (size_t i = 0; i < numAttachs; ++i) consumes[i] = NULL;
 
+	renderer->graph.numEvents = 0;
+
 	for (size_t i = 0; i < renderer->graph.passes.size; ++i)
 	{
 		GFXPass* pass =
 			*(GFXPass**)gfx_vec_at(&renderer->graph.passes, i);
 
-		// Resolve!
-		_gfx_pass_resolve(pass, consumes);
-
 		// At this point we also sneakedly set the order of all passes
 		// so the recorders know what's up.
+		// Set it before resolving, so it can compute distances.
 		pass->order = (unsigned int)i;
+
+		// Resolve!
+		_gfx_pass_resolve(pass, consumes, owners);
 	}
 
 	// Its now validated!
@@ -218,17 +669,28 @@ static void _gfx_render_graph_analyze(GFXRenderer* renderer)
 }
 
 /****************************/
-void _gfx_render_graph_init(GFXRenderer* renderer)
+bool _gfx_render_graph_init(GFXRenderer* renderer)
 {
 	assert(renderer != NULL);
 
+	if (!_gfx_mutex_init(&renderer->graph.lock))
+		return 0;
+
 	gfx_vec_init(&renderer->graph.sinks, sizeof(GFXPass*));
 	gfx_vec_init(&renderer->graph.passes, sizeof(GFXPass*));
 
+	gfx_map_init(&renderer->graph.views,
+		sizeof(_GFXViewEntry), _gfx_hash_xxh64, _gfx_hash_cmp);
+	gfx_map_init(&renderer->graph.framebuffers,
+		sizeof(VkFramebuffer), _gfx_hash_xxh64, _gfx_hash_cmp);
+
 	renderer->graph.numRender = 0;
+	renderer->graph.numEvents = 0;
 
 	// No graph is a valid graph.
 	renderer->graph.state = _GFX_GRAPH_BUILT;
+
+	return 1;
 }
 
 /****************************/
@@ -247,6 +709,269 @@ void _gfx_render_graph_clear(GFXRenderer* renderer)
 
 	gfx_vec_clear(&renderer->graph.passes);
 	gfx_vec_clear(&renderer->graph.sinks);
+
+	// Make all cached framebuffers and views stale.
+	for (
+		VkFramebuffer* buffer = gfx_map_first(&renderer->graph.framebuffers);
+		buffer != NULL;
+		buffer = gfx_map_next(&renderer->graph.framebuffers, buffer))
+	{
+		_gfx_push_stale(renderer,
+			*buffer, VK_NULL_HANDLE, VK_NULL_HANDLE,
+			VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE);
+	}
+
+	for (
+		_GFXViewEntry* entry = gfx_map_first(&renderer->graph.views);
+		entry != NULL;
+		entry = gfx_map_next(&renderer->graph.views, entry))
+	{
+		_gfx_push_stale(renderer,
+			VK_NULL_HANDLE, entry->view, VK_NULL_HANDLE,
+			VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE);
+	}
+
+	gfx_map_clear(&renderer->graph.framebuffers);
+	gfx_map_clear(&renderer->graph.views);
+	_gfx_mutex_clear(&renderer->graph.lock);
+}
+
+/****************************/
+VkFramebuffer _gfx_render_graph_framebuffer(GFXRenderer* renderer,
+                                            VkRenderPass pass,
+                                            uint32_t width, uint32_t height,
+                                            uint32_t layers,
+                                            size_t numViews,
+                                            const VkImageView* views)
+{
+	assert(renderer != NULL);
+	assert(pass != VK_NULL_HANDLE);
+	assert(numViews == 0 || views != NULL);
+
+	_GFXContext* context = renderer->cache.context;
+
+	// Build the key: the render pass, size and all views.
+	_GFXHashBuilder builder;
+	if (!_gfx_hash_builder(&builder))
+		goto error;
+
+	if (
+		!_gfx_hash_builder_push(&builder, sizeof(pass), &pass) ||
+		!_gfx_hash_builder_push(&builder, sizeof(width), &width) ||
+		!_gfx_hash_builder_push(&builder, sizeof(height), &height) ||
+		!_gfx_hash_builder_push(&builder, sizeof(layers), &layers) ||
+		(numViews > 0 &&
+			!_gfx_hash_builder_push(&builder, sizeof(VkImageView) * numViews, views)))
+	{
+		gfx_free(_gfx_hash_builder_get(&builder));
+		goto error;
+	}
+
+	const uint64_t hash = _gfx_hash_builder_hash(&builder);
+	_GFXHashKey* key = _gfx_hash_builder_get(&builder);
+
+	// Search for an already created framebuffer.
+	VkFramebuffer* buffer =
+		gfx_map_hsearch(&renderer->graph.framebuffers, key, hash);
+
+	if (buffer != NULL)
+	{
+		gfx_free(key);
+		return *buffer;
+	}
+
+	// Nothing found, create a new one.
+	VkFramebufferCreateInfo fci = {
+		.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+
+		.pNext           = NULL,
+		.flags           = 0,
+		.renderPass      = pass,
+		.attachmentCount = (uint32_t)numViews,
+		.pAttachments    = numViews > 0 ? views : NULL,
+		.width           = width,
+		.height          = height,
+		.layers          = layers
+	};
+
+	VkFramebuffer framebuffer;
+	_GFX_VK_CHECK(
+		context->vk.CreateFramebuffer(
+			context->vk.device, &fci, NULL, &framebuffer),
+		{
+			gfx_free(key);
+			goto error;
+		});
+
+	buffer = gfx_map_hinsert(&renderer->graph.framebuffers,
+		&framebuffer, _gfx_hash_size(key), key, hash);
+
+	gfx_free(key);
+
+	if (buffer == NULL)
+	{
+		context->vk.DestroyFramebuffer(
+			context->vk.device, framebuffer, NULL);
+		goto error;
+	}
+
+	return framebuffer;
+
+
+	// Error on failure.
+error:
+	gfx_log_error("Could not create a new framebuffer.");
+
+	return VK_NULL_HANDLE;
+}
+
+/****************************/
+VkImageView _gfx_render_graph_view(GFXRenderer* renderer, const void* owner,
+                                   const VkImageViewCreateInfo* ivci)
+{
+	assert(renderer != NULL);
+	assert(owner != NULL);
+	assert(ivci != NULL);
+	assert(ivci->pNext == NULL);
+
+	_GFXContext* context = renderer->cache.context;
+
+	// Build the key: the image, format & subresource range.
+	_GFXHashBuilder builder;
+	if (!_gfx_hash_builder(&builder))
+		goto error;
+
+	if (
+		!_gfx_hash_builder_push(&builder,
+			sizeof(ivci->flags), &ivci->flags) ||
+		!_gfx_hash_builder_push(&builder,
+			sizeof(ivci->image), &ivci->image) ||
+		!_gfx_hash_builder_push(&builder,
+			sizeof(ivci->viewType), &ivci->viewType) ||
+		!_gfx_hash_builder_push(&builder,
+			sizeof(ivci->format), &ivci->format) ||
+		!_gfx_hash_builder_push(&builder,
+			sizeof(ivci->components), &ivci->components) ||
+		!_gfx_hash_builder_push(&builder,
+			sizeof(ivci->subresourceRange), &ivci->subresourceRange))
+	{
+		gfx_free(_gfx_hash_builder_get(&builder));
+		goto error;
+	}
+
+	const uint64_t hash = _gfx_hash_builder_hash(&builder);
+	_GFXHashKey* key = _gfx_hash_builder_get(&builder);
+
+	// Search for an already created view.
+	_GFXViewEntry* entry =
+		gfx_map_hsearch(&renderer->graph.views, key, hash);
+
+	if (entry != NULL)
+	{
+		gfx_free(key);
+		return entry->view;
+	}
+
+	// Nothing found, create a new one.
+	_GFXViewEntry elem = { .owner = owner };
+	_GFX_VK_CHECK(
+		context->vk.CreateImageView(
+			context->vk.device, ivci, NULL, &elem.view),
+		{
+			gfx_free(key);
+			goto error;
+		});
+
+	entry = gfx_map_hinsert(&renderer->graph.views,
+		&elem, _gfx_hash_size(key), key, hash);
+
+	gfx_free(key);
+
+	if (entry == NULL)
+	{
+		context->vk.DestroyImageView(
+			context->vk.device, elem.view, NULL);
+		goto error;
+	}
+
+	return elem.view;
+
+
+	// Error on failure.
+error:
+	gfx_log_error("Could not create a new image view.");
+
+	return VK_NULL_HANDLE;
+}
+
+/****************************/
+void _gfx_render_graph_evict(GFXRenderer* renderer, const void* owner)
+{
+	assert(renderer != NULL);
+
+	// Offset of the views in a framebuffer key.
+	const size_t offset =
+		sizeof(VkRenderPass) + sizeof(uint32_t) * 3;
+
+	// Loop over all views of the owner, and for each view,
+	// loop over all framebuffers and check if they reference it.
+	// Use the fast erase so we can keep iterating.
+	GFXMap* views = &renderer->graph.views;
+	GFXMap* buffers = &renderer->graph.framebuffers;
+	bool evicted = 0;
+
+	for (
+		_GFXViewEntry* entry = gfx_map_first(views);
+		entry != NULL;)
+	{
+		_GFXViewEntry* next = gfx_map_next(views, entry);
+
+		if (entry->owner != owner)
+		{
+			entry = next;
+			continue;
+		}
+
+		for (
+			VkFramebuffer* buffer = gfx_map_first(buffers);
+			buffer != NULL;)
+		{
+			const _GFXHashKey* key = gfx_map_key(buffers, buffer);
+			VkFramebuffer* bNext = gfx_map_next(buffers, buffer);
+			bool evict = 0;
+
+			for (size_t k = offset; !evict && k < key->len; k += sizeof(VkImageView))
+			{
+				VkImageView view;
+				memcpy(&view, key->bytes + k, sizeof(VkImageView));
+				evict = (view == entry->view);
+			}
+
+			if (evict)
+			{
+				_gfx_push_stale(renderer,
+					*buffer, VK_NULL_HANDLE, VK_NULL_HANDLE,
+					VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE);
+				gfx_map_ferase(buffers, buffer);
+			}
+
+			buffer = bNext;
+		}
+
+		_gfx_push_stale(renderer,
+			VK_NULL_HANDLE, entry->view, VK_NULL_HANDLE,
+			VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE);
+		gfx_map_ferase(views, entry);
+
+		evicted = 1;
+		entry = next;
+	}
+
+	if (evicted)
+	{
+		gfx_map_shrink(views);
+		gfx_map_shrink(buffers);
+	}
 }
 
 /****************************/
@@ -272,7 +997,7 @@ bool _gfx_render_graph_warmup(GFXRenderer* renderer)
 	for (size_t i = 0; i < renderer->graph.numRender; ++i)
 	{
 		GFXPass* pass = *(GFXPass**)gfx_vec_at(&renderer->graph.passes, i);
-		if (pass->type == GFX_PASS_RENDER)
+		if (pass->type == GFX_PASS_RENDER && !pass->culled)
 			// No need to worry about destructing, state remains 'validated'.
 			failed += !_gfx_pass_warmup((_GFXRenderPass*)pass);
 	}
@@ -317,7 +1042,7 @@ bool _gfx_render_graph_build(GFXRenderer* renderer)
 	for (size_t i = 0; i < renderer->graph.numRender; ++i)
 	{
 		GFXPass* pass = *(GFXPass**)gfx_vec_at(&renderer->graph.passes, i);
-		if (pass->type == GFX_PASS_RENDER)
+		if (pass->type == GFX_PASS_RENDER && !pass->culled)
 			// The pass itself should log errors.
 			// No need to worry about destructing, state remains 'validated'.
 			failed += !_gfx_pass_build((_GFXRenderPass*)pass);
@@ -344,8 +1069,18 @@ void _gfx_render_graph_rebuild(GFXRenderer* renderer, _GFXRecreateFlags flags)
 	assert(renderer != NULL);
 	assert(flags & _GFX_RECREATE);
 
+	// Evict everything cached for recreated swapchains,
+	// their old images are destroyed once the old swapchain is.
+	for (size_t i = 0; i < renderer->backing.attachs.size; ++i)
+	{
+		const _GFXAttach* at = gfx_vec_at(&renderer->backing.attachs, i);
+		if (at->type == _GFX_ATTACH_WINDOW && (at->window.flags & _GFX_RECREATE))
+			_gfx_render_graph_evict(renderer, at->window.window);
+	}
+
 	// Nothing to rebuild if no build attempt was even made.
-	if (renderer->graph.state < _GFX_GRAPH_VALIDATED)
+	// If only re-culled, all passes that are still built are up to date.
+	if (renderer->graph.state < _GFX_GRAPH_CULLED)
 		return;
 
 	// (Re)build all render passes.
@@ -356,7 +1091,7 @@ void _gfx_render_graph_rebuild(GFXRenderer* renderer, _GFXRecreateFlags flags)
 	for (size_t i = 0; i < renderer->graph.numRender; ++i)
 	{
 		GFXPass* pass = *(GFXPass**)gfx_vec_at(&renderer->graph.passes, i);
-		if (pass->type == GFX_PASS_RENDER)
+		if (pass->type == GFX_PASS_RENDER && !pass->culled)
 			failed += !_gfx_pass_rebuild((_GFXRenderPass*)pass, flags);
 	}
 
@@ -367,7 +1102,8 @@ void _gfx_render_graph_rebuild(GFXRenderer* renderer, _GFXRecreateFlags flags)
 			failed);
 
 		// The graph is not invalid, but incomplete.
-		renderer->graph.state = _GFX_GRAPH_VALIDATED;
+		if (renderer->graph.state > _GFX_GRAPH_VALIDATED)
+			renderer->graph.state = _GFX_GRAPH_VALIDATED;
 	}
 }
 
@@ -399,6 +1135,57 @@ void _gfx_render_graph_invalidate(GFXRenderer* renderer)
 		renderer->graph.state = _GFX_GRAPH_INVALID;
 }
 
+/****************************/
+void _gfx_render_graph_cull(GFXRenderer* renderer)
+{
+	assert(renderer != NULL);
+
+	// If not analyzed, culling is done during analysis.
+	if (renderer->graph.state < _GFX_GRAPH_CULLED)
+		return;
+
+	// Remember which passes were culled & re-evaluate.
+	const size_t numPasses = renderer->graph.passes.size;
+	GFXPass** passes = gfx_vec_at(&renderer->graph.passes, 0);
+
+	bool* culled = malloc(sizeof(bool) * (numPasses > 0 ? numPasses : 1));
+	if (culled == NULL)
+	{
+		// Re-analyze everything on the next build instead.
+		gfx_log_warn("Could not re-cull the renderer's graph, invalidating.");
+		_gfx_render_graph_invalidate(renderer);
+		return;
+	}
+
+	for (size_t i = 0; i < numPasses; ++i) culled[i] = passes[i]->culled;
+
+	_gfx_render_graph_mark(renderer);
+
+	// Destruct all render passes affected by a changed pass.
+	// These are all passes consuming the same attachments, as their layouts
+	// and dependencies may change.
+	// Passes of which the subpass chain changes are destructed on analysis.
+	bool changed = 0;
+
+	for (size_t i = 0; i < numPasses; ++i)
+	{
+		if (passes[i]->culled == culled[i]) continue;
+		changed = 1;
+
+		_gfx_pass_destruct_chain(passes[i]);
+
+		for (size_t j = 0; j < renderer->graph.numRender; ++j)
+			if (j != i && _gfx_pass_shares(passes[i], passes[j]))
+				_gfx_pass_destruct_chain(passes[j]);
+	}
+
+	free(culled);
+
+	// Re-analyze on the next build, without purging everything.
+	if (changed)
+		renderer->graph.state = _GFX_GRAPH_CULLED;
+}
+
 /****************************/
 GFX_API GFXPass* gfx_renderer_add_pass(GFXRenderer* renderer, GFXPassType type,
                                        size_t numParents, GFXPass** parents)
@@ -445,6 +1232,7 @@ GFX_API GFXPass* gfx_renderer_add_pass(GFXRenderer* renderer, GFXPassType type,
 	}
 
 	// Increase render (+inline compute) pass count on success.
+	// Inline compute passes may be moved to the compute queue on analyze.
 	if (pass->type != GFX_PASS_COMPUTE_ASYNC) ++renderer->graph.numRender;
 
 	// Loop through all sinks, remove if it's now a parent.
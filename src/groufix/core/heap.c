@@ -10,6 +10,7 @@
 #include <assert.h>
 #include <limits.h>
 #include <stdlib.h>
+#include <string.h>
 
 
 #define _GFX_BUFFER_FROM_LIST(node) \
@@ -30,33 +31,157 @@
 #define _GFX_GROUP_FROM_LIST(node) \
 	_GFX_GROUP_FROM_BUFFER(_GFX_BUFFER_FROM_LIST(node))
 
+#define _GFX_GEOMETRY_FROM_LIST(node) \
+	((_GFXGeometry*)((char*)_GFX_BUFFER_FROM_LIST(node) - \
+		offsetof(_GFXGeometry, buffer)))
+
+
+// Size of a staging pool chunk & the maximum size of the staging pool,
+// larger uploads get a dedicated staging buffer.
+#define _GFX_STAGING_CHUNK_SIZE (4ull * 1024 * 1024)
+#define _GFX_STAGING_POOL_SIZE (64ull * 1024 * 1024)
+
+// Size of a geometry block & the largest primitive sub-allocated from one,
+// larger primitives get a dedicated vertex/index buffer.
+#define _GFX_GEOMETRY_BLOCK_SIZE (16ull * 1024 * 1024)
+#define _GFX_GEOMETRY_MAX_SIZE (1ull * 1024 * 1024)
+
+// Maximum number of heaps a thread remembers its sub-allocation cache of.
+#define _GFX_HEAP_THREAD_CACHES 16
+
+// Maximum number of sub-allocation caches of a heap, including the shared one.
+#define _GFX_HEAP_MAX_CACHES 32
+
 
 // Modifies flags (lvalue) according to resulting Vulkan memory flags.
+// Memory that was not asked to be host visible only becomes host visible
+// if it is also coherent, so mapping it never needs to respect atom sizes.
 #define _GFX_MOD_MEMORY_FLAGS(flags, vFlags) \
 	flags = \
 		(flags & ~(GFXMemoryFlags)( \
 			GFX_MEMORY_HOST_VISIBLE | GFX_MEMORY_DEVICE_LOCAL)) | \
-		((vFlags) & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT ? \
+		((vFlags) & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT && \
+		((vFlags) & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT || \
+		(flags) & GFX_MEMORY_HOST_VISIBLE) ? \
 			GFX_MEMORY_HOST_VISIBLE : (GFXMemoryFlags)0) | \
 		((vFlags) & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT ? \
 			GFX_MEMORY_DEVICE_LOCAL : (GFXMemoryFlags)0)
 
 
+/****************************
+ * Next heap id, 0 is never used.
+ */
+static atomic_uintmax_t _gfx_heap_id = 1;
+
+
+/****************************
+ * Retrieves the sub-allocation cache of the calling thread,
+ * creates a new one if it does not have one yet.
+ * Thread-safe with respect to the heap!
+ */
+static _GFXSlabCache* _gfx_heap_slabs(GFXHeap* heap)
+{
+	// Threads that are not attached share the first cache.
+	_GFXThreadState* state = _gfx_get_local();
+	if (state == NULL) goto shared;
+
+	// Look for the cache of this heap, heap ids are never reused,
+	// so caches of destroyed heaps are never found.
+	// The most recently used cache is kept at the end.
+	const size_t size = state->heap.slabs.size;
+
+	for (size_t c = size; c > 0; --c)
+	{
+		_GFXThreadSlabs* slabs = gfx_vec_at(&state->heap.slabs, c-1);
+		if (slabs->heap != heap->id) continue;
+
+		_GFXThreadSlabs found = *slabs;
+		memmove(slabs, slabs + 1, sizeof(_GFXThreadSlabs) * (size - c));
+		*(_GFXThreadSlabs*)gfx_vec_at(&state->heap.slabs, size-1) = found;
+
+		return found.cache;
+	}
+
+	// Not found, create a new cache, owned by the heap.
+	// We create it before locking, it is thrown away if the heap
+	// turns out to have too many caches already.
+	_GFXSlabCache* cache = malloc(sizeof(_GFXSlabCache));
+	if (cache != NULL && !_gfx_slab_cache_init(
+		cache, &heap->allocator, &heap->lock))
+	{
+		free(cache);
+		cache = NULL;
+	}
+
+	_gfx_mutex_lock(&heap->lock);
+
+	if (cache != NULL && heap->numSlabs < _GFX_HEAP_MAX_CACHES)
+	{
+		gfx_list_insert_after(&heap->slabs, &cache->list, NULL);
+		++heap->numSlabs;
+
+		_gfx_mutex_unlock(&heap->lock);
+	}
+	else
+	{
+		// Too many caches (or out of memory), share one round-robin.
+		// Caches are locked on use, so this is fine, it just contends more.
+		// This keeps the number of caches bounded, no matter how many
+		// threads come and go or how often they forget this heap.
+		if (heap->reuse == NULL) heap->reuse = heap->slabs.head->next;
+		if (heap->reuse == NULL) heap->reuse = heap->slabs.head;
+
+		_GFXSlabCache* other = (_GFXSlabCache*)heap->reuse;
+		heap->reuse = heap->reuse->next;
+
+		_gfx_mutex_unlock(&heap->lock);
+
+		if (cache != NULL)
+		{
+			_gfx_slab_cache_clear(cache);
+			free(cache);
+		}
+
+		cache = other;
+	}
+
+	// Forget the least recently used cache if we remember too many,
+	// it is still owned (and eventually cleared) by its heap.
+	if (state->heap.slabs.size >= _GFX_HEAP_THREAD_CACHES)
+		gfx_vec_erase(&state->heap.slabs, 1, 0);
+
+	// If we cannot remember it, we just look it up again next time.
+	_GFXThreadSlabs slabs = { .heap = heap->id, .cache = cache };
+	gfx_vec_push(&state->heap.slabs, 1, &slabs);
+
+	return cache;
+
+
+	// Fallback to the shared cache.
+shared:
+	return (_GFXSlabCache*)heap->slabs.head;
+}
+
 /****************************
  * Performs the actual internal memory allocation.
  * Extracts Vulkan memory flags (and implicitly memory type) from public flags.
  * @param dreqs Can be NULL to disallow a dedicated allocation.
+ *
+ * Thread-safe with respect to the heap!
+ * Tries to sub-allocate from the calling thread's slabs first,
+ * so the heap only needs to be locked when they run dry.
  */
-static inline bool _gfx_alloc_mem(_GFXAllocator* alloc, _GFXMemAlloc* mem,
-                                  bool linear, bool transient,
-                                  GFXMemoryFlags flags,
-                                  const VkMemoryRequirements* reqs,
-                                  const VkMemoryDedicatedRequirements* dreqs,
-                                  VkBuffer buffer, VkImage image)
+static bool _gfx_alloc_mem(GFXHeap* heap, _GFXMemAlloc* mem,
+                           bool linear, bool transient,
+                           GFXMemoryFlags flags,
+                           const VkMemoryRequirements* reqs,
+                           const VkMemoryDedicatedRequirements* dreqs,
+                           VkBuffer buffer, VkImage image)
 {
 	// Get appropriate memory flags & allocate.
-	// For now we always add coherency to host visible memory, this way we do
+	// We always require coherency for host visible memory, this way we do
 	// not need to account for `VkPhysicalDeviceLimits::nonCoherentAtomSize`.
+	// Except for readback memory, which prefers to be host cached.
 	// There are a bunch of memory types we are interested in:
 	//  DEVICE_LOCAL
 	//   Large heap, for any and all GPU-only resources.
@@ -67,7 +192,10 @@ static inline bool _gfx_alloc_mem(_GFXAllocator* alloc, _GFXMemAlloc* mem,
 	//  HOST_VISIBLE | HOST_COHERENT
 	//   Large heap, for any and all staging resources,
 	//   and also a fallback for dynamic/streamed things.
-	// TODO: What about HOST_CACHED, for faster reads?
+	//  HOST_VISIBLE | HOST_CACHED
+	//   For readback resources, fast host reads, may not be coherent.
+	const bool readback = (flags & GFX_MEMORY_READBACK) == GFX_MEMORY_READBACK;
+
 	VkMemoryPropertyFlags required =
 		(flags & GFX_MEMORY_HOST_VISIBLE) ?
 			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
@@ -76,32 +204,132 @@ static inline bool _gfx_alloc_mem(_GFXAllocator* alloc, _GFXMemAlloc* mem,
 
 	// Add the device local flag to optimal flags, this way we fallback to
 	// non device-local memory in case it must be host visible memory too :)
+	// Dynamic buffers prefer the (smaller) host visible device local heap,
+	// falling back to plain device local memory.
 	// Include the lazily allocated bit if possible & transient is requested.
-	VkMemoryPropertyFlags optimal = required |
-		((flags & GFX_MEMORY_DEVICE_LOCAL) ?
+	// Readback memory drops coherency for the host cached bit.
+	const bool dynamic = linear && (flags & GFX_MEMORY_DYNAMIC);
+
+	VkMemoryPropertyFlags optimal =
+		(readback ?
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+			VK_MEMORY_PROPERTY_HOST_CACHED_BIT : required) |
+		((flags & GFX_MEMORY_DEVICE_LOCAL) || dynamic ?
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT : 0) |
+		(dynamic ?
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+			VK_MEMORY_PROPERTY_HOST_COHERENT_BIT : 0) |
 		(!(flags & GFX_MEMORY_HOST_VISIBLE) && transient ?
 			VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : 0);
 
+	// Non-coherent memory is invalidated/flushed in whole atoms,
+	// align readback memory so it never shares an atom with others.
+	VkMemoryRequirements mreqs = *reqs;
+	if (readback)
+	{
+		const VkDeviceSize atom = GFX_MAX(heap->allocator.atomSize, 1);
+		mreqs.alignment = GFX_MAX(mreqs.alignment, atom);
+		mreqs.size = GFX_ALIGN_UP(mreqs.size, atom);
+	}
+
 	// Check if the Vulkan implementation wants a dedicated allocation.
 	// Note that we do not check `dreqs->requiresDedicatedAllocation`, this
 	// is only relevant for external memory, which we do not use.
-	if (dreqs != NULL && dreqs->prefersDedicatedAllocation)
-		return _gfx_allocd(alloc, mem, required, optimal, *reqs, buffer, image);
+	const bool dedicated = dreqs != NULL && dreqs->prefersDedicatedAllocation;
+
+	if (!dedicated && _gfx_slab_alloc(
+		_gfx_heap_slabs(heap), mem, linear, required, optimal, mreqs))
+	{
+		return 1;
+	}
+
+	_gfx_mutex_lock(&heap->lock);
+
+	const bool success = dedicated ?
+		_gfx_allocd(&heap->allocator, mem, required, optimal, mreqs, buffer, image) :
+		_gfx_alloc(&heap->allocator, mem, linear, required, optimal, mreqs);
+
+	_gfx_mutex_unlock(&heap->lock);
+
+	return success;
+}
+
+/****************************
+ * Frees memory allocated by _gfx_alloc_mem.
+ * Thread-safe with respect to the heap!
+ */
+static void _gfx_free_mem(GFXHeap* heap, _GFXMemAlloc* mem)
+{
+	if (mem->slab != NULL)
+		_gfx_slab_free(mem);
 	else
-		return _gfx_alloc(alloc, mem, linear, required, optimal, *reqs);
+	{
+		_gfx_mutex_lock(&heap->lock);
+		_gfx_free(&heap->allocator, mem);
+		_gfx_mutex_unlock(&heap->lock);
+	}
 }
 
 /****************************
- * Populates the `vk.buffer` and `alloc` fields
- * of a _GFXBuffer object, allocating a new Vulkan buffer in the process.
- * @param buffer Cannot be NULL, base.flags is appropriately modified.
- * @return Zero on failure.
+ * Drops all queued streaming uploads to a memory resource.
+ * @param obj Referenced object (the `obj` field of GFXReference).
+ *
+ * Must be called before the resource is freed!
+ */
+static void _gfx_heap_drop_streams(GFXHeap* heap, const void* obj)
+{
+	_gfx_mutex_lock(&heap->ops.stream.lock);
+
+	// Wait until no upload to it is being submitted anymore,
+	// start over after every wait, the requests may have changed.
+	size_t f = 0;
+
+	while (f < heap->ops.stream.flight.size)
+	{
+		_GFXStreamReq* req =
+			*(_GFXStreamReq**)gfx_vec_at(&heap->ops.stream.flight, f);
+
+		if (req->dst.obj != obj)
+			++f;
+		else
+		{
+			_gfx_cond_wait(&heap->ops.stream.cond, &heap->ops.stream.lock);
+			f = 0;
+		}
+	}
+
+	GFXVec* reqs = &heap->ops.stream.requests;
+	size_t dropped = 0;
+
+	for (size_t r = reqs->size; r > 0; --r)
+	{
+		_GFXStreamReq* req = *(_GFXStreamReq**)gfx_vec_at(reqs, r-1);
+		if (req->dst.obj != obj) continue;
+
+		free(req);
+		gfx_vec_erase(reqs, 1, r-1);
+		++dropped;
+	}
+
+	_gfx_mutex_unlock(&heap->ops.stream.lock);
+
+	if (dropped > 0) gfx_log_warn(
+		"Freed a memory resource with %"GFX_PRIs" queued streaming "
+		"upload(s), they are never submitted.",
+		dropped);
+}
+
+/****************************
+ * Creates a new Vulkan buffer for a _GFXBuffer object, without memory.
+ * @param buffer Cannot be NULL.
+ * @param usage  Vulkan usage flags to add to those of buffer.
+ * @return VK_NULL_HANDLE on failure.
  *
  * The `base` and `heap` fields of buffer must be properly initialized,
- * these values are read for the allocation!
+ * these values are read for the creation!
  */
-static bool _gfx_buffer_alloc(_GFXBuffer* buffer)
+static VkBuffer _gfx_buffer_create(const _GFXBuffer* buffer,
+                                   VkBufferUsageFlags usage)
 {
 	assert(buffer != NULL);
 
@@ -119,8 +347,7 @@ static bool _gfx_buffer_alloc(_GFXBuffer* buffer)
 		_gfx_filter_families(buffer->base.flags, families);
 
 	// Create a new Vulkan buffer.
-	VkBufferUsageFlags usage =
-		_GFX_GET_VK_BUFFER_USAGE(buffer->base.flags, buffer->base.usage);
+	usage |= _GFX_GET_VK_BUFFER_USAGE(buffer->base.flags, buffer->base.usage);
 
 	VkBufferCreateInfo bci = {
 		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
@@ -136,8 +363,33 @@ static bool _gfx_buffer_alloc(_GFXBuffer* buffer)
 
 	};
 
+	VkBuffer vkBuffer;
 	_GFX_VK_CHECK(context->vk.CreateBuffer(
-		context->vk.device, &bci, NULL, &buffer->vk.buffer), return 0);
+		context->vk.device, &bci, NULL, &vkBuffer), return VK_NULL_HANDLE);
+
+	return vkBuffer;
+}
+
+/****************************
+ * Populates the `vk.buffer` and `alloc` fields
+ * of a _GFXBuffer object, allocating a new Vulkan buffer in the process.
+ * @param buffer Cannot be NULL, base.flags is appropriately modified.
+ * @return Zero on failure.
+ *
+ * The `base` and `heap` fields of buffer must be properly initialized,
+ * these values are read for the allocation!
+ */
+static bool _gfx_buffer_alloc(_GFXBuffer* buffer)
+{
+	assert(buffer != NULL);
+
+	GFXHeap* heap = buffer->heap;
+	_GFXContext* context = heap->allocator.context;
+
+	// Create a new Vulkan buffer.
+	buffer->vk.buffer = _gfx_buffer_create(buffer, 0);
+	if (buffer->vk.buffer == VK_NULL_HANDLE)
+		return 0;
 
 	// Get memory requirements & do actual allocation.
 	VkBufferMemoryRequirementsInfo2 bmri2 = {
@@ -160,7 +412,7 @@ static bool _gfx_buffer_alloc(_GFXBuffer* buffer)
 		context->vk.device, &bmri2, &mr2);
 
 	if (!_gfx_alloc_mem(
-		&heap->allocator, &buffer->alloc, 1, 0, buffer->base.flags,
+		heap, &buffer->alloc, 1, 0, buffer->base.flags,
 		&mr2.memoryRequirements, &mdr,
 		buffer->vk.buffer, VK_NULL_HANDLE))
 	{
@@ -183,7 +435,7 @@ static bool _gfx_buffer_alloc(_GFXBuffer* buffer)
 
 	// Cleanup on failure.
 clean_alloc:
-	_gfx_free(&heap->allocator, &buffer->alloc);
+	_gfx_free_mem(heap, &buffer->alloc);
 clean:
 	context->vk.DestroyBuffer(
 		context->vk.device, buffer->vk.buffer, NULL);
@@ -208,7 +460,20 @@ static void _gfx_buffer_free(_GFXBuffer* buffer)
 		context->vk.device, buffer->vk.buffer, NULL);
 
 	// Free the memory.
-	_gfx_free(&heap->allocator, &buffer->alloc);
+	_gfx_free_mem(heap, &buffer->alloc);
+}
+
+/****************************/
+void _gfx_buffer_refer(GFXReference ref, const _GFXBuffer* own, bool release)
+{
+	_GFXUnpackRef unp = _gfx_ref_unpack(ref);
+	if (unp.obj.buffer == NULL || unp.obj.buffer == own)
+		return;
+
+	if (release)
+		atomic_fetch_sub_explicit(&unp.obj.buffer->refs, 1, memory_order_relaxed);
+	else
+		atomic_fetch_add_explicit(&unp.obj.buffer->refs, 1, memory_order_relaxed);
 }
 
 /****************************
@@ -295,7 +560,7 @@ static bool _gfx_image_alloc(_GFXImage* image)
 		context->vk.device, &imri2, &mr2);
 
 	if (!_gfx_alloc_mem(
-		&heap->allocator, &image->alloc, 0, 0, image->base.flags,
+		heap, &image->alloc, 0, 0, image->base.flags,
 		&mr2.memoryRequirements, &mdr,
 		VK_NULL_HANDLE, image->vk.image))
 	{
@@ -318,7 +583,7 @@ static bool _gfx_image_alloc(_GFXImage* image)
 
 	// Cleanup on failure.
 clean_alloc:
-	_gfx_free(&heap->allocator, &image->alloc);
+	_gfx_free_mem(heap, &image->alloc);
 clean:
 	context->vk.DestroyImage(
 		context->vk.device, image->vk.image, NULL);
@@ -343,18 +608,21 @@ static void _gfx_image_free(_GFXImage* image)
 		context->vk.device, image->vk.image, NULL);
 
 	// Free the memory.
-	_gfx_free(&heap->allocator, &image->alloc);
+	_gfx_free_mem(heap, &image->alloc);
 }
 
 /****************************/
-_GFXBacking* _gfx_alloc_backing(GFXHeap* heap,
-                                const _GFXImageAttach* attach)
+_GFXBacking* _gfx_create_backing(GFXHeap* heap,
+                                 const _GFXImageAttach* attach,
+                                 VkMemoryRequirements* reqs, bool* share)
 {
 	assert(heap != NULL);
 	assert(attach != NULL);
 	assert(attach->width > 0);
 	assert(attach->height > 0);
 	assert(attach->depth > 0);
+	assert(reqs != NULL);
+	assert(share != NULL);
 
 	_GFXContext* context = heap->allocator.context;
 
@@ -362,6 +630,8 @@ _GFXBacking* _gfx_alloc_backing(GFXHeap* heap,
 	_GFXBacking* backing = malloc(sizeof(_GFXBacking));
 	if (backing == NULL) goto clean;
 
+	backing->mem = NULL;
+
 	// Get queue families to share with.
 	uint32_t families[3] = {
 		heap->ops.graphics.queue.family,
@@ -379,8 +649,11 @@ _GFXBacking* _gfx_alloc_backing(GFXHeap* heap,
 		(attach->base.type == GFX_IMAGE_CUBE) ?
 			VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0;
 
+	// Add the transient usage if the graph deemed it transient.
 	VkImageUsageFlags usage = _GFX_GET_VK_IMAGE_USAGE(
-		attach->base.flags, attach->base.usage, attach->base.format);
+		attach->base.flags,
+		attach->base.usage | (attach->transient ? GFX_IMAGE_TRANSIENT : 0),
+		attach->base.format);
 
 	VkImageCreateInfo ici = {
 		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
@@ -409,7 +682,7 @@ _GFXBacking* _gfx_alloc_backing(GFXHeap* heap,
 	_GFX_VK_CHECK(context->vk.CreateImage(
 		context->vk.device, &ici, NULL, &backing->vk.image), goto clean);
 
-	// Get memory requirements & do actual allocation.
+	// Get memory requirements.
 	VkImageMemoryRequirementsInfo2 imri2 = {
 		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2,
 		.pNext = NULL,
@@ -429,50 +702,139 @@ _GFXBacking* _gfx_alloc_backing(GFXHeap* heap,
 	context->vk.GetImageMemoryRequirements2(
 		context->vk.device, &imri2, &mr2);
 
-	// Allocating a backing, may have requested to be transient!
-	bool transient = usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+	// It cannot share dedicated memory or lazily allocated memory.
+	*reqs = mr2.memoryRequirements;
+	*share = !attach->transient && !mdr.requiresDedicatedAllocation;
 
-	// Lock just before the allocation.
-	// Postponed until now because we can, don't block other allocations :)
-	_gfx_mutex_lock(&heap->lock);
+	return backing;
+
+
+	// Cleanup on failure.
+clean:
+	free(backing);
+	gfx_log_error(
+		"Could not create a %"PRIu32"x%"PRIu32"x%"PRIu32" backing image.",
+		attach->width, attach->height, attach->depth);
 
+	return NULL;
+}
+
+/****************************/
+bool _gfx_bind_backings(GFXHeap* heap, const _GFXImageAttach* attach,
+                        const VkMemoryRequirements* reqs,
+                        size_t num, _GFXBacking** backings)
+{
+	assert(heap != NULL);
+	assert(attach != NULL);
+	assert(reqs != NULL);
+	assert(num > 0);
+	assert(backings != NULL);
+
+	_GFXContext* context = heap->allocator.context;
+
+	// Allocate new memory, referenced by all backings.
+	_GFXBackingMem* mem = malloc(sizeof(_GFXBackingMem));
+	if (mem == NULL) goto clean;
+
+	mem->refs = (unsigned int)num;
+
+	// A single backing may get dedicated memory, so query that.
+	VkMemoryDedicatedRequirements mdr = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS,
+		.pNext = NULL,
+		.prefersDedicatedAllocation = VK_FALSE,
+		.requiresDedicatedAllocation = VK_FALSE
+	};
+
+	if (num == 1)
+	{
+		VkImageMemoryRequirementsInfo2 imri2 = {
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2,
+			.pNext = NULL,
+			.image = backings[0]->vk.image
+		};
+
+		VkMemoryRequirements2 mr2 = {
+			.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2,
+			.pNext = &mdr
+		};
+
+		context->vk.GetImageMemoryRequirements2(
+			context->vk.device, &imri2, &mr2);
+	}
+
+	// Allocating a backing, may have requested to be transient!
 	if (!_gfx_alloc_mem(
-		&heap->allocator, &backing->alloc, 0, transient, attach->base.flags,
-		&mr2.memoryRequirements, &mdr,
-		VK_NULL_HANDLE, backing->vk.image))
+		heap, &mem->alloc, 0, attach->transient, attach->base.flags,
+		reqs, &mdr,
+		VK_NULL_HANDLE, num == 1 ? backings[0]->vk.image : VK_NULL_HANDLE))
 	{
-		goto clean_image;
+		goto clean_mem;
 	}
 
-	// Bind the image to the memory.
-	_GFX_VK_CHECK(
-		context->vk.BindImageMemory(
-			context->vk.device,
-			backing->vk.image,
-			backing->alloc.vk.memory, backing->alloc.offset),
-		goto clean_alloc);
+	// Bind all images to the memory.
+	for (size_t b = 0; b < num; ++b)
+		_GFX_VK_CHECK(
+			context->vk.BindImageMemory(
+				context->vk.device,
+				backings[b]->vk.image,
+				mem->alloc.vk.memory, mem->alloc.offset),
+			goto clean_alloc);
 
-	// Unlock.
-	_gfx_mutex_unlock(&heap->lock);
+	for (size_t b = 0; b < num; ++b)
+		backings[b]->mem = mem;
 
-	return backing;
+	return 1;
 
 
 	// Cleanup on failure.
 clean_alloc:
-	_gfx_free(&heap->allocator, &backing->alloc);
-clean_image:
-	_gfx_mutex_unlock(&heap->lock); // Don't forget.
-
-	context->vk.DestroyImage(
-		context->vk.device, backing->vk.image, NULL);
+	_gfx_free_mem(heap, &mem->alloc);
+clean_mem:
+	free(mem);
 clean:
-	free(backing);
 	gfx_log_error(
-		"Could not allocate a %"PRIu32"x%"PRIu32"x%"PRIu32" backing image.",
-		attach->width, attach->height, attach->depth);
+		"Could not allocate memory for %"GFX_PRIs" backing image(s).",
+		num);
 
-	return NULL;
+	return 0;
+}
+
+/****************************/
+bool _gfx_bind_backing_alias(GFXHeap* heap, _GFXBacking* backing,
+                             const VkMemoryRequirements* reqs,
+                             _GFXBacking* alias)
+{
+	assert(heap != NULL);
+	assert(backing != NULL);
+	assert(backing->mem == NULL);
+	assert(reqs != NULL);
+	assert(alias != NULL);
+
+	_GFXContext* context = heap->allocator.context;
+	_GFXBackingMem* shared = alias->mem;
+
+	// See if the image fits in the memory of alias.
+	if (
+		shared->alloc.block->single ||
+		!(reqs->memoryTypeBits & ((uint32_t)1 << shared->alloc.block->type)) ||
+		reqs->size > shared->alloc.size ||
+		shared->alloc.offset % reqs->alignment != 0)
+	{
+		return 0;
+	}
+
+	_GFX_VK_CHECK(
+		context->vk.BindImageMemory(
+			context->vk.device,
+			backing->vk.image,
+			shared->alloc.vk.memory, shared->alloc.offset),
+		return 0);
+
+	backing->mem = shared;
+	++shared->refs;
+
+	return 1;
 }
 
 /****************************/
@@ -488,17 +850,23 @@ void _gfx_free_backing(GFXHeap* heap, _GFXBacking* backing)
 	context->vk.DestroyImage(
 		context->vk.device, backing->vk.image, NULL);
 
-	// Lock, free the memory & unlock.
-	_gfx_mutex_lock(&heap->lock);
-	_gfx_free(alloc, &backing->alloc);
-	_gfx_mutex_unlock(&heap->lock);
+	// Release the memory, which may be shared with other backings.
+	// It is freed by whichever backing releases it last.
+	if (backing->mem != NULL && --backing->mem->refs == 0)
+	{
+		_gfx_free_mem(heap, &backing->mem->alloc);
+		free(backing->mem);
+	}
 
 	free(backing);
 }
 
-/****************************/
-_GFXStaging* _gfx_alloc_staging(GFXHeap* heap,
-                                VkBufferUsageFlags usage, uint64_t size)
+/****************************
+ * Creates a new (non-pooled) persistently mapped staging buffer.
+ * @return NULL on failure.
+ */
+static _GFXStaging* _gfx_create_staging(GFXHeap* heap,
+                                        VkBufferUsageFlags usage, uint64_t size)
 {
 	assert(heap != NULL);
 	assert(size > 0);
@@ -509,6 +877,10 @@ _GFXStaging* _gfx_alloc_staging(GFXHeap* heap,
 	_GFXStaging* staging = malloc(sizeof(_GFXStaging));
 	if (staging == NULL) goto clean;
 
+	staging->chunk = NULL;
+	staging->offset = 0;
+	staging->refs = 0;
+
 	// Create a new Vulkan buffer.
 	// Note that staging buffers are never shared between queues!
 	VkBufferCreateInfo bci = {
@@ -529,16 +901,17 @@ _GFXStaging* _gfx_alloc_staging(GFXHeap* heap,
 	// Get memory requirements & do actual allocation.
 	// We only set GFX_MEMORY_HOST_VISIBLE, we never want device locality.
 	// Nor do we allow dedicated allocations to optimize memory use.
+	// Staging buffers that are copied into are read by the host!
 	VkMemoryRequirements mr;
 	context->vk.GetBufferMemoryRequirements(
 		context->vk.device, staging->vk.buffer, &mr);
 
-	// Lock just before the allocation.
-	// Postponed until now because we can, allows many staging buffers :)
-	_gfx_mutex_lock(&heap->lock);
+	const GFXMemoryFlags flags =
+		(usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT) ?
+			GFX_MEMORY_READBACK : GFX_MEMORY_HOST_VISIBLE;
 
 	if (!_gfx_alloc_mem(
-		&heap->allocator, &staging->alloc, 1, 0, GFX_MEMORY_HOST_VISIBLE,
+		heap, &staging->alloc, 1, 0, flags,
 		&mr, NULL, VK_NULL_HANDLE, VK_NULL_HANDLE))
 	{
 		goto clean_buffer;
@@ -552,21 +925,17 @@ _GFXStaging* _gfx_alloc_staging(GFXHeap* heap,
 			staging->alloc.vk.memory, staging->alloc.offset),
 		goto clean_alloc);
 
-	// Map the buffer & unlock.
+	// Map the buffer.
 	if ((staging->vk.ptr = _gfx_map(&heap->allocator, &staging->alloc)) == NULL)
 		goto clean_alloc;
 
-	_gfx_mutex_unlock(&heap->lock);
-
 	return staging;
 
 
 	// Cleanup on failure.
 clean_alloc:
-	_gfx_free(&heap->allocator, &staging->alloc);
+	_gfx_free_mem(heap, &staging->alloc);
 clean_buffer:
-	_gfx_mutex_unlock(&heap->lock); // Don't forget.
-
 	context->vk.DestroyBuffer(
 		context->vk.device, staging->vk.buffer, NULL);
 clean:
@@ -577,27 +946,121 @@ clean:
 	return NULL;
 }
 
+/****************************/
+_GFXStaging* _gfx_alloc_staging(GFXHeap* heap,
+                                VkBufferUsageFlags usage, uint64_t size)
+{
+	assert(heap != NULL);
+	assert(size > 0);
+
+	// Only pool small uploads, readback memory is different memory.
+	if (usage != VK_BUFFER_USAGE_TRANSFER_SRC_BIT || size > _GFX_STAGING_CHUNK_SIZE)
+		return _gfx_create_staging(heap, usage, size);
+
+	_GFXStaging* staging = malloc(sizeof(_GFXStaging));
+	if (staging == NULL)
+	{
+		gfx_log_error(
+			"Could not allocate a staging buffer of %"PRIu64" bytes.", size);
+
+		return NULL;
+	}
+
+	// Find a chunk with enough space left, linearly sub-allocating.
+	// Chunks without any users are reset to be empty again.
+	_gfx_mutex_lock(&heap->ops.staging.lock);
+
+	_GFXStaging* chunk;
+	uint64_t offset = 0;
+
+	for (
+		chunk = (_GFXStaging*)heap->ops.staging.chunks.head;
+		chunk != NULL;
+		chunk = (_GFXStaging*)chunk->list.next)
+	{
+		if (chunk->refs == 0) chunk->offset = 0;
+
+		offset = (chunk->offset + _GFX_STAGING_ALIGN - 1) /
+			_GFX_STAGING_ALIGN * _GFX_STAGING_ALIGN;
+
+		if (offset + size <= chunk->alloc.size)
+			break;
+	}
+
+	// None found, claim a new chunk if within bounds.
+	if (chunk == NULL &&
+		heap->ops.staging.size + _GFX_STAGING_CHUNK_SIZE <= _GFX_STAGING_POOL_SIZE)
+	{
+		chunk = _gfx_create_staging(
+			heap, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, _GFX_STAGING_CHUNK_SIZE);
+
+		if (chunk != NULL)
+		{
+			gfx_list_insert_after(&heap->ops.staging.chunks, &chunk->list, NULL);
+			heap->ops.staging.size += chunk->alloc.size;
+			offset = 0;
+		}
+	}
+
+	// Pool is exhausted, fallback to a dedicated staging buffer.
+	if (chunk == NULL)
+	{
+		_gfx_mutex_unlock(&heap->ops.staging.lock);
+		free(staging);
+
+		return _gfx_create_staging(heap, usage, size);
+	}
+
+	chunk->offset = offset + size;
+	++chunk->refs;
+
+	_gfx_mutex_unlock(&heap->ops.staging.lock);
+
+	// Mirror the chunk's memory so flushing only touches the sub-range.
+	staging->alloc = chunk->alloc;
+	staging->alloc.size = size;
+	staging->alloc.offset = chunk->alloc.offset + offset;
+
+	staging->chunk = chunk;
+	staging->offset = offset;
+	staging->refs = 0;
+	staging->vk.buffer = chunk->vk.buffer;
+	staging->vk.ptr = (void*)((char*)chunk->vk.ptr + offset);
+
+	return staging;
+}
+
 /****************************/
 void _gfx_free_staging(GFXHeap* heap, _GFXStaging* staging)
 {
 	assert(heap != NULL);
 	assert(staging != NULL);
 
+	// If pooled, give the range back to its chunk.
+	if (staging->chunk != NULL)
+	{
+		_gfx_mutex_lock(&heap->ops.staging.lock);
+		--staging->chunk->refs;
+		_gfx_mutex_unlock(&heap->ops.staging.lock);
+
+		free(staging);
+		return;
+	}
+
 	_GFXAllocator* alloc = &heap->allocator;
 	_GFXContext* context = alloc->context;
 
 	// Firstly unmap, this so the map references of the underlying
 	// memory block don't get fckd by staging buffers.
-	_gfx_unmap(alloc, &staging->alloc);
+	if (staging->vk.ptr != NULL)
+		_gfx_unmap(alloc, &staging->alloc);
 
 	// Destroy Vulkan buffer.
 	context->vk.DestroyBuffer(
 		context->vk.device, staging->vk.buffer, NULL);
 
-	// Lock, free the memory & unlock.
-	_gfx_mutex_lock(&heap->lock);
-	_gfx_free(alloc, &staging->alloc);
-	_gfx_mutex_unlock(&heap->lock);
+	// Free the memory.
+	_gfx_free_mem(heap, &staging->alloc);
 
 	free(staging);
 }
@@ -636,11 +1099,20 @@ GFX_API GFXHeap* gfx_create_heap(GFXDevice* device)
 	if (!_gfx_mutex_init(&heap->ops.transfer.lock))
 		goto clean_graphics_lock;
 
+	if (!_gfx_mutex_init(&heap->ops.staging.lock))
+		goto clean_transfer_lock;
+
+	if (!_gfx_mutex_init(&heap->ops.stream.lock))
+		goto clean_staging_lock;
+
+	if (!_gfx_cond_init(&heap->ops.stream.cond))
+		goto clean_stream_lock;
+
 	// Get context associated with the device.
 	_GFXDevice* dev;
 	_GFXContext* context;
 	_GFX_GET_DEVICE(dev, device);
-	_GFX_GET_CONTEXT(context, device, goto clean_transfer_lock);
+	_GFX_GET_CONTEXT(context, device, goto clean_stream_cond);
 
 	// Pick the graphics and transfer queues (and compute family).
 	_gfx_pick_queue(context, &heap->ops.graphics.queue, VK_QUEUE_GRAPHICS_BIT, 0);
@@ -652,6 +1124,8 @@ GFX_API GFXHeap* gfx_create_heap(GFXDevice* device)
 	// These are short-lived buffers, as they are never re-used.
 	heap->ops.graphics.vk.pool = VK_NULL_HANDLE;
 	heap->ops.transfer.vk.pool = VK_NULL_HANDLE;
+	heap->ops.graphics.vk.timeline = VK_NULL_HANDLE;
+	heap->ops.transfer.vk.timeline = VK_NULL_HANDLE;
 
 	VkCommandPoolCreateInfo cpci = {
 		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
@@ -673,12 +1147,64 @@ GFX_API GFXHeap* gfx_create_heap(GFXDevice* device)
 			context->vk.device, &cpci, NULL, &heap->ops.transfer.vk.pool),
 		goto clean_pools);
 
+	// If supported, create a timeline semaphore for each queue.
+	// Transfer operations signal increasing values instead of using
+	// a fence each, so we can poll or wait for many at once.
+	if (context->features & _GFX_SUPPORT_TIMELINE_SEMAPHORE)
+	{
+		VkSemaphoreTypeCreateInfo stci = {
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+
+			.pNext         = NULL,
+			.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+			.initialValue  = 0
+		};
+
+		VkSemaphoreCreateInfo sci = {
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+			.pNext = &stci,
+			.flags = 0
+		};
+
+		_GFX_VK_CHECK(
+			context->vk.CreateSemaphore(
+				context->vk.device, &sci, NULL,
+				&heap->ops.graphics.vk.timeline),
+			goto clean_pools);
+
+		_GFX_VK_CHECK(
+			context->vk.CreateSemaphore(
+				context->vk.device, &sci, NULL,
+				&heap->ops.transfer.vk.timeline),
+			goto clean_pools);
+	}
+
 	// Initialize allocator things.
 	_gfx_allocator_init(&heap->allocator, dev);
+
+	// Create the shared sub-allocation cache,
+	// all other caches are created by their threads.
+	_GFXSlabCache* shared = malloc(sizeof(_GFXSlabCache));
+	if (shared == NULL)
+		goto clean_pools;
+
+	if (!_gfx_slab_cache_init(shared, &heap->allocator, &heap->lock))
+	{
+		free(shared);
+		goto clean_pools;
+	}
+
+	heap->id = atomic_fetch_add(&_gfx_heap_id, 1);
+	heap->numSlabs = 1;
+	heap->reuse = NULL;
+	gfx_list_init(&heap->slabs);
+	gfx_list_insert_after(&heap->slabs, &shared->list, NULL);
+
 	gfx_list_init(&heap->buffers);
 	gfx_list_init(&heap->images);
 	gfx_list_init(&heap->primitives);
 	gfx_list_init(&heap->groups);
+	gfx_list_init(&heap->geometry);
 
 	// Initialize operation things.
 	heap->ops.graphics.injection = NULL;
@@ -690,6 +1216,14 @@ GFX_API GFXHeap* gfx_create_heap(GFXDevice* device)
 	gfx_vec_init(&heap->ops.transfer.deps, sizeof(GFXInject));
 	atomic_store(&heap->ops.graphics.blocking, 0);
 	atomic_store(&heap->ops.transfer.blocking, 0);
+	heap->ops.graphics.value = 0;
+	heap->ops.transfer.value = 0;
+
+	gfx_list_init(&heap->ops.staging.chunks);
+	heap->ops.staging.size = 0;
+
+	gfx_vec_init(&heap->ops.stream.requests, sizeof(_GFXStreamReq*));
+	gfx_vec_init(&heap->ops.stream.flight, sizeof(_GFXStreamReq*));
 
 	return heap;
 
@@ -700,6 +1234,16 @@ clean_pools:
 		context->vk.device, heap->ops.graphics.vk.pool, NULL);
 	context->vk.DestroyCommandPool(
 		context->vk.device, heap->ops.transfer.vk.pool, NULL);
+	context->vk.DestroySemaphore(
+		context->vk.device, heap->ops.graphics.vk.timeline, NULL);
+	context->vk.DestroySemaphore(
+		context->vk.device, heap->ops.transfer.vk.timeline, NULL);
+clean_stream_cond:
+	_gfx_cond_clear(&heap->ops.stream.cond);
+clean_stream_lock:
+	_gfx_mutex_clear(&heap->ops.stream.lock);
+clean_staging_lock:
+	_gfx_mutex_clear(&heap->ops.staging.lock);
 clean_transfer_lock:
 	_gfx_mutex_clear(&heap->ops.transfer.lock);
 clean_graphics_lock:
@@ -721,6 +1265,15 @@ GFX_API void gfx_destroy_heap(GFXHeap* heap)
 
 	_GFXContext* context = heap->allocator.context;
 
+	// Drop all streaming uploads that were never submitted.
+	for (size_t r = 0; r < heap->ops.stream.requests.size; ++r)
+		free(*(_GFXStreamReq**)gfx_vec_at(&heap->ops.stream.requests, r));
+
+	gfx_vec_clear(&heap->ops.stream.requests);
+	gfx_vec_clear(&heap->ops.stream.flight);
+	_gfx_mutex_clear(&heap->ops.stream.lock);
+	_gfx_cond_clear(&heap->ops.stream.cond);
+
 	// Destroy operation resources first so we can wait on them.
 	// First destroy the graphics queue pool.
 	_GFXTransferPool* pool = &heap->ops.graphics;
@@ -739,11 +1292,8 @@ destroy_pool:
 		_GFXTransfer* transfer = gfx_deque_at(&pool->transfers, t);
 
 		if (transfer->flushed)
-			_GFX_VK_CHECK(
-				context->vk.WaitForFences(
-					context->vk.device, 1, &transfer->vk.done,
-					VK_TRUE, UINT64_MAX),
-				{});
+			_gfx_transfer_wait(
+				heap, pool, transfer->value, transfer->vk.done);
 
 		context->vk.DestroyFence(
 			context->vk.device, transfer->vk.done, NULL);
@@ -751,9 +1301,11 @@ destroy_pool:
 		_gfx_free_stagings(heap, transfer);
 	}
 
-	// Destroy pool, transfers deque & lock.
+	// Destroy pool, timeline, transfers deque & lock.
 	context->vk.DestroyCommandPool(
 		context->vk.device, pool->vk.pool, NULL);
+	context->vk.DestroySemaphore(
+		context->vk.device, pool->vk.timeline, NULL);
 
 	gfx_deque_clear(&pool->transfers);
 	_gfx_mutex_clear(&pool->lock);
@@ -765,6 +1317,17 @@ destroy_pool:
 		goto destroy_pool;
 	}
 
+	// All transfers are done, destroy the staging pool.
+	while (heap->ops.staging.chunks.head != NULL)
+	{
+		_GFXStaging* chunk = (_GFXStaging*)heap->ops.staging.chunks.head;
+		gfx_list_erase(&heap->ops.staging.chunks, &chunk->list);
+		_gfx_free_staging(heap, chunk);
+	}
+
+	gfx_list_clear(&heap->ops.staging.chunks);
+	_gfx_mutex_clear(&heap->ops.staging.lock);
+
 	// Free all things.
 	while (heap->buffers.head != NULL) gfx_free_buffer(
 		(GFXBuffer*)_GFX_BUFFER_FROM_LIST(heap->buffers.head));
@@ -778,12 +1341,30 @@ destroy_pool:
 	while (heap->groups.head != NULL) gfx_free_group(
 		(GFXGroup*)_GFX_GROUP_FROM_LIST(heap->groups.head));
 
-	// Clear allocator.
+	while (heap->geometry.head != NULL)
+	{
+		_GFXGeometry* geom = _GFX_GEOMETRY_FROM_LIST(heap->geometry.head);
+		gfx_list_erase(&heap->geometry, &geom->buffer.list);
+		_gfx_free_geometry(geom);
+	}
+
+	// Clear slabs & allocator.
+	while (heap->slabs.head != NULL)
+	{
+		_GFXSlabCache* cache = (_GFXSlabCache*)heap->slabs.head;
+		gfx_list_erase(&heap->slabs, &cache->list);
+		_gfx_slab_cache_clear(cache);
+		free(cache);
+	}
+
+	gfx_list_clear(&heap->slabs);
+
 	_gfx_allocator_clear(&heap->allocator);
 	gfx_list_clear(&heap->buffers);
 	gfx_list_clear(&heap->images);
 	gfx_list_clear(&heap->primitives);
 	gfx_list_clear(&heap->groups);
+	gfx_list_clear(&heap->geometry);
 	_gfx_mutex_clear(&heap->lock);
 
 	free(heap);
@@ -840,6 +1421,43 @@ GFX_API bool gfx_heap_block(GFXHeap* heap)
 	_gfx_mutex_lock(&heap->ops.graphics.lock);
 	_gfx_mutex_lock(&heap->ops.transfer.lock);
 
+	// If using timeline semaphores, we only have to wait for the last
+	// submitted value of each pool, no need to gather anything.
+	// Both pools always either have or do not have a timeline.
+	if (heap->ops.graphics.vk.timeline != VK_NULL_HANDLE)
+	{
+		VkSemaphore timelines[] = {
+			heap->ops.graphics.vk.timeline,
+			heap->ops.transfer.vk.timeline
+		};
+
+		uint64_t values[] = {
+			heap->ops.graphics.value,
+			heap->ops.transfer.value
+		};
+
+		// No fences to protect, so no need to increase the block count.
+		_gfx_mutex_unlock(&heap->ops.graphics.lock);
+		_gfx_mutex_unlock(&heap->ops.transfer.lock);
+
+		VkSemaphoreWaitInfo swi = {
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+
+			.pNext          = NULL,
+			.flags          = 0,
+			.semaphoreCount = 2,
+			.pSemaphores    = timelines,
+			.pValues        = values
+		};
+
+		_GFX_VK_CHECK(
+			context->vk.WaitSemaphores(
+				context->vk.device, &swi, UINT64_MAX),
+			success = 0);
+
+		return success;
+	}
+
 	// Dynamically allocate some mem, no idea how many fences there are..
 	const size_t numFences =
 		heap->ops.graphics.transfers.size +
@@ -892,87 +1510,340 @@ gather_fences:
 				VK_TRUE, UINT64_MAX),
 			success = 0);
 
-	free(fences);
+	free(fences);
+
+	// No need to lock :)
+	atomic_fetch_sub(&heap->ops.graphics.blocking, 1);
+	atomic_fetch_sub(&heap->ops.transfer.blocking, 1);
+
+	return success;
+
+
+	// Early unlock & exit.
+early_exit:
+	_gfx_mutex_unlock(&heap->ops.graphics.lock);
+	_gfx_mutex_unlock(&heap->ops.transfer.lock);
+
+	return success;
+}
+
+/****************************/
+GFX_API void gfx_heap_purge(GFXHeap* heap)
+{
+	assert(heap != NULL);
+
+	_GFXContext* context = heap->allocator.context;
+
+	// First purge the graphics queue pool.
+	_GFXTransferPool* pool = &heap->ops.graphics;
+
+purge:
+	// Lock so we can free command buffers.
+	_gfx_mutex_lock(&pool->lock);
+
+	// Check the front-most transfer operation, continue
+	// until one is not done yet, it's a round-robin.
+	// Note we check if the host is blocking for any operations,
+	// if so, we cannot destroy the fences, so skip purging...
+	// Unless we use a timeline semaphore, then there are no fences.
+	const bool isBlocking =
+		pool->vk.timeline == VK_NULL_HANDLE &&
+		atomic_load(&pool->blocking) > 0;
+
+	uint64_t counter = 0;
+
+	while (!isBlocking && pool->transfers.size > 0)
+	{
+		// Check if the transfer is flushed & done.
+		// If it is not, we are done purging.
+		_GFXTransfer* transfer = gfx_deque_at(&pool->transfers, 0);
+		if (!transfer->flushed)
+			break;
+
+		VkResult result =
+			_gfx_transfer_status(heap, pool, transfer, &counter);
+
+		if (result == VK_NOT_READY)
+			break;
+
+		if (result != VK_SUCCESS)
+		{
+			// Woopsie daisy :o
+			_gfx_mutex_unlock(&pool->lock);
+
+			_GFX_VK_CHECK(result, {});
+			gfx_log_warn("Heap purge failed.");
+			return;
+		}
+
+		// If it is, destroy its resources.
+		context->vk.FreeCommandBuffers(
+			context->vk.device, pool->vk.pool, 1, &transfer->vk.cmd);
+		context->vk.DestroyFence(
+			context->vk.device, transfer->vk.done, NULL);
+
+		_gfx_free_stagings(heap, transfer);
+
+		// And pop it.
+		gfx_deque_pop_front(&pool->transfers, 1);
+	}
+
+	_gfx_mutex_unlock(&pool->lock);
+
+	// Then purge transfer queue pool.
+	if (pool == &heap->ops.graphics)
+	{
+		pool = &heap->ops.transfer;
+		goto purge;
+	}
+
+	// Lastly trim the allocator, freeing empty memory blocks.
+	_gfx_mutex_lock(&heap->lock);
+	_gfx_allocator_trim(&heap->allocator);
+	_gfx_mutex_unlock(&heap->lock);
+}
+
+/****************************/
+GFX_API void gfx_heap_keep_blocks(GFXHeap* heap, uint32_t num)
+{
+	assert(heap != NULL);
+
+	_gfx_mutex_lock(&heap->lock);
+	heap->allocator.keep = num;
+	_gfx_mutex_unlock(&heap->lock);
+}
+
+/****************************/
+GFX_API void gfx_heap_limit_frees(GFXHeap* heap, uint32_t num)
+{
+	assert(heap != NULL);
+
+	_gfx_mutex_lock(&heap->lock);
+	heap->allocator.release = num;
+	_gfx_mutex_unlock(&heap->lock);
+}
+
+/****************************/
+GFX_API size_t gfx_heap_get_num_budgets(GFXHeap* heap)
+{
+	assert(heap != NULL);
+
+	// Constant, queried on allocator initialization.
+	return heap->allocator.numHeaps;
+}
+
+/****************************/
+GFX_API GFXMemoryBudget gfx_heap_get_budget(GFXHeap* heap, size_t index)
+{
+	assert(heap != NULL);
+	assert(index < heap->allocator.numHeaps);
+
+	_GFXAllocator* alloc = &heap->allocator;
+
+	// Get whether the memory heap is device local.
+	VkPhysicalDeviceMemoryProperties pdmp;
+	_groufix.vk.GetPhysicalDeviceMemoryProperties(
+		alloc->device->vk.device, &pdmp);
+
+	const bool deviceLocal =
+		pdmp.memoryHeaps[index].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+
+	// Lock, as we modify the allocator by refreshing.
+	_gfx_mutex_lock(&heap->lock);
+
+	_gfx_allocator_budget(alloc);
+
+	GFXMemoryBudget budget = {
+		.flags     = deviceLocal ? GFX_MEMORY_DEVICE_LOCAL : GFX_MEMORY_NONE,
+		.size      = alloc->heaps[index].size,
+		.budget    = alloc->heaps[index].budget,
+		.usage     = alloc->heaps[index].usage,
+		.allocated = alloc->heaps[index].allocated
+	};
+
+	_gfx_mutex_unlock(&heap->lock);
+
+	return budget;
+}
+
+/****************************
+ * Swaps the Vulkan buffer and memory between a buffer and a staging buffer.
+ */
+static void _gfx_buffer_swap(_GFXBuffer* buffer, _GFXStaging* staging)
+{
+	_GFXMemAlloc alloc;
+	_gfx_relocate(&alloc, &buffer->alloc);
+	_gfx_relocate(&buffer->alloc, &staging->alloc);
+	_gfx_relocate(&staging->alloc, &alloc);
+
+	VkBuffer vkBuffer = buffer->vk.buffer;
+	buffer->vk.buffer = staging->vk.buffer;
+	staging->vk.buffer = vkBuffer;
+}
+
+/****************************/
+GFX_API void gfx_heap_get_stats(GFXHeap* heap, GFXMemoryStats* stats)
+{
+	assert(heap != NULL);
+	assert(stats != NULL);
+
+	_GFXAllocator* alloc = &heap->allocator;
 
-	// No need to lock :)
-	atomic_fetch_sub(&heap->ops.graphics.blocking, 1);
-	atomic_fetch_sub(&heap->ops.transfer.blocking, 1);
+	VkPhysicalDeviceMemoryProperties pdmp;
+	_groufix.vk.GetPhysicalDeviceMemoryProperties(
+		alloc->device->vk.device, &pdmp);
 
-	return success;
+	// Read all counters, no need to lock.
+	stats->numTypes = pdmp.memoryTypeCount;
 
+	for (uint32_t t = 0; t < VK_MAX_MEMORY_TYPES; ++t)
+		stats->blocks[t] = t < pdmp.memoryTypeCount ?
+			atomic_load(&alloc->stats.blocks[t]) : 0;
 
-	// Early unlock & exit.
-early_exit:
-	_gfx_mutex_unlock(&heap->ops.graphics.lock);
-	_gfx_mutex_unlock(&heap->ops.transfer.lock);
+	stats->allocated = atomic_load(&alloc->stats.allocated);
+	stats->used = atomic_load(&alloc->stats.used);
+	stats->allocs = atomic_load(&alloc->stats.allocs);
+	stats->cells = atomic_load(&alloc->stats.cells);
+	stats->fallbacks = atomic_load(&alloc->stats.fallbacks);
 
-	return success;
+	// Lock to search for the largest free range.
+	_gfx_mutex_lock(&heap->lock);
+	stats->largest = _gfx_allocator_largest(alloc);
+	_gfx_mutex_unlock(&heap->lock);
+
+	// Unused memory includes waste created by alignment.
+	const uint64_t unused =
+		stats->allocated - GFX_MIN(stats->allocated, stats->used);
+
+	stats->fragmentation = (unused == 0) ? 0.0f :
+		1.0f - (float)((double)GFX_MIN(stats->largest, unused) / (double)unused);
 }
 
 /****************************/
-GFX_API void gfx_heap_purge(GFXHeap* heap)
+GFX_API uint64_t gfx_heap_defragment(GFXHeap* heap, uint64_t budget,
+                                     GFXDependency* dep)
 {
 	assert(heap != NULL);
+	assert(dep != NULL);
 
 	_GFXContext* context = heap->allocator.context;
+	uint64_t moved = 0;
 
-	// First purge the graphics queue pool.
-	_GFXTransferPool* pool = &heap->ops.graphics;
+	// Lock, we're modifying the allocator.
+	_gfx_mutex_lock(&heap->lock);
 
-purge:
-	// Lock so we can free command buffers.
-	_gfx_mutex_lock(&pool->lock);
+	for (
+		GFXListNode* node = heap->buffers.head;
+		node != NULL && moved < budget;
+		node = node->next)
+	{
+		_GFXBuffer* buffer = _GFX_BUFFER_FROM_LIST(node);
+		const _GFXMemBlock* block = buffer->alloc.block;
+
+		// We can only copy from buffers we can transfer from and
+		// we never move host visible buffers, they may be mapped.
+		// Buffers in slabs are left to the slabs.
+		// Nor do we move pinned buffers, primitives, groups and sets
+		// hold on to their Vulkan buffer (e.g. within descriptors).
+		if (
+			atomic_load_explicit(&buffer->refs, memory_order_relaxed) > 0 ||
+			buffer->alloc.slab != NULL ||
+			!(buffer->base.flags & GFX_MEMORY_READ) ||
+			(buffer->base.flags & GFX_MEMORY_HOST_VISIBLE))
+		{
+			continue;
+		}
 
-	// Check the front-most transfer operation, continue
-	// until one is not done yet, it's a round-robin.
-	// Note we check if the host is blocking for any operations,
-	// if so, we cannot destroy the fences, so skip purging...
-	const bool isBlocking = atomic_load(&pool->blocking) > 0;
+		// Only move out of sparsely used blocks & do not exceed the budget.
+		// Note this also skips dedicated allocations, they are fully used.
+		if (
+			block->used > block->size / 2 ||
+			buffer->alloc.size > budget - moved)
+		{
+			continue;
+		}
 
-	while (!isBlocking && pool->transfers.size > 0)
-	{
-		// Check if the transfer is flushed & done.
-		// If it is not, we are done purging.
-		_GFXTransfer* transfer = gfx_deque_at(&pool->transfers, 0);
-		if (!transfer->flushed)
+		// Create a new Vulkan buffer we can transfer to.
+		// We use a staging buffer object to hold it, which
+		// will eventually hold the old buffer so it gets retired.
+		_GFXStaging* staging = malloc(sizeof(_GFXStaging));
+		if (staging == NULL)
 			break;
 
-		VkResult result = context->vk.GetFenceStatus(
-			context->vk.device, transfer->vk.done);
+		staging->chunk = NULL;
+		staging->offset = 0;
+		staging->refs = 0;
+		staging->vk.ptr = NULL;
+		staging->vk.buffer =
+			_gfx_buffer_create(buffer, VK_BUFFER_USAGE_TRANSFER_DST_BIT);
 
-		if (result == VK_NOT_READY)
+		if (staging->vk.buffer == VK_NULL_HANDLE)
+		{
+			free(staging);
 			break;
+		}
 
-		if (result != VK_SUCCESS)
+		// Try to claim memory in a more densely used block.
+		// If we cannot, just leave this buffer be.
+		VkMemoryRequirements mr;
+		context->vk.GetBufferMemoryRequirements(
+			context->vk.device, staging->vk.buffer, &mr);
+
+		if (!_gfx_alloc_defrag(
+			&heap->allocator, &staging->alloc, &buffer->alloc, mr))
 		{
-			// Woopsie daisy :o
-			_gfx_mutex_unlock(&pool->lock);
+			goto skip;
+		}
 
-			_GFX_VK_CHECK(result, {});
-			gfx_log_warn("Heap purge failed.");
-			return;
+		_GFX_VK_CHECK(
+			context->vk.BindBufferMemory(
+				context->vk.device,
+				staging->vk.buffer,
+				staging->alloc.vk.memory, staging->alloc.offset),
+			{
+				_gfx_free(&heap->allocator, &staging->alloc);
+				goto skip;
+			});
+
+		// Swap the old and the new, then record the copy.
+		// Unlock while recording, as recording may free staging buffers!
+		_gfx_buffer_swap(buffer, staging);
+		_gfx_mutex_unlock(&heap->lock);
+
+		const bool success = _gfx_move_buffer(heap, buffer, staging, dep);
+
+		_gfx_mutex_lock(&heap->lock);
+
+		if (success)
+		{
+			moved += buffer->alloc.size;
+			continue;
 		}
 
-		// If it is, destroy its resources.
-		context->vk.FreeCommandBuffers(
-			context->vk.device, pool->vk.pool, 1, &transfer->vk.cmd);
-		context->vk.DestroyFence(
-			context->vk.device, transfer->vk.done, NULL);
+		// On failure, swap back and stop.
+		_gfx_buffer_swap(buffer, staging);
+		_gfx_free(&heap->allocator, &staging->alloc);
 
-		_gfx_free_stagings(heap, transfer);
+		context->vk.DestroyBuffer(
+			context->vk.device, staging->vk.buffer, NULL);
 
-		// And pop it.
-		gfx_deque_pop_front(&pool->transfers, 1);
-	}
+		free(staging);
+		break;
 
-	_gfx_mutex_unlock(&pool->lock);
+	skip:
+		context->vk.DestroyBuffer(
+			context->vk.device, staging->vk.buffer, NULL);
 
-	// Then purge transfer queue pool.
-	if (pool == &heap->ops.graphics)
-	{
-		pool = &heap->ops.transfer;
-		goto purge;
+		free(staging);
 	}
+
+	_gfx_mutex_unlock(&heap->lock);
+
+	// Flush all copies, so the dependency signals become visible.
+	if (moved > 0 && !gfx_heap_flush(heap))
+		gfx_log_warn("Heap defragmentation could not flush all moves.");
+
+	return moved;
 }
 
 /****************************/
@@ -995,17 +1866,15 @@ GFX_API GFXBuffer* gfx_alloc_buffer(GFXHeap* heap,
 	buffer->base.usage = usage;
 	buffer->base.size = size;
 
-	// Allocate the Vulkan buffer.
-	// Now we will actually modify the heap, so we lock!
-	_gfx_mutex_lock(&heap->lock);
+	atomic_store_explicit(&buffer->refs, 0, memory_order_relaxed);
 
+	// Allocate the Vulkan buffer.
+	// This locks the heap by itself, only when necessary.
 	if (!_gfx_buffer_alloc(buffer))
-	{
-		_gfx_mutex_unlock(&heap->lock);
 		goto clean;
-	}
 
-	// Link into the heap & unlock.
+	// Link into the heap, we modify the heap so we lock!
+	_gfx_mutex_lock(&heap->lock);
 	gfx_list_insert_after(&heap->buffers, &buffer->list, NULL);
 
 	_gfx_mutex_unlock(&heap->lock);
@@ -1030,14 +1899,16 @@ GFX_API void gfx_free_buffer(GFXBuffer* buffer)
 	_GFXBuffer* buff = (_GFXBuffer*)buffer;
 	GFXHeap* heap = buff->heap;
 
+	// Drop all queued uploads, they would write to freed memory.
+	_gfx_heap_drop_streams(heap, buffer);
+
 	// Unlink from heap & free.
 	_gfx_mutex_lock(&heap->lock);
-
 	gfx_list_erase(&heap->buffers, &buff->list);
-	_gfx_buffer_free(buff);
-
 	_gfx_mutex_unlock(&heap->lock);
 
+	_gfx_buffer_free(buff);
+
 	free(buff);
 }
 
@@ -1096,16 +1967,12 @@ GFX_API GFXImage* gfx_alloc_image(GFXHeap* heap,
 	image->base.depth = depth;
 
 	// Allocate the Vulkan image.
-	// Now we will actually modify the heap, so we lock!
-	_gfx_mutex_lock(&heap->lock);
-
+	// This locks the heap by itself, only when necessary.
 	if (!_gfx_image_alloc(image))
-	{
-		_gfx_mutex_unlock(&heap->lock);
 		goto clean;
-	}
 
-	// Link into the heap & unlock.
+	// Link into the heap, we modify the heap so we lock!
+	_gfx_mutex_lock(&heap->lock);
 	gfx_list_insert_after(&heap->images, &image->list, NULL);
 
 	_gfx_mutex_unlock(&heap->lock);
@@ -1131,15 +1998,235 @@ GFX_API void gfx_free_image(GFXImage* image)
 	_GFXImage* img = (_GFXImage*)image;
 	GFXHeap* heap = img->heap;
 
+	// Drop all queued uploads, they would write to freed memory.
+	_gfx_heap_drop_streams(heap, image);
+
 	// Unlink from heap & free.
 	_gfx_mutex_lock(&heap->lock);
-
 	gfx_list_erase(&heap->images, &img->list);
+	_gfx_mutex_unlock(&heap->lock);
+
 	_gfx_image_free(img);
 
+	free(img);
+}
+
+/****************************
+ * Allocates a new geometry block, not yet linked into the heap.
+ * @return NULL on failure.
+ */
+static _GFXGeometry* _gfx_alloc_geometry(GFXHeap* heap,
+                                         GFXMemoryFlags flags,
+                                         GFXBufferUsage usage)
+{
+	_GFXGeometry* geom = malloc(sizeof(_GFXGeometry));
+	if (geom == NULL)
+		return NULL;
+
+	// Always usable as both vertex and index buffer,
+	// so indexed & non-indexed primitives can share it.
+	geom->buffer.heap = heap;
+	geom->buffer.base.size = _GFX_GEOMETRY_BLOCK_SIZE;
+	geom->buffer.base.flags = flags;
+	geom->buffer.base.usage = usage | GFX_BUFFER_VERTEX | GFX_BUFFER_INDEX;
+	atomic_store_explicit(&geom->buffer.refs, 0, memory_order_relaxed);
+
+	geom->flags = flags;
+	geom->usage = usage;
+	geom->used = 0;
+
+	// Start with one free range spanning the entire block.
+	const _GFXGeomRange range = { .offset = 0, .size = _GFX_GEOMETRY_BLOCK_SIZE };
+	gfx_vec_init(&geom->free, sizeof(_GFXGeomRange));
+
+	if (!gfx_vec_push(&geom->free, 1, &range))
+		goto clean;
+
+	// This locks the heap by itself.
+	if (!_gfx_buffer_alloc(&geom->buffer))
+		goto clean;
+
+	return geom;
+
+
+	// Cleanup on failure.
+clean:
+	gfx_vec_clear(&geom->free);
+	free(geom);
+
+	return NULL;
+}
+
+/****************************
+ * Frees a geometry block, must be unlinked from the heap.
+ */
+static void _gfx_free_geometry(_GFXGeometry* geom)
+{
+	_gfx_buffer_free(&geom->buffer);
+	gfx_vec_clear(&geom->free);
+	free(geom);
+}
+
+/****************************
+ * Claims a range of a geometry block for a primitive.
+ * Vertices are aligned to their stride & indices to their size,
+ * so both can be addressed from offset 0 of the block.
+ * @param prim Cannot be NULL, its geometry fields are set on success.
+ * @return Zero if the block has no room.
+ *
+ * The heap must be locked!
+ */
+static bool _gfx_geometry_claim(_GFXGeometry* geom, _GFXPrimitive* prim,
+                                uint32_t stride, uint64_t verSize,
+                                char indexSize, uint64_t indSize)
+{
+	// First fit, the free list is short as ranges are merged on release.
+	for (size_t r = 0; r < geom->free.size; ++r)
+	{
+		_GFXGeomRange* range = gfx_vec_at(&geom->free, r);
+
+		const uint64_t verOffset =
+			(range->offset + stride - 1) / stride * stride;
+		const uint64_t indOffset = indSize > 0 ?
+			GFX_ALIGN_UP(verOffset + verSize, (uint64_t)indexSize) :
+			verOffset + verSize;
+		const uint64_t end =
+			indOffset + indSize;
+
+		if (end > range->offset + range->size)
+			continue;
+
+		// Claim from the start of the range, including alignment.
+		prim->geometry = geom;
+		prim->range.offset = range->offset;
+		prim->range.size = end - range->offset;
+		prim->baseVertex = (uint32_t)(verOffset / stride);
+		prim->baseIndex = indSize > 0 ? (uint32_t)(indOffset / indexSize) : 0;
+
+		range->size -= prim->range.size;
+		range->offset = end;
+		geom->used += prim->range.size;
+
+		if (range->size == 0) gfx_vec_erase(&geom->free, 1, r);
+
+		return 1;
+	}
+
+	return 0;
+}
+
+/****************************
+ * Releases the range of a geometry block claimed by a primitive.
+ * @param prim Cannot be NULL, prim->geometry cannot be NULL.
+ * @return Non-zero if the block became empty.
+ *
+ * The heap must be locked!
+ */
+static bool _gfx_geometry_release(_GFXPrimitive* prim)
+{
+	_GFXGeometry* geom = prim->geometry;
+	_GFXGeomRange range = prim->range;
+
+	// Find the first free range after the released range.
+	size_t r = 0;
+	while (r < geom->free.size &&
+		((_GFXGeomRange*)gfx_vec_at(&geom->free, r))->offset < range.offset)
+	{
+		++r;
+	}
+
+	// Merge with the next and/or previous ranges.
+	_GFXGeomRange* next = r < geom->free.size ?
+		gfx_vec_at(&geom->free, r) : NULL;
+	_GFXGeomRange* prev = r > 0 ?
+		gfx_vec_at(&geom->free, r - 1) : NULL;
+
+	geom->used -= range.size;
+
+	if (next != NULL && range.offset + range.size == next->offset)
+	{
+		next->offset = range.offset;
+		next->size += range.size;
+
+		if (prev != NULL && prev->offset + prev->size == next->offset)
+			prev->size += next->size,
+			gfx_vec_erase(&geom->free, 1, r);
+	}
+	else if (prev != NULL && prev->offset + prev->size == range.offset)
+		prev->size += range.size;
+
+	// If we cannot insert a new range, lose it until the block is empty.
+	else if (!gfx_vec_insert(&geom->free, 1, &range, r))
+		gfx_log_warn(
+			"Geometry block could not release primitive range, "
+			"lost %"PRIu64" bytes until the block is empty.",
+			range.size);
+
+	// When empty, reset the free list to a single range,
+	// this also recovers any lost ranges.
+	if (geom->used == 0)
+	{
+		gfx_vec_release(&geom->free);
+		gfx_vec_push(&geom->free, 1, &(_GFXGeomRange){
+			.offset = 0,
+			.size = _GFX_GEOMETRY_BLOCK_SIZE
+		});
+
+		return 1;
+	}
+
+	return 0;
+}
+
+/****************************
+ * Sub-allocates a primitive from the shared geometry of its heap.
+ * Allocates a new geometry block if no compatible block has room.
+ * @param prim Cannot be NULL, its buffer.heap field must be set.
+ * @return Zero on failure.
+ *
+ * Thread-safe with respect to the heap!
+ */
+static bool _gfx_prim_geometry(_GFXPrimitive* prim,
+                               GFXMemoryFlags flags, GFXBufferUsage usage,
+                               uint32_t stride, uint64_t verSize,
+                               char indexSize, uint64_t indSize)
+{
+	GFXHeap* heap = prim->buffer.heap;
+
+	// Look for a compatible geometry block with room.
+	_gfx_mutex_lock(&heap->lock);
+
+	for (
+		GFXListNode* node = heap->geometry.head;
+		node != NULL;
+		node = node->next)
+	{
+		_GFXGeometry* geom = _GFX_GEOMETRY_FROM_LIST(node);
+
+		if (
+			geom->flags == flags && geom->usage == usage &&
+			_gfx_geometry_claim(geom, prim, stride, verSize, indexSize, indSize))
+		{
+			_gfx_mutex_unlock(&heap->lock);
+			return 1;
+		}
+	}
+
 	_gfx_mutex_unlock(&heap->lock);
 
-	free(img);
+	// None found, allocate & link a new one, which always has room.
+	_GFXGeometry* geom = _gfx_alloc_geometry(heap, flags, usage);
+	if (geom == NULL)
+		return 0;
+
+	_gfx_mutex_lock(&heap->lock);
+
+	gfx_list_insert_after(&heap->geometry, &geom->buffer.list, NULL);
+	_gfx_geometry_claim(geom, prim, stride, verSize, indexSize, indSize);
+
+	_gfx_mutex_unlock(&heap->lock);
+
+	return 1;
 }
 
 /****************************/
@@ -1327,6 +2414,8 @@ GFX_API GFXPrimitive* gfx_alloc_prim(GFXHeap* heap,
 		(verSize > 0 ? GFX_BUFFER_VERTEX : 0) |
 		(indSize > 0 ? GFX_BUFFER_INDEX : 0);
 
+	atomic_store_explicit(&prim->buffer.refs, 0, memory_order_relaxed);
+
 	prim->base.flags = 0;
 	prim->base.usage = 0;
 	prim->base.topology = topology;
@@ -1334,27 +2423,73 @@ GFX_API GFXPrimitive* gfx_alloc_prim(GFXHeap* heap,
 	prim->base.numIndices = numIndices;
 	prim->base.indexSize = numIndices > 0 ? indexSize : 0;
 
+	prim->geometry = NULL;
+	prim->baseVertex = 0;
+	prim->baseIndex = 0;
+
 	// Allocate a buffer if required.
 	// If nothing gets allocated, vk.buffer is set to VK_NULL_HANDLE.
 	prim->buffer.vk.buffer = VK_NULL_HANDLE;
 
-	// Now we will actually modify the heap, so we lock!
-	_gfx_mutex_lock(&heap->lock);
-
-	if (prim->buffer.base.size > 0)
+	// Small primitives with all vertex attributes interleaved in a newly
+	// allocated buffer (i.e. a single binding) and newly allocated indices,
+	// if any, are sub-allocated from the heap's shared geometry instead.
+	// Then point all references into the geometry block.
+	const bool shared =
+		verSize > 0 &&
+		prim->numBindings == 1 &&
+		prim->bindings[0].buffer == &prim->buffer &&
+		prim->bindings[0].stride > 0 &&
+		(numIndices == 0 || indSize > 0) &&
+		prim->buffer.base.size <= _GFX_GEOMETRY_MAX_SIZE;
+
+	if (shared)
 	{
-		if (!_gfx_buffer_alloc(&prim->buffer))
+		// This locks the heap by itself.
+		if (!_gfx_prim_geometry(prim, flags, usage,
+			prim->bindings[0].stride, verSize, indexSize, indSize))
 		{
-			_gfx_mutex_unlock(&heap->lock);
 			goto clean;
 		}
 
+		_GFXBuffer* buffer = &prim->geometry->buffer;
+		const uint64_t verOffset =
+			(uint64_t)prim->baseVertex * prim->bindings[0].stride;
+
+		for (size_t a = 0; a < numAttribs; ++a)
+			prim->attribs[a].base.buffer = gfx_ref_buffer_at(buffer, verOffset);
+
+		prim->bindings[0].buffer = buffer;
+		prim->bindings[0].offset = verOffset;
+
+		if (indSize > 0) prim->index = gfx_ref_buffer_at(buffer,
+			(uint64_t)prim->baseIndex * (uint64_t)indexSize);
+
+		// Nothing is allocated for the primitive itself.
+		prim->buffer.base.size = 0;
+		prim->base.flags = buffer->base.flags;
+		prim->base.usage = buffer->base.usage;
+	}
+
+	// This locks the heap by itself, only when necessary.
+	else if (prim->buffer.base.size > 0)
+	{
+		if (!_gfx_buffer_alloc(&prim->buffer))
+			goto clean;
+
 		// Trickle down memory flags & usage to user-land.
 		prim->base.flags = prim->buffer.base.flags;
 		prim->base.usage = prim->buffer.base.usage;
 	}
 
-	// Link into the heap & unlock.
+	// Pin all referenced buffers, so they are never moved.
+	for (size_t a = 0; a < numAttribs; ++a)
+		_gfx_buffer_refer(prim->attribs[a].base.buffer, &prim->buffer, 0);
+
+	_gfx_buffer_refer(prim->index, &prim->buffer, 0);
+
+	// Link into the heap, we modify the heap so we lock!
+	_gfx_mutex_lock(&heap->lock);
 	gfx_list_insert_after(&heap->primitives, &prim->buffer.list, NULL);
 
 	_gfx_mutex_unlock(&heap->lock);
@@ -1379,16 +2514,50 @@ GFX_API void gfx_free_prim(GFXPrimitive* primitive)
 	_GFXPrimitive* prim = (_GFXPrimitive*)primitive;
 	GFXHeap* heap = prim->buffer.heap;
 
+	// Drop all queued uploads, they would write to freed memory.
+	_gfx_heap_drop_streams(heap, primitive);
+
 	// Unlink from heap & free.
 	_gfx_mutex_lock(&heap->lock);
-
 	gfx_list_erase(&heap->primitives, &prim->buffer.list);
 
-	if (prim->buffer.vk.buffer != VK_NULL_HANDLE)
-		_gfx_buffer_free(&prim->buffer);
+	// Release its geometry range, free the block when empty,
+	// unless it is the last block of its kind.
+	_GFXGeometry* geom = NULL;
+
+	if (prim->geometry != NULL && _gfx_geometry_release(prim))
+		for (
+			GFXListNode* node = heap->geometry.head;
+			node != NULL;
+			node = node->next)
+		{
+			_GFXGeometry* other = _GFX_GEOMETRY_FROM_LIST(node);
+
+			if (
+				other != prim->geometry &&
+				other->flags == prim->geometry->flags &&
+				other->usage == prim->geometry->usage)
+			{
+				geom = prim->geometry;
+				gfx_list_erase(&heap->geometry, &geom->buffer.list);
+				break;
+			}
+		}
 
 	_gfx_mutex_unlock(&heap->lock);
 
+	if (geom != NULL)
+		_gfx_free_geometry(geom);
+
+	// Unpin all referenced buffers.
+	for (size_t a = 0; a < prim->numAttribs; ++a)
+		_gfx_buffer_refer(prim->attribs[a].base.buffer, &prim->buffer, 1);
+
+	_gfx_buffer_refer(prim->index, &prim->buffer, 1);
+
+	if (prim->buffer.vk.buffer != VK_NULL_HANDLE)
+		_gfx_buffer_free(&prim->buffer);
+
 	free(prim);
 }
 
@@ -1414,6 +2583,27 @@ GFX_API GFXAttribute gfx_prim_get_attrib(GFXPrimitive* primitive, size_t attrib)
 	return attr;
 }
 
+/****************************
+ * Adds or removes a reference to all buffers referenced by a group.
+ * @param group Cannot be NULL, all bindings must be initialized.
+ * @see _gfx_buffer_refer.
+ */
+static void _gfx_group_refer(_GFXGroup* group, bool release)
+{
+	for (size_t b = 0; b < group->numBindings; ++b)
+	{
+		const GFXBinding* bind = &group->bindings[b];
+
+		if (
+			bind->type == GFX_BINDING_BUFFER ||
+			bind->type == GFX_BINDING_BUFFER_TEXEL)
+		{
+			for (size_t r = 0; r < bind->count; ++r)
+				_gfx_buffer_refer(bind->buffers[r], &group->buffer, release);
+		}
+	}
+}
+
 /****************************/
 GFX_API GFXGroup* gfx_alloc_group(GFXHeap* heap,
                                   GFXMemoryFlags flags, GFXBufferUsage usage,
@@ -1574,6 +2764,8 @@ GFX_API GFXGroup* gfx_alloc_group(GFXHeap* heap,
 	group->buffer.base.usage = usage;
 	group->buffer.base.size = size;
 
+	atomic_store_explicit(&group->buffer.refs, 0, memory_order_relaxed);
+
 	group->base.flags = 0;
 	group->base.usage = 0;
 
@@ -1581,23 +2773,22 @@ GFX_API GFXGroup* gfx_alloc_group(GFXHeap* heap,
 	// If nothing gets allocated, vk.buffer is set to VK_NULL_HANDLE.
 	group->buffer.vk.buffer = VK_NULL_HANDLE;
 
-	// Now we will actually modify the heap, so we lock!
-	_gfx_mutex_lock(&heap->lock);
-
+	// This locks the heap by itself, only when necessary.
 	if (group->buffer.base.size > 0)
 	{
 		if (!_gfx_buffer_alloc(&group->buffer))
-		{
-			_gfx_mutex_unlock(&heap->lock);
 			goto clean;
-		}
 
 		// Trickle down memory flags & usage to user-land.
 		group->base.flags = group->buffer.base.flags;
 		group->base.usage = group->buffer.base.usage;
 	}
 
-	// Link into the heap & unlock.
+	// Pin all referenced buffers, so they are never moved.
+	_gfx_group_refer(group, 0);
+
+	// Link into the heap, we modify the heap so we lock!
+	_gfx_mutex_lock(&heap->lock);
 	gfx_list_insert_after(&heap->groups, &group->buffer.list, NULL);
 
 	_gfx_mutex_unlock(&heap->lock);
@@ -1622,16 +2813,20 @@ GFX_API void gfx_free_group(GFXGroup* group)
 	_GFXGroup* grp = (_GFXGroup*)group;
 	GFXHeap* heap = grp->buffer.heap;
 
+	// Drop all queued uploads, they would write to freed memory.
+	_gfx_heap_drop_streams(heap, group);
+
 	// Unlink from heap & free.
 	_gfx_mutex_lock(&heap->lock);
-
 	gfx_list_erase(&heap->groups, &grp->buffer.list);
+	_gfx_mutex_unlock(&heap->lock);
+
+	// Unpin all referenced buffers.
+	_gfx_group_refer(grp, 1);
 
 	if (grp->buffer.vk.buffer != VK_NULL_HANDLE)
 		_gfx_buffer_free(&grp->buffer);
 
-	_gfx_mutex_unlock(&heap->lock);
-
 	free(group);
 }
 
@@ -15,7 +15,9 @@
 _GFXState _groufix =
 {
 	.initialized = 0,
-	.logDef = GFX_LOG_DEFAULT
+	.logDef = GFX_LOG_DEFAULT,
+	.workersDef = GFX_WORKERS_AUTO,
+	.headlessDef = 0
 };
 
 
@@ -33,9 +35,27 @@ bool _gfx_init(void)
 
 	atomic_store(&_groufix.thread.id, 0);
 
+	// Initialize the job system, without any workers.
+	if (!_gfx_mutex_init(&_groufix.jobs.lock))
+		goto clean_io;
+
+	if (!_gfx_cond_init(&_groufix.jobs.wake))
+		goto clean_jobs_lock;
+
+	_groufix.jobs.numWorkers = 0;
+	_groufix.jobs.started = 0;
+	_groufix.jobs.workers = NULL;
+
+	gfx_deque_init(&_groufix.jobs.queue, sizeof(_GFXJob*));
+	atomic_store(&_groufix.jobs.queued, 0);
+	atomic_store(&_groufix.jobs.shared, 0);
+	atomic_store(&_groufix.jobs.epoch, 0);
+	atomic_store(&_groufix.jobs.sleepers, 0);
+	atomic_store(&_groufix.jobs.stop, 0);
+
 	// Initialize other things...
 	if (!_gfx_mutex_init(&_groufix.contextLock))
-		goto clean_io;
+		goto clean_jobs;
 
 	gfx_vec_init(&_groufix.devices, sizeof(_GFXDevice));
 	gfx_list_init(&_groufix.contexts);
@@ -51,6 +71,10 @@ bool _gfx_init(void)
 
 
 	// Cleanup on failure.
+clean_jobs:
+	_gfx_cond_clear(&_groufix.jobs.wake);
+clean_jobs_lock:
+	_gfx_mutex_clear(&_groufix.jobs.lock);
 clean_io:
 	_gfx_mutex_clear(&_groufix.thread.ioLock);
 clean_key:
@@ -67,9 +91,12 @@ void _gfx_terminate(void)
 	gfx_vec_clear(&_groufix.devices);
 	gfx_list_clear(&_groufix.contexts);
 	gfx_vec_clear(&_groufix.monitors);
+	gfx_deque_clear(&_groufix.jobs.queue);
 
 	_gfx_thread_key_clear(_groufix.thread.key);
 	_gfx_mutex_clear(&_groufix.thread.ioLock);
+	_gfx_cond_clear(&_groufix.jobs.wake);
+	_gfx_mutex_clear(&_groufix.jobs.lock);
 	_gfx_mutex_clear(&_groufix.contextLock);
 
 	// Signal that termination is done.
@@ -95,9 +122,17 @@ bool _gfx_create_local(void)
 	// Give it a unique id.
 	state->id = atomic_fetch_add(&_groufix.thread.id, 1);
 
+	// No sub-allocation caches yet.
+	gfx_vec_init(&state->heap.slabs, sizeof(_GFXThreadSlabs));
+
+	// Not a job system worker (yet).
+	state->jobs.worker = NULL;
+
 	// Initialize the logging stuff.
 	state->log.level = _groufix.logDef;
 	state->log.out = GFX_IO_STDERR; // For initial identification.
+	state->log.life = NULL;
+	gfx_vec_init(&state->log.rings, sizeof(_GFXThreadRing));
 
 	return 1;
 }
@@ -109,7 +144,12 @@ void _gfx_destroy_local(void)
 	assert(_gfx_thread_key_get(_groufix.thread.key));
 
 	// Get key and free it.
-	free(_gfx_thread_key_get(_groufix.thread.key));
+	// The sub-allocation caches themselves are owned by their heaps.
+	// The asynchronous log rings are owned by their logs.
+	_GFXThreadState* state = _gfx_thread_key_get(_groufix.thread.key);
+	gfx_vec_clear(&state->heap.slabs);
+	_gfx_log_detach(state);
+	free(state);
 
 	// I mean this better not fail...
 	_gfx_thread_key_set(_groufix.thread.key, NULL);
@@ -0,0 +1,503 @@
+/**
+ * This file is part of groufix.
+ * Copyright (c) Stef Velzel. All rights reserved.
+ *
+ * groufix : graphics engine produced by Stef Velzel.
+ * www     : <www.vuzzel.nl>
+ */
+
+#include "groufix/core.h"
+#include <assert.h>
+#include <stdlib.h>
+
+
+// Capacity of the deque of each worker, must be a power of two.
+#define _GFX_JOBS_CAPACITY 256
+
+// Maximum number of worker threads.
+#define _GFX_JOBS_MAX_WORKERS 64
+
+// Number of times an idle thread yields before it blocks.
+#define _GFX_JOBS_SPIN 128
+
+
+/****************************
+ * Job system worker definition.
+ * Its deque is a Chase-Lev work-stealing deque: the worker pushes and pops
+ * at the bottom, all other threads steal from the top.
+ */
+struct _GFXJobWorker
+{
+	_GFXThread thread;
+
+	atomic_intmax_t   top;
+	atomic_intmax_t   bottom;
+	_Atomic(_GFXJob*) jobs[_GFX_JOBS_CAPACITY];
+};
+
+
+/****************************
+ * Pushes a job to the bottom of a worker's deque, only the worker may push.
+ * @return Zero if the deque is full.
+ */
+static bool _gfx_jobs_push(_GFXJobWorker* worker, _GFXJob* job)
+{
+	const intmax_t b =
+		atomic_load_explicit(&worker->bottom, memory_order_relaxed);
+	const intmax_t t =
+		atomic_load_explicit(&worker->top, memory_order_acquire);
+
+	if (b - t >= _GFX_JOBS_CAPACITY)
+		return 0;
+
+	atomic_store_explicit(
+		&worker->jobs[b & (_GFX_JOBS_CAPACITY - 1)], job, memory_order_relaxed);
+
+	atomic_thread_fence(memory_order_release);
+	atomic_store_explicit(&worker->bottom, b + 1, memory_order_relaxed);
+
+	return 1;
+}
+
+/****************************
+ * Pops a job from the bottom of a worker's deque, only the worker may pop.
+ * @return NULL if the deque is empty.
+ */
+static _GFXJob* _gfx_jobs_pop(_GFXJobWorker* worker)
+{
+	const intmax_t b =
+		atomic_load_explicit(&worker->bottom, memory_order_relaxed) - 1;
+
+	atomic_store_explicit(&worker->bottom, b, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+
+	intmax_t t =
+		atomic_load_explicit(&worker->top, memory_order_relaxed);
+
+	// Empty, restore bottom.
+	if (t > b)
+	{
+		atomic_store_explicit(&worker->bottom, b + 1, memory_order_relaxed);
+		return NULL;
+	}
+
+	_GFXJob* job = atomic_load_explicit(
+		&worker->jobs[b & (_GFX_JOBS_CAPACITY - 1)], memory_order_relaxed);
+
+	// If it is the last job, race against stealing threads.
+	if (t == b)
+	{
+		if (!atomic_compare_exchange_strong_explicit(&worker->top, &t, t + 1,
+			memory_order_seq_cst, memory_order_relaxed))
+		{
+			job = NULL;
+		}
+
+		atomic_store_explicit(&worker->bottom, b + 1, memory_order_relaxed);
+	}
+
+	return job;
+}
+
+/****************************
+ * Steals a job from the top of a worker's deque, any thread may steal.
+ * @return NULL if the deque is empty or another thread won the race.
+ */
+static _GFXJob* _gfx_jobs_steal(_GFXJobWorker* worker)
+{
+	intmax_t t =
+		atomic_load_explicit(&worker->top, memory_order_acquire);
+
+	atomic_thread_fence(memory_order_seq_cst);
+
+	const intmax_t b =
+		atomic_load_explicit(&worker->bottom, memory_order_acquire);
+
+	if (t >= b)
+		return NULL;
+
+	_GFXJob* job = atomic_load_explicit(
+		&worker->jobs[t & (_GFX_JOBS_CAPACITY - 1)], memory_order_relaxed);
+
+	if (!atomic_compare_exchange_strong_explicit(&worker->top, &t, t + 1,
+		memory_order_seq_cst, memory_order_relaxed))
+	{
+		return NULL;
+	}
+
+	return job;
+}
+
+/****************************
+ * Takes the first job from the shared queue (i.e. the oldest).
+ * @return NULL if the queue is empty.
+ */
+static _GFXJob* _gfx_jobs_take_shared(void)
+{
+	// Avoid contention on the lock when empty.
+	if (atomic_load_explicit(&_groufix.jobs.shared, memory_order_relaxed) == 0)
+		return NULL;
+
+	_GFXJob* job = NULL;
+	_gfx_mutex_lock(&_groufix.jobs.lock);
+
+	if (_groufix.jobs.queue.size > 0)
+	{
+		job = *(_GFXJob**)gfx_deque_at(&_groufix.jobs.queue, 0);
+		gfx_deque_pop_front(&_groufix.jobs.queue, 1);
+		atomic_fetch_sub(&_groufix.jobs.shared, 1);
+	}
+
+	_gfx_mutex_unlock(&_groufix.jobs.lock);
+
+	return job;
+}
+
+/****************************
+ * Takes a job to execute on a worker thread: first from its own deque,
+ * then from the shared queue, then from the deques of all other workers.
+ * @return NULL if none found.
+ */
+static _GFXJob* _gfx_jobs_take(_GFXJobWorker* worker)
+{
+	_GFXJob* job = _gfx_jobs_pop(worker);
+
+	if (job == NULL)
+		job = _gfx_jobs_take_shared();
+
+	if (job == NULL)
+	{
+		// Start stealing from the next worker,
+		// so not all workers steal from the same one.
+		const size_t numWorkers = _groufix.jobs.numWorkers;
+		const size_t w = (size_t)(worker - _groufix.jobs.workers);
+
+		for (size_t i = 1; job == NULL && i < numWorkers; ++i)
+			job = _gfx_jobs_steal(_groufix.jobs.workers + (w + i) % numWorkers);
+	}
+
+	if (job != NULL)
+		atomic_fetch_sub(&_groufix.jobs.queued, 1);
+
+	return job;
+}
+
+/****************************
+ * Wakes up all threads blocked in _gfx_jobs_block.
+ */
+static void _gfx_jobs_wake(void)
+{
+	// Both are sequentially consistent, so either we see the sleeper,
+	// or the sleeper sees the new epoch.
+	atomic_fetch_add(&_groufix.jobs.epoch, 1);
+
+	if (atomic_load(&_groufix.jobs.sleepers) > 0)
+	{
+		_gfx_mutex_lock(&_groufix.jobs.lock);
+		_gfx_cond_broadcast(&_groufix.jobs.wake);
+		_gfx_mutex_unlock(&_groufix.jobs.lock);
+	}
+}
+
+/****************************
+ * Blocks the calling thread until _gfx_jobs_wake is called.
+ * @param epoch Value of _groufix.jobs.epoch read before checking for work,
+ *              returns immediately if it changed since.
+ */
+static void _gfx_jobs_block(size_t epoch)
+{
+	_gfx_mutex_lock(&_groufix.jobs.lock);
+	atomic_fetch_add(&_groufix.jobs.sleepers, 1);
+
+	while (atomic_load(&_groufix.jobs.epoch) == epoch)
+		_gfx_cond_wait(&_groufix.jobs.wake, &_groufix.jobs.lock);
+
+	atomic_fetch_sub(&_groufix.jobs.sleepers, 1);
+	_gfx_mutex_unlock(&_groufix.jobs.lock);
+}
+
+/****************************
+ * Executes a job and decreases its counter (and all its parents).
+ * Wakes up all blocked threads if any counter hits zero.
+ */
+static void _gfx_jobs_run(_GFXJob* job)
+{
+	// Read the counter first, the job may resubmit itself.
+	_GFXJobCounter* counter = job->counter;
+	job->func(job->arg);
+
+	// Read each parent before decreasing,
+	// the counter may be freed once it hits zero.
+	bool zero = 0;
+
+	while (counter != NULL)
+	{
+		_GFXJobCounter* parent = counter->parent;
+		zero |= atomic_fetch_sub_explicit(
+			&counter->count, 1, memory_order_release) == 1;
+		counter = parent;
+	}
+
+	if (zero) _gfx_jobs_wake();
+}
+
+/****************************
+ * Checks whether a job is counted by a given counter.
+ */
+static bool _gfx_jobs_owns(const _GFXJobCounter* counter, const _GFXJob* job)
+{
+	for (const _GFXJobCounter* c = job->counter; c != NULL; c = c->parent)
+		if (c == counter) return 1;
+
+	return 0;
+}
+
+/****************************
+ * Worker thread entry point.
+ * @param arg The _GFXJobWorker* to run.
+ */
+static _GFXThreadRet _GFX_THREAD_CALL _gfx_jobs_worker(void* arg)
+{
+	_GFXJobWorker* worker = arg;
+
+	// Attach as any other thread, jobs may use thread local state.
+	if (gfx_attach())
+		_gfx_get_local()->jobs.worker = worker;
+	else
+		gfx_log_warn("Job system worker could not attach itself.");
+
+	// Keep executing jobs, when idle, first yield to other threads,
+	// then block until a job comes along.
+	// When stopped, finish all jobs that are left.
+	unsigned int idle = 0;
+
+	while (1)
+	{
+		// Read the epoch before looking for work, so we cannot miss
+		// a wake up in between.
+		const size_t epoch = atomic_load(&_groufix.jobs.epoch);
+
+		_GFXJob* job = _gfx_jobs_take(worker);
+		if (job != NULL)
+		{
+			_gfx_jobs_run(job);
+			idle = 0;
+			continue;
+		}
+
+		if (
+			atomic_load(&_groufix.jobs.stop) &&
+			atomic_load(&_groufix.jobs.queued) == 0)
+		{
+			break;
+		}
+
+		if (idle < _GFX_JOBS_SPIN)
+			_gfx_thread_yield(), ++idle;
+		else
+			_gfx_jobs_block(epoch);
+	}
+
+	gfx_detach();
+
+	return 0;
+}
+
+/****************************/
+bool _gfx_jobs_init(void)
+{
+	assert(atomic_load(&_groufix.initialized));
+	assert(_groufix.jobs.workers == NULL);
+
+	atomic_store(&_groufix.jobs.stop, 0);
+
+	// By default, each logical processor (but the calling thread's) gets a
+	// worker, the application can configure fewer if it has its own threads.
+	const unsigned int concurrency = _gfx_thread_concurrency();
+	const size_t numWorkers = GFX_MIN(_GFX_JOBS_MAX_WORKERS,
+		_groufix.workersDef == GFX_WORKERS_AUTO ?
+			(size_t)concurrency - 1 : (size_t)_groufix.workersDef);
+
+	if (numWorkers == 0)
+		goto done;
+
+	// Allocate & initialize all deques before starting any thread,
+	// they steal from each other.
+	_groufix.jobs.workers = malloc(sizeof(_GFXJobWorker) * numWorkers);
+	if (_groufix.jobs.workers == NULL)
+	{
+		gfx_log_warn(
+			"Could not allocate job system workers, "
+			"all jobs are executed by submitting threads.");
+
+		goto done;
+	}
+
+	for (size_t w = 0; w < numWorkers; ++w)
+	{
+		_GFXJobWorker* worker = _groufix.jobs.workers + w;
+		atomic_store(&worker->top, 0);
+		atomic_store(&worker->bottom, 0);
+	}
+
+	_groufix.jobs.numWorkers = numWorkers;
+
+	// Start all workers, on failure we can only use fewer.
+	// The deques of workers that did not start are never pushed to,
+	// so other workers just never find anything to steal there.
+	for (size_t w = 0; w < numWorkers; ++w)
+	{
+		if (_gfx_thread_create(
+			&_groufix.jobs.workers[w].thread, _gfx_jobs_worker,
+			_groufix.jobs.workers + w))
+		{
+			++_groufix.jobs.started;
+		}
+		else
+		{
+			gfx_log_warn(
+				"Could only start %"GFX_PRIs" out of %"GFX_PRIs" "
+				"job system workers.",
+				w, numWorkers);
+
+			break;
+		}
+	}
+
+done:
+	gfx_log_info(
+		"Job system started with %"GFX_PRIs" worker thread(s).",
+		_groufix.jobs.started);
+
+	return 1;
+}
+
+/****************************/
+void _gfx_jobs_terminate(void)
+{
+	// Stop all workers, they finish all jobs first.
+	atomic_store(&_groufix.jobs.stop, 1);
+	_gfx_jobs_wake();
+
+	for (size_t w = 0; w < _groufix.jobs.started; ++w)
+		_gfx_thread_join(_groufix.jobs.workers[w].thread);
+
+	free(_groufix.jobs.workers);
+
+	_groufix.jobs.numWorkers = 0;
+	_groufix.jobs.started = 0;
+	_groufix.jobs.workers = NULL;
+}
+
+/****************************/
+size_t _gfx_jobs_concurrency(void)
+{
+	return _groufix.jobs.started + 1;
+}
+
+/****************************/
+void _gfx_jobs_submit(_GFXJobCounter* counter, size_t numJobs, _GFXJob* jobs)
+{
+	assert(numJobs == 0 || jobs != NULL);
+
+	if (numJobs == 0) return;
+
+	// Count all jobs before submitting any,
+	// so the counter cannot hit zero in between.
+	for (_GFXJobCounter* c = counter; c != NULL; c = c->parent)
+		atomic_fetch_add_explicit(&c->count, numJobs, memory_order_relaxed);
+
+	_GFXThreadState* state = _gfx_get_local();
+	_GFXJobWorker* worker = (state == NULL) ? NULL : state->jobs.worker;
+
+	for (size_t j = 0; j < numJobs; ++j)
+	{
+		jobs[j].counter = counter;
+		bool pushed = 0;
+
+		// Workers push to their own deque, others to the shared queue.
+		// Without any workers, just execute it right away.
+		if (worker != NULL)
+			pushed = _gfx_jobs_push(worker, jobs + j);
+
+		else if (_groufix.jobs.started > 0)
+		{
+			_GFXJob* job = jobs + j;
+			_gfx_mutex_lock(&_groufix.jobs.lock);
+
+			if ((pushed = gfx_deque_push(&_groufix.jobs.queue, 1, &job)))
+				atomic_fetch_add(&_groufix.jobs.shared, 1);
+
+			_gfx_mutex_unlock(&_groufix.jobs.lock);
+		}
+
+		if (pushed)
+			atomic_fetch_add(&_groufix.jobs.queued, 1),
+			_gfx_jobs_wake();
+		else
+			_gfx_jobs_run(jobs + j);
+	}
+}
+
+/****************************/
+void _gfx_jobs_wait(_GFXJobCounter* counter)
+{
+	assert(counter != NULL);
+
+	_GFXThreadState* state = _gfx_get_local();
+	_GFXJobWorker* worker = (state == NULL) ? NULL : state->jobs.worker;
+
+	unsigned int idle = 0;
+
+	while (atomic_load_explicit(&counter->count, memory_order_acquire) > 0)
+	{
+		// Read the epoch before looking for work, so we cannot miss
+		// a wake up in between.
+		const size_t epoch = atomic_load(&_groufix.jobs.epoch);
+		_GFXJob* job = NULL;
+
+		if (worker != NULL)
+			// Workers help out with anything,
+			// the jobs we wait for may themselves wait for others.
+			job = _gfx_jobs_take(worker);
+
+		else if (atomic_load_explicit(
+			&_groufix.jobs.shared, memory_order_relaxed) > 0)
+		{
+			// Others only take back their own jobs, which were (most likely)
+			// pushed last, i.e. are at the back of the queue.
+			_gfx_mutex_lock(&_groufix.jobs.lock);
+
+			GFXDeque* queue = &_groufix.jobs.queue;
+			if (queue->size > 0)
+			{
+				_GFXJob* back = *(_GFXJob**)gfx_deque_at(queue, queue->size - 1);
+				if (_gfx_jobs_owns(counter, back))
+				{
+					job = back;
+					gfx_deque_pop(queue, 1);
+					atomic_fetch_sub(&_groufix.jobs.shared, 1);
+					atomic_fetch_sub(&_groufix.jobs.queued, 1);
+				}
+			}
+
+			_gfx_mutex_unlock(&_groufix.jobs.lock);
+		}
+
+		if (job != NULL)
+		{
+			_gfx_jobs_run(job);
+			idle = 0;
+		}
+		else if (idle < _GFX_JOBS_SPIN)
+			_gfx_thread_yield(), ++idle;
+
+		// Block until a job is pushed or any counter hits zero,
+		// check the counter again, it may have hit zero since the epoch.
+		else if (atomic_load_explicit(
+			&counter->count, memory_order_acquire) > 0)
+		{
+			_gfx_jobs_block(epoch);
+		}
+	}
+}
@@ -0,0 +1,115 @@
+/**
+ * This file is part of groufix.
+ * Copyright (c) Stef Velzel. All rights reserved.
+ *
+ * groufix : graphics engine produced by Stef Velzel.
+ * www     : <www.vuzzel.nl>
+ */
+
+
+#ifndef _GFX_CORE_JOBS_H
+#define _GFX_CORE_JOBS_H
+
+#include "groufix/def.h"
+
+
+/**
+ * Job counter, counts all unfinished jobs submitted with it,
+ * including those submitted with any of its children.
+ */
+typedef struct _GFXJobCounter
+{
+	atomic_size_t          count;
+	struct _GFXJobCounter* parent; // NULL if none.
+
+} _GFXJobCounter;
+
+
+/**
+ * Job definition, must stay alive until its counter is decreased.
+ */
+typedef struct _GFXJob
+{
+	void (*func)(void*);
+	void* arg;
+
+	_GFXJobCounter* counter; // Set on submission.
+
+} _GFXJob;
+
+
+/**
+ * Job system worker declaration.
+ */
+typedef struct _GFXJobWorker _GFXJobWorker;
+
+
+/****************************
+ * Job system.
+ ****************************/
+
+/**
+ * Initializes a job counter.
+ * @param counter Cannot be NULL.
+ * @param parent  Counter to also count all jobs in, may be NULL.
+ *
+ * The parent must outlive all jobs submitted with the counter.
+ */
+static inline void _gfx_job_counter(_GFXJobCounter* counter,
+                                    _GFXJobCounter* parent)
+{
+	atomic_store_explicit(&counter->count, 0, memory_order_relaxed);
+	counter->parent = parent;
+}
+
+/**
+ * Starts the job system, spawning _groufix.workersDef worker threads.
+ * _groufix.initialized must be 1, no workers may be started yet.
+ * @return Non-zero on success.
+ *
+ * Worker threads attach themselves, they have thread local state.
+ * Fewer workers may be started than configured, but never more.
+ */
+bool _gfx_jobs_init(void);
+
+/**
+ * Stops the job system, finishing all submitted jobs.
+ * Must be called by the same thread that called _gfx_jobs_init,
+ * can be called without having started the job system.
+ */
+void _gfx_jobs_terminate(void);
+
+/**
+ * Retrieves the number of threads that can execute jobs concurrently,
+ * i.e. the number of worker threads + the calling thread.
+ * @return Always at least 1.
+ */
+size_t _gfx_jobs_concurrency(void);
+
+/**
+ * Submits jobs to be executed by the job system.
+ * @param counter Counter to count the jobs in, may be NULL.
+ * @param jobs    Cannot be NULL if numJobs > 0.
+ *
+ * The calling thread must be attached.
+ * Jobs may be executed on any thread, including the calling thread, in any
+ * order, the calling thread executes them immediately if there is no room.
+ * Jobs submitted from a job are pushed to the worker thread executing it,
+ * other workers steal these jobs when they run out.
+ */
+void _gfx_jobs_submit(_GFXJobCounter* counter, size_t numJobs, _GFXJob* jobs);
+
+/**
+ * Blocks until a counter hits zero, i.e. all its jobs are finished.
+ * @param counter Cannot be NULL.
+ *
+ * The calling thread must be attached.
+ * Worker threads execute any other job until then, so jobs can themselves
+ * fork (submit) and join (wait), but should not hold any locks while
+ * waiting that other jobs could take.
+ * Non-worker threads only execute their own jobs not yet taken by a worker.
+ */
+void _gfx_jobs_wait(_GFXJobCounter* counter);
+
+
+#endif
@@ -8,6 +8,7 @@
 
 #include "groufix/core.h"
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
@@ -37,6 +38,380 @@ static const char* _gfx_log_colors[] = {
 #endif
 
 
+// Size of an asynchronous log record, longer records are truncated.
+#define _GFX_LOG_RECORD_SIZE 512
+
+// Default number of asynchronous log records buffered per thread.
+#define _GFX_LOG_DEFAULT_CAPACITY 256
+
+// Interval at which the asynchronous log writer drains, in milliseconds.
+#define _GFX_LOG_INTERVAL 5
+
+// Maximum number of asynchronous log rings a thread remembers.
+#define _GFX_LOG_THREAD_RINGS 16
+
+
+/****************************
+ * Preformatted asynchronous log record.
+ */
+typedef struct _GFXLogRecord
+{
+	uint32_t len;
+	char     text[_GFX_LOG_RECORD_SIZE - sizeof(uint32_t)];
+
+} _GFXLogRecord;
+
+
+/****************************
+ * Lifetime of a thread writing to asynchronous logs.
+ */
+typedef struct _GFXLogLife
+{
+	atomic_bool alive; // Zero once the thread detached.
+	atomic_uint refs;  // The thread itself + all its rings.
+
+} _GFXLogLife;
+
+
+/****************************
+ * Single-producer single-consumer ring of log records, one per thread.
+ */
+typedef struct _GFXLogRing
+{
+	struct _GFXLogRing* next;
+	_GFXLogLife*        life; // Of the producing thread.
+
+	atomic_size_t head; // Written by the writer thread only.
+	atomic_size_t tail; // Written by the producing thread only.
+
+	_GFXLogRecord records[]; // Capacity in total.
+
+} _GFXLogRing;
+
+
+/****************************
+ * Asynchronous logging output definition.
+ */
+struct GFXAsyncLog
+{
+	GFXWriter        writer;
+	const GFXWriter* out;
+
+	uintmax_t id;
+	size_t    capacity; // Power of two.
+	bool      color;
+
+	_Atomic(_GFXLogRing*) rings; // Pushed by threads, unlinked by writer.
+	atomic_uint_fast64_t  dropped;
+	atomic_bool           stop;
+
+	_GFXThread thread;
+};
+
+
+/****************************
+ * Chrome trace output definition.
+ */
+struct GFXTraceWriter
+{
+	GFXTracer        tracer;
+	const GFXWriter* out;
+
+	uint64_t freq;  // Timer frequency.
+	uint64_t start; // Timer value at creation.
+};
+
+
+/****************************
+ * Next asynchronous log id, 0 is never used.
+ */
+static atomic_uintmax_t _gfx_log_async_id = 1;
+
+
+/****************************
+ * Current tracer, NULL if not tracing.
+ */
+static _Atomic(const GFXTracer*) _gfx_tracer = NULL;
+
+
+/****************************
+ * Checks whether a writer stream is a tty we can output color to.
+ */
+static bool _gfx_log_is_tty(const GFXWriter* out)
+{
+#if defined (GFX_UNIX)
+	return
+		(out == GFX_IO_STDOUT && isatty(STDOUT_FILENO)) ||
+		(out == GFX_IO_STDERR && isatty(STDERR_FILENO));
+#else
+	return 0;
+#endif
+}
+
+/****************************
+ * Releases a reference to the lifetime of a thread, freeing it at zero.
+ */
+static void _gfx_log_life_release(_GFXLogLife* life)
+{
+	if (atomic_fetch_sub_explicit(&life->refs, 1, memory_order_acq_rel) == 1)
+		free(life);
+}
+
+/****************************
+ * Retrieves the ring of the calling thread for an asynchronous log,
+ * allocating and inserting a new one if it does not have one yet.
+ * @return NULL if the calling thread is not attached or on failure.
+ */
+static _GFXLogRing* _gfx_log_async_ring(GFXAsyncLog* log)
+{
+	_GFXThreadState* state = _gfx_get_local();
+	if (state == NULL) return NULL;
+
+	// Look for the ring of this log, log ids are never reused,
+	// so rings of destroyed logs are never found.
+	// The rings themselves are only ever looked up by their own thread,
+	// so the writer thread can retire them once this thread detached.
+	for (size_t r = state->log.rings.size; r > 0; --r)
+	{
+		_GFXThreadRing* tRing = gfx_vec_at(&state->log.rings, r-1);
+		if (tRing->log == log->id) return tRing->ring;
+	}
+
+	// Not found, the thread shares its lifetime with all its rings.
+	if (state->log.life == NULL)
+	{
+		_GFXLogLife* life = malloc(sizeof(_GFXLogLife));
+		if (life == NULL) return NULL;
+
+		atomic_init(&life->alive, 1);
+		atomic_init(&life->refs, 1);
+		state->log.life = life;
+	}
+
+	_GFXLogRing* ring = malloc(
+		sizeof(_GFXLogRing) + sizeof(_GFXLogRecord) * log->capacity);
+
+	if (ring == NULL) return NULL;
+
+	// Forget the oldest ring if we remember too many,
+	// it is still owned (and eventually retired) by its log.
+	if (state->log.rings.size >= _GFX_LOG_THREAD_RINGS)
+		gfx_vec_erase(&state->log.rings, 1, 0);
+
+	_GFXThreadRing tRing = { .log = log->id, .ring = ring };
+	if (!gfx_vec_push(&state->log.rings, 1, &tRing))
+	{
+		free(ring);
+		return NULL;
+	}
+
+	ring->life = state->log.life;
+	atomic_fetch_add_explicit(&ring->life->refs, 1, memory_order_relaxed);
+
+	atomic_init(&ring->head, 0);
+	atomic_init(&ring->tail, 0);
+
+	// Push it onto the list, only ever contended by new rings.
+	ring->next = atomic_load_explicit(&log->rings, memory_order_relaxed);
+	while (!atomic_compare_exchange_weak_explicit(&log->rings,
+		&ring->next, ring, memory_order_release, memory_order_relaxed));
+
+	return ring;
+}
+
+/****************************
+ * Claims the next record to write in a ring.
+ * @return NULL if the ring is full, the record is dropped.
+ */
+static _GFXLogRecord* _gfx_log_async_claim(GFXAsyncLog* log, _GFXLogRing* ring)
+{
+	const size_t tail =
+		atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+	if (tail - atomic_load_explicit(&ring->head, memory_order_acquire) >=
+		log->capacity)
+	{
+		atomic_fetch_add_explicit(&log->dropped, 1, memory_order_relaxed);
+		return NULL;
+	}
+
+	return ring->records + (tail & (log->capacity - 1));
+}
+
+/****************************
+ * Publishes the record last claimed to the writer thread.
+ */
+static void _gfx_log_async_publish(_GFXLogRing* ring)
+{
+	atomic_store_explicit(&ring->tail,
+		atomic_load_explicit(&ring->tail, memory_order_relaxed) + 1,
+		memory_order_release);
+}
+
+/****************************
+ * GFXAsyncLog implementation of the write function.
+ * Data is split into records as is, without any formatting.
+ */
+static long long _gfx_log_async_write(const GFXWriter* str, const void* data, size_t len)
+{
+	GFXAsyncLog* log = GFX_IO_OBJ(str, GFXAsyncLog, writer);
+
+	_GFXLogRing* ring = _gfx_log_async_ring(log);
+	if (ring == NULL)
+	{
+		atomic_fetch_add_explicit(&log->dropped, 1, memory_order_relaxed);
+		return -1;
+	}
+
+	for (size_t pos = 0; pos < len; )
+	{
+		_GFXLogRecord* rec = _gfx_log_async_claim(log, ring);
+		if (rec == NULL) return (long long)pos;
+
+		const size_t size = GFX_MIN(len - pos, sizeof(rec->text));
+		memcpy(rec->text, (const char*)data + pos, size);
+		rec->len = (uint32_t)size;
+
+		_gfx_log_async_publish(ring);
+		pos += size;
+	}
+
+	return (long long)len;
+}
+
+/****************************
+ * Writes all published records of an asynchronous log to its output.
+ * Retires all rings of threads that detached, once drained.
+ */
+static void _gfx_log_async_drain(GFXAsyncLog* log)
+{
+	_GFXLogRing* prev = NULL;
+	_GFXLogRing* ring =
+		atomic_load_explicit(&log->rings, memory_order_acquire);
+
+	while (ring != NULL)
+	{
+		_GFXLogRing* next = ring->next;
+
+		// Check whether the thread detached before reading the tail,
+		// if so, this drains its last records.
+		const bool detached =
+			!atomic_load_explicit(&ring->life->alive, memory_order_acquire);
+
+		size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+		const size_t tail =
+			atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+		if (head != tail)
+		{
+			// Synchronize with threads logging to the output directly.
+			_gfx_mutex_lock(&_groufix.thread.ioLock);
+
+			for (; head != tail; ++head)
+			{
+				const _GFXLogRecord* rec =
+					ring->records + (head & (log->capacity - 1));
+
+				gfx_io_write(log->out, rec->text, rec->len);
+			}
+
+			_gfx_mutex_unlock(&_groufix.thread.ioLock);
+
+			// Release the records to the producing thread.
+			atomic_store_explicit(&ring->head, head, memory_order_release);
+		}
+
+		// Unlink & free the ring if its thread detached.
+		// The head of the list is contended by new rings,
+		// if one was pushed, retry during the next drain.
+		bool retire = detached;
+
+		if (retire && prev != NULL)
+			prev->next = next;
+		else if (retire)
+		{
+			_GFXLogRing* expected = ring;
+			retire = atomic_compare_exchange_strong(&log->rings, &expected, next);
+		}
+
+		if (retire)
+		{
+			_gfx_log_life_release(ring->life);
+			free(ring);
+		}
+		else
+			prev = ring;
+
+		ring = next;
+	}
+}
+
+/****************************
+ * Asynchronous log writer thread entry point.
+ * @param arg The GFXAsyncLog* to drain.
+ */
+static _GFXThreadRet _GFX_THREAD_CALL _gfx_log_async_thread(void* arg)
+{
+	GFXAsyncLog* log = arg;
+
+	// Drain once more after being stopped,
+	// so everything published before is written.
+	while (1)
+	{
+		const bool stop = atomic_load(&log->stop);
+		_gfx_log_async_drain(log);
+
+		if (stop) break;
+		_gfx_thread_sleep(_GFX_LOG_INTERVAL);
+	}
+
+	return 0;
+}
+
+/****************************
+ * Formats a new line into the ring of the calling thread.
+ */
+static void _gfx_log_async(GFXAsyncLog* log, uintmax_t thread,
+                           GFXLogLevel level, double timeMs,
+                           const char* file, unsigned int line,
+                           const char* fmt, va_list args)
+{
+	_GFXLogRing* ring = _gfx_log_async_ring(log);
+	if (ring == NULL)
+	{
+		atomic_fetch_add_explicit(&log->dropped, 1, memory_order_relaxed);
+		return;
+	}
+
+	_GFXLogRecord* rec = _gfx_log_async_claim(log, ring);
+	if (rec == NULL) return;
+
+	// Format straight into the record, reserving space for a newline.
+	const char* L = _gfx_log_levels[level-1];
+	const size_t size = sizeof(rec->text);
+	int len;
+
+#if defined (GFX_UNIX)
+	if (log->color)
+		len = snprintf(rec->text, size,
+			"%.2ems %s%-5s \x1b[90mthread-%"PRIuMAX": %s:%u: \x1b[0m",
+			timeMs, _gfx_log_colors[level-1], L, thread, file, line);
+	else
+#endif
+		len = snprintf(rec->text, size,
+			"%.2ems %-5s thread-%"PRIuMAX": %s:%u: ",
+			timeMs, L, thread, file, line);
+
+	size_t pos = GFX_MIN((size_t)GFX_MAX(len, 0), size - 1);
+	len = vsnprintf(rec->text + pos, size - pos, fmt, args);
+	pos = GFX_MIN(pos + (size_t)GFX_MAX(len, 0), size - 1);
+
+	rec->text[pos] = '\n';
+	rec->len = (uint32_t)(pos + 1);
+
+	_gfx_log_async_publish(ring);
+}
+
 /****************************
  * Logs a new line to a writer stream.
  */
@@ -48,9 +423,7 @@ static void _gfx_log(const GFXWriter* out, uintmax_t thread,
 	const char* L = _gfx_log_levels[level-1];
 
 #if defined (GFX_UNIX)
-	if (
-		(out == GFX_IO_STDOUT && isatty(STDOUT_FILENO)) ||
-		(out == GFX_IO_STDERR && isatty(STDERR_FILENO)))
+	if (_gfx_log_is_tty(out))
 	{
 		// If on unix, logging to stdout/stderr and it is a tty, use color.
 		const char* C = _gfx_log_colors[level-1];
@@ -75,6 +448,51 @@ static void _gfx_log(const GFXWriter* out, uintmax_t thread,
 	gfx_io_write(out, "\n", sizeof(char));
 }
 
+/****************************
+ * Writes a single Chrome trace event of the calling thread.
+ */
+static void _gfx_trace_writer_event(GFXTraceWriter* trace,
+                                    const GFXTraceZone* zone, char phase)
+{
+	// Get the timestamp first, in microseconds.
+	const uint64_t ticks = glfwGetTimerValue() - trace->start;
+	const double ts = (double)ticks * 1000000.0 / (double)trace->freq;
+
+	_GFXThreadState* state = _gfx_get_local();
+	const uintmax_t thread = (state != NULL) ? state->id : 0;
+
+	// Each event is a single write, so asynchronous outputs keep it whole.
+	// Otherwise synchronize with other logging, never tracing the wait.
+	const bool async = (trace->out->write == _gfx_log_async_write);
+	if (!async) _gfx_mutex_lock_raw(&_groufix.thread.ioLock);
+
+	gfx_io_writef(trace->out,
+		"{\"name\":\"%s\",\"cat\":\"groufix\",\"ph\":\"%c\","
+		"\"ts\":%.3f,\"pid\":0,\"tid\":%"PRIuMAX"},\n",
+		zone->name, phase, ts, thread);
+
+	if (!async) _gfx_mutex_unlock(&_groufix.thread.ioLock);
+}
+
+/****************************
+ * GFXTraceWriter implementation of the begin function.
+ */
+static uint64_t _gfx_trace_writer_begin(const GFXTraceZone* zone, void* user)
+{
+	_gfx_trace_writer_event(user, zone, 'B');
+
+	// Remember the zone to name the end event.
+	return (uint64_t)(uintptr_t)zone;
+}
+
+/****************************
+ * GFXTraceWriter implementation of the end function.
+ */
+static void _gfx_trace_writer_end(uint64_t ctx, void* user)
+{
+	_gfx_trace_writer_event(user, (const GFXTraceZone*)(uintptr_t)ctx, 'E');
+}
+
 /****************************/
 GFX_API void gfx_log(GFXLogLevel level, const char* file, unsigned int line,
                      const char* fmt, ...)
@@ -111,13 +529,20 @@ GFX_API void gfx_log(GFXLogLevel level, const char* file, unsigned int line,
 		}
 
 		// Check output stream & log level.
+		// Asynchronous outputs format on this thread, but without locking.
 		if (out != NULL && level <= logLevel)
 		{
 			va_start(args, fmt);
 
-			_gfx_mutex_lock(&_groufix.thread.ioLock);
-			_gfx_log(out, thread, level, timeMs, file, line, fmt, args);
-			_gfx_mutex_unlock(&_groufix.thread.ioLock);
+			if (out->write == _gfx_log_async_write)
+				_gfx_log_async(GFX_IO_OBJ(out, GFXAsyncLog, writer),
+					thread, level, timeMs, file, line, fmt, args);
+			else
+			{
+				_gfx_mutex_lock(&_groufix.thread.ioLock);
+				_gfx_log(out, thread, level, timeMs, file, line, fmt, args);
+				_gfx_mutex_unlock(&_groufix.thread.ioLock);
+			}
 
 			va_end(args);
 		}
@@ -134,6 +559,26 @@ GFX_API void gfx_log(GFXLogLevel level, const char* file, unsigned int line,
 	}
 }
 
+/****************************/
+void _gfx_log_detach(_GFXThreadState* state)
+{
+	assert(state != NULL);
+
+	// Forget all rings, they are owned by their logs.
+	gfx_vec_clear(&state->log.rings);
+
+	// Publish that this thread will never write to its rings again,
+	// all records published before are still drained.
+	_GFXLogLife* life = state->log.life;
+	if (life != NULL)
+	{
+		atomic_store_explicit(&life->alive, 0, memory_order_release);
+		_gfx_log_life_release(life);
+	}
+
+	state->log.life = NULL;
+}
+
 /****************************/
 GFX_API bool gfx_log_set_level(GFXLogLevel level)
 {
@@ -171,3 +616,169 @@ GFX_API bool gfx_log_set(const GFXWriter* out)
 
 	return 1;
 }
+
+/****************************/
+GFX_API void gfx_trace_set(const GFXTracer* tracer)
+{
+	assert(tracer == NULL || tracer->begin != NULL);
+	assert(tracer == NULL || tracer->end != NULL);
+
+	atomic_store_explicit(&_gfx_tracer, tracer, memory_order_release);
+}
+
+/****************************/
+GFX_API GFXTraceCtx gfx_trace_begin_zone(const GFXTraceZone* zone)
+{
+	assert(zone != NULL);
+
+	const GFXTracer* tracer =
+		atomic_load_explicit(&_gfx_tracer, memory_order_acquire);
+
+	return (GFXTraceCtx){
+		.tracer = tracer,
+		.id = (tracer != NULL) ? tracer->begin(zone, tracer->user) : 0
+	};
+}
+
+/****************************/
+GFX_API void gfx_trace_end_zone(GFXTraceCtx ctx)
+{
+	// End with the tracer it began with, even if it was reset since.
+	if (ctx.tracer != NULL)
+		ctx.tracer->end(ctx.id, ctx.tracer->user);
+}
+
+/****************************/
+GFX_API GFXAsyncLog* gfx_create_async_log(const GFXWriter* out, size_t capacity)
+{
+	assert(atomic_load(&_groufix.initialized));
+	assert(out != NULL);
+
+	// Round the capacity up to a power of two, for cheap ring indexing.
+	capacity = (capacity == 0) ? _GFX_LOG_DEFAULT_CAPACITY : capacity;
+
+	size_t pot = 1;
+	while (pot < capacity) pot <<= 1;
+
+	// Allocate a new log.
+	GFXAsyncLog* log = malloc(sizeof(GFXAsyncLog));
+	if (log == NULL) goto error;
+
+	log->writer.write = _gfx_log_async_write;
+	log->out = out;
+	log->id = atomic_fetch_add(&_gfx_log_async_id, 1);
+	log->capacity = pot;
+
+	// Check for a tty once, instead of for every record.
+	log->color = _gfx_log_is_tty(out);
+
+	atomic_init(&log->rings, NULL);
+	atomic_init(&log->dropped, 0);
+	atomic_init(&log->stop, 0);
+
+	// Start the writer thread.
+	if (!_gfx_thread_create(&log->thread, _gfx_log_async_thread, log))
+	{
+		free(log);
+		goto error;
+	}
+
+	return log;
+
+
+	// Error on failure.
+error:
+	gfx_log_error("Could not create a new asynchronous log.");
+	return NULL;
+}
+
+/****************************/
+GFX_API void gfx_destroy_async_log(GFXAsyncLog* log)
+{
+	if (log == NULL)
+		return;
+
+	// Stop & join the writer thread, which drains everything.
+	atomic_store(&log->stop, 1);
+	_gfx_thread_join(log->thread);
+
+	// Free all rings, threads will never match the log's id again.
+	_GFXLogRing* ring = atomic_load(&log->rings);
+	while (ring != NULL)
+	{
+		_GFXLogRing* next = ring->next;
+		_gfx_log_life_release(ring->life);
+		free(ring);
+		ring = next;
+	}
+
+	free(log);
+}
+
+/****************************/
+GFX_API const GFXWriter* gfx_async_log_get_writer(GFXAsyncLog* log)
+{
+	assert(log != NULL);
+
+	return &log->writer;
+}
+
+/****************************/
+GFX_API uint64_t gfx_async_log_get_dropped(GFXAsyncLog* log)
+{
+	assert(log != NULL);
+
+	return (uint64_t)atomic_load_explicit(&log->dropped, memory_order_relaxed);
+}
+
+/****************************/
+GFX_API GFXTraceWriter* gfx_create_trace_writer(const GFXWriter* out)
+{
+	assert(atomic_load(&_groufix.initialized));
+	assert(out != NULL);
+
+	// Allocate a new trace output.
+	GFXTraceWriter* trace = malloc(sizeof(GFXTraceWriter));
+	if (trace == NULL)
+	{
+		gfx_log_error("Could not create a new trace writer.");
+		return NULL;
+	}
+
+	trace->tracer.begin = _gfx_trace_writer_begin;
+	trace->tracer.end = _gfx_trace_writer_end;
+	trace->tracer.user = trace;
+	trace->out = out;
+
+	// Timestamps are relative to creation.
+	trace->freq = glfwGetTimerFrequency();
+	trace->start = glfwGetTimerValue();
+
+	// Open the JSON array.
+	gfx_io_write(out, "[\n", sizeof(char) * 2);
+
+	return trace;
+}
+
+/****************************/
+GFX_API void gfx_destroy_trace_writer(GFXTraceWriter* trace)
+{
+	if (trace == NULL)
+		return;
+
+	// Close the JSON array with a metadata event naming the process,
+	// which conveniently takes care of the trailing comma.
+	gfx_io_writef(trace->out,
+		"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,"
+		"\"args\":{\"name\":\"groufix\"}}\n]\n");
+
+	free(trace);
+}
+
+/****************************/
+GFX_API const GFXTracer* gfx_trace_writer_get_tracer(GFXTraceWriter* trace)
+{
+	assert(trace != NULL);
+
+	return &trace->tracer;
+}
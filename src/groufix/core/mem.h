@@ -10,10 +10,10 @@
 #ifndef _GFX_CORE_MEM_H
 #define _GFX_CORE_MEM_H
 
+#include "groufix/containers/alloc.h"
 #include "groufix/containers/io.h"
 #include "groufix/containers/list.h"
 #include "groufix/containers/map.h"
-#include "groufix/containers/tree.h"
 #include "groufix/containers/vec.h"
 #include "groufix/core.h"
 
@@ -38,11 +38,25 @@ typedef struct _GFXHashKey
  */
 typedef struct _GFXHashBuilder
 {
-	GFXVec out;
+	GFXVec out; // Used once buf is exceeded.
+
+	char*  buf; // Fixed buffer, NULL if not used (anymore).
+	size_t size;
+	size_t capacity;
+
+	// Incremental hash state, whole stripes are hashed while pushing.
+	uint64_t acc[4];
+	size_t   hashed; // #Key bytes hashed into acc.
 
 } _GFXHashBuilder;
 
 
+/**
+ * Number of bytes consumed by each incremental hashing step.
+ */
+#define _GFX_HASH_STRIPE 32
+
+
 /**
  * Returns the total size (including key header) of a hash key in bytes.
  */
@@ -51,13 +65,39 @@ static inline size_t _gfx_hash_size(const _GFXHashKey* key)
 	return sizeof(_GFXHashKey) + sizeof(char) * key->len;
 }
 
+/**
+ * Returns the current length of the key being built by a hash key builder.
+ */
+static inline size_t _gfx_hash_builder_len(const _GFXHashBuilder* b)
+{
+	return (b->buf != NULL ? b->size : b->out.size) - sizeof(_GFXHashKey);
+}
+
+/**
+ * Pushes data on top of a hash key builder using its fixed buffer.
+ * @see _gfx_hash_builder_push.
+ */
+void* _gfx_hash_builder_push_buf(_GFXHashBuilder* b, size_t s, const void* d);
+
+/**
+ * Hashes all whole stripes of a hash key builder that are not hashed yet.
+ */
+void _gfx_hash_builder_stripes(_GFXHashBuilder* b);
+
 /**
  * Pushes data on top of a hash key builder, extending its key.
  * @return A pointer to the pushed data, NULL on failure.
+ *
+ * Previously pushed data is hashed on push, pushed data may only be
+ * written to through the returned pointer until the next push.
  */
 static inline void* _gfx_hash_builder_push(_GFXHashBuilder* b, size_t s, const void* d)
 {
-	return !gfx_vec_push(&b->out, s, d) ? NULL : gfx_vec_at(&b->out, b->out.size - s);
+	if (_gfx_hash_builder_len(b) - b->hashed >= _GFX_HASH_STRIPE)
+		_gfx_hash_builder_stripes(b);
+
+	return b->buf != NULL ? _gfx_hash_builder_push_buf(b, s, d) :
+		!gfx_vec_push(&b->out, s, d) ? NULL : gfx_vec_at(&b->out, b->out.size - s);
 }
 
 /**
@@ -67,10 +107,22 @@ static inline void* _gfx_hash_builder_push(_GFXHashBuilder* b, size_t s, const v
 int _gfx_hash_cmp(const void* l, const void* r);
 
 /**
- * MurmurHash3 (32 bits) implementation as GFXMap hash function,
+ * xxHash (64 bits) implementation as GFXMap hash function,
  * key is of type _GFXHashKey*.
  */
-uint64_t _gfx_hash_murmur3(const void* key);
+uint64_t _gfx_hash_xxh64(const void* key);
+
+/**
+ * xxHash (64 bits) implementation for raw data.
+ * @param bytes Cannot be NULL if len > 0, needs no alignment.
+ */
+uint64_t _gfx_hash_xxh64_bytes(size_t len, const void* bytes);
+
+/**
+ * MurmurHash3 (32 bits) implementation for raw data.
+ * @param bytes Cannot be NULL if len > 0, must be aligned to 4 bytes.
+ */
+uint64_t _gfx_hash_murmur3_bytes(size_t len, const void* bytes);
 
 /**
  * Initializes a hash key builder.
@@ -84,15 +136,63 @@ bool _gfx_hash_builder(_GFXHashBuilder* builder);
  * Claims ownership over the memory allocated by a hash key builder.
  * The hash key builder itself is invalidated.
  * @param builder Cannot be NULL.
- * @return Allocated key data, must call free().
+ * @return Allocated key data, must call gfx_free().
  */
 _GFXHashKey* _gfx_hash_builder_get(_GFXHashBuilder* builder);
 
+/**
+ * Initializes a hash key builder that builds in a fixed buffer first,
+ * only allocating memory if the key does not fit in it.
+ * Needs to eventually be cleared with a call to _gfx_hash_builder_clear()
+ * or _gfx_hash_builder_get().
+ * @param builder  Cannot be NULL.
+ * @param capacity Must be >= sizeof(_GFXHashKey).
+ * @param buf      Cannot be NULL, must be aligned for a _GFXHashKey.
+ */
+void _gfx_hash_builder_buf(_GFXHashBuilder* builder, size_t capacity, void* buf);
+
+/**
+ * Retrieves the key built by a hash key builder, without claiming it.
+ * @param builder Cannot be NULL.
+ * @return Key data, valid until the builder is pushed to or cleared.
+ */
+_GFXHashKey* _gfx_hash_builder_key(_GFXHashBuilder* builder);
+
+/**
+ * Retrieves the hash of the key built by a hash key builder,
+ * only hashes what was not yet hashed while pushing.
+ * @param builder Cannot be NULL.
+ * @return Equal to _gfx_hash_xxh64() of the key.
+ */
+uint64_t _gfx_hash_builder_hash(_GFXHashBuilder* builder);
+
+/**
+ * Clears a hash key builder, freeing any memory it allocated.
+ * @param builder Cannot be NULL.
+ */
+void _gfx_hash_builder_clear(_GFXHashBuilder* builder);
+
 
 /****************************
  * Vulkan memory management.
  ****************************/
 
+/**
+ * Size classes of the free ranges of a memory block.
+ * Every power of two is a first-level class,
+ * each is subdivided into _GFX_MEM_SL linear second-level classes.
+ */
+#define _GFX_MEM_SL_LOG 4
+#define _GFX_MEM_SL (1u << _GFX_MEM_SL_LOG)
+#define _GFX_MEM_FL (64 - _GFX_MEM_SL_LOG + 1)
+
+
+/**
+ * Free memory node declaration.
+ */
+typedef struct _GFXMemFree _GFXMemFree;
+
+
 /**
  * Memory block (i.e. Vulkan memory object to be subdivided).
  */
@@ -100,14 +200,20 @@ typedef struct _GFXMemBlock
 {
 	GFXListNode  list; // Base-type.
 	uint32_t     type; // Vulkan memory type index.
+	uint32_t     heap; // Vulkan memory heap index.
 	VkDeviceSize size;
+	VkDeviceSize used; // Claimed by allocations, excluding waste.
+	bool         single;  // Allocated for a single allocation, freed when empty.
+	bool         retired; // In the retired list, empty, awaiting a trim.
 
 
 	// Related memory nodes.
 	struct
 	{
-		GFXTree free; // Stores { VkDeviceSize, VkDeviceSize } : _GFXMemNode.
-		GFXList list; // References _GFXMemNode | _GFXMemAlloc.
+		uint64_t     fl;               // First-level bitmap, zero if full.
+		uint32_t     sl[_GFX_MEM_FL]; // Second-level bitmaps.
+		_GFXMemFree* free[_GFX_MEM_FL][_GFX_MEM_SL]; // Segregated free lists.
+		GFXList      list; // References _GFXMemFree | _GFXMemAlloc.
 
 	} nodes;
 
@@ -139,18 +245,39 @@ typedef struct _GFXMemNode
 {
 	GFXListNode list; // Base-type.
 
-	bool free; // isa _GFXMemAlloc if zero, isa search tree node if non-zero.
+	bool free; // isa _GFXMemAlloc if zero, isa _GFXMemFree if non-zero.
 
 } _GFXMemNode;
 
 
+/**
+ * Free memory node, linked in the size class of its size.
+ */
+struct _GFXMemFree
+{
+	_GFXMemNode  node; // Base-type.
+	_GFXMemFree* prev; // Within its size class.
+	_GFXMemFree* next;
+
+	VkDeviceSize size;
+	VkDeviceSize offset;
+};
+
+
+/**
+ * Sub-allocation slab declaration.
+ */
+typedef struct _GFXMemSlab _GFXMemSlab;
+
+
 /**
  * Allocated memory node (contains everything necessary for use).
  */
 typedef struct _GFXMemAlloc
 {
-	_GFXMemNode   node; // Base-type.
+	_GFXMemNode   node; // Base-type, not linked if sub-allocated from a slab.
 	_GFXMemBlock* block;
+	_GFXMemSlab*  slab; // NULL if not sub-allocated from a slab.
 
 	VkDeviceSize  size;
 	VkDeviceSize  offset;
@@ -179,11 +306,45 @@ typedef struct _GFXAllocator
 	_GFXDevice*  device; // For memory property queries.
 	_GFXContext* context;
 
-	GFXList free; // References _GFXMemBlock.
-	GFXList full; // References _GFXMemBlock.
+	GFXList free;    // References _GFXMemBlock.
+	GFXList full;    // References _GFXMemBlock.
+	GFXList retired; // References _GFXMemBlock, only if release > 0.
 
 	// Constant, queried once.
 	VkDeviceSize granularity;
+	VkDeviceSize atomSize; // For non-coherent memory.
+
+	// Preferred size of the next memory block, for each memory type.
+	// Grows geometrically on demand, shrinks when empty blocks are trimmed.
+	VkDeviceSize blockSizes[VK_MAX_MEMORY_TYPES]; // 0 if not yet known.
+	uint32_t     keep;    // Number of empty blocks to keep per memory type.
+	uint32_t     release; // Max #blocks freed per trim, 0 for no limit.
+
+
+	// Memory heap budgets (refreshed when allocating new blocks).
+	uint32_t numHeaps;
+
+	struct
+	{
+		VkDeviceSize size;
+		VkDeviceSize budget;    // Estimated budget of the entire process.
+		VkDeviceSize usage;     // Estimated usage of the entire process.
+		VkDeviceSize allocated; // Allocated by this allocator.
+
+	} heaps[VK_MAX_MEMORY_HEAPS];
+
+
+	// Statistics, atomic so they can be read without locking.
+	struct
+	{
+		atomic_uint_fast64_t blocks[VK_MAX_MEMORY_TYPES];
+		atomic_uint_fast64_t allocated; // Bytes in memory blocks.
+		atomic_uint_fast64_t used;      // Bytes claimed by allocations.
+		atomic_uint_fast64_t allocs;    // Live allocations (a slab is one).
+		atomic_uint_fast64_t cells;     // Live slab sub-allocations.
+		atomic_uint_fast64_t fallbacks; // Allocations not of the optimal type.
+
+	} stats;
 
 } _GFXAllocator;
 
@@ -204,6 +365,34 @@ void _gfx_allocator_init(_GFXAllocator* alloc, _GFXDevice* device);
  */
 void _gfx_allocator_clear(_GFXAllocator* alloc);
 
+/**
+ * Frees empty memory blocks of an allocator,
+ * only keeping alloc->keep empty blocks for each memory type.
+ * Frees retired blocks first, at most alloc->release blocks in total.
+ * @param alloc Cannot be NULL.
+ *
+ * Not thread-safe at all.
+ */
+void _gfx_allocator_trim(_GFXAllocator* alloc);
+
+/**
+ * Refreshes the budget and usage of all memory heaps of an allocator.
+ * @param alloc Cannot be NULL.
+ *
+ * Not thread-safe at all.
+ * If VK_EXT_memory_budget is not supported, the budget is estimated from the
+ * heap size and usage is estimated from memory allocated by this allocator.
+ */
+void _gfx_allocator_budget(_GFXAllocator* alloc);
+
+/**
+ * Retrieves the size of the largest free range of an allocator.
+ * @param alloc Cannot be NULL.
+ *
+ * Not thread-safe at all.
+ */
+VkDeviceSize _gfx_allocator_largest(_GFXAllocator* alloc);
+
 /**
  * Allocate some Vulkan memory.
  * The object pointed to by mem cannot be moved or copied!
@@ -234,10 +423,37 @@ bool _gfx_allocd(_GFXAllocator* alloc, _GFXMemAlloc* mem,
                  VkMemoryRequirements reqs,
                  VkBuffer buffer, VkImage image);
 
+/**
+ * Allocate some Vulkan memory to move an existing allocation to.
+ * The object pointed to by mem cannot be moved or copied!
+ * @param alloc Cannot be NULL.
+ * @param mem   Cannot be NULL.
+ * @param src   Allocation to move, cannot be NULL, must be allocated from alloc.
+ * @param reqs  Must be valid (size > 0, align = a power of two, bits != 0).
+ * @return Non-zero on success.
+ *
+ * Not thread-safe at all.
+ * Never allocates a new memory block, only succeeds if memory of the same
+ * type can be claimed from a block that is more densely used than src's.
+ * The memory of src is _NOT_ copied nor freed!
+ */
+bool _gfx_alloc_defrag(_GFXAllocator* alloc, _GFXMemAlloc* mem,
+                       const _GFXMemAlloc* src, VkMemoryRequirements reqs);
+
+/**
+ * Moves an allocation object to another address, i.e. relocates it.
+ * @param dst Cannot be NULL, must not be in use.
+ * @param src Cannot be NULL, must be allocated.
+ *
+ * Not thread-safe at all.
+ * The content of src is invalidated after this call, dst takes its place.
+ */
+void _gfx_relocate(_GFXMemAlloc* dst, _GFXMemAlloc* src);
+
 /**
  * Free some Vulkan memory.
  * @param alloc Cannot be NULL.
- * @param mem   Cannot be NULL, must be allocated from alloc.
+ * @param mem   Cannot be NULL, must be allocated from alloc, not from a slab.
  *
  * Not thread-safe at all.
  * The content of mem is invalidated after this call.
@@ -257,6 +473,25 @@ void _gfx_free(_GFXAllocator* alloc, _GFXMemAlloc* mem);
  */
 void* _gfx_map(_GFXAllocator* alloc, _GFXMemAlloc* mem);
 
+/**
+ * Invalidates mapped Vulkan memory, making device writes visible to the host.
+ * No-op if the memory is host coherent.
+ * @param alloc Cannot be NULL.
+ * @param mem   Cannot be NULL, must be allocated from alloc and mapped.
+ *
+ * This function is reentrant!
+ * Non-coherent memory should be aligned to alloc->atomSize, as the
+ * invalidated range is rounded to it.
+ */
+void _gfx_mem_invalidate(_GFXAllocator* alloc, _GFXMemAlloc* mem);
+
+/**
+ * Flushes mapped Vulkan memory, making host writes visible to the device.
+ * No-op if the memory is host coherent.
+ * @see _gfx_mem_invalidate.
+ */
+void _gfx_mem_flush(_GFXAllocator* alloc, _GFXMemAlloc* mem);
+
 /**
  * Unmaps Vulkan memory, invalidating a mapped pointer.
  * Must be called exactly once for every successful call to _gfx_map.
@@ -268,10 +503,90 @@ void* _gfx_map(_GFXAllocator* alloc, _GFXMemAlloc* mem);
 void _gfx_unmap(_GFXAllocator* alloc, _GFXMemAlloc* mem);
 
 
+/**
+ * Sub-allocation cache (i.e. the slabs of a thread).
+ */
+typedef struct _GFXSlabCache
+{
+	GFXListNode    list; // Base-type.
+	_GFXAllocator* alloc;
+	_GFXMutex*     allocLock; // Locked whenever alloc is used.
+	_GFXMutex      lock;
+
+	GFXList slabs; // References _GFXMemSlab.
+
+} _GFXSlabCache;
+
+
+/**
+ * Sub-allocation slab (i.e. equally sized cells claimed from the allocator).
+ */
+struct _GFXMemSlab
+{
+	GFXListNode    list;  // Base-type.
+	_GFXMemAlloc   alloc; // Claimed from the allocator.
+	_GFXSlabCache* cache;
+
+	// Allocation input & size class.
+	VkMemoryPropertyFlags required;
+	VkMemoryPropertyFlags optimal;
+	bool                  linear;
+	VkDeviceSize          cell;
+
+	uint64_t free; // Bit set for each free cell.
+};
+
+
+/**
+ * Initializes a sub-allocation cache.
+ * @param cache     Cannot be NULL.
+ * @param alloc     Cannot be NULL.
+ * @param allocLock Cannot be NULL, must be locked to use alloc.
+ * @return Non-zero on success.
+ */
+bool _gfx_slab_cache_init(_GFXSlabCache* cache,
+                          _GFXAllocator* alloc, _GFXMutex* allocLock);
+
+/**
+ * Clears a sub-allocation cache, giving all slabs back to the allocator.
+ * @param cache Cannot be NULL.
+ *
+ * All sub-allocations of the cache must be freed (or be lost)!
+ */
+void _gfx_slab_cache_clear(_GFXSlabCache* cache);
+
+/**
+ * Sub-allocates some Vulkan memory from a slab of a cache.
+ * Only locks the allocator when the cache needs a new slab.
+ * @see _gfx_alloc.
+ * @param cache Cannot be NULL.
+ * @return Non-zero on success, zero if too large or out of memory.
+ *
+ * Thread-safe with respect to the cache and its allocator!
+ * Should fallback to _gfx_alloc on failure.
+ */
+bool _gfx_slab_alloc(_GFXSlabCache* cache, _GFXMemAlloc* mem, bool linear,
+                     VkMemoryPropertyFlags required, VkMemoryPropertyFlags optimal,
+                     VkMemoryRequirements reqs);
+
+/**
+ * Frees some Vulkan memory sub-allocated from a slab.
+ * @param mem Cannot be NULL, mem->slab cannot be NULL.
+ *
+ * Thread-safe with respect to the cache and its allocator!
+ * The content of mem is invalidated after this call.
+ */
+void _gfx_slab_free(_GFXMemAlloc* mem);
+
+
 /****************************
  * Vulkan object cache.
  ****************************/
 
+// Number of (core) Vulkan descriptor types, which are enumerated [0,11).
+#define _GFX_NUM_DESCRIPTOR_TYPES 11
+
+
 /**
  * Cached element (i.e. cachable Vulkan object).
  */
@@ -280,6 +595,9 @@ typedef struct _GFXCacheElem
 	// Input structure type.
 	VkStructureType type;
 
+	// #descriptors of each type, only for descriptor set layouts.
+	uint32_t descriptors[_GFX_NUM_DESCRIPTOR_TYPES];
+
 
 	// Vulkan fields.
 	struct
@@ -314,7 +632,12 @@ typedef struct _GFXCache
 	_GFXMutex lookupLock;
 	_GFXMutex createLock;
 
+	// Lock-free lookup tables into simple and mutable.
+	atomic_uintptr_t simpleTable;
+	atomic_uintptr_t mutableTable;
+
 	size_t templateStride;
+	size_t stored; // Vulkan cache data size when last loaded or stored.
 
 
 	// Vulkan fields.
@@ -366,6 +689,7 @@ bool _gfx_cache_flush(_GFXCache* cache);
  *
  * This function is reentrant,
  * However, cannot run concurrently with other calls.
+ * Retrieving an existing element does not lock nor allocate any memory.
  *
  * Except when anything other than a Vk*PipelineCreateInfo struct is given,
  * then it can run concurrently with _gfx_cache_flush and _gfx_cache_warmup.
@@ -391,6 +715,10 @@ bool _gfx_cache_flush(_GFXCache* cache);
  *   1 for the pipeline layout.
  *   1 for the compatible render pass (compatibility is not resolved!).
  *
+ *   If its pNext chain contains VkPipelineLibraryCreateInfoKHR, the
+ *   pipeline is linked from the given libraries instead, but is cached
+ *   under the same key as if it were not (i.e. all state must be given).
+ *
  *  VkComputePipelineCreateInfo:
  *   1 for the shader module.
  *   1 for the pipeline layout.
@@ -399,6 +727,22 @@ _GFXCacheElem* _gfx_cache_get(_GFXCache* cache,
                               const VkStructureType* createInfo,
                               const void** handles);
 
+/**
+ * Retrieves a pipeline from the cache, without creating it if not present.
+ * Input is a Vk*PipelineCreateInfo struct with replace handles.
+ * @param cache      Cannot be NULL.
+ * @param createInfo A pointer to a Vk*PipelineCreateInfo struct, cannot be NULL.
+ * @param handles    Must match the non-hashable field count of createInfo.
+ * @return NULL if not present (or on failure).
+ *
+ * This function is reentrant and can run concurrently with _gfx_cache_get.
+ * However, cannot run concurrently with any other calls.
+ * @see _gfx_cache_get for the handles that must be passed.
+ */
+_GFXCacheElem* _gfx_cache_lookup(_GFXCache* cache,
+                                 const VkStructureType* createInfo,
+                                 const void** handles);
+
 /**
  * Warms up the immutable cache (i.e. inserts a pipeline in it). Input is a
  * Vk*PipelineCreateInfo struct with replace handles for non-hashable fields.
@@ -423,6 +767,8 @@ bool _gfx_cache_warmup(_GFXCache* cache,
  * @return Non-zero on success.
  *
  * Not thread-safe at all.
+ * If src provides direct access to its data, nothing is copied.
+ * Data is validated against the format version, device and driver.
  */
 bool _gfx_cache_load(_GFXCache* cache, const GFXReader* src);
 
@@ -436,6 +782,18 @@ bool _gfx_cache_load(_GFXCache* cache, const GFXReader* src);
  */
 bool _gfx_cache_store(_GFXCache* cache, const GFXWriter* dst);
 
+/**
+ * Saves the current groufix pipeline cache data to a file, only if it
+ * changed since it was last loaded or stored.
+ * @param cache Cannot be NULL.
+ * @param path  File to overwrite, cannot be NULL.
+ * @return Non-zero on success (including when nothing was written).
+ *
+ * Not thread-safe at all.
+ * Writes to a temporary file first, which is then moved over path.
+ */
+bool _gfx_cache_save(_GFXCache* cache, const char* path);
+
 
 /****************************
  * Vulkan descriptor management.
@@ -449,10 +807,20 @@ typedef struct _GFXPoolBlock
 	GFXListNode list;  // Base-type, undefined if claimed by subordinate.
 	GFXList     elems; // References _GFXPoolElem.
 	bool        full;
+	bool        drain; // Sets are not recycled anymore, implies full.
+
+	// #consecutive flushes the block was under-used.
+	unsigned int idle;
 
 	// #in-use descriptor sets (i.e. not-recycled).
 	atomic_uint_fast32_t sets;
 
+	// Only accessed by the pool or claiming subordinate.
+	uint32_t maxSets;   // #sets the Vulkan pool can hold.
+	uint32_t allocated; // #sets allocated from the Vulkan pool.
+	uint32_t types;     // Bitmask of descriptor types it holds.
+	uint32_t exhausted; // Bitmask of descriptor types it ran out of.
+
 
 	// Vulkan fields.
 	struct
@@ -495,6 +863,14 @@ typedef struct _GFXPoolSub
 	GFXMap         mutable; // Stores _GFXHashKey : _GFXPoolElem.
 	_GFXPoolBlock* block;   // Currently claimed for new allocations.
 
+	// Descriptor demand since last flush (i.e. newly allocated sets).
+	struct
+	{
+		uint64_t sets;
+		uint64_t descriptors[_GFX_NUM_DESCRIPTOR_TYPES];
+
+	} demand;
+
 } _GFXPoolSub;
 
 
@@ -517,6 +893,24 @@ typedef struct _GFXPool
 	_GFXMutex recLock; // For recycling.
 
 	unsigned int flushes;
+	size_t       maxRecycled; // Zero for no limit.
+
+
+	// Descriptor block sizing, updated on flush.
+	struct
+	{
+		uint64_t sets; // Demand of unsubbed subordinates since last flush.
+		uint64_t descriptors[_GFX_NUM_DESCRIPTOR_TYPES];
+
+		bool  observed; // Zero if avg is not yet initialized.
+		float avg[_GFX_NUM_DESCRIPTOR_TYPES]; // Per set, moving average.
+
+		uint32_t maxSets;
+		uint32_t sizes[_GFX_NUM_DESCRIPTOR_TYPES]; // For new blocks.
+
+	} demand;
+
+	atomic_size_t blocks; // #allocated blocks.
 
 } _GFXPool;
 
@@ -525,13 +919,15 @@ typedef struct _GFXPool
  * Initializes a pool.
  * @param pool    Cannot be NULL.
  * @param device  Cannot be NULL.
- * @param flushes Number of flushes after which a descriptor set is recycled.
+ * @param flushes     Number of flushes after which a descriptor set is recycled.
+ * @param maxRecycled Maximum #recycled descriptor sets to keep, 0 for no limit.
  * @return Non-zero on success.
  *
  * _gfx_device_init_context must have returned successfully at least once
  * for the given device.
  */
-bool _gfx_pool_init(_GFXPool* pool, _GFXDevice* device, unsigned int flushes);
+bool _gfx_pool_init(_GFXPool* pool, _GFXDevice* device,
+                    unsigned int flushes, size_t maxRecycled);
 
 /**
  * Clears a pool, also clearing all subordinates.
@@ -543,6 +939,8 @@ void _gfx_pool_clear(_GFXPool* pool);
  * Flushes all subordinate descriptor caches to the immutable pool cache,
  * making them visible to all other subordinates.
  * Then recycles descriptor sets that were last retrieved #flushes ago.
+ * Also re-evaluates the size of new blocks from the observed demand,
+ * drains blocks that stay under-used and trims the recycled sets.
  * @param pool Cannot be NULL.
  * @return Non-zero on success, can be partially flushed on failure.
  *
@@ -593,6 +991,15 @@ void _gfx_pool_unsub(_GFXPool* pool, _GFXPoolSub* sub);
 void _gfx_pool_recycle(_GFXPool* pool,
                        const _GFXHashKey* key, unsigned int flushes);
 
+/**
+ * Forces recycling of all Vulkan descriptor sets, without waiting for them
+ * to be unused like _gfx_pool_reset does.
+ * @param pool    Cannot be NULL.
+ * @param flushes Number of flushes after which the descriptor sets are recycled.
+ * @see _gfx_pool_recycle.
+ */
+void _gfx_pool_recycle_all(_GFXPool* pool, unsigned int flushes);
+
 /**
  * Retrieves, allocates or recycles a Vulkan descriptor set from the pool.
  * @param pool      Cannot be NULL.
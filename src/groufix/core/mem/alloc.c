@@ -18,20 +18,24 @@
 // Preferred memory block size of a 'large' heap (256 MiB).
 #define _GFX_DEF_LARGE_HEAP_BLOCK_SIZE (256ull * 1024 * 1024)
 
+// Initial preferred memory block size of a memory type (16 MiB).
+// Block sizes grow geometrically up to the preferred size of the heap.
+#define _GFX_MIN_BLOCK_SIZE (16ull * 1024 * 1024)
 
-// Get the size and offset of a key (as an lvalue) +
-// Get the strictest alignment (i.e. the least significant bit) of a key,
-// returns all 1's on no alignment, this so it always compares as stricter.
+// Default number of empty memory blocks to keep for each memory type.
+#define _GFX_DEF_KEEP_BLOCKS 1
+
+// Estimated budget of a heap if VK_EXT_memory_budget is not supported (80%).
+#define _GFX_DEF_HEAP_BUDGET(size) ((size) / 5 * 4)
+
+
+// Get the size and offset of a key (as an lvalue).
 #define _GFX_KEY_SIZE(key) \
 	((VkDeviceSize*)(key))[0]
 
 #define _GFX_KEY_OFFSET(key) \
 	((VkDeviceSize*)(key))[1]
 
-#define _GFX_KEY_ALIGN(key) \
-	(_GFX_KEY_OFFSET(key) == 0 ? ~((VkDeviceSize)0) : \
-	_GFX_KEY_OFFSET(key) & (~_GFX_KEY_OFFSET(key) + 1))
-
 
 // Get Vulkan memory property flag bits as a readable string.
 #define _GFX_GET_VK_TYPE_FLAG_STRING(pdmp, type, flag) \
@@ -62,10 +66,11 @@
 
 
 // Gets suitable memory types (auto log when none found) assigned to two lvalue.
-#define _GFX_GET_MEM_TYPES(lreq, lopt, pdmp, required, optimal, types, action) \
+#define _GFX_GET_MEM_TYPES(lreq, lopt, alloc, pdmp, required, optimal, types, action) \
 	do { \
-		lreq = _gfx_get_mem_type(pdmp, required, types); \
-		lopt = _gfx_get_mem_type(pdmp, optimal, types); \
+		const bool _group = (alloc)->context->numDevices > 1; \
+		lreq = _gfx_get_mem_type(pdmp, required, types, _group); \
+		lopt = _gfx_get_mem_type(pdmp, optimal, types, _group); \
 		if (lreq == UINT32_MAX && lopt == UINT32_MAX) { \
 			gfx_log_error( \
 				"Could not find suitable Vulkan memory type for allocation."); \
@@ -75,30 +80,217 @@
 
 
 /****************************
- * Search tree key comparison function, l and r are of type VkDeviceSize[2].
- * First element is the size, second is the offset.
- * Orders on size first, then strictest alignment (i.e. LSB of offset).
+ * Index of the least/most significant set bit, mask cannot be zero.
+ */
+static inline uint32_t _gfx_tlsf_lsb(uint64_t mask)
+{
+	assert(mask != 0);
+
+#if defined (__GNUC__) || defined (__clang__)
+	return (uint32_t)__builtin_ctzll(mask);
+#else
+	uint32_t i = 0;
+	while (!(mask & 1)) mask >>= 1, ++i;
+	return i;
+#endif
+}
+
+static inline uint32_t _gfx_tlsf_msb(uint64_t mask)
+{
+	assert(mask != 0);
+
+#if defined (__GNUC__) || defined (__clang__)
+	return 63 - (uint32_t)__builtin_clzll(mask);
+#else
+	uint32_t i = 0;
+	while (mask >>= 1) ++i;
+	return i;
+#endif
+}
+
+/****************************
+ * Computes the size class a free range of a given size is linked in.
+ * All ranges in a class are at least the size of its lower bound.
+ */
+static inline void _gfx_tlsf_class(VkDeviceSize size,
+                                   uint32_t* fl, uint32_t* sl)
+{
+	if (size < _GFX_MEM_SL)
+		*fl = 0,
+		*sl = (uint32_t)size;
+	else
+	{
+		const uint32_t msb = _gfx_tlsf_msb(size);
+		*fl = msb - _GFX_MEM_SL_LOG + 1;
+		*sl = (uint32_t)(size >> (msb - _GFX_MEM_SL_LOG)) - _GFX_MEM_SL;
+	}
+}
+
+/****************************
+ * Finds the first non-empty size class at or above { fl, sl }.
+ * @return NULL if none found, otherwise the head of the found class.
+ *
+ * Outputs the found size class to fl and sl.
+ */
+static inline _GFXMemFree* _gfx_tlsf_find(_GFXMemBlock* block,
+                                          uint32_t* fl, uint32_t* sl)
+{
+	if (*fl >= _GFX_MEM_FL)
+		return NULL;
+
+	// Search the second-level classes of the same first-level class.
+	uint64_t slMask = *sl >= _GFX_MEM_SL ? 0 :
+		block->nodes.sl[*fl] & (~(uint64_t)0 << *sl);
+
+	if (slMask == 0)
+	{
+		// Then search the larger first-level classes.
+		const uint64_t flMask = *fl + 1 >= 64 ? 0 :
+			block->nodes.fl & (~(uint64_t)0 << (*fl + 1));
+
+		if (flMask == 0)
+			return NULL;
+
+		*fl = _gfx_tlsf_lsb(flMask);
+		slMask = block->nodes.sl[*fl];
+	}
+
+	*sl = _gfx_tlsf_lsb(slMask);
+	return block->nodes.free[*fl][*sl];
+}
+
+/****************************
+ * Links a free node into the size class of its size.
+ */
+static void _gfx_tlsf_insert(_GFXMemBlock* block, _GFXMemFree* node)
+{
+	uint32_t fl, sl;
+	_gfx_tlsf_class(node->size, &fl, &sl);
+
+	_GFXMemFree* head = block->nodes.free[fl][sl];
+	node->prev = NULL;
+	node->next = head;
+
+	if (head != NULL) head->prev = node;
+	block->nodes.free[fl][sl] = node;
+
+	block->nodes.fl |= (uint64_t)1 << fl;
+	block->nodes.sl[fl] |= (uint32_t)1 << sl;
+}
+
+/****************************
+ * Unlinks a free node from its size class.
+ */
+static void _gfx_tlsf_erase(_GFXMemBlock* block, _GFXMemFree* node)
+{
+	uint32_t fl, sl;
+	_gfx_tlsf_class(node->size, &fl, &sl);
+
+	if (node->next != NULL) node->next->prev = node->prev;
+	if (node->prev != NULL) node->prev->next = node->next;
+	else block->nodes.free[fl][sl] = node->next;
+
+	// Clear the bits of emptied classes.
+	if (block->nodes.free[fl][sl] == NULL)
+	{
+		block->nodes.sl[fl] &= ~((uint32_t)1 << sl);
+		if (block->nodes.sl[fl] == 0)
+			block->nodes.fl &= ~((uint64_t)1 << fl);
+	}
+}
+
+/****************************
+ * Changes the range of a free node, relinking it if its size class changed.
+ */
+static void _gfx_tlsf_update(_GFXMemBlock* block, _GFXMemFree* node,
+                             VkDeviceSize size, VkDeviceSize offset)
+{
+	uint32_t fl, sl, nfl, nsl;
+	_gfx_tlsf_class(node->size, &fl, &sl);
+	_gfx_tlsf_class(size, &nfl, &nsl);
+
+	node->offset = offset;
+
+	if (fl == nfl && sl == nsl)
+		node->size = size;
+	else
+	{
+		_gfx_tlsf_erase(block, node);
+		node->size = size;
+		_gfx_tlsf_insert(block, node);
+	}
+}
+
+/****************************
+ * Allocates a new free node and links it into its size class.
+ * @return NULL on failure.
+ *
+ * The node is not linked into the list of nodes yet.
+ */
+static _GFXMemFree* _gfx_tlsf_alloc(_GFXMemBlock* block,
+                                    VkDeviceSize size, VkDeviceSize offset)
+{
+	_GFXMemFree* node = malloc(sizeof(_GFXMemFree));
+	if (node == NULL) return NULL;
+
+	node->node.free = 1;
+	node->size = size;
+	node->offset = offset;
+	_gfx_tlsf_insert(block, node);
+
+	return node;
+}
+
+/****************************
+ * Initializes the free ranges of a memory block, without any free nodes.
+ */
+static void _gfx_tlsf_init(_GFXMemBlock* block)
+{
+	block->nodes.fl = 0;
+
+	for (uint32_t f = 0; f < _GFX_MEM_FL; ++f)
+	{
+		block->nodes.sl[f] = 0;
+
+		for (uint32_t s = 0; s < _GFX_MEM_SL; ++s)
+			block->nodes.free[f][s] = NULL;
+	}
+
+	gfx_list_init(&block->nodes.list);
+}
+
+/****************************
+ * Frees all free nodes of a memory block, allocations are left untouched.
  */
-static int _gfx_allocator_cmp(const void* l, const void* r)
+static void _gfx_tlsf_clear(_GFXMemBlock* block)
 {
-	const VkDeviceSize* kL = l;
-	const VkDeviceSize* kR = r;
+	_GFXMemNode* next = (_GFXMemNode*)block->nodes.list.head;
 
-	return
-		(_GFX_KEY_SIZE(kL) < _GFX_KEY_SIZE(kR)) ? -1 :
-		(_GFX_KEY_SIZE(kL) > _GFX_KEY_SIZE(kR)) ?  1 :
-		(_GFX_KEY_ALIGN(kL) < _GFX_KEY_ALIGN(kR)) ? -1 :
-		(_GFX_KEY_ALIGN(kL) > _GFX_KEY_ALIGN(kR)) ?  1 : 0;
+	while (next != NULL)
+	{
+		_GFXMemNode* node = next;
+		next = (_GFXMemNode*)node->list.next;
+
+		if (node->free) free(node);
+	}
+
+	gfx_list_clear(&block->nodes.list);
+	block->nodes.fl = 0;
 }
 
 /****************************
  * Find a memory type that includes all the given memory property flags.
  * @param pdmp  Cannot be NULL.
  * @param types Supported (i.e. required) memory type bits to choose from.
+ * @param group Whether the memory is allocated for a device group.
  * @return UINT32_MAX if none found.
+ *
+ * Memory of a multi-instance heap is replicated on every device of a group,
+ * which cannot be mapped, so host visible types of those heaps are skipped.
  */
 static uint32_t _gfx_get_mem_type(const VkPhysicalDeviceMemoryProperties* pdmp,
-                                  VkMemoryPropertyFlags flags, uint32_t types)
+                                  VkMemoryPropertyFlags flags, uint32_t types,
+                                  bool group)
 {
 	assert(pdmp != NULL);
 	assert(types != 0);
@@ -115,12 +307,44 @@ static uint32_t _gfx_get_mem_type(const VkPhysicalDeviceMemoryProperties* pdmp,
 		if ((pdmp->memoryTypes[t].propertyFlags & flags) != flags)
 			continue;
 
+		// Cannot be mapped within a group.
+		if (
+			group &&
+			(flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) &&
+			(pdmp->memoryHeaps[pdmp->memoryTypes[t].heapIndex].flags &
+				VK_MEMORY_HEAP_MULTI_INSTANCE_BIT))
+		{
+			continue;
+		}
+
 		return t;
 	}
 
 	return UINT32_MAX;
 }
 
+/****************************
+ * Gets the remaining budget of a memory heap, in bytes.
+ * Assumes the budget of the allocator was recently refreshed.
+ */
+static inline VkDeviceSize _gfx_allocator_remaining(const _GFXAllocator* alloc,
+                                                    uint32_t heap)
+{
+	return alloc->heaps[heap].usage >= alloc->heaps[heap].budget ? 0 :
+		alloc->heaps[heap].budget - alloc->heaps[heap].usage;
+}
+
+/****************************
+ * Checks whether the heap of a memory type has budget left for an allocation.
+ * Assumes the budget of the allocator was recently refreshed.
+ */
+static inline bool _gfx_allocator_has_budget(const _GFXAllocator* alloc,
+                                             const VkPhysicalDeviceMemoryProperties* pdmp,
+                                             uint32_t type, VkDeviceSize size)
+{
+	return _gfx_allocator_remaining(alloc, pdmp->memoryTypes[type].heapIndex) >= size;
+}
+
 /****************************
  * Allocates and initializes a new Vulkan memory 'block' to be subdivided.
  * @param minSize Use to force a minimum allocation (beyond default block sizes).
@@ -133,6 +357,9 @@ static uint32_t _gfx_get_mem_type(const VkPhysicalDeviceMemoryProperties* pdmp,
  *
  * To allocate Vulkan 'dedicated' memory, a buffer _OR_ image can be passed,
  * these will be passed to Vulkan if and only if minSize == maxSIze.
+ *
+ * The budget of the allocator should be recently refreshed, the preferred
+ * block size is never larger than the remaining budget of the heap.
  */
 static _GFXMemBlock* _gfx_alloc_mem_block(_GFXAllocator* alloc,
                                           const VkPhysicalDeviceMemoryProperties* pdmp,
@@ -172,8 +399,8 @@ static _GFXMemBlock* _gfx_alloc_mem_block(_GFXAllocator* alloc,
 	_gfx_mutex_unlock(&context->limits.allocLock);
 
 	// Validate that we have enough memory.
-	const VkDeviceSize heapSize =
-		pdmp->memoryHeaps[pdmp->memoryTypes[type].heapIndex].size;
+	const uint32_t heap = pdmp->memoryTypes[type].heapIndex;
+	const VkDeviceSize heapSize = pdmp->memoryHeaps[heap].size;
 
 	if (minSize > heapSize)
 	{
@@ -186,14 +413,30 @@ static _GFXMemBlock* _gfx_alloc_mem_block(_GFXAllocator* alloc,
 	}
 
 	// Calculate block size in Vulkan units.
-	// If it is a 'small' heap, we allocate the heap's size divided by 8.
-	const VkDeviceSize prefBlockSize =
+	// Block sizes start small and grow with every new block of the same
+	// memory type, up to the maximum preferred size of the heap.
+	// If it is a 'small' heap, this is the heap's size divided by 8.
+	const VkDeviceSize maxBlockSize =
 		(heapSize <= _GFX_MAX_SMALL_HEAP_SIZE) ?
 		heapSize / 8 :
 		_GFX_DEF_LARGE_HEAP_BLOCK_SIZE;
 
+	if (alloc->blockSizes[type] == 0)
+		alloc->blockSizes[type] = _GFX_MIN_BLOCK_SIZE;
+
+	const VkDeviceSize prefBlockSize =
+		GFX_MIN(alloc->blockSizes[type], maxBlockSize);
+
+	// Do not exceed the remaining budget, unless we must for minSize.
+	const VkDeviceSize remaining = _gfx_allocator_remaining(alloc, heap);
+
+	if (minSize > remaining) gfx_log_warn(
+		"Allocating %"PRIu64" bytes exceeds the memory heap budget, "
+		"%"PRIu64" out of %"PRIu64" bytes remaining.",
+		minSize, remaining, alloc->heaps[heap].budget);
+
 	VkDeviceSize blockSize =
-		GFX_CLAMP(prefBlockSize, minSize, maxSize);
+		GFX_CLAMP(GFX_MIN(prefBlockSize, remaining), minSize, maxSize);
 
 	// Check whether we want to allocate Vulkan dedicated memory.
 	const bool dedicated =
@@ -252,16 +495,18 @@ static _GFXMemBlock* _gfx_alloc_mem_block(_GFXAllocator* alloc,
 	}
 
 	// At this point we have memory!
-	// Initialize the block and the list of nodes & free tree.
-	const VkDeviceSize key[2] = { blockSize, 0 };
+	// Initialize the block and the list of nodes & free ranges.
 	block->type = type;
+	block->heap = heap;
 	block->size = blockSize;
+	block->used = 0;
+	block->single = (minSize == maxSize);
+	block->retired = 0;
 
 	block->map.refs = 0;
 	block->map.ptr = NULL;
 
-	gfx_list_init(&block->nodes.list);
-	gfx_tree_init(&block->nodes.free, sizeof(key), _gfx_allocator_cmp);
+	_gfx_tlsf_init(block);
 
 	// If an exact size, link the block into the full list.
 	// As there is no free root node, it will be regarded as full.
@@ -270,31 +515,44 @@ static _GFXMemBlock* _gfx_alloc_mem_block(_GFXAllocator* alloc,
 	else
 	{
 		// If not an exact size however (!), insert a free root node.
-		_GFXMemNode* node = gfx_tree_insert(
-			&block->nodes.free, sizeof(_GFXMemNode), NULL, key);
+		_GFXMemFree* node = _gfx_tlsf_alloc(block, blockSize, 0);
 
 		// Ah well..
 		if (node == NULL)
 			goto clean_memory;
 
-		node->free = 1;
-		gfx_list_insert_after(&block->nodes.list, &node->list, NULL);
+		gfx_list_insert_after(&block->nodes.list, &node->node.list, NULL);
 
 		// And link the block in the free list instead.
 		gfx_list_insert_after(&alloc->free, &block->list, NULL);
 	}
 
+	// Keep track of the heap usage, so we don't have to refresh it.
+	alloc->heaps[heap].allocated += blockSize;
+	alloc->heaps[heap].usage += blockSize;
+
+	atomic_fetch_add(&alloc->stats.blocks[type], 1);
+	atomic_fetch_add(&alloc->stats.allocated, blockSize);
+
+	// Observed demand, grow the next block of this memory type.
+	if (!block->single)
+		alloc->blockSizes[type] = GFX_MIN(prefBlockSize << 1, maxBlockSize);
+
 	// Woop woop.
 	gfx_log_debug(
 		"New Vulkan memory object allocated:\n"
 		"    Memory block size: %"PRIu64" bytes%s.\n"
 		"    Prefer block size: %"PRIu64" bytes.\n"
 		"    Memory heap size: %"PRIu64" bytes.\n"
+		"    Memory heap budget: %"PRIu64" bytes.\n"
+		"    Memory heap usage: %"PRIu64" bytes.\n"
 		"    Memory heap flags: %s\n%s%s%s%s%s%s",
 		blockSize,
 		dedicated ? " (dedicated)" : "",
 		prefBlockSize,
 		heapSize,
+		alloc->heaps[heap].budget,
+		alloc->heaps[heap].usage,
 		_GFX_GET_VK_TYPE_EMPTY_STRING(pdmp, type),
 		_GFX_GET_VK_TYPE_DEVICE_LOCAL_STRING(pdmp, type),
 		_GFX_GET_VK_TYPE_HOST_VISIBLE_STRING(pdmp, type),
@@ -308,8 +566,6 @@ static _GFXMemBlock* _gfx_alloc_mem_block(_GFXAllocator* alloc,
 
 	// Cleanup on failure.
 clean_memory:
-	gfx_list_clear(&block->nodes.list);
-	gfx_tree_clear(&block->nodes.free);
 	context->vk.FreeMemory(context->vk.device, block->vk.memory, NULL);
 clean_lock:
 	_gfx_mutex_clear(&block->map.lock);
@@ -342,13 +598,21 @@ static void _gfx_free_mem_block(_GFXAllocator* alloc, _GFXMemBlock* block)
 	context->vk.FreeMemory(context->vk.device, block->vk.memory, NULL);
 	atomic_fetch_sub(&context->limits.allocs, 1);
 
+	// Keep track of the heap usage.
+	alloc->heaps[block->heap].allocated -= block->size;
+	alloc->heaps[block->heap].usage -=
+		GFX_MIN(alloc->heaps[block->heap].usage, block->size);
+
+	atomic_fetch_sub(&alloc->stats.blocks[block->type], 1);
+	atomic_fetch_sub(&alloc->stats.allocated, block->size);
+
 	// Unlink from the allocator and free all remaining block things.
 	gfx_list_erase(
-		(block->nodes.free.root == NULL) ? &alloc->full : &alloc->free,
+		block->retired ? &alloc->retired :
+		(block->nodes.fl == 0) ? &alloc->full : &alloc->free,
 		&block->list);
 
-	gfx_list_clear(&block->nodes.list);
-	gfx_tree_clear(&block->nodes.free);
+	_gfx_tlsf_clear(block);
 	_gfx_mutex_clear(&block->map.lock);
 
 #if !defined (NDEBUG)
@@ -374,6 +638,212 @@ static void _gfx_free_mem_block(_GFXAllocator* alloc, _GFXMemBlock* block)
 	free(block);
 }
 
+/****************************
+ * Frees an empty memory block that is in the full list.
+ * If the allocator limits the #blocks freed per trim, it is retired instead,
+ * and freed by a later _gfx_allocator_trim.
+ * @param mem The last allocation of the block, already regarded as freed.
+ */
+static void _gfx_retire_mem_block(_GFXAllocator* alloc, _GFXMemBlock* block,
+                                  _GFXMemAlloc* mem)
+{
+	assert(alloc != NULL);
+	assert(block != NULL);
+	assert(mem != NULL);
+	assert(block->used == 0);
+
+	if (alloc->release == 0)
+	{
+		_gfx_free_mem_block(alloc, block);
+		return;
+	}
+
+	// The allocation's node must be gone, mem is invalidated.
+	gfx_list_erase(&block->nodes.list, &mem->node.list);
+
+	gfx_list_erase(&alloc->full, &block->list);
+	gfx_list_insert_after(&alloc->retired, &block->list, NULL);
+	block->retired = 1;
+}
+
+/****************************
+ * Searches the free blocks of an allocator for free space.
+ * @param type  Vulkan memory type index to search blocks of.
+ * @param key   Search key { size, alignment }, offset is set on success.
+ * @param src   Block an allocation is moved from, may be NULL.
+ * @param found Outputs the free node to claim memory from, cannot be NULL.
+ * @return NULL if no free space was found.
+ *
+ * If src is not NULL, only blocks more densely used than src are searched.
+ */
+static _GFXMemBlock* _gfx_alloc_search(_GFXAllocator* alloc, uint32_t type,
+                                       bool linear, VkMemoryRequirements reqs,
+                                       VkDeviceSize* key,
+                                       const _GFXMemBlock* src,
+                                       _GFXMemFree** found)
+{
+	assert(alloc != NULL);
+	assert(key != NULL);
+	assert(found != NULL);
+
+	_GFXMemBlock* block;
+	_GFXMemFree* node = NULL;
+
+	// Get the size class to start searching from.
+	uint32_t sFl, sSl;
+	_gfx_tlsf_class(reqs.size, &sFl, &sSl);
+
+	for (
+		block = (_GFXMemBlock*)alloc->free.head;
+		block != NULL;
+		block = (_GFXMemBlock*)block->list.next)
+	{
+		if (block->type != type)
+			continue;
+
+		// When moving, only move to blocks that are used more densely.
+		// This way allocations always converge to fewer blocks.
+		if (src != NULL && (block == src || block->used <= src->used))
+			continue;
+
+		// Search for free space.
+		// We only check the head of every non-empty size class, starting at
+		// the class of the asked size, the bitmaps skip all empty classes.
+		// The head of the class of the asked size may be too small, as may
+		// any head that cannot fit the waste created by alignment and
+		// granularity. This waste is bounded, so within a few classes we
+		// always find a fit, or run out of classes.
+		uint32_t fl = sFl, sl = sSl;
+
+		for (
+			node = _gfx_tlsf_find(block, &fl, &sl);
+			node != NULL;
+			++sl, node = _gfx_tlsf_find(block, &fl, &sl))
+		{
+			// Check if granularity constraints apply.
+			_GFXMemAlloc* left = (_GFXMemAlloc*)node->node.list.prev;
+			_GFXMemAlloc* right = (_GFXMemAlloc*)node->node.list.next;
+
+			// If neighbors exist, they must be an allocation.
+			const bool lGran = (left != NULL && left->linear != linear);
+			const bool rGran = (right != NULL && right->linear != linear);
+
+			// Get the alignment we want, if left granularity applies,
+			// we use the largest of the asked alignment and the granularity.
+			// We can do this because granularity must be a power of two.
+			// This is necessary because a free block directly starts at the
+			// end of a claimed block, so we need to align up.
+			// Otherwise we still need to align up because free nodes are
+			// not ordered by alignment at all.
+			const VkDeviceSize align = lGran ?
+				GFX_MAX(alloc->granularity, reqs.alignment) : reqs.alignment;
+			const VkDeviceSize offset =
+				GFX_ALIGN_UP(node->offset, align);
+
+			VkDeviceSize waste =
+				offset - node->offset;
+
+			// If right granularity applies, we want to align down.
+			// This is necessary because a free block also directly ends at
+			// the start of a claimed block.
+			if (rGran) waste +=
+				right->offset - GFX_ALIGN_DOWN(right->offset, alloc->granularity);
+
+			// Check if we didn't waste all space and
+			// we have enough for the asked size.
+			if (
+				node->size > waste &&
+				node->size - waste >= reqs.size)
+			{
+				_GFX_KEY_OFFSET(key) = offset; // Set the key's offset value.
+				break;
+			}
+		}
+
+		if (node != NULL)
+			break;
+	}
+
+
+	*found = node;
+	return block;
+}
+
+/****************************
+ * Claims memory from a block, i.e. outputs the allocation data.
+ * @param node  Free node to claim from, NULL if the block has no free root.
+ * @param key   Memory to claim { size, offset }, must fit in node.
+ * @param flags Vulkan memory property flags of the block's memory type.
+ */
+static void _gfx_alloc_claim(_GFXAllocator* alloc, _GFXMemAlloc* mem,
+                             _GFXMemBlock* block, _GFXMemFree* node,
+                             const VkDeviceSize* key, bool linear,
+                             VkDeviceSize alignment, VkMemoryPropertyFlags flags)
+{
+	assert(alloc != NULL);
+	assert(mem != NULL);
+	assert(block != NULL);
+	assert(key != NULL);
+
+	*mem = (_GFXMemAlloc){
+		.node   = { .free = 0 },
+		.block  = block,
+		.slab   = NULL,
+		.size   = _GFX_KEY_SIZE(key),
+		.offset = _GFX_KEY_OFFSET(key),
+		.flags  = flags,
+		.linear = linear,
+		.vk     = { .memory = block->vk.memory }
+	};
+
+	gfx_list_insert_before(
+		&block->nodes.list, &mem->node.list,
+		(node == NULL) ? NULL : &node->node.list);
+
+	block->used += _GFX_KEY_SIZE(key);
+
+	atomic_fetch_add(&alloc->stats.used, _GFX_KEY_SIZE(key));
+	atomic_fetch_add(&alloc->stats.allocs, 1);
+
+	// Now fix the free ranges...
+	// If there was no free root node to begin with, we're done!
+	if (node == NULL)
+		return;
+
+	// So we aligned the claimed memory, this means there could be some waste
+	// to the left of it, however we just ignore it and consider it unusable.
+	// However to the right of the memory we might still have a big free block.
+	const VkDeviceSize rOffset =
+		_GFX_KEY_OFFSET(key) + _GFX_KEY_SIZE(key);
+	const VkDeviceSize rSize =
+		node->size - (rOffset - node->offset);
+
+	// The waste we created to the left is at most (alignment - 1) in size,
+	// ignoring granularity. Similarly, if memory to the right is smaller
+	// than the waste, we skip it as well.
+	// Bit of an arbitrary heuristic, but hey we don't like small nodes :)
+	if (rSize < alignment)
+	{
+		// Not preserving any memory, erase claimed node.
+		gfx_list_erase(&block->nodes.list, &node->node.list);
+		_gfx_tlsf_erase(block, node);
+		free(node);
+
+		// Move block to full list if fully allocated now.
+		if (block->nodes.fl == 0)
+		{
+			gfx_list_erase(&alloc->free, &block->list);
+			gfx_list_insert_after(&alloc->full, &block->list, NULL);
+		}
+	}
+	else
+	{
+		// We want to preserve memory to the right,
+		// so just update the node's range (and size class).
+		_gfx_tlsf_update(block, node, rSize, rOffset);
+	}
+}
+
 /****************************/
 void _gfx_allocator_init(_GFXAllocator* alloc, _GFXDevice* device)
 {
@@ -386,11 +856,33 @@ void _gfx_allocator_init(_GFXAllocator* alloc, _GFXDevice* device)
 
 	gfx_list_init(&alloc->free);
 	gfx_list_init(&alloc->full);
+	gfx_list_init(&alloc->retired);
 
 	VkPhysicalDeviceProperties pdp;
 	_groufix.vk.GetPhysicalDeviceProperties(device->vk.device, &pdp);
 
 	alloc->granularity = pdp.limits.bufferImageGranularity;
+	alloc->atomSize = pdp.limits.nonCoherentAtomSize;
+	alloc->keep = _GFX_DEF_KEEP_BLOCKS;
+	alloc->release = 0;
+
+	for (uint32_t t = 0; t < VK_MAX_MEMORY_TYPES; ++t)
+		alloc->blockSizes[t] = 0;
+
+	// Initialize the memory heap budgets & statistics.
+	for (uint32_t h = 0; h < VK_MAX_MEMORY_HEAPS; ++h)
+		alloc->heaps[h].allocated = 0;
+
+	for (uint32_t t = 0; t < VK_MAX_MEMORY_TYPES; ++t)
+		atomic_store(&alloc->stats.blocks[t], 0);
+
+	atomic_store(&alloc->stats.allocated, 0);
+	atomic_store(&alloc->stats.used, 0);
+	atomic_store(&alloc->stats.allocs, 0);
+	atomic_store(&alloc->stats.cells, 0);
+	atomic_store(&alloc->stats.fallbacks, 0);
+
+	_gfx_allocator_budget(alloc);
 }
 
 /****************************/
@@ -405,9 +897,117 @@ void _gfx_allocator_clear(_GFXAllocator* alloc)
 	while (alloc->full.head != NULL)
 		_gfx_free_mem_block(alloc, (_GFXMemBlock*)alloc->full.head);
 
+	while (alloc->retired.head != NULL)
+		_gfx_free_mem_block(alloc, (_GFXMemBlock*)alloc->retired.head);
+
 	// Kind of a no-op, but for consistency.
 	gfx_list_clear(&alloc->free);
 	gfx_list_clear(&alloc->full);
+	gfx_list_clear(&alloc->retired);
+}
+
+/****************************/
+void _gfx_allocator_trim(_GFXAllocator* alloc)
+{
+	assert(alloc != NULL);
+
+	// Free at most alloc->release blocks, oldest retired blocks first.
+	uint32_t budget = (alloc->release == 0) ? UINT32_MAX : alloc->release;
+
+	while (budget > 0 && alloc->retired.head != NULL)
+		_gfx_free_mem_block(alloc, (_GFXMemBlock*)alloc->retired.head),
+		--budget;
+
+	// Count the empty blocks of each memory type, free all beyond keep.
+	// Empty blocks are never full, so only check the free list.
+	uint32_t empty[VK_MAX_MEMORY_TYPES] = { 0 };
+	_GFXMemBlock* next = (_GFXMemBlock*)alloc->free.head;
+
+	while (budget > 0 && next != NULL)
+	{
+		_GFXMemBlock* block = next;
+		next = (_GFXMemBlock*)block->list.next;
+
+		if (block->used > 0 || ++empty[block->type] <= alloc->keep)
+			continue;
+
+		// Demand went down, shrink the next block of this memory type.
+		alloc->blockSizes[block->type] = GFX_MAX(
+			alloc->blockSizes[block->type] >> 1, _GFX_MIN_BLOCK_SIZE);
+
+		_gfx_free_mem_block(alloc, block);
+		--budget;
+	}
+}
+
+/****************************/
+void _gfx_allocator_budget(_GFXAllocator* alloc)
+{
+	assert(alloc != NULL);
+
+	const bool ext =
+		alloc->context->features & _GFX_SUPPORT_MEMORY_BUDGET;
+
+	// Query memory properties, including budgets if supported.
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT pdmbp = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT,
+		.pNext = NULL
+	};
+
+	VkPhysicalDeviceMemoryProperties2 pdmp2 = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2,
+		.pNext = ext ? &pdmbp : NULL
+	};
+
+	_groufix.vk.GetPhysicalDeviceMemoryProperties2(
+		alloc->device->vk.device, &pdmp2);
+
+	alloc->numHeaps = pdmp2.memoryProperties.memoryHeapCount;
+
+	for (uint32_t h = 0; h < alloc->numHeaps; ++h)
+	{
+		const VkDeviceSize size = pdmp2.memoryProperties.memoryHeaps[h].size;
+		alloc->heaps[h].size = size;
+
+		// Without the extension, we can only estimate from our own usage.
+		// Note that usage reported by Vulkan includes other allocators!
+		alloc->heaps[h].budget =
+			ext ? pdmbp.heapBudget[h] : _GFX_DEF_HEAP_BUDGET(size);
+		alloc->heaps[h].usage =
+			ext ? pdmbp.heapUsage[h] : alloc->heaps[h].allocated;
+	}
+}
+
+/****************************/
+VkDeviceSize _gfx_allocator_largest(_GFXAllocator* alloc)
+{
+	assert(alloc != NULL);
+
+	// The largest free range of a block is in its largest size class.
+	// Full blocks have no free ranges, so only check the free list.
+	VkDeviceSize largest = 0;
+
+	for (
+		_GFXMemBlock* block = (_GFXMemBlock*)alloc->free.head;
+		block != NULL;
+		block = (_GFXMemBlock*)block->list.next)
+	{
+		if (block->nodes.fl == 0)
+			continue;
+
+		const uint32_t fl = _gfx_tlsf_msb(block->nodes.fl);
+		const uint32_t sl = _gfx_tlsf_msb(block->nodes.sl[fl]);
+
+		for (
+			_GFXMemFree* node = block->nodes.free[fl][sl];
+			node != NULL;
+			node = node->next)
+		{
+			largest = GFX_MAX(largest, node->size);
+		}
+	}
+
+	return largest;
 }
 
 /****************************/
@@ -421,6 +1021,8 @@ bool _gfx_alloc(_GFXAllocator* alloc, _GFXMemAlloc* mem, bool linear,
 	assert(GFX_IS_POWER_OF_TWO(reqs.alignment));
 	assert(reqs.memoryTypeBits != 0);
 
+	gfx_trace_begin(alloc, "_gfx_alloc");
+
 	// Alignment of 0 means 1.
 	reqs.alignment = (reqs.alignment > 0) ? reqs.alignment : 1;
 
@@ -432,13 +1034,12 @@ bool _gfx_alloc(_GFXAllocator* alloc, _GFXMemAlloc* mem, bool linear,
 	// Get memory type index.
 	uint32_t tReq, tOpt;
 	_GFX_GET_MEM_TYPES(
-		tReq, tOpt, &pdmp, required, optimal, reqs.memoryTypeBits,
-		return 0);
+		tReq, tOpt, alloc, &pdmp, required, optimal, reqs.memoryTypeBits,
+		goto error);
 
-	// Construct a search key:
-	// The key of the memory block will store two uint64_t's:
-	// the first being the size, the second being the offset.
-	// Alignment is computed from offset to compare, so we can insert alignment.
+	// Construct a claim key:
+	// The key stores two uint64_t's: the first being the size,
+	// the second being the offset, which we initialize to the alignment.
 	// When found, we override this alignment with the resulting offset,
 	// at that point we will use the key's values for consistency.
 	VkDeviceSize key[2] = { reqs.size, reqs.alignment };
@@ -448,82 +1049,39 @@ bool _gfx_alloc(_GFXAllocator* alloc, _GFXMemAlloc* mem, bool linear,
 	// Note that if neither types are defined we already returned.
 	uint32_t type = (tOpt == UINT32_MAX) ? tReq : tOpt;
 	_GFXMemBlock* block;
-	_GFXMemNode* node = NULL;
+	_GFXMemFree* node;
+
+	// Whether we can still fallback to another type & did so early.
+	bool fallback = (tOpt != UINT32_MAX && tReq != UINT32_MAX && tReq != tOpt);
+	bool early = 0;
 
 	// Goto here to try with another type :)
 try_search:
-
-	for (
-		block = (_GFXMemBlock*)alloc->free.head;
-		block != NULL;
-		block = (_GFXMemBlock*)block->list.next)
+	block = _gfx_alloc_search(alloc, type, linear, reqs, key, NULL, &node);
+	if (block == NULL)
 	{
-		if (block->type != type)
-			continue;
-
-		// Search for free space.
-		// If there are no nodes with an exact size match, we need the least
-		// strict alignment of the next size class, the tree does this for us
-		// by searching for a right match.
-		// If there are exact size matches, we want the least strict alignment
-		// that is >= than the key's alignment, so again, right match.
-		// Lastly, for granularity constraints we need to search all exact
-		// size/alignment duplicates, luckily right match will return the
-		// left-most duplicate, so gfx_tree_succ will cover them all.
-		for (
-			node = gfx_tree_search(&block->nodes.free, key, GFX_TREE_MATCH_RIGHT);
-			node != NULL;
-			node = gfx_tree_succ(&block->nodes.free, node))
+		// Uh oh the search failed, we need to allocate a new memory block.
+		// Refresh the budget first, if the heap of this memory type is out
+		// of budget but the fallback is not, fallback early.
+		// Otherwise the driver may start paging long before it fails.
+		const uint32_t other = (type == tOpt) ? tReq : tOpt;
+		_gfx_allocator_budget(alloc);
+
+		if (
+			fallback && !early &&
+			!_gfx_allocator_has_budget(alloc, &pdmp, type, reqs.size) &&
+			_gfx_allocator_has_budget(alloc, &pdmp, other, reqs.size))
 		{
-			const VkDeviceSize* fKey = gfx_tree_key(&block->nodes.free, node);
-
-			// Check if granularity constraints apply.
-			_GFXMemAlloc* left = (_GFXMemAlloc*)node->list.prev;
-			_GFXMemAlloc* right = (_GFXMemAlloc*)node->list.next;
+			gfx_log_debug(
+				"Memory heap out of budget, will try to fallback to another "
+				"available memory heap.");
 
-			// If neighbors exist, they must be an allocation.
-			const bool lGran = (left != NULL && left->linear != linear);
-			const bool rGran = (right != NULL && right->linear != linear);
-
-			// Get the alignment we want, if left granularity applies,
-			// we use the largest of the asked alignment and the granularity.
-			// We can do this because granularity must be a power of two.
-			// This is necessary because a free block directly starts at the
-			// end of a claimed block, so we need to align up.
-			// Otherwise we still need to align up because we can encounter
-			// less strict alignments when the node's size is larger.
-			const VkDeviceSize align = lGran ?
-				GFX_MAX(alloc->granularity, reqs.alignment) : reqs.alignment;
-			const VkDeviceSize offset =
-				GFX_ALIGN_UP(_GFX_KEY_OFFSET(fKey), align);
-
-			VkDeviceSize waste =
-				offset - _GFX_KEY_OFFSET(fKey);
-
-			// If right granularity applies, we want to align down.
-			// This is necessary because a free block also directly ends at
-			// the start of a claimed block.
-			if (rGran) waste +=
-				right->offset - GFX_ALIGN_DOWN(right->offset, alloc->granularity);
-
-			// Check if we didn't waste all space and
-			// we have enough for the asked size.
-			if (
-				_GFX_KEY_SIZE(fKey) > waste &&
-				_GFX_KEY_SIZE(fKey) - waste >= reqs.size)
-			{
-				_GFX_KEY_OFFSET(key) = offset; // Set the key's offset value.
-				break;
-			}
+			early = 1;
+			type = other;
+			goto try_search;
 		}
 
-		if (node != NULL)
-			break;
-	}
-
-	if (block == NULL)
-	{
-		// Uh oh the search failed, try to allocate a new memory block.
+		// Try to allocate the new memory block.
 		block = _gfx_alloc_mem_block(
 			alloc, &pdmp, type, reqs.size,
 			GFX_MAX(reqs.size, _GFX_DEF_LARGE_HEAP_BLOCK_SIZE),
@@ -532,13 +1090,13 @@ try_search:
 		// Well this is not going well..
 		if (block == NULL)
 		{
-			// If we tried the optimal memory type, and there is a defined
-			// required type as fallback, try to search/allocate using that.
+			// If there is another defined memory type as fallback,
+			// try to search/allocate using that.
 			// This is a bit much logging going on, however this is quite
 			// an extraordinary situation, so we would surely want to
 			// know about it.
 			// Announce we're still trying through a warning.
-			if (type == tOpt && (tReq != UINT32_MAX && tReq != tOpt))
+			if (fallback)
 			{
 				gfx_log_warn(
 					"Allocation failed, will try to fallback to another "
@@ -552,76 +1110,38 @@ try_search:
 					_GFX_GET_VK_TYPE_LAZILY_ALLOCATED_STRING(&pdmp, type),
 					_GFX_GET_VK_TYPE_PROTECTED_STRING(&pdmp, type));
 
-				type = tReq;
+				fallback = 0;
+				type = other;
 				goto try_search;
 			}
 
-			return 0;
+			goto error;
 		}
 
 		// There's 1 free node, the entire block, just pick it :)
 		// We're at the beginning, so it always aligns, set offset of 0.
-		node = block->nodes.free.root;
+		node = (_GFXMemFree*)block->nodes.list.head;
 		_GFX_KEY_OFFSET(key) = 0;
 	}
 
 	// Claim the memory.
-	// i.e. output the allocation data.
-	*mem = (_GFXMemAlloc){
-		.node   = { .free = 0 },
-		.block  = block,
-		.size   = _GFX_KEY_SIZE(key),
-		.offset = _GFX_KEY_OFFSET(key),
-		.flags  = pdmp.memoryTypes[block->type].propertyFlags,
-		.linear = linear,
-		.vk     = { .memory = block->vk.memory }
-	};
+	_gfx_alloc_claim(
+		alloc, mem, block, node, key, linear, reqs.alignment,
+		pdmp.memoryTypes[block->type].propertyFlags);
 
-	gfx_list_insert_before(
-		&block->nodes.list, &mem->node.list,
-		(node == NULL) ? NULL : &node->list);
+	if (tOpt != UINT32_MAX && block->type != tOpt)
+		atomic_fetch_add(&alloc->stats.fallbacks, 1);
 
-	// Now fix the free tree...
-	// If there was no free root node to begin with, we're done!
-	if (node == NULL)
-		return 1;
+	gfx_trace_end(alloc);
 
-	// So we aligned the claimed memory, this means there could be some waste
-	// to the left of it, however we just ignore it and consider it unusable.
-	// However to the right of the memory we might still have a big free block.
-	const VkDeviceSize* cKey = gfx_tree_key(&block->nodes.free, node);
-
-	const VkDeviceSize rOffset =
-		_GFX_KEY_OFFSET(key) + _GFX_KEY_SIZE(key);
-	const VkDeviceSize rSize =
-		_GFX_KEY_SIZE(cKey) - (rOffset - _GFX_KEY_OFFSET(cKey));
+	return 1;
 
-	// The waste we created to the left is at most (alignment - 1) in size,
-	// ignoring granularity. Similarly, if memory to the right is smaller
-	// than the waste, we skip it as well.
-	// Bit of an arbitrary heuristic, but hey we don't like small nodes :)
-	if (rSize < reqs.alignment)
-	{
-		// Not preserving any memory, erase claimed node.
-		gfx_list_erase(&block->nodes.list, &node->list);
-		gfx_tree_erase(&block->nodes.free, node);
 
-		// Move block to full list if fully allocated now.
-		if (block->nodes.free.root == NULL)
-		{
-			gfx_list_erase(&alloc->free, &block->list);
-			gfx_list_insert_after(&alloc->full, &block->list, NULL);
-		}
-	}
-	else
-	{
-		// We want to preserve memory to the right,
-		// so just update the node's key in the free tree.
-		const VkDeviceSize rKey[2] = { rSize, rOffset };
-		gfx_tree_update(&block->nodes.free, node, rKey);
-	}
+	// Error on failure.
+error:
+	gfx_trace_end(alloc);
 
-	return 1;
+	return 0;
 }
 
 /****************************/
@@ -644,9 +1164,25 @@ bool _gfx_allocd(_GFXAllocator* alloc, _GFXMemAlloc* mem,
 	// Get memory type index.
 	uint32_t tReq, tOpt;
 	_GFX_GET_MEM_TYPES(
-		tReq, tOpt, &pdmp, required, optimal, reqs.memoryTypeBits,
+		tReq, tOpt, alloc, &pdmp, required, optimal, reqs.memoryTypeBits,
 		return 0);
 
+	// Refresh the budget, if the heap of the optimal memory type is out of
+	// budget but the required memory type is not, swap them around.
+	// Remember the optimal type for statistics.
+	const uint32_t type = tOpt;
+	_gfx_allocator_budget(alloc);
+
+	if (
+		tOpt != UINT32_MAX && tReq != UINT32_MAX && tReq != tOpt &&
+		!_gfx_allocator_has_budget(alloc, &pdmp, tOpt, reqs.size) &&
+		_gfx_allocator_has_budget(alloc, &pdmp, tReq, reqs.size))
+	{
+		const uint32_t t = tOpt;
+		tOpt = tReq;
+		tReq = t;
+	}
+
 	// Allocate a memory block.
 	// No free root node is inserted by setting minSize == maxSize.
 	_GFXMemBlock* block = NULL;
@@ -681,40 +1217,120 @@ bool _gfx_allocd(_GFXAllocator* alloc, _GFXMemAlloc* mem,
 	if (block == NULL)
 		return 0;
 
-	// Claim memory,
-	// i.e. output the allocation data.
-	*mem = (_GFXMemAlloc){
-		.node   = { .free = 0 },
-		.block  = block,
-		.size   = reqs.size,
-		.offset = 0,
-		.flags  = pdmp.memoryTypes[block->type].propertyFlags,
-		.linear = 0,
-		.vk     = { .memory = block->vk.memory }
-	};
+	// Claim memory, there is no free root node.
+	const VkDeviceSize key[2] = { reqs.size, 0 };
+
+	_gfx_alloc_claim(
+		alloc, mem, block, NULL, key, 0, reqs.alignment,
+		pdmp.memoryTypes[block->type].propertyFlags);
 
-	gfx_list_insert_before(&block->nodes.list, &mem->node.list, NULL);
+	if (type != UINT32_MAX && block->type != type)
+		atomic_fetch_add(&alloc->stats.fallbacks, 1);
 
 	return 1;
 }
 
+/****************************/
+bool _gfx_alloc_defrag(_GFXAllocator* alloc, _GFXMemAlloc* mem,
+                       const _GFXMemAlloc* src, VkMemoryRequirements reqs)
+{
+	assert(alloc != NULL);
+	assert(mem != NULL);
+	assert(src != NULL);
+	assert(src->slab == NULL);
+	assert(reqs.size > 0);
+	assert(GFX_IS_POWER_OF_TWO(reqs.alignment));
+
+	// Must be able to use the same memory type.
+	if (!(((uint32_t)1 << src->block->type) & reqs.memoryTypeBits))
+		return 0;
+
+	// Alignment of 0 means 1.
+	reqs.alignment = (reqs.alignment > 0) ? reqs.alignment : 1;
+
+	// Search for free space in other blocks, never allocate a new block,
+	// as that would defeat the purpose of moving the allocation.
+	VkDeviceSize key[2] = { reqs.size, reqs.alignment };
+	_GFXMemFree* node;
+
+	_GFXMemBlock* block = _gfx_alloc_search(
+		alloc, src->block->type, src->linear, reqs, key, src->block, &node);
+
+	if (block == NULL)
+		return 0;
+
+	_gfx_alloc_claim(
+		alloc, mem, block, node, key, src->linear, reqs.alignment,
+		src->flags);
+
+	return 1;
+}
+
+/****************************/
+void _gfx_relocate(_GFXMemAlloc* dst, _GFXMemAlloc* src)
+{
+	assert(dst != NULL);
+	assert(src != NULL);
+	assert(dst != src);
+
+	GFXList* list = &src->block->nodes.list;
+
+	// Copy all data, then take the place of src in the list of nodes.
+	// Inserting dst will initialize its (copied) list node.
+	// Slab sub-allocations are not in the list, just copy those.
+	*dst = *src;
+	if (src->slab != NULL) return;
+
+	gfx_list_insert_before(list, &dst->node.list, &src->node.list);
+	gfx_list_erase(list, &src->node.list);
+}
+
 /****************************/
 void _gfx_free(_GFXAllocator* alloc, _GFXMemAlloc* mem)
 {
 	assert(alloc != NULL);
 	assert(mem != NULL);
+	assert(mem->slab == NULL);
 
 	_GFXMemBlock* block = mem->block;
+	block->used -= mem->size;
+
+	atomic_fetch_sub(&alloc->stats.used, mem->size);
+	atomic_fetch_sub(&alloc->stats.allocs, 1);
 
-	// Ok we have to deal with the list of memory nodes and the free tree..
+	// Ok we have to deal with the list of memory nodes and the free ranges..
 	// First the case that this allocation is the only memory node.
-	// Just free the memory block.
+	// Free the memory block if it only exists for this allocation,
+	// otherwise keep it around (empty) until the allocator is trimmed.
 	_GFXMemNode* left = (_GFXMemNode*)mem->node.list.prev;
 	_GFXMemNode* right = (_GFXMemNode*)mem->node.list.next;
 
 	if (left == NULL && right == NULL)
 	{
-		_gfx_free_mem_block(alloc, block);
+		if (block->single)
+		{
+			_gfx_retire_mem_block(alloc, block, mem);
+			return;
+		}
+
+		// As it is the only node, the block must be full,
+		// insert a free root node spanning the entire block.
+		_GFXMemFree* node = _gfx_tlsf_alloc(block, block->size, 0);
+
+		// Cannot represent it as empty, just free it.
+		if (node == NULL)
+		{
+			_gfx_retire_mem_block(alloc, block, mem);
+			return;
+		}
+
+		gfx_list_erase(&block->nodes.list, &mem->node.list);
+		gfx_list_insert_after(&block->nodes.list, &node->node.list, NULL);
+
+		// And move it to the free list.
+		gfx_list_erase(&alloc->full, &block->list);
+		gfx_list_insert_after(&alloc->free, &block->list, NULL);
+
 		return;
 	}
 
@@ -725,19 +1341,18 @@ void _gfx_free(_GFXAllocator* alloc, _GFXMemAlloc* mem)
 	const VkDeviceSize lBound =
 		(left == NULL) ? 0 :
 		(left->free) ?
-			_GFX_KEY_OFFSET(gfx_tree_key(&block->nodes.free, left)) :
+			((_GFXMemFree*)left)->offset :
 			((_GFXMemAlloc*)left)->offset +
 			((_GFXMemAlloc*)left)->size;
 
 	const VkDeviceSize rBound =
 		(right == NULL) ? block->size :
 		(right->free) ?
-			_GFX_KEY_OFFSET(gfx_tree_key(&block->nodes.free, right)) +
-			_GFX_KEY_SIZE(gfx_tree_key(&block->nodes.free, right)) :
+			((_GFXMemFree*)right)->offset +
+			((_GFXMemFree*)right)->size :
 			((_GFXMemAlloc*)right)->offset;
 
-	// Now modify the list and free tree to reflect the claimed space.
-	const VkDeviceSize key[2] = { rBound - lBound, lBound };
+	// Now modify the list and free ranges to reflect the claimed space.
 	const bool lFree = (left != NULL) && left->free;
 	const bool rFree = (right != NULL) && right->free;
 
@@ -751,26 +1366,24 @@ void _gfx_free(_GFXAllocator* alloc, _GFXMemAlloc* mem)
 		if (lFree && rFree)
 		{
 			gfx_list_erase(&block->nodes.list, &right->list);
-			gfx_tree_erase(&block->nodes.free, right);
+			_gfx_tlsf_erase(block, (_GFXMemFree*)right);
+			free(right);
 		}
 
-		// If more than one node remains in the list,
-		// expand a neighbour so it covers the new free space.
-		// If only one remains, just free the entire memory block.
-		if (block->nodes.list.head != block->nodes.list.tail)
-			gfx_tree_update(&block->nodes.free, lFree ? left : right, key);
-		else
-			_gfx_free_mem_block(alloc, block);
+		// Expand a neighbour so it covers the new free space.
+		// If it is the only node left, the block is now empty,
+		// which is kept around until the allocator is trimmed.
+		_gfx_tlsf_update(block,
+			(_GFXMemFree*)(lFree ? left : right), rBound - lBound, lBound);
 	}
 	else
 	{
-		const bool full = (block->nodes.free.root == NULL);
+		const bool full = (block->nodes.fl == 0);
 
 		// We know no free neighbour exists AND at least one neighbour exists,
 		// if no neighbour were to exist at all we exit early at the top.
 		// So just insert a new free node.
-		_GFXMemNode* node = gfx_tree_insert(
-			&block->nodes.free, sizeof(_GFXMemNode), NULL, key);
+		_GFXMemFree* node = _gfx_tlsf_alloc(block, rBound - lBound, lBound);
 
 		if (node == NULL)
 		{
@@ -778,13 +1391,13 @@ void _gfx_free(_GFXAllocator* alloc, _GFXMemAlloc* mem)
 			gfx_log_warn(
 				"Could not insert a new free node whilst freeing an allocation "
 				"from a Vulkan memory object, potentially lost %"PRIu64" bytes.",
-				_GFX_KEY_SIZE(key));
+				rBound - lBound);
 		}
 		else
 		{
 			// Yey we have a node, link it in..
-			node->free = 1;
-			gfx_list_insert_after(&block->nodes.list, &node->list, &mem->node.list);
+			gfx_list_insert_after(
+				&block->nodes.list, &node->node.list, &mem->node.list);
 
 			if (full)
 			{
@@ -849,6 +1462,63 @@ unlock:
 	return ptr;
 }
 
+/****************************
+ * Computes the mapped memory range of an allocation,
+ * rounded to the non-coherent atom size.
+ */
+static VkMappedMemoryRange _gfx_mem_range(_GFXAllocator* alloc,
+                                          _GFXMemAlloc* mem)
+{
+	const VkDeviceSize atom = GFX_MAX(alloc->atomSize, 1);
+	const VkDeviceSize offset = mem->offset & ~(atom - 1);
+	const VkDeviceSize end = GFX_ALIGN_UP(mem->offset + mem->size, atom);
+
+	return (VkMappedMemoryRange){
+		.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+
+		.pNext  = NULL,
+		.memory = mem->vk.memory,
+		.offset = offset,
+		.size   = (end >= mem->block->size) ? VK_WHOLE_SIZE : end - offset
+	};
+}
+
+/****************************/
+void _gfx_mem_invalidate(_GFXAllocator* alloc, _GFXMemAlloc* mem)
+{
+	assert(alloc != NULL);
+	assert(mem != NULL);
+
+	if (mem->flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+		return;
+
+	_GFXContext* context = alloc->context;
+	const VkMappedMemoryRange range = _gfx_mem_range(alloc, mem);
+
+	_GFX_VK_CHECK(
+		context->vk.InvalidateMappedMemoryRanges(
+			context->vk.device, 1, &range),
+		gfx_log_warn("Could not invalidate mapped memory."));
+}
+
+/****************************/
+void _gfx_mem_flush(_GFXAllocator* alloc, _GFXMemAlloc* mem)
+{
+	assert(alloc != NULL);
+	assert(mem != NULL);
+
+	if (mem->flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+		return;
+
+	_GFXContext* context = alloc->context;
+	const VkMappedMemoryRange range = _gfx_mem_range(alloc, mem);
+
+	_GFX_VK_CHECK(
+		context->vk.FlushMappedMemoryRanges(
+			context->vk.device, 1, &range),
+		gfx_log_warn("Could not flush mapped memory."));
+}
+
 /****************************/
 void _gfx_unmap(_GFXAllocator* alloc, _GFXMemAlloc* mem)
 {
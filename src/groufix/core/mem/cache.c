@@ -8,6 +8,7 @@
 
 #include "groufix/core/mem.h"
 #include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -15,6 +16,22 @@
 // 'Randomized' magic number (generated by human imagination).
 #define _GFX_HEADER_MAGIC ((uint32_t)0xff60af14)
 
+// Version of the groufix pipeline cache format.
+#define _GFX_HEADER_VERSION ((uint32_t)1)
+
+// Size of the packed groufix pipeline cache header & chunk header.
+#define _GFX_HEADER_SIZE (sizeof(uint32_t) * 6 + VK_UUID_SIZE)
+#define _GFX_CHUNK_HEADER_SIZE (sizeof(uint64_t) * 2)
+
+// Alignment of all chunks in a groufix pipeline cache.
+#define _GFX_CHUNK_ALIGN 8
+
+// Size of the stack buffer to build keys in, larger keys are allocated.
+#define _GFX_KEY_BUFFER_SIZE 1024
+
+// Minimum capacity of a lock-free lookup table, must be a power of two.
+#define _GFX_TABLE_MIN_CAPACITY 16
+
 
 // Pushes an lvalue to a hash key being built.
 #define _GFX_KEY_PUSH(value) \
@@ -37,16 +54,22 @@
 	} while (0)
 
 
+/****************************
+ * Next pipeline cache temporary file id (within this process).
+ */
+static atomic_uintmax_t _gfx_cache_tmp = 0;
+
+
 /****************************
  * Unpacked groufix pipeline cache header.
+ * A groufix pipeline cache consists of this header followed by any number
+ * of chunks, each chunk is a _GFXPipelineCacheChunk followed by its data,
+ * padded to _GFX_CHUNK_ALIGN bytes. All chunks are merged when loading.
  */
 typedef struct _GFXPipelineCacheHeader
 {
-	uint32_t magic; // Equal to _GFX_HEADER_MAGIC.
-
-	// Data size & hash including this header (with hash set to 0).
-	uint32_t dataSize;
-	uint64_t dataHash;
+	uint32_t magic;   // Equal to _GFX_HEADER_MAGIC.
+	uint32_t version; // Equal to _GFX_HEADER_VERSION.
 
 	// Vulkan values to validate compatibility.
 	uint32_t vendorID;
@@ -59,18 +82,213 @@ typedef struct _GFXPipelineCacheHeader
 
 
 /****************************
- * Allocates & builds a hashable key value from a Vk*CreateInfo struct
+ * Unpacked groufix pipeline cache chunk header.
+ */
+typedef struct _GFXPipelineCacheChunk
+{
+	uint64_t dataSize; // Excluding this header & padding.
+	uint64_t dataHash;
+
+} _GFXPipelineCacheChunk;
+
+
+/****************************
+ * Lock-free lookup table of cache elements, an index into one of the maps.
+ * Elements can only be inserted, never erased, so readers can traverse it
+ * without any lock. The table is replaced when growing, old tables are
+ * retired (not freed) so concurrent readers can finish reading them.
+ */
+typedef struct _GFXCacheTable
+{
+	struct _GFXCacheTable* prev; // Retired table, freed on clear.
+
+	size_t size;
+	size_t capacity; // Power of two.
+
+	struct
+	{
+		uint64_t         hash;
+		atomic_uintptr_t elem; // Written last, 0 if empty.
+
+	} slots[];
+
+} _GFXCacheTable;
+
+
+/****************************
+ * Searches a lock-free lookup table for an element.
+ * @param table Table to search in, cannot be NULL.
+ * @param map   Map the table indexes into, cannot be NULL.
+ * @return NULL if not found.
+ *
+ * Can run concurrently with (one) _gfx_cache_table_insert.
+ */
+static _GFXCacheElem* _gfx_cache_table_search(atomic_uintptr_t* table,
+                                              GFXMap* map,
+                                              const _GFXHashKey* key,
+                                              uint64_t hash)
+{
+	const _GFXCacheTable* tab = (const _GFXCacheTable*)atomic_load_explicit(
+		table, memory_order_acquire);
+
+	if (tab == NULL) return NULL;
+
+	// Linear probing, the table is never full.
+	const size_t mask = tab->capacity - 1;
+
+	for (size_t i = (size_t)hash & mask; ; i = (i + 1) & mask)
+	{
+		_GFXCacheElem* elem = (_GFXCacheElem*)atomic_load_explicit(
+			&tab->slots[i].elem, memory_order_acquire);
+
+		if (elem == NULL)
+			return NULL;
+
+		if (
+			tab->slots[i].hash == hash &&
+			!map->cmp(gfx_map_key(map, elem), key))
+		{
+			return elem;
+		}
+	}
+}
+
+/****************************
+ * Inserts an element into a lock-free lookup table.
+ * @param table Table to insert in, cannot be NULL.
+ * @param elem  Must be a node of the map the table indexes into.
+ * @return Non-zero on success.
+ *
+ * Cannot run concurrently with itself for the same table.
+ */
+static bool _gfx_cache_table_insert(atomic_uintptr_t* table,
+                                    _GFXCacheElem* elem, uint64_t hash)
+{
+	_GFXCacheTable* tab = (_GFXCacheTable*)atomic_load_explicit(
+		table, memory_order_relaxed);
+
+	// Keep the load factor at or below 1/2, grow if necessary.
+	// Build the new table in full before publishing it.
+	if (tab == NULL || (tab->size + 1) << 1 > tab->capacity)
+	{
+		const size_t cap = (tab == NULL) ?
+			_GFX_TABLE_MIN_CAPACITY : tab->capacity << 1;
+
+		_GFXCacheTable* new = malloc(
+			sizeof(_GFXCacheTable) + cap * sizeof(new->slots[0]));
+
+		if (new == NULL)
+			return 0;
+
+		new->prev = tab;
+		new->size = 0;
+		new->capacity = cap;
+
+		for (size_t i = 0; i < cap; ++i)
+			atomic_store_explicit(
+				&new->slots[i].elem, (uintptr_t)NULL, memory_order_relaxed);
+
+		for (size_t i = 0; tab != NULL && i < tab->capacity; ++i)
+		{
+			const uintptr_t e = atomic_load_explicit(
+				&tab->slots[i].elem, memory_order_relaxed);
+
+			if (e == (uintptr_t)NULL) continue;
+
+			size_t j = (size_t)tab->slots[i].hash & (cap - 1);
+			while (atomic_load_explicit(
+				&new->slots[j].elem, memory_order_relaxed) != (uintptr_t)NULL)
+			{
+				j = (j + 1) & (cap - 1);
+			}
+
+			new->slots[j].hash = tab->slots[i].hash;
+			atomic_store_explicit(&new->slots[j].elem, e, memory_order_relaxed);
+			++new->size;
+		}
+
+		tab = new;
+		atomic_store_explicit(table, (uintptr_t)(void*)tab, memory_order_release);
+	}
+
+	// Find an empty slot & publish the element, hash first.
+	const size_t mask = tab->capacity - 1;
+	size_t i = (size_t)hash & mask;
+
+	while (atomic_load_explicit(
+		&tab->slots[i].elem, memory_order_relaxed) != (uintptr_t)NULL)
+	{
+		i = (i + 1) & mask;
+	}
+
+	tab->slots[i].hash = hash;
+	atomic_store_explicit(
+		&tab->slots[i].elem, (uintptr_t)(void*)elem, memory_order_release);
+
+	++tab->size;
+
+	return 1;
+}
+
+/****************************
+ * Frees a lock-free lookup table and all its retired tables.
+ * @param table Table to clear, cannot be NULL, is set to empty.
+ *
+ * Cannot run concurrently with any other table function for the same table.
+ */
+static void _gfx_cache_table_clear(atomic_uintptr_t* table)
+{
+	_GFXCacheTable* tab = (_GFXCacheTable*)atomic_load_explicit(
+		table, memory_order_relaxed);
+
+	while (tab != NULL)
+	{
+		_GFXCacheTable* prev = tab->prev;
+		free(tab);
+		tab = prev;
+	}
+
+	atomic_store_explicit(table, (uintptr_t)NULL, memory_order_relaxed);
+}
+
+
+/****************************
+ * Finds a structure of the given type in a pNext chain.
+ * @return NULL if not found.
+ */
+static const void* _gfx_cache_find_next(const void* pNext, VkStructureType type)
+{
+	for (
+		const VkBaseInStructure* next = pNext;
+		next != NULL;
+		next = next->pNext)
+	{
+		if (next->sType == type) return next;
+	}
+
+	return NULL;
+}
+
+/****************************
+ * Builds a hashable key value from a Vk*CreateInfo struct
  * with given replace handles for non-hashable fields.
- * @return Key value, must call free() on success (NULL on failure).
+ * @param out Outputs the used hash key builder, cannot be NULL.
+ * @param buf Cannot be NULL, buffer of _GFX_KEY_BUFFER_SIZE bytes.
+ * @return Key value, must call _gfx_hash_builder_clear(out) on success.
+ *
+ * Only allocates memory if the key does not fit in buf.
  */
-static _GFXHashKey* _gfx_cache_alloc_key(const VkStructureType* createInfo,
+static _GFXHashKey* _gfx_cache_build_key(_GFXHashBuilder* out, void* buf,
+                                         const VkStructureType* createInfo,
                                          const void** handles)
 {
+	assert(out != NULL);
+	assert(buf != NULL);
 	assert(createInfo != NULL);
 
-	// Initialize a hash key builder.
+	// Initialize a hash key builder, building in the given buffer.
 	_GFXHashBuilder builder;
-	if (!_gfx_hash_builder(&builder)) goto error;
+	_gfx_hash_builder_buf(&builder, _GFX_KEY_BUFFER_SIZE, buf);
 
 	// Based on type, push all the to-be-hashed data.
 	// Here we try to minimize the data actually necessary to specify
@@ -90,7 +308,11 @@ static _GFXHashKey* _gfx_cache_alloc_key(const VkStructureType* createInfo,
 		const VkDescriptorSetLayoutCreateInfo* dslci =
 			(const VkDescriptorSetLayoutCreateInfo*)createInfo;
 
-		// Ignore the pNext field.
+		// Only push the binding flags from the pNext field.
+		const VkDescriptorSetLayoutBindingFlagsCreateInfo* dslbfci =
+			_gfx_cache_find_next(dslci->pNext,
+				VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO);
+
 		_GFX_KEY_PUSH(dslci->flags);
 		_GFX_KEY_PUSH(dslci->bindingCount);
 
@@ -102,6 +324,13 @@ static _GFXHashKey* _gfx_cache_alloc_key(const VkStructureType* createInfo,
 			_GFX_KEY_PUSH(dslb->descriptorCount);
 			_GFX_KEY_PUSH(dslb->stageFlags);
 
+			// Insert binding flags, 0 if not given.
+			const VkDescriptorBindingFlags dbf =
+				dslbfci != NULL && dslbfci->bindingCount > 0 ?
+				dslbfci->pBindingFlags[b] : 0;
+
+			_GFX_KEY_PUSH(dbf);
+
 			// Insert bool 'has immutable samplers'.
 			temp =
 				dslb->descriptorCount > 0 &&
@@ -272,7 +501,17 @@ static _GFXHashKey* _gfx_cache_alloc_key(const VkStructureType* createInfo,
 		const VkGraphicsPipelineCreateInfo* gpci =
 			(const VkGraphicsPipelineCreateInfo*)createInfo;
 
-		// Ignore the pNext field.
+		// Only push the graphics pipeline library flags from the pNext field.
+		// Libraries to link are ignored, linked pipelines are cached under
+		// the same key as if they were not linked.
+		const VkGraphicsPipelineLibraryCreateInfoEXT* gplci =
+			_gfx_cache_find_next(gpci->pNext,
+				VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT);
+
+		const VkGraphicsPipelineLibraryFlagsEXT gplFlags =
+			gplci != NULL ? gplci->flags : 0;
+
+		_GFX_KEY_PUSH(gplFlags);
 		_GFX_KEY_PUSH(gpci->flags);
 		_GFX_KEY_PUSH(gpci->stageCount);
 
@@ -313,39 +552,54 @@ static _GFXHashKey* _gfx_cache_alloc_key(const VkStructureType* createInfo,
 			}
 		}
 
-		const VkPipelineVertexInputStateCreateInfo* pvisci = gpci->pVertexInputState;
-		// Ignore the pNext field.
-		// Ignore vertex input state flags.
-		_GFX_KEY_PUSH(pvisci->vertexBindingDescriptionCount);
+		// Insert bool 'has vertex input state'.
+		// Pipeline libraries may not have all state.
+		temp = gpci->pVertexInputState != NULL;
+		_GFX_KEY_PUSH(temp);
 
-		for (size_t b = 0; b < pvisci->vertexBindingDescriptionCount; ++b)
+		if (gpci->pVertexInputState != NULL)
 		{
-			const VkVertexInputBindingDescription* vibd =
-				pvisci->pVertexBindingDescriptions + b;
+			const VkPipelineVertexInputStateCreateInfo* pvisci = gpci->pVertexInputState;
+			// Ignore the pNext field.
+			// Ignore vertex input state flags.
+			_GFX_KEY_PUSH(pvisci->vertexBindingDescriptionCount);
 
-			_GFX_KEY_PUSH(vibd->binding);
-			_GFX_KEY_PUSH(vibd->stride);
-			_GFX_KEY_PUSH(vibd->inputRate);
-		}
+			for (size_t b = 0; b < pvisci->vertexBindingDescriptionCount; ++b)
+			{
+				const VkVertexInputBindingDescription* vibd =
+					pvisci->pVertexBindingDescriptions + b;
 
-		_GFX_KEY_PUSH(pvisci->vertexAttributeDescriptionCount);
+				_GFX_KEY_PUSH(vibd->binding);
+				_GFX_KEY_PUSH(vibd->stride);
+				_GFX_KEY_PUSH(vibd->inputRate);
+			}
 
-		for (size_t a = 0; a < pvisci->vertexAttributeDescriptionCount; ++a)
-		{
-			const VkVertexInputAttributeDescription* viad =
-				pvisci->pVertexAttributeDescriptions + a;
+			_GFX_KEY_PUSH(pvisci->vertexAttributeDescriptionCount);
+
+			for (size_t a = 0; a < pvisci->vertexAttributeDescriptionCount; ++a)
+			{
+				const VkVertexInputAttributeDescription* viad =
+					pvisci->pVertexAttributeDescriptions + a;
 
-			_GFX_KEY_PUSH(viad->location);
-			_GFX_KEY_PUSH(viad->binding);
-			_GFX_KEY_PUSH(viad->format);
-			_GFX_KEY_PUSH(viad->offset);
+				_GFX_KEY_PUSH(viad->location);
+				_GFX_KEY_PUSH(viad->binding);
+				_GFX_KEY_PUSH(viad->format);
+				_GFX_KEY_PUSH(viad->offset);
+			}
 		}
 
-		const VkPipelineInputAssemblyStateCreateInfo* piasci = gpci->pInputAssemblyState;
-		// Ignore the pNext field.
-		// Ignore input assembly state flags.
-		_GFX_KEY_PUSH(piasci->topology);
-		_GFX_KEY_PUSH(piasci->primitiveRestartEnable);
+		// Insert bool 'has input assembly state'.
+		temp = gpci->pInputAssemblyState != NULL;
+		_GFX_KEY_PUSH(temp);
+
+		if (gpci->pInputAssemblyState != NULL)
+		{
+			const VkPipelineInputAssemblyStateCreateInfo* piasci = gpci->pInputAssemblyState;
+			// Ignore the pNext field.
+			// Ignore input assembly state flags.
+			_GFX_KEY_PUSH(piasci->topology);
+			_GFX_KEY_PUSH(piasci->primitiveRestartEnable);
+		}
 
 		// Insert bool 'has tessellation state'.
 		temp = gpci->pTessellationState != NULL;
@@ -405,19 +659,26 @@ static _GFXHashKey* _gfx_cache_alloc_key(const VkStructureType* createInfo,
 				}
 		}
 
-		const VkPipelineRasterizationStateCreateInfo* prsci = gpci->pRasterizationState;
-		// Ignore the pNext field.
-		// Ignore rasterization state flags.
-		_GFX_KEY_PUSH(prsci->depthClampEnable);
-		_GFX_KEY_PUSH(prsci->rasterizerDiscardEnable);
-		_GFX_KEY_PUSH(prsci->polygonMode);
-		_GFX_KEY_PUSH(prsci->cullMode);
-		_GFX_KEY_PUSH(prsci->frontFace);
-		_GFX_KEY_PUSH(prsci->depthBiasEnable);
-		_GFX_KEY_PUSH(prsci->depthBiasConstantFactor);
-		_GFX_KEY_PUSH(prsci->depthBiasClamp);
-		_GFX_KEY_PUSH(prsci->depthBiasSlopeFactor);
-		_GFX_KEY_PUSH(prsci->lineWidth);
+		// Insert bool 'has rasterization state'.
+		temp = gpci->pRasterizationState != NULL;
+		_GFX_KEY_PUSH(temp);
+
+		if (gpci->pRasterizationState != NULL)
+		{
+			const VkPipelineRasterizationStateCreateInfo* prsci = gpci->pRasterizationState;
+			// Ignore the pNext field.
+			// Ignore rasterization state flags.
+			_GFX_KEY_PUSH(prsci->depthClampEnable);
+			_GFX_KEY_PUSH(prsci->rasterizerDiscardEnable);
+			_GFX_KEY_PUSH(prsci->polygonMode);
+			_GFX_KEY_PUSH(prsci->cullMode);
+			_GFX_KEY_PUSH(prsci->frontFace);
+			_GFX_KEY_PUSH(prsci->depthBiasEnable);
+			_GFX_KEY_PUSH(prsci->depthBiasConstantFactor);
+			_GFX_KEY_PUSH(prsci->depthBiasClamp);
+			_GFX_KEY_PUSH(prsci->depthBiasSlopeFactor);
+			_GFX_KEY_PUSH(prsci->lineWidth);
+		}
 
 		// Insert bool 'has multisample state'.
 		temp = gpci->pMultisampleState != NULL;
@@ -572,14 +833,14 @@ static _GFXHashKey* _gfx_cache_alloc_key(const VkStructureType* createInfo,
 		goto clean;
 	}
 
-	// Return the key data.
-	return _gfx_hash_builder_get(&builder);
+	// Output the builder & return the key data.
+	*out = builder;
+	return _gfx_hash_builder_key(out);
 
 
 	// Cleanup on failure.
 clean:
-	free(_gfx_hash_builder_get(&builder));
-error:
+	_gfx_hash_builder_clear(&builder);
 	gfx_log_error("Could not allocate key for cached Vulkan object.");
 
 	return NULL;
@@ -601,6 +862,7 @@ static bool _gfx_cache_create_elem(_GFXCache* cache, _GFXCacheElem* elem,
 
 	// Firstly, set type.
 	elem->type = *createInfo;
+	memset(elem->descriptors, 0, sizeof(elem->descriptors));
 
 	// Then call the appropriate create function.
 	switch (elem->type)
@@ -619,6 +881,16 @@ static bool _gfx_cache_create_elem(_GFXCache* cache, _GFXCacheElem* elem,
 			const VkDescriptorSetLayoutCreateInfo* dslci =
 				(const VkDescriptorSetLayoutCreateInfo*)createInfo;
 
+			// While we're at it, count the descriptors of each type,
+			// so descriptor pools can be sized appropriately.
+			for (uint32_t b = 0; b < dslci->bindingCount; ++b)
+				if ((size_t)dslci->pBindings[b].descriptorType <
+					_GFX_NUM_DESCRIPTOR_TYPES)
+				{
+					elem->descriptors[dslci->pBindings[b].descriptorType] +=
+						dslci->pBindings[b].descriptorCount;
+				}
+
 			VkDescriptorUpdateTemplateEntry entries[dslci->bindingCount];
 			uint32_t count = dslci->bindingCount;
 			size_t offset = 0;
@@ -652,7 +924,15 @@ static bool _gfx_cache_create_elem(_GFXCache* cache, _GFXCacheElem* elem,
 			}
 
 			// If no bindings remain, do not create an update template!
-			if (count == 0)
+			// Same for update-after-bind layouts, their sets are updated
+			// per descriptor, as they are only partially bound.
+			// And push descriptor layouts, their templates depend on the
+			// pipeline layout, so the technique creates them.
+			if (
+				count == 0 ||
+				(dslci->flags &
+					(VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT |
+					VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR)))
 			{
 				elem->vk.template = VK_NULL_HANDLE;
 				break;
@@ -732,12 +1012,51 @@ static bool _gfx_cache_create_elem(_GFXCache* cache, _GFXCacheElem* elem,
 		break;
 
 	case VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO:
-		_GFX_VK_CHECK(
-			context->vk.CreateGraphicsPipelines(context->vk.device,
-				cache->vk.cache, 1,
-				(const VkGraphicsPipelineCreateInfo*)createInfo, NULL,
-				&elem->vk.pipeline),
-			goto error);
+		{
+			const VkGraphicsPipelineCreateInfo* gpci =
+				(const VkGraphicsPipelineCreateInfo*)createInfo;
+
+			// If linking pipeline libraries, all state is taken from the
+			// libraries, so only pass what is necessary to link them.
+			VkGraphicsPipelineCreateInfo link;
+
+			if (
+				!(gpci->flags & VK_PIPELINE_CREATE_LIBRARY_BIT_KHR) &&
+				_gfx_cache_find_next(gpci->pNext,
+					VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR) != NULL)
+			{
+				link = (VkGraphicsPipelineCreateInfo){
+					.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+
+					.pNext               = gpci->pNext,
+					.flags               = gpci->flags,
+					.stageCount          = 0,
+					.pStages             = NULL,
+					.pVertexInputState   = NULL,
+					.pInputAssemblyState = NULL,
+					.pTessellationState  = NULL,
+					.pViewportState      = NULL,
+					.pRasterizationState = NULL,
+					.pMultisampleState   = NULL,
+					.pDepthStencilState  = NULL,
+					.pColorBlendState    = NULL,
+					.pDynamicState       = NULL,
+					.layout              = gpci->layout,
+					.renderPass          = gpci->renderPass,
+					.subpass             = gpci->subpass,
+					.basePipelineHandle  = VK_NULL_HANDLE,
+					.basePipelineIndex   = -1
+				};
+
+				gpci = &link;
+			}
+
+			_GFX_VK_CHECK(
+				context->vk.CreateGraphicsPipelines(context->vk.device,
+					cache->vk.cache, 1, gpci, NULL,
+					&elem->vk.pipeline),
+				goto error);
+		}
 		break;
 
 	case VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO:
@@ -826,17 +1145,27 @@ static _GFXCacheElem* _gfx_cache_get_simple(_GFXCache* cache,
 		*createInfo != VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO);
 
 	// Firstly we create a key value & hash it.
-	_GFXHashKey* key = _gfx_cache_alloc_key(createInfo, handles);
+	_Alignas(max_align_t) char buf[_GFX_KEY_BUFFER_SIZE];
+	_GFXHashBuilder builder;
+
+	_GFXHashKey* key = _gfx_cache_build_key(&builder, buf, createInfo, handles);
 	if (key == NULL) return NULL;
 
-	const uint64_t hash = cache->simple.hash(key);
+	const uint64_t hash = _gfx_hash_builder_hash(&builder);
+
+	// Nothing is ever erased from the simple cache, so we can check the
+	// lock-free table first, a hit needs no lock at all.
+	_GFXCacheElem* elem = _gfx_cache_table_search(
+		&cache->simpleTable, &cache->simple, key, hash);
+
+	if (elem != NULL) goto found;
 
 	// Here we do need to lock the simple cache, as we want the function
 	// to be reentrant. And we have a dedicated lock!
 	_gfx_mutex_lock(&cache->simpleLock);
 
 	// Try to find a matching element first.
-	_GFXCacheElem* elem = gfx_map_hsearch(&cache->simple, key, hash);
+	elem = gfx_map_hsearch(&cache->simple, key, hash);
 	if (elem == NULL)
 	{
 		// If not found, create and insert a new element.
@@ -849,11 +1178,17 @@ static _GFXCacheElem* _gfx_cache_get_simple(_GFXCache* cache,
 			gfx_map_erase(&cache->simple, elem);
 			elem = NULL;
 		}
+
+		// Only publish it to the table once it is created.
+		// If this fails it is still found in the map.
+		if (elem != NULL)
+			_gfx_cache_table_insert(&cache->simpleTable, elem, hash);
 	}
 
 	// Unlock, free data & return.
 	_gfx_mutex_unlock(&cache->simpleLock);
-	free(key);
+found:
+	_gfx_hash_builder_clear(&builder);
 	return elem;
 }
 
@@ -872,10 +1207,13 @@ static _GFXCacheElem* _gfx_cache_get_pipeline(_GFXCache* cache,
 		*createInfo == VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO);
 
 	// Again, create a key value & hash it.
-	_GFXHashKey* key = _gfx_cache_alloc_key(createInfo, handles);
+	_Alignas(max_align_t) char buf[_GFX_KEY_BUFFER_SIZE];
+	_GFXHashBuilder builder;
+
+	_GFXHashKey* key = _gfx_cache_build_key(&builder, buf, createInfo, handles);
 	if (key == NULL) return NULL;
 
-	const uint64_t hash = cache->immutable.hash(key);
+	const uint64_t hash = _gfx_hash_builder_hash(&builder);
 
 	// First we check the immutable cache.
 	// This function does not need to run concurrent with _gfx_cache_warmup
@@ -884,10 +1222,10 @@ static _GFXCacheElem* _gfx_cache_get_pipeline(_GFXCache* cache,
 	if (elem != NULL) goto found;
 
 	// If not found in the immutable cache, check the mutable cache.
-	// For this lookup we obviously do lock.
-	_gfx_mutex_lock(&cache->lookupLock);
-	elem = gfx_map_hsearch(&cache->mutable, key, hash);
-	_gfx_mutex_unlock(&cache->lookupLock);
+	// Its lock-free table only ever gets inserted into until flushed,
+	// so no need to lock for this lookup either.
+	elem = _gfx_cache_table_search(
+		&cache->mutableTable, &cache->mutable, key, hash);
 
 	if (elem != NULL) goto found;
 
@@ -917,7 +1255,7 @@ static _GFXCacheElem* _gfx_cache_get_pipeline(_GFXCache* cache,
 	{
 		// Uh oh failed to create :(
 		_gfx_mutex_unlock(&cache->createLock);
-		free(key);
+		_gfx_hash_builder_clear(&builder);
 		return NULL;
 	}
 
@@ -930,19 +1268,25 @@ static _GFXCacheElem* _gfx_cache_get_pipeline(_GFXCache* cache,
 		&cache->mutable, &newElem, _gfx_hash_size(key), key, hash);
 
 	_gfx_mutex_unlock(&cache->lookupLock);
+
+	// Then publish it to the lock-free table, still locked for creation.
+	// If this fails it is still found in the map.
+	if (elem != NULL)
+		_gfx_cache_table_insert(&cache->mutableTable, elem, hash);
+
 	_gfx_mutex_unlock(&cache->createLock);
 
 	if (elem != NULL) goto found;
 
 	// Ah, well, it is not in the map, away with it then...
 	_gfx_cache_destroy_elem(cache, &newElem);
-	free(key);
+	_gfx_hash_builder_clear(&builder);
 	return NULL;
 
 
 	// Free data & return when found.
 found:
-	free(key);
+	_gfx_hash_builder_clear(&builder);
 	return elem;
 }
 
@@ -985,11 +1329,16 @@ bool _gfx_cache_init(_GFXCache* cache, _GFXDevice* device, size_t templateStride
 
 	// Initialize the hashtables.
 	gfx_map_init(&cache->simple,
-		sizeof(_GFXCacheElem), _gfx_hash_murmur3, _gfx_hash_cmp);
+		sizeof(_GFXCacheElem), _gfx_hash_xxh64, _gfx_hash_cmp);
 	gfx_map_init(&cache->immutable,
-		sizeof(_GFXCacheElem), _gfx_hash_murmur3, _gfx_hash_cmp);
+		sizeof(_GFXCacheElem), _gfx_hash_xxh64, _gfx_hash_cmp);
 	gfx_map_init(&cache->mutable,
-		sizeof(_GFXCacheElem), _gfx_hash_murmur3, _gfx_hash_cmp);
+		sizeof(_GFXCacheElem), _gfx_hash_xxh64, _gfx_hash_cmp);
+
+	cache->stored = 0;
+
+	atomic_store_explicit(&cache->simpleTable, (uintptr_t)NULL, memory_order_relaxed);
+	atomic_store_explicit(&cache->mutableTable, (uintptr_t)NULL, memory_order_relaxed);
 
 	return 1;
 
@@ -1044,6 +1393,9 @@ void _gfx_cache_clear(_GFXCache* cache)
 		context->vk.device, cache->vk.cache, NULL);
 
 	// Clear all other things.
+	_gfx_cache_table_clear(&cache->simpleTable);
+	_gfx_cache_table_clear(&cache->mutableTable);
+
 	gfx_map_clear(&cache->simple);
 	gfx_map_clear(&cache->immutable);
 	gfx_map_clear(&cache->mutable);
@@ -1059,7 +1411,14 @@ bool _gfx_cache_flush(_GFXCache* cache)
 	assert(cache != NULL);
 
 	// No need to lock anything, we just merge the tables.
-	return gfx_map_merge(&cache->immutable, &cache->mutable);
+	// Nodes keep their address, so on failure the lock-free table of the
+	// mutable cache is still valid, otherwise it is empty now.
+	if (!gfx_map_merge(&cache->immutable, &cache->mutable))
+		return 0;
+
+	_gfx_cache_table_clear(&cache->mutableTable);
+
+	return 1;
 }
 
 /****************************/
@@ -1070,15 +1429,51 @@ _GFXCacheElem* _gfx_cache_get(_GFXCache* cache,
 	assert(cache != NULL);
 	assert(createInfo != NULL);
 
+	gfx_trace_begin(get, "_gfx_cache_get");
+
 	// Just route to the correct cache.
 	const bool isPipeline =
 		*createInfo == VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO ||
 		*createInfo == VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
 
-	if (isPipeline)
-		return _gfx_cache_get_pipeline(cache, createInfo, handles);
-	else
-		return _gfx_cache_get_simple(cache, createInfo, handles);
+	_GFXCacheElem* elem = isPipeline ?
+		_gfx_cache_get_pipeline(cache, createInfo, handles) :
+		_gfx_cache_get_simple(cache, createInfo, handles);
+
+	gfx_trace_end(get);
+
+	return elem;
+}
+
+/****************************/
+_GFXCacheElem* _gfx_cache_lookup(_GFXCache* cache,
+                                 const VkStructureType* createInfo,
+                                 const void** handles)
+{
+	assert(cache != NULL);
+	assert(createInfo != NULL);
+	assert(
+		*createInfo == VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO ||
+		*createInfo == VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO);
+
+	// Create a key value & hash it.
+	_Alignas(max_align_t) char buf[_GFX_KEY_BUFFER_SIZE];
+	_GFXHashBuilder builder;
+
+	_GFXHashKey* key = _gfx_cache_build_key(&builder, buf, createInfo, handles);
+	if (key == NULL) return NULL;
+
+	const uint64_t hash = _gfx_hash_builder_hash(&builder);
+
+	// Check the immutable cache, then the mutable cache, both without locking.
+	// Same as _gfx_cache_get_pipeline, except we never create.
+	_GFXCacheElem* elem = gfx_map_hsearch(&cache->immutable, key, hash);
+	if (elem == NULL)
+		elem = _gfx_cache_table_search(
+			&cache->mutableTable, &cache->mutable, key, hash);
+
+	_gfx_hash_builder_clear(&builder);
+	return elem;
 }
 
 /****************************/
@@ -1093,10 +1488,13 @@ bool _gfx_cache_warmup(_GFXCache* cache,
 		*createInfo == VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO);
 
 	// Create a key value & hash it.
-	_GFXHashKey* key = _gfx_cache_alloc_key(createInfo, handles);
+	_Alignas(max_align_t) char buf[_GFX_KEY_BUFFER_SIZE];
+	_GFXHashBuilder builder;
+
+	_GFXHashKey* key = _gfx_cache_build_key(&builder, buf, createInfo, handles);
 	if (key == NULL) return 0;
 
-	const uint64_t hash = cache->immutable.hash(key);
+	const uint64_t hash = _gfx_hash_builder_hash(&builder);
 
 	// Here we do need to lock the immutable cache, as we want the function
 	// to be reentrant. However we have no dedicated lock.
@@ -1129,267 +1527,367 @@ bool _gfx_cache_warmup(_GFXCache* cache,
 				_gfx_mutex_unlock(&cache->lookupLock);
 			}
 
-			free(key);
+			_gfx_hash_builder_clear(&builder);
 			return 0;
 		}
 	}
 
 	// Free data & return.
-	free(key);
+	_gfx_hash_builder_clear(&builder);
 	return 1;
 }
 
-/****************************/
-bool _gfx_cache_load(_GFXCache* cache, const GFXReader* src)
+/****************************
+ * Packs the groufix pipeline cache header for the current device.
+ * @param out Cannot be NULL, must be _GFX_HEADER_SIZE bytes.
+ */
+static void _gfx_cache_pack_header(_GFXCache* cache, char* out)
 {
-	assert(_groufix.vk.instance != NULL);
-	assert(cache != NULL);
-	assert(src != NULL);
+	VkPhysicalDeviceProperties pdp;
+	_groufix.vk.GetPhysicalDeviceProperties(cache->vk.device, &pdp);
+
+	const _GFXPipelineCacheHeader header = {
+		.magic         = _GFX_HEADER_MAGIC,
+		.version       = _GFX_HEADER_VERSION,
+		.vendorID      = pdp.vendorID,
+		.deviceID      = pdp.deviceID,
+		.driverVersion = pdp.driverVersion,
+		.driverABI     = (uint32_t)sizeof(void*)
+	};
 
-	_GFXContext* context = cache->context;
+	memcpy(out, &header.magic, sizeof(header.magic));
+	out += sizeof(header.magic);
+	memcpy(out, &header.version, sizeof(header.version));
+	out += sizeof(header.version);
+	memcpy(out, &header.vendorID, sizeof(header.vendorID));
+	out += sizeof(header.vendorID);
+	memcpy(out, &header.deviceID, sizeof(header.deviceID));
+	out += sizeof(header.deviceID);
+	memcpy(out, &header.driverVersion, sizeof(header.driverVersion));
+	out += sizeof(header.driverVersion);
+	memcpy(out, &header.driverABI, sizeof(header.driverABI));
+	out += sizeof(header.driverABI);
+	memcpy(out, pdp.pipelineCacheUUID, sizeof(header.uuid));
+}
 
-	// We use a hash key builder for pipeline caches too :o
-	_GFXHashBuilder builder;
-	if (!_gfx_hash_builder(&builder)) return 0;
+/****************************
+ * Loads groufix pipeline cache data from memory.
+ * @param data Cannot be NULL, must be aligned to _GFX_CHUNK_ALIGN bytes.
+ * @see _gfx_cache_load.
+ */
+static bool _gfx_cache_load_data(_GFXCache* cache, size_t len, const char* data)
+{
+	_GFXContext* context = cache->context;
 
-	// Then stick empty data in it big enough for the source.
-	long long len = gfx_io_len(src);
-	if (len <= 0)
+	// What's this, not even a header >:(
+	if (len < _GFX_HEADER_SIZE)
 	{
 		gfx_log_error(
-			"Zero or unknown stream length, cannot load pipeline cache.");
+			"Could not load pipeline cache; "
+			"groufix header is incomplete.");
 
-		free(_gfx_hash_builder_get(&builder));
 		return 0;
 	}
 
-	void* bData = _gfx_hash_builder_push(&builder, (size_t)len, NULL);
-	if (bData == NULL)
-	{
-		gfx_log_error(
-			"Could not allocate buffer to load pipeline cache.");
-
-		free(_gfx_hash_builder_get(&builder));
-		return 0;
-	}
+	// Validate the header by comparing it to our own.
+	// This validates the version, device UUID and driver version.
+	char header[_GFX_HEADER_SIZE];
+	_gfx_cache_pack_header(cache, header);
 
-	// Read cache data.
-	len = gfx_io_read(src, bData, (size_t)len);
-	if (len <= 0)
+	if (memcmp(header, data, _GFX_HEADER_SIZE) != 0)
 	{
 		gfx_log_error(
-			"Could not read pipeline cache from stream.");
+			"Could not load pipeline cache; "
+			"data is of a different version or device.");
 
-		free(_gfx_hash_builder_get(&builder));
 		return 0;
 	}
 
-	// Claim builder data & unpack the groufix header.
-	_GFXHashKey* key = _gfx_hash_builder_get(&builder);
-	key->len = (size_t)len; // In case of shorter read.
-
-	_GFXPipelineCacheHeader header;
-	const size_t headerSize =
-		sizeof(header.magic) + sizeof(header.dataSize) +
-		sizeof(header.dataHash) + sizeof(header.vendorID) +
-		sizeof(header.deviceID) + sizeof(header.driverVersion) +
-		sizeof(header.driverABI) + sizeof(header.uuid);
+	// Merge all chunks.
+	// Stop at the first invalid chunk, as this is most likely an
+	// interrupted write and all chunks before it are still fine.
+	size_t pos = GFX_ALIGN_UP(_GFX_HEADER_SIZE, _GFX_CHUNK_ALIGN);
+	size_t chunks = 0;
 
-	// What's this, not even a header >:(
-	if (key->len < headerSize)
+	while (pos < len)
 	{
-		gfx_log_error(
-			"Could not load pipeline cache; "
-			"groufix header is incomplete.");
+		_GFXPipelineCacheChunk chunk;
 
-		free(key);
-		return 0;
-	}
+		if (len - pos < _GFX_CHUNK_HEADER_SIZE)
+			goto invalid;
 
-	const uint64_t emptyHash = 0;
-	char* head = key->bytes;
-
-	memcpy(&header.magic, head, sizeof(header.magic));
-	head += sizeof(header.magic);
-	memcpy(&header.dataSize, head, sizeof(header.dataSize));
-	head += sizeof(header.dataSize);
-	memcpy(&header.dataHash, head, sizeof(header.dataHash));
-	// Set dataHash to 0 in the received data so we can hash & compare it :)
-	memcpy(head, &emptyHash, sizeof(header.dataHash));
-	head += sizeof(header.dataHash);
-	memcpy(&header.vendorID, head, sizeof(header.vendorID));
-	head += sizeof(header.vendorID);
-	memcpy(&header.deviceID, head, sizeof(header.deviceID));
-	head += sizeof(header.deviceID);
-	memcpy(&header.driverVersion, head, sizeof(header.driverVersion));
-	head += sizeof(header.driverVersion);
-	memcpy(&header.driverABI, head, sizeof(header.driverABI));
-	head += sizeof(header.driverABI);
-	memcpy(header.uuid, head, sizeof(header.uuid));
-	head += sizeof(header.uuid);
-
-	// Validate the received data.
-	{
-		// Get allocation limit in a scope so pdp gets freed :)
-		VkPhysicalDeviceProperties pdp;
-		_groufix.vk.GetPhysicalDeviceProperties(cache->vk.device, &pdp);
+		memcpy(&chunk.dataSize, data + pos, sizeof(chunk.dataSize));
+		pos += sizeof(chunk.dataSize);
+		memcpy(&chunk.dataHash, data + pos, sizeof(chunk.dataHash));
+		pos += sizeof(chunk.dataHash);
 
 		if (
-			header.magic != _GFX_HEADER_MAGIC ||
-			header.dataSize != key->len ||
-			header.dataHash != _gfx_hash_murmur3(key) ||
-			header.vendorID != pdp.vendorID ||
-			header.deviceID != pdp.deviceID ||
-			header.driverVersion != pdp.driverVersion ||
-			header.driverABI != (uint32_t)sizeof(void*) ||
-			memcmp(header.uuid, pdp.pipelineCacheUUID, sizeof(header.uuid)) != 0)
+			chunk.dataSize > len - pos ||
+			chunk.dataHash != _gfx_hash_murmur3_bytes(
+				(size_t)chunk.dataSize, data + pos))
 		{
-			gfx_log_error(
-				"Could not load pipeline cache; "
-				"data is invalid or incompatible.");
-
-			free(key);
-			return 0;
+			goto invalid;
 		}
-	}
 
-	// Create a temporary Vulkan pipeline cache.
-	VkPipelineCacheCreateInfo pcci = {
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		// Create a temporary Vulkan pipeline cache & merge it.
+		VkPipelineCacheCreateInfo pcci = {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
 
-		.pNext           = NULL,
-		.flags           = 0,
-		.initialDataSize = key->len - headerSize,
-		.pInitialData    = head
-	};
+			.pNext           = NULL,
+			.flags           = 0,
+			.initialDataSize = (size_t)chunk.dataSize,
+			.pInitialData    = data + pos
+		};
 
-	VkPipelineCache vkCache;
-	_GFX_VK_CHECK(
-		context->vk.CreatePipelineCache(
-			context->vk.device, &pcci, NULL, &vkCache),
-		{
-			gfx_log_error("Failed to load pipeline cache.");
+		VkPipelineCache vkCache;
+		_GFX_VK_CHECK(
+			context->vk.CreatePipelineCache(
+				context->vk.device, &pcci, NULL, &vkCache),
+			goto error);
 
-			free(key);
-			return 0;
-		});
+		_GFX_VK_CHECK(
+			context->vk.MergePipelineCaches(
+				context->vk.device, cache->vk.cache, 1, &vkCache),
+			{
+				context->vk.DestroyPipelineCache(
+					context->vk.device, vkCache, NULL);
+				goto error;
+			});
 
-	free(key);
+		context->vk.DestroyPipelineCache(
+			context->vk.device, vkCache, NULL);
 
-	// And finally, merge the temporary pipeline & destroy it.
-	bool success = 1;
+		pos += GFX_MIN(len - pos,
+			GFX_ALIGN_UP((size_t)chunk.dataSize, _GFX_CHUNK_ALIGN));
 
-	_GFX_VK_CHECK(
-		context->vk.MergePipelineCaches(
-			context->vk.device, cache->vk.cache, 1, &vkCache),
-		{
-			gfx_log_error("Failed to merge pipeline cache.");
-			success = 0;
-		});
+		++chunks;
+		continue;
 
-	context->vk.DestroyPipelineCache(
-		context->vk.device, vkCache, NULL);
+	invalid:
+		gfx_log_warn(
+			"Pipeline cache chunk %"GFX_PRIs" is incomplete or corrupt, "
+			"ignoring it and all following chunks.",
+			chunks);
+
+		break;
+	}
+
+	// Remember how big the Vulkan cache is, so we know when to save.
+	_GFX_VK_CHECK(context->vk.GetPipelineCacheData(
+		context->vk.device, cache->vk.cache, &cache->stored, NULL),
+		cache->stored = 0);
 
 	// Some victory logs c:
-	if (success)
-		gfx_log_info(
-			"Successfully loaded groufix pipeline cache:\n"
-			"    Input size: %"GFX_PRIs" bytes.\n",
-			key->len);
+	gfx_log_info(
+		"Successfully loaded groufix pipeline cache:\n"
+		"    Input size: %"GFX_PRIs" bytes.\n"
+		"    #chunks: %"GFX_PRIs".\n",
+		len, chunks);
 
-	return success;
+	return 1;
+
+
+	// Error on failure.
+error:
+	gfx_log_error("Failed to load pipeline cache.");
+
+	return 0;
 }
 
-/****************************/
-bool _gfx_cache_store(_GFXCache* cache, const GFXWriter* dst)
+/****************************
+ * Writes the groufix header and the current Vulkan pipeline cache data
+ * as a single chunk.
+ * @see _gfx_cache_store.
+ */
+static bool _gfx_cache_write(_GFXCache* cache, const GFXWriter* dst)
 {
-	assert(_groufix.vk.instance != NULL);
-	assert(cache != NULL);
-	assert(dst != NULL);
-
 	_GFXContext* context = cache->context;
 
-	// Again with the hash key builder c:
-	_GFXHashBuilder builder;
-	if (!_gfx_hash_builder(&builder)) return 0;
+	// Get the size of the pipeline cache.
+	// Then allocate a big enough chunk for the cache data & get the data.
+	// Allocate the chunk header & padding in front and back of it.
+	const size_t headerSize =
+		GFX_ALIGN_UP(_GFX_HEADER_SIZE, _GFX_CHUNK_ALIGN);
 
-	// Create & push a groufix header, needs to be packed!
-	// Given this function follows the same makeup as _gfx_cache_alloc_key,
-	// we are very much going to abuse the _GFX_KEY_PUSH macro.
-	const uint32_t magic = _GFX_HEADER_MAGIC;
-	const uint32_t emptySize = 0;
-	const uint64_t emptyHash = 0;
-	const uint32_t driverABI = (uint32_t)sizeof(void*);
+	size_t vkSize;
+	_GFX_VK_CHECK(context->vk.GetPipelineCacheData(
+		context->vk.device, cache->vk.cache, &vkSize, NULL), goto error);
 
-	_GFX_KEY_PUSH(magic);
-	_GFX_KEY_PUSH(emptySize);
-	_GFX_KEY_PUSH(emptyHash);
+	const size_t size =
+		headerSize + _GFX_CHUNK_HEADER_SIZE +
+		GFX_ALIGN_UP(vkSize, _GFX_CHUNK_ALIGN);
 
-	{
-		// Get allocation limit in a scope so pdp gets freed :)
-		VkPhysicalDeviceProperties pdp;
-		_groufix.vk.GetPhysicalDeviceProperties(cache->vk.device, &pdp);
+	char* bData = calloc(1, size);
+	if (bData == NULL) goto error;
 
-		_GFX_KEY_PUSH(pdp.vendorID);
-		_GFX_KEY_PUSH(pdp.deviceID);
-		_GFX_KEY_PUSH(pdp.driverVersion);
-		_GFX_KEY_PUSH(driverABI);
+	char* vkData = bData + headerSize + _GFX_CHUNK_HEADER_SIZE;
 
-		if (!_gfx_hash_builder_push(
-			&builder, sizeof(pdp.pipelineCacheUUID), pdp.pipelineCacheUUID))
+	_GFX_VK_CHECK(context->vk.GetPipelineCacheData(
+		context->vk.device, cache->vk.cache, &vkSize, vkData),
 		{
-			goto clean;
-		}
-	}
+			free(bData);
+			goto error;
+		});
 
-	// Get the size of the pipeline cache.
-	// Then push a big enough chunk for the cache data & get the data.
-	size_t vkSize;
-	_GFX_VK_CHECK(context->vk.GetPipelineCacheData(
-		context->vk.device, cache->vk.cache, &vkSize, NULL), goto clean);
+	// Pack the headers, data hash is computed over the Vulkan data only.
+	const _GFXPipelineCacheChunk chunk = {
+		.dataSize = (uint64_t)vkSize,
+		.dataHash = _gfx_hash_murmur3_bytes(vkSize, vkData)
+	};
 
-	void* bData = _gfx_hash_builder_push(&builder, vkSize, NULL);
-	if (bData == NULL) goto clean;
+	_gfx_cache_pack_header(cache, bData);
 
-	_GFX_VK_CHECK(context->vk.GetPipelineCacheData(
-		context->vk.device, cache->vk.cache, &vkSize, bData), goto clean);
-
-	// Claim builder data.
-	// Set its `dataSize` so we can hash.
-	_GFXHashKey* key = _gfx_hash_builder_get(&builder);
-	memcpy(
-		(uint32_t*)key->bytes + 1, // Right after `magic`.
-		&key->len,
-		sizeof(uint32_t));
-
-	// Then hash while `dataHash` is 0 and set it afterwards
-	const uint64_t hash = _gfx_hash_murmur3(key);
-	memcpy(
-		(uint32_t*)key->bytes + 2, // Right after `dataSize`.
-		&hash,
-		sizeof(uint64_t));
-
-	// Stream out the data.
-	if (gfx_io_write(dst, key->bytes, key->len) <= 0)
+	memcpy(bData + headerSize,
+		&chunk.dataSize, sizeof(chunk.dataSize));
+	memcpy(bData + headerSize + sizeof(chunk.dataSize),
+		&chunk.dataHash, sizeof(chunk.dataHash));
+
+	// Stream out the data, padding included.
+	if (gfx_io_write(dst, bData, size) <= 0)
 	{
 		gfx_log_error("Could not write pipeline cache to stream.");
-		free(key);
+		free(bData);
 		return 0;
 	}
 
+	free(bData);
+	cache->stored = vkSize;
+
 	// Yey we did it!
 	gfx_log_info(
 		"Written groufix pipeline cache to stream (%"GFX_PRIs" bytes).",
-		key->len);
+		size);
 
-	free(key);
 	return 1;
 
 
 	// Cleanup on failure.
-clean:
+error:
 	gfx_log_error("Failed to store pipeline cache.");
 
-	free(_gfx_hash_builder_get(&builder));
+	return 0;
+}
+
+/****************************/
+bool _gfx_cache_load(_GFXCache* cache, const GFXReader* src)
+{
+	assert(_groufix.vk.instance != NULL);
+	assert(cache != NULL);
+	assert(src != NULL);
+
+	long long len = gfx_io_len(src);
+	if (len <= 0)
+	{
+		gfx_log_error(
+			"Zero or unknown stream length, cannot load pipeline cache.");
+
+		return 0;
+	}
+
+	// If the stream gives direct access to its data (e.g. a memory mapped
+	// file), read straight from it, no need to copy anything.
+	const void* data = gfx_io_data(src);
+	if (data != NULL && ((uintptr_t)data % _GFX_CHUNK_ALIGN) == 0)
+		return _gfx_cache_load_data(cache, (size_t)len, data);
+
+	// Otherwise read it into a buffer first.
+	void* bData = malloc((size_t)len);
+	if (bData == NULL)
+	{
+		gfx_log_error(
+			"Could not allocate buffer to load pipeline cache.");
+
+		return 0;
+	}
+
+	len = gfx_io_read(src, bData, (size_t)len);
+	if (len <= 0)
+	{
+		gfx_log_error(
+			"Could not read pipeline cache from stream.");
+
+		free(bData);
+		return 0;
+	}
+
+	const bool success = _gfx_cache_load_data(cache, (size_t)len, bData);
+	free(bData);
+
+	return success;
+}
+
+/****************************/
+bool _gfx_cache_store(_GFXCache* cache, const GFXWriter* dst)
+{
+	assert(_groufix.vk.instance != NULL);
+	assert(cache != NULL);
+	assert(dst != NULL);
+
+	// Write the header and a single chunk with all data.
+	return _gfx_cache_write(cache, dst);
+}
+
+/****************************/
+bool _gfx_cache_save(_GFXCache* cache, const char* path)
+{
+	assert(_groufix.vk.instance != NULL);
+	assert(cache != NULL);
+	assert(path != NULL);
+
+	_GFXContext* context = cache->context;
+
+	// The Vulkan cache only grows when something was added, so if the
+	// size did not change since the last load or store, nothing is new.
+	size_t vkSize;
+	_GFX_VK_CHECK(context->vk.GetPipelineCacheData(
+		context->vk.device, cache->vk.cache, &vkSize, NULL),
+		goto error);
+
+	if (vkSize == cache->stored)
+		return 1;
+
+	// Write to a temporary file first, then move it into place,
+	// so the file always holds complete data and never grows.
+	// Its name is unique to this process & save, so concurrent saves
+	// (from any process) never write to the same temporary file.
+	char* tmp = malloc(strlen(path) + 48);
+	if (tmp == NULL)
+		goto error;
+
+	sprintf(tmp, "%s.%"PRIuMAX".%"PRIuMAX".tmp",
+		path, _gfx_process_id(), atomic_fetch_add(&_gfx_cache_tmp, 1));
+
+	GFXFile file;
+	bool written = gfx_file_init(&file, tmp, "wb");
+
+	if (written)
+	{
+		written = _gfx_cache_write(cache, &file.writer);
+		gfx_file_clear(&file);
+	}
+
+	// Rename may not overwrite on all platforms,
+	// only remove the old file if it did not.
+	if (written && rename(tmp, path) != 0)
+	{
+		remove(path);
+		written = rename(tmp, path) == 0;
+	}
+
+	if (!written)
+		remove(tmp);
+
+	free(tmp);
+
+	if (!written)
+		goto error;
+
+	return 1;
+
+
+	// Error on failure.
+error:
+	gfx_log_error("Failed to save pipeline cache to file: %s.", path);
+
 	return 0;
 }
@@ -8,6 +8,7 @@
 
 #include "groufix/core/mem.h"
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 
 #if defined (GFX_WIN32)
@@ -18,15 +19,134 @@
 // 'Randomized' hash seed (generated on the web).
 #define _GFX_HASH_SEED ((uint32_t)0x4ac093e6)
 
+// xxHash (64 bits) primes.
+#define _GFX_XXH_P1 ((uint64_t)0x9e3779b185ebca87)
+#define _GFX_XXH_P2 ((uint64_t)0xc2b2ae3d27d4eb4f)
+#define _GFX_XXH_P3 ((uint64_t)0x165667b19e3779f9)
+#define _GFX_XXH_P4 ((uint64_t)0x85ebca77c2b2ae63)
+#define _GFX_XXH_P5 ((uint64_t)0x27d4eb2f165667c5)
+
 
 // Platform agnostic rotl.
 #if defined (GFX_WIN32)
 	#define _GFX_ROTL32(x, r) _rotl(x, r)
+	#define _GFX_ROTL64(x, r) _rotl64(x, r)
 #else
 	#define _GFX_ROTL32(x, r) ((x << r) | (x >> (32 - r)))
+	#define _GFX_ROTL64(x, r) ((x << r) | (x >> (64 - r)))
 #endif
 
 
+/****************************
+ * Reads (unaligned) 8 and 4 bytes.
+ */
+static inline uint64_t _gfx_read64(const char* p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint32_t _gfx_read32(const char* p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+/****************************
+ * Single xxHash lane round.
+ */
+static inline uint64_t _gfx_xxh64_round(uint64_t acc, uint64_t lane)
+{
+	acc += lane * _GFX_XXH_P2;
+	acc = _GFX_ROTL64(acc, 31);
+	return acc * _GFX_XXH_P1;
+}
+
+/****************************
+ * Initializes the four xxHash lane accumulators.
+ */
+static void _gfx_xxh64_init(uint64_t acc[4])
+{
+	acc[0] = _GFX_HASH_SEED + _GFX_XXH_P1 + _GFX_XXH_P2;
+	acc[1] = _GFX_HASH_SEED + _GFX_XXH_P2;
+	acc[2] = _GFX_HASH_SEED;
+	acc[3] = _GFX_HASH_SEED - _GFX_XXH_P1;
+}
+
+/****************************
+ * Hashes a number of whole _GFX_HASH_STRIPE byte stripes.
+ * The four lanes are independent, so they run in parallel on any modern CPU.
+ */
+static void _gfx_xxh64_stripes(uint64_t acc[4], size_t num, const char* p)
+{
+	static_assert(_GFX_HASH_STRIPE == 32, "xxHash stripes must be 32 bytes.");
+
+	uint64_t a0 = acc[0], a1 = acc[1], a2 = acc[2], a3 = acc[3];
+
+	for (; num; --num, p += _GFX_HASH_STRIPE)
+		a0 = _gfx_xxh64_round(a0, _gfx_read64(p + 0)),
+		a1 = _gfx_xxh64_round(a1, _gfx_read64(p + 8)),
+		a2 = _gfx_xxh64_round(a2, _gfx_read64(p + 16)),
+		a3 = _gfx_xxh64_round(a3, _gfx_read64(p + 24));
+
+	acc[0] = a0, acc[1] = a1, acc[2] = a2, acc[3] = a3;
+}
+
+/****************************
+ * Finalizes an xxHash from its accumulators and the remaining tail.
+ * @param len  Total length of the hashed data.
+ * @param tail The last (len % _GFX_HASH_STRIPE) bytes of the data.
+ */
+static uint64_t _gfx_xxh64_final(const uint64_t acc[4],
+                                 size_t len, const char* tail)
+{
+	uint64_t h;
+
+	// Merge the lanes if at least one stripe was hashed.
+	if (len >= _GFX_HASH_STRIPE)
+	{
+		h =
+			_GFX_ROTL64(acc[0], 1) + _GFX_ROTL64(acc[1], 7) +
+			_GFX_ROTL64(acc[2], 12) + _GFX_ROTL64(acc[3], 18);
+
+		for (size_t l = 0; l < 4; ++l)
+			h ^= _gfx_xxh64_round(0, acc[l]),
+			h = h * _GFX_XXH_P1 + _GFX_XXH_P4;
+	}
+	else
+		h = _GFX_HASH_SEED + _GFX_XXH_P5;
+
+	h += (uint64_t)len;
+
+	// Process the tail bytes.
+	size_t rem = len % _GFX_HASH_STRIPE;
+
+	for (; rem >= 8; rem -= 8, tail += 8)
+		h ^= _gfx_xxh64_round(0, _gfx_read64(tail)),
+		h = _GFX_ROTL64(h, 27) * _GFX_XXH_P1 + _GFX_XXH_P4;
+
+	if (rem >= 4)
+		h ^= (uint64_t)_gfx_read32(tail) * _GFX_XXH_P1,
+		h = _GFX_ROTL64(h, 23) * _GFX_XXH_P2 + _GFX_XXH_P3,
+		rem -= 4, tail += 4;
+
+	for (; rem; --rem, ++tail)
+		h ^= (uint64_t)(uint8_t)*tail * _GFX_XXH_P5,
+		h = _GFX_ROTL64(h, 11) * _GFX_XXH_P1;
+
+	// Avalanche.
+	h ^= h >> 33;
+	h *= _GFX_XXH_P2;
+	h ^= h >> 29;
+	h *= _GFX_XXH_P3;
+	h ^= h >> 32;
+
+	return h;
+}
+
+
 /****************************/
 int _gfx_hash_cmp(const void* l, const void* r)
 {
@@ -38,12 +158,31 @@ int _gfx_hash_cmp(const void* l, const void* r)
 }
 
 /****************************/
-uint64_t _gfx_hash_murmur3(const void* key)
+uint64_t _gfx_hash_xxh64(const void* key)
+{
+	const _GFXHashKey* cKey = key;
+	return _gfx_hash_xxh64_bytes(cKey->len, cKey->bytes);
+}
+
+/****************************/
+uint64_t _gfx_hash_xxh64_bytes(size_t len, const void* bytes)
+{
+	const size_t num = len / _GFX_HASH_STRIPE;
+
+	uint64_t acc[4];
+	_gfx_xxh64_init(acc);
+	_gfx_xxh64_stripes(acc, num, bytes);
+
+	return _gfx_xxh64_final(acc, len,
+		(const char*)bytes + num * _GFX_HASH_STRIPE);
+}
+
+/****************************/
+uint64_t _gfx_hash_murmur3_bytes(size_t len, const void* bytes)
 {
 	static_assert(sizeof(uint32_t) == 4, "MurmurHash3 blocks must be 4 bytes.");
 
-	const _GFXHashKey* cKey = key;
-	const size_t nblocks = cKey->len / sizeof(uint32_t);
+	const size_t nblocks = len / sizeof(uint32_t);
 
 	uint32_t h = _GFX_HASH_SEED;
 
@@ -51,7 +190,7 @@ uint64_t _gfx_hash_murmur3(const void* key)
 	const uint32_t c2 = 0x1b873593;
 
 	// Process the body in blocks of 4 bytes.
-	const uint32_t* body = (const uint32_t*)cKey->bytes + nblocks;
+	const uint32_t* body = (const uint32_t*)bytes + nblocks;
 
 	for (size_t i = nblocks; i; --i)
 	{
@@ -71,7 +210,7 @@ uint64_t _gfx_hash_murmur3(const void* key)
 
 	uint32_t k = 0;
 
-	switch (cKey->len & 3)
+	switch (len & 3)
 	{
 	case 3:
 		k ^= (uint32_t)tail[2] << 16;
@@ -88,7 +227,7 @@ uint64_t _gfx_hash_murmur3(const void* key)
 	}
 
 	// Finalize.
-	h ^= (uint32_t)cKey->len;
+	h ^= (uint32_t)len;
 
 	h ^= h >> 16;
 	h *= 0x85ebca6b;
@@ -108,6 +247,11 @@ bool _gfx_hash_builder(_GFXHashBuilder* builder)
 	// so we build it in a vector and claim its memory afterwards.
 	// Initialize with a _GFXHashKey as header.
 	gfx_vec_init(&builder->out, 1);
+	builder->buf = NULL;
+	builder->size = 0;
+	builder->capacity = 0;
+	builder->hashed = 0;
+	_gfx_xxh64_init(builder->acc);
 
 	if (gfx_vec_push(&builder->out, sizeof(_GFXHashKey), NULL))
 		return 1;
@@ -121,6 +265,18 @@ _GFXHashKey* _gfx_hash_builder_get(_GFXHashBuilder* builder)
 {
 	assert(builder != NULL);
 
+	// Still in the fixed buffer, copy it to new memory.
+	if (builder->buf != NULL)
+	{
+		_GFXHashKey* key = gfx_malloc(builder->size);
+		if (key == NULL) return NULL;
+
+		memcpy(key, builder->buf, builder->size);
+		key->len = builder->size - sizeof(_GFXHashKey);
+
+		return key;
+	}
+
 	// Claim data, set length & return.
 	const size_t len = builder->out.size - sizeof(_GFXHashKey);
 	_GFXHashKey* key = gfx_vec_claim(&builder->out); // Implicitly clears.
@@ -128,3 +284,104 @@ _GFXHashKey* _gfx_hash_builder_get(_GFXHashBuilder* builder)
 
 	return key;
 }
+
+/****************************/
+void* _gfx_hash_builder_push_buf(_GFXHashBuilder* b, size_t s, const void* d)
+{
+	assert(b != NULL);
+	assert(b->buf != NULL);
+
+	// Fits in the fixed buffer, just copy.
+	if (s <= b->capacity - b->size)
+	{
+		void* ptr = b->buf + b->size;
+		if (d != NULL) memcpy(ptr, d, s);
+		b->size += s;
+
+		return ptr;
+	}
+
+	// Otherwise move everything to the vector and stop using the buffer.
+	if (!gfx_vec_push(&b->out, b->size, b->buf))
+		return NULL;
+
+	b->buf = NULL;
+
+	return !gfx_vec_push(&b->out, s, d) ? NULL : gfx_vec_at(&b->out, b->out.size - s);
+}
+
+/****************************/
+void _gfx_hash_builder_buf(_GFXHashBuilder* builder, size_t capacity, void* buf)
+{
+	assert(builder != NULL);
+	assert(capacity >= sizeof(_GFXHashKey));
+	assert(buf != NULL);
+
+	// Reserve the _GFXHashKey header in the buffer.
+	gfx_vec_init(&builder->out, 1);
+	builder->buf = buf;
+	builder->size = sizeof(_GFXHashKey);
+	builder->capacity = capacity;
+	builder->hashed = 0;
+	_gfx_xxh64_init(builder->acc);
+}
+
+/****************************/
+_GFXHashKey* _gfx_hash_builder_key(_GFXHashBuilder* builder)
+{
+	assert(builder != NULL);
+
+	// Set length & return whatever memory is in use.
+	_GFXHashKey* key;
+
+	if (builder->buf != NULL)
+		key = (_GFXHashKey*)builder->buf,
+		key->len = builder->size - sizeof(_GFXHashKey);
+	else
+		key = gfx_vec_at(&builder->out, 0),
+		key->len = builder->out.size - sizeof(_GFXHashKey);
+
+	return key;
+}
+
+/****************************/
+void _gfx_hash_builder_stripes(_GFXHashBuilder* b)
+{
+	assert(b != NULL);
+
+	// Hash from wherever the key currently lives,
+	// the pushed data is still hot in cache.
+	const char* bytes = (b->buf != NULL ? b->buf :
+		(const char*)gfx_vec_at(&b->out, 0)) + sizeof(_GFXHashKey);
+
+	const size_t num =
+		(_gfx_hash_builder_len(b) - b->hashed) / _GFX_HASH_STRIPE;
+
+	_gfx_xxh64_stripes(b->acc, num, bytes + b->hashed);
+	b->hashed += num * _GFX_HASH_STRIPE;
+}
+
+/****************************/
+uint64_t _gfx_hash_builder_hash(_GFXHashBuilder* builder)
+{
+	assert(builder != NULL);
+
+	// Hash the remaining stripes, then finalize with the tail.
+	// The builder state stays valid, it can still be pushed to.
+	_gfx_hash_builder_stripes(builder);
+
+	const char* bytes = (builder->buf != NULL ? builder->buf :
+		(const char*)gfx_vec_at(&builder->out, 0)) + sizeof(_GFXHashKey);
+
+	return _gfx_xxh64_final(builder->acc,
+		_gfx_hash_builder_len(builder), bytes + builder->hashed);
+}
+
+/****************************/
+void _gfx_hash_builder_clear(_GFXHashBuilder* builder)
+{
+	assert(builder != NULL);
+
+	gfx_vec_clear(&builder->out);
+	builder->buf = NULL;
+}
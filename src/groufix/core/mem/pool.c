@@ -9,9 +9,29 @@
 #include "groufix/core/mem.h"
 #include <assert.h>
 #include <stdlib.h>
+#include <math.h>
 #include <string.h>
 
 
+// Maximum #sets of a descriptor block.
+#define _GFX_POOL_MAX_SETS 1000
+
+// Weight of the newest demand in the moving average, in (0,1].
+#define _GFX_POOL_DEMAND_WEIGHT 0.25f
+
+// Extra room in a block relative to the average demand, >= 1.
+#define _GFX_POOL_DEMAND_HEADROOM 1.25f
+
+// Minimum #sets of the allocating layout a new block can hold.
+#define _GFX_POOL_MIN_SETS 16
+
+// Fraction of #sets of a block under which it is considered under-used.
+#define _GFX_POOL_TRIM_USAGE 0.125f
+
+// #consecutive flushes a block must be under-used before it is drained.
+#define _GFX_POOL_TRIM_FLUSHES 16
+
+
 /****************************
  * Mirrors _GFXHashKey, but containing only one _GFXCacheElem*.
  */
@@ -23,6 +43,19 @@ typedef struct _GFXRecycleKey
 } _GFXRecycleKey;
 
 
+/****************************
+ * Computes the bitmask of descriptor types used by a descriptor set layout.
+ */
+static inline uint32_t _gfx_pool_layout_types(const _GFXCacheElem* setLayout)
+{
+	uint32_t types = 0;
+
+	for (uint32_t t = 0; t < _GFX_NUM_DESCRIPTOR_TYPES; ++t)
+		if (setLayout->descriptors[t] > 0) types |= (uint32_t)1 << t;
+
+	return types;
+}
+
 /****************************
  * Helper to make all subordinates unclaim their allocating descriptor block,
  * and let them link all blocks into the pool's free list again.
@@ -48,14 +81,17 @@ static void _gfx_unclaim_pool_blocks(_GFXPool* pool)
 
 /****************************
  * Allocates and initializes a new block (i.e. Vulkan descriptor pool).
+ * @param setLayout The descriptor set layout to allocate for.
  * @return NULL on failure.
  *
  * The block is not linked into the free or full list of the pool,
  * must manually be claimed by either the pool or a subordinate!
  */
-static _GFXPoolBlock* _gfx_alloc_pool_block(_GFXPool* pool)
+static _GFXPoolBlock* _gfx_alloc_pool_block(_GFXPool* pool,
+                                            const _GFXCacheElem* setLayout)
 {
 	assert(pool != NULL);
+	assert(setLayout != NULL);
 
 	_GFXContext* context = pool->context;
 
@@ -65,40 +101,40 @@ static _GFXPoolBlock* _gfx_alloc_pool_block(_GFXPool* pool)
 		goto clean;
 
 	// Create descriptor pool.
-	// TODO: Come up with something to determine all the pool sizes.
-	uint32_t sams = 1000;
-	uint32_t combImgSams = 1000;
-	uint32_t samImgs = 1000;
-	uint32_t stoImgs = 1000;
-	uint32_t uniTexBufs = 1000;
-	uint32_t stoTexBufs = 1000;
-	uint32_t uniBufs = 1000;
-	uint32_t stoBufs = 1000;
-	uint32_t uniBufDyns = 1000;
-	uint32_t stoBufDyns = 1000;
-	uint32_t inps = 1000;
+	// Take the sizes determined from observed demand, but make sure we can
+	// at least allocate a few sets of the given layout, otherwise we would
+	// endlessly allocate new blocks for a layout the demand did not expect.
+	VkDescriptorPoolSize sizes[_GFX_NUM_DESCRIPTOR_TYPES];
+	uint32_t counts[_GFX_NUM_DESCRIPTOR_TYPES];
+	uint32_t numSizes = 0;
+	uint32_t types = 0;
+
+	for (uint32_t t = 0; t < _GFX_NUM_DESCRIPTOR_TYPES; ++t)
+	{
+		counts[t] = GFX_MAX(pool->demand.sizes[t],
+			setLayout->descriptors[t] * _GFX_POOL_MIN_SETS);
+
+		if (counts[t] > 0) types |= (uint32_t)1 << t;
+		if (counts[t] > 0) sizes[numSizes++] = (VkDescriptorPoolSize){
+			.type = (VkDescriptorType)t,
+			.descriptorCount = counts[t]
+		};
+	}
+
+	// Vulkan does not like empty pools, but empty sets are allowed.
+	if (numSizes == 0) sizes[numSizes++] = (VkDescriptorPoolSize){
+		.type = VK_DESCRIPTOR_TYPE_SAMPLER,
+		.descriptorCount = 1
+	};
 
 	VkDescriptorPoolCreateInfo dpci = {
 		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
 
 		.pNext         = NULL,
 		.flags         = 0,
-		.maxSets       = 1000,
-		.poolSizeCount = 11,
-
-		.pPoolSizes = (VkDescriptorPoolSize[]){
-			{ VK_DESCRIPTOR_TYPE_SAMPLER, sams },
-			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, combImgSams },
-			{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, samImgs },
-			{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, stoImgs },
-			{ VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, uniTexBufs },
-			{ VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, stoTexBufs },
-			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uniBufs },
-			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, stoBufs },
-			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, uniBufDyns },
-			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, stoBufDyns },
-			{ VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, inps }
-		}
+		.maxSets       = pool->demand.maxSets,
+		.poolSizeCount = numSizes,
+		.pPoolSizes    = sizes
 	};
 
 	_GFX_VK_CHECK(context->vk.CreateDescriptorPool(
@@ -107,11 +143,19 @@ static _GFXPoolBlock* _gfx_alloc_pool_block(_GFXPool* pool)
 	// Init the rest & return.
 	gfx_list_init(&block->elems);
 	block->full = 0;
+	block->drain = 0;
+	block->idle = 0;
+	block->maxSets = pool->demand.maxSets;
+	block->allocated = 0;
+	block->types = types;
+	block->exhausted = 0;
 	atomic_store_explicit(&block->sets, 0, memory_order_relaxed);
+	atomic_fetch_add_explicit(&pool->blocks, 1, memory_order_relaxed);
 
 	// Weee.
 	gfx_log_debug(
 		"New Vulkan descriptor pool allocated:\n"
+		"    #sets: %"PRIu32".\n"
 		"    #samplers: %"PRIu32".\n"
 		"    #combined image samplers: %"PRIu32".\n"
 		"    #sampled images: %"PRIu32".\n"
@@ -123,12 +167,18 @@ static _GFXPoolBlock* _gfx_alloc_pool_block(_GFXPool* pool)
 		"    #dynamic uniform buffers: %"PRIu32".\n"
 		"    #dynamic storage buffers: %"PRIu32".\n"
 		"    #attachment inputs: %"PRIu32".\n",
-		sams, combImgSams,
-		samImgs, stoImgs,
-		uniTexBufs, stoTexBufs,
-		uniBufs, stoBufs,
-		uniBufDyns, stoBufDyns,
-		inps);
+		pool->demand.maxSets,
+		counts[VK_DESCRIPTOR_TYPE_SAMPLER],
+		counts[VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER],
+		counts[VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE],
+		counts[VK_DESCRIPTOR_TYPE_STORAGE_IMAGE],
+		counts[VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER],
+		counts[VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER],
+		counts[VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER],
+		counts[VK_DESCRIPTOR_TYPE_STORAGE_BUFFER],
+		counts[VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC],
+		counts[VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC],
+		counts[VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT]);
 
 	return block;
 
@@ -141,6 +191,48 @@ clean:
 	return NULL;
 }
 
+/****************************
+ * Folds the demand of a subordinate into the pool's pending demand,
+ * resetting the demand of the subordinate.
+ */
+static void _gfx_pool_gather_demand(_GFXPool* pool, _GFXPoolSub* sub)
+{
+	pool->demand.sets += sub->demand.sets;
+	sub->demand.sets = 0;
+
+	for (uint32_t t = 0; t < _GFX_NUM_DESCRIPTOR_TYPES; ++t)
+		pool->demand.descriptors[t] += sub->demand.descriptors[t],
+		sub->demand.descriptors[t] = 0;
+}
+
+/****************************
+ * Updates the moving average demand with all pending demand and
+ * re-evaluates the sizes of new descriptor blocks.
+ */
+static void _gfx_pool_update_demand(_GFXPool* pool)
+{
+	// Nothing was allocated, nothing to observe.
+	if (pool->demand.sets == 0)
+		return;
+
+	const float w = pool->demand.observed ? _GFX_POOL_DEMAND_WEIGHT : 1.0f;
+	pool->demand.observed = 1;
+
+	for (uint32_t t = 0; t < _GFX_NUM_DESCRIPTOR_TYPES; ++t)
+	{
+		const float perSet =
+			(float)pool->demand.descriptors[t] / (float)pool->demand.sets;
+
+		pool->demand.avg[t] = pool->demand.avg[t] * (1.0f - w) + perSet * w;
+		pool->demand.descriptors[t] = 0;
+
+		pool->demand.sizes[t] = (uint32_t)ceilf(pool->demand.avg[t] *
+			(float)pool->demand.maxSets * _GFX_POOL_DEMAND_HEADROOM);
+	}
+
+	pool->demand.sets = 0;
+}
+
 /****************************
  * Frees a descriptor block, freeing GPU memory of all descriptor sets.
  * _GFXPoolElem objects from this pool are not erased from their hashtables!
@@ -157,6 +249,8 @@ static void _gfx_free_pool_block(_GFXPool* pool, _GFXPoolBlock* block)
 	context->vk.DestroyDescriptorPool(
 		context->vk.device, block->vk.pool, NULL);
 
+	atomic_fetch_sub_explicit(&pool->blocks, 1, memory_order_relaxed);
+
 	gfx_list_clear(&block->elems);
 	free(block);
 
@@ -170,7 +264,9 @@ static void _gfx_free_pool_block(_GFXPool* pool, _GFXPoolBlock* block)
  * destroyed & freed.
  * @param map  Must be the hashtable elem is currently stored in.
  * @param elem Element to recycle, will not be in map anymore after this call.
- * @return Non-zero if recycled, zero if erased.
+ * @return Non-zero if recycled, zero if erased (i.e. lost).
+ *
+ * Elements of a draining block are erased, but not considered lost.
  */
 static bool _gfx_recycle_pool_elem(_GFXPool* pool, GFXMap* map,
                                    _GFXPoolElem* elem)
@@ -197,7 +293,14 @@ static bool _gfx_recycle_pool_elem(_GFXPool* pool, GFXMap* map,
 	// Try to move the element to the recycled hashtable.
 	// Make sure to use the fast variants of map_(move|erase), so
 	// we can keep iterating outside this function!
-	if (!gfx_map_fmove(
+	// If the block is draining, just erase it, as it will never be used again.
+	if (block->drain)
+	{
+		gfx_list_erase(&block->elems, &elem->list);
+		gfx_map_ferase(map, elem);
+	}
+
+	else if (!gfx_map_fmove(
 		map, &pool->recycled, elem, sizeof(_GFXRecycleKey), &key))
 	{
 		// If that failed, erase it entirely, it will never be used again.
@@ -277,8 +380,126 @@ static bool _gfx_make_pool_elem_stale(_GFXPool* pool, GFXMap* map,
 	return 1;
 }
 
+/****************************
+ * Drains all blocks that have been under-used for too long and erases
+ * recycled elements exceeding the maximum, so memory usage follows the
+ * working set instead of the historical peak.
+ * No subordinate may hold an allocating block (see _gfx_unclaim_pool_blocks)!
+ *
+ * Draining blocks are moved to the full list and no longer hand out recycled
+ * descriptor sets, they are destroyed once all their sets are recycled.
+ */
+static void _gfx_pool_trim(_GFXPool* pool)
+{
+	assert(pool != NULL);
+
+	const uint32_t low =
+		(uint32_t)((float)pool->demand.maxSets * _GFX_POOL_TRIM_USAGE);
+
+	// Count the blocks that can still be allocated from,
+	// we never drain the last one.
+	size_t active = 0;
+	bool drained = 0;
+
+	for (GFXList* list = &pool->free; list != NULL;
+		list = (list == &pool->free) ? &pool->full : NULL)
+	{
+		for (
+			_GFXPoolBlock* block = (_GFXPoolBlock*)list->head;
+			block != NULL;
+			block = (_GFXPoolBlock*)block->list.next)
+		{
+			active += !block->drain;
+		}
+	}
+
+	// Update the idle counts of all blocks and mark them for draining.
+	for (GFXList* list = &pool->free; list != NULL;
+		list = (list == &pool->free) ? &pool->full : NULL)
+	{
+		_GFXPoolBlock* block = (_GFXPoolBlock*)list->head;
+
+		while (block != NULL)
+		{
+			_GFXPoolBlock* next = (_GFXPoolBlock*)block->list.next;
+
+			if (!block->drain)
+			{
+				const uint32_t sets = (uint32_t)atomic_load_explicit(
+					&block->sets, memory_order_relaxed);
+
+				block->idle = (sets <= low) ? block->idle + 1 : 0;
+
+				if (block->idle >= _GFX_POOL_TRIM_FLUSHES && active > 1)
+				{
+					// Move it to the full list so it is never claimed.
+					if (!block->full)
+					{
+						gfx_list_erase(&pool->free, &block->list);
+						gfx_list_insert_after(&pool->full, &block->list, NULL);
+						block->full = 1;
+					}
+
+					block->drain = 1;
+					--active;
+					drained = 1;
+				}
+			}
+
+			block = next;
+		}
+	}
+
+	// Erase recycled elements of draining blocks,
+	// as well as any elements exceeding the maximum.
+	if (
+		drained ||
+		(pool->maxRecycled > 0 && pool->recycled.size > pool->maxRecycled))
+	{
+		_GFXPoolElem* elem = gfx_map_first(&pool->recycled);
+
+		while (elem != NULL)
+		{
+			_GFXPoolElem* next = gfx_map_next(&pool->recycled, elem);
+
+			if (
+				elem->block->drain ||
+				(pool->maxRecycled > 0 && pool->recycled.size > pool->maxRecycled))
+			{
+				gfx_list_erase(&elem->block->elems, &elem->list);
+				gfx_map_ferase(&pool->recycled, elem);
+			}
+
+			elem = next;
+		}
+
+		gfx_map_shrink(&pool->recycled);
+	}
+
+	// Lastly, destroy all draining blocks with no in-use sets left.
+	// Note that the rest of the draining blocks get destroyed by
+	// _gfx_recycle_pool_elem once their last set is recycled.
+	_GFXPoolBlock* block = (_GFXPoolBlock*)pool->full.head;
+
+	while (block != NULL)
+	{
+		_GFXPoolBlock* next = (_GFXPoolBlock*)block->list.next;
+
+		if (
+			block->drain &&
+			atomic_load_explicit(&block->sets, memory_order_relaxed) == 0)
+		{
+			gfx_list_erase(&pool->full, &block->list);
+			_gfx_free_pool_block(pool, block);
+		}
+
+		block = next;
+	}
+}
+
 /****************************/
-bool _gfx_pool_init(_GFXPool* pool, _GFXDevice* device, unsigned int flushes)
+bool _gfx_pool_init(_GFXPool* pool, _GFXDevice* device,
+                    unsigned int flushes, size_t maxRecycled)
 {
 	assert(pool != NULL);
 	assert(device != NULL);
@@ -286,6 +507,7 @@ bool _gfx_pool_init(_GFXPool* pool, _GFXDevice* device, unsigned int flushes)
 
 	pool->context = device->context;
 	pool->flushes = flushes;
+	pool->maxRecycled = maxRecycled;
 
 	// Initialize the locks.
 	if (!_gfx_mutex_init(&pool->subLock))
@@ -303,11 +525,24 @@ bool _gfx_pool_init(_GFXPool* pool, _GFXDevice* device, unsigned int flushes)
 	gfx_list_init(&pool->subs);
 
 	gfx_map_init(&pool->immutable,
-		sizeof(_GFXPoolElem), _gfx_hash_murmur3, _gfx_hash_cmp);
+		sizeof(_GFXPoolElem), _gfx_hash_xxh64, _gfx_hash_cmp);
 	gfx_map_init(&pool->stale,
-		sizeof(_GFXPoolElem), _gfx_hash_murmur3, _gfx_hash_cmp);
+		sizeof(_GFXPoolElem), _gfx_hash_xxh64, _gfx_hash_cmp);
 	gfx_map_init(&pool->recycled,
-		sizeof(_GFXPoolElem), _gfx_hash_murmur3, _gfx_hash_cmp);
+		sizeof(_GFXPoolElem), _gfx_hash_xxh64, _gfx_hash_cmp);
+
+	// Until any demand is observed, guess a uniform demand of a single
+	// descriptor of each type per set.
+	pool->demand.sets = 0;
+	pool->demand.observed = 0;
+	pool->demand.maxSets = _GFX_POOL_MAX_SETS;
+
+	for (uint32_t t = 0; t < _GFX_NUM_DESCRIPTOR_TYPES; ++t)
+		pool->demand.descriptors[t] = 0,
+		pool->demand.avg[t] = 1.0f,
+		pool->demand.sizes[t] = _GFX_POOL_MAX_SETS;
+
+	atomic_store_explicit(&pool->blocks, 0, memory_order_relaxed);
 
 	return 1;
 }
@@ -382,8 +617,13 @@ bool _gfx_pool_flush(_GFXPool* pool)
 	{
 		success = success &&
 			gfx_map_merge(&pool->immutable, &sub->mutable);
+
+		_gfx_pool_gather_demand(pool, sub);
 	}
 
+	// Size new blocks for all demand since the last flush.
+	_gfx_pool_update_demand(pool);
+
 	if (!success) gfx_log_warn(
 		"Pool flush failed to make cache available to all threads.");
 
@@ -422,6 +662,9 @@ recycle:
 	gfx_map_shrink(&pool->immutable);
 	gfx_map_shrink(&pool->stale);
 
+	// And trim blocks & recycled elements that are no longer needed.
+	_gfx_pool_trim(pool);
+
 	if (lost > 0) gfx_log_warn(
 		"Pool flush failed, lost %"GFX_PRIs" Vulkan descriptor sets. "
 		"Will remain unavailable until blocks are reset or fully recycled.",
@@ -461,12 +704,13 @@ void _gfx_pool_reset(_GFXPool* pool)
 		gfx_list_erase(&pool->full, &block->list);
 		gfx_list_insert_after(&pool->free, &block->list, NULL);
 
-		// Reset the full flag.
+		// Reset the full & drain flags.
+		// Unused blocks will be drained again by _gfx_pool_flush.
 		block->full = 0;
+		block->drain = 0;
 	}
 
 	// And reset all the blocks and their Vulkan descriptor pools.
-	// TODO: Free pools based on how many recycled descriptors there were.
 	for (
 		_GFXPoolBlock* block = (_GFXPoolBlock*)pool->free.head;
 		block != NULL;
@@ -474,6 +718,8 @@ void _gfx_pool_reset(_GFXPool* pool)
 	{
 		gfx_list_clear(&block->elems);
 		atomic_store_explicit(&block->sets, 0, memory_order_relaxed);
+		block->allocated = 0;
+		block->exhausted = 0;
 
 		context->vk.ResetDescriptorPool(
 			context->vk.device, block->vk.pool, 0);
@@ -488,9 +734,13 @@ void _gfx_pool_sub(_GFXPool* pool, _GFXPoolSub* sub)
 
 	// Initialize the subordinate.
 	gfx_map_init(&sub->mutable,
-		sizeof(_GFXPoolElem), _gfx_hash_murmur3, _gfx_hash_cmp);
+		sizeof(_GFXPoolElem), _gfx_hash_xxh64, _gfx_hash_cmp);
 
 	sub->block = NULL;
+	sub->demand.sets = 0;
+
+	for (uint32_t t = 0; t < _GFX_NUM_DESCRIPTOR_TYPES; ++t)
+		sub->demand.descriptors[t] = 0;
 
 	// Lastly to link the subordinate into the pool.
 	gfx_list_insert_after(&pool->subs, &sub->list, NULL);
@@ -535,6 +785,9 @@ void _gfx_pool_unsub(_GFXPool* pool, _GFXPoolSub* sub)
 
 	gfx_map_clear(&sub->mutable);
 
+	// Keep its demand around for the next flush.
+	_gfx_pool_gather_demand(pool, sub);
+
 	// Unlink subordinate from the pool.
 	gfx_list_erase(&pool->subs, &sub->list);
 }
@@ -595,6 +848,54 @@ void _gfx_pool_recycle(_GFXPool* pool,
 		lost);
 }
 
+/****************************/
+void _gfx_pool_recycle_all(_GFXPool* pool, unsigned int flushes)
+{
+	assert(pool != NULL);
+
+	// First unclaim all subordinate blocks, so we can recycle elements.
+	_gfx_unclaim_pool_blocks(pool);
+
+	// Then make every element in all tables stale,
+	// fmove keeps the next node valid while iterating.
+	size_t lost = 0;
+
+	for (
+		_GFXPoolSub* sub = (_GFXPoolSub*)pool->subs.head;
+		sub != NULL;
+		sub = (_GFXPoolSub*)sub->list.next)
+	{
+		for (
+			_GFXPoolElem* elem = gfx_map_first(&sub->mutable);
+			elem != NULL;)
+		{
+			_GFXPoolElem* next = gfx_map_next(&sub->mutable, elem);
+
+			lost += !_gfx_make_pool_elem_stale(
+				pool, &sub->mutable, elem, flushes);
+
+			elem = next;
+		}
+	}
+
+	for (
+		_GFXPoolElem* elem = gfx_map_first(&pool->immutable);
+		elem != NULL;)
+	{
+		_GFXPoolElem* next = gfx_map_next(&pool->immutable, elem);
+
+		lost += !_gfx_make_pool_elem_stale(
+			pool, &pool->immutable, elem, flushes);
+
+		elem = next;
+	}
+
+	if (lost > 0) gfx_log_warn(
+		"Pool recycling failed, lost %"GFX_PRIs" Vulkan descriptor sets. "
+		"Will remain unavailable until blocks are reset or fully recycled.",
+		lost);
+}
+
 /****************************/
 _GFXPoolElem* _gfx_pool_get(_GFXPool* pool, _GFXPoolSub* sub,
                             const _GFXCacheElem* setLayout,
@@ -606,6 +907,8 @@ _GFXPoolElem* _gfx_pool_get(_GFXPool* pool, _GFXPoolSub* sub,
 	assert(setLayout->type == VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO);
 	assert(key != NULL);
 
+	gfx_trace_begin(get, "_gfx_pool_get");
+
 	_GFXContext* context = pool->context;
 	const uint64_t hash = pool->immutable.hash(key);
 
@@ -640,7 +943,7 @@ _GFXPoolElem* _gfx_pool_get(_GFXPool* pool, _GFXPoolSub* sub,
 			elem, _gfx_hash_size(key), key, hash))
 		{
 			_gfx_mutex_unlock(&pool->recLock);
-			return NULL;
+			goto error;
 		}
 
 	_gfx_mutex_unlock(&pool->recLock);
@@ -648,17 +951,26 @@ _GFXPoolElem* _gfx_pool_get(_GFXPool* pool, _GFXPoolSub* sub,
 	// If we STILL have no element, allocate a new descriptor set.
 	if (elem == NULL)
 	{
+		// Whether the current block was just allocated for this set.
+		// And the descriptor types we need room for.
+		bool fresh = 0;
+		const uint32_t types = _gfx_pool_layout_types(setLayout);
+
 		// Goto here to try another descriptor block.
 	try_block:
 
 		// To do this, we need a descriptor block.
-		// If we don't have one, go claim one from the free list.
+		// If we don't have one, go claim one from the free list,
+		// skipping blocks that ran out of any type we need.
 		// We need to lock for this again.
 		if (sub->block == NULL)
 		{
 			_gfx_mutex_lock(&pool->subLock);
 
 			sub->block = (_GFXPoolBlock*)pool->free.head;
+			while (sub->block != NULL && (sub->block->exhausted & types))
+				sub->block = (_GFXPoolBlock*)sub->block->list.next;
+
 			if (sub->block != NULL)
 				gfx_list_erase(&pool->free, &sub->block->list);
 
@@ -666,12 +978,16 @@ _GFXPoolElem* _gfx_pool_get(_GFXPool* pool, _GFXPoolSub* sub,
 
 			// If we didn't manage to claim a block, make one ourselves...
 			if (sub->block == NULL)
-				if ((sub->block = _gfx_alloc_pool_block(pool)) == NULL)
+			{
+				if ((sub->block = _gfx_alloc_pool_block(pool, setLayout)) == NULL)
 				{
 					// ...
 					if (elem != NULL) gfx_map_erase(&sub->mutable, elem);
-					return NULL;
+					goto error;
 				}
+
+				fresh = 1;
+			}
 		}
 
 		// Quickly try to get a map element if we didn't already.
@@ -680,7 +996,7 @@ _GFXPoolElem* _gfx_pool_get(_GFXPool* pool, _GFXPoolSub* sub,
 			elem = gfx_map_hinsert(
 				&sub->mutable, NULL, _gfx_hash_size(key), key, hash);
 
-			if (elem == NULL) return NULL;
+			if (elem == NULL) goto error;
 		}
 
 		// Now allocate a descriptor set from this block/pool.
@@ -699,18 +1015,34 @@ _GFXPoolElem* _gfx_pool_get(_GFXPool* pool, _GFXPoolSub* sub,
 		VkResult result = context->vk.AllocateDescriptorSets(
 			context->vk.device, &dsai, &elem->vk.set);
 
-		// If the descriptor pool was out of memory,
-		// move the descriptor block to the full list and try again.
-		// We must lock for this again..
+		// If the descriptor pool was out of memory, only the descriptor
+		// types we need ran out, other layouts may still fit.
+		// So remember those types and give the block back, unless it
+		// cannot hold anything anymore, then move it to the full list.
+		// Then try again, we must lock for this again..
+		// Unless the block was just allocated, it should have had room.
 		if (
-			result == VK_ERROR_FRAGMENTED_POOL ||
-			result == VK_ERROR_OUT_OF_POOL_MEMORY)
+			!fresh &&
+			(result == VK_ERROR_FRAGMENTED_POOL ||
+			result == VK_ERROR_OUT_OF_POOL_MEMORY))
 		{
+			_GFXPoolBlock* block = sub->block;
+			block->exhausted |= types;
+
 			_gfx_mutex_lock(&pool->subLock);
 
-			// Don't forget to set the full flag!
-			sub->block->full = 1;
-			gfx_list_insert_after(&pool->full, &sub->block->list, NULL);
+			if (
+				types == 0 ||
+				block->allocated >= block->maxSets ||
+				(block->types & ~block->exhausted) == 0)
+			{
+				// Don't forget to set the full flag!
+				block->full = 1;
+				gfx_list_insert_after(&pool->full, &block->list, NULL);
+			}
+			else
+				// Insert at the end, hot blocks are at the beginning.
+				gfx_list_insert_after(&pool->free, &block->list, NULL);
 
 			_gfx_mutex_unlock(&pool->subLock);
 
@@ -722,12 +1054,31 @@ _GFXPoolElem* _gfx_pool_get(_GFXPool* pool, _GFXPoolSub* sub,
 		_GFX_VK_CHECK(result,
 			{
 				gfx_map_erase(&sub->mutable, elem);
-				return NULL;
+				goto error;
 			});
 
 		// And link the element and block together.
 		elem->block = sub->block;
 		gfx_list_insert_after(&sub->block->elems, &elem->list, NULL);
+
+		// If all sets of the block are used up, it is full.
+		if (++sub->block->allocated >= sub->block->maxSets)
+		{
+			_gfx_mutex_lock(&pool->subLock);
+
+			sub->block->full = 1;
+			gfx_list_insert_after(&pool->full, &sub->block->list, NULL);
+
+			_gfx_mutex_unlock(&pool->subLock);
+
+			sub->block = NULL;
+		}
+
+		// Keep track of the demand of newly allocated sets.
+		++sub->demand.sets;
+
+		for (uint32_t t = 0; t < _GFX_NUM_DESCRIPTOR_TYPES; ++t)
+			sub->demand.descriptors[t] += setLayout->descriptors[t];
 	}
 
 	// Now that we surely have an element, initialize it!
@@ -745,5 +1096,14 @@ _GFXPoolElem* _gfx_pool_get(_GFXPool* pool, _GFXPoolSub* sub,
 	// Reset #flushes of the element & return when found.
 found:
 	atomic_store_explicit(&elem->flushes, pool->flushes, memory_order_relaxed);
+	gfx_trace_end(get);
+
 	return elem;
+
+
+	// Error on failure.
+error:
+	gfx_trace_end(get);
+
+	return NULL;
 }
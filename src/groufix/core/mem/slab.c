@@ -0,0 +1,230 @@
+/**
+ * This file is part of groufix.
+ * Copyright (c) Stef Velzel. All rights reserved.
+ *
+ * groufix : graphics engine produced by Stef Velzel.
+ * www     : <www.vuzzel.nl>
+ */
+
+#include "groufix/core/mem.h"
+#include <assert.h>
+#include <stdlib.h>
+
+
+// Number of cells in a slab, must match the bits of _GFXMemSlab::free.
+#define _GFX_SLAB_CELLS 64
+
+// All cells free.
+#define _GFX_SLAB_EMPTY (~(uint64_t)0)
+
+// Smallest & largest size class of a slab (256 B, 64 KiB).
+// Meaning slabs are between 16 KiB and 4 MiB in size.
+#define _GFX_SLAB_MIN_CELL 256
+#define _GFX_SLAB_MAX_CELL (64ull * 1024)
+
+
+/****************************
+ * Claims a new slab from the allocator.
+ * @return NULL on failure.
+ *
+ * Locks the allocator during the allocation!
+ */
+static _GFXMemSlab* _gfx_alloc_slab(_GFXSlabCache* cache, bool linear,
+                                    VkMemoryPropertyFlags required,
+                                    VkMemoryPropertyFlags optimal,
+                                    VkDeviceSize cell, uint32_t types)
+{
+	assert(cache != NULL);
+
+	_GFXMemSlab* slab = malloc(sizeof(_GFXMemSlab));
+	if (slab == NULL)
+		return NULL;
+
+	// Align the slab to its size class, so all cells are aligned to it.
+	VkMemoryRequirements reqs = {
+		.size           = cell * _GFX_SLAB_CELLS,
+		.alignment      = cell,
+		.memoryTypeBits = types
+	};
+
+	_gfx_mutex_lock(cache->allocLock);
+
+	const bool success = _gfx_alloc(
+		cache->alloc, &slab->alloc, linear, required, optimal, reqs);
+
+	_gfx_mutex_unlock(cache->allocLock);
+
+	if (!success)
+	{
+		free(slab);
+		return NULL;
+	}
+
+	slab->cache = cache;
+	slab->required = required;
+	slab->optimal = optimal;
+	slab->linear = linear;
+	slab->cell = cell;
+	slab->free = _GFX_SLAB_EMPTY;
+
+	return slab;
+}
+
+/****************************
+ * Frees a slab, giving its memory back to the allocator.
+ * Locks the allocator during the free!
+ */
+static void _gfx_free_slab(_GFXSlabCache* cache, _GFXMemSlab* slab)
+{
+	assert(cache != NULL);
+	assert(slab != NULL);
+
+	_gfx_mutex_lock(cache->allocLock);
+	_gfx_free(cache->alloc, &slab->alloc);
+	_gfx_mutex_unlock(cache->allocLock);
+
+	free(slab);
+}
+
+/****************************/
+bool _gfx_slab_cache_init(_GFXSlabCache* cache,
+                          _GFXAllocator* alloc, _GFXMutex* allocLock)
+{
+	assert(cache != NULL);
+	assert(alloc != NULL);
+	assert(allocLock != NULL);
+
+	if (!_gfx_mutex_init(&cache->lock))
+		return 0;
+
+	cache->alloc = alloc;
+	cache->allocLock = allocLock;
+	gfx_list_init(&cache->slabs);
+
+	return 1;
+}
+
+/****************************/
+void _gfx_slab_cache_clear(_GFXSlabCache* cache)
+{
+	assert(cache != NULL);
+
+	// Give all memory back to the allocator.
+	while (cache->slabs.head != NULL)
+	{
+		_GFXMemSlab* slab = (_GFXMemSlab*)cache->slabs.head;
+		gfx_list_erase(&cache->slabs, &slab->list);
+		_gfx_free_slab(cache, slab);
+	}
+
+	gfx_list_clear(&cache->slabs);
+	_gfx_mutex_clear(&cache->lock);
+}
+
+/****************************/
+bool _gfx_slab_alloc(_GFXSlabCache* cache, _GFXMemAlloc* mem, bool linear,
+                     VkMemoryPropertyFlags required, VkMemoryPropertyFlags optimal,
+                     VkMemoryRequirements reqs)
+{
+	assert(cache != NULL);
+	assert(mem != NULL);
+	assert(reqs.size > 0);
+	assert(GFX_IS_POWER_OF_TWO(reqs.alignment));
+	assert(reqs.memoryTypeBits != 0);
+
+	// Too large for any size class, leave it to the allocator.
+	if (reqs.size > _GFX_SLAB_MAX_CELL || reqs.alignment > _GFX_SLAB_MAX_CELL)
+		return 0;
+
+	// Get the size class, a power of two that fits both size & alignment.
+	VkDeviceSize cell = _GFX_SLAB_MIN_CELL;
+	while (cell < reqs.size || cell < reqs.alignment) cell <<= 1;
+
+	// Find a slab with free cells and matching memory.
+	// Slabs that were last allocated from are at the front.
+	_gfx_mutex_lock(&cache->lock);
+
+	_GFXMemSlab* slab;
+
+	for (
+		slab = (_GFXMemSlab*)cache->slabs.head;
+		slab != NULL;
+		slab = (_GFXMemSlab*)slab->list.next)
+	{
+		if (
+			slab->free != 0 &&
+			slab->cell == cell &&
+			slab->linear == linear &&
+			slab->required == required &&
+			slab->optimal == optimal &&
+			(((uint32_t)1 << slab->alloc.block->type) & reqs.memoryTypeBits))
+		{
+			break;
+		}
+	}
+
+	if (slab != NULL)
+		gfx_list_erase(&cache->slabs, &slab->list);
+	else
+	{
+		// Ran dry, claim a new slab.
+		slab = _gfx_alloc_slab(
+			cache, linear, required, optimal, cell, reqs.memoryTypeBits);
+
+		if (slab == NULL)
+		{
+			_gfx_mutex_unlock(&cache->lock);
+			return 0;
+		}
+	}
+
+	gfx_list_insert_before(&cache->slabs, &slab->list, NULL);
+
+	// Claim the first free cell.
+	size_t c = 0;
+	while (!(slab->free & ((uint64_t)1 << c))) ++c;
+
+	slab->free &= ~((uint64_t)1 << c);
+	atomic_fetch_add(&cache->alloc->stats.cells, 1);
+
+	*mem = (_GFXMemAlloc){
+		.node   = { .free = 0 },
+		.block  = slab->alloc.block,
+		.slab   = slab,
+		.size   = reqs.size,
+		.offset = slab->alloc.offset + cell * c,
+		.flags  = slab->alloc.flags,
+		.linear = linear,
+		.vk     = { .memory = slab->alloc.vk.memory }
+	};
+
+	_gfx_mutex_unlock(&cache->lock);
+
+	return 1;
+}
+
+/****************************/
+void _gfx_slab_free(_GFXMemAlloc* mem)
+{
+	assert(mem != NULL);
+	assert(mem->slab != NULL);
+
+	_GFXMemSlab* slab = mem->slab;
+	_GFXSlabCache* cache = slab->cache;
+
+	_gfx_mutex_lock(&cache->lock);
+
+	const size_t c = (size_t)((mem->offset - slab->alloc.offset) / slab->cell);
+	slab->free |= (uint64_t)1 << c;
+	atomic_fetch_sub(&cache->alloc->stats.cells, 1);
+
+	// Give an empty slab back to the allocator, unless it was last used,
+	// this so we do not keep hitting the allocator on alloc/free cycles.
+	if (slab->free == _GFX_SLAB_EMPTY && cache->slabs.head != &slab->list)
+	{
+		gfx_list_erase(&cache->slabs, &slab->list);
+		_gfx_free_slab(cache, slab);
+	}
+
+	_gfx_mutex_unlock(&cache->lock);
+}
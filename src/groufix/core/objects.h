@@ -15,6 +15,7 @@
 #include "groufix/containers/vec.h"
 #include "groufix/core/mem.h"
 #include "groufix/core.h"
+#include <stdlib.h>
 
 
 #define _GFX_GET_VK_BUFFER_USAGE(flags, usage) \
@@ -272,81 +273,81 @@
 	((stage) & GFX_STAGE_COMPUTE ? \
 		VK_SHADER_STAGE_COMPUTE_BIT : (VkShaderStageFlagBits)0))
 
-#define _GFX_GET_VK_ACCESS_FLAGS(mask, fmt) \
+#define _GFX_GET_VK_ACCESS_FLAGS2(mask, fmt) \
 	(((mask) & GFX_ACCESS_VERTEX_READ ? \
-		VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT : (VkAccessFlags)0) | \
+		VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT_KHR : (VkAccessFlags2KHR)0) | \
 	((mask) & GFX_ACCESS_INDEX_READ ? \
-		VK_ACCESS_INDEX_READ_BIT : (VkAccessFlags)0) | \
+		VK_ACCESS_2_INDEX_READ_BIT_KHR : (VkAccessFlags2KHR)0) | \
 	((mask) & GFX_ACCESS_UNIFORM_READ ? \
-		VK_ACCESS_UNIFORM_READ_BIT : (VkAccessFlags)0) | \
+		VK_ACCESS_2_UNIFORM_READ_BIT_KHR : (VkAccessFlags2KHR)0) | \
 	((mask) & GFX_ACCESS_INDIRECT_READ ? \
-		VK_ACCESS_INDIRECT_COMMAND_READ_BIT : (VkAccessFlags)0) | \
+		VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT_KHR : (VkAccessFlags2KHR)0) | \
 	((mask) & GFX_ACCESS_SAMPLED_READ ? \
-		VK_ACCESS_SHADER_READ_BIT : (VkAccessFlags)0) | \
+		VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR : (VkAccessFlags2KHR)0) | \
 	((mask) & GFX_ACCESS_STORAGE_READ ? \
-		VK_ACCESS_SHADER_READ_BIT : (VkAccessFlags)0) | \
+		VK_ACCESS_2_SHADER_STORAGE_READ_BIT_KHR : (VkAccessFlags2KHR)0) | \
 	((mask) & GFX_ACCESS_STORAGE_WRITE ? \
-		VK_ACCESS_SHADER_WRITE_BIT : (VkAccessFlags)0) | \
+		VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR : (VkAccessFlags2KHR)0) | \
 	((mask) & GFX_ACCESS_ATTACHMENT_INPUT ? \
-		VK_ACCESS_INPUT_ATTACHMENT_READ_BIT : (VkAccessFlags)0) | \
+		VK_ACCESS_2_INPUT_ATTACHMENT_READ_BIT_KHR : (VkAccessFlags2KHR)0) | \
 	((mask) & GFX_ACCESS_ATTACHMENT_READ ? \
 		(GFX_FORMAT_HAS_DEPTH_OR_STENCIL(fmt) ? \
-			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT : \
-			VK_ACCESS_COLOR_ATTACHMENT_READ_BIT) : (VkAccessFlags)0) | \
+			VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT_KHR : \
+			VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT_KHR) : (VkAccessFlags2KHR)0) | \
 	((mask) & GFX_ACCESS_ATTACHMENT_WRITE ? \
 		(GFX_FORMAT_HAS_DEPTH_OR_STENCIL(fmt) ? \
-			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT : \
-			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT) : (VkAccessFlags)0) | \
+			VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR : \
+			VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR) : (VkAccessFlags2KHR)0) | \
 	((mask) & GFX_ACCESS_ATTACHMENT_RESOLVE ? \
-		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT : (VkAccessFlags)0) | \
+		VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR : (VkAccessFlags2KHR)0) | \
 	((mask) & GFX_ACCESS_TRANSFER_READ ? \
-		VK_ACCESS_TRANSFER_READ_BIT : (VkAccessFlags)0) | \
+		VK_ACCESS_2_TRANSFER_READ_BIT_KHR : (VkAccessFlags2KHR)0) | \
 	((mask) & GFX_ACCESS_TRANSFER_WRITE ? \
-		VK_ACCESS_TRANSFER_WRITE_BIT : (VkAccessFlags)0) | \
+		VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR : (VkAccessFlags2KHR)0) | \
 	((mask) & GFX_ACCESS_HOST_READ ? \
-		VK_ACCESS_HOST_READ_BIT : (VkAccessFlags)0) | \
+		VK_ACCESS_2_HOST_READ_BIT_KHR : (VkAccessFlags2KHR)0) | \
 	((mask) & GFX_ACCESS_HOST_WRITE ? \
-		VK_ACCESS_HOST_WRITE_BIT : (VkAccessFlags)0))
+		VK_ACCESS_2_HOST_WRITE_BIT_KHR : (VkAccessFlags2KHR)0))
 
-#define _GFX_GET_VK_PIPELINE_STAGE(mask, stage, fmt) \
+#define _GFX_GET_VK_PIPELINE_STAGE2(mask, stage, fmt) \
 	(((mask) & GFX_ACCESS_VERTEX_READ ? \
-		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT : (VkPipelineStageFlags)0) | \
+		VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT_KHR : (VkPipelineStageFlags2KHR)0) | \
 	((mask) & GFX_ACCESS_INDEX_READ ? \
-		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT : (VkPipelineStageFlags)0) | \
+		VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT_KHR : (VkPipelineStageFlags2KHR)0) | \
 	((mask) & GFX_ACCESS_INDIRECT_READ ? \
-		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT : (VkPipelineStageFlags)0) | \
+		VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT_KHR : (VkPipelineStageFlags2KHR)0) | \
 	((mask) & (GFX_ACCESS_UNIFORM_READ | GFX_ACCESS_SAMPLED_READ | \
 	GFX_ACCESS_STORAGE_READ | GFX_ACCESS_STORAGE_WRITE) ? \
 		(((stage) == 0 || ((stage) & GFX_STAGE_VERTEX) ? \
-			VK_PIPELINE_STAGE_VERTEX_SHADER_BIT : (VkPipelineStageFlags)0) | \
+			VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT_KHR : (VkPipelineStageFlags2KHR)0) | \
 		((stage) == 0 || ((stage) & GFX_STAGE_TESS_CONTROL) ? \
-			VK_PIPELINE_STAGE_TESSELLATION_CONTROL_SHADER_BIT : (VkPipelineStageFlags)0) | \
+			VK_PIPELINE_STAGE_2_TESSELLATION_CONTROL_SHADER_BIT_KHR : (VkPipelineStageFlags2KHR)0) | \
 		((stage) == 0 || ((stage) & GFX_STAGE_TESS_EVALUATION) ? \
-			VK_PIPELINE_STAGE_TESSELLATION_EVALUATION_SHADER_BIT : (VkPipelineStageFlags)0) | \
+			VK_PIPELINE_STAGE_2_TESSELLATION_EVALUATION_SHADER_BIT_KHR : (VkPipelineStageFlags2KHR)0) | \
 		((stage) == 0 || ((stage) & GFX_STAGE_GEOMETRY) ? \
-			VK_PIPELINE_STAGE_GEOMETRY_SHADER_BIT : (VkPipelineStageFlags)0) | \
+			VK_PIPELINE_STAGE_2_GEOMETRY_SHADER_BIT_KHR : (VkPipelineStageFlags2KHR)0) | \
 		((stage) == 0 || ((stage) & GFX_STAGE_FRAGMENT) ? \
-			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT : (VkPipelineStageFlags)0) | \
+			VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR : (VkPipelineStageFlags2KHR)0) | \
 		((stage) == 0 || ((stage) & GFX_STAGE_COMPUTE) ? \
-			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : (VkPipelineStageFlags)0)) : \
-		(VkPipelineStageFlags)0) | \
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR : (VkPipelineStageFlags2KHR)0)) : \
+		(VkPipelineStageFlags2KHR)0) | \
 	((mask) & GFX_ACCESS_ATTACHMENT_INPUT ? \
-		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT : (VkPipelineStageFlags)0) | \
+		VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR : (VkPipelineStageFlags2KHR)0) | \
 	((mask) & (GFX_ACCESS_ATTACHMENT_READ | GFX_ACCESS_ATTACHMENT_WRITE) ? \
 		(GFX_FORMAT_HAS_DEPTH_OR_STENCIL(fmt) ? \
-			VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | \
-			VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT : \
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT) : (VkPipelineStageFlags)0) | \
+			VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT_KHR | \
+			VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT_KHR : \
+			VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR) : (VkPipelineStageFlags2KHR)0) | \
 	((mask) & GFX_ACCESS_ATTACHMENT_RESOLVE ? \
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT : (VkPipelineStageFlags)0) | \
+		VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR : (VkPipelineStageFlags2KHR)0) | \
 	((mask) & GFX_ACCESS_TRANSFER_READ ? \
-		VK_PIPELINE_STAGE_TRANSFER_BIT : (VkPipelineStageFlags)0) | \
+		VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR : (VkPipelineStageFlags2KHR)0) | \
 	((mask) & GFX_ACCESS_TRANSFER_WRITE ? \
-		VK_PIPELINE_STAGE_TRANSFER_BIT : (VkPipelineStageFlags)0) | \
+		VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR : (VkPipelineStageFlags2KHR)0) | \
 	((mask) & GFX_ACCESS_HOST_READ ? \
-		VK_PIPELINE_STAGE_HOST_BIT : (VkPipelineStageFlags)0) | \
+		VK_PIPELINE_STAGE_2_HOST_BIT_KHR : (VkPipelineStageFlags2KHR)0) | \
 	((mask) & GFX_ACCESS_HOST_WRITE ? \
-		VK_PIPELINE_STAGE_HOST_BIT : (VkPipelineStageFlags)0))
+		VK_PIPELINE_STAGE_2_HOST_BIT_KHR : (VkPipelineStageFlags2KHR)0))
 
 #define _GFX_GET_VK_IMAGE_LAYOUT(mask, fmt) \
 	((mask) == 0 ? \
@@ -378,12 +379,33 @@
 #define _GFX_MOD_VK_PIPELINE_STAGE(vkStage, context) \
 	((vkStage) & \
 		~((!((context)->features & _GFX_SUPPORT_GEOMETRY_SHADER) ? \
-			VK_PIPELINE_STAGE_GEOMETRY_SHADER_BIT : \
-			(VkPipelineStageFlags)0) | \
+			VK_PIPELINE_STAGE_2_GEOMETRY_SHADER_BIT_KHR : \
+			(VkPipelineStageFlags2KHR)0) | \
 		(!((context)->features & _GFX_SUPPORT_TESSELLATION_SHADER) ? \
-			VK_PIPELINE_STAGE_TESSELLATION_CONTROL_SHADER_BIT | \
-			VK_PIPELINE_STAGE_TESSELLATION_EVALUATION_SHADER_BIT : \
-			(VkPipelineStageFlags)0)))
+			VK_PIPELINE_STAGE_2_TESSELLATION_CONTROL_SHADER_BIT_KHR | \
+			VK_PIPELINE_STAGE_2_TESSELLATION_EVALUATION_SHADER_BIT_KHR : \
+			(VkPipelineStageFlags2KHR)0)))
+
+
+// Synchronization2 flags to legacy flags, all legacy bits are equal,
+// finer grained (non-legacy) bits are the upper 32 bits.
+#define _GFX_GET_VK_ACCESS_FLAGS_LEGACY(vkAccess2) \
+	((VkAccessFlags)((vkAccess2) & UINT32_MAX) | \
+	((vkAccess2) & (VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR | \
+	VK_ACCESS_2_SHADER_STORAGE_READ_BIT_KHR) ? \
+		VK_ACCESS_SHADER_READ_BIT : (VkAccessFlags)0) | \
+	((vkAccess2) & VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR ? \
+		VK_ACCESS_SHADER_WRITE_BIT : (VkAccessFlags)0))
+
+#define _GFX_GET_VK_PIPELINE_STAGE_LEGACY(vkStage2) \
+	((VkPipelineStageFlags)((vkStage2) & UINT32_MAX) | \
+	((vkStage2) & (VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT_KHR | \
+	VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT_KHR) ? \
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT : (VkPipelineStageFlags)0) | \
+	((vkStage2) & (VK_PIPELINE_STAGE_2_COPY_BIT_KHR | \
+	VK_PIPELINE_STAGE_2_BLIT_BIT_KHR | VK_PIPELINE_STAGE_2_RESOLVE_BIT_KHR | \
+	VK_PIPELINE_STAGE_2_CLEAR_BIT_KHR) ? \
+		VK_PIPELINE_STAGE_TRANSFER_BIT : (VkPipelineStageFlags)0))
 
 
 /****************************
@@ -459,6 +481,10 @@ struct GFXShader
 
 	GFXShaderStage stage;
 
+	// SPIR-V bytecode identity, to validate reflection blobs.
+	size_t   codeSize;
+	uint32_t codeHash;
+
 
 	// Reflection metadata.
 	struct
@@ -497,6 +523,10 @@ struct GFXShader
 typedef struct _GFXInjection _GFXInjection;
 
 
+// Alignment of staging sub-ranges (multiple of 4, 64 and all texel block sizes).
+#define _GFX_STAGING_ALIGN 192
+
+
 /**
  * Staging buffer.
  */
@@ -505,12 +535,17 @@ typedef struct _GFXStaging
 	GFXListNode  list;  // Base-type.
 	_GFXMemAlloc alloc; // Stores the size.
 
+	// Pooled staging, sub-allocated from a persistently mapped chunk.
+	struct _GFXStaging* chunk;  // NULL if not pooled.
+	uint64_t            offset; // Within chunk (if a chunk, first unused byte).
+	unsigned int        refs;   // If a chunk, #pooled stagings using it.
+
 
 	// Vulkan fields.
 	struct
 	{
 		VkBuffer buffer;
-		void*    ptr;
+		void*    ptr; // NULL if not mapped (i.e. a retired buffer).
 
 	} vk;
 
@@ -522,15 +557,16 @@ typedef struct _GFXStaging
  */
 typedef struct _GFXTransfer
 {
-	GFXList stagings; // References _GFXStaging, automatically freed.
-	bool    flushed;
+	GFXList  stagings; // References _GFXStaging, automatically freed.
+	bool     flushed;
+	uint64_t value;    // Flush value, signaled on the timeline if any.
 
 
 	// Vulkan fields.
 	struct
 	{
 		VkCommandBuffer cmd;
-		VkFence         done; // Mostly for polling.
+		VkFence         done; // Mostly for polling, VK_NULL_HANDLE if timeline.
 
 	} vk;
 
@@ -552,17 +588,59 @@ typedef struct _GFXTransferPool
 	// #blocking threads.
 	atomic_uintmax_t blocking;
 
+	// Last flush value, increasing with every flushed transfer.
+	uint64_t value;
+
 
 	// Vulkan fields.
 	struct
 	{
 		VkCommandPool pool;
+		VkSemaphore   timeline; // VK_NULL_HANDLE if not supported.
 
 	} vk;
 
 } _GFXTransferPool;
 
 
+/**
+ * Streaming upload region, submitted in parts of whole units.
+ * A unit is a byte of a buffer or a row of blocks of an image.
+ */
+typedef struct _GFXStreamRegion
+{
+	uint64_t unit;   // Host size of a unit in bytes.
+	uint64_t units;  // #units in the region.
+	uint64_t rows;   // #units in each slice (i.e. layer or depth slice).
+	uint64_t stride; // #units between slices in host memory.
+
+} _GFXStreamRegion;
+
+
+/**
+ * Streaming upload request.
+ */
+typedef struct _GFXStreamReq
+{
+	unsigned int priority;
+	GFXReference dst;
+	VkImageType  type;        // Of the destination, if an image.
+	uint32_t     blockHeight; // Of the destination format, 1 if a buffer.
+
+	size_t       numRegions;
+	size_t       region; // Next region to submit.
+	uint64_t     done;   // Units of the next region already submitted.
+
+	size_t            numDeps;
+	GFXInject*        deps;
+	GFXRegion*        srcRegions; // Relative to data.
+	GFXRegion*        dstRegions;
+	_GFXStreamRegion* regions;
+	void*             data; // Copied source data.
+
+} _GFXStreamReq;
+
+
 /**
  * Internal heap.
  */
@@ -571,10 +649,19 @@ struct GFXHeap
 	_GFXAllocator allocator; // Has both _GFXDevice* and _GFXContext*.
 	_GFXMutex     lock;      // For allocation.
 
+	// Sub-allocation caches, one per thread, created on first use.
+	// The first is shared by all threads that are not attached.
+	// Once there are too many, threads share the others round-robin.
+	GFXList      slabs;    // References _GFXSlabCache.
+	size_t       numSlabs; // #caches in slabs.
+	GFXListNode* reuse;    // Next cache to share, may be NULL.
+	uintmax_t    id;       // Unique, finds the caches in thread local state.
+
 	GFXList buffers;    // References _GFXBuffer.
 	GFXList images;     // References _GFXImage.
 	GFXList primitives; // References _GFXPrimitive.
 	GFXList groups;     // References _GFXGroup.
+	GFXList geometry;   // References _GFXGeometry.
 
 
 	// Operation resources,
@@ -585,6 +672,27 @@ struct GFXHeap
 		_GFXTransferPool transfer;
 		uint32_t         compute; // Family index only.
 
+		// Staging pool, recycled when transfers are done.
+		struct
+		{
+			GFXList   chunks; // References _GFXStaging.
+			uint64_t  size;   // Total size of all chunks.
+			_GFXMutex lock;
+
+		} staging;
+
+		// Streaming upload queue.
+		// Requests are taken out of the queue while being submitted,
+		// cond is broadcast whenever they are done.
+		struct
+		{
+			GFXVec    requests; // Stores _GFXStreamReq*, sorted on priority.
+			GFXVec    flight;   // Stores _GFXStreamReq*, being submitted.
+			_GFXMutex lock;
+			_GFXCond  cond;
+
+		} stream;
+
 	} ops;
 };
 
@@ -600,6 +708,9 @@ typedef struct _GFXBuffer
 
 	_GFXMemAlloc alloc;
 
+	// #primitives, groups & sets referencing it (i.e. pinning it).
+	atomic_uint_least32_t refs;
+
 
 	// Vulkan fields.
 	struct
@@ -634,6 +745,33 @@ typedef struct _GFXImage
 } _GFXImage;
 
 
+/**
+ * Range of a geometry block.
+ */
+typedef struct _GFXGeomRange
+{
+	uint64_t offset;
+	uint64_t size;
+
+} _GFXGeomRange;
+
+
+/**
+ * Geometry block, shared vertex/index buffer primitives sub-allocate from.
+ */
+typedef struct _GFXGeometry
+{
+	_GFXBuffer buffer; // Linked into the heap's geometry list.
+
+	GFXMemoryFlags flags; // As requested, buffer.base.flags is modified.
+	GFXBufferUsage usage; // As requested.
+
+	GFXVec   free; // Stores _GFXGeomRange, sorted on offset.
+	uint64_t used; // Total size of all claimed ranges.
+
+} _GFXGeometry;
+
+
 /**
  * Primitive buffer (i.e. Vulkan vertex input binding).
  */
@@ -677,6 +815,14 @@ typedef struct _GFXPrimitive
 	_GFXBuffer   buffer; // vk.buffer is VK_NULL_HANDLE if nothing is allocated.
 	GFXBufferRef index;  // May be GFX_REF_NULL.
 
+	// Shared geometry, if sub-allocated instead of allocating buffer.
+	// Its buffer is bound at offset 0 with the base vertex & index baked
+	// into direct draws, so primitives in the same block bind only once.
+	_GFXGeometry* geometry; // NULL if not sub-allocated.
+	_GFXGeomRange range;
+	uint32_t      baseVertex;
+	uint32_t      baseIndex;
+
 	size_t          numBindings;
 	_GFXPrimBuffer* bindings; // Vulkan input bindings.
 
@@ -713,6 +859,14 @@ typedef struct _GFXGroup
 #define _GFX_PASS_GEN(pass) \
 	(((_GFXRenderPass*)(pass))->gen)
 
+/**
+ * Retrieve the master pass of a subpass chain from a _GFXRenderPass pointer.
+ * Evaluates to the pass itself if it is the master.
+ */
+#define _GFX_PASS_MASTER(rPass) \
+	((rPass)->out.master != NULL ? \
+		(_GFXRenderPass*)(rPass)->out.master : (rPass))
+
 
 /**
  * Attachment consumption declaration.
@@ -720,13 +874,24 @@ typedef struct _GFXGroup
 typedef struct _GFXConsume _GFXConsume;
 
 
+/**
+ * Attachment backing memory, shared by all backings aliasing it.
+ */
+typedef struct _GFXBackingMem
+{
+	_GFXMemAlloc alloc;
+	unsigned int refs; // Number of backings bound to it.
+
+} _GFXBackingMem;
+
+
 /**
  * Attachment backing.
  */
 typedef struct _GFXBacking
 {
-	GFXListNode  list; // Base-type.
-	_GFXMemAlloc alloc;
+	GFXListNode     list; // Base-type.
+	_GFXBackingMem* mem;  // Freed when no backing refers to it.
 
 	unsigned int purge; // If stale, index of frame to purge at.
 
@@ -757,6 +922,20 @@ typedef struct _GFXImageAttach
 	// Set by dependency objects, signaled out of the renderer.
 	bool signaled;
 
+	// Whether the most recent backing is lazily allocated,
+	// derived from its consumptions by the render graph.
+	bool transient;
+
+	// Lifetime in submission order, derived by the render graph.
+	// Attachments with disjoint lifetimes may share memory.
+	struct
+	{
+		unsigned int first; // UINT_MAX if never consumed.
+		unsigned int last;
+		bool         alias; // Whether it may share memory at all.
+
+	} life;
+
 
 	// Vulkan fields.
 	struct
@@ -775,7 +954,7 @@ typedef struct _GFXImageAttach
 typedef struct _GFXWindowAttach
 {
 	_GFXWindow*       window;
-	_GFXRecreateFlags flags; // Used by virtual frames, from last submission.
+	_GFXRecreateFlags flags; // Used by virtual frames, reset when rebuilt.
 
 	// Inherits all resources from window.
 
@@ -812,18 +991,210 @@ typedef struct _GFXAttach
 
 
 /**
- * Recording command pool.
+ * Recording query set (queries of a single type).
+ */
+typedef struct _GFXRecorderQueries
+{
+	uint32_t used;    // #used queries.
+	GFXVec   results; // Stores GFXQueryResult, resolved on reset.
+
+
+	// Vulkan fields.
+	struct
+	{
+		GFXVec pools; // Stores VkQueryPool, in blocks of equal size.
+
+	} vk;
+
+} _GFXRecorderQueries;
+
+
+/**
+ * Recorder state tracking limits, anything beyond is always recorded.
+ */
+#define _GFX_RECORDER_SETS 8
+#define _GFX_RECORDER_DYNAMICS 8
+#define _GFX_RECORDER_PUSH_SIZE 256
+
+
+/**
+ * Recorder bound descriptor set state.
+ */
+typedef struct _GFXRecorderSet
+{
+	VkDescriptorSet set; // VK_NULL_HANDLE if unknown.
+	uint32_t        numDynamics;
+	uint32_t        offsets[_GFX_RECORDER_DYNAMICS];
+
+} _GFXRecorderSet;
+
+
+/**
+ * Recorder descriptor set & push constant state.
+ */
+typedef struct _GFXRecorderState
+{
+	VkPipelineLayout    layout;
+	VkPipelineBindPoint point;      // Of the bound sets.
+	VkShaderStageFlags  pushStages; // Of the push constants.
+	uint32_t            pushBegin;  // Byte range [pushBegin, pushEnd).
+	uint32_t            pushEnd;
+	uint32_t            push[_GFX_RECORDER_PUSH_SIZE / sizeof(uint32_t)];
+
+	_GFXRecorderSet sets[_GFX_RECORDER_SETS];
+
+} _GFXRecorderState;
+
+
+/**
+ * Deferred recorder draw type.
+ */
+typedef enum _GFXRecorderDrawType
+{
+	_GFX_RECORDER_DRAW,
+	_GFX_RECORDER_DRAW_INDEXED,
+	_GFX_RECORDER_DRAW_INDIRECT,
+	_GFX_RECORDER_DRAW_INDEXED_INDIRECT,
+	_GFX_RECORDER_DRAW_INDIRECT_COUNT,
+	_GFX_RECORDER_DRAW_INDEXED_INDIRECT_COUNT
+
+} _GFXRecorderDrawType;
+
+
+/**
+ * Dynamic graphics state (not baked into pipelines).
+ * Contains no padding, so it can be compared bytewise.
+ */
+typedef struct _GFXDynamicState
+{
+	// Only dynamic with extended dynamic state.
+	VkCullModeFlags cullMode;
+	VkFrontFace     frontFace;
+	VkBool32        depthTest;
+	VkBool32        depthWrite;
+	VkBool32        depthBounds;
+	VkBool32        stencilTest;
+	VkCompareOp     depthCmp;
+
+	// Stencil operations are only dynamic with extended dynamic state,
+	// its masks & reference value always are.
+	VkStencilOpState front;
+	VkStencilOpState back;
+
+	// Always dynamic.
+	float minDepth;
+	float maxDepth;
+	float constants[4];
+
+} _GFXDynamicState;
+
+
+/**
+ * Recorder draw command (to be deferred).
+ */
+typedef struct _GFXRecorderDraw
+{
+	_GFXRecorderDrawType type;
+	uint64_t             key;   // Sort key.
+	size_t               state; // Deferred state index.
+	size_t               push;  // Deferred push index, SIZE_MAX for none.
+
+	_GFXCacheElem*   pipeline;
+	GFXPrimitive*    primitive; // May be NULL.
+	bool             baked;     // If geometry offsets are in the parameters.
+	_GFXDynamicState dynamic;
+
+
+	// Draw parameters.
+	union {
+		struct
+		{
+			uint32_t count; // #vertices or #indices.
+			uint32_t instances;
+			uint32_t first; // First vertex or index.
+			int32_t  vertexOffset;
+			uint32_t firstInstance;
+
+		} direct;
+
+		struct
+		{
+			VkBuffer     buffer;
+			VkDeviceSize offset;
+			VkBuffer     countBuffer; // Only for count draws.
+			VkDeviceSize countOffset;
+			uint32_t     count; // (Maximum) #draws.
+			uint32_t     stride;
+
+		} indirect;
+	};
+
+} _GFXRecorderDraw;
+
+
+/**
+ * Descriptor set used by a retained recording.
+ */
+typedef struct _GFXRecorderSetRef
+{
+	GFXSet*       set;
+	_GFXPoolElem* elem;
+	uint32_t      gen; // Modification generation of set.
+
+} _GFXRecorderSetRef;
+
+
+/**
+ * Retained recording (re-executed across frames).
+ */
+typedef struct _GFXRecorderRetained
+{
+	GFXPass* pass;
+	void*    ptr;
+	void (*cb)(GFXRecorder*, unsigned int, void*);
+
+	uint32_t gen;     // Recorder retain generation.
+	uint32_t passGen; // Pass build generation (of render passes).
+	uint32_t width;
+	uint32_t height;
+
+	bool used; // During the current use of the virtual frame.
+	bool once; // Cannot be re-executed.
+
+	GFXVec sets; // Stores _GFXRecorderSetRef.
+
+
+	// Vulkan fields.
+	struct
+	{
+		VkRenderPass    pass;
+		VkCommandBuffer cmd;
+
+	} vk;
+
+} _GFXRecorderRetained;
+
+
+/**
+ * Recording command pool (including queries).
  */
 typedef struct _GFXRecorderPool
 {
 	size_t used; // #used buffers in cmds.
 
+	// Query sets, one for each GFXQueryType.
+	_GFXRecorderQueries queries[2];
+
+	// Retained recordings.
+	GFXVec retained; // Stores _GFXRecorderRetained.
+
 
 	// Vulkan fields.
 	struct
 	{
 		VkCommandPool pool;
-		GFXVec        cmds; // Stores VkCommandBuffer.
+		VkCommandPool retained; // May be VK_NULL_HANDLE.
+		GFXVec        cmds;     // Stores VkCommandBuffer.
 
 	} vk;
 
@@ -855,18 +1226,66 @@ struct GFXRecorder
 	{
 		_GFXCacheElem* pipeline;
 		_GFXPrimitive* primitive;
+		_GFXGeometry*  geometry;  // Bound at offset 0, excludes primitive.
+		char           indexSize; // Of the index buffer bound with geometry.
+
+		_GFXRecorderState state;
+
+		bool             dynamics; // If dynamic is set.
+		_GFXDynamicState dynamic;
 
 	} bind;
 
 
+	// Deferred (sorted) recording.
+	struct
+	{
+		bool     enabled; // Set by the user.
+		bool     active;  // Within a deferred callback.
+		bool     dirtySets;
+		bool     dirtyPush;
+		uint16_t depth;
+		uint16_t hash; // Of the last state in states.
+		size_t   push; // Last push in pushes, SIZE_MAX for none.
+
+		_GFXRecorderState state; // In issue order, ahead of bind.state.
+
+		GFXVec draws;  // Stores _GFXRecorderDraw.
+		GFXVec keys;   // Stores { uint64_t, size_t } (2x #draws, sort space).
+		GFXVec states; // Stores _GFXRecorderState (push is ignored).
+		GFXVec pushes; // Stores uint32_t, { begin, end, stages, data... }.
+
+	} defer;
+
+
+	// Redundant commands that were not recorded.
+	GFXRecorderStats skipped;
+
+
+	// Retained recording.
+	struct
+	{
+		bool     enabled; // Set by the user.
+		uint32_t gen;     // Invalidation generation.
+
+		_GFXRecorderRetained* current; // Being recorded, may be NULL.
+
+	} retain;
+
+
 	// Recording output.
 	struct
 	{
-		GFXVec cmds; // Stores { unsigned int, VkCommandBuffer } (sorted).
+		GFXVec cmds; // Stores GFXVec of VkCommandBuffer, indexed by pass order.
 
 	} out;
 
 
+	// Parallel recording helpers, not linked into the renderer.
+	GFXVec helpers; // Stores GFXRecorder*.
+	bool   helper;  // Non-zero if this is a helper itself.
+
+
 	unsigned int     current; // Current virtual frame index.
 	_GFXRecorderPool pools[]; // Two { graphics, compute } for each virtual frame.
 };
@@ -892,15 +1311,80 @@ typedef struct _GFXFrameSync
 } _GFXFrameSync;
 
 
+/**
+ * Frame ring chunk (transient host visible memory).
+ */
+typedef struct _GFXFrameChunk
+{
+	GFXBuffer* buffer;
+	void*      ptr; // Persistently mapped.
+
+} _GFXFrameChunk;
+
+
+/**
+ * Frame attachment readback, issued after submission.
+ */
+typedef struct _GFXFrameRead
+{
+	size_t     index; // Attachment index.
+	void*      dst;
+	size_t     numDeps;
+	GFXInject* deps; // Allocated from the frame's arena.
+
+} _GFXFrameRead;
+
+
+/**
+ * Frame pass range (graphics command buffers recorded by a single thread).
+ */
+typedef struct _GFXFrameRange
+{
+	// Vulkan fields.
+	struct
+	{
+		VkCommandPool   pool;
+		VkCommandBuffer cmd;  // Pass commands.
+		VkCommandBuffer post; // Signal commands, submitted after cmd.
+
+	} vk;
+
+} _GFXFrameRange;
+
+
+/**
+ * Frame timer (timestamp query pair of a pass or recorder).
+ */
+typedef struct _GFXFrameTimer
+{
+	GFXPass*     pass;     // NULL if not written.
+	GFXRecorder* recorder; // NULL for the entire pass.
+	bool         compute;  // Written on the compute queue.
+
+} _GFXFrameTimer;
+
+
+// Maximum number of workers recording a single virtual frame.
+#define _GFX_FRAME_MAX_WORKERS 8
+
+
 /**
  * Internal virtual frame.
  */
 struct GFXFrame
 {
 	unsigned int index;
+	uint32_t     devices; // Device mask of the last submission.
 
 	GFXVec refs;  // Stores size_t, for each attachment; index into syncs (or SIZE_MAX).
 	GFXVec syncs; // Stores _GFXFrameSync, one for each window attachment.
+	GFXVec events; // Stores VkEvent, for split barriers in the graph.
+	GFXVec ranges; // Stores _GFXFrameRange, at least one.
+
+	// Transient host memory of a single submission, reset on synchronization.
+	// Each worker recording in parallel, but the first, has its own.
+	GFXArena arena;
+	GFXArena workers[_GFX_FRAME_MAX_WORKERS - 1];
 
 	enum {
 		_GFX_FRAME_GRAPHICS = 0x0001,
@@ -909,15 +1393,47 @@ struct GFXFrame
 	} submitted;
 
 
+	// Transient memory ring, recycled on acquisition.
+	struct
+	{
+		GFXVec       chunks;  // Stores _GFXFrameChunk.
+		size_t       current; // Index into chunks.
+		uint64_t     offset;  // Into the current chunk.
+		size_t       peak;    // Most chunks used since the last trim.
+		unsigned int resets;  // Resets since the last trim.
+		_GFXMutex    lock;
+
+	} ring;
+
+
+	// Timestamp queries, resolved on synchronization.
+	struct
+	{
+		uint32_t count;   // Number of queries in the query pool.
+		uint32_t block;   // Number of timers per pass.
+		GFXVec   timers;  // Stores _GFXFrameTimer, one for each query pair.
+		GFXVec   timings; // Stores GFXTiming.
+
+	} timer;
+
+
+	// Attachment readbacks, finished on synchronization.
+	struct
+	{
+		GFXVec pending; // Stores _GFXFrameRead, issued on submission.
+		GFXVec active;  // Stores GFXReadback*.
+
+	} reads;
+
+
 	// Vulkan fields.
 	struct
 	{
 		VkSemaphore rendered;
+		VkQueryPool queries; // May be VK_NULL_HANDLE.
 
 		struct {
-			VkCommandPool   pool;
-			VkCommandBuffer cmd;
-			VkFence         done;
+			VkFence done; // Command buffers are stored in ranges.
 
 		} graphics;
 
@@ -955,11 +1471,62 @@ struct GFXRenderer
 	GFXFrame* public; // Public frame, if not NULL, user has access.
 	GFXDeque  stales; // Stores { unsigned int, (Vk*)+ }.
 
+	// Stale destruction, amortized over frames.
+	size_t       staleReady;  // #stales at the front whose frame is done.
+	unsigned int staleBudget; // Max #stales destroyed per frame, 0 = no limit.
+
+
+	// Profiling (i.e. timestamps written by virtual frames).
+	struct
+	{
+		bool     enabled;
+		uint64_t graphics; // Valid timestamp bits of the graphics queue.
+		uint64_t compute;  // Valid timestamp bits of the compute queue.
+		float    period;   // Nanoseconds per timestamp tick.
+
+	} profile;
+
+
+	// Frame pacing (i.e. latency limit & presentation intervals).
+	struct
+	{
+		unsigned int   latency;  // Frames the GPU may be behind, 0 for no limit.
+		uint64_t       time;     // Host time of the last presentation, 0 for none.
+		uint64_t       interval; // Minimum virtual presentation interval (ns).
+		GFXPacingStats stats;
+
+	} pacing;
+
+
+	// Alternate frame rendering (across the device group).
+	struct
+	{
+		bool         enabled;
+		unsigned int next; // Index of the next device to render with.
+
+	} afr;
+
+
+	// Background pipeline compiler (a single thread, as pipeline
+	// creation is serialized by the cache anyway).
+	struct
+	{
+		bool       enabled;
+		bool       running;  // If the thread is compiling.
+		bool       joinable; // If the thread needs to be joined.
+		_GFXThread thread;
+		GFXDeque   queue;    // Stores GFXRenderable*.
+		_GFXMutex  lock;     // For the queue & thread.
+		_GFXMutex  compile;  // Held while compiling.
+
+	} compiler;
+
 
 	// Render backing (i.e. attachments).
 	struct
 	{
 		GFXVec attachs; // Stores _GFXAttach.
+		bool   live;    // Recreate without waiting for virtual frames.
 
 		enum {
 			_GFX_BACKING_INVALID,
@@ -974,13 +1541,21 @@ struct GFXRenderer
 	// Render graph (directed acyclic graph of passes).
 	struct
 	{
-		size_t numRender; // Number of render & inline compute passes.
+		size_t numRender; // Number of passes on the graphics queue.
+		size_t numEvents; // Number of split barriers (events per frame).
 		GFXVec sinks;     // Stores GFXPass* (sink passes, tree roots).
 		GFXVec passes;    // Stores GFXPass* (in submission order).
 
+		// Image view & framebuffer cache, created lazily.
+		// Entries live until the images they were created for are destroyed.
+		GFXMap    views;        // Stores _GFXHashKey : { owner, VkImageView }.
+		GFXMap    framebuffers; // Stores _GFXHashKey : VkFramebuffer.
+		_GFXMutex lock;         // For framebuffers.
+
 		enum {
 			_GFX_GRAPH_EMPTY,
 			_GFX_GRAPH_INVALID, // Needs to purge.
+			_GFX_GRAPH_CULLED,  // Needs to re-analyze, culled passes are purged.
 			_GFX_GRAPH_VALIDATED,
 			_GFX_GRAPH_WARMED,
 			_GFX_GRAPH_BUILT
@@ -1034,6 +1609,17 @@ struct _GFXConsume
 		// Non-NULL to form a dependency.
 		const _GFXConsume* prev;
 
+		// Whether this is the first consumption of any non-culled pass.
+		bool first;
+
+		// Whether prev is consumed by the same subpass chain,
+		// the dependency is then formed by a subpass dependency.
+		bool local;
+
+		// Index into the frame's events to signal after this consumption,
+		// SIZE_MAX if the next dependency is not split.
+		size_t event;
+
 	} out;
 };
 
@@ -1045,9 +1631,14 @@ struct GFXPass
 {
 	GFXPassType  type;
 	GFXRenderer* renderer;
-	unsigned int level;  // Determines submission order.
-	unsigned int order;  // Actual submission order.
-	unsigned int childs; // Number of passes this is a parent of.
+	unsigned int level;   // Determines submission order.
+	unsigned int order;   // Actual submission order.
+	unsigned int childs;  // Number of passes this is a parent of.
+	bool         async;   // Scheduled on the compute queue, set on analyze.
+	bool         promote; // Set by the user, may be scheduled async if so.
+	bool         enabled; // Set by the user, culled if not.
+	bool         culled;  // Does not contribute to any sink, set on analyze.
+	uint32_t     devices; // Device mask set by the user, 0 for all.
 
 	// Stores _GFXConsume.
 	GFXVec consumes;
@@ -1114,7 +1705,7 @@ typedef struct _GFXRenderPass
 		GFXVec       clears; // Stores VkClearValue.
 		GFXVec       blends; // Stores VkPipelineColorBlendAttachmentState.
 		GFXVec       views;  // Stores { _GFXConsume*, VkImageView }.
-		GFXVec       frames; // Stores { VkImageView, VkFramebuffer }.
+		GFXVec       frames; // Stores { VkImageView, VkFramebuffer (cached) }.
 
 	} vk;
 
@@ -1163,12 +1754,19 @@ struct GFXTechnique
 	GFXVec samplers;  // Stores { size_t set, GFXSampler }, temporary!
 	GFXVec immutable; // Stores { size_t set, size_t binding }.
 	GFXVec dynamic;   // Stores { size_t set, size_t binding }.
+	GFXVec bindless;  // Stores { size_t set, size_t binding, size_t count }.
+	GFXVec push;      // Stores { size_t set, VkDescriptorUpdateTemplate }.
+
+	// In declaration order.
+	GFXVec variants; // Stores { uint32_t id, GFXShaderStage, size_t, size_t, GFXConstant* }.
 
 
 	// Vulkan fields.
 	struct { VkPipelineLayout layout; } vk; // For locality.
 
 	// Locking output.
+	size_t         numVariants;  // 1 until locked.
+	void*          variantTable; // Specialization constants per variant, may be NULL.
 	_GFXCacheElem* layout;       // Pipeline layout, NULL until locked.
 	_GFXCacheElem* setLayouts[]; // Set layouts (sorted), all NULL until locked.
 };
@@ -1216,6 +1814,10 @@ typedef struct _GFXSetBinding
 	size_t        count;   // 0 = empty binding.
 	_GFXSetEntry* entries; // NULL if empty or immutable samplers only.
 
+	// Claimable indices.
+	size_t next; // Next never claimed index.
+	GFXVec free; // Stores size_t, released indices.
+
 } _GFXSetBinding;
 
 
@@ -1232,10 +1834,25 @@ struct GFXSet
 	// If used since last modification.
 	atomic_bool used;
 
+	// Modification generation (to invalidate retained recordings).
+	atomic_uint_least32_t gen;
+
 	size_t numAttachs;  // #referenced attachments.
 	size_t numDynamics; // #dynamic buffer entries.
 	size_t numBindings;
 
+	// Pushed into command buffers, never allocated from a pool.
+	bool push;
+
+	// Bindless (update-after-bind) descriptor set,
+	// not allocated from the renderer's pool, updated in-place.
+	struct
+	{
+		_GFXPoolElem     elem;
+		VkDescriptorPool pool; // VK_NULL_HANDLE if not bindless.
+
+	} bindless;
+
 	_GFXSetBinding bindings[]; // Sorted, no gaps.
 };
 
@@ -1354,6 +1971,11 @@ _GFXUnpackRef _gfx_ref_unpack(GFXReference ref);
  */
 struct _GFXInjection
 {
+	// Transient memory to allocate all metadata from, NULL for the heap.
+	// Set after _gfx_injection, the arena must outlive the injection.
+	GFXArena* arena;
+
+
 	// Operation input, must be pre-initialized!
 	struct
 	{
@@ -1374,16 +1996,26 @@ struct _GFXInjection
 	// Injected (to-be-flushed) barriers.
 	struct
 	{
-		// Barrier metadata.
-		VkPipelineStageFlags srcStage;
-		VkPipelineStageFlags dstStage;
+		// Barrier metadata, union of all (synchronization2) stages.
+		VkPipelineStageFlags2KHR srcStage;
+		VkPipelineStageFlags2KHR dstStage;
+
+		// Execution-only barrier stages.
+		VkPipelineStageFlags2KHR srcExec;
+		VkPipelineStageFlags2KHR dstExec;
+
+		// Memory barriers, each with their own stages.
+		size_t                     numBufs;
+		VkBufferMemoryBarrier2KHR* bufs;
 
-		// Memory barriers.
-		size_t                 numBufs;
-		VkBufferMemoryBarrier* bufs;
+		size_t                    numImgs;
+		VkImageMemoryBarrier2KHR* imgs;
 
-		size_t                numImgs;
-		VkImageMemoryBarrier* imgs;
+#if !defined (NDEBUG)
+		// Statistics, added to the context's when flushed.
+		size_t numPushed;
+		size_t numMerged;
+#endif
 
 	} bars;
 
@@ -1400,6 +2032,12 @@ struct _GFXInjection
 		// Wait stages, of the same size as waits.
 		VkPipelineStageFlags* stages;
 
+		// Timeline values, of the same size as waits and sigs.
+		// Values of binary semaphores are zero (and ignored).
+		uint64_t* waitValues;
+		uint64_t* sigValues;
+		bool      timeline; // Non-zero if any timeline semaphore is output.
+
 	} out;
 };
 
@@ -1423,7 +2061,7 @@ typedef struct _GFXSync
 	// Stage in the object's lifecycle.
 	enum
 	{
-		_GFX_SYNC_UNUSED, // Only `flags` and `vk.signaled` are defined.
+		_GFX_SYNC_UNUSED, // Only `flags` and `vk.{ signaled, value, sigQueue }` are defined.
 		_GFX_SYNC_PREPARE,
 		_GFX_SYNC_PREPARE_CATCH, // Within the same injection.
 		_GFX_SYNC_PENDING,
@@ -1447,15 +2085,19 @@ typedef struct _GFXSync
 	struct
 	{
 		VkSemaphore signaled; // May be VK_NULL_HANDLE.
+		uint64_t    value;    // Last signaled value, if a timeline semaphore.
+
+		// Queue that last signaled, if a timeline semaphore with value > 0.
+		struct { uint32_t family, index; } sigQueue;
 
-		// Barrier metadata.
-		VkAccessFlags srcAccess;
-		VkAccessFlags dstAccess;
-		VkImageLayout oldLayout;
-		VkImageLayout newLayout;
-		VkPipelineStageFlags srcStage;
-		VkPipelineStageFlags dstStage;
-		VkPipelineStageFlags semStages; // Only set if `signaled` is used.
+		// Barrier metadata (synchronization2 flags).
+		VkAccessFlags2KHR        srcAccess;
+		VkAccessFlags2KHR        dstAccess;
+		VkImageLayout            oldLayout;
+		VkImageLayout            newLayout;
+		VkPipelineStageFlags2KHR srcStage;
+		VkPipelineStageFlags2KHR dstStage;
+		VkPipelineStageFlags2KHR semStages; // Only set if `signaled` is used.
 
 		// Family & queue indices.
 		struct { uint32_t family; } srcQueue;
@@ -1481,6 +2123,7 @@ struct GFXDependency
 	_GFXContext* context;
 
 	unsigned int waitCapacity;
+	bool         timeline; // Uses timeline semaphores, capacity is ignored.
 
 	size_t    sems;  // #semaphores at the front of `syncs`.
 	GFXDeque  syncs; // Stores _GFXSync.
@@ -1499,23 +2142,52 @@ struct GFXDependency
  */
 static inline void _gfx_injection(_GFXInjection* injection)
 {
+	injection->arena = NULL;
+
 	injection->bars.srcStage = 0;
 	injection->bars.dstStage = 0;
+	injection->bars.srcExec = 0;
+	injection->bars.dstExec = 0;
 	injection->bars.numBufs = 0;
 	injection->bars.bufs = NULL;
 	injection->bars.numImgs = 0;
 	injection->bars.imgs = NULL;
+#if !defined (NDEBUG)
+	injection->bars.numPushed = 0;
+	injection->bars.numMerged = 0;
+#endif
 
 	injection->out.numWaits = 0;
 	injection->out.waits = NULL;
 	injection->out.numSigs = 0;
 	injection->out.sigs = NULL;
 	injection->out.stages = NULL;
+	injection->out.waitValues = NULL;
+	injection->out.sigValues = NULL;
+	injection->out.timeline = 0;
+}
+
+/**
+ * (Re)allocates injection metadata, from the injection's arena if it has one.
+ * @param ptr     May be NULL, must be allocated through this function.
+ * @param oldSize Number of bytes of (the start of) ptr to preserve.
+ * @return NULL on failure, in which case ptr is left untouched.
+ */
+static inline void* _gfx_injection_realloc(_GFXInjection* injection,
+                                           void* ptr, size_t oldSize,
+                                           size_t size)
+{
+	return injection->arena != NULL ?
+		gfx_arena_realloc(injection->arena, ptr, oldSize, size) :
+		realloc(ptr, size);
 }
 
 /**
  * Flushes all stored barriers injected by _gfx_injection_push.
  * Automatically flushed by a successful call to _gfx_deps_(catch|prepare).
+ * With synchronization2 all barriers are recorded in a single
+ * vkCmdPipelineBarrier2KHR call, each barrier keeping its own stages.
+ * Otherwise they are recorded using the batch-wide stages.
  * @param context   Cannot be NULL.
  * @param cmd       To record all barriers to, cannot be VK_NULL_HANDLE.
  * @param injection Barrier metadata to flush, cannot be NULL.
@@ -1532,11 +2204,15 @@ void _gfx_injection_flush(_GFXContext* context, VkCommandBuffer cmd,
  * @return Zero on failure.
  *
  * Can only set one of `bmb` OR `imb` to non-NULL!
- */
-bool _gfx_injection_push(VkPipelineStageFlags srcStage,
-                         VkPipelineStageFlags dstStage,
-                         const VkBufferMemoryBarrier* bmb,
-                         const VkImageMemoryBarrier* imb,
+ * The stage masks of `bmb` or `imb` are ignored, srcStage and dstStage are used.
+ * Memory barriers are merged into an already pushed barrier of the same
+ * resource, layouts and queue families if their ranges overlap or touch,
+ * the result barrier covers both ranges and access masks.
+ */
+bool _gfx_injection_push(VkPipelineStageFlags2KHR srcStage,
+                         VkPipelineStageFlags2KHR dstStage,
+                         const VkBufferMemoryBarrier2KHR* bmb,
+                         const VkImageMemoryBarrier2KHR* imb,
                          _GFXInjection* injection);
 
 /**
@@ -1615,15 +2291,51 @@ void _gfx_deps_finish(size_t numInjs, const GFXInject* injs,
  ****************************/
 
 /**
- * Allocates a backing image from a heap.
+ * Creates a backing image from a heap, without any memory bound to it.
  * @param heap   Cannot be NULL.
  * @param attach Cannot be NULL, { .width, .height, .depth } > 0.
+ * @param reqs   Cannot be NULL, outputs the memory requirements.
+ * @param share  Cannot be NULL, outputs whether it can share memory.
+ * @return NULL on failure.
  *
  * Thread-safe with respect to the heap!
  * Leaves the `purge` index and `list` base-type uninitialized!
+ * The `mem` field is set to NULL. An image cannot share memory if it
+ * requires dedicated or lazily allocated memory.
+ */
+_GFXBacking* _gfx_create_backing(GFXHeap* heap,
+                                 const _GFXImageAttach* attach,
+                                 VkMemoryRequirements* reqs, bool* share);
+
+/**
+ * Allocates new memory and binds backing images to it, sharing it.
+ * @param heap     Cannot be NULL.
+ * @param attach   Cannot be NULL, memory flags are taken from it.
+ * @param reqs     Cannot be NULL, must satisfy all backings.
+ * @param num      Must be > 0.
+ * @param backings Cannot be NULL, backings without any memory bound.
+ * @return Zero on failure, no memory will be bound.
+ *
+ * Thread-safe with respect to the heap!
+ * Only a single backing may get a dedicated allocation.
  */
-_GFXBacking* _gfx_alloc_backing(GFXHeap* heap,
-                                const _GFXImageAttach* attach);
+bool _gfx_bind_backings(GFXHeap* heap, const _GFXImageAttach* attach,
+                        const VkMemoryRequirements* reqs,
+                        size_t num, _GFXBacking** backings);
+
+/**
+ * Binds a backing image to the memory of another backing, sharing it.
+ * @param heap    Cannot be NULL.
+ * @param backing Cannot be NULL, backing without any memory bound.
+ * @param reqs    Cannot be NULL, memory requirements of backing.
+ * @param alias   Cannot be NULL, backing to share memory with.
+ * @return Zero if it does not fit in the memory of alias (or on failure).
+ *
+ * Thread-safe with respect to the heap!
+ */
+bool _gfx_bind_backing_alias(GFXHeap* heap, _GFXBacking* backing,
+                             const VkMemoryRequirements* reqs,
+                             _GFXBacking* alias);
 
 /**
  * Frees a backing image.
@@ -1632,6 +2344,8 @@ _GFXBacking* _gfx_alloc_backing(GFXHeap* heap,
  *
  * Thread-safe with respect to the heap!
  * Does not unlink itself from anything!
+ * Its memory is only freed once no other backing is bound to it anymore,
+ * backing may not have any memory bound to it yet.
  */
 void _gfx_free_backing(GFXHeap* heap, _GFXBacking* backing);
 
@@ -1643,6 +2357,8 @@ void _gfx_free_backing(GFXHeap* heap, _GFXBacking* backing);
  *
  * Thread-safe with respect to the heap!
  * Leaves the `list` base-type uninitialized!
+ * Small upload (transfer source) stagings are sub-allocated from the
+ * staging pool of the heap, all copies must add the `offset` field.
  */
 _GFXStaging* _gfx_alloc_staging(GFXHeap* heap,
                                 VkBufferUsageFlags usage, uint64_t size);
@@ -1654,6 +2370,7 @@ _GFXStaging* _gfx_alloc_staging(GFXHeap* heap,
  *
  * Thread-safe with respect to the heap!
  * Does not unlink itself from anything!
+ * Pooled stagings give their range back to the staging pool.
  */
 void _gfx_free_staging(GFXHeap* heap, _GFXStaging* staging);
 
@@ -1678,6 +2395,80 @@ void _gfx_free_stagings(GFXHeap* heap, _GFXTransfer* transfer);
  */
 bool _gfx_flush_transfer(GFXHeap* heap, _GFXTransferPool* pool);
 
+/**
+ * Polls whether a flushed transfer operation of a transfer pool is done.
+ * @param heap     Cannot be NULL.
+ * @param pool     Cannot be NULL, must be of heap.
+ * @param transfer Cannot be NULL, must be of pool and flushed.
+ * @param counter  In/out cached timeline counter of pool, cannot be NULL.
+ * @return VK_SUCCESS if done, VK_NOT_READY if not, other on failure.
+ *
+ * Not thread-safe with respect to the pool!
+ * Initialize counter to zero, if the pool uses a timeline semaphore it is
+ * only queried when the cached counter has not reached the transfer yet.
+ */
+VkResult _gfx_transfer_status(GFXHeap* heap, _GFXTransferPool* pool,
+                              const _GFXTransfer* transfer, uint64_t* counter);
+
+/**
+ * Blocks until a flushed transfer operation of a transfer pool is done.
+ * @param heap  Cannot be NULL.
+ * @param pool  Cannot be NULL, must be of heap.
+ * @param value Timeline value of the transfer operation.
+ * @param done  Fence of the transfer operation.
+ * @return Zero on failure.
+ *
+ * Thread-safe with respect to the pool, only the pool's timeline is read,
+ * meaning the pool does not need to be locked to wait.
+ * If the pool does not use a timeline semaphore, the caller must make sure
+ * the fence is not reset or destroyed during this call (see `blocking`).
+ */
+bool _gfx_transfer_wait(GFXHeap* heap, _GFXTransferPool* pool,
+                        uint64_t value, VkFence done);
+
+/**
+ * Adds or removes a reference to the buffer that a resource reference points
+ * to, a referenced buffer is never moved by gfx_heap_defragment.
+ * @param ref     Any reference, ignored if it does not point to a buffer.
+ * @param own     Buffer to ignore references to, may be NULL.
+ * @param release Non-zero to remove a reference instead of adding one.
+ *
+ * Thread-safe.
+ */
+void _gfx_buffer_refer(GFXReference ref, const _GFXBuffer* own, bool release);
+
+/**
+ * Records a copy from an old Vulkan buffer to the current one of a buffer,
+ * in the current transfer operation of the graphics pool of the heap.
+ * @param heap   Cannot be NULL.
+ * @param buffer Cannot be NULL, must be of heap.
+ * @param old    Cannot be NULL, must be of the same size as buffer.
+ * @param dep    Cannot be NULL, signaled with respect to buffer.
+ * @return Zero on failure, current transfer is lost.
+ *
+ * Thread-safe with respect to the heap!
+ * On success, old is freed when the transfer operation is done.
+ * The old buffer must have been created with VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+ * and the current one with VK_BUFFER_USAGE_TRANSFER_DST_BIT.
+ */
+bool _gfx_move_buffer(GFXHeap* heap, _GFXBuffer* buffer,
+                      _GFXStaging* old, GFXDependency* dep);
+
+/**
+ * Reads data from a memory resource reference without blocking,
+ * copying only on some of the physical devices of the device group.
+ * @param devices Device mask to copy on, 0 for all devices.
+ * @see gfx_read_async.
+ *
+ * With more than one device in the mask, they all write to dst.
+ */
+GFXReadback* _gfx_read_async(GFXReference src, void* dst,
+                             GFXTransferFlags flags, uint32_t devices,
+                             size_t numRegions, size_t numDeps,
+                             const GFXRegion* srcRegions,
+                             const GFXRegion* dstRegions,
+                             const GFXInject* deps);
+
 
 /****************************
  * Pipeline creation & warmup.
@@ -1696,6 +2487,49 @@ bool _gfx_flush_transfer(GFXHeap* heap, _GFXTransferPool* pool);
 bool _gfx_renderable_pipeline(GFXRenderable* renderable,
                               _GFXCacheElem** elem, bool warmup);
 
+/**
+ * Retrieves the dynamic state of a renderable, i.e. all render state
+ * that is not baked into its graphics pipeline.
+ * @param renderable Cannot be NULL.
+ * @param dynamic    Cannot be NULL.
+ *
+ * Completely thread-safe with respect to the renderable!
+ */
+void _gfx_renderable_dynamic(const GFXRenderable* renderable,
+                             _GFXDynamicState* dynamic);
+
+/**
+ * Retrieves a graphics pipeline from the renderer's cache, if not present,
+ * it is queued for compilation by the renderer's compiler thread instead.
+ * @param renderable Cannot be NULL.
+ * @param elem       Output cache element, NULL if not present, cannot be NULL.
+ * @return Zero on failure.
+ *
+ * Completely thread-safe with respect to the renderable!
+ */
+bool _gfx_renderable_pipeline_async(GFXRenderable* renderable,
+                                    _GFXCacheElem** elem);
+
+/**
+ * Initializes the background pipeline compiler of a renderer.
+ * @param renderer Cannot be NULL.
+ * @return Zero on failure.
+ */
+bool _gfx_render_compiler_init(GFXRenderer* renderer);
+
+/**
+ * Clears the background pipeline compiler of a renderer.
+ * Will block until the compiler thread is done.
+ * @param renderer Cannot be NULL.
+ */
+void _gfx_render_compiler_clear(GFXRenderer* renderer);
+
+/**
+ * Forgets all queued pipelines and blocks until the compiler thread is done.
+ * @param renderer Cannot be NULL.
+ */
+void _gfx_render_compiler_drain(GFXRenderer* renderer);
+
 /**
  * Retrieves a compute pipeline from the renderer's cache (or warms it up).
  * Essentially a wrapper for _gfx_cache_(get|warmup).
@@ -1741,6 +2575,7 @@ uint32_t _gfx_frame_get_swapchain_index(GFXFrame* frame, size_t index);
 /**
  * Blocks until all pending submissions of a virtual frame are done
  * and subsequently resets all command pools.
+ * When resetting, all written timestamps are resolved into timings.
  * @param renderer Cannot be NULL.
  * @param frame    Cannot be NULL.
  * @param reset    Non-zero to also reset command pools.
@@ -1770,7 +2605,10 @@ bool _gfx_frame_acquire(GFXRenderer* renderer, GFXFrame* frame);
  * @param frame    Cannot be NULL.
  * @return Zero if the frame could not be submitted.
  *
+ * Issues all pending attachment readbacks after the frame is submitted.
  * This will consume (not erase) all elements in renderer->deps!
+ * Render and inline compute passes are recorded by multiple threads,
+ * spawned and joined within this call.
  * Failure is considered fatal, swapchains could be left in an incomplete state.
  */
 bool _gfx_frame_submit(GFXRenderer* renderer, GFXFrame* frame);
@@ -1815,11 +2653,27 @@ void _gfx_render_backing_rebuild(GFXRenderer* renderer, _GFXRecreateFlags flags)
  */
 void _gfx_render_backing_purge(GFXRenderer* renderer);
 
+/**
+ * Re-evaluates which image attachments can be transient (i.e. lazily
+ * allocated) and which can share memory, replacing the backing of any
+ * attachment that changed.
+ * @param renderer Cannot be NULL.
+ *
+ * An attachment is transient if it only has attachment usages and all
+ * passes that consume it specify GFX_ACCESS_DISCARD.
+ * Attachments only consumed by the graphics queue, whose contents are not
+ * loaded by their first consumption, may share memory if their lifetimes
+ * (first to last consumption in submission order) do not overlap.
+ * Replaced backings are purged when the current frame is acquired again.
+ */
+void _gfx_render_backing_analyze(GFXRenderer* renderer);
+
 /**
  * Initializes the render graph of a renderer.
  * @param renderer Cannot be NULL.
+ * @return Zero on failure.
  */
-void _gfx_render_graph_init(GFXRenderer* renderer);
+bool _gfx_render_graph_init(GFXRenderer* renderer);
 
 /**
  * Clears the render graph of a renderer, destroying all passes.
@@ -1855,6 +2709,9 @@ bool _gfx_render_graph_build(GFXRenderer* renderer);
  * @param renderer Cannot be NULL.
  * @param flags    Must contain the _GFX_RECREATE bit.
  *
+ * Only passes of which a consumed attachment changed are rebuilt, i.e. a
+ * window attachment with recreate flags set or a recreated image attachment.
+ *
  * This will call the relevant _gfx_pass_rebuild calls.
  * Thus not thread-safe with respect to pushing stale resources!
  */
@@ -1879,6 +2736,62 @@ void _gfx_render_graph_destruct(GFXRenderer* renderer);
  */
 void _gfx_render_graph_invalidate(GFXRenderer* renderer);
 
+/**
+ * Re-evaluates which passes of the render graph are culled, only the passes
+ * affected by any change are destructed and the graph is re-analyzed the
+ * next time _gfx_render_graph_(warmup|build) is called.
+ * Suitable for when passes are enabled or disabled.
+ * @param renderer Cannot be NULL.
+ *
+ * This will call the relevant _gfx_pass_destruct calls.
+ * Thus not thread-safe with respect to pushing stale resources!
+ */
+void _gfx_render_graph_cull(GFXRenderer* renderer);
+
+/**
+ * Retrieves a framebuffer from the render graph's framebuffer cache,
+ * creating it if it does not exist yet.
+ * @param renderer Cannot be NULL.
+ * @param pass     Vulkan render pass to be compatible with.
+ * @param numViews Number of image views (framebuffer attachments).
+ * @param views    Cannot be NULL if numViews > 0.
+ * @return VK_NULL_HANDLE on failure.
+ *
+ * The graph's lock must be locked!
+ */
+VkFramebuffer _gfx_render_graph_framebuffer(GFXRenderer* renderer,
+                                            VkRenderPass pass,
+                                            uint32_t width, uint32_t height,
+                                            uint32_t layers,
+                                            size_t numViews,
+                                            const VkImageView* views);
+
+/**
+ * Retrieves an image view from the render graph's image view cache,
+ * creating it if it does not exist yet.
+ * @param renderer Cannot be NULL.
+ * @param owner    Backing or window owning ivci->image, cannot be NULL.
+ * @param ivci     Cannot be NULL, pNext must be NULL.
+ * @return VK_NULL_HANDLE on failure.
+ *
+ * Views are keyed on their image, format and subresource range, so they
+ * (and the framebuffers using them) survive rebuilding passes.
+ * Not thread-safe with respect to pushing stale resources!
+ */
+VkImageView _gfx_render_graph_view(GFXRenderer* renderer, const void* owner,
+                                   const VkImageViewCreateInfo* ivci);
+
+/**
+ * Evicts all image views of an owner from the render graph's cache,
+ * and all framebuffers referencing them, making them stale.
+ * Must be called before the images of the owner are destroyed.
+ * @param renderer Cannot be NULL.
+ * @param owner    Backing or window to evict for.
+ *
+ * Not thread-safe with respect to pushing stale resources!
+ */
+void _gfx_render_graph_evict(GFXRenderer* renderer, const void* owner);
+
 
 /****************************
  * Pass (nodes in the render graph).
@@ -1908,9 +2821,10 @@ void _gfx_destroy_pass(GFXPass* pass);
 
 /**
  * Retrieves the current framebuffer of a pass with respect to a frame.
+ * Framebuffers are created lazily through the render graph's cache.
  * @param rPass Cannot be NULL.
  * @param frame Cannot be NULL.
- * @return VK_NULL_HANDLE if unknown.
+ * @return VK_NULL_HANDLE if unknown or on failure.
  */
 VkFramebuffer _gfx_pass_framebuffer(_GFXRenderPass* rPass, GFXFrame* frame);
 
@@ -1942,6 +2856,8 @@ bool _gfx_pass_build(_GFXRenderPass* rPass);
  * @param flags Must contain the _GFX_RECREATE bit.
  * @return Non-zero if rebuilt successfully.
  *
+ * No-op if none of the consumed attachments were recreated.
+ *
  * Not thread-safe with respect to pushing stale resources!
  */
 bool _gfx_pass_rebuild(_GFXRenderPass* rPass, _GFXRecreateFlags flags);
@@ -1986,7 +2902,9 @@ bool _gfx_push_stale(GFXRenderer* renderer,
                      VkFramebuffer framebuffer,
                      VkImageView imageView,
                      VkBufferView bufferView,
-                     VkCommandPool commandPool);
+                     VkCommandPool commandPool,
+                     VkQueryPool queryPool,
+                     VkDescriptorPool descriptorPool);
 
 /**
  * Blocks until all frames in a renderer's render frame are done.
@@ -2001,30 +2919,47 @@ bool _gfx_sync_frames(GFXRenderer* renderer);
 /**
  * Resets a recording pool, i.e. resets all command buffers
  * and sets the new current recording pool(s) to use for recording commands.
+ * Before resetting, all query results of the new current pools are resolved,
+ * the virtual frame must be done rendering.
  * @param recorder Cannot be NULL.
  * @return Non-zero if successfully reset.
  */
 bool _gfx_recorder_reset(GFXRecorder* recorder);
 
+/**
+ * Records commands to reset all queries used by a recorder for the current
+ * virtual frame, must be recorded before any of its output is recorded.
+ * @param recorder Cannot be NULL.
+ * @param compute  Non-zero to reset the queries of the compute queue.
+ * @param cmd      Cannot be NULL, cannot be in a render pass (!).
+ */
+void _gfx_recorder_reset_queries(GFXRecorder* recorder,
+                                 bool compute, VkCommandBuffer cmd);
+
 /**
  * Records the recording output of a recorder into a given command buffer.
  * The command buffer must be in the recording state (!).
  * @param recorder Cannot be NULL.
  * @param order    Buffers that were output with this order will be recorded.
  * @param cmd      Cannot be NULL, must be in the render pass of `order` (!).
+ * @param queries  Query pool to write timestamps to, may be VK_NULL_HANDLE.
+ * @param query    Index of the first of two (reset) timestamp queries.
+ * @return Non-zero if anything was recorded (and timestamps were written).
  */
-void _gfx_recorder_record(GFXRecorder* recorder,
-                          unsigned int order, VkCommandBuffer cmd);
+bool _gfx_recorder_record(GFXRecorder* recorder,
+                          unsigned int order, VkCommandBuffer cmd,
+                          VkQueryPool queries, uint32_t query);
 
 /**
  * Retrieves all Vulkan specialization constant info and map entries.
  * @param technique Cannot be NULL, must be locked.
+ * @param variant   Must be < `technique->numVariants`.
  * @param infos     `_GFX_NUM_SHADER_STAGES` VkSpecilizationInfo structs.
  * @param entries   `technique->constants.size` VkSpecializationMapEntry structs.
  *
  * All output entries are sorted on { stage, constantID }.
  */
-void _gfx_tech_get_constants(GFXTechnique* technique,
+void _gfx_tech_get_constants(GFXTechnique* technique, size_t variant,
                              VkSpecializationInfo* infos,
                              VkSpecializationMapEntry* entries);
 
@@ -2050,6 +2985,24 @@ void _gfx_tech_get_set_size(GFXTechnique* technique,
 bool _gfx_tech_get_set_binding(GFXTechnique* technique,
                                size_t set, size_t binding, _GFXSetBinding* out);
 
+/**
+ * Retrieves whether a specific descriptor set layout within a technique is
+ * bindless, i.e. created with the update-after-bind flags.
+ * @param technique Cannot be NULL, must be locked.
+ * @param set       Must be < technique->numSets.
+ */
+bool _gfx_tech_is_bindless(GFXTechnique* technique, size_t set);
+
+/**
+ * Retrieves the push descriptor update template of a specific descriptor
+ * set layout within a technique.
+ * @param technique Cannot be NULL, must be locked.
+ * @param set       Must be < technique->numSets.
+ * @return VK_NULL_HANDLE if the set is not pushed.
+ */
+VkDescriptorUpdateTemplate _gfx_tech_get_push(GFXTechnique* technique,
+                                              size_t set);
+
 /**
  * Retrieves, allocates or recycles a Vulkan descriptor set of the given set.
  * @param set Cannot be NULL.
@@ -2062,5 +3015,19 @@ bool _gfx_tech_get_set_binding(GFXTechnique* technique,
  */
 _GFXPoolElem* _gfx_set_get(GFXSet* set, _GFXPoolSub* sub);
 
+/**
+ * Records pushing all descriptors of a push descriptor set.
+ * @param set      Cannot be NULL, must be a push descriptor set.
+ * @param cmd      Command buffer to record into.
+ * @param template Push descriptor update template of the technique.
+ * @param layout   Pipeline layout of the technique.
+ * @param index    Set number within the pipeline layout.
+ *
+ * Thread-safe with respect to the set, just like _gfx_set_get.
+ */
+void _gfx_set_push(GFXSet* set, VkCommandBuffer cmd,
+                   VkDescriptorUpdateTemplate template,
+                   VkPipelineLayout layout, uint32_t index);
+
 
 #endif
@@ -50,7 +50,8 @@ typedef enum _GFXCopyFlags
 {
 	_GFX_COPY_REVERSED = 0x0001,
 	_GFX_COPY_SCALED   = 0x0002,
-	_GFX_COPY_RESOLVE  = 0x0004
+	_GFX_COPY_RESOLVE  = 0x0004,
+	_GFX_COPY_MIPMAPS  = 0x0008
 
 } _GFXCopyFlags;
 
@@ -66,6 +67,50 @@ typedef struct _GFXStageRegion
 } _GFXStageRegion;
 
 
+/****************************
+ * Internal copy operation, a single source, destination & regions set.
+ */
+typedef struct _GFXCopyOp
+{
+	const _GFXUnpackRef*   src; // NULL to copy (from|to) the staging buffer.
+	const _GFXUnpackRef*   dst;
+	const _GFXStageRegion* stage; // Cannot be NULL if src is NULL.
+	const GFXRegion*       srcRegions;
+	const GFXRegion*       dstRegions;
+	size_t                 numRegions;
+	uint32_t               devices; // Device mask to copy on, 0 for all.
+
+	// Resolved by _gfx_copy_resolve.
+	const _GFXImageAttach* attach;
+	VkBuffer               srcBuffer;
+	VkBuffer               dstBuffer;
+	VkImage                srcImage;
+	VkImage                dstImage;
+	const _GFXImage*       mipImage;  // Image to generate mipmaps of, or NULL.
+	GFXFilter              mipFilter;
+
+} _GFXCopyOp;
+
+
+/****************************
+ * Asynchronous read operation (readback) definition.
+ */
+struct GFXReadback
+{
+	GFXHeap*          heap;
+	_GFXTransferPool* pool;
+	uint64_t          value;   // Flush value of the transfer operation.
+	_GFXStaging*      staging; // NULL once done.
+	bool              done;
+
+	// Host copy, stage & dstRegions are allocated along with the readback.
+	void*            dst;
+	size_t           numRegions;
+	_GFXStageRegion* stage;
+	GFXRegion*       dstRegions;
+};
+
+
 /****************************
  * Computes a list of staging regions that compact (modify) the regions
  * associated with the host pointer, solely for staging buffer allocation.
@@ -286,15 +331,20 @@ static _GFXTransfer* _gfx_claim_transfer(GFXHeap* heap, _GFXTransferPool* pool)
 	// This way we end up with round-robin like behaviour :)
 	// Note we check if the host is blocking for any transfers,
 	// if so, we cannot reset the fence, so skip recycling...
-	const bool isBlocking = atomic_load(&pool->blocking) > 0;
+	// Unless we use a timeline semaphore, then there is no fence to reset.
+	const bool isBlocking =
+		pool->vk.timeline == VK_NULL_HANDLE &&
+		atomic_load(&pool->blocking) > 0;
+
 	_GFXTransfer newTransfer;
 
 	if (!isBlocking && pool->transfers.size > 0)
 	{
 		_GFXTransfer* transfer = gfx_deque_at(&pool->transfers, 0);
 
-		VkResult result = context->vk.GetFenceStatus(
-			context->vk.device, transfer->vk.done);
+		uint64_t counter = 0;
+		VkResult result =
+			_gfx_transfer_status(heap, pool, transfer, &counter);
 
 		if (result == VK_SUCCESS)
 		{
@@ -306,11 +356,13 @@ static _GFXTransfer* _gfx_claim_transfer(GFXHeap* heap, _GFXTransferPool* pool)
 
 			_gfx_free_stagings(heap, &newTransfer);
 			newTransfer.flushed = 0;
+			newTransfer.value = 0;
 
-			_GFX_VK_CHECK(
-				context->vk.ResetFences(
-					context->vk.device, 1, &newTransfer.vk.done),
-				goto clean);
+			if (newTransfer.vk.done != VK_NULL_HANDLE)
+				_GFX_VK_CHECK(
+					context->vk.ResetFences(
+						context->vk.device, 1, &newTransfer.vk.done),
+					goto clean);
 
 			// Finish this new transfer.
 			goto finish;
@@ -327,6 +379,7 @@ static _GFXTransfer* _gfx_claim_transfer(GFXHeap* heap, _GFXTransferPool* pool)
 	// At this point we apparently need to create a new transfer object.
 	gfx_list_init(&newTransfer.stagings);
 	newTransfer.flushed = 0;
+	newTransfer.value = 0;
 	newTransfer.vk.cmd = NULL;
 	newTransfer.vk.done = VK_NULL_HANDLE;
 
@@ -343,15 +396,19 @@ static _GFXTransfer* _gfx_claim_transfer(GFXHeap* heap, _GFXTransferPool* pool)
 	_GFX_VK_CHECK(context->vk.AllocateCommandBuffers(
 		context->vk.device, &cbai, &newTransfer.vk.cmd), goto clean);
 
-	// And create fence.
-	VkFenceCreateInfo fci = {
-		.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-		.pNext = NULL,
-		.flags = 0
-	};
+	// And create fence, if not signaling the pool's timeline.
+	if (pool->vk.timeline == VK_NULL_HANDLE)
+	{
+		VkFenceCreateInfo fci = {
+			.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+			.pNext = NULL,
+			.flags = 0
+		};
 
-	_GFX_VK_CHECK(context->vk.CreateFence(
-		context->vk.device, &fci, NULL, &newTransfer.vk.done), goto clean);
+		_GFX_VK_CHECK(context->vk.CreateFence(
+			context->vk.device, &fci, NULL, &newTransfer.vk.done),
+			goto clean);
+	}
 
 finish:
 	// We have a new transfer operation object,
@@ -440,6 +497,8 @@ bool _gfx_flush_transfer(GFXHeap* heap, _GFXTransferPool* pool)
 	assert(heap != NULL);
 	assert(pool != NULL);
 
+	gfx_trace_begin(flush, "_gfx_flush_transfer");
+
 	_GFXContext* context = heap->allocator.context;
 
 	// See if we have any injection metadata to flush with & finish.
@@ -459,18 +518,50 @@ bool _gfx_flush_transfer(GFXHeap* heap, _GFXTransferPool* pool)
 			context->vk.EndCommandBuffer(transfer->vk.cmd),
 			goto clean);
 
+		// If using a timeline semaphore, append it to the signal semaphores.
+		// Values of binary semaphores are ignored.
+		const bool timeline = pool->vk.timeline != VK_NULL_HANDLE;
+		const bool values = timeline || injection->out.timeline;
+		const size_t numSigs = injection->out.numSigs + (timeline ? 1 : 0);
+		const uint64_t value = pool->value + 1;
+
+		VkSemaphore sigs[numSigs > 0 ? numSigs : 1];
+		uint64_t sigValues[numSigs > 0 ? numSigs : 1];
+
+		if (injection->out.numSigs > 0) memcpy(
+			sigs, injection->out.sigs,
+			sizeof(VkSemaphore) * injection->out.numSigs);
+
+		if (injection->out.numSigs > 0) memcpy(
+			sigValues, injection->out.sigValues,
+			sizeof(uint64_t) * injection->out.numSigs);
+
+		if (timeline)
+			sigs[numSigs - 1] = pool->vk.timeline,
+			sigValues[numSigs - 1] = value;
+
+		VkTimelineSemaphoreSubmitInfo tssi = {
+			.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+
+			.pNext                     = NULL,
+			.waitSemaphoreValueCount   = (uint32_t)injection->out.numWaits,
+			.pWaitSemaphoreValues      = injection->out.waitValues,
+			.signalSemaphoreValueCount = (uint32_t)numSigs,
+			.pSignalSemaphoreValues    = sigValues
+		};
+
 		// Lock queue and submit.
 		VkSubmitInfo si = {
 			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
 
-			.pNext                = NULL,
+			.pNext                = values ? &tssi : NULL,
 			.waitSemaphoreCount   = (uint32_t)injection->out.numWaits,
 			.pWaitSemaphores      = injection->out.waits,
 			.pWaitDstStageMask    = injection->out.stages,
 			.commandBufferCount   = 1,
 			.pCommandBuffers      = &transfer->vk.cmd,
-			.signalSemaphoreCount = (uint32_t)injection->out.numSigs,
-			.pSignalSemaphores    = injection->out.sigs
+			.signalSemaphoreCount = (uint32_t)numSigs,
+			.pSignalSemaphores    = sigs
 		};
 
 		_gfx_mutex_lock(pool->queue.lock);
@@ -488,6 +579,8 @@ bool _gfx_flush_transfer(GFXHeap* heap, _GFXTransferPool* pool)
 		// After this we free `pool->injection` and set it to NULL,
 		// making the above guarantee hold.
 		transfer->flushed = 1;
+
+		pool->value = transfer->value = value;
 	}
 
 	// Make all commands visible for future operations.
@@ -501,6 +594,7 @@ bool _gfx_flush_transfer(GFXHeap* heap, _GFXTransferPool* pool)
 	free(pool->injection);
 
 	pool->injection = NULL;
+	gfx_trace_end(flush);
 
 	return 1;
 
@@ -509,10 +603,75 @@ bool _gfx_flush_transfer(GFXHeap* heap, _GFXTransferPool* pool)
 clean:
 	gfx_log_error("Heap flush failed; lost all prior operations.");
 	_gfx_pop_transfer(heap, pool);
+	gfx_trace_end(flush);
 
 	return 0;
 }
 
+/****************************/
+VkResult _gfx_transfer_status(GFXHeap* heap, _GFXTransferPool* pool,
+                              const _GFXTransfer* transfer, uint64_t* counter)
+{
+	assert(heap != NULL);
+	assert(pool != NULL);
+	assert(transfer != NULL);
+	assert(transfer->flushed);
+	assert(counter != NULL);
+
+	_GFXContext* context = heap->allocator.context;
+
+	// Without timeline, poll the fence.
+	if (pool->vk.timeline == VK_NULL_HANDLE)
+		return context->vk.GetFenceStatus(
+			context->vk.device, transfer->vk.done);
+
+	// Otherwise only query the counter if we have to,
+	// so a caller walking the transfers front to back queries once.
+	if (*counter < transfer->value)
+	{
+		VkResult result = context->vk.GetSemaphoreCounterValue(
+			context->vk.device, pool->vk.timeline, counter);
+
+		if (result != VK_SUCCESS)
+			return result;
+	}
+
+	return *counter >= transfer->value ? VK_SUCCESS : VK_NOT_READY;
+}
+
+/****************************/
+bool _gfx_transfer_wait(GFXHeap* heap, _GFXTransferPool* pool,
+                        uint64_t value, VkFence done)
+{
+	assert(heap != NULL);
+	assert(pool != NULL);
+
+	_GFXContext* context = heap->allocator.context;
+
+	if (pool->vk.timeline == VK_NULL_HANDLE)
+	{
+		_GFX_VK_CHECK(context->vk.WaitForFences(
+			context->vk.device, 1, &done, VK_TRUE, UINT64_MAX), return 0);
+	}
+	else
+	{
+		VkSemaphoreWaitInfo swi = {
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+
+			.pNext          = NULL,
+			.flags          = 0,
+			.semaphoreCount = 1,
+			.pSemaphores    = &pool->vk.timeline,
+			.pValues        = &value
+		};
+
+		_GFX_VK_CHECK(context->vk.WaitSemaphores(
+			context->vk.device, &swi, UINT64_MAX), return 0);
+	}
+
+	return 1;
+}
+
 /****************************
  * Copies data from a host pointer to a mapped resource or staging buffer.
  * @param ptr        Host pointer, cannot be NULL.
@@ -555,93 +714,54 @@ static void _gfx_copy_host(void* ptr, void* ref,
 }
 
 /****************************
- * Copies data from a resource or staging buffer to another resource.
- * @param heap       Cannot be NULL.
- * @param filter     Ignored if cpFlags does not contain _GFX_COPY_SCALED.
- * @param numRefs    Must be >= 1 if staging != NULL, must be >= 2 otherwise.
- * @param numRegions Must be > 0.
- * @param staging    Staging buffer.
- * @param refs       Input references, cannot be NULL.
- * @param masks      Input access masks, cannot be NULL.
- * @param sizes      Must contain _gfx_ref_size(refs), cannot be NULL.
- * @param stage      Staging regions, cannot be NULL if staging is not.
- * @param srcRegions Source regions, cannot be NULL.
- * @param dstRegions Destination regions, Cannot be NULL.
- * @param deps       Cannot be NULL if numDeps > 0.
- * @return Non-zero on success.
- *
- * Staging must be set OR numRefs must be >= 2.
- * This allows use of either a memory resource or a staging buffer.
- * If staging is _not_ set, _GFX_COPY_REVERSED must not be set.
- * If staging is set, _GFX_COPY_(SCALED|RESOLVE) must not be set.
+ * Resolves the Vulkan resources of a copy operation and validates them.
+ * @param op      Cannot be NULL, its resolved fields are set.
+ * @param staging Staging buffer, must be set if op->src is NULL.
+ * @return Non-zero if valid.
  */
-static int _gfx_copy_device(GFXHeap* heap, GFXTransferFlags flags,
-                            _GFXCopyFlags cpFlags, GFXFilter filter,
-                            size_t numRefs, size_t numRegions, size_t numDeps,
-                            _GFXStaging* staging,
-                            const _GFXUnpackRef* refs,
-                            const GFXAccessMask* masks,
-                            const uint64_t* sizes,
-                            const _GFXStageRegion* stage,
-                            const GFXRegion* srcRegions,
-                            const GFXRegion* dstRegions,
-                            const GFXInject* deps)
+static bool _gfx_copy_resolve(_GFXCopyFlags cpFlags,
+                              _GFXStaging* staging, _GFXCopyOp* op)
 {
-	assert(heap != NULL);
-	assert(!(cpFlags & _GFX_COPY_REVERSED) || staging != NULL);
-	assert(!(cpFlags & _GFX_COPY_SCALED) || staging == NULL);
-	assert(!(cpFlags & _GFX_COPY_RESOLVE) || staging == NULL);
-	assert(!(cpFlags & _GFX_COPY_SCALED) || !(cpFlags & _GFX_COPY_RESOLVE));
-	assert(numRefs >= 1);
-	assert(numRefs >= 2 || staging != NULL);
-	assert(numRegions > 0);
-	assert(refs != NULL);
-	assert(masks != NULL);
-	assert(sizes != NULL);
-	assert(staging == NULL || stage != NULL);
-	assert(srcRegions != NULL);
-	assert(dstRegions != NULL);
-	assert(numDeps == 0 || deps != NULL);
-
-	_GFXContext* context = heap->allocator.context;
+	assert(op != NULL);
+	assert(op->dst != NULL);
+	assert(op->src != NULL || (staging != NULL && op->stage != NULL));
 
-	const bool rev = cpFlags & _GFX_COPY_REVERSED;
-	const bool blit = cpFlags & _GFX_COPY_SCALED;
 	const bool resolve = cpFlags & _GFX_COPY_RESOLVE;
+	const bool mipmaps = cpFlags & _GFX_COPY_MIPMAPS;
 
-	// First of all, get resources and metadata to copy.
-	// So we can check them before throwing away all previous operations.
 	// Note there can only be one single attachment,
 	// because there must be at least one heap involved!
-	const _GFXUnpackRef* src = (staging != NULL) ? NULL : &refs[0];
-	const _GFXUnpackRef* dst = (staging != NULL) ? &refs[0] : &refs[1];
+	const _GFXUnpackRef* src = op->src;
+	const _GFXUnpackRef* dst = op->dst;
 	const _GFXImageAttach* attach =
 		(src != NULL && src->obj.renderer != NULL) ?
 		_GFX_UNPACK_REF_ATTACH(*src) : _GFX_UNPACK_REF_ATTACH(*dst);
 
-	const VkBuffer srcBuffer =
-		(staging != NULL) ? staging->vk.buffer :
+	op->attach = attach;
+
+	op->srcBuffer =
+		(src == NULL) ? staging->vk.buffer :
 		(src->obj.buffer != NULL) ? src->obj.buffer->vk.buffer :
 		VK_NULL_HANDLE;
 
-	const VkBuffer dstBuffer =
+	op->dstBuffer =
 		(dst->obj.buffer != NULL) ? dst->obj.buffer->vk.buffer :
 		VK_NULL_HANDLE;
 
-	const VkImage srcImage =
-		(staging != NULL) ? VK_NULL_HANDLE :
+	op->srcImage =
+		(src == NULL) ? VK_NULL_HANDLE :
 		(src->obj.image != NULL) ? src->obj.image->vk.image :
 		(src->obj.renderer != NULL) ? attach->vk.image :
 		VK_NULL_HANDLE;
 
-	const VkImage dstImage =
+	op->dstImage =
 		(dst->obj.image != NULL) ? dst->obj.image->vk.image :
 		(dst->obj.renderer != NULL) ? attach->vk.image :
 		VK_NULL_HANDLE;
 
 	// In case a renderer's attachment hasn't been built yet.
-	if ((srcBuffer == VK_NULL_HANDLE && srcImage == VK_NULL_HANDLE) ||
-		(dstBuffer == VK_NULL_HANDLE && dstImage == VK_NULL_HANDLE))
+	if ((op->srcBuffer == VK_NULL_HANDLE && op->srcImage == VK_NULL_HANDLE) ||
+		(op->dstBuffer == VK_NULL_HANDLE && op->dstImage == VK_NULL_HANDLE))
 	{
 		gfx_log_warn(
 			"Attempted to perform operation on a memory resource "
@@ -652,7 +772,7 @@ static int _gfx_copy_device(GFXHeap* heap, GFXTransferFlags flags,
 
 	// Validate we're resolving a multisampled image.
 	if (resolve &&
-		(src->obj.renderer == NULL || attach->base.samples < 2))
+		(src == NULL || src->obj.renderer == NULL || attach->base.samples < 2))
 	{
 		gfx_log_warn(
 			"Attempted to perform resolve operation on a memory resource "
@@ -672,33 +792,76 @@ static int _gfx_copy_device(GFXHeap* heap, GFXTransferFlags flags,
 		return 0;
 	}
 
-	// Now get us transfer operation resources.
-	// Note that this will lock `pool->lock` for us,
-	// we use this lock for recording as well!
-	// Pick transfer pool from the heap.
-	_GFXTransferPool* pool = (flags & GFX_TRANSFER_ASYNC) ?
-		&heap->ops.transfer : &heap->ops.graphics;
-
-	_GFXTransfer* transfer = _gfx_claim_transfer(heap, pool);
-	if (transfer == NULL)
-		goto unlock;
+	// Resolve the image to generate mipmaps of.
+	// Only heap images have mipmaps, attachments are skipped.
+	op->mipImage = NULL;
+	op->mipFilter = GFX_FILTER_NEAREST;
 
-	// Then get us some injection metadata.
-	_gfx_claim_injection(pool, numRefs, refs, masks, sizes);
-	if (pool->injection == NULL)
-		goto clean;
+	if (mipmaps && dst->obj.image != NULL && dst->obj.image->base.mipmaps > 1)
+	{
+		const _GFXImage* image = dst->obj.image;
+		const GFXFormat fmt = image->base.format;
+		const GFXFormatFeatures feats =
+			gfx_format_support(fmt, gfx_heap_get_device(image->heap));
+
+		// Mipmaps are generated by blitting, validate we can.
+		if (GFX_FORMAT_IS_COMPRESSED(fmt) ||
+			GFX_FORMAT_HAS_DEPTH_OR_STENCIL(fmt) ||
+			!(feats & GFX_FORMAT_IMAGE_READ) ||
+			!(feats & GFX_FORMAT_IMAGE_WRITE) ||
+			!(image->base.flags & GFX_MEMORY_READ) ||
+			!(image->base.flags & GFX_MEMORY_WRITE))
+		{
+			gfx_log_warn(
+				"Attempted to generate mipmaps of an image that cannot be "
+				"blitted (compressed, depth/stencil or lacks "
+				"GFX_MEMORY_READ and GFX_MEMORY_WRITE).");
 
-	// Store dependencies for flushing.
-	if (!gfx_vec_push(&pool->deps, numDeps, deps))
-		goto clean;
+			return 0;
+		}
 
-	// Inject wait commands.
-	if (!_gfx_deps_catch(
-		context, transfer->vk.cmd, numDeps, deps, pool->injection))
-	{
-		goto clean;
+		op->mipImage = image;
+		op->mipFilter = (feats & GFX_FORMAT_SAMPLED_IMAGE_LINEAR) ?
+			GFX_FILTER_LINEAR : GFX_FILTER_NEAREST;
 	}
 
+	return 1;
+}
+
+/****************************
+ * Records a resolved copy operation into a command buffer.
+ * @param cmd     Cannot be VK_NULL_HANDLE.
+ * @param op      Cannot be NULL, must be resolved by _gfx_copy_resolve.
+ * @param staging Staging buffer, must be set if op->src is NULL.
+ */
+static void _gfx_copy_record(_GFXContext* context, VkCommandBuffer cmd,
+                             _GFXCopyFlags cpFlags, GFXFilter filter,
+                             _GFXStaging* staging, const _GFXCopyOp* op)
+{
+	assert(context != NULL);
+	assert(cmd != VK_NULL_HANDLE);
+	assert(op != NULL);
+
+	const bool rev = cpFlags & _GFX_COPY_REVERSED;
+	const bool blit = cpFlags & _GFX_COPY_SCALED;
+	const bool resolve = cpFlags & _GFX_COPY_RESOLVE;
+
+	// Only use the staging buffer if this operation is staged.
+	if (op->src != NULL) staging = NULL;
+
+	const _GFXUnpackRef* src = op->src;
+	const _GFXUnpackRef* dst = op->dst;
+	const _GFXImageAttach* attach = op->attach;
+	const _GFXStageRegion* stage = op->stage;
+	const GFXRegion* srcRegions = op->srcRegions;
+	const GFXRegion* dstRegions = op->dstRegions;
+	const size_t numRegions = op->numRegions;
+
+	const VkBuffer srcBuffer = op->srcBuffer;
+	const VkBuffer dstBuffer = op->dstBuffer;
+	const VkImage srcImage = op->srcImage;
+	const VkImage dstImage = op->dstImage;
+
 	// Ok now record the commands, we check all src/dst resource type
 	// combinations and perform the appropriate copy command.
 	// For each different copy command, we setup its regions accordingly.
@@ -711,7 +874,7 @@ static int _gfx_copy_device(GFXHeap* heap, GFXTransferFlags flags,
 		{
 			// stage offset OR reference offset + region offset.
 			cRegions[r].srcOffset = (staging != NULL) ?
-				stage[r].offset :
+				staging->offset + stage[r].offset :
 				src->value + srcRegions[r].offset;
 
 			// reference offset + region offset.
@@ -733,7 +896,7 @@ static int _gfx_copy_device(GFXHeap* heap, GFXTransferFlags flags,
 			}
 		}
 
-		context->vk.CmdCopyBuffer(transfer->vk.cmd,
+		context->vk.CmdCopyBuffer(cmd,
 			rev ? dstBuffer : srcBuffer,
 			rev ? srcBuffer : dstBuffer,
 			(uint32_t)numRegions, cRegions);
@@ -786,7 +949,7 @@ static int _gfx_copy_device(GFXHeap* heap, GFXTransferFlags flags,
 			};
 		}
 
-		context->vk.CmdBlitImage(transfer->vk.cmd,
+		context->vk.CmdBlitImage(cmd,
 			srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
 			dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 			(uint32_t)numRegions, cRegions,
@@ -850,12 +1013,12 @@ static int _gfx_copy_device(GFXHeap* heap, GFXTransferFlags flags,
 		}
 
 		if (resolve)
-			context->vk.CmdResolveImage(transfer->vk.cmd,
+			context->vk.CmdResolveImage(cmd,
 				srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
 				dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 				(uint32_t)numRegions, &cRegions[0].r);
 		else
-			context->vk.CmdCopyImage(transfer->vk.cmd,
+			context->vk.CmdCopyImage(cmd,
 				srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
 				dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 				(uint32_t)numRegions, &cRegions[0].c);
@@ -876,7 +1039,7 @@ static int _gfx_copy_device(GFXHeap* heap, GFXTransferFlags flags,
 		{
 			// stage offset OR reference offset + region offset.
 			cRegions[r].bufferOffset = (staging != NULL) ?
-				stage[r].offset :
+				staging->offset + stage[r].offset :
 				(srcBuffer != VK_NULL_HANDLE) ?
 					src->value + srcRegions[r].offset :
 					dst->value + dstRegions[r].offset;
@@ -906,18 +1069,243 @@ static int _gfx_copy_device(GFXHeap* heap, GFXTransferFlags flags,
 		}
 
 		if (srcBuffer != VK_NULL_HANDLE && !rev)
-			context->vk.CmdCopyBufferToImage(transfer->vk.cmd,
+			context->vk.CmdCopyBufferToImage(cmd,
 				srcBuffer,
 				dstImage,
 				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 				(uint32_t)numRegions, cRegions);
 		else
-			context->vk.CmdCopyImageToBuffer(transfer->vk.cmd,
+			context->vk.CmdCopyImageToBuffer(cmd,
 				rev ? dstImage : srcImage,
 				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
 				rev ? srcBuffer : dstBuffer,
 				(uint32_t)numRegions, cRegions);
 	}
+}
+
+/****************************
+ * Records mipmap generation of an image into a command buffer.
+ * @param cmd   Cannot be VK_NULL_HANDLE.
+ * @param image Cannot be NULL, must be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL.
+ *
+ * Each mipmap is blitted from the previous one, all mipmaps except the last
+ * are transitioned to TRANSFER_SRC_OPTIMAL in turn. When done, all mipmaps
+ * are transitioned back to TRANSFER_DST_OPTIMAL.
+ */
+static void _gfx_mips_record(_GFXContext* context, VkCommandBuffer cmd,
+                             GFXFilter filter, const _GFXImage* image)
+{
+	assert(context != NULL);
+	assert(cmd != VK_NULL_HANDLE);
+	assert(image != NULL);
+	assert(image->base.mipmaps > 1);
+
+	const uint32_t mipmaps = image->base.mipmaps;
+	const uint32_t layers = image->base.layers;
+
+	VkImageMemoryBarrier imb = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+
+		.pNext               = NULL,
+		.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask       = VK_ACCESS_TRANSFER_READ_BIT,
+		.oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		.newLayout           = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image               = image->vk.image,
+
+		.subresourceRange = {
+			.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel   = 0,
+			.levelCount     = 1,
+			.baseArrayLayer = 0,
+			.layerCount     = layers
+		}
+	};
+
+	int32_t width = (int32_t)image->base.width;
+	int32_t height = (int32_t)image->base.height;
+	int32_t depth = (int32_t)image->base.depth;
+
+	for (uint32_t m = 1; m < mipmaps; ++m)
+	{
+		// Make the previous mipmap available as blit source.
+		imb.subresourceRange.baseMipLevel = m - 1;
+
+		context->vk.CmdPipelineBarrier(cmd,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0, 0, NULL, 0, NULL, 1, &imb);
+
+		const int32_t mWidth = GFX_MAX(1, width >> 1);
+		const int32_t mHeight = GFX_MAX(1, height >> 1);
+		const int32_t mDepth = GFX_MAX(1, depth >> 1);
+
+		const VkImageBlit region = {
+			.srcSubresource = {
+				.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+				.mipLevel       = m - 1,
+				.baseArrayLayer = 0,
+				.layerCount     = layers
+			},
+			.srcOffsets = {
+				{ 0, 0, 0 },
+				{ width, height, depth }
+			},
+			.dstSubresource = {
+				.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+				.mipLevel       = m,
+				.baseArrayLayer = 0,
+				.layerCount     = layers
+			},
+			.dstOffsets = {
+				{ 0, 0, 0 },
+				{ mWidth, mHeight, mDepth }
+			}
+		};
+
+		context->vk.CmdBlitImage(cmd,
+			image->vk.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			image->vk.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1, &region,
+			_GFX_GET_VK_FILTER(filter));
+
+		width = mWidth, height = mHeight, depth = mDepth;
+	}
+
+	// Transition all source mipmaps back, so the entire image is in
+	// the layout the injection metadata expects it to be in.
+	imb.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	imb.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	imb.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	imb.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	imb.subresourceRange.baseMipLevel = 0;
+	imb.subresourceRange.levelCount = mipmaps - 1;
+
+	context->vk.CmdPipelineBarrier(cmd,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 0, NULL, 0, NULL, 1, &imb);
+}
+
+/****************************
+ * Copies data from resources or a staging buffer to other resources.
+ * @param heap    Cannot be NULL.
+ * @param filter  Ignored if cpFlags does not contain _GFX_COPY_SCALED.
+ * @param numOps  Must be > 0.
+ * @param numRefs Must be > 0.
+ * @param staging Staging buffer, shared by all staged operations.
+ * @param ops     Operations to perform, cannot be NULL.
+ * @param refs    Input references of all operations, cannot be NULL.
+ * @param masks   Input access masks, cannot be NULL.
+ * @param sizes   Must contain _gfx_ref_size(refs), cannot be NULL.
+ * @param deps    Cannot be NULL if numDeps > 0.
+ * @param value   Output flush value of the transfer operation, may be NULL.
+ * @return Non-zero on success.
+ *
+ * All operations are recorded into a single transfer operation and
+ * dependencies are injected once for all of them.
+ * If value is not NULL, flags must contain GFX_TRANSFER_FLUSH and the
+ * staging buffer is _not_ freed by the transfer operation, the caller
+ * keeps ownership and must keep it alive until the value is reached.
+ * Staging must be set if any operation has no source reference.
+ * If staging is _not_ set, _GFX_COPY_REVERSED must not be set.
+ * If staging is set, _GFX_COPY_(SCALED|RESOLVE) must not be set.
+ *
+ * If flags contains GFX_TRANSFER_MIPMAPS (and _GFX_COPY_REVERSED is not set),
+ * mipmaps are generated for all destination images after they are written,
+ * operations with zero regions only generate mipmaps.
+ */
+static int _gfx_copy_device(GFXHeap* heap, GFXTransferFlags flags,
+                            _GFXCopyFlags cpFlags, GFXFilter filter,
+                            size_t numOps, size_t numRefs, size_t numDeps,
+                            _GFXStaging* staging,
+                            _GFXCopyOp* ops,
+                            const _GFXUnpackRef* refs,
+                            const GFXAccessMask* masks,
+                            const uint64_t* sizes,
+                            const GFXInject* deps,
+                            uint64_t* value)
+{
+	assert(heap != NULL);
+	assert(!(cpFlags & _GFX_COPY_REVERSED) || staging != NULL);
+	assert(!(cpFlags & _GFX_COPY_SCALED) || staging == NULL);
+	assert(!(cpFlags & _GFX_COPY_RESOLVE) || staging == NULL);
+	assert(!(cpFlags & _GFX_COPY_SCALED) || !(cpFlags & _GFX_COPY_RESOLVE));
+	assert(numOps > 0);
+	assert(numRefs > 0);
+	assert(ops != NULL);
+	assert(refs != NULL);
+	assert(masks != NULL);
+	assert(sizes != NULL);
+	assert(numDeps == 0 || deps != NULL);
+	assert(value == NULL || (flags & GFX_TRANSFER_FLUSH));
+
+	_GFXContext* context = heap->allocator.context;
+
+	// Mipmaps are generated for destination images only, not on readback.
+	if ((flags & GFX_TRANSFER_MIPMAPS) && !(cpFlags & _GFX_COPY_REVERSED))
+		cpFlags |= _GFX_COPY_MIPMAPS;
+
+	// First of all, get resources and metadata to copy.
+	// So we can check them before throwing away all previous operations.
+	for (size_t o = 0; o < numOps; ++o)
+		if (!_gfx_copy_resolve(cpFlags, staging, &ops[o]))
+			return 0;
+
+	// Now get us transfer operation resources.
+	// Note that this will lock `pool->lock` for us,
+	// we use this lock for recording as well!
+	// Pick transfer pool from the heap.
+	// Blitting requires graphics capabilities, so mipmap generation
+	// is never asynchronous.
+	_GFXTransferPool* pool =
+		((flags & GFX_TRANSFER_ASYNC) && !(cpFlags & _GFX_COPY_MIPMAPS)) ?
+			&heap->ops.transfer : &heap->ops.graphics;
+
+	_GFXTransfer* transfer = _gfx_claim_transfer(heap, pool);
+	if (transfer == NULL)
+		goto unlock;
+
+	// Then get us some injection metadata.
+	_gfx_claim_injection(pool, numRefs, refs, masks, sizes);
+	if (pool->injection == NULL)
+		goto clean;
+
+	// Store dependencies for flushing.
+	if (!gfx_vec_push(&pool->deps, numDeps, deps))
+		goto clean;
+
+	// Inject wait commands.
+	if (!_gfx_deps_catch(
+		context, transfer->vk.cmd, numDeps, deps, pool->injection))
+	{
+		goto clean;
+	}
+
+	// Record all operations, including their mipmap generation.
+	// Operations restricted to some devices of a device group only record
+	// their copies for them, barriers and injections are for all devices.
+	const uint32_t devices = _GFX_CONTEXT_DEVICES(context);
+
+	for (size_t o = 0; o < numOps; ++o)
+	{
+		const bool masked =
+			ops[o].devices != 0 && ops[o].devices != devices;
+
+		if (masked)
+			context->vk.CmdSetDeviceMask(transfer->vk.cmd, ops[o].devices);
+
+		if (ops[o].numRegions > 0)
+			_gfx_copy_record(
+				context, transfer->vk.cmd, cpFlags, filter, staging, &ops[o]);
+
+		if (ops[o].mipImage != NULL)
+			_gfx_mips_record(
+				context, transfer->vk.cmd, ops[o].mipFilter, ops[o].mipImage);
+
+		if (masked)
+			context->vk.CmdSetDeviceMask(transfer->vk.cmd, devices);
+	}
 
 	// Inject signal commands.
 	if (!_gfx_deps_prepare(
@@ -938,12 +1326,17 @@ static int _gfx_copy_device(GFXHeap* heap, GFXTransferFlags flags,
 	// at which point we must also increase the block count!
 	// We want to unlock BEFORE blocking, so other operations can start.
 	VkFence done = transfer->vk.done;
+	uint64_t doneValue = transfer->value;
+
+	if (value != NULL)
+		*value = doneValue;
+
 	if (flags & GFX_TRANSFER_BLOCK)
 		atomic_fetch_add(&pool->blocking, 1);
 
 	// If not blocking, remember the staging buffer
 	// so it gets freed at some point.
-	else if (staging != NULL)
+	else if (staging != NULL && value == NULL)
 		gfx_list_insert_after(&transfer->stagings, &staging->list, NULL);
 
 	_gfx_mutex_unlock(&pool->lock);
@@ -951,12 +1344,9 @@ static int _gfx_copy_device(GFXHeap* heap, GFXTransferFlags flags,
 	// Ok so block if asked (+ decrease block count back down).
 	if (flags & GFX_TRANSFER_BLOCK)
 	{
-		_GFX_VK_CHECK(context->vk.WaitForFences(
-			context->vk.device, 1, &done, VK_TRUE, UINT64_MAX),
-		{
+		if (!_gfx_transfer_wait(heap, pool, doneValue, done))
 			// We can't undo what we've done, treat as fatal :(
 			gfx_log_fatal("Transfer operation failed to block.");
-		});
 
 		// No need to lock :)
 		atomic_fetch_sub(&pool->blocking, 1);
@@ -976,47 +1366,145 @@ unlock:
 }
 
 /****************************/
-GFX_API bool gfx_read(GFXReference src, void* dst,
-                      GFXTransferFlags flags,
-                      size_t numRegions, size_t numDeps,
-                      const GFXRegion* srcRegions, const GFXRegion* dstRegions,
-                      const GFXInject* deps)
+bool _gfx_move_buffer(GFXHeap* heap, _GFXBuffer* buffer,
+                      _GFXStaging* old, GFXDependency* dep)
 {
-	assert(!GFX_REF_IS_NULL(src));
-	assert(dst != NULL);
-	assert(numRegions > 0);
-	assert(srcRegions != NULL);
-	assert(dstRegions != NULL);
-	assert(numDeps == 0 || deps != NULL);
-
-	// When reading we always need to block...
-	flags |= GFX_TRANSFER_BLOCK;
+	assert(heap != NULL);
+	assert(buffer != NULL);
+	assert(buffer->heap == heap);
+	assert(old != NULL);
+	assert(dep != NULL);
 
-	// Unpack reference.
-	_GFXUnpackRef unp = _gfx_ref_unpack(src);
-	GFXHeap* heap = _GFX_UNPACK_REF_HEAP(unp);
+	_GFXContext* context = heap->allocator.context;
 
-#if !defined (NDEBUG)
-	GFXMemoryFlags mFlags = _GFX_UNPACK_REF_FLAGS(unp);
+	// Signal all access the buffer could be used for, for the entire buffer.
+	// We reference the buffer itself so the signal never includes old.
+	const GFXBufferUsage usage = buffer->base.usage;
+	const GFXAccessMask mask =
+		GFX_ACCESS_TRANSFER_READ_WRITE |
+		(usage & GFX_BUFFER_VERTEX ? GFX_ACCESS_VERTEX_READ : 0) |
+		(usage & GFX_BUFFER_INDEX ? GFX_ACCESS_INDEX_READ : 0) |
+		(usage & GFX_BUFFER_INDIRECT ? GFX_ACCESS_INDIRECT_READ : 0) |
+		(usage & (GFX_BUFFER_UNIFORM | GFX_BUFFER_UNIFORM_TEXEL) ?
+			GFX_ACCESS_UNIFORM_READ : 0) |
+		(usage & (GFX_BUFFER_STORAGE | GFX_BUFFER_STORAGE_TEXEL) ?
+			GFX_ACCESS_STORAGE_READ_WRITE : 0);
+
+	const GFXInject inj =
+		gfx_dep_sigr(dep, mask, GFX_STAGE_ANY, gfx_ref_buffer(&buffer->base));
 
-	// Validate memory flags.
-	if (!(mFlags & (GFX_MEMORY_HOST_VISIBLE | GFX_MEMORY_READ)))
-	{
-		gfx_log_warn(
-			"Not allowed to read from a memory resource that was not "
-			"created with GFX_MEMORY_HOST_VISIBLE or GFX_MEMORY_READ.");
-	}
+	// Prepare injection metadata.
+	const _GFXUnpackRef ref = _gfx_ref_unpack(gfx_ref_buffer(&buffer->base));
+	const GFXAccessMask rMask = GFX_ACCESS_TRANSFER_WRITE;
+	const uint64_t rSize = buffer->base.size;
 
-	// Validate async flag.
-	if ((flags & GFX_TRANSFER_ASYNC) &&
-		(mFlags & GFX_MEMORY_COMPUTE_CONCURRENT) &&
-		!(mFlags & GFX_MEMORY_TRANSFER_CONCURRENT))
-	{
-		gfx_log_warn(
-			"Not allowed to perform asynchronous read from a memory resource "
-			"with concurrent memory flags excluding transfer operations.");
-	}
-#endif
+	// Always use the graphics queue, so the old buffer is only freed
+	// after all prior operations on this queue have completed.
+	_GFXTransferPool* pool = &heap->ops.graphics;
+
+	_GFXTransfer* transfer = _gfx_claim_transfer(heap, pool);
+	if (transfer == NULL)
+		goto unlock;
+
+	_gfx_claim_injection(pool, 1, &ref, &rMask, &rSize);
+	if (pool->injection == NULL)
+		goto clean;
+
+	if (!gfx_vec_push(&pool->deps, 1, &inj))
+		goto clean;
+
+	// We do not know what happened to the old buffer before,
+	// so make all prior writes available to the copy.
+	VkMemoryBarrier mb = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+
+		.pNext         = NULL,
+		.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT
+	};
+
+	context->vk.CmdPipelineBarrier(transfer->vk.cmd,
+		VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 1, &mb, 0, NULL, 0, NULL);
+
+	// Copy the entire buffer.
+	VkBufferCopy region = {
+		.srcOffset = 0,
+		.dstOffset = 0,
+		.size      = buffer->base.size
+	};
+
+	context->vk.CmdCopyBuffer(transfer->vk.cmd,
+		old->vk.buffer, buffer->vk.buffer, 1, &region);
+
+	// Inject the signal command.
+	if (!_gfx_deps_prepare(
+		context, transfer->vk.cmd, 0, 1, &inj, pool->injection))
+	{
+		goto clean;
+	}
+
+	// Remember the old buffer so it gets freed when the copy is done.
+	gfx_list_insert_after(&transfer->stagings, &old->list, NULL);
+
+	_gfx_mutex_unlock(&pool->lock);
+
+	return 1;
+
+
+	// Cleanup on failure.
+clean:
+	gfx_log_warn("Transfer operation failed; lost all prior operations.");
+	_gfx_pop_transfer(heap, pool);
+unlock:
+	_gfx_mutex_unlock(&pool->lock);
+
+	return 0;
+}
+
+/****************************/
+GFX_API bool gfx_read(GFXReference src, void* dst,
+                      GFXTransferFlags flags,
+                      size_t numRegions, size_t numDeps,
+                      const GFXRegion* srcRegions, const GFXRegion* dstRegions,
+                      const GFXInject* deps)
+{
+	assert(!GFX_REF_IS_NULL(src));
+	assert(dst != NULL);
+	assert(numRegions > 0);
+	assert(srcRegions != NULL);
+	assert(dstRegions != NULL);
+	assert(numDeps == 0 || deps != NULL);
+
+	// When reading we always need to block...
+	flags |= GFX_TRANSFER_BLOCK;
+
+	// Unpack reference.
+	_GFXUnpackRef unp = _gfx_ref_unpack(src);
+	GFXHeap* heap = _GFX_UNPACK_REF_HEAP(unp);
+
+#if !defined (NDEBUG)
+	GFXMemoryFlags mFlags = _GFX_UNPACK_REF_FLAGS(unp);
+
+	// Validate memory flags.
+	if (!(mFlags & (GFX_MEMORY_HOST_VISIBLE | GFX_MEMORY_READ)))
+	{
+		gfx_log_warn(
+			"Not allowed to read from a memory resource that was not "
+			"created with GFX_MEMORY_HOST_VISIBLE or GFX_MEMORY_READ.");
+	}
+
+	// Validate async flag.
+	if ((flags & GFX_TRANSFER_ASYNC) &&
+		(mFlags & GFX_MEMORY_COMPUTE_CONCURRENT) &&
+		!(mFlags & GFX_MEMORY_TRANSFER_CONCURRENT))
+	{
+		gfx_log_warn(
+			"Not allowed to perform asynchronous read from a memory resource "
+			"with concurrent memory flags excluding transfer operations.");
+	}
+#endif
 
 	// We either map or stage, staging may remain NULL.
 	// @see gfx_write for details.
@@ -1033,6 +1521,9 @@ GFX_API bool gfx_read(GFXReference src, void* dst,
 		if (ptr == NULL) goto error;
 		ptr = (void*)((char*)ptr + unp.value);
 
+		// Make device writes visible to the host.
+		_gfx_mem_invalidate(&heap->allocator, &unp.obj.buffer->alloc);
+
 		// Warn if we have injection commands but cannot submit them.
 		if (numDeps > 0) gfx_log_warn(
 			"All dependency injection commands ignored, "
@@ -1061,15 +1552,25 @@ GFX_API bool gfx_read(GFXReference src, void* dst,
 		const GFXAccessMask rMask = GFX_ACCESS_TRANSFER_READ;
 		const uint64_t rSize = _gfx_ref_size(src);
 
+		_GFXCopyOp op = {
+			.src = NULL,
+			.dst = &unp,
+			.stage = stage,
+			.srcRegions = dstRegions,
+			.dstRegions = srcRegions,
+			.numRegions = numRegions
+		};
+
 		if (!_gfx_copy_device(
 			heap, flags, _GFX_COPY_REVERSED, GFX_FILTER_NEAREST,
-			1, numRegions, numDeps,
-			staging, &unp, &rMask, &rSize,
-			stage, dstRegions, srcRegions, deps))
+			1, 1, numDeps, staging, &op, &unp, &rMask, &rSize, deps, NULL))
 		{
 			_gfx_free_staging(heap, staging);
 			goto error;
 		}
+
+		// We blocked, make the copy visible to the host.
+		_gfx_mem_invalidate(&heap->allocator, &staging->alloc);
 	}
 
 	// Do the staging -> host copy.
@@ -1094,6 +1595,316 @@ error:
 	return 0;
 }
 
+/****************************
+ * Polls (or blocks) whether a flushed transfer operation is done.
+ * @param heap  Cannot be NULL.
+ * @param pool  Cannot be NULL, must be of heap.
+ * @param value Flush value of the transfer operation.
+ * @param block Non-zero to block until it is done.
+ * @return Non-zero if done, zero if not done or on failure.
+ *
+ * Thread-safe with respect to the pool.
+ * Without timeline semaphore, a transfer operation is done once its fence
+ * is signaled or it is not found anymore, as it can only be recycled or
+ * purged once it is done.
+ */
+static bool _gfx_transfer_poll(GFXHeap* heap, _GFXTransferPool* pool,
+                               uint64_t value, bool block)
+{
+	assert(heap != NULL);
+	assert(pool != NULL);
+
+	_GFXContext* context = heap->allocator.context;
+
+	// With timeline semaphore, simply check or wait for the value.
+	if (pool->vk.timeline != VK_NULL_HANDLE)
+	{
+		if (block)
+			return _gfx_transfer_wait(heap, pool, value, VK_NULL_HANDLE);
+
+		uint64_t counter;
+		_GFX_VK_CHECK(
+			context->vk.GetSemaphoreCounterValue(
+				context->vk.device, pool->vk.timeline, &counter),
+			return 0);
+
+		return counter >= value;
+	}
+
+	// Otherwise go find the transfer operation.
+	_gfx_mutex_lock(&pool->lock);
+
+	_GFXTransfer* transfer = NULL;
+	for (size_t t = 0; t < pool->transfers.size; ++t)
+	{
+		_GFXTransfer* tr = gfx_deque_at(&pool->transfers, t);
+		if (tr->flushed && tr->value == value)
+		{
+			transfer = tr;
+			break;
+		}
+	}
+
+	if (transfer == NULL)
+	{
+		_gfx_mutex_unlock(&pool->lock);
+		return 1;
+	}
+
+	if (!block)
+	{
+		VkResult result = context->vk.GetFenceStatus(
+			context->vk.device, transfer->vk.done);
+
+		_gfx_mutex_unlock(&pool->lock);
+
+		if (result != VK_SUCCESS && result != VK_NOT_READY)
+			_GFX_VK_CHECK(result, {});
+
+		return result == VK_SUCCESS;
+	}
+
+	// Same as blocking for any other transfer operation,
+	// increase the block count so the fence does not get reset.
+	VkFence done = transfer->vk.done;
+	atomic_fetch_add(&pool->blocking, 1);
+
+	_gfx_mutex_unlock(&pool->lock);
+
+	const bool success = _gfx_transfer_wait(heap, pool, 0, done);
+	atomic_fetch_sub(&pool->blocking, 1);
+
+	return success;
+}
+
+/****************************
+ * Finishes a readback, i.e. copies the staging data to the host.
+ * @param readback Cannot be NULL, device must be done with its staging.
+ */
+static void _gfx_readback_finish(GFXReadback* readback)
+{
+	assert(readback != NULL);
+	assert(!readback->done);
+	assert(readback->staging != NULL);
+
+	GFXHeap* heap = readback->heap;
+	_GFXStaging* staging = readback->staging;
+
+	// Make the copy visible to the host.
+	_gfx_mem_invalidate(&heap->allocator, &staging->alloc);
+
+	// Do the staging -> host copy.
+	_gfx_copy_host(
+		readback->dst, staging->vk.ptr, _GFX_COPY_REVERSED,
+		readback->numRegions, readback->dstRegions, NULL, readback->stage);
+
+	// And get rid of the staging buffer immediately.
+	_gfx_free_staging(heap, staging);
+
+	readback->staging = NULL;
+	readback->done = 1;
+}
+
+/****************************/
+GFX_API GFXReadback* gfx_read_async(GFXReference src, void* dst,
+                                    GFXTransferFlags flags,
+                                    size_t numRegions, size_t numDeps,
+                                    const GFXRegion* srcRegions,
+                                    const GFXRegion* dstRegions,
+                                    const GFXInject* deps)
+{
+	return _gfx_read_async(src, dst, flags, 0,
+		numRegions, numDeps, srcRegions, dstRegions, deps);
+}
+
+/****************************/
+GFXReadback* _gfx_read_async(GFXReference src, void* dst,
+                             GFXTransferFlags flags, uint32_t devices,
+                             size_t numRegions, size_t numDeps,
+                             const GFXRegion* srcRegions,
+                             const GFXRegion* dstRegions,
+                             const GFXInject* deps)
+{
+	assert(!GFX_REF_IS_NULL(src));
+	assert(dst != NULL);
+	assert(numRegions > 0);
+	assert(srcRegions != NULL);
+	assert(dstRegions != NULL);
+	assert(numDeps == 0 || deps != NULL);
+
+	// We never block, but always flush so the read will get done.
+	flags &= ~(GFXTransferFlags)GFX_TRANSFER_BLOCK;
+	flags |= GFX_TRANSFER_FLUSH;
+
+	// Unpack reference.
+	_GFXUnpackRef unp = _gfx_ref_unpack(src);
+	GFXHeap* heap = _GFX_UNPACK_REF_HEAP(unp);
+
+	// Allocate the readback, with its stage and host regions.
+	GFXReadback* readback = malloc(
+		sizeof(GFXReadback) +
+		(sizeof(_GFXStageRegion) + sizeof(GFXRegion)) * numRegions);
+
+	if (readback == NULL)
+		goto error;
+
+	readback->heap = heap;
+	readback->pool = (flags & GFX_TRANSFER_ASYNC) ?
+		&heap->ops.transfer : &heap->ops.graphics;
+	readback->value = 0;
+	readback->staging = NULL;
+	readback->done = 0;
+
+	readback->dst = dst;
+	readback->numRegions = numRegions;
+	readback->stage = (_GFXStageRegion*)(readback + 1);
+	readback->dstRegions = (GFXRegion*)(readback->stage + numRegions);
+
+	memcpy(readback->dstRegions, dstRegions, sizeof(GFXRegion) * numRegions);
+
+	// If it is a host visible buffer, gfx_read maps it and does not block,
+	// so we are immediately done.
+	if (unp.obj.buffer != NULL &&
+		(unp.obj.buffer->base.flags & GFX_MEMORY_HOST_VISIBLE))
+	{
+		if (!gfx_read(src, dst, flags,
+			numRegions, numDeps, srcRegions, dstRegions, deps))
+		{
+			goto clean;
+		}
+
+		readback->done = 1;
+		return readback;
+	}
+
+#if !defined (NDEBUG)
+	GFXMemoryFlags mFlags = _GFX_UNPACK_REF_FLAGS(unp);
+
+	// Validate memory flags.
+	if (!(mFlags & GFX_MEMORY_READ))
+	{
+		gfx_log_warn(
+			"Not allowed to read from a memory resource that was not "
+			"created with GFX_MEMORY_HOST_VISIBLE or GFX_MEMORY_READ.");
+	}
+
+	// Validate async flag.
+	if ((flags & GFX_TRANSFER_ASYNC) &&
+		(mFlags & GFX_MEMORY_COMPUTE_CONCURRENT) &&
+		!(mFlags & GFX_MEMORY_TRANSFER_CONCURRENT))
+	{
+		gfx_log_warn(
+			"Not allowed to perform asynchronous read from a memory resource "
+			"with concurrent memory flags excluding transfer operations.");
+	}
+#endif
+
+	// Stage exactly like gfx_read, except we keep the staging buffer.
+	// @see gfx_read for details.
+	const uint64_t size = _gfx_stage_compact(
+		&unp, numRegions, dstRegions, srcRegions, readback->stage);
+	readback->staging = _gfx_alloc_staging(
+		heap, VK_BUFFER_USAGE_TRANSFER_DST_BIT, size);
+
+	if (readback->staging == NULL)
+		goto clean;
+
+	// Do the resource -> staging copy.
+	const GFXAccessMask rMask = GFX_ACCESS_TRANSFER_READ;
+	const uint64_t rSize = _gfx_ref_size(src);
+
+	_GFXCopyOp op = {
+		.src = NULL,
+		.dst = &unp,
+		.stage = readback->stage,
+		.srcRegions = dstRegions,
+		.dstRegions = srcRegions,
+		.numRegions = numRegions,
+		.devices = devices
+	};
+
+	if (!_gfx_copy_device(
+		heap, flags, _GFX_COPY_REVERSED, GFX_FILTER_NEAREST,
+		1, 1, numDeps, readback->staging, &op, &unp, &rMask, &rSize, deps,
+		&readback->value))
+	{
+		_gfx_free_staging(heap, readback->staging);
+		goto clean;
+	}
+
+	return readback;
+
+
+	// Cleanup on failure.
+clean:
+	free(readback);
+error:
+	gfx_log_error("Asynchronous read operation failed.");
+
+	return NULL;
+}
+
+/****************************/
+GFX_API bool gfx_readback_poll(GFXReadback* readback)
+{
+	assert(readback != NULL);
+
+	if (readback->done)
+		return 1;
+
+	if (!_gfx_transfer_poll(
+		readback->heap, readback->pool, readback->value, 0))
+	{
+		return 0;
+	}
+
+	_gfx_readback_finish(readback);
+
+	return 1;
+}
+
+/****************************/
+GFX_API bool gfx_readback_wait(GFXReadback* readback)
+{
+	assert(readback != NULL);
+
+	if (readback->done)
+		return 1;
+
+	if (!_gfx_transfer_poll(
+		readback->heap, readback->pool, readback->value, 1))
+	{
+		gfx_log_error("Readback failed to block.");
+		return 0;
+	}
+
+	_gfx_readback_finish(readback);
+
+	return 1;
+}
+
+/****************************/
+GFX_API void gfx_readback_free(GFXReadback* readback)
+{
+	if (readback == NULL)
+		return;
+
+	// If not done, we must wait for the device to stop using the staging
+	// buffer before we can free it.
+	if (!readback->done)
+	{
+		if (!_gfx_transfer_poll(
+			readback->heap, readback->pool, readback->value, 1))
+		{
+			gfx_log_warn("Freeing a readback the device may still use.");
+		}
+
+		_gfx_free_staging(readback->heap, readback->staging);
+	}
+
+	free(readback);
+}
+
 /****************************/
 GFX_API bool gfx_write(const void* src, GFXReference dst,
                        GFXTransferFlags flags,
@@ -1140,6 +1951,8 @@ GFX_API bool gfx_write(const void* src, GFXReference dst,
 	_GFXStageRegion stage[numRegions];
 
 	// If it is a host visible buffer, map it.
+	// This includes buffers whose memory turned out to be host visible,
+	// their flags are modified on allocation, skipping staging entirely.
 	// We cannot map images because we do not allocate linear images (!)
 	// Otherwise, create a staging buffer of an appropriate size.
 	if (unp.obj.buffer != NULL &&
@@ -1183,19 +1996,27 @@ GFX_API bool gfx_write(const void* src, GFXReference dst,
 		const GFXAccessMask rMask = GFX_ACCESS_TRANSFER_WRITE;
 		const uint64_t rSize = _gfx_ref_size(dst);
 
+		_GFXCopyOp op = {
+			.src = NULL,
+			.dst = &unp,
+			.stage = stage,
+			.srcRegions = srcRegions,
+			.dstRegions = dstRegions,
+			.numRegions = numRegions
+		};
+
 		if (!_gfx_copy_device(
 			heap, flags, 0, GFX_FILTER_NEAREST,
-			1, numRegions, numDeps,
-			staging, &unp, &rMask, &rSize,
-			stage, srcRegions, dstRegions, deps))
+			1, 1, numDeps, staging, &op, &unp, &rMask, &rSize, deps, NULL))
 		{
 			_gfx_free_staging(heap, staging);
 			goto error;
 		}
 	}
 
-	// Unmap if not staging, otherwise, free staging buffer IFF blocking.
+	// Flush & unmap if not staging, otherwise, free staging buffer IFF blocking.
 	if (staging == NULL)
+		_gfx_mem_flush(&heap->allocator, &unp.obj.buffer->alloc),
 		_gfx_unmap(&heap->allocator, &unp.obj.buffer->alloc);
 	else if (flags & GFX_TRANSFER_BLOCK)
 		_gfx_free_staging(heap, staging);
@@ -1280,11 +2101,18 @@ static bool _gfx_copy(GFXReference src, GFXReference dst,
 	GFXHeap* heap = _GFX_UNPACK_REF_HEAP(refs[0]);
 
 	// Do the resource -> resource copy.
+	_GFXCopyOp op = {
+		.src = &refs[0],
+		.dst = &refs[1],
+		.stage = NULL,
+		.srcRegions = srcRegions,
+		.dstRegions = dstRegions,
+		.numRegions = numRegions
+	};
+
 	if (!_gfx_copy_device(
 		heap, flags, cpFlags, filter,
-		2, numRegions, numDeps,
-		NULL, refs, rMasks, rSizes,
-		NULL, srcRegions, dstRegions, deps))
+		1, 2, numDeps, NULL, &op, refs, rMasks, rSizes, deps, NULL))
 	{
 		gfx_log_error(
 			"%s operation failed.",
@@ -1350,14 +2178,740 @@ GFX_API bool gfx_resolve(GFXImageRef src, GFXImageRef dst,
 }
 
 /****************************/
-GFX_API void* gfx_map(GFXBufferRef ref)
+GFX_API bool gfx_image_generate_mips(GFXImageRef ref,
+                                     GFXTransferFlags flags,
+                                     size_t numDeps, const GFXInject* deps)
 {
-	assert(GFX_REF_IS_BUFFER(ref));
+	assert(GFX_REF_IS_IMAGE(ref));
+	assert(numDeps == 0 || deps != NULL);
 
 	// Unpack reference.
-	_GFXUnpackRef unp = _gfx_ref_unpack(ref);
+	const _GFXUnpackRef unp = _gfx_ref_unpack(ref);
 
-#if !defined (NDEBUG)
+	if (unp.obj.image == NULL)
+	{
+		gfx_log_error(
+			"Can only generate mipmaps of images allocated from a heap.");
+
+		return 0;
+	}
+
+	// Nothing to generate.
+	if (unp.obj.image->base.mipmaps < 2)
+		return 1;
+
+	// Prepare injection metadata.
+	GFXHeap* heap = unp.obj.image->heap;
+	const GFXAccessMask rMask = GFX_ACCESS_TRANSFER_WRITE;
+	const uint64_t rSize = _gfx_ref_size(ref);
+
+	// Record a single operation without regions, it is both source and
+	// destination, so _gfx_copy_device only generates its mipmaps.
+	_GFXCopyOp op = {
+		.src = &unp,
+		.dst = &unp,
+		.stage = NULL,
+		.srcRegions = NULL,
+		.dstRegions = NULL,
+		.numRegions = 0
+	};
+
+	if (!_gfx_copy_device(
+		heap, flags | GFX_TRANSFER_MIPMAPS, 0, GFX_FILTER_NEAREST,
+		1, 1, numDeps, NULL, &op, &unp, &rMask, &rSize, deps, NULL))
+	{
+		gfx_log_error("Mipmap generation operation failed.");
+
+		return 0;
+	}
+
+	return 1;
+}
+
+/****************************/
+GFX_API bool gfx_write_batch(GFXTransferFlags flags,
+                             size_t numOps, size_t numDeps,
+                             const GFXWriteOp* ops, const GFXInject* deps)
+{
+	assert(numOps > 0);
+	assert(ops != NULL);
+	assert(numDeps == 0 || deps != NULL);
+
+	// Unpack all references & count all regions.
+	_GFXUnpackRef unps[numOps];
+	size_t numRegions = 0;
+
+	for (size_t o = 0; o < numOps; ++o)
+	{
+		assert(ops[o].src != NULL);
+		assert(!GFX_REF_IS_NULL(ops[o].dst));
+		assert(ops[o].numRegions > 0);
+		assert(ops[o].srcRegions != NULL);
+		assert(ops[o].dstRegions != NULL);
+
+		unps[o] = _gfx_ref_unpack(ops[o].dst);
+		numRegions += ops[o].numRegions;
+
+#if !defined (NDEBUG)
+		// Validate memory flags.
+		if (!(_GFX_UNPACK_REF_FLAGS(unps[o]) &
+			(GFX_MEMORY_HOST_VISIBLE | GFX_MEMORY_WRITE)))
+		{
+			gfx_log_warn(
+				"Not allowed to write to a memory resource that was not "
+				"created with GFX_MEMORY_HOST_VISIBLE or GFX_MEMORY_WRITE.");
+		}
+#endif
+	}
+
+	// Check that all destinations share the same heap.
+	GFXHeap* heap = _GFX_UNPACK_REF_HEAP(unps[0]);
+
+	for (size_t o = 1; o < numOps; ++o)
+		if (_GFX_UNPACK_REF_HEAP(unps[o]) != heap)
+		{
+			gfx_log_error(
+				"All destinations of a batched write operation must be "
+				"allocated from the same heap.");
+
+			goto error;
+		}
+
+	// Compact the regions of all operations that need staging into one
+	// staging buffer, each aligned so all copies stay valid.
+	// Host visible buffers are mapped and written to immediately.
+	_GFXStageRegion stage[numRegions];
+	_GFXCopyOp cops[numOps];
+	GFXAccessMask masks[numOps];
+	uint64_t sizes[numOps];
+	size_t staged[numOps]; // Operation index of each staged copy.
+
+	size_t numStaged = 0;
+	size_t numStage = 0;
+	uint64_t size = 0;
+
+	for (size_t o = 0; o < numOps; ++o)
+	{
+		if (unps[o].obj.buffer != NULL &&
+			(unps[o].obj.buffer->base.flags & GFX_MEMORY_HOST_VISIBLE))
+		{
+			_GFXAllocator* alloc = &heap->allocator;
+			void* ptr = _gfx_map(alloc, &unps[o].obj.buffer->alloc);
+			if (ptr == NULL) goto error;
+
+			_gfx_copy_host(
+				(void*)ops[o].src, (char*)ptr + unps[o].value, 0,
+				ops[o].numRegions, ops[o].srcRegions, ops[o].dstRegions, NULL);
+
+			_gfx_mem_flush(alloc, &unps[o].obj.buffer->alloc);
+			_gfx_unmap(alloc, &unps[o].obj.buffer->alloc);
+
+			continue;
+		}
+
+		_GFXStageRegion* opStage = stage + numStage;
+		const uint64_t opSize = _gfx_stage_compact(
+			&unps[o], ops[o].numRegions,
+			ops[o].srcRegions, ops[o].dstRegions, opStage);
+
+		size = (size + _GFX_STAGING_ALIGN - 1) /
+			_GFX_STAGING_ALIGN * _GFX_STAGING_ALIGN;
+
+		for (size_t r = 0; r < ops[o].numRegions; ++r)
+			opStage[r].offset += size;
+
+		size += opSize;
+		numStage += ops[o].numRegions;
+
+		// Store the operation & injection metadata,
+		// the destination reference must be at the same index as cops.
+		staged[numStaged] = o;
+		unps[numStaged] = unps[o];
+		masks[numStaged] = GFX_ACCESS_TRANSFER_WRITE;
+		sizes[numStaged] = _gfx_ref_size(ops[o].dst);
+
+		cops[numStaged] = (_GFXCopyOp){
+			.src = NULL,
+			.dst = &unps[numStaged],
+			.stage = opStage,
+			.srcRegions = ops[o].srcRegions,
+			.dstRegions = ops[o].dstRegions,
+			.numRegions = ops[o].numRegions
+		};
+
+		++numStaged;
+	}
+
+	// Nothing to stage, all was mapped.
+	if (numStaged == 0)
+	{
+		// Warn if we have injection commands but cannot submit them.
+		if (numDeps > 0) gfx_log_warn(
+			"All dependency injection commands ignored, "
+			"the operation is not asynchronous (mappable buffer write).");
+
+		return 1;
+	}
+
+	// Allocate one staging buffer for all & do the host -> staging copies.
+	_GFXStaging* staging = _gfx_alloc_staging(
+		heap, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, size);
+
+	if (staging == NULL)
+		goto error;
+
+	for (size_t c = 0; c < numStaged; ++c)
+	{
+		_gfx_copy_host(
+			(void*)ops[staged[c]].src, staging->vk.ptr, 0,
+			cops[c].numRegions, cops[c].srcRegions, NULL, cops[c].stage);
+	}
+
+	// Do all staging -> resource copies in one go.
+	if (!_gfx_copy_device(
+		heap, flags, 0, GFX_FILTER_NEAREST,
+		numStaged, numStaged, numDeps,
+		staging, cops, unps, masks, sizes, deps, NULL))
+	{
+		_gfx_free_staging(heap, staging);
+		goto error;
+	}
+
+	// Free staging buffer IFF blocking.
+	if (flags & GFX_TRANSFER_BLOCK)
+		_gfx_free_staging(heap, staging);
+
+	return 1;
+
+
+	// Error on failure.
+error:
+	gfx_log_error("Batched write operation failed.");
+
+	return 0;
+}
+
+/****************************/
+GFX_API bool gfx_copy_batch(GFXTransferFlags flags,
+                            size_t numOps, size_t numDeps,
+                            const GFXCopyOp* ops, const GFXInject* deps)
+{
+	assert(numOps > 0);
+	assert(ops != NULL);
+	assert(numDeps == 0 || deps != NULL);
+
+	// Prepare injection metadata.
+	_GFXUnpackRef refs[numOps * 2];
+	GFXAccessMask masks[numOps * 2];
+	uint64_t sizes[numOps * 2];
+	_GFXCopyOp cops[numOps];
+
+	for (size_t o = 0; o < numOps; ++o)
+	{
+		assert(!GFX_REF_IS_NULL(ops[o].src));
+		assert(!GFX_REF_IS_NULL(ops[o].dst));
+		assert(ops[o].numRegions > 0);
+		assert(ops[o].srcRegions != NULL);
+		assert(ops[o].dstRegions != NULL);
+
+		refs[o*2] = _gfx_ref_unpack(ops[o].src);
+		refs[o*2+1] = _gfx_ref_unpack(ops[o].dst);
+		masks[o*2] = GFX_ACCESS_TRANSFER_READ;
+		masks[o*2+1] = GFX_ACCESS_TRANSFER_WRITE;
+		sizes[o*2] = _gfx_ref_size(ops[o].src);
+		sizes[o*2+1] = _gfx_ref_size(ops[o].dst);
+
+		cops[o] = (_GFXCopyOp){
+			.src = &refs[o*2],
+			.dst = &refs[o*2+1],
+			.stage = NULL,
+			.srcRegions = ops[o].srcRegions,
+			.dstRegions = ops[o].dstRegions,
+			.numRegions = ops[o].numRegions
+		};
+
+		// Check that the resources share the same context.
+		if (_GFX_UNPACK_REF_CONTEXT(refs[o*2]) !=
+			_GFX_UNPACK_REF_CONTEXT(refs[o*2+1]))
+		{
+			gfx_log_error(
+				"When transfering from one memory resource to another they "
+				"must be built on the same logical Vulkan device.");
+
+			goto error;
+		}
+
+#if !defined (NDEBUG)
+		// Validate memory flags.
+		if (!(_GFX_UNPACK_REF_FLAGS(refs[o*2]) & GFX_MEMORY_READ) ||
+			!(_GFX_UNPACK_REF_FLAGS(refs[o*2+1]) & GFX_MEMORY_WRITE))
+		{
+			gfx_log_warn(
+				"Not allowed to transfer from one memory resource "
+				"to another if they were not created with "
+				"GFX_MEMORY_READ and GFX_MEMORY_WRITE respectively.");
+		}
+#endif
+	}
+
+	// Always take the heap from src, must be the same for all.
+	GFXHeap* heap = _GFX_UNPACK_REF_HEAP(refs[0]);
+
+	for (size_t o = 1; o < numOps; ++o)
+		if (_GFX_UNPACK_REF_HEAP(refs[o*2]) != heap)
+		{
+			gfx_log_error(
+				"All sources of a batched copy operation must be "
+				"allocated from the same heap.");
+
+			goto error;
+		}
+
+	// Do all resource -> resource copies in one go.
+	if (!_gfx_copy_device(
+		heap, flags, 0, GFX_FILTER_NEAREST,
+		numOps, numOps * 2, numDeps,
+		NULL, cops, refs, masks, sizes, deps, NULL))
+	{
+		goto error;
+	}
+
+	return 1;
+
+
+	// Error on failure.
+error:
+	gfx_log_error("Batched copy operation failed.");
+
+	return 0;
+}
+
+/****************************/
+GFX_API bool gfx_heap_stream_write(GFXHeap* heap, unsigned int priority,
+                                   const void* src, GFXReference dst,
+                                   size_t numRegions, size_t numDeps,
+                                   const GFXRegion* srcRegions,
+                                   const GFXRegion* dstRegions,
+                                   const GFXInject* deps)
+{
+	assert(heap != NULL);
+	assert(src != NULL);
+	assert(!GFX_REF_IS_NULL(dst));
+	assert(numRegions > 0);
+	assert(srcRegions != NULL);
+	assert(dstRegions != NULL);
+	assert(numDeps == 0 || deps != NULL);
+
+	// Unpack reference & validate the heap.
+	_GFXUnpackRef unp = _gfx_ref_unpack(dst);
+
+	if (_GFX_UNPACK_REF_HEAP(unp) != heap)
+	{
+		gfx_log_error(
+			"A streaming upload must be queued at the heap its "
+			"destination memory resource is allocated from.");
+
+		return 0;
+	}
+
+	// Get the host size of each region.
+	_GFXStageRegion stage[numRegions];
+	_gfx_stage_compact(&unp, numRegions, srcRegions, dstRegions, stage);
+
+	uint64_t size = 0;
+	for (size_t r = 0; r < numRegions; ++r)
+		size += stage[r].size;
+
+	// Allocate the request, along with its deps, regions and data.
+	_GFXStreamReq* req = malloc(
+		sizeof(_GFXStreamReq) +
+		sizeof(GFXInject) * numDeps +
+		sizeof(GFXRegion) * numRegions * 2 +
+		sizeof(_GFXStreamRegion) * numRegions +
+		size);
+
+	if (req == NULL)
+		goto error;
+
+	req->priority = priority;
+	req->dst = dst;
+	req->numRegions = numRegions;
+	req->region = 0;
+	req->done = 0;
+	req->numDeps = numDeps;
+	req->deps = (GFXInject*)(req + 1);
+	req->srcRegions = (GFXRegion*)(req->deps + numDeps);
+	req->dstRegions = req->srcRegions + numRegions;
+	req->regions = (_GFXStreamRegion*)(req->dstRegions + numRegions);
+	req->data = req->regions + numRegions;
+
+	// Get the image type and format, just like _gfx_stage_compact.
+	_GFXImageAttach* attach =
+		_GFX_UNPACK_REF_ATTACH(unp);
+
+	req->type = _GFX_GET_VK_IMAGE_TYPE(
+		(unp.obj.image != NULL) ? unp.obj.image->base.type :
+		(unp.obj.renderer != NULL) ? attach->base.type : 0);
+
+	GFXFormat fmt =
+		(unp.obj.image != NULL) ? unp.obj.image->base.format :
+		(unp.obj.renderer != NULL) ? attach->base.format :
+		GFX_FORMAT_EMPTY;
+
+	req->blockHeight =
+		GFX_FORMAT_IS_EMPTY(fmt) ? 1 : GFX_FORMAT_BLOCK_HEIGHT(fmt);
+
+	if (numDeps > 0)
+		memcpy(req->deps, deps, sizeof(GFXInject) * numDeps);
+
+	// Copy the data of all regions, tightly packed.
+	uint64_t offset = 0;
+
+	for (size_t r = 0; r < numRegions; ++r)
+	{
+		memcpy(
+			(char*)req->data + offset,
+			(const char*)src + srcRegions[r].offset,
+			stage[r].size);
+
+		req->srcRegions[r] = srcRegions[r];
+		req->srcRegions[r].offset = offset;
+		req->dstRegions[r] = dstRegions[r];
+
+		offset += stage[r].size;
+
+		// Split buffer regions into bytes.
+		_GFXStreamRegion* reg = &req->regions[r];
+
+		if (GFX_FORMAT_IS_EMPTY(fmt))
+		{
+			reg->unit = 1;
+			reg->units = stage[r].size;
+			reg->rows = reg->units;
+			reg->stride = reg->units;
+			continue;
+		}
+
+		// And image regions into rows of blocks, mirroring the host layout
+		// of _gfx_stage_compact, in which layers of 1D images are rows.
+		// Resolve the host packing, as parts get a different height.
+		const GFXRegion* dstReg = &dstRegions[r];
+		GFXRegion* srcReg = &req->srcRegions[r];
+
+		const uint32_t blockWidth = GFX_FORMAT_BLOCK_WIDTH(fmt);
+		const uint32_t blockHeight = req->blockHeight;
+		const uint32_t blockSize = _GFX_MOD_BLOCK_SIZE(
+			GFX_FORMAT_BLOCK_SIZE(fmt) / CHAR_BIT, fmt, dstReg->aspect);
+
+		if (srcReg->rowSize == 0) srcReg->rowSize = dstReg->width;
+		if (srcReg->numRows == 0) srcReg->numRows = dstReg->height;
+
+		const uint64_t rowSize = (srcReg->rowSize + blockWidth - 1) / blockWidth;
+		const uint64_t numRows = (srcReg->numRows + blockHeight - 1) / blockHeight;
+
+		reg->unit = rowSize * blockSize;
+
+		if (req->type == VK_IMAGE_TYPE_1D)
+		{
+			reg->rows = dstReg->numLayers;
+			reg->stride = reg->rows;
+			reg->units = reg->rows;
+		}
+		else
+		{
+			const uint64_t slices =
+				(req->type == VK_IMAGE_TYPE_3D) ? dstReg->depth : dstReg->numLayers;
+
+			reg->rows = (dstReg->height + blockHeight - 1) / blockHeight;
+			reg->stride = numRows;
+			reg->units = reg->rows * slices;
+		}
+	}
+
+	// Insert it after all requests of equal or higher priority.
+	_gfx_mutex_lock(&heap->ops.stream.lock);
+
+	GFXVec* reqs = &heap->ops.stream.requests;
+	size_t q = reqs->size;
+
+	while (q > 0 &&
+		(*(_GFXStreamReq**)gfx_vec_at(reqs, q-1))->priority < priority) --q;
+
+	const bool success = gfx_vec_insert(reqs, 1, &req, q);
+
+	_gfx_mutex_unlock(&heap->ops.stream.lock);
+
+	if (!success)
+	{
+		free(req);
+		goto error;
+	}
+
+	return 1;
+
+
+	// Error on failure.
+error:
+	gfx_log_error("Could not queue a streaming upload.");
+
+	return 0;
+}
+
+/****************************
+ * Computes the regions of a part of a streaming upload region.
+ * @param r     Index of the region.
+ * @param done  Units of the region that were already submitted.
+ * @param num   Units to submit, cannot cross a slice.
+ * @param parts Outputs { host region, destination region }.
+ */
+static void _gfx_stream_part(const _GFXStreamReq* req, size_t r,
+                             uint64_t done, uint64_t num, GFXRegion* parts)
+{
+	const _GFXStreamRegion* reg = &req->regions[r];
+	const uint64_t slice = done / reg->rows;
+	const uint64_t row = done % reg->rows;
+
+	parts[0] = req->srcRegions[r];
+	parts[1] = req->dstRegions[r];
+	parts[0].offset += (slice * reg->stride + row) * reg->unit;
+
+	if (GFX_REF_IS_BUFFER(req->dst))
+	{
+		parts[0].size = num;
+		parts[1].offset += done;
+		parts[1].size = num;
+	}
+
+	else if (req->type == VK_IMAGE_TYPE_1D)
+	{
+		// Rows are layers.
+		parts[1].layer += (uint32_t)row;
+		parts[1].numLayers = (uint32_t)num;
+	}
+
+	else
+	{
+		// A range of rows of a single layer or depth slice.
+		const uint32_t y = (uint32_t)row * req->blockHeight;
+
+		if (req->type == VK_IMAGE_TYPE_3D)
+			parts[1].z += (uint32_t)slice,
+			parts[1].depth = 1;
+		else
+			parts[1].layer += (uint32_t)slice,
+			parts[1].numLayers = 1;
+
+		parts[1].y += y;
+		parts[1].height = GFX_MIN(
+			parts[1].height - y, (uint32_t)num * req->blockHeight);
+	}
+}
+
+/****************************
+ * Puts a streaming upload request back into the queue,
+ * before all requests of equal or lower priority.
+ * @return Zero on failure, the request is dropped.
+ */
+static bool _gfx_stream_requeue(GFXHeap* heap, _GFXStreamReq* req)
+{
+	GFXVec* reqs = &heap->ops.stream.requests;
+	size_t q = 0;
+
+	while (q < reqs->size &&
+		(*(_GFXStreamReq**)gfx_vec_at(reqs, q))->priority > req->priority) ++q;
+
+	if (gfx_vec_insert(reqs, 1, &req, q))
+		return 1;
+
+	gfx_log_error("Could not requeue a streaming upload, it is dropped.");
+	free(req);
+
+	return 0;
+}
+
+/****************************/
+GFX_API bool gfx_heap_stream(GFXHeap* heap, uint64_t budget)
+{
+	assert(heap != NULL);
+
+	_gfx_mutex_lock(&heap->ops.stream.lock);
+
+	GFXVec* reqs = &heap->ops.stream.requests;
+	GFXVec* flight = &heap->ops.stream.flight;
+	bool success = 1;
+
+	// Partial write operations, each of one region,
+	// and all requests taken out of the queue to submit them.
+	GFXVec ops, regions, deps, taken;
+	gfx_vec_init(&ops, sizeof(GFXWriteOp));
+	gfx_vec_init(&regions, sizeof(GFXRegion));
+	gfx_vec_init(&deps, sizeof(GFXInject));
+	gfx_vec_init(&taken, sizeof(_GFXStreamReq*));
+
+	// Go over all requests in priority order and gather parts to submit
+	// until the budget is reached. When done, the next part to submit is
+	// region r of request q, of which done units were already submitted.
+	uint64_t total = 0;
+	size_t q, r = 0;
+	uint64_t done = 0;
+
+	for (q = 0; q < reqs->size; ++q)
+	{
+		_GFXStreamReq* req = *(_GFXStreamReq**)gfx_vec_at(reqs, q);
+		bool first = (req->region == 0 && req->done == 0);
+
+		for (r = req->region, done = req->done; r < req->numRegions; ++r, done = 0)
+		{
+			const _GFXStreamRegion* reg = &req->regions[r];
+
+			while (done < reg->units)
+			{
+				// Parts of image regions cannot cross slices.
+				uint64_t num = GFX_MIN(
+					reg->units - done, reg->rows - done % reg->rows);
+
+				// Out of budget, split at whole units.
+				// Unless nothing is submitted yet, then submit one unit.
+				if (budget > 0 && total + num * reg->unit > budget)
+				{
+					const uint64_t fit =
+						total < budget ? (budget - total) / reg->unit : 0;
+
+					if (fit > 0)
+						num = fit;
+					else if (total > 0)
+						goto submit;
+					else
+						num = 1;
+				}
+
+				GFXRegion parts[2];
+				_gfx_stream_part(req, r, done, num, parts);
+
+				GFXWriteOp op = {
+					.src = req->data,
+					.dst = req->dst,
+					.numRegions = 1,
+					.srcRegions = NULL,
+					.dstRegions = NULL
+				};
+
+				if (!gfx_vec_push(&ops, 1, &op) || !gfx_vec_push(&regions, 2, parts))
+					goto clean;
+
+				// First part of the request, submit its wait commands with it.
+				if (first)
+				{
+					for (size_t d = 0; d < req->numDeps; ++d)
+						if (req->deps[d].type == GFX_DEP_WAIT)
+							if (!gfx_vec_push(&deps, 1, req->deps + d))
+								goto clean;
+
+					first = 0;
+				}
+
+				total += num * reg->unit;
+				done += num;
+			}
+		}
+
+		// Request completed, submit its signal commands with it.
+		for (size_t d = 0; d < req->numDeps; ++d)
+			if (req->deps[d].type != GFX_DEP_WAIT)
+				if (!gfx_vec_push(&deps, 1, req->deps + d))
+					goto clean;
+	}
+
+submit:
+	// Nothing to submit.
+	if (ops.size == 0)
+		goto clear;
+
+	for (size_t o = 0; o < ops.size; ++o)
+	{
+		GFXWriteOp* op = gfx_vec_at(&ops, o);
+		op->srcRegions = gfx_vec_at(&regions, o * 2);
+		op->dstRegions = gfx_vec_at(&regions, o * 2 + 1);
+	}
+
+	// Take all requests we submit parts of out of the queue, so we can
+	// unlock while submitting, other threads can keep queueing uploads.
+	// Freeing any of their destinations waits until we are done.
+	const size_t numTaken = GFX_MIN(q + 1, reqs->size);
+
+	if (
+		!gfx_vec_push(&taken, numTaken, gfx_vec_at(reqs, 0)) ||
+		!gfx_vec_push(flight, numTaken, gfx_vec_at(reqs, 0)))
+	{
+		goto clean;
+	}
+
+	gfx_vec_erase(reqs, numTaken, 0);
+	_gfx_mutex_unlock(&heap->ops.stream.lock);
+
+	success = gfx_write_batch(
+		GFX_TRANSFER_ASYNC | GFX_TRANSFER_FLUSH,
+		ops.size, deps.size,
+		gfx_vec_at(&ops, 0), gfx_vec_at(&deps, 0));
+
+	_gfx_mutex_lock(&heap->ops.stream.lock);
+
+	// Put back all requests that are not completed, in reverse so they
+	// keep their order. If we failed, none of them are.
+	// On success, remember where the partially submitted one is at.
+	for (size_t t = numTaken; t > 0; --t)
+	{
+		_GFXStreamReq* req = *(_GFXStreamReq**)gfx_vec_at(&taken, t-1);
+
+		for (size_t f = flight->size; f > 0; --f)
+			if (*(_GFXStreamReq**)gfx_vec_at(flight, f-1) == req)
+			{
+				gfx_vec_erase(flight, 1, f-1);
+				break;
+			}
+
+		if (success && t-1 < q)
+			free(req);
+		else
+		{
+			if (success)
+				req->region = r,
+				req->done = done;
+
+			_gfx_stream_requeue(heap, req);
+		}
+	}
+
+	_gfx_cond_broadcast(&heap->ops.stream.cond);
+
+	if (success)
+		goto clear;
+
+
+	// Cleanup on failure.
+clean:
+	gfx_log_error("Could not submit streaming uploads.");
+	success = 0;
+clear:
+	gfx_vec_clear(&ops);
+	gfx_vec_clear(&regions);
+	gfx_vec_clear(&deps);
+	gfx_vec_clear(&taken);
+
+	_gfx_mutex_unlock(&heap->ops.stream.lock);
+
+	return success;
+}
+
+/****************************/
+GFX_API void* gfx_map(GFXBufferRef ref)
+{
+	assert(GFX_REF_IS_BUFFER(ref));
+
+	// Unpack reference.
+	_GFXUnpackRef unp = _gfx_ref_unpack(ref);
+
+#if !defined (NDEBUG)
 	// Validate host visibility.
 	if (!(GFX_MEMORY_HOST_VISIBLE & _GFX_UNPACK_REF_FLAGS(unp)))
 		gfx_log_warn(
@@ -1369,8 +2923,15 @@ GFX_API void* gfx_map(GFXBufferRef ref)
 	void* ptr = NULL;
 
 	if (unp.obj.buffer != NULL)
-		ptr = _gfx_map(&unp.obj.buffer->heap->allocator, &unp.obj.buffer->alloc),
-		ptr = (ptr == NULL) ? NULL : (void*)((char*)ptr + unp.value);
+	{
+		_GFXAllocator* alloc = &unp.obj.buffer->heap->allocator;
+		ptr = _gfx_map(alloc, &unp.obj.buffer->alloc);
+
+		// Make device writes visible to the host.
+		if (ptr != NULL)
+			_gfx_mem_invalidate(alloc, &unp.obj.buffer->alloc),
+			ptr = (void*)((char*)ptr + unp.value);
+	}
 
 	return ptr;
 }
@@ -1387,6 +2948,8 @@ GFX_API void gfx_unmap(GFXBufferRef ref)
 	// This function is required to be called _exactly_ once (and no more)
 	// for every gfx_map, given this is the exact same assumption as
 	// _gfx_unmap makes, this should all work out...
+	// Flush first, to make host writes visible to the device.
 	if (unp.obj.buffer != NULL)
+		_gfx_mem_flush(&unp.obj.buffer->heap->allocator, &unp.obj.buffer->alloc),
 		_gfx_unmap(&unp.obj.buffer->heap->allocator, &unp.obj.buffer->alloc);
 }
@@ -15,8 +15,8 @@
 // Detect whether a render pass is warmed.
 #define _GFX_PASS_IS_WARMED(rPass) (rPass->vk.pass != VK_NULL_HANDLE)
 
-// Detect whether a render pass is built.
-#define _GFX_PASS_IS_BUILT(rPass) (rPass->vk.frames.size > 0)
+// Detect whether a render pass is built (framebuffers live in the master).
+#define _GFX_PASS_IS_BUILT(rPass) (_GFX_PASS_MASTER(rPass)->vk.frames.size > 0)
 
 // Auto log on any zero or mismatching framebuffer dimensions.
 #define _GFX_VALIDATE_DIMS(rPass, width, height, layers, action) \
@@ -58,7 +58,8 @@
 typedef struct _GFXViewElem
 {
 	const _GFXConsume* consume;
-	VkImageView        view; // Remains VK_NULL_HANDLE if a swapchain.
+	VkImageView        view;  // Cached, remains VK_NULL_HANDLE if a swapchain.
+	VkImage            image; // Image the view was built for.
 
 } _GFXViewElem;
 
@@ -68,8 +69,8 @@ typedef struct _GFXViewElem
  */
 typedef struct _GFXFrameElem
 {
-	VkImageView   view; // Swapchain view, may be VK_NULL_HANDLE.
-	VkFramebuffer buffer;
+	VkImageView   view;   // Swapchain view (cached), may be VK_NULL_HANDLE.
+	VkFramebuffer buffer; // Owned by the framebuffer cache, created lazily.
 
 } _GFXFrameElem;
 
@@ -218,6 +219,9 @@ invalidate:
 	con->out.initial = VK_IMAGE_LAYOUT_UNDEFINED;
 	con->out.final = VK_IMAGE_LAYOUT_UNDEFINED;
 	con->out.prev = NULL;
+	con->out.first = 0;
+	con->out.local = 0;
+	con->out.event = SIZE_MAX;
 
 	// Changed a pass, the graph is invalidated.
 	// This makes it so the graph will destruct this pass before anything else.
@@ -239,29 +243,24 @@ static void _gfx_pass_destruct_partial(_GFXRenderPass* rPass,
 	assert(rPass != NULL);
 	assert(rPass->base.type == GFX_PASS_RENDER);
 
+	// Subpasses do not own any framebuffers, forward to the master,
+	// which resets the build output of the entire chain.
+	if (rPass->out.master != NULL)
+	{
+		_gfx_pass_destruct_partial((_GFXRenderPass*)rPass->out.master, flags);
+		return;
+	}
+
 	// The recreate flag is always set if anything is set and signals that
 	// the actual images have been recreated.
 	if (flags & _GFX_RECREATE)
 	{
-		// Make all framebuffers and views stale.
-		// Note that they might still be in use by pending virtual frames.
-		// NOT locked using the renderer's lock;
-		// the reason that _gfx_pass_(build|destruct) are not thread-safe.
-		for (size_t i = 0; i < rPass->vk.frames.size; ++i)
-		{
-			_GFXFrameElem* elem = gfx_vec_at(&rPass->vk.frames, i);
-			_gfx_push_stale(rPass->base.renderer,
-				elem->buffer, elem->view,
-				VK_NULL_HANDLE, VK_NULL_HANDLE);
-		}
-
+		// All views and framebuffers are owned by the renderer's cache,
+		// which evicts them once their images are destroyed.
+		// So just forget about them, they might be reused on rebuild.
 		for (size_t i = 0; i < rPass->vk.views.size; ++i)
 		{
 			_GFXViewElem* elem = gfx_vec_at(&rPass->vk.views, i);
-			if (elem->view != VK_NULL_HANDLE)
-				_gfx_push_stale(rPass->base.renderer,
-					VK_NULL_HANDLE, elem->view,
-					VK_NULL_HANDLE, VK_NULL_HANDLE);
 
 			// We DO NOT release rPass->vk.views.
 			// This because on-swapchain recreate, the consumptions of
@@ -273,9 +272,16 @@ static void _gfx_pass_destruct_partial(_GFXRenderPass* rPass,
 		}
 
 		// We do not re-filter, so we must keep `build.backing`!
-		rPass->build.fWidth = 0;
-		rPass->build.fHeight = 0;
-		rPass->build.fLayers = 0;
+		for (
+			_GFXRenderPass* rSub = rPass;
+			rSub != NULL;
+			rSub = (_GFXRenderPass*)rSub->out.next)
+		{
+			rSub->build.fWidth = 0;
+			rSub->build.fHeight = 0;
+			rSub->build.fLayers = 0;
+		}
+
 		gfx_vec_release(&rPass->vk.frames); // Force a rebuild.
 	}
 
@@ -283,12 +289,19 @@ static void _gfx_pass_destruct_partial(_GFXRenderPass* rPass,
 	// This object is cached, so no need to destroy anything.
 	if (flags & _GFX_REFORMAT)
 	{
-		rPass->build.pass = NULL;
-		rPass->vk.pass = VK_NULL_HANDLE;
+		// All subpasses reference the same Vulkan render pass.
+		for (
+			_GFXRenderPass* rSub = rPass;
+			rSub != NULL;
+			rSub = (_GFXRenderPass*)rSub->out.next)
+		{
+			rSub->build.pass = NULL;
+			rSub->vk.pass = VK_NULL_HANDLE;
 
-		// Increase generation; the render pass is used in pipelines,
-		// ergo we need to invalidate current pipelines using it.
-		_gfx_pass_gen(rPass);
+			// Increase generation; the render pass is used in pipelines,
+			// ergo we need to invalidate current pipelines using it.
+			_gfx_pass_gen(rSub);
+		}
 	}
 }
 
@@ -343,6 +356,11 @@ GFXPass* _gfx_create_pass(GFXRenderer* renderer, GFXPassType type,
 	pass->level = 0;
 	pass->order = 0;
 	pass->childs = 0;
+	pass->async = (type == GFX_PASS_COMPUTE_ASYNC);
+	pass->promote = 0;
+	pass->enabled = 1;
+	pass->culled = 0;
+	pass->devices = 0;
 
 	gfx_vec_init(&pass->consumes, sizeof(_GFXConsume));
 	gfx_vec_init(&pass->deps, sizeof(GFXInject));
@@ -456,6 +474,17 @@ void _gfx_destroy_pass(GFXPass* pass)
 		// Destruct all partial things.
 		_gfx_pass_destruct_partial(rPass, _GFX_RECREATE_ALL);
 
+		// Unlink it from its subpass chain,
+		// so the master never walks into a freed pass.
+		if (rPass->out.master != NULL)
+		{
+			_GFXRenderPass* rSub = (_GFXRenderPass*)rPass->out.master;
+			while (rSub->out.next != pass)
+				rSub = (_GFXRenderPass*)rSub->out.next;
+
+			rSub->out.next = NULL;
+		}
+
 		// Free all remaining things.
 		gfx_vec_clear(&rPass->vk.clears);
 		gfx_vec_clear(&rPass->vk.blends);
@@ -491,32 +520,66 @@ VkFramebuffer _gfx_pass_framebuffer(_GFXRenderPass* rPass, GFXFrame* frame)
 	assert(rPass->base.type == GFX_PASS_RENDER);
 	assert(frame != NULL);
 
-	// TODO:GRA: Get framebuffer from master pass.
+	GFXRenderer* rend = rPass->base.renderer;
 
-	// Just a single framebuffer.
-	if (rPass->vk.frames.size == 1)
-		return ((_GFXFrameElem*)gfx_vec_at(&rPass->vk.frames, 0))->buffer;
+	// Subpasses use the framebuffers of their master.
+	rPass = _GFX_PASS_MASTER(rPass);
 
-	// Query the swapchain image index.
-	const uint32_t image =
+	// Just a single framebuffer, or query the swapchain image index.
+	const uint32_t image = (rPass->vk.frames.size == 1) ? 0 :
 		_gfx_frame_get_swapchain_index(frame, rPass->build.backing);
 
-	// Validate & return.
-	return rPass->vk.frames.size <= image ?
-		VK_NULL_HANDLE :
-		((_GFXFrameElem*)gfx_vec_at(&rPass->vk.frames, image))->buffer;
+	if (rPass->vk.frames.size <= image)
+		return VK_NULL_HANDLE;
+
+	// Get the framebuffer from the renderer's cache if we do not have it.
+	// Lock, as this may be called from within multiple recording threads.
+	_GFXFrameElem* elem = gfx_vec_at(&rPass->vk.frames, image);
+	_gfx_mutex_lock(&rend->graph.lock);
+
+	if (elem->buffer == VK_NULL_HANDLE)
+	{
+		const size_t numViews = rPass->vk.views.size;
+		VkImageView* views = malloc(sizeof(VkImageView) * GFX_MAX(1, numViews));
+
+		if (views != NULL)
+		{
+			for (size_t i = 0; i < numViews; ++i)
+			{
+				// Swapchain views are left empty, fill them in.
+				views[i] = ((_GFXViewElem*)gfx_vec_at(&rPass->vk.views, i))->view;
+				if (views[i] == VK_NULL_HANDLE) views[i] = elem->view;
+			}
+
+			elem->buffer = _gfx_render_graph_framebuffer(rend,
+				rPass->vk.pass,
+				GFX_MAX(1, rPass->build.fWidth),
+				GFX_MAX(1, rPass->build.fHeight),
+				GFX_MAX(1, rPass->build.fLayers),
+				numViews, views);
+
+			free(views);
+		}
+	}
+
+	VkFramebuffer buffer = elem->buffer;
+	_gfx_mutex_unlock(&rend->graph.lock);
+
+	return buffer;
 }
 
 /****************************
  * Filters all consumed attachments into framebuffer views &
  * a potential window to use as back-buffer, silently logging issues.
- * @param rPass Cannot be NULL.
+ * Filters the consumptions of all subpasses in the chain.
+ * @param rPass Cannot be NULL, must be a master pass.
  * @return Zero on failure.
  */
 static bool _gfx_pass_filter_attachments(_GFXRenderPass* rPass)
 {
 	assert(rPass != NULL);
 	assert(rPass->base.type == GFX_PASS_RENDER);
+	assert(rPass->out.master == NULL);
 
 	GFXRenderer* rend = rPass->base.renderer;
 
@@ -524,101 +587,126 @@ static bool _gfx_pass_filter_attachments(_GFXRenderPass* rPass)
 	if (rPass->vk.views.size > 0)
 		return 1;
 
-	// TODO:GRA: Should get from all next subpasses too and skip if not master.
-	// Literally point to the consume elem of a next pass.
-	// Note that we can still only have one window attachment for
-	// framebuffer creation reasons + we CAN have multiple depth/stencil
-	// attachments now, one per subpass!
-
 	// Reserve as many views as there are attachments, can never be more.
-	if (!gfx_vec_reserve(&rPass->vk.views, rPass->base.consumes.size))
-		return 0;
+	size_t numConsumes = 0;
 
-	// And start looping over all consumptions :)
-	size_t depSten = SIZE_MAX; // Only to warn for duplicates.
+	for (
+		_GFXRenderPass* rSub = rPass;
+		rSub != NULL;
+		rSub = (_GFXRenderPass*)rSub->out.next)
+	{
+		numConsumes += rSub->base.consumes.size;
+	}
 
-	for (size_t i = 0; i < rPass->base.consumes.size; ++i)
+	if (!gfx_vec_reserve(&rPass->vk.views, numConsumes))
+		return 0;
+
+	// And start looping over all consumptions of all subpasses :)
+	// We can only have one window attachment for the entire chain, for
+	// framebuffer creation reasons, but one depth/stencil per subpass.
+	for (
+		_GFXRenderPass* rSub = rPass;
+		rSub != NULL;
+		rSub = (_GFXRenderPass*)rSub->out.next)
 	{
-		const _GFXConsume* con = gfx_vec_at(&rPass->base.consumes, i);
-		const _GFXAttach* at = gfx_vec_at(&rend->backing.attachs, con->view.index);
+		size_t depSten = SIZE_MAX; // Only to warn for duplicates.
 
-		// Validate existence of the attachment.
-		if (
-			con->view.index >= rend->backing.attachs.size ||
-			at->type == _GFX_ATTACH_EMPTY)
+		for (size_t i = 0; i < rSub->base.consumes.size; ++i)
 		{
-			gfx_log_warn(
-				"Consumption of attachment at index %"GFX_PRIs" ignored, "
-				"attachment not described.",
-				con->view.index);
+			const _GFXConsume* con = gfx_vec_at(&rSub->base.consumes, i);
+			const _GFXAttach* at = gfx_vec_at(&rend->backing.attachs, con->view.index);
 
-			continue;
-		}
+			// Validate existence of the attachment.
+			if (
+				con->view.index >= rend->backing.attachs.size ||
+				at->type == _GFX_ATTACH_EMPTY)
+			{
+				gfx_log_warn(
+					"Consumption of attachment at index %"GFX_PRIs" ignored, "
+					"attachment not described.",
+					con->view.index);
 
-		// Validate that we want to access it as attachment.
-		if (!(con->mask &
-			(GFX_ACCESS_ATTACHMENT_INPUT |
-			GFX_ACCESS_ATTACHMENT_READ |
-			GFX_ACCESS_ATTACHMENT_WRITE |
-			GFX_ACCESS_ATTACHMENT_RESOLVE)))
-		{
-			continue;
-		}
+				continue;
+			}
 
-		// If a window we read/write color to, pick it.
-		if (at->type == _GFX_ATTACH_WINDOW &&
-			(con->view.range.aspect & GFX_IMAGE_COLOR) &&
-			(con->mask &
-				(GFX_ACCESS_ATTACHMENT_READ |
+			// Validate that we want to access it as attachment.
+			if (!(con->mask &
+				(GFX_ACCESS_ATTACHMENT_INPUT |
+				GFX_ACCESS_ATTACHMENT_READ |
 				GFX_ACCESS_ATTACHMENT_WRITE |
 				GFX_ACCESS_ATTACHMENT_RESOLVE)))
-		{
-			// Check if we already had a backing window.
-			if (rPass->build.backing == SIZE_MAX)
-				rPass->build.backing = con->view.index;
-			else
 			{
-				// Skip any other candidate, cannot create a view for it.
+				continue;
+			}
+
+			// Check if a previous subpass already made a view for it.
+			bool filtered = 0;
+
+			for (size_t v = 0; !filtered && v < rPass->vk.views.size; ++v)
+			{
+				const _GFXViewElem* view = gfx_vec_at(&rPass->vk.views, v);
+				filtered = view->consume->view.index == con->view.index;
+			}
+
+			// If a window we read/write color to, pick it.
+			if (at->type == _GFX_ATTACH_WINDOW &&
+				(con->view.range.aspect & GFX_IMAGE_COLOR) &&
+				(con->mask &
+					(GFX_ACCESS_ATTACHMENT_READ |
+					GFX_ACCESS_ATTACHMENT_WRITE |
+					GFX_ACCESS_ATTACHMENT_RESOLVE)))
+			{
+				// Check if we already had a backing window.
+				if (rPass->build.backing == SIZE_MAX)
+					rPass->build.backing = con->view.index;
+
+				else if (rPass->build.backing != con->view.index)
+				{
+					// Skip any other candidate, cannot create a view for it.
+					gfx_log_warn(
+						"Consumption of attachment at index %"GFX_PRIs" "
+						"ignored, a single pass can only read/write to a "
+						"single window attachment at a time.",
+						con->view.index);
+
+					continue;
+				}
+			}
+
+			// Skip any other windows too, no view will be created.
+			else if (at->type == _GFX_ATTACH_WINDOW)
+			{
 				gfx_log_warn(
-					"Consumption of attachment at index %"GFX_PRIs" "
-					"ignored, a single pass can only read/write to a "
-					"single window attachment at a time.",
+					"Consumption of attachment at index %"GFX_PRIs" ignored, "
+					"a pass can only read/write to a window attachment.",
 					con->view.index);
 
 				continue;
 			}
-		}
-
-		// Skip any other windows too, no view will be created.
-		else if (at->type == _GFX_ATTACH_WINDOW)
-		{
-			gfx_log_warn(
-				"Consumption of attachment at index %"GFX_PRIs" ignored, "
-				"a pass can only read/write to a window attachment.",
-				con->view.index);
 
-			continue;
-		}
+			// If a depth/stencil we read/write to, warn for duplicates.
+			else if (
+				GFX_FORMAT_HAS_DEPTH_OR_STENCIL(at->image.base.format) &&
+				(con->view.range.aspect &
+					(GFX_IMAGE_DEPTH | GFX_IMAGE_STENCIL)) &&
+				(con->mask &
+					(GFX_ACCESS_ATTACHMENT_READ | GFX_ACCESS_ATTACHMENT_WRITE)))
+			{
+				if (depSten == SIZE_MAX)
+					depSten = con->view.index;
+				else
+					gfx_log_warn(
+						"A single pass can only read/write to a single "
+						"depth/stencil attachment at a time.");
+			}
 
-		// If a depth/stencil we read/write to, warn for duplicates.
-		else if (
-			GFX_FORMAT_HAS_DEPTH_OR_STENCIL(at->image.base.format) &&
-			(con->view.range.aspect &
-				(GFX_IMAGE_DEPTH | GFX_IMAGE_STENCIL)) &&
-			(con->mask &
-				(GFX_ACCESS_ATTACHMENT_READ | GFX_ACCESS_ATTACHMENT_WRITE)))
-		{
-			if (depSten == SIZE_MAX)
-				depSten = con->view.index;
-			else
-				gfx_log_warn(
-					"A single pass can only read/write to a single "
-					"depth/stencil attachment at a time.");
+			// Add a view element referencing this (first) consumption.
+			if (!filtered)
+			{
+				_GFXViewElem elem = { .consume = con, .view = VK_NULL_HANDLE };
+				gfx_vec_push(&rPass->vk.views, 1, &elem);
+			}
 		}
-
-		// Add a view element referencing this consumption.
-		_GFXViewElem elem = { .consume = con, .view = VK_NULL_HANDLE };
-		gfx_vec_push(&rPass->vk.views, 1, &elem);
 	}
 
 	return 1;
@@ -650,19 +738,45 @@ static uint32_t _gfx_pass_find_attachment(_GFXRenderPass* rPass, size_t index)
 	return VK_ATTACHMENT_UNUSED;
 }
 
+/****************************
+ * Finds the consumption of an attachment by a single (sub)pass.
+ * @param rPass Cannot be NULL.
+ * @param index Attachment index to find.
+ * @return NULL if the attachment is not consumed as attachment.
+ */
+static const _GFXConsume* _gfx_pass_find_consume(_GFXRenderPass* rPass,
+                                                 size_t index)
+{
+	assert(rPass != NULL);
+	assert(rPass->base.type == GFX_PASS_RENDER);
+
+	for (size_t i = 0; i < rPass->base.consumes.size; ++i)
+	{
+		const _GFXConsume* con = gfx_vec_at(&rPass->base.consumes, i);
+		if (con->view.index == index)
+			return (con->mask &
+				(GFX_ACCESS_ATTACHMENT_INPUT |
+				GFX_ACCESS_ATTACHMENT_READ |
+				GFX_ACCESS_ATTACHMENT_WRITE |
+				GFX_ACCESS_ATTACHMENT_RESOLVE)) ? con : NULL;
+	}
+
+	return NULL;
+}
+
 /****************************/
 bool _gfx_pass_warmup(_GFXRenderPass* rPass)
 {
 	assert(rPass != NULL);
 	assert(rPass->base.type == GFX_PASS_RENDER);
 
-	GFXRenderer* rend = rPass->base.renderer;
+	// Subpasses are warmed up by their master,
+	// which propagates the Vulkan render pass to the entire chain.
+	if (rPass->out.master != NULL)
+		return _gfx_pass_warmup((_GFXRenderPass*)rPass->out.master);
 
-	// TODO:GRA: Somehow do this for all subpasses if this is master.
-	// And skip all this if this is not master.
-	// Need to set the correct state.enabled value for all subpasses.
-	// And somehow propagate the VK pass and subpass index to all subpasses.
-	// Used for creating pipelines, which are still for specific passes.
+	GFXRenderer* rend = rPass->base.renderer;
+	_GFXContext* context = rend->cache.context;
 
 	// Already warmed.
 	if (_GFX_PASS_IS_WARMED(rPass))
@@ -673,27 +787,42 @@ bool _gfx_pass_warmup(_GFXRenderPass* rPass)
 	if (!_gfx_pass_filter_attachments(rPass))
 		return 0;
 
+	// Gather all subpasses of the chain.
+	size_t numSubs = 0;
+	size_t numConsumes = 0;
+
+	for (
+		_GFXRenderPass* rSub = rPass;
+		rSub != NULL;
+		rSub = (_GFXRenderPass*)rSub->out.next)
+	{
+		++numSubs;
+		numConsumes += rSub->base.consumes.size;
+	}
+
+	_GFXRenderPass* subs[numSubs];
+	subs[0] = rPass;
+	for (size_t s = 1; s < numSubs; ++s)
+		subs[s] = (_GFXRenderPass*)subs[s-1]->out.next;
+
 	// We are always gonna update the clear & blend values.
 	// Do it here and not build so we don't unnecessarily reconstruct this.
 	// Same for state variables & enables.
+	// Clear values are per attachment, blend values are per subpass.
 	gfx_vec_release(&rPass->vk.clears);
-	gfx_vec_release(&rPass->vk.blends);
-	rPass->state.samples = 1;
-	rPass->state.enabled = 0;
 
-	// Both just need one element per view.
 	if (!gfx_vec_reserve(&rPass->vk.clears, rPass->vk.views.size))
 		return 0;
 
-	if (!gfx_vec_reserve(&rPass->vk.blends, rPass->vk.views.size))
-		return 0;
+	for (size_t s = 0; s < numSubs; ++s)
+	{
+		gfx_vec_release(&subs[s]->vk.blends);
+		subs[s]->state.samples = 1;
+		subs[s]->state.enabled = 0;
 
-	// Describe all attachments.
-	// We loop over all framebuffer views, which guarantees non-empty
-	// attachments with attachment input/read/write/resolve access.
-	// Keep track of all the input/color and depth/stencil attachment counts.
-	size_t numInputs = 0;
-	size_t numColors = 0;
+		if (!gfx_vec_reserve(&subs[s]->vk.blends, rPass->vk.views.size))
+			return 0;
+	}
 
 	const VkAttachmentReference unused = (VkAttachmentReference){
 		.attachment = VK_ATTACHMENT_UNUSED,
@@ -701,38 +830,41 @@ bool _gfx_pass_warmup(_GFXRenderPass* rPass)
 	};
 
 	const size_t vlaViews = rPass->vk.views.size > 0 ? rPass->vk.views.size : 1;
+	const size_t vlaDeps = numConsumes > 0 ? numConsumes : 1;
 	VkAttachmentDescription ad[vlaViews];
-	VkAttachmentReference input[vlaViews];
-	VkAttachmentReference color[vlaViews];
-	VkAttachmentReference resolve[vlaViews];
-	VkAttachmentReference depSten = unused;
+	uint32_t firstSub[vlaViews];
+	uint32_t lastSub[vlaViews];
 
+	// Describe all attachments.
+	// We loop over all framebuffer views, which guarantees non-empty
+	// attachments with attachment input/read/write/resolve access.
+	// Describe loading by the first and storing by the last consumption.
 	for (size_t i = 0; i < rPass->vk.views.size; ++i)
 	{
 		const _GFXViewElem* view = gfx_vec_at(&rPass->vk.views, i);
 		const _GFXConsume* con = view->consume;
+		const _GFXConsume* last = con;
 		const _GFXAttach* at = gfx_vec_at(&rend->backing.attachs, con->view.index);
 
-		bool isColor = 0;
+		firstSub[i] = UINT32_MAX;
+		lastSub[i] = 0;
 
-		// Swapchain.
-		if (at->type == _GFX_ATTACH_WINDOW)
+		for (size_t s = 0; s < numSubs; ++s)
 		{
-			// Reference the attachment if appropriate.
-			if (con->mask &
-				(GFX_ACCESS_ATTACHMENT_READ | GFX_ACCESS_ATTACHMENT_WRITE))
-			{
-				resolve[numColors] = unused;
-				color[numColors] = (VkAttachmentReference){
-					.attachment = (uint32_t)i,
-					.layout     = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
-				};
+			const _GFXConsume* sCon =
+				_gfx_pass_find_consume(subs[s], con->view.index);
 
-				numColors++;
-				isColor = 1;
+			if (sCon != NULL)
+			{
+				if (firstSub[i] == UINT32_MAX) firstSub[i] = (uint32_t)s;
+				lastSub[i] = (uint32_t)s;
+				last = sCon;
 			}
+		}
 
-			// Describe the attachment.
+		// Swapchain.
+		if (at->type == _GFX_ATTACH_WINDOW)
+		{
 			const bool clear = con->cleared & GFX_IMAGE_COLOR;
 			const bool load = con->out.initial != VK_IMAGE_LAYOUT_UNDEFINED;
 
@@ -746,14 +878,14 @@ bool _gfx_pass_warmup(_GFXRenderPass* rPass)
 					(load) ? VK_ATTACHMENT_LOAD_OP_LOAD :
 					VK_ATTACHMENT_LOAD_OP_DONT_CARE,
 
-				.storeOp = (con->mask & GFX_ACCESS_DISCARD) ?
+				.storeOp = (last->mask & GFX_ACCESS_DISCARD) ?
 					VK_ATTACHMENT_STORE_OP_DONT_CARE :
 					VK_ATTACHMENT_STORE_OP_STORE,
 
 				.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
 				.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
 				.initialLayout  = con->out.initial,
-				.finalLayout    = con->out.final
+				.finalLayout    = last->out.final
 			};
 		}
 
@@ -762,11 +894,6 @@ bool _gfx_pass_warmup(_GFXRenderPass* rPass)
 		{
 			const GFXFormat fmt = at->image.base.format;
 
-			const bool aspectMatch =
-				con->view.range.aspect &
-				(GFX_FORMAT_HAS_DEPTH_OR_STENCIL(fmt) ?
-					GFX_IMAGE_DEPTH | GFX_IMAGE_STENCIL : GFX_IMAGE_COLOR);
-
 			const bool firstClear =
 				!GFX_FORMAT_HAS_DEPTH_OR_STENCIL(fmt) ?
 					con->cleared & GFX_IMAGE_COLOR :
@@ -785,51 +912,6 @@ bool _gfx_pass_warmup(_GFXRenderPass* rPass)
 				GFX_FORMAT_HAS_STENCIL(fmt) &&
 					con->out.initial != VK_IMAGE_LAYOUT_UNDEFINED;
 
-			// Build references.
-			uint32_t resolveInd =
-				_gfx_pass_find_attachment(rPass, con->resolve);
-
-			const VkAttachmentReference ref = (VkAttachmentReference){
-				.attachment = (uint32_t)i,
-				.layout = _GFX_GET_VK_IMAGE_LAYOUT(con->mask, fmt)
-			};
-
-			const VkAttachmentReference refResolve =
-				(resolveInd == VK_ATTACHMENT_UNUSED) ?
-					unused :
-					(VkAttachmentReference){
-						.attachment = resolveInd,
-						.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
-					};
-
-			// Reference the attachment if appropriate.
-			if (con->mask & GFX_ACCESS_ATTACHMENT_INPUT)
-				input[numInputs++] = aspectMatch ? ref : unused;
-
-			if (con->mask &
-				(GFX_ACCESS_ATTACHMENT_READ | GFX_ACCESS_ATTACHMENT_WRITE))
-			{
-				if (!GFX_FORMAT_HAS_DEPTH_OR_STENCIL(fmt))
-					resolve[numColors] = aspectMatch ? refResolve : unused,
-					color[numColors] = aspectMatch ? ref : unused,
-					numColors++,
-					isColor = 1;
-
-				// Only set depSten on aspect match.
-				else if (aspectMatch)
-				{
-					depSten = ref;
-
-					// Adjust state enables.
-					rPass->state.enabled &= ~(unsigned int)(
-						_GFX_PASS_DEPTH | _GFX_PASS_STENCIL);
-					rPass->state.enabled |= (unsigned int)(
-						(GFX_FORMAT_HAS_DEPTH(fmt) ? _GFX_PASS_DEPTH : 0) |
-						(GFX_FORMAT_HAS_STENCIL(fmt) ? _GFX_PASS_STENCIL : 0));
-				}
-			}
-
-			// Describe the attachment.
 			ad[i] = (VkAttachmentDescription){
 				.flags   = 0,
 				.format  = at->image.vk.format,
@@ -840,7 +922,7 @@ bool _gfx_pass_warmup(_GFXRenderPass* rPass)
 					(firstLoad) ? VK_ATTACHMENT_LOAD_OP_LOAD :
 					VK_ATTACHMENT_LOAD_OP_DONT_CARE,
 
-				.storeOp = (con->mask & GFX_ACCESS_DISCARD) ?
+				.storeOp = (last->mask & GFX_ACCESS_DISCARD) ?
 					VK_ATTACHMENT_STORE_OP_DONT_CARE :
 					VK_ATTACHMENT_STORE_OP_STORE,
 
@@ -849,93 +931,266 @@ bool _gfx_pass_warmup(_GFXRenderPass* rPass)
 					(secondLoad) ? VK_ATTACHMENT_LOAD_OP_LOAD :
 					VK_ATTACHMENT_LOAD_OP_DONT_CARE,
 
-				.stencilStoreOp = (con->mask & GFX_ACCESS_DISCARD) ?
+				.stencilStoreOp = (last->mask & GFX_ACCESS_DISCARD) ?
 					VK_ATTACHMENT_STORE_OP_DONT_CARE :
 					VK_ATTACHMENT_STORE_OP_STORE,
 
 				.initialLayout = con->out.initial,
-				.finalLayout = con->out.final
+				.finalLayout = last->out.final
 			};
-
-			// Remember the greatest sample count for pipelines.
-			if (ad[i].samples > rPass->state.samples)
-				rPass->state.samples = ad[i].samples;
 		}
 
 		// Lastly, store the clear value for when we begin the pass,
 		// memory is already reserved :)
 		gfx_vec_push(&rPass->vk.clears, 1, &con->clear.vk);
+	}
+
+	// Now describe all subpasses.
+	// Keep track of all the input/color and depth/stencil attachment counts.
+	VkAttachmentReference input[numSubs][vlaViews];
+	VkAttachmentReference color[numSubs][vlaViews];
+	VkAttachmentReference resolve[numSubs][vlaViews];
+	VkAttachmentReference depSten[numSubs];
+	uint32_t preserve[numSubs][vlaViews];
+	VkSubpassDescription sd[numSubs];
+	VkSubpassDependency deps[vlaDeps];
+	size_t numDeps = 0;
+
+	for (size_t s = 0; s < numSubs; ++s)
+	{
+		_GFXRenderPass* rSub = subs[s];
+		size_t numInputs = 0;
+		size_t numColors = 0;
+		size_t numPreserves = 0;
+
+		depSten[s] = unused;
 
-		// Same for the blend values for building pipelines.
-		if (isColor)
+		for (size_t c = 0; c < rSub->base.consumes.size; ++c)
 		{
-			VkPipelineColorBlendAttachmentState pcbas = {
-				.blendEnable         = VK_FALSE,
-				.srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
-				.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO,
-				.colorBlendOp        = VK_BLEND_OP_ADD,
-				.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
-				.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
-				.alphaBlendOp        = VK_BLEND_OP_ADD,
-				.colorWriteMask      =
-					VK_COLOR_COMPONENT_R_BIT |
-					VK_COLOR_COMPONENT_G_BIT |
-					VK_COLOR_COMPONENT_B_BIT |
-					VK_COLOR_COMPONENT_A_BIT
-			};
+			const _GFXConsume* con = gfx_vec_at(&rSub->base.consumes, c);
+
+			// Skip if filtered out of the framebuffer views.
+			const uint32_t ind =
+				_gfx_pass_find_attachment(rPass, con->view.index);
+
+			if (ind == VK_ATTACHMENT_UNUSED || _gfx_pass_find_consume(
+				rSub, con->view.index) == NULL)
+			{
+				continue;
+			}
+
+			const _GFXAttach* at = gfx_vec_at(&rend->backing.attachs, con->view.index);
+			const GFXFormat fmt = (at->type == _GFX_ATTACH_IMAGE) ?
+				at->image.base.format : GFX_FORMAT_EMPTY;
 
-			// Use independent blend state if given.
-			const GFXBlendOpState* blendColor;
-			const GFXBlendOpState* blendAlpha;
+			bool isColor = 0;
 
-			if (con->flags & _GFX_CONSUME_BLEND)
-				blendColor = &con->color,
-				blendAlpha = &con->alpha;
+			// Swapchain.
+			if (at->type == _GFX_ATTACH_WINDOW)
+			{
+				// Reference the attachment if appropriate.
+				if (con->mask &
+					(GFX_ACCESS_ATTACHMENT_READ | GFX_ACCESS_ATTACHMENT_WRITE))
+				{
+					resolve[s][numColors] = unused;
+					color[s][numColors] = (VkAttachmentReference){
+						.attachment = ind,
+						.layout     = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+					};
+
+					numColors++;
+					isColor = 1;
+				}
+			}
+
+			// Non-swapchain.
 			else
-				blendColor = &rPass->state.blend.color,
-				blendAlpha = &rPass->state.blend.alpha;
+			{
+				const bool aspectMatch =
+					con->view.range.aspect &
+					(GFX_FORMAT_HAS_DEPTH_OR_STENCIL(fmt) ?
+						GFX_IMAGE_DEPTH | GFX_IMAGE_STENCIL : GFX_IMAGE_COLOR);
+
+				// Build references.
+				uint32_t resolveInd =
+					_gfx_pass_find_attachment(rPass, con->resolve);
+
+				const VkAttachmentReference ref = (VkAttachmentReference){
+					.attachment = ind,
+					.layout = _GFX_GET_VK_IMAGE_LAYOUT(con->mask, fmt)
+				};
+
+				const VkAttachmentReference refResolve =
+					(resolveInd == VK_ATTACHMENT_UNUSED) ?
+						unused :
+						(VkAttachmentReference){
+							.attachment = resolveInd,
+							.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+						};
+
+				// Reference the attachment if appropriate.
+				if (con->mask & GFX_ACCESS_ATTACHMENT_INPUT)
+					input[s][numInputs++] = aspectMatch ? ref : unused;
 
-			if (blendColor->op != GFX_BLEND_NO_OP)
+				if (con->mask &
+					(GFX_ACCESS_ATTACHMENT_READ | GFX_ACCESS_ATTACHMENT_WRITE))
+				{
+					if (!GFX_FORMAT_HAS_DEPTH_OR_STENCIL(fmt))
+						resolve[s][numColors] = aspectMatch ? refResolve : unused,
+						color[s][numColors] = aspectMatch ? ref : unused,
+						numColors++,
+						isColor = 1;
+
+					// Only set depSten on aspect match.
+					else if (aspectMatch)
+					{
+						depSten[s] = ref;
+
+						// Adjust state enables.
+						rSub->state.enabled &= ~(unsigned int)(
+							_GFX_PASS_DEPTH | _GFX_PASS_STENCIL);
+						rSub->state.enabled |= (unsigned int)(
+							(GFX_FORMAT_HAS_DEPTH(fmt) ? _GFX_PASS_DEPTH : 0) |
+							(GFX_FORMAT_HAS_STENCIL(fmt) ? _GFX_PASS_STENCIL : 0));
+					}
+				}
+
+				// Remember the greatest sample count for pipelines.
+				if (ad[ind].samples > rSub->state.samples)
+					rSub->state.samples = ad[ind].samples;
+			}
+
+			// Form a subpass dependency with the previous subpass
+			// that consumed this attachment, if necessary.
+			if (con->out.prev != NULL && con->out.local)
 			{
-				pcbas.blendEnable = VK_TRUE;
-				pcbas.srcColorBlendFactor =
-					_GFX_GET_VK_BLEND_FACTOR(blendColor->srcFactor);
-				pcbas.dstColorBlendFactor =
-					_GFX_GET_VK_BLEND_FACTOR(blendColor->dstFactor);
-				pcbas.colorBlendOp =
-					_GFX_GET_VK_BLEND_OP(blendColor->op);
+				const _GFXConsume* prev = con->out.prev;
+
+				size_t src = s;
+				while (src > 0 &&
+					_gfx_pass_find_consume(subs[src-1], con->view.index) != prev)
+				{
+					--src;
+				}
+
+				if (src-- > 0)
+				{
+					const VkPipelineStageFlags srcStage =
+						_GFX_GET_VK_PIPELINE_STAGE_LEGACY(
+							_GFX_MOD_VK_PIPELINE_STAGE(
+								_GFX_GET_VK_PIPELINE_STAGE2(
+									prev->mask, prev->stage, fmt), context));
+
+					const VkPipelineStageFlags dstStage =
+						_GFX_GET_VK_PIPELINE_STAGE_LEGACY(
+							_GFX_MOD_VK_PIPELINE_STAGE(
+								_GFX_GET_VK_PIPELINE_STAGE2(
+									con->mask, con->stage, fmt), context));
+
+					// Attachments are only accessed at the same pixel,
+					// so the dependency can be framebuffer-local.
+					deps[numDeps++] = (VkSubpassDependency){
+						.srcSubpass    = (uint32_t)src,
+						.dstSubpass    = (uint32_t)s,
+						.srcStageMask  = srcStage != 0 ? srcStage :
+							VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+						.dstStageMask  = dstStage != 0 ? dstStage :
+							VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+						.srcAccessMask = _GFX_GET_VK_ACCESS_FLAGS_LEGACY(
+							_GFX_GET_VK_ACCESS_FLAGS2(prev->mask, fmt)),
+						.dstAccessMask = _GFX_GET_VK_ACCESS_FLAGS_LEGACY(
+							_GFX_GET_VK_ACCESS_FLAGS2(con->mask, fmt)),
+
+						.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT
+					};
+				}
 			}
 
-			if (blendAlpha->op != GFX_BLEND_NO_OP)
+			// Same for the blend values for building pipelines.
+			if (isColor)
 			{
-				pcbas.blendEnable = VK_TRUE;
-				pcbas.srcAlphaBlendFactor =
-					_GFX_GET_VK_BLEND_FACTOR(blendAlpha->srcFactor);
-				pcbas.dstAlphaBlendFactor =
-					_GFX_GET_VK_BLEND_FACTOR(blendAlpha->dstFactor);
-				pcbas.alphaBlendOp =
-					_GFX_GET_VK_BLEND_OP(blendAlpha->op);
+				VkPipelineColorBlendAttachmentState pcbas = {
+					.blendEnable         = VK_FALSE,
+					.srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
+					.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO,
+					.colorBlendOp        = VK_BLEND_OP_ADD,
+					.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+					.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+					.alphaBlendOp        = VK_BLEND_OP_ADD,
+					.colorWriteMask      =
+						VK_COLOR_COMPONENT_R_BIT |
+						VK_COLOR_COMPONENT_G_BIT |
+						VK_COLOR_COMPONENT_B_BIT |
+						VK_COLOR_COMPONENT_A_BIT
+				};
+
+				// Use independent blend state if given.
+				const GFXBlendOpState* blendColor;
+				const GFXBlendOpState* blendAlpha;
+
+				if (con->flags & _GFX_CONSUME_BLEND)
+					blendColor = &con->color,
+					blendAlpha = &con->alpha;
+				else
+					blendColor = &rSub->state.blend.color,
+					blendAlpha = &rSub->state.blend.alpha;
+
+				if (blendColor->op != GFX_BLEND_NO_OP)
+				{
+					pcbas.blendEnable = VK_TRUE;
+					pcbas.srcColorBlendFactor =
+						_GFX_GET_VK_BLEND_FACTOR(blendColor->srcFactor);
+					pcbas.dstColorBlendFactor =
+						_GFX_GET_VK_BLEND_FACTOR(blendColor->dstFactor);
+					pcbas.colorBlendOp =
+						_GFX_GET_VK_BLEND_OP(blendColor->op);
+				}
+
+				if (blendAlpha->op != GFX_BLEND_NO_OP)
+				{
+					pcbas.blendEnable = VK_TRUE;
+					pcbas.srcAlphaBlendFactor =
+						_GFX_GET_VK_BLEND_FACTOR(blendAlpha->srcFactor);
+					pcbas.dstAlphaBlendFactor =
+						_GFX_GET_VK_BLEND_FACTOR(blendAlpha->dstFactor);
+					pcbas.alphaBlendOp =
+						_GFX_GET_VK_BLEND_OP(blendAlpha->op);
+				}
+
+				gfx_vec_push(&rSub->vk.blends, 1, &pcbas);
 			}
+		}
 
-			gfx_vec_push(&rPass->vk.blends, 1, &pcbas);
+		// Preserve all attachments used before and after this subpass.
+		for (size_t i = 0; i < rPass->vk.views.size; ++i)
+		{
+			const _GFXViewElem* view = gfx_vec_at(&rPass->vk.views, i);
+
+			if (
+				firstSub[i] < s && s < lastSub[i] &&
+				_gfx_pass_find_consume(rSub, view->consume->view.index) == NULL)
+			{
+				preserve[s][numPreserves++] = (uint32_t)i;
+			}
 		}
+
+		sd[s] = (VkSubpassDescription){
+			.flags                   = 0,
+			.pipelineBindPoint       = VK_PIPELINE_BIND_POINT_GRAPHICS,
+			.inputAttachmentCount    = (uint32_t)numInputs,
+			.pInputAttachments       = numInputs > 0 ? input[s] : NULL,
+			.colorAttachmentCount    = (uint32_t)numColors,
+			.pColorAttachments       = numColors > 0 ? color[s] : NULL,
+			.pResolveAttachments     = numColors > 0 ? resolve[s] : NULL,
+			.pDepthStencilAttachment =
+				(depSten[s].attachment != VK_ATTACHMENT_UNUSED) ?
+					depSten + s : NULL,
+			.preserveAttachmentCount = (uint32_t)numPreserves,
+			.pPreserveAttachments    = numPreserves > 0 ? preserve[s] : NULL
+		};
 	}
 
 	// Ok now create the Vulkan render pass.
-	VkSubpassDescription sd = {
-		.flags                   = 0,
-		.pipelineBindPoint       = VK_PIPELINE_BIND_POINT_GRAPHICS,
-		.inputAttachmentCount    = (uint32_t)numInputs,
-		.pInputAttachments       = numInputs > 0 ? input : NULL,
-		.colorAttachmentCount    = (uint32_t)numColors,
-		.pColorAttachments       = numColors > 0 ? color : NULL,
-		.pResolveAttachments     = numColors > 0 ? resolve : NULL,
-		.pDepthStencilAttachment =
-			(depSten.attachment != VK_ATTACHMENT_UNUSED) ? &depSten : NULL,
-		.preserveAttachmentCount = 0,
-		.pPreserveAttachments    = NULL
-	};
-
 	VkRenderPassCreateInfo rpci = {
 		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
 
@@ -943,10 +1198,10 @@ bool _gfx_pass_warmup(_GFXRenderPass* rPass)
 		.flags           = 0,
 		.attachmentCount = (uint32_t)rPass->vk.views.size,
 		.pAttachments    = rPass->vk.views.size > 0 ? ad : NULL,
-		.subpassCount    = 1,
-		.pSubpasses      = &sd,
-		.dependencyCount = 0,
-		.pDependencies   = NULL
+		.subpassCount    = (uint32_t)numSubs,
+		.pSubpasses      = sd,
+		.dependencyCount = (uint32_t)numDeps,
+		.pDependencies   = numDeps > 0 ? deps : NULL
 	};
 
 	// Remember the cache element for locality!
@@ -955,6 +1210,11 @@ bool _gfx_pass_warmup(_GFXRenderPass* rPass)
 
 	rPass->vk.pass = rPass->build.pass->vk.pass;
 
+	// And propagate it to all subpasses, used for creating pipelines.
+	for (size_t s = 1; s < numSubs; ++s)
+		subs[s]->build.pass = rPass->build.pass,
+		subs[s]->vk.pass = rPass->vk.pass;
+
 	return 1;
 }
 
@@ -964,11 +1224,12 @@ bool _gfx_pass_build(_GFXRenderPass* rPass)
 	assert(rPass != NULL);
 	assert(rPass->base.type == GFX_PASS_RENDER);
 
-	GFXRenderer* rend = rPass->base.renderer;
-	_GFXContext* context = rend->cache.context;
+	// Subpasses are built by their master,
+	// which propagates the dimensions to the entire chain.
+	if (rPass->out.master != NULL)
+		return _gfx_pass_build((_GFXRenderPass*)rPass->out.master);
 
-	// TODO:GRA: Skip all this if this is not master.
-	// We somehow want to propagate the dimensions to all subpasses.
+	GFXRenderer* rend = rPass->base.renderer;
 
 	// Already built.
 	if (_GFX_PASS_IS_BUILT(rPass))
@@ -982,7 +1243,6 @@ bool _gfx_pass_build(_GFXRenderPass* rPass)
 	// We're gonna need to create all image views.
 	// Keep track of the window used as backing so we can build framebuffers.
 	// Also in here we're gonna get the dimensions (i.e. size) of the pass.
-	VkImageView views[rPass->vk.views.size > 0 ? rPass->vk.views.size : 1];
 	const _GFXAttach* backing = NULL;
 	size_t backingInd = SIZE_MAX;
 
@@ -998,7 +1258,6 @@ bool _gfx_pass_build(_GFXRenderPass* rPass)
 			// To be filled in below.
 			backing = at;
 			backingInd = i;
-			views[i] = VK_NULL_HANDLE;
 
 			// Validate dimensions.
 			_GFX_VALIDATE_DIMS(rPass,
@@ -1065,18 +1324,21 @@ bool _gfx_pass_build(_GFXRenderPass* rPass)
 				}
 			};
 
-			VkImageView* vkView = views + i;
-			_GFX_VK_CHECK(
-				context->vk.CreateImageView(
-					context->vk.device, &ivci, NULL, vkView),
-				goto clean);
+			// Get it from the renderer's cache, owned by the current backing.
+			view->view = _gfx_render_graph_view(rend,
+				at->image.backings.head, &ivci);
 
-			view->view = *vkView; // So it's made stale later on.
+			if (view->view == VK_NULL_HANDLE)
+				goto clean;
+
+			view->image = at->image.vk.image;
 		}
 	}
 
-	// Ok now we need to create all the framebuffers.
+	// Ok now we need to prepare all the framebuffers.
 	// We either have one for each window image, or just a single one.
+	// The framebuffers themselves are retrieved from the renderer's cache
+	// on first use, so we do not create any for unused swapchain images.
 	// Reserve the exact amount, it's probably not gonna change.
 	const size_t frames =
 		(backingInd != SIZE_MAX) ?
@@ -1087,7 +1349,10 @@ bool _gfx_pass_build(_GFXRenderPass* rPass)
 
 	for (size_t i = 0; i < frames; ++i)
 	{
-		_GFXFrameElem elem = { .view = VK_NULL_HANDLE };
+		_GFXFrameElem elem = {
+			.view = VK_NULL_HANDLE,
+			.buffer = VK_NULL_HANDLE
+		};
 
 		// If there is a swapchain ..
 		if (backingInd != SIZE_MAX)
@@ -1121,43 +1386,27 @@ bool _gfx_pass_build(_GFXRenderPass* rPass)
 				}
 			};
 
-			_GFX_VK_CHECK(
-				context->vk.CreateImageView(
-					context->vk.device, &ivci, NULL, &elem.view),
-				goto clean);
-
-			// Fill in the left-empty image view from above.
-			views[backingInd] = elem.view;
-		}
-
-		// Create a Vulkan framebuffer.
-		VkFramebufferCreateInfo fci = {
-			.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
-
-			.pNext           = NULL,
-			.flags           = 0,
-			.renderPass      = rPass->vk.pass,
-			.attachmentCount = (uint32_t)rPass->vk.views.size,
-			.pAttachments    = rPass->vk.views.size > 0 ? views : NULL,
-			.width           = GFX_MAX(1, rPass->build.fWidth),
-			.height          = GFX_MAX(1, rPass->build.fHeight),
-			.layers          = GFX_MAX(1, rPass->build.fLayers)
-		};
-
-		_GFX_VK_CHECK(
-			context->vk.CreateFramebuffer(
-				context->vk.device, &fci, NULL, &elem.buffer),
-			{
-				// Nvm immediately destroy the view.
-				context->vk.DestroyImageView(
-					context->vk.device, elem.view, NULL);
+			elem.view = _gfx_render_graph_view(rend, window, &ivci);
+			if (elem.view == VK_NULL_HANDLE)
 				goto clean;
-			});
+		}
 
 		// It was already reserved :)
 		gfx_vec_push(&rPass->vk.frames, 1, &elem);
 	}
 
+	// Propagate the dimensions to all subpasses, used for recording.
+	for (
+		_GFXRenderPass* rSub = (_GFXRenderPass*)rPass->out.next;
+		rSub != NULL;
+		rSub = (_GFXRenderPass*)rSub->out.next)
+	{
+		rSub->build.backing = rPass->build.backing;
+		rSub->build.fWidth = rPass->build.fWidth;
+		rSub->build.fHeight = rPass->build.fHeight;
+		rSub->build.fLayers = rPass->build.fLayers;
+	}
+
 	return 1;
 
 
@@ -1176,6 +1425,45 @@ skip_pass:
 	return 1;
 }
 
+/****************************
+ * Filters recreate flags down to the flags that affect a render pass.
+ * @param rPass Cannot be NULL, must be a master.
+ * @param flags Recreate flags of the entire renderer.
+ * @return The flags to rebuild the pass with, zero if not affected.
+ *
+ * Window attachments contribute their own recreate flags, image attachments
+ * only signal a recreate if their image was replaced since the last build.
+ */
+static _GFXRecreateFlags _gfx_pass_filter_flags(_GFXRenderPass* rPass,
+                                                _GFXRecreateFlags flags)
+{
+	assert(rPass != NULL);
+	assert(rPass->out.master == NULL);
+
+	GFXRenderer* rend = rPass->base.renderer;
+
+	// Nothing filtered yet, we do not know what is consumed.
+	if (rPass->vk.views.size == 0)
+		return flags;
+
+	_GFXRecreateFlags passFlags = 0;
+
+	for (size_t i = 0; i < rPass->vk.views.size; ++i)
+	{
+		const _GFXViewElem* view = gfx_vec_at(&rPass->vk.views, i);
+		const _GFXAttach* at =
+			gfx_vec_at(&rend->backing.attachs, view->consume->view.index);
+
+		if (at->type == _GFX_ATTACH_WINDOW)
+			passFlags |= at->window.flags;
+
+		else if (view->image != at->image.vk.image)
+			passFlags |= _GFX_RECREATE;
+	}
+
+	return passFlags & flags;
+}
+
 /****************************/
 bool _gfx_pass_rebuild(_GFXRenderPass* rPass, _GFXRecreateFlags flags)
 {
@@ -1183,20 +1471,46 @@ bool _gfx_pass_rebuild(_GFXRenderPass* rPass, _GFXRecreateFlags flags)
 	assert(rPass->base.type == GFX_PASS_RENDER);
 	assert(flags & _GFX_RECREATE);
 
+	// Subpasses are rebuilt by their master.
+	// The master always precedes them in submission order.
+	if (rPass->out.master != NULL)
+		return 1;
+
+	// Only touch the pass if any of its attachments actually changed.
+	flags = _gfx_pass_filter_flags(rPass, flags);
+	if (!(flags & _GFX_RECREATE))
+		return 1;
+
 	// Remember if we're warmed or entirely built.
+	// And the current Vulkan render pass, to see if it changes.
 	const bool warmed = _GFX_PASS_IS_WARMED(rPass);
 	const bool built = _GFX_PASS_IS_BUILT(rPass);
+	const _GFXCacheElem* pass = rPass->build.pass;
 
 	// Then we destroy the things we want to recreate.
 	_gfx_pass_destruct_partial(rPass, flags);
 
 	// Then re-perform the remembered bits :)
-	if (built)
-		return _gfx_pass_build(rPass);
-	if (warmed)
-		return _gfx_pass_warmup(rPass);
+	const bool success =
+		built ? _gfx_pass_build(rPass) :
+		warmed ? _gfx_pass_warmup(rPass) : 1;
+
+	// If the cache gave us the same Vulkan render pass, all pipelines
+	// using it are still valid, so undo the generation increase.
+	if (
+		(flags & _GFX_REFORMAT) &&
+		pass != NULL && rPass->build.pass == pass)
+	{
+		for (
+			_GFXRenderPass* rSub = rPass;
+			rSub != NULL;
+			rSub = (_GFXRenderPass*)rSub->out.next)
+		{
+			--rSub->gen;
+		}
+	}
 
-	return 1;
+	return success;
 }
 
 /****************************/
@@ -1485,6 +1799,75 @@ GFX_API GFXRenderState gfx_pass_get_state(GFXPass* pass)
 		};
 }
 
+/****************************/
+GFX_API void gfx_pass_set_enabled(GFXPass* pass, bool enabled)
+{
+	assert(pass != NULL);
+	assert(!pass->renderer->recording);
+
+	if (pass->enabled == enabled) return;
+	pass->enabled = enabled;
+
+	// Only re-cull, do not invalidate the entire graph.
+	_gfx_render_graph_cull(pass->renderer);
+}
+
+/****************************/
+GFX_API bool gfx_pass_is_enabled(GFXPass* pass)
+{
+	assert(pass != NULL);
+
+	return pass->enabled;
+}
+
+/****************************/
+GFX_API bool gfx_pass_is_culled(GFXPass* pass)
+{
+	assert(pass != NULL);
+
+	return pass->culled;
+}
+
+/****************************/
+GFX_API void gfx_pass_set_promotable(GFXPass* pass, bool promote)
+{
+	assert(pass != NULL);
+	assert(!pass->renderer->recording);
+
+	if (pass->type != GFX_PASS_COMPUTE_INLINE || pass->promote == promote)
+		return;
+
+	pass->promote = promote;
+
+	// Changes the submission order, so invalidate the graph.
+	_gfx_render_graph_invalidate(pass->renderer);
+}
+
+/****************************/
+GFX_API bool gfx_pass_is_promotable(GFXPass* pass)
+{
+	assert(pass != NULL);
+
+	return pass->promote;
+}
+
+/****************************/
+GFX_API void gfx_pass_set_devices(GFXPass* pass, uint32_t devices)
+{
+	assert(pass != NULL);
+	assert(!pass->renderer->recording);
+
+	pass->devices = devices;
+}
+
+/****************************/
+GFX_API uint32_t gfx_pass_get_devices(GFXPass* pass)
+{
+	assert(pass != NULL);
+
+	return pass->devices;
+}
+
 /****************************/
 GFX_API size_t gfx_pass_get_num_parents(GFXPass* pass)
 {
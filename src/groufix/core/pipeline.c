@@ -10,6 +10,29 @@
 #include <assert.h>
 
 
+// Minimum number of pipelines warmed up by a single worker.
+#define _GFX_WARMUP_MIN_PIPELINES 4
+
+// Maximum number of workers warming up a single batch.
+#define _GFX_WARMUP_MAX_WORKERS 64
+
+
+/****************************
+ * Batch of pipelines to warmup in parallel, shared by all workers.
+ */
+typedef struct _GFXWarmupBatch
+{
+	size_t          numRenderables;
+	GFXRenderable** renderables;
+	size_t          numComputables;
+	GFXComputable** computables;
+
+	atomic_size_t next; // Next pipeline to warmup, renderables first.
+	atomic_bool   success;
+
+} _GFXWarmupBatch;
+
+
 /****************************
  * Spin-locks a renderable for pipeline retrieval.
  */
@@ -40,18 +63,297 @@ static inline void _gfx_renderable_unlock(GFXRenderable* renderable)
 	atomic_store_explicit(&renderable->lock, 0, memory_order_release);
 }
 
+/****************************
+ * Gathers the render state of a renderable, falling back to its pass.
+ * All pointers of the returned state are non-NULL.
+ */
+static GFXRenderState _gfx_renderable_state(const GFXRenderable* renderable)
+{
+	const _GFXRenderPass* rPass = (const _GFXRenderPass*)renderable->pass;
+	const GFXRenderState* state = renderable->state;
+
+	return (GFXRenderState){
+		.raster = (state != NULL && state->raster != NULL) ?
+			state->raster : &rPass->state.raster,
+		.blend = (state != NULL && state->blend != NULL) ?
+			state->blend : &rPass->state.blend,
+		.depth = (state != NULL && state->depth != NULL) ?
+			state->depth : &rPass->state.depth,
+		.stencil = (state != NULL && state->stencil != NULL) ?
+			state->stencil : &rPass->state.stencil
+	};
+}
+
 /****************************/
-bool _gfx_renderable_pipeline(GFXRenderable* renderable,
-                              _GFXCacheElem** elem, bool warmup)
+void _gfx_renderable_dynamic(const GFXRenderable* renderable,
+                             _GFXDynamicState* dynamic)
 {
 	assert(renderable != NULL);
-	assert(warmup || elem != NULL);
+	assert(dynamic != NULL);
+
+	const _GFXRenderPass* rPass = (const _GFXRenderPass*)renderable->pass;
+	const GFXRenderState state = _gfx_renderable_state(renderable);
+
+	const VkStencilOpState sos = {
+		.failOp      = VK_STENCIL_OP_KEEP,
+		.passOp      = VK_STENCIL_OP_KEEP,
+		.depthFailOp = VK_STENCIL_OP_KEEP,
+		.compareOp   = VK_COMPARE_OP_NEVER,
+		.compareMask = 0,
+		.writeMask   = 0,
+		.reference   = 0
+	};
+
+	*dynamic = (_GFXDynamicState){
+		.cullMode    = VK_CULL_MODE_NONE,
+		.frontFace   = VK_FRONT_FACE_CLOCKWISE,
+		.depthTest   = VK_FALSE,
+		.depthWrite  = VK_FALSE,
+		.depthBounds = VK_FALSE,
+		.stencilTest = VK_FALSE,
+		.depthCmp    = VK_COMPARE_OP_ALWAYS,
+		.minDepth    = 0.0f,
+		.maxDepth    = 1.0f,
+		.front       = sos,
+		.back        = sos,
+		.constants   = { 0.0f, 0.0f, 0.0f, 0.0f }
+	};
+
+	// Nothing is used if rasterization is disabled.
+	if (state.raster->mode == GFX_RASTER_DISCARD)
+		return;
+
+	dynamic->cullMode = _GFX_GET_VK_CULL_MODE(state.raster->cull);
+	dynamic->frontFace = _GFX_GET_VK_FRONT_FACE(state.raster->front);
+
+	if (state.blend->logic == GFX_LOGIC_NO_OP)
+	{
+		dynamic->constants[0] = state.blend->constants[0];
+		dynamic->constants[1] = state.blend->constants[1];
+		dynamic->constants[2] = state.blend->constants[2];
+		dynamic->constants[3] = state.blend->constants[3];
+	}
+
+	if (rPass->state.enabled & _GFX_PASS_DEPTH)
+	{
+		dynamic->depthTest = VK_TRUE;
+		dynamic->depthCmp = _GFX_GET_VK_COMPARE_OP(state.depth->cmp);
+
+		if (state.depth->flags & GFX_DEPTH_WRITE)
+			dynamic->depthWrite = VK_TRUE;
+
+		if (state.depth->flags & GFX_DEPTH_BOUNDED)
+		{
+			dynamic->depthBounds = VK_TRUE;
+			dynamic->minDepth = state.depth->minDepth;
+			dynamic->maxDepth = state.depth->maxDepth;
+		}
+	}
+
+	if (rPass->state.enabled & _GFX_PASS_STENCIL)
+	{
+		const GFXStencilState* stencil = state.stencil;
+		dynamic->stencilTest = VK_TRUE;
+
+		dynamic->front = (VkStencilOpState){
+			.failOp = _GFX_GET_VK_STENCIL_OP(stencil->front.fail),
+			.passOp = _GFX_GET_VK_STENCIL_OP(stencil->front.pass),
+			.depthFailOp = _GFX_GET_VK_STENCIL_OP(stencil->front.depthFail),
+			.compareOp = _GFX_GET_VK_COMPARE_OP(stencil->front.cmp),
+			.compareMask = stencil->front.cmpMask,
+			.writeMask = stencil->front.writeMask,
+			.reference = stencil->front.reference
+		};
+
+		dynamic->back = (VkStencilOpState){
+			.failOp = _GFX_GET_VK_STENCIL_OP(stencil->back.fail),
+			.passOp = _GFX_GET_VK_STENCIL_OP(stencil->back.pass),
+			.depthFailOp = _GFX_GET_VK_STENCIL_OP(stencil->back.depthFail),
+			.compareOp = _GFX_GET_VK_COMPARE_OP(stencil->back.cmp),
+			.compareMask = stencil->back.cmpMask,
+			.writeMask = stencil->back.writeMask,
+			.reference = stencil->back.reference
+		};
+	}
+}
+
+/****************************
+ * Pipeline retrieval mode.
+ */
+typedef enum _GFXPipelineMode
+{
+	_GFX_PIPELINE_GET,
+	_GFX_PIPELINE_WARMUP,
+	_GFX_PIPELINE_LOOKUP // Outputs NULL if not present.
+
+} _GFXPipelineMode;
+
+
+/****************************
+ * Retrieves a graphics pipeline library holding a subset of a pipeline.
+ * @param gpci    Complete create info of the pipeline (without pNext).
+ * @param flags   The single subset of the pipeline to build.
+ * @param handles Shader handles, followed by the layout and render pass.
+ * @return NULL on failure.
+ *
+ * Only the state relevant to the subset is hashed, so libraries can be
+ * shared between many different pipelines.
+ */
+static _GFXCacheElem* _gfx_renderable_library(_GFXCache* cache,
+                                              const VkGraphicsPipelineCreateInfo* gpci,
+                                              VkGraphicsPipelineLibraryFlagsEXT flags,
+                                              const void** handles,
+                                              uint32_t numShaders)
+{
+	assert(cache != NULL);
+	assert(gpci != NULL);
+	assert(handles != NULL);
+
+	const bool vertex =
+		flags & VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT;
+	const bool preRaster =
+		flags & VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT;
+	const bool fragment =
+		flags & VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT;
+	const bool output =
+		flags & VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT;
+
+	// Filter out the shaders of this subset.
+	VkPipelineShaderStageCreateInfo pstci[numShaders > 0 ? numShaders : 1];
+	const void* libHandles[numShaders + 2];
+	uint32_t numStages = 0;
+
+	for (uint32_t s = 0; s < numShaders; ++s)
+	{
+		const bool isFragment =
+			gpci->pStages[s].stage == VK_SHADER_STAGE_FRAGMENT_BIT;
+
+		if ((preRaster && !isFragment) || (fragment && isFragment))
+			pstci[numStages] = gpci->pStages[s],
+			libHandles[numStages++] = handles[s];
+	}
+
+	// Only shaders need the pipeline layout,
+	// the vertex input interface is independent of the render pass.
+	const bool shaders = preRaster || fragment;
+
+	libHandles[numStages+0] = shaders ? handles[numShaders+0] : NULL;
+	libHandles[numStages+1] = vertex ? NULL : handles[numShaders+1];
+
+	VkGraphicsPipelineLibraryCreateInfoEXT gplci = {
+		.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT,
+
+		.pNext = NULL,
+		.flags = flags
+	};
+
+	// Leave out all state that is not part of this subset.
+	VkGraphicsPipelineCreateInfo lib = *gpci;
+	lib.pNext = &gplci;
+	lib.flags |= VK_PIPELINE_CREATE_LIBRARY_BIT_KHR;
+	lib.stageCount = numStages;
+	lib.pStages = pstci;
+
+	if (!vertex)
+		lib.pVertexInputState = NULL,
+		lib.pInputAssemblyState = NULL;
+
+	if (!preRaster)
+		lib.pViewportState = NULL,
+		lib.pRasterizationState = NULL,
+		lib.pTessellationState = NULL;
+
+	if (!fragment)
+		lib.pDepthStencilState = NULL;
+
+	if (!fragment && !output)
+		lib.pMultisampleState = NULL;
+
+	if (!output)
+		lib.pColorBlendState = NULL;
+
+	if (!shaders)
+		lib.layout = VK_NULL_HANDLE;
+
+	if (vertex)
+		lib.renderPass = VK_NULL_HANDLE,
+		lib.subpass = 0;
+
+	return _gfx_cache_get(cache, &lib.sType, libHandles);
+}
+
+/****************************
+ * Links a graphics pipeline from (cached) graphics pipeline libraries.
+ * @param gpci    Complete create info of the pipeline (without pNext).
+ * @param handles Shader handles, followed by the layout and render pass.
+ * @return NULL on failure.
+ */
+static _GFXCacheElem* _gfx_renderable_link(_GFXCache* cache,
+                                           VkGraphicsPipelineCreateInfo* gpci,
+                                           const void** handles,
+                                           uint32_t numShaders)
+{
+	assert(cache != NULL);
+	assert(gpci != NULL);
+	assert(handles != NULL);
+
+	// If we already have the pipeline, no need to link.
+	_GFXCacheElem* elem = _gfx_cache_lookup(cache, &gpci->sType, handles);
+	if (elem != NULL) return elem;
+
+	// Retrieve all four subsets of the pipeline.
+	const VkGraphicsPipelineLibraryFlagsEXT subsets[] = {
+		VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT,
+		VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT,
+		VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT,
+		VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT
+	};
+
+	VkPipeline libs[4];
+
+	for (size_t l = 0; l < 4; ++l)
+	{
+		_GFXCacheElem* lib =
+			_gfx_renderable_library(cache, gpci, subsets[l], handles, numShaders);
+
+		if (lib == NULL) return NULL;
+		libs[l] = lib->vk.pipeline;
+	}
+
+	// Link them, this is cached under the same key as the full pipeline.
+	VkPipelineLibraryCreateInfoKHR plci = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR,
+
+		.pNext        = NULL,
+		.libraryCount = 4,
+		.pLibraries   = libs
+	};
+
+	gpci->pNext = &plci;
+	elem = _gfx_cache_get(cache, &gpci->sType, handles);
+	gpci->pNext = NULL;
+
+	return elem;
+}
+
+/****************************
+ * Retrieves (or warms up) the graphics pipeline of a renderable.
+ * @see _gfx_renderable_pipeline.
+ */
+static bool _gfx_renderable_get(GFXRenderable* renderable,
+                                _GFXCacheElem** elem, _GFXPipelineMode mode)
+{
+	assert(renderable != NULL);
+	assert(mode == _GFX_PIPELINE_WARMUP || elem != NULL);
+
+	const bool warmup = (mode == _GFX_PIPELINE_WARMUP);
 
 	_GFXRenderPass* rPass = (_GFXRenderPass*)renderable->pass;
 
 	// Firstly, spin-lock the renderable and check if we have an up-to-date
 	// pipeline, if so, we can just return :)
 	// Immediately unlock afterwards for maximum concurrency!
+	// Also read the variant, so we know which one we're building.
 	_gfx_renderable_lock(renderable);
 
 	if (
@@ -63,6 +365,7 @@ bool _gfx_renderable_pipeline(GFXRenderable* renderable,
 		return 1;
 	}
 
+	const size_t variant = renderable->variant;
 	_gfx_renderable_unlock(renderable);
 
 	// We do not have a pipeline, create a new one.
@@ -96,21 +399,21 @@ bool _gfx_renderable_pipeline(GFXRenderable* renderable,
 	handles[numShaders+1] = rPass->build.pass;
 
 	// Gather appropriate state data.
-	const GFXRasterState* raster =
-		(renderable->state != NULL && renderable->state->raster != NULL) ?
-		renderable->state->raster : &rPass->state.raster;
-
-	const GFXBlendState* blend =
-		(renderable->state != NULL && renderable->state->blend != NULL) ?
-		renderable->state->blend : &rPass->state.blend;
-
-	const GFXDepthState* depth =
-		(renderable->state != NULL && renderable->state->depth != NULL) ?
-		renderable->state->depth : &rPass->state.depth;
-
-	const GFXStencilState* stencil =
-		(renderable->state != NULL && renderable->state->stencil != NULL) ?
-		renderable->state->stencil : &rPass->state.stencil;
+	// All state that is dynamic is left out of the pipeline to reduce the
+	// number of pipelines, this is set to constant values so it is left out
+	// of the cache key as well. Recorders set it with each draw command.
+	// Without extended dynamic state, only stencil masks & reference, depth
+	// bounds and blend constants are dynamic.
+	const bool extended =
+		tech->renderer->cache.context->features &
+		_GFX_SUPPORT_EXTENDED_DYNAMIC_STATE;
+
+	const GFXRenderState state = _gfx_renderable_state(renderable);
+	const GFXRasterState* raster = state.raster;
+	const GFXBlendState* blend = state.blend;
+
+	_GFXDynamicState dynamic;
+	_gfx_renderable_dynamic(renderable, &dynamic);
 
 	// Build rasterization info.
 	const bool noRaster = (raster->mode == GFX_RASTER_DISCARD);
@@ -121,7 +424,7 @@ bool _gfx_renderable_pipeline(GFXRenderable* renderable,
 		.pNext                   = NULL,
 		.flags                   = 0,
 		.depthClampEnable        = VK_FALSE,
-		.rasterizerDiscardEnable = VK_TRUE,
+		.rasterizerDiscardEnable = noRaster ? VK_TRUE : VK_FALSE,
 		.polygonMode             = VK_POLYGON_MODE_FILL,
 		.cullMode                = VK_CULL_MODE_NONE,
 		.frontFace               = VK_FRONT_FACE_CLOCKWISE,
@@ -133,13 +436,11 @@ bool _gfx_renderable_pipeline(GFXRenderable* renderable,
 	};
 
 	if (!noRaster)
-	{
-		prsci.rasterizerDiscardEnable = VK_FALSE;
-
 		prsci.polygonMode = _GFX_GET_VK_POLYGON_MODE(raster->mode);
-		prsci.cullMode = _GFX_GET_VK_CULL_MODE(raster->cull);
-		prsci.frontFace = _GFX_GET_VK_FRONT_FACE(raster->front);
-	}
+
+	if (!extended)
+		prsci.cullMode = dynamic.cullMode,
+		prsci.frontFace = dynamic.frontFace;
 
 	// Build blend info.
 	VkPipelineColorBlendStateCreateInfo pcbsci = {
@@ -154,20 +455,10 @@ bool _gfx_renderable_pipeline(GFXRenderable* renderable,
 		.blendConstants  = { 0.0f, 0.0f, 0.0f, 0.0f }
 	};
 
-	if (!noRaster)
+	if (!noRaster && blend->logic != GFX_LOGIC_NO_OP)
 	{
-		if (blend->logic != GFX_LOGIC_NO_OP)
-		{
-			pcbsci.logicOpEnable = VK_TRUE;
-			pcbsci.logicOp = _GFX_GET_VK_LOGIC_OP(blend->logic);
-		}
-		else
-		{
-			pcbsci.blendConstants[0] = blend->constants[0];
-			pcbsci.blendConstants[1] = blend->constants[1];
-			pcbsci.blendConstants[2] = blend->constants[2];
-			pcbsci.blendConstants[3] = blend->constants[3];
-		}
+		pcbsci.logicOpEnable = VK_TRUE;
+		pcbsci.logicOp = _GFX_GET_VK_LOGIC_OP(blend->logic);
 	}
 
 	// Build depth/stencil info.
@@ -197,46 +488,45 @@ bool _gfx_renderable_pipeline(GFXRenderable* renderable,
 		.maxDepthBounds        = 1.0f
 	};
 
-	if (!noRaster && (rPass->state.enabled & _GFX_PASS_DEPTH))
+	if (!extended)
 	{
-		pdssci.depthTestEnable = VK_TRUE;
-		pdssci.depthCompareOp = _GFX_GET_VK_COMPARE_OP(depth->cmp);
-
-		if (depth->flags & GFX_DEPTH_WRITE)
-			pdssci.depthWriteEnable = VK_TRUE;
-
-		if (depth->flags & GFX_DEPTH_BOUNDED)
-		{
-			pdssci.depthBoundsTestEnable = VK_TRUE;
-			pdssci.minDepthBounds = depth->minDepth;
-			pdssci.maxDepthBounds = depth->maxDepth;
-		}
+		pdssci.depthTestEnable = dynamic.depthTest;
+		pdssci.depthWriteEnable = dynamic.depthWrite;
+		pdssci.depthCompareOp = dynamic.depthCmp;
+		pdssci.depthBoundsTestEnable = dynamic.depthBounds;
+		pdssci.stencilTestEnable = dynamic.stencilTest;
+
+		pdssci.front.failOp = dynamic.front.failOp;
+		pdssci.front.passOp = dynamic.front.passOp;
+		pdssci.front.depthFailOp = dynamic.front.depthFailOp;
+		pdssci.front.compareOp = dynamic.front.compareOp;
+
+		pdssci.back.failOp = dynamic.back.failOp;
+		pdssci.back.passOp = dynamic.back.passOp;
+		pdssci.back.depthFailOp = dynamic.back.depthFailOp;
+		pdssci.back.compareOp = dynamic.back.compareOp;
 	}
 
-	if (!noRaster && (rPass->state.enabled & _GFX_PASS_STENCIL))
-	{
-		pdssci.stencilTestEnable = VK_TRUE;
-
-		pdssci.front = (VkStencilOpState){
-			.failOp = _GFX_GET_VK_STENCIL_OP(stencil->front.fail),
-			.passOp = _GFX_GET_VK_STENCIL_OP(stencil->front.pass),
-			.depthFailOp = _GFX_GET_VK_STENCIL_OP(stencil->front.depthFail),
-			.compareOp = _GFX_GET_VK_COMPARE_OP(stencil->front.cmp),
-			.compareMask = stencil->front.cmpMask,
-			.writeMask = stencil->front.writeMask,
-			.reference = stencil->front.reference
-		};
-
-		pdssci.back = (VkStencilOpState){
-			.failOp = _GFX_GET_VK_STENCIL_OP(stencil->back.fail),
-			.passOp = _GFX_GET_VK_STENCIL_OP(stencil->back.pass),
-			.depthFailOp = _GFX_GET_VK_STENCIL_OP(stencil->back.depthFail),
-			.compareOp = _GFX_GET_VK_COMPARE_OP(stencil->back.cmp),
-			.compareMask = stencil->back.cmpMask,
-			.writeMask = stencil->back.writeMask,
-			.reference = stencil->back.reference
-		};
-	}
+	// Build dynamic state info.
+	const VkDynamicState dynamics[] = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR,
+		VK_DYNAMIC_STATE_BLEND_CONSTANTS,
+		VK_DYNAMIC_STATE_DEPTH_BOUNDS,
+		VK_DYNAMIC_STATE_STENCIL_COMPARE_MASK,
+		VK_DYNAMIC_STATE_STENCIL_WRITE_MASK,
+		VK_DYNAMIC_STATE_STENCIL_REFERENCE,
+
+		// Extended dynamic state (VK_EXT_extended_dynamic_state).
+		VK_DYNAMIC_STATE_CULL_MODE_EXT,
+		VK_DYNAMIC_STATE_FRONT_FACE_EXT,
+		VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT,
+		VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT,
+		VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT,
+		VK_DYNAMIC_STATE_DEPTH_BOUNDS_TEST_ENABLE_EXT,
+		VK_DYNAMIC_STATE_STENCIL_TEST_ENABLE_EXT,
+		VK_DYNAMIC_STATE_STENCIL_OP_EXT
+	};
 
 	// Build shader info.
 	const size_t numConsts = tech->constants.size;
@@ -244,7 +534,7 @@ bool _gfx_renderable_pipeline(GFXRenderable* renderable,
 	VkSpecializationInfo si[_GFX_NUM_SHADER_STAGES];
 	VkSpecializationMapEntry sme[numConsts > 0 ? numConsts : 1];
 
-	_gfx_tech_get_constants(tech, si, sme);
+	_gfx_tech_get_constants(tech, variant, si, sme);
 
 	for (uint32_t s = 0; s < numShaders; ++s)
 	{
@@ -365,11 +655,8 @@ bool _gfx_renderable_pipeline(GFXRenderable* renderable,
 
 			.pNext             = NULL,
 			.flags             = 0,
-			.dynamicStateCount = 2,
-			.pDynamicStates    = (VkDynamicState[]){
-				VK_DYNAMIC_STATE_VIEWPORT,
-				VK_DYNAMIC_STATE_SCISSOR
-			}
+			.dynamicStateCount = extended ? 15 : 7,
+			.pDynamicStates    = dynamics
 		}}
 	};
 
@@ -378,17 +665,38 @@ bool _gfx_renderable_pipeline(GFXRenderable* renderable,
 		return _gfx_cache_warmup(&tech->renderer->cache, &gpci.sType, handles);
 	else
 	{
-		// Otherwise, actually retrieve the pipeline.
-		*elem = _gfx_cache_get(&tech->renderer->cache, &gpci.sType, handles);
+		// Otherwise, actually retrieve (or only look up) the pipeline.
+		// If possible, link it from pipeline libraries, which is much faster
+		// than compiling an entire pipeline from scratch.
+		// Skip this if rasterization is discarded, as fragment state is not
+		// part of the pipeline at all then.
+		_GFXCache* cache = &tech->renderer->cache;
+
+		const bool library =
+			mode == _GFX_PIPELINE_GET && !noRaster &&
+			(cache->context->features & _GFX_SUPPORT_PIPELINE_LIBRARY);
+
+		*elem = NULL;
+
+		if (library)
+			*elem = _gfx_renderable_link(cache, &gpci, handles, numShaders);
+
+		// Fallback to a complete pipeline if linking failed.
+		if (*elem == NULL)
+			*elem = (mode == _GFX_PIPELINE_LOOKUP) ?
+				_gfx_cache_lookup(cache, &gpci.sType, handles) :
+				_gfx_cache_get(cache, &gpci.sType, handles);
 
 		// Finally, update the stored pipeline!
-		// Skip this step on failure tho.
-		if (*elem == NULL) return 0;
+		// Skip this step on failure tho, not being present is fine.
+		// Also skip if the variant was changed meanwhile.
+		if (*elem == NULL) return (mode == _GFX_PIPELINE_LOOKUP);
 
 		_gfx_renderable_lock(renderable);
 
-		renderable->pipeline = (uintptr_t)(void*)*elem;
-		renderable->gen = _GFX_PASS_GEN(rPass);
+		if (renderable->variant == variant)
+			renderable->pipeline = (uintptr_t)(void*)*elem,
+			renderable->gen = _GFX_PASS_GEN(rPass);
 
 		_gfx_renderable_unlock(renderable);
 
@@ -396,6 +704,179 @@ bool _gfx_renderable_pipeline(GFXRenderable* renderable,
 	}
 }
 
+/****************************/
+bool _gfx_renderable_pipeline(GFXRenderable* renderable,
+                              _GFXCacheElem** elem, bool warmup)
+{
+	return _gfx_renderable_get(renderable, elem,
+		warmup ? _GFX_PIPELINE_WARMUP : _GFX_PIPELINE_GET);
+}
+
+/****************************
+ * Entry point of the background pipeline compiler thread.
+ * Compiles queued renderables until the queue is empty.
+ */
+static _GFXThreadRet _GFX_THREAD_CALL _gfx_compiler_thread(void* arg)
+{
+	GFXRenderer* renderer = arg;
+
+	while (1)
+	{
+		// Pop the next renderable, stop running if there is none.
+		_gfx_mutex_lock(&renderer->compiler.lock);
+
+		if (renderer->compiler.queue.size == 0)
+		{
+			renderer->compiler.running = 0;
+			_gfx_mutex_unlock(&renderer->compiler.lock);
+			break;
+		}
+
+		GFXRenderable* renderable =
+			*(GFXRenderable**)gfx_deque_at(&renderer->compiler.queue, 0);
+
+		gfx_deque_pop_front(&renderer->compiler.queue, 1);
+		_gfx_mutex_unlock(&renderer->compiler.lock);
+
+		// Compile it, holding the compile lock so the cache does not get
+		// flushed and the render graph does not get rebuilt meanwhile.
+		_GFXCacheElem* elem;
+
+		_gfx_mutex_lock(&renderer->compiler.compile);
+		if (!_gfx_renderable_get(renderable, &elem, _GFX_PIPELINE_GET))
+			gfx_log_warn("Failed to compile pipeline in the background.");
+		_gfx_mutex_unlock(&renderer->compiler.compile);
+
+		// On failure it is simply queued again by the next draw.
+		atomic_store_explicit(&renderable->pending, 0, memory_order_release);
+	}
+
+	return 0;
+}
+
+/****************************/
+bool _gfx_renderable_pipeline_async(GFXRenderable* renderable,
+                                    _GFXCacheElem** elem)
+{
+	assert(renderable != NULL);
+	assert(elem != NULL);
+
+	GFXRenderer* renderer = renderable->pass->renderer;
+
+	// Nothing to do if already being compiled.
+	if (atomic_load_explicit(&renderable->pending, memory_order_acquire))
+	{
+		*elem = NULL;
+		return 1;
+	}
+
+	// Check if the pipeline is already present, without compiling.
+	if (!_gfx_renderable_get(renderable, elem, _GFX_PIPELINE_LOOKUP))
+		return 0;
+
+	if (*elem != NULL)
+		return 1;
+
+	// If not, queue it for the compiler thread.
+	// Start the thread if it is not running, joining the previous one.
+	if (atomic_exchange_explicit(&renderable->pending, 1, memory_order_acquire))
+		return 1;
+
+	_gfx_mutex_lock(&renderer->compiler.lock);
+
+	if (!gfx_deque_push(&renderer->compiler.queue, 1, &renderable))
+		goto error;
+
+	if (!renderer->compiler.running)
+	{
+		if (renderer->compiler.joinable)
+			_gfx_thread_join(renderer->compiler.thread),
+			renderer->compiler.joinable = 0;
+
+		if (!_gfx_thread_create(
+			&renderer->compiler.thread, _gfx_compiler_thread, renderer))
+		{
+			gfx_deque_pop(&renderer->compiler.queue, 1);
+			goto error;
+		}
+
+		renderer->compiler.running = 1;
+		renderer->compiler.joinable = 1;
+	}
+
+	_gfx_mutex_unlock(&renderer->compiler.lock);
+
+	return 1;
+
+
+	// Compile it right here on failure.
+error:
+	_gfx_mutex_unlock(&renderer->compiler.lock);
+	atomic_store_explicit(&renderable->pending, 0, memory_order_relaxed);
+
+	gfx_log_warn("Could not queue pipeline for background compilation.");
+	return _gfx_renderable_get(renderable, elem, _GFX_PIPELINE_GET);
+}
+
+/****************************/
+bool _gfx_render_compiler_init(GFXRenderer* renderer)
+{
+	assert(renderer != NULL);
+
+	if (!_gfx_mutex_init(&renderer->compiler.lock))
+		return 0;
+
+	if (!_gfx_mutex_init(&renderer->compiler.compile))
+	{
+		_gfx_mutex_clear(&renderer->compiler.lock);
+		return 0;
+	}
+
+	renderer->compiler.enabled = 0;
+	renderer->compiler.running = 0;
+	renderer->compiler.joinable = 0;
+	gfx_deque_init(&renderer->compiler.queue, sizeof(GFXRenderable*));
+
+	return 1;
+}
+
+/****************************/
+void _gfx_render_compiler_clear(GFXRenderer* renderer)
+{
+	assert(renderer != NULL);
+
+	_gfx_render_compiler_drain(renderer);
+
+	gfx_deque_clear(&renderer->compiler.queue);
+	_gfx_mutex_clear(&renderer->compiler.compile);
+	_gfx_mutex_clear(&renderer->compiler.lock);
+}
+
+/****************************/
+void _gfx_render_compiler_drain(GFXRenderer* renderer)
+{
+	assert(renderer != NULL);
+
+	// Forget all queued renderables.
+	_gfx_mutex_lock(&renderer->compiler.lock);
+
+	for (size_t r = 0; r < renderer->compiler.queue.size; ++r)
+		atomic_store_explicit(
+			&(*(GFXRenderable**)gfx_deque_at(&renderer->compiler.queue, r))->pending,
+			0, memory_order_relaxed);
+
+	gfx_deque_release(&renderer->compiler.queue);
+
+	// Then wait for the current compilation to finish.
+	// The thread will stop due to the empty queue.
+	const bool joinable = renderer->compiler.joinable;
+	renderer->compiler.joinable = 0;
+
+	_gfx_mutex_unlock(&renderer->compiler.lock);
+
+	if (joinable) _gfx_thread_join(renderer->compiler.thread);
+}
+
 /****************************/
 bool _gfx_computable_pipeline(GFXComputable* computable,
                               _GFXCacheElem** elem, bool warmup)
@@ -443,7 +924,7 @@ bool _gfx_computable_pipeline(GFXComputable* computable,
 	VkSpecializationInfo si[_GFX_NUM_SHADER_STAGES];
 	VkSpecializationMapEntry sme[numConsts > 0 ? numConsts : 1];
 
-	_gfx_tech_get_constants(tech, si, sme);
+	_gfx_tech_get_constants(tech, computable->variant, si, sme);
 
 	VkComputePipelineCreateInfo cpci = {
 		.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
@@ -536,14 +1017,77 @@ GFX_API bool gfx_renderable(GFXRenderable* renderable,
 	renderable->technique = tech;
 	renderable->primitive = prim;
 	renderable->state = state;
+	renderable->fallback = NULL;
+	renderable->variant = 0;
 
 	atomic_store_explicit(&renderable->lock, 0, memory_order_relaxed);
+	atomic_store_explicit(&renderable->pending, 0, memory_order_relaxed);
 	renderable->pipeline = (uintptr_t)NULL;
 	renderable->gen = 0;
 
 	return 1;
 }
 
+/****************************/
+GFX_API bool gfx_renderable_variant(GFXRenderable* renderable, size_t variant)
+{
+	assert(renderable != NULL);
+
+	GFXTechnique* tech = renderable->technique;
+
+	if (tech->layout == NULL || variant >= tech->numVariants)
+	{
+		gfx_log_error(
+			"Could not set renderable variant; technique must be locked "
+			"and variant must be < %"GFX_PRIs".",
+			tech->numVariants);
+
+		return 0;
+	}
+
+	// Only drop the pipeline if the variant actually changes.
+	_gfx_renderable_lock(renderable);
+
+	if (renderable->variant != variant)
+		renderable->variant = variant,
+		renderable->pipeline = (uintptr_t)NULL;
+
+	_gfx_renderable_unlock(renderable);
+
+	return 1;
+}
+
+/****************************/
+GFX_API void gfx_renderable_fallback(GFXRenderable* renderable,
+                                     GFXTechnique* tech)
+{
+	assert(renderable != NULL);
+	assert(tech == NULL || tech->renderer == renderable->pass->renderer);
+	assert(tech == NULL ||
+		tech->shaders[_GFX_GET_SHADER_STAGE_INDEX(GFX_STAGE_COMPUTE)] == NULL);
+
+	renderable->fallback = tech;
+}
+
+/****************************/
+GFX_API bool gfx_renderable_is_ready(GFXRenderable* renderable)
+{
+	assert(renderable != NULL);
+
+	if (atomic_load_explicit(&renderable->pending, memory_order_acquire))
+		return 0;
+
+	_gfx_renderable_lock(renderable);
+
+	const bool ready =
+		renderable->pipeline != (uintptr_t)NULL &&
+		renderable->gen == _GFX_PASS_GEN((_GFXRenderPass*)renderable->pass);
+
+	_gfx_renderable_unlock(renderable);
+
+	return ready;
+}
+
 /****************************/
 GFX_API bool gfx_renderable_warmup(GFXRenderable* renderable)
 {
@@ -554,9 +1098,12 @@ GFX_API bool gfx_renderable_warmup(GFXRenderable* renderable)
 	// To build pipelines, we need the Vulkan render pass.
 	// This is the exact reason we can warmup all passes of the render graph!
 	// Sadly this is not thread-safe at all, so we re-use the renderer's lock.
+	// Also block the background compiler, as it reads from the graph.
+	_gfx_mutex_lock(&renderer->compiler.compile);
 	_gfx_mutex_lock(&renderer->lock);
 	bool success = _gfx_render_graph_warmup(renderer);
 	_gfx_mutex_unlock(&renderer->lock);
+	_gfx_mutex_unlock(&renderer->compiler.compile);
 
 	if (!success)
 	{
@@ -592,12 +1139,40 @@ GFX_API bool gfx_computable(GFXComputable* computable,
 
 	// Init computable, store NULL as pipeline.
 	computable->technique = tech;
+	computable->variant = 0;
 	atomic_store_explicit(
 		&computable->pipeline, (uintptr_t)NULL, memory_order_relaxed);
 
 	return 1;
 }
 
+/****************************/
+GFX_API bool gfx_computable_variant(GFXComputable* computable, size_t variant)
+{
+	assert(computable != NULL);
+
+	GFXTechnique* tech = computable->technique;
+
+	if (tech->layout == NULL || variant >= tech->numVariants)
+	{
+		gfx_log_error(
+			"Could not set computable variant; technique must be locked "
+			"and variant must be < %"GFX_PRIs".",
+			tech->numVariants);
+
+		return 0;
+	}
+
+	if (computable->variant != variant)
+	{
+		computable->variant = variant;
+		atomic_store_explicit(
+			&computable->pipeline, (uintptr_t)NULL, memory_order_relaxed);
+	}
+
+	return 1;
+}
+
 /****************************/
 GFX_API bool gfx_computable_warmup(GFXComputable* computable)
 {
@@ -612,3 +1187,101 @@ GFX_API bool gfx_computable_warmup(GFXComputable* computable)
 
 	return 1;
 }
+
+/****************************
+ * Job entry point, warms up pipelines of a batch until none are left,
+ * sets `success` of the batch to zero on failure.
+ */
+static void _gfx_warmup_worker(void* arg)
+{
+	_GFXWarmupBatch* batch = arg;
+	const size_t total = batch->numRenderables + batch->numComputables;
+
+	// Keep grabbing the next pipeline, as some take a lot longer to compile
+	// than others, this balances the load between all workers.
+	// Identical pipelines are only compiled once, the cache dedupes them.
+	while (1)
+	{
+		const size_t i =
+			atomic_fetch_add_explicit(&batch->next, 1, memory_order_relaxed);
+
+		if (i >= total)
+			break;
+
+		const bool success = (i < batch->numRenderables) ?
+			_gfx_renderable_pipeline(
+				batch->renderables[i], NULL, 1) :
+			_gfx_computable_pipeline(
+				batch->computables[i - batch->numRenderables], NULL, 1);
+
+		if (!success)
+			atomic_store_explicit(&batch->success, 0, memory_order_relaxed);
+	}
+}
+
+/****************************/
+GFX_API bool gfx_renderer_warmup_batch(GFXRenderer* renderer,
+                                       size_t numRenderables,
+                                       GFXRenderable** renderables,
+                                       size_t numComputables,
+                                       GFXComputable** computables)
+{
+	assert(renderer != NULL);
+	assert(numRenderables == 0 || renderables != NULL);
+	assert(numComputables == 0 || computables != NULL);
+
+	const size_t total = numRenderables + numComputables;
+	if (total == 0) return 1;
+
+	// Warmup the render graph once, as with gfx_renderable_warmup.
+	if (numRenderables > 0)
+	{
+		_gfx_mutex_lock(&renderer->compiler.compile);
+		_gfx_mutex_lock(&renderer->lock);
+		bool success = _gfx_render_graph_warmup(renderer);
+		_gfx_mutex_unlock(&renderer->lock);
+		_gfx_mutex_unlock(&renderer->compiler.compile);
+
+		if (!success)
+		{
+			gfx_log_error("Could not warm batch; graph warmup failed.");
+			return 0;
+		}
+	}
+
+	// Then build all pipelines, spread over all workers.
+	// This thread acts as the first worker.
+	_GFXWarmupBatch batch = {
+		.numRenderables = numRenderables,
+		.renderables = renderables,
+		.numComputables = numComputables,
+		.computables = computables
+	};
+
+	atomic_store_explicit(&batch.next, 0, memory_order_relaxed);
+	atomic_store_explicit(&batch.success, 1, memory_order_relaxed);
+
+	const size_t numWorkers = GFX_MAX(1, GFX_MIN(
+		_gfx_jobs_concurrency(),
+		GFX_MIN(_GFX_WARMUP_MAX_WORKERS, total / _GFX_WARMUP_MIN_PIPELINES)));
+
+	_GFXJobCounter counter;
+	_gfx_job_counter(&counter, NULL);
+
+	_GFXJob jobs[numWorkers];
+
+	for (size_t w = 0; w < numWorkers; ++w)
+		jobs[w] = (_GFXJob){ .func = _gfx_warmup_worker, .arg = &batch };
+
+	_gfx_jobs_submit(&counter, numWorkers - 1, jobs + 1);
+	_gfx_warmup_worker(&batch);
+	_gfx_jobs_wait(&counter);
+
+	if (!atomic_load_explicit(&batch.success, memory_order_relaxed))
+	{
+		gfx_log_error("Could not warm batch; not all pipelines built.");
+		return 0;
+	}
+
+	return 1;
+}
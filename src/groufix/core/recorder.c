@@ -10,38 +10,182 @@
 #include <assert.h>
 #include <limits.h>
 #include <stdlib.h>
+#include <string.h>
+
+
+// Number of queries in a single Vulkan query pool of a recorder.
+#define _GFX_RECORDER_QUERIES 64
+
+// Query handle encoding, { slot, type, compute }.
+#define _GFX_QUERY_ID(slot, type, compute) \
+	(((slot) << 2) | ((uint32_t)(type) << 1) | ((compute) ? 1u : 0u))
+
+#define _GFX_QUERY_SLOT(query) ((query) >> 2)
+#define _GFX_QUERY_TYPE(query) ((GFXQueryType)(((query) >> 1) & 1u))
+#define _GFX_QUERY_COMPUTE(query) ((query) & 1u)
+
+// Maximum number of partitions of a single parallel recording.
+#define _GFX_RECORDER_MAX_HELPERS 16
 
 
 /****************************
- * Recording command buffer element definition.
+ * Deferred draw sort key definition.
  */
-typedef struct _GFXCmdElem
+typedef struct _GFXSortKey
 {
-	unsigned int    order; // Pass order.
-	VkCommandBuffer cmd;
+	uint64_t key;
+	size_t   index; // Into the deferred draws.
+
+} _GFXSortKey;
+
+
+/****************************
+ * Retrieves the current recording pool of a recorder.
+ * Based on the queue the pass is scheduled on, not its type.
+ */
+static inline _GFXRecorderPool* _gfx_recorder_pool(GFXRecorder* recorder,
+                                                   bool compute)
+{
+	return &recorder->pools[recorder->current * 2 + (compute ? 1 : 0)];
+}
+
+/****************************
+ * Retrieves the pipeline statistics queried by a recording pool.
+ * @param compute Non-zero for the compute pool.
+ */
+static VkQueryPipelineStatisticFlags _gfx_recorder_stats(GFXRecorder* recorder,
+                                                         bool compute)
+{
+	// The graphics queue might not support compute.
+	const _GFXDevice* device = recorder->renderer->heap->allocator.device;
+
+	return compute ?
+		VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT :
+		VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+		(device->base.features.inlineCompute ?
+			VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT : 0);
+}
+
+/****************************
+ * Resolves the results of all used queries of a recording pool,
+ * without waiting, unexecuted queries are simply not available.
+ * @param pool    Cannot be NULL, must be done rendering.
+ * @param compute Non-zero if this is the compute pool.
+ */
+static void _gfx_recorder_resolve(GFXRecorder* recorder,
+                                  _GFXRecorderPool* pool, bool compute)
+{
+	assert(recorder != NULL);
+	assert(pool != NULL);
+
+	_GFXContext* context = recorder->context;
+
+	for (unsigned int t = 0; t < 2; ++t)
+	{
+		_GFXRecorderQueries* queries = &pool->queries[t];
+
+		if (queries->results.size > 0)
+			gfx_vec_pop(&queries->results, queries->results.size);
+
+		if (queries->used == 0)
+			continue;
+
+		if (!gfx_vec_push(&queries->results, queries->used, NULL))
+		{
+			gfx_log_warn("Could not resolve query results of a recorder.");
+			continue;
+		}
+
+		// Count the values of each query, followed by its availability.
+		const VkQueryPipelineStatisticFlags stats =
+			(t == GFX_QUERY_OCCLUSION) ? 0 :
+			_gfx_recorder_stats(recorder, compute);
+
+		size_t numValues = (t == GFX_QUERY_OCCLUSION) ? 1 : 0;
+		for (VkQueryPipelineStatisticFlags f = stats; f != 0; f &= f - 1)
+			++numValues;
 
-} _GFXCmdElem;
+		// Allocate space for the values of a single Vulkan query pool.
+		const size_t maxSize =
+			sizeof(uint64_t) * _GFX_RECORDER_QUERIES * (numValues + 1);
 
+		uint64_t* values = malloc(maxSize);
+		if (values == NULL)
+		{
+			gfx_log_warn("Could not resolve query results of a recorder.");
+			gfx_vec_pop(&queries->results, queries->results.size);
+			continue;
+		}
+
+		for (uint32_t q = 0; q < queries->used; q += _GFX_RECORDER_QUERIES)
+		{
+			const uint32_t count =
+				GFX_MIN(_GFX_RECORDER_QUERIES, queries->used - q);
+			const VkQueryPool vkPool = *(VkQueryPool*)gfx_vec_at(
+				&queries->vk.pools, q / _GFX_RECORDER_QUERIES);
+
+			const size_t size = sizeof(uint64_t) * count * (numValues + 1);
+			const VkResult result = context->vk.GetQueryPoolResults(
+				context->vk.device, vkPool,
+				0, count, size, values,
+				sizeof(uint64_t) * (numValues + 1),
+				VK_QUERY_RESULT_64_BIT |
+				VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+			if (result != VK_SUCCESS && result != VK_NOT_READY)
+			{
+				gfx_log_warn("Could not resolve query results of a recorder.");
+				memset(values, 0, size);
+			}
+
+			// Unpack values in bit order of the statistics.
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				const uint64_t* v = values + i * (numValues + 1);
+				GFXQueryResult* res = gfx_vec_at(&queries->results, q + i);
+				size_t k = 0;
+
+				*res = (GFXQueryResult){ .available = (v[numValues] != 0) };
+
+				if (t == GFX_QUERY_OCCLUSION)
+					res->samples = v[k++];
+				if (stats & VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT)
+					res->vertices = v[k++];
+				if (stats & VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT)
+					res->primitives = v[k++];
+				if (stats & VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT)
+					res->vertexInvocations = v[k++];
+				if (stats & VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT)
+					res->fragmentInvocations = v[k++];
+				if (stats & VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT)
+					res->computeInvocations = v[k++];
+			}
+		}
+
+		free(values);
+	}
+}
 
 /****************************
  * Claims (or creates) a command buffer from the current recording pool.
  * To unclaim, the current pool's used count should be decreased.
  * @param recorder Cannot be NULL.
- * @param type     Type of the pass, to inform pool selection.
+ * @param pass     Pass to claim for, to inform pool selection.
  * @return The command buffer, NULL on failure.
  */
 static VkCommandBuffer _gfx_recorder_claim(GFXRecorder* recorder,
-                                           GFXPassType type)
+                                           GFXPass* pass)
 {
 	assert(recorder != NULL);
+	assert(pass != NULL);
 
 	_GFXContext* context = recorder->context;
 
 	// Select recorder pool.
-	_GFXRecorderPool* pool = &recorder->pools[
-		type != GFX_PASS_COMPUTE_ASYNC ?
-			recorder->current * 2 :
-			recorder->current * 2 + 1];
+	_GFXRecorderPool* pool = _gfx_recorder_pool(recorder, pass->async);
 
 	// If we still have enough command buffers, return the next one.
 	if (pool->used < pool->vk.cmds.size)
@@ -76,30 +220,387 @@ static VkCommandBuffer _gfx_recorder_claim(GFXRecorder* recorder,
 }
 
 /****************************
- * Binds a graphics pipeline to the current recording.
- * @param recorder   Cannot be NULL, assumed to be in a callback.
- * @param renderable Cannot be NULL, assumed to be validated.
- * @return Zero on failure.
+ * Finds (or creates) a retained recording in the current recording pool,
+ * claiming it for the current use of the virtual frame.
+ * @param recorder Cannot be NULL, must be in retained mode.
+ * @param pass     Pass to retain for, to inform pool selection.
+ * @param valid    Cannot be NULL, outputs whether it can be re-executed.
+ * @return The retained recording, NULL on failure.
+ *
+ * If it cannot be re-executed, the recording is updated to describe the
+ * current state and its command buffer must be recorded again.
  */
-static bool _gfx_recorder_bind_renderable(GFXRecorder* recorder,
-                                          GFXRenderable* renderable)
+static _GFXRecorderRetained* _gfx_recorder_retain(GFXRecorder* recorder,
+                                                  GFXPass* pass,
+                                                  void (*cb)(GFXRecorder*, unsigned int, void*),
+                                                  void* ptr, bool* valid)
 {
 	assert(recorder != NULL);
-	assert(renderable != NULL);
+	assert(recorder->retain.enabled);
+	assert(pass != NULL);
+	assert(valid != NULL);
 
+	GFXRenderer* renderer = recorder->renderer;
 	_GFXContext* context = recorder->context;
+	_GFXRecorderPool* pool = _gfx_recorder_pool(recorder, pass->async);
 
-	// Get pipeline from renderable.
-	_GFXCacheElem* elem;
-	if (!_gfx_renderable_pipeline(renderable, &elem, 0))
+	// Get the state the recording depends on.
+	const bool render = (pass->type == GFX_PASS_RENDER);
+	const _GFXRenderPass* rPass = (const _GFXRenderPass*)pass;
+
+	const uint32_t passGen = render ? _GFX_PASS_GEN(rPass) : 0;
+	const VkRenderPass vkPass = render ? rPass->vk.pass : VK_NULL_HANDLE;
+	const uint32_t width = render ? rPass->build.fWidth : 0;
+	const uint32_t height = render ? rPass->build.fHeight : 0;
+
+	// Find the first unclaimed recording of the same pass & callback.
+	// The same pass & callback can be recorded multiple times per frame,
+	// in which case they are matched in recording order.
+	_GFXRecorderRetained* entry = NULL;
+
+	for (size_t r = 0; r < pool->retained.size; ++r)
+	{
+		_GFXRecorderRetained* e = gfx_vec_at(&pool->retained, r);
+		if (!e->used && e->pass == pass && e->cb == cb && e->ptr == ptr)
+		{
+			entry = e;
+			break;
+		}
+	}
+
+	if (entry != NULL)
+	{
+		*valid =
+			!entry->once &&
+			entry->gen == recorder->retain.gen &&
+			entry->passGen == passGen &&
+			entry->vk.pass == vkPass &&
+			entry->width == width &&
+			entry->height == height;
+
+		// Then check that all descriptor sets are unmodified.
+		// This marks them as used, so they are kept alive as well.
+		for (size_t s = 0; *valid && s < entry->sets.size; ++s)
+		{
+			const _GFXRecorderSetRef* ref = gfx_vec_at(&entry->sets, s);
+
+			// Pushed sets are baked in, only check their generation.
+			*valid =
+				(ref->set->push ||
+				_gfx_set_get(ref->set, &recorder->sub) == ref->elem) &&
+				atomic_load_explicit(&ref->set->gen, memory_order_relaxed) == ref->gen;
+		}
+	}
+	else
+	{
+		// Create the retained command pool if not done so yet.
+		// Its command buffers must be individually resettable.
+		if (pool->vk.retained == VK_NULL_HANDLE)
+		{
+			VkCommandPoolCreateInfo cpci = {
+				.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+
+				.pNext            = NULL,
+				.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+				.queueFamilyIndex = pass->async ?
+					renderer->compute.family : renderer->graphics.family
+			};
+
+			_GFX_VK_CHECK(
+				context->vk.CreateCommandPool(
+					context->vk.device, &cpci, NULL, &pool->vk.retained),
+				return NULL);
+		}
+
+		// Allocate a new recording.
+		if (!gfx_vec_push(&pool->retained, 1, NULL))
+			return NULL;
+
+		VkCommandBufferAllocateInfo cbai = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+
+			.pNext              = NULL,
+			.commandPool        = pool->vk.retained,
+			.level              = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+			.commandBufferCount = 1
+		};
+
+		entry = gfx_vec_at(&pool->retained, pool->retained.size - 1);
+		_GFX_VK_CHECK(
+			context->vk.AllocateCommandBuffers(
+				context->vk.device, &cbai, &entry->vk.cmd),
+			{
+				gfx_vec_pop(&pool->retained, 1);
+				return NULL;
+			});
+
+		entry->pass = pass;
+		entry->ptr = ptr;
+		entry->cb = cb;
+		gfx_vec_init(&entry->sets, sizeof(_GFXRecorderSetRef));
+
+		*valid = 0;
+	}
+
+	// Claim it & describe the current state if it must be recorded.
+	entry->used = 1;
+
+	if (!*valid)
+	{
+		entry->gen = recorder->retain.gen;
+		entry->passGen = passGen;
+		entry->width = width;
+		entry->height = height;
+		entry->once = 0;
+		entry->vk.pass = vkPass;
+
+		gfx_vec_release(&entry->sets);
+	}
+
+	return entry;
+}
+
+/****************************
+ * Frees all retained recordings of a recording pool that were not
+ * claimed during its previous use & unclaims all others.
+ * @param pool Cannot be NULL, must be done rendering.
+ */
+static void _gfx_recorder_prune(GFXRecorder* recorder, _GFXRecorderPool* pool)
+{
+	assert(recorder != NULL);
+	assert(pool != NULL);
+
+	_GFXContext* context = recorder->context;
+
+	for (size_t r = pool->retained.size; r > 0; --r)
+	{
+		_GFXRecorderRetained* entry = gfx_vec_at(&pool->retained, r-1);
+		if (entry->used)
+		{
+			entry->used = 0;
+			continue;
+		}
+
+		context->vk.FreeCommandBuffers(context->vk.device,
+			pool->vk.retained, 1, &entry->vk.cmd);
+
+		gfx_vec_clear(&entry->sets);
+		gfx_vec_erase(&pool->retained, 1, r-1);
+	}
+}
+
+/****************************
+ * Remembers a descriptor set used by the current retained recording.
+ * @param recorder Cannot be NULL, must be retaining a recording.
+ * @param set      Cannot be NULL.
+ * @param elem     The descriptor set element used, NULL if pushed.
+ */
+static void _gfx_recorder_retain_set(GFXRecorder* recorder,
+                                     GFXSet* set, _GFXPoolElem* elem)
+{
+	assert(recorder != NULL);
+	assert(recorder->retain.current != NULL);
+	assert(set != NULL);
+	assert(elem != NULL || set->push);
+
+	_GFXRecorderRetained* entry = recorder->retain.current;
+	_GFXRecorderSetRef ref = {
+		.set = set,
+		.elem = elem,
+		.gen = (uint32_t)atomic_load_explicit(&set->gen, memory_order_relaxed)
+	};
+
+	// If it cannot be remembered, it cannot be validated either.
+	if (!gfx_vec_push(&entry->sets, 1, &ref))
+		entry->once = 1;
+}
+
+/****************************
+ * Forgets all descriptor set & push constant state.
+ * @param state Cannot be NULL.
+ */
+static void _gfx_recorder_reset_state(_GFXRecorderState* state)
+{
+	assert(state != NULL);
+
+	state->layout = VK_NULL_HANDLE;
+	state->point = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	state->pushStages = 0;
+	state->pushBegin = 0;
+	state->pushEnd = 0;
+
+	for (size_t s = 0; s < _GFX_RECORDER_SETS; ++s)
+		state->sets[s].set = VK_NULL_HANDLE;
+}
+
+/****************************
+ * Forgets all bound state of the current recording.
+ * @param recorder Cannot be NULL.
+ */
+static void _gfx_recorder_reset_bind(GFXRecorder* recorder)
+{
+	assert(recorder != NULL);
+
+	recorder->bind.pipeline = NULL;
+	recorder->bind.primitive = NULL;
+	recorder->bind.geometry = NULL;
+	recorder->bind.indexSize = 0;
+	recorder->bind.dynamics = 0;
+	_gfx_recorder_reset_state(&recorder->bind.state);
+}
+
+/****************************
+ * Makes sure a descriptor set & push constant state belongs to
+ * a given pipeline layout, forgets all of it if it does not.
+ * @param state Cannot be NULL.
+ * @return Non-zero if the state was forgotten.
+ *
+ * Layouts are cached, so equal handles imply equal layouts.
+ * Different layouts might be compatible, but we do not bother checking.
+ */
+static bool _gfx_recorder_use_layout(_GFXRecorderState* state,
+                                     VkPipelineLayout layout)
+{
+	assert(state != NULL);
+
+	if (state->layout == layout)
 		return 0;
 
-	// Bind as graphics pipeline.
-	if (recorder->bind.pipeline != elem)
+	_gfx_recorder_reset_state(state);
+	state->layout = layout;
+
+	return 1;
+}
+
+/****************************
+ * Tracks a descriptor set bind in a state (of the same layout).
+ * @param state   Cannot be NULL.
+ * @param dSets   numSets Vulkan descriptor sets.
+ * @param numDyns numSets numbers of dynamic offsets of each set.
+ * @param offs    All dynamic offsets of all sets, consecutively.
+ * @param first   Cannot be NULL, outputs the first changed set (numSets if none).
+ * @param last    Cannot be NULL, outputs the last changed set.
+ *
+ * All sets inbetween first and last (inclusive) need to be bound.
+ * Binding a subrange does not disturb the other sets, as long as
+ * the layout stays the same. Sets beyond _GFX_RECORDER_SETS or with
+ * too many dynamic offsets are not remembered, always considered changed.
+ */
+static void _gfx_recorder_track_sets(_GFXRecorderState* state,
+                                     VkPipelineBindPoint point,
+                                     size_t firstSet, size_t numSets,
+                                     const VkDescriptorSet* dSets,
+                                     const size_t* numDyns,
+                                     const uint32_t* offs,
+                                     size_t* first, size_t* last)
+{
+	assert(state != NULL);
+	assert(dSets != NULL);
+	assert(numDyns != NULL);
+	assert(first != NULL);
+	assert(last != NULL);
+
+	// Forget all bound sets if the bind point changed.
+	if (state->point != point)
 	{
-		recorder->bind.pipeline = elem;
-		context->vk.CmdBindPipeline(recorder->inp.cmd,
-			VK_PIPELINE_BIND_POINT_GRAPHICS, elem->vk.pipeline);
+		state->point = point;
+
+		for (size_t s = 0; s < _GFX_RECORDER_SETS; ++s)
+			state->sets[s].set = VK_NULL_HANDLE;
+	}
+
+	*first = numSets;
+	*last = 0;
+
+	const uint32_t* dyns = offs;
+
+	for (size_t s = 0; s < numSets; dyns += numDyns[s++])
+	{
+		if (firstSet + s >= _GFX_RECORDER_SETS)
+		{
+			*first = GFX_MIN(*first, s);
+			*last = s;
+			continue;
+		}
+
+		_GFXRecorderSet* bound = &state->sets[firstSet + s];
+
+		if (
+			bound->set != VK_NULL_HANDLE &&
+			bound->set == dSets[s] &&
+			bound->numDynamics == numDyns[s] &&
+			(numDyns[s] == 0 ||
+			memcmp(bound->offsets, dyns, sizeof(uint32_t) * numDyns[s]) == 0))
+		{
+			continue;
+		}
+
+		*first = GFX_MIN(*first, s);
+		*last = s;
+
+		// Too many dynamic offsets, do not remember.
+		if (numDyns[s] > _GFX_RECORDER_DYNAMICS)
+			bound->set = VK_NULL_HANDLE;
+		else
+		{
+			bound->set = dSets[s];
+			bound->numDynamics = (uint32_t)numDyns[s];
+			if (numDyns[s] > 0) memcpy(
+				bound->offsets, dyns, sizeof(uint32_t) * numDyns[s]);
+		}
+	}
+}
+
+/****************************
+ * Tracks a push constant update in a state (of the same layout).
+ * @param state Cannot be NULL.
+ * @return Zero if the exact same bytes were already pushed.
+ */
+static bool _gfx_recorder_track_push(_GFXRecorderState* state,
+                                     VkShaderStageFlags stages,
+                                     uint32_t offset,
+                                     uint32_t size, const void* data)
+{
+	assert(state != NULL);
+	assert(data != NULL);
+
+	const uint32_t end = offset + size;
+	char* push = (char*)state->push;
+
+	state->pushStages = stages;
+
+	if (end > _GFX_RECORDER_PUSH_SIZE)
+	{
+		// Cannot remember; forget all overlapping bytes.
+		if (offset < state->pushEnd)
+			state->pushEnd = GFX_MAX(offset, state->pushBegin);
+
+		return 1;
+	}
+
+	if (
+		offset >= state->pushBegin &&
+		end <= state->pushEnd &&
+		memcmp(push + offset, data, size) == 0)
+	{
+		return 0;
+	}
+
+	// Remember the pushed bytes, the known range must be contiguous.
+	memcpy(push + offset, data, size);
+
+	if (
+		state->pushBegin < state->pushEnd &&
+		offset <= state->pushEnd &&
+		end >= state->pushBegin)
+	{
+		state->pushBegin = GFX_MIN(state->pushBegin, offset);
+		state->pushEnd = GFX_MAX(state->pushEnd, end);
+	}
+	else
+	{
+		state->pushBegin = offset;
+		state->pushEnd = end;
 	}
 
 	return 1;
@@ -125,7 +626,9 @@ static bool _gfx_recorder_bind_computable(GFXRecorder* recorder,
 		return 0;
 
 	// Bind as compute pipeline.
-	if (recorder->bind.pipeline != elem)
+	if (recorder->bind.pipeline == elem)
+		++recorder->skipped.pipelines;
+	else
 	{
 		recorder->bind.pipeline = elem;
 		context->vk.CmdBindPipeline(recorder->inp.cmd,
@@ -139,9 +642,10 @@ static bool _gfx_recorder_bind_computable(GFXRecorder* recorder,
  * Binds a vertex and/or index buffer to the current recording.
  * @param recorder  Cannot be NULL, assumed to be in a callback.
  * @param primitive Cannot be NULL.
+ * @param baked     Whether the draw has the geometry offsets baked in.
  */
 static void _gfx_recorder_bind_primitive(GFXRecorder* recorder,
-                                         GFXPrimitive* primitive)
+                                         GFXPrimitive* primitive, bool baked)
 {
 	assert(recorder != NULL);
 	assert(primitive != NULL);
@@ -149,10 +653,50 @@ static void _gfx_recorder_bind_primitive(GFXRecorder* recorder,
 	_GFXContext* context = recorder->context;
 	_GFXPrimitive* prim = (_GFXPrimitive*)primitive;
 
+	// Bind shared geometry at offset 0 for all its primitives,
+	// only rebinding indices when the index type changes.
+	if (baked && prim->geometry != NULL)
+	{
+		const bool indexed = primitive->numIndices > 0;
+
+		if (
+			recorder->bind.geometry == prim->geometry &&
+			(!indexed || recorder->bind.indexSize == primitive->indexSize))
+		{
+			++recorder->skipped.primitives;
+			return;
+		}
+
+		VkBuffer buffer = prim->geometry->buffer.vk.buffer;
+
+		if (recorder->bind.geometry != prim->geometry)
+		{
+			recorder->bind.primitive = NULL;
+			recorder->bind.geometry = prim->geometry;
+			recorder->bind.indexSize = 0;
+
+			context->vk.CmdBindVertexBuffers(recorder->inp.cmd,
+				0, 1, &buffer, (VkDeviceSize[]){ 0 });
+		}
+
+		if (indexed)
+		{
+			recorder->bind.indexSize = primitive->indexSize;
+
+			context->vk.CmdBindIndexBuffer(recorder->inp.cmd,
+				buffer, 0,
+				primitive->indexSize == sizeof(uint16_t) ?
+					VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32);
+		}
+	}
+
 	// Bind vertex & index buffers.
-	if (recorder->bind.primitive != prim)
+	else if (recorder->bind.primitive == prim)
+		++recorder->skipped.primitives;
+	else
 	{
 		recorder->bind.primitive = prim;
+		recorder->bind.geometry = NULL;
 		VkBuffer vertexBuffs[prim->numBindings];
 		VkDeviceSize vertexOffsets[prim->numBindings];
 
@@ -178,34 +722,760 @@ static void _gfx_recorder_bind_primitive(GFXRecorder* recorder,
 	}
 }
 
+/****************************
+ * Records a draw command to the current recording,
+ * binding its pipeline and primitive first.
+ * @param recorder Cannot be NULL, assumed to be in a callback.
+ * @param draw     Cannot be NULL.
+ */
+static void _gfx_recorder_draw(GFXRecorder* recorder,
+                               const _GFXRecorderDraw* draw)
+{
+	assert(recorder != NULL);
+	assert(draw != NULL);
+
+	_GFXContext* context = recorder->context;
+	VkCommandBuffer cmd = recorder->inp.cmd;
+
+	// Bind as graphics pipeline.
+	if (recorder->bind.pipeline == draw->pipeline)
+		++recorder->skipped.pipelines;
+	else
+	{
+		recorder->bind.pipeline = draw->pipeline;
+		context->vk.CmdBindPipeline(cmd,
+			VK_PIPELINE_BIND_POINT_GRAPHICS, draw->pipeline->vk.pipeline);
+	}
+
+	// Set dynamic state.
+	_gfx_recorder_set_dynamic(recorder, &draw->dynamic);
+
+	// Bind primitive.
+	if (draw->primitive != NULL)
+		_gfx_recorder_bind_primitive(recorder, draw->primitive, draw->baked);
+
+	// Record the draw command.
+	switch (draw->type)
+	{
+	case _GFX_RECORDER_DRAW:
+		context->vk.CmdDraw(cmd,
+			draw->direct.count, draw->direct.instances,
+			draw->direct.first, draw->direct.firstInstance);
+		break;
+
+	case _GFX_RECORDER_DRAW_INDEXED:
+		context->vk.CmdDrawIndexed(cmd,
+			draw->direct.count, draw->direct.instances,
+			draw->direct.first, draw->direct.vertexOffset,
+			draw->direct.firstInstance);
+		break;
+
+	case _GFX_RECORDER_DRAW_INDIRECT:
+		context->vk.CmdDrawIndirect(cmd,
+			draw->indirect.buffer, draw->indirect.offset,
+			draw->indirect.count, draw->indirect.stride);
+		break;
+
+	case _GFX_RECORDER_DRAW_INDEXED_INDIRECT:
+		context->vk.CmdDrawIndexedIndirect(cmd,
+			draw->indirect.buffer, draw->indirect.offset,
+			draw->indirect.count, draw->indirect.stride);
+		break;
+
+	case _GFX_RECORDER_DRAW_INDIRECT_COUNT:
+		context->vk.CmdDrawIndirectCount(cmd,
+			draw->indirect.buffer, draw->indirect.offset,
+			draw->indirect.countBuffer, draw->indirect.countOffset,
+			draw->indirect.count, draw->indirect.stride);
+		break;
+
+	case _GFX_RECORDER_DRAW_INDEXED_INDIRECT_COUNT:
+		context->vk.CmdDrawIndexedIndirectCount(cmd,
+			draw->indirect.buffer, draw->indirect.offset,
+			draw->indirect.countBuffer, draw->indirect.countOffset,
+			draw->indirect.count, draw->indirect.stride);
+		break;
+	}
+}
+
+/****************************
+ * Sets all dynamic graphics state that differs from the current state.
+ * @param recorder Cannot be NULL, assumed to be in a callback.
+ * @param dynamic  Cannot be NULL.
+ *
+ * All graphics pipelines share the same set of dynamic state,
+ * so binding another pipeline leaves the current state intact.
+ */
+static void _gfx_recorder_set_dynamic(GFXRecorder* recorder,
+                                      const _GFXDynamicState* dynamic)
+{
+	assert(recorder != NULL);
+	assert(dynamic != NULL);
+
+	_GFXContext* context = recorder->context;
+	VkCommandBuffer cmd = recorder->inp.cmd;
+	_GFXDynamicState* cur = &recorder->bind.dynamic;
+
+	const bool all = !recorder->bind.dynamics;
+
+	if (!all && memcmp(cur, dynamic, sizeof(_GFXDynamicState)) == 0)
+		return;
+
+#define _GFX_DYNAMIC_DIFF(field) \
+	(all || memcmp(&cur->field, &dynamic->field, sizeof(cur->field)) != 0)
+
+	if (context->features & _GFX_SUPPORT_EXTENDED_DYNAMIC_STATE)
+	{
+		if (_GFX_DYNAMIC_DIFF(cullMode))
+			context->vk.CmdSetCullModeEXT(cmd, dynamic->cullMode);
+		if (_GFX_DYNAMIC_DIFF(frontFace))
+			context->vk.CmdSetFrontFaceEXT(cmd, dynamic->frontFace);
+		if (_GFX_DYNAMIC_DIFF(depthTest))
+			context->vk.CmdSetDepthTestEnableEXT(cmd, dynamic->depthTest);
+		if (_GFX_DYNAMIC_DIFF(depthWrite))
+			context->vk.CmdSetDepthWriteEnableEXT(cmd, dynamic->depthWrite);
+		if (_GFX_DYNAMIC_DIFF(depthBounds))
+			context->vk.CmdSetDepthBoundsTestEnableEXT(cmd, dynamic->depthBounds);
+		if (_GFX_DYNAMIC_DIFF(stencilTest))
+			context->vk.CmdSetStencilTestEnableEXT(cmd, dynamic->stencilTest);
+		if (_GFX_DYNAMIC_DIFF(depthCmp))
+			context->vk.CmdSetDepthCompareOpEXT(cmd, dynamic->depthCmp);
+
+		if (
+			all ||
+			cur->front.failOp != dynamic->front.failOp ||
+			cur->front.passOp != dynamic->front.passOp ||
+			cur->front.depthFailOp != dynamic->front.depthFailOp ||
+			cur->front.compareOp != dynamic->front.compareOp)
+		{
+			context->vk.CmdSetStencilOpEXT(cmd, VK_STENCIL_FACE_FRONT_BIT,
+				dynamic->front.failOp, dynamic->front.passOp,
+				dynamic->front.depthFailOp, dynamic->front.compareOp);
+		}
+
+		if (
+			all ||
+			cur->back.failOp != dynamic->back.failOp ||
+			cur->back.passOp != dynamic->back.passOp ||
+			cur->back.depthFailOp != dynamic->back.depthFailOp ||
+			cur->back.compareOp != dynamic->back.compareOp)
+		{
+			context->vk.CmdSetStencilOpEXT(cmd, VK_STENCIL_FACE_BACK_BIT,
+				dynamic->back.failOp, dynamic->back.passOp,
+				dynamic->back.depthFailOp, dynamic->back.compareOp);
+		}
+	}
+
+	if (all || cur->front.compareMask != dynamic->front.compareMask)
+		context->vk.CmdSetStencilCompareMask(cmd,
+			VK_STENCIL_FACE_FRONT_BIT, dynamic->front.compareMask);
+	if (all || cur->back.compareMask != dynamic->back.compareMask)
+		context->vk.CmdSetStencilCompareMask(cmd,
+			VK_STENCIL_FACE_BACK_BIT, dynamic->back.compareMask);
+
+	if (all || cur->front.writeMask != dynamic->front.writeMask)
+		context->vk.CmdSetStencilWriteMask(cmd,
+			VK_STENCIL_FACE_FRONT_BIT, dynamic->front.writeMask);
+	if (all || cur->back.writeMask != dynamic->back.writeMask)
+		context->vk.CmdSetStencilWriteMask(cmd,
+			VK_STENCIL_FACE_BACK_BIT, dynamic->back.writeMask);
+
+	if (all || cur->front.reference != dynamic->front.reference)
+		context->vk.CmdSetStencilReference(cmd,
+			VK_STENCIL_FACE_FRONT_BIT, dynamic->front.reference);
+	if (all || cur->back.reference != dynamic->back.reference)
+		context->vk.CmdSetStencilReference(cmd,
+			VK_STENCIL_FACE_BACK_BIT, dynamic->back.reference);
+
+	if (_GFX_DYNAMIC_DIFF(minDepth) || _GFX_DYNAMIC_DIFF(maxDepth))
+		context->vk.CmdSetDepthBounds(cmd,
+			dynamic->minDepth, dynamic->maxDepth);
+
+	if (_GFX_DYNAMIC_DIFF(constants))
+		context->vk.CmdSetBlendConstants(cmd, dynamic->constants);
+
+#undef _GFX_DYNAMIC_DIFF
+
+	recorder->bind.dynamics = 1;
+	*cur = *dynamic;
+}
+
+/****************************
+ * Binds all descriptor sets of a state that are not bound yet.
+ * @param recorder Cannot be NULL, assumed to be in a callback.
+ * @param state    Cannot be NULL, its push constants are ignored.
+ */
+static void _gfx_recorder_apply_sets(GFXRecorder* recorder,
+                                     const _GFXRecorderState* state)
+{
+	assert(recorder != NULL);
+	assert(state != NULL);
+
+	_GFXContext* context = recorder->context;
+	_GFXRecorderState* bound = &recorder->bind.state;
+
+	if (state->layout == VK_NULL_HANDLE)
+		return;
+
+	_gfx_recorder_use_layout(bound, state->layout);
+
+	if (bound->point != state->point)
+	{
+		bound->point = state->point;
+
+		for (size_t s = 0; s < _GFX_RECORDER_SETS; ++s)
+			bound->sets[s].set = VK_NULL_HANDLE;
+	}
+
+	// Bind each consecutive range of sets that are not bound yet.
+#define _GFX_SET_NEEDS_BIND(s) \
+	(state->sets[s].set != VK_NULL_HANDLE && \
+	(state->sets[s].set != bound->sets[s].set || \
+	state->sets[s].numDynamics != bound->sets[s].numDynamics || \
+	memcmp(state->sets[s].offsets, bound->sets[s].offsets, \
+		sizeof(uint32_t) * state->sets[s].numDynamics) != 0))
+
+	for (size_t s = 0, e; s < _GFX_RECORDER_SETS; s = e)
+	{
+		e = s + 1;
+		if (!_GFX_SET_NEEDS_BIND(s)) continue;
+		while (e < _GFX_RECORDER_SETS && _GFX_SET_NEEDS_BIND(e)) ++e;
+
+		VkDescriptorSet dSets[e - s];
+		uint32_t offs[(e - s) * _GFX_RECORDER_DYNAMICS];
+		uint32_t numOffsets = 0;
+
+		for (size_t r = s; r < e; ++r)
+		{
+			dSets[r - s] = state->sets[r].set;
+			memcpy(offs + numOffsets, state->sets[r].offsets,
+				sizeof(uint32_t) * state->sets[r].numDynamics);
+
+			numOffsets += state->sets[r].numDynamics;
+			bound->sets[r] = state->sets[r];
+		}
+
+		context->vk.CmdBindDescriptorSets(recorder->inp.cmd,
+			state->point, state->layout,
+			(uint32_t)s, (uint32_t)(e - s), dSets,
+			numOffsets, offs);
+	}
+
+#undef _GFX_SET_NEEDS_BIND
+}
+
+/****************************
+ * Pushes constants to the current recording if not pushed yet,
+ * using the layout of the current bound state.
+ * @param recorder Cannot be NULL, assumed to be in a callback.
+ * @param data     Cannot be NULL, (end - begin) bytes.
+ */
+static void _gfx_recorder_apply_push(GFXRecorder* recorder,
+                                     VkShaderStageFlags stages,
+                                     uint32_t begin, uint32_t end,
+                                     const void* data)
+{
+	assert(recorder != NULL);
+	assert(begin < end);
+	assert(data != NULL);
+
+	_GFXContext* context = recorder->context;
+	_GFXRecorderState* bound = &recorder->bind.state;
+
+	if (_gfx_recorder_track_push(bound, stages, begin, end - begin, data))
+		context->vk.CmdPushConstants(recorder->inp.cmd,
+			bound->layout, stages, begin, end - begin, data);
+}
+
+/****************************
+ * 64-bit FNV-1a hash of some data, folded into 16 bits.
+ */
+static uint16_t _gfx_recorder_hash(size_t size, const void* data)
+{
+	uint64_t hash = 14695981039346656037u;
+
+	for (size_t b = 0; b < size; ++b)
+		hash = (hash ^ ((const unsigned char*)data)[b]) * 1099511628211u;
+
+	return (uint16_t)(hash ^ (hash >> 16) ^ (hash >> 32) ^ (hash >> 48));
+}
+
+/****************************
+ * Defers a draw command of the current recording, to be sorted.
+ * @param recorder Cannot be NULL, assumed to be in a deferred callback.
+ * @param draw     Cannot be NULL, its key, state and push are overwritten.
+ * @return Zero on failure.
+ *
+ * The sort key is { pipeline, sets, primitive, depth } from most to least
+ * significant, 16 bits each. Hash collisions only affect sort quality.
+ */
+static bool _gfx_recorder_defer(GFXRecorder* recorder,
+                                _GFXRecorderDraw* draw)
+{
+	assert(recorder != NULL);
+	assert(recorder->defer.active);
+	assert(draw != NULL);
+
+	_GFXRecorderState* state = &recorder->defer.state;
+
+	// Snapshot the descriptor set state if it changed.
+	if (recorder->defer.dirtySets)
+	{
+		if (!gfx_vec_push(&recorder->defer.states, 1, state))
+			return 0;
+
+		// Hash the layout & all known sets.
+		uint16_t hashes[1 + _GFX_RECORDER_SETS];
+		hashes[0] = _gfx_recorder_hash(sizeof(state->layout), &state->layout);
+
+		for (size_t s = 0; s < _GFX_RECORDER_SETS; ++s)
+			hashes[1 + s] = (uint16_t)(state->sets[s].set == VK_NULL_HANDLE ? 0 :
+				_gfx_recorder_hash(
+					sizeof(state->sets[s].set), &state->sets[s].set) ^
+				_gfx_recorder_hash(
+					sizeof(uint32_t) * state->sets[s].numDynamics,
+					state->sets[s].offsets));
+
+		recorder->defer.hash = _gfx_recorder_hash(sizeof(hashes), hashes);
+		recorder->defer.dirtySets = 0;
+	}
+
+	// Snapshot the push constants if they changed.
+	if (recorder->defer.dirtyPush)
+	{
+		recorder->defer.push = SIZE_MAX;
+
+		if (state->pushBegin < state->pushEnd)
+		{
+			const uint32_t size = state->pushEnd - state->pushBegin;
+			const size_t index = recorder->defer.pushes.size;
+
+			if (!gfx_vec_push(&recorder->defer.pushes,
+				3 + size / sizeof(uint32_t), NULL))
+			{
+				return 0;
+			}
+
+			uint32_t* push = gfx_vec_at(&recorder->defer.pushes, index);
+			push[0] = state->pushBegin;
+			push[1] = state->pushEnd;
+			push[2] = (uint32_t)state->pushStages;
+			memcpy(push + 3, (char*)state->push + state->pushBegin, size);
+
+			recorder->defer.push = index;
+		}
+
+		recorder->defer.dirtyPush = 0;
+	}
+
+	draw->state = recorder->defer.states.size - 1;
+	draw->push = recorder->defer.push;
+
+	// Sort on what will be bound, which is the geometry when baked.
+	const _GFXPrimitive* prim = (const _GFXPrimitive*)draw->primitive;
+	const void* bind = (prim == NULL) ? NULL :
+		(draw->baked && prim->geometry != NULL) ?
+			(const void*)prim->geometry : (const void*)prim;
+
+	draw->key =
+		((uint64_t)_gfx_recorder_hash(
+			sizeof(draw->pipeline), &draw->pipeline) << 48) |
+		((uint64_t)recorder->defer.hash << 32) |
+		((uint64_t)(bind == NULL ? 0 : _gfx_recorder_hash(
+			sizeof(bind), &bind)) << 16) |
+		recorder->defer.depth;
+
+	return gfx_vec_push(&recorder->defer.draws, 1, draw);
+}
+
+/****************************
+ * Retrieves the graphics pipeline to draw a renderable with.
+ * If the renderer compiles pipelines in the background and the pipeline is
+ * not yet available, the fallback technique of the renderable is used.
+ * @param recorder Cannot be NULL, assumed to be in a callback.
+ * @param elem     Cannot be NULL.
+ * @return Zero if the draw command should not be recorded.
+ */
+static bool _gfx_recorder_pipeline(GFXRecorder* recorder,
+                                   GFXRenderable* renderable,
+                                   _GFXCacheElem** elem)
+{
+	assert(recorder != NULL);
+	assert(renderable != NULL);
+	assert(elem != NULL);
+
+	// Not compiling in the background, just get the pipeline.
+	if (!recorder->renderer->compiler.enabled)
+	{
+		if (!_gfx_renderable_pipeline(renderable, elem, 0))
+			goto error;
+
+		return 1;
+	}
+
+	if (!_gfx_renderable_pipeline_async(renderable, elem))
+		goto error;
+
+	if (*elem != NULL)
+		return 1;
+
+	// The pipeline is still being compiled, this recording is incomplete,
+	// so make sure it is not retained.
+	if (recorder->retain.current != NULL)
+		recorder->retain.current->once = 1;
+
+	// Skip the draw if there is no fallback.
+	// Otherwise draw using a temporary renderable with the fallback
+	// technique, the pipeline of which is compiled right here.
+	if (renderable->fallback == NULL)
+		return 0;
+
+	GFXRenderable fallback;
+	if (!gfx_renderable(&fallback,
+		renderable->pass, renderable->fallback,
+		renderable->primitive, renderable->state))
+	{
+		goto error;
+	}
+
+	if (!_gfx_renderable_pipeline(&fallback, elem, 0))
+		goto error;
+
+	return 1;
+
+
+	// Error on failure.
+error:
+	gfx_log_error(
+		"Failed to get Vulkan graphics pipeline during draw command; "
+		"command not recorded.");
+
+	return 0;
+}
+
+/****************************
+ * Records a draw command to the current recording,
+ * or defers it if in a deferred callback.
+ * @param recorder Cannot be NULL, assumed to be in a callback.
+ * @param draw     Cannot be NULL.
+ */
+static void _gfx_recorder_issue(GFXRecorder* recorder, _GFXRecorderDraw* draw)
+{
+	assert(recorder != NULL);
+	assert(draw != NULL);
+
+	if (!recorder->defer.active)
+		_gfx_recorder_draw(recorder, draw);
+
+	else if (!_gfx_recorder_defer(recorder, draw))
+		gfx_log_error(
+			"Failed to defer draw command; "
+			"command not recorded.");
+}
+
+/****************************
+ * Records an indirect draw command from a buffer.
+ * @param recorder   Cannot be NULL, assumed to be in a callback.
+ * @param renderable Cannot be NULL.
+ * @param type       Must be an indirect non-count draw type.
+ * @param stride     Must be a valid stride (i.e. not 0).
+ * @param ref        Must be a buffer reference.
+ * @param baked      Whether the commands have the geometry offsets baked in.
+ */
+static void _gfx_recorder_indirect(GFXRecorder* recorder,
+                                   GFXRenderable* renderable,
+                                   _GFXRecorderDrawType type,
+                                   uint32_t count,
+                                   uint32_t stride, GFXBufferRef ref,
+                                   bool baked)
+{
+	assert(recorder != NULL);
+	assert(recorder->inp.pass != NULL);
+	assert(recorder->inp.pass->type == GFX_PASS_RENDER);
+	assert(recorder->inp.cmd != NULL);
+	assert(renderable != NULL);
+	assert(renderable->pass == recorder->inp.pass);
+	assert(renderable->technique != NULL);
+	assert(
+		type == _GFX_RECORDER_DRAW_INDIRECT ||
+		type == _GFX_RECORDER_DRAW_INDEXED_INDIRECT);
+	assert(stride > 0);
+
+	// Unpack reference & validate.
+	_GFXUnpackRef unp = _gfx_ref_unpack(ref);
+	if (unp.obj.buffer == NULL)
+	{
+		gfx_log_error(
+			"Failed to retrieve indirect buffer during draw command; "
+			"command not recorded.");
+
+		return;
+	}
+
+	// Get pipeline & record the draw command.
+	_GFXRecorderDraw draw = {
+		.type      = type,
+		.primitive = renderable->primitive,
+		.baked     = baked,
+		.indirect  = {
+			.buffer      = unp.obj.buffer->vk.buffer,
+			.offset      = unp.value,
+			.countBuffer = VK_NULL_HANDLE,
+			.countOffset = 0,
+			.count       = count,
+			.stride      = stride
+		}
+	};
+
+	if (!_gfx_recorder_pipeline(recorder, renderable, &draw.pipeline))
+		return;
+
+	_gfx_renderable_dynamic(renderable, &draw.dynamic);
+	_gfx_recorder_issue(recorder, &draw);
+}
+
+/****************************
+ * Sorts & records all deferred draw commands of the current recording.
+ * @param recorder Cannot be NULL, assumed to be in a deferred callback.
+ * @param sync     Non-zero to leave the bound state as issued last.
+ *
+ * Sorting is a stable LSD radix sort on the draw keys,
+ * if it cannot allocate, the draws are recorded in issue order.
+ */
+static void _gfx_recorder_flush(GFXRecorder* recorder, bool sync)
+{
+	assert(recorder != NULL);
+	assert(recorder->defer.active);
+
+	GFXVec* draws = &recorder->defer.draws;
+	const size_t num = draws->size;
+
+	if (num > 0)
+	{
+		// Sort back and forth between two halves of the keys.
+		_GFXSortKey* src = NULL;
+		gfx_vec_release(&recorder->defer.keys);
+
+		if (gfx_vec_push(&recorder->defer.keys, num * 2, NULL))
+		{
+			src = gfx_vec_at(&recorder->defer.keys, 0);
+			_GFXSortKey* dst = src + num;
+
+			for (size_t d = 0; d < num; ++d)
+				src[d] = (_GFXSortKey){
+					.key = ((_GFXRecorderDraw*)gfx_vec_at(draws, d))->key,
+					.index = d
+				};
+
+			for (unsigned int shift = 0; shift < 64; shift += 8)
+			{
+				size_t counts[256] = {0};
+
+				for (size_t d = 0; d < num; ++d)
+					++counts[(src[d].key >> shift) & 0xff];
+
+				// Skip if all keys share this byte.
+				if (counts[(src[0].key >> shift) & 0xff] == num)
+					continue;
+
+				for (size_t b = 0, sum = 0; b < 256; ++b)
+				{
+					const size_t count = counts[b];
+					counts[b] = sum;
+					sum += count;
+				}
+
+				for (size_t d = 0; d < num; ++d)
+					dst[counts[(src[d].key >> shift) & 0xff]++] = src[d];
+
+				_GFXSortKey* tmp = src;
+				src = dst;
+				dst = tmp;
+			}
+		}
+
+		// Record all draws, re-establishing their state first.
+		for (size_t d = 0; d < num; ++d)
+		{
+			_GFXRecorderDraw* draw =
+				gfx_vec_at(draws, src != NULL ? src[d].index : d);
+
+			_gfx_recorder_apply_sets(recorder,
+				gfx_vec_at(&recorder->defer.states, draw->state));
+
+			if (draw->push != SIZE_MAX)
+			{
+				const uint32_t* push =
+					gfx_vec_at(&recorder->defer.pushes, draw->push);
+
+				_gfx_recorder_apply_push(recorder,
+					(VkShaderStageFlags)push[2], push[0], push[1], push + 3);
+			}
+
+			_gfx_recorder_draw(recorder, draw);
+		}
+	}
+
+	// Start over, keeping memory for the next recording.
+	gfx_vec_release(&recorder->defer.draws);
+	gfx_vec_release(&recorder->defer.keys);
+	gfx_vec_release(&recorder->defer.states);
+	gfx_vec_release(&recorder->defer.pushes);
+
+	recorder->defer.dirtySets = 1;
+	recorder->defer.dirtyPush = 1;
+
+	// Bind the state as the user expects it.
+	if (sync)
+	{
+		const _GFXRecorderState* state = &recorder->defer.state;
+		_gfx_recorder_apply_sets(recorder, state);
+
+		if (state->pushBegin < state->pushEnd)
+			_gfx_recorder_apply_push(recorder,
+				state->pushStages, state->pushBegin, state->pushEnd,
+				(const char*)state->push + state->pushBegin);
+	}
+}
+
+/****************************
+ * Starts issuing in-order state again after recording
+ * commands directly during a deferred callback.
+ * @param recorder Cannot be NULL, assumed to be in a deferred callback.
+ */
+static void _gfx_recorder_undefer(GFXRecorder* recorder)
+{
+	assert(recorder != NULL);
+	assert(recorder->defer.active);
+
+	recorder->defer.state = recorder->bind.state;
+	recorder->defer.dirtySets = 1;
+	recorder->defer.dirtyPush = 1;
+}
+
+/****************************
+ * Records pushing a push descriptor set, flushing deferred draws first.
+ * @param recorder Cannot be NULL.
+ * @param set      Cannot be NULL, must be a push descriptor set.
+ * @param template Push descriptor update template of the technique's set.
+ *
+ * Pushed descriptors cannot be re-established by the deferred state,
+ * so they are always recorded directly.
+ */
+static void _gfx_recorder_push_set(GFXRecorder* recorder,
+                                   GFXTechnique* technique,
+                                   VkPipelineBindPoint bindPoint,
+                                   size_t index, GFXSet* set,
+                                   VkDescriptorUpdateTemplate template)
+{
+	assert(recorder != NULL);
+	assert(technique != NULL);
+	assert(set != NULL);
+	assert(set->push);
+
+	if (recorder->defer.active)
+		_gfx_recorder_flush(recorder, 1);
+
+	// Remember the set to validate a retained recording.
+	if (recorder->retain.current != NULL)
+		_gfx_recorder_retain_set(recorder, set, NULL);
+
+	// Forget whatever was bound at this set number.
+	_gfx_recorder_use_layout(&recorder->bind.state, technique->vk.layout);
+
+	if (recorder->bind.state.point != bindPoint)
+	{
+		recorder->bind.state.point = bindPoint;
+
+		for (size_t s = 0; s < _GFX_RECORDER_SETS; ++s)
+			recorder->bind.state.sets[s].set = VK_NULL_HANDLE;
+	}
+
+	if (index < _GFX_RECORDER_SETS)
+		recorder->bind.state.sets[index].set = VK_NULL_HANDLE;
+
+	_gfx_set_push(set, recorder->inp.cmd,
+		template, technique->vk.layout, (uint32_t)index);
+
+	if (recorder->defer.active)
+		_gfx_recorder_undefer(recorder);
+}
+
+/****************************
+ * Makes sure the recorder has an output bucket for all submission orders
+ * up to (but not including) a given number of orders.
+ * @param recorder Cannot be NULL.
+ * @return Zero on failure.
+ */
+static bool _gfx_recorder_buckets(GFXRecorder* recorder, size_t numOrders)
+{
+	assert(recorder != NULL);
+
+	GFXVec* buckets = &recorder->out.cmds;
+	if (buckets->size >= numOrders)
+		return 1;
+
+	const size_t size = buckets->size;
+	if (!gfx_vec_push(buckets, numOrders - size, NULL))
+		return 0;
+
+	for (size_t b = size; b < numOrders; ++b)
+		gfx_vec_init(gfx_vec_at(buckets, b), sizeof(VkCommandBuffer));
+
+	return 1;
+}
+
 /****************************
  * Outputs a command buffer of a specific submission order.
  * @param recorder Cannot be NULL.
  * @return Zero on failure.
+ *
+ * Command buffers of the same order are kept in output order.
  */
 static bool _gfx_recorder_output(GFXRecorder* recorder,
                                  unsigned int order, VkCommandBuffer cmd)
 {
-	// Find the right spot to insert at.
-	// We assume the most prevelant way of recording stuff is in submission
-	// order. Which would make backwards linear search perfect.
-	size_t loc;
-	for (loc = recorder->out.cmds.size; loc > 0; --loc)
-	{
-		unsigned int cOrder =
-			((_GFXCmdElem*)gfx_vec_at(&recorder->out.cmds, loc-1))->order;
+	// Buckets are allocated on reset, so this should only
+	// allocate if the render graph gained passes since.
+	if (!_gfx_recorder_buckets(recorder, (size_t)order + 1))
+		return 0;
 
-		if (cOrder <= order)
-			break;
-	}
+	return gfx_vec_push(gfx_vec_at(&recorder->out.cmds, order), 1, &cmd);
+}
+
+/****************************
+ * Parallel recording partition definition.
+ */
+typedef struct _GFXRecorderPart
+{
+	GFXRecorder* helper;
+	GFXPass*     pass;
+	size_t       first;
+	size_t       num;
+
+	void (*cb)(GFXRecorder*, unsigned int, size_t, size_t, void*);
+	void* ptr;
 
-	// Insert at found position.
-	_GFXCmdElem elem = {
-		.order = order,
-		.cmd = cmd
-	};
+} _GFXRecorderPart;
+
+/****************************
+ * Forwards a gfx_recorder_render callback to a partition's callback.
+ */
+static void _gfx_recorder_part_cb(GFXRecorder* recorder,
+                                  unsigned int frame, void* ptr)
+{
+	_GFXRecorderPart* part = ptr;
+	part->cb(recorder, frame, part->first, part->num, part->ptr);
+}
 
-	return gfx_vec_insert(&recorder->out.cmds, 1, &elem, loc);
+/****************************
+ * Job recording a single partition with its helper.
+ * @param arg Cannot be NULL, must be a _GFXRecorderPart*.
+ */
+static void _gfx_recorder_part(void* arg)
+{
+	_GFXRecorderPart* part = arg;
+	gfx_recorder_render(part->helper, part->pass, _gfx_recorder_part_cb, part);
 }
 
 /****************************/
@@ -215,8 +1485,13 @@ bool _gfx_recorder_reset(GFXRecorder* recorder)
 
 	_GFXContext* context = recorder->context;
 
-	// Clear output.
-	gfx_vec_release(&recorder->out.cmds);
+	// Clear output, keeping all memory around.
+	// Then preallocate a bucket for each pass in the render graph.
+	for (size_t b = 0; b < recorder->out.cmds.size; ++b)
+		gfx_vec_release(gfx_vec_at(&recorder->out.cmds, b));
+
+	if (!_gfx_recorder_buckets(recorder, recorder->renderer->graph.passes.size))
+		return 0;
 
 	// Set new current recording pools.
 	recorder->current = recorder->renderer->current;
@@ -226,6 +1501,14 @@ bool _gfx_recorder_reset(GFXRecorder* recorder)
 
 	for (unsigned int p = 0; p < 2; ++p)
 	{
+		// Resolve all queries of the previous use of this pool.
+		_gfx_recorder_resolve(recorder, pools + p, p == 1);
+		pools[p].queries[0].used = 0;
+		pools[p].queries[1].used = 0;
+
+		// Free retained recordings that were not re-executed.
+		_gfx_recorder_prune(recorder, pools + p);
+
 		// If the pool did not use some command buffers, free them.
 		if (pools[p].used < pools[p].vk.cmds.size)
 		{
@@ -247,55 +1530,84 @@ bool _gfx_recorder_reset(GFXRecorder* recorder)
 		pools[p].used = 0;
 	}
 
+	// Lastly, reset all parallel recording helpers.
+	for (size_t h = 0; h < recorder->helpers.size; ++h)
+		if (!_gfx_recorder_reset(
+			*(GFXRecorder**)gfx_vec_at(&recorder->helpers, h)))
+		{
+			return 0;
+		}
+
 	return 1;
 }
 
 /****************************/
-void _gfx_recorder_record(GFXRecorder* recorder,
-                          unsigned int order, VkCommandBuffer cmd)
+bool _gfx_recorder_record(GFXRecorder* recorder,
+                          unsigned int order, VkCommandBuffer cmd,
+                          VkQueryPool queries, uint32_t query)
 {
 	assert(recorder != NULL);
 	assert(cmd != NULL);
 
 	_GFXContext* context = recorder->context;
 
-	// Do a binary search to find the left-most command buffer of this order.
-	size_t l = 0;
-	size_t r = recorder->out.cmds.size;
+	// Get the output bucket of this order.
+	if (order >= recorder->out.cmds.size)
+		return 0;
 
-	while (l < r)
-	{
-		const size_t p = (l + r) >> 1;
-		const _GFXCmdElem* e = gfx_vec_at(&recorder->out.cmds, p);
+	const GFXVec* bucket = gfx_vec_at(&recorder->out.cmds, order);
+	if (bucket->size == 0)
+		return 0;
 
-		if (e->order < order) l = p + 1;
-		else r = p;
-	}
+	// Record them all into the given command buffer.
+	// Surrounded by timestamps if a query pool is given.
+	if (queries != VK_NULL_HANDLE)
+		context->vk.CmdWriteTimestamp(cmd,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queries, query);
 
-	// Then find the right-most command buffer of this order.
-	while (r < recorder->out.cmds.size)
-	{
-		const _GFXCmdElem* e = gfx_vec_at(&recorder->out.cmds, r);
-		if (e->order > order) break;
-		else ++r;
-	}
+	context->vk.CmdExecuteCommands(cmd,
+		(uint32_t)bucket->size, gfx_vec_at(bucket, 0));
+
+	if (queries != VK_NULL_HANDLE)
+		context->vk.CmdWriteTimestamp(cmd,
+			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queries, query + 1);
+
+	return 1;
+}
+
+/****************************/
+void _gfx_recorder_reset_queries(GFXRecorder* recorder,
+                                 bool compute, VkCommandBuffer cmd)
+{
+	assert(recorder != NULL);
+	assert(cmd != NULL);
+
+	_GFXContext* context = recorder->context;
+	_GFXRecorderPool* pool = _gfx_recorder_pool(recorder, compute);
 
-	// Finally record them all into the given command buffer.
-	if (r > l)
+	for (unsigned int t = 0; t < 2; ++t)
 	{
-		VkCommandBuffer buffs[r-l];
-		for (size_t i = l; i < r; ++i) buffs[i-l] =
-			((_GFXCmdElem*)gfx_vec_at(&recorder->out.cmds, i))->cmd;
+		const _GFXRecorderQueries* queries = &pool->queries[t];
 
-		context->vk.CmdExecuteCommands(cmd, (uint32_t)(r-l), buffs);
+		for (uint32_t q = 0; q < queries->used; q += _GFX_RECORDER_QUERIES)
+			context->vk.CmdResetQueryPool(cmd,
+				*(VkQueryPool*)gfx_vec_at(
+					&queries->vk.pools, q / _GFX_RECORDER_QUERIES),
+				0, GFX_MIN(_GFX_RECORDER_QUERIES, queries->used - q));
 	}
 }
 
-/****************************/
-GFX_API GFXRecorder* gfx_renderer_add_recorder(GFXRenderer* renderer)
+/****************************
+ * Creates a new recorder.
+ * @param renderer Cannot be NULL.
+ * @param link     Non-zero to link it into the renderer's recorders.
+ * @return NULL on failure.
+ *
+ * Unlinked recorders are never reset nor recorded by the renderer itself.
+ */
+static GFXRecorder* _gfx_recorder_create(GFXRenderer* renderer, bool link)
 {
 	assert(renderer != NULL);
-	assert(!renderer->recording);
 
 	_GFXContext* context = renderer->cache.context;
 
@@ -305,7 +1617,7 @@ GFX_API GFXRecorder* gfx_renderer_add_recorder(GFXRenderer* renderer)
 		sizeof(_GFXRecorderPool) * renderer->numFrames * 2);
 
 	if (rec == NULL)
-		goto error;
+		return NULL;
 
 	// Create two command pools for each frame.
 	// One for the graphics family and one for the compute family.
@@ -360,7 +1672,7 @@ GFX_API GFXRecorder* gfx_renderer_add_recorder(GFXRenderer* renderer)
 		}
 
 		free(rec);
-		goto error;
+		return NULL;
 	}
 
 	// Initialize the rest of the pools.
@@ -369,14 +1681,35 @@ GFX_API GFXRecorder* gfx_renderer_add_recorder(GFXRenderer* renderer)
 	rec->current = 0;
 	rec->inp.pass = NULL;
 	rec->inp.cmd = NULL;
-	gfx_vec_init(&rec->out.cmds, sizeof(_GFXCmdElem));
-
-	for (unsigned int i = 0; i < renderer->numFrames; ++i)
+	rec->skipped = (GFXRecorderStats){ 0, 0, 0, 0 };
+	rec->retain.enabled = 0;
+	rec->retain.gen = 0;
+	rec->retain.current = NULL;
+	_gfx_recorder_reset_bind(rec);
+	gfx_vec_init(&rec->out.cmds, sizeof(GFXVec));
+	gfx_vec_init(&rec->helpers, sizeof(GFXRecorder*));
+	rec->helper = !link;
+
+	rec->defer.enabled = 0;
+	rec->defer.active = 0;
+	gfx_vec_init(&rec->defer.draws, sizeof(_GFXRecorderDraw));
+	gfx_vec_init(&rec->defer.keys, sizeof(_GFXSortKey));
+	gfx_vec_init(&rec->defer.states, sizeof(_GFXRecorderState));
+	gfx_vec_init(&rec->defer.pushes, sizeof(uint32_t));
+
+	for (unsigned int i = 0; i < renderer->numFrames * 2; ++i)
 	{
-		rec->pools[i*2].used = 0;
-		rec->pools[i*2+1].used = 0;
-		gfx_vec_init(&rec->pools[i*2].vk.cmds, sizeof(VkCommandBuffer));
-		gfx_vec_init(&rec->pools[i*2+1].vk.cmds, sizeof(VkCommandBuffer));
+		rec->pools[i].used = 0;
+		rec->pools[i].vk.retained = VK_NULL_HANDLE;
+		gfx_vec_init(&rec->pools[i].retained, sizeof(_GFXRecorderRetained));
+		gfx_vec_init(&rec->pools[i].vk.cmds, sizeof(VkCommandBuffer));
+
+		for (unsigned int t = 0; t < 2; ++t)
+		{
+			rec->pools[i].queries[t].used = 0;
+			gfx_vec_init(&rec->pools[i].queries[t].results, sizeof(GFXQueryResult));
+			gfx_vec_init(&rec->pools[i].queries[t].vk.pools, sizeof(VkQueryPool));
+		}
 	}
 
 	// Ok so we cheat a little by checking if the renderer has a public frame.
@@ -391,61 +1724,115 @@ GFX_API GFXRecorder* gfx_renderer_add_recorder(GFXRenderer* renderer)
 	_gfx_mutex_lock(&renderer->lock);
 
 	_gfx_pool_sub(&renderer->pool, &rec->sub);
-	gfx_list_insert_after(&renderer->recorders, &rec->list, NULL);
+	if (link) gfx_list_insert_after(&renderer->recorders, &rec->list, NULL);
 
 	_gfx_mutex_unlock(&renderer->lock);
 
 	return rec;
-
-
-	// Error on failure.
-error:
-	gfx_log_error("Could not add a new recorder to a renderer.");
-	return NULL;
 }
 
-/****************************/
-GFX_API void gfx_erase_recorder(GFXRecorder* recorder)
+/****************************
+ * Destroys a recorder, including all its parallel recording helpers.
+ * @param recorder Cannot be NULL.
+ * @param link     Non-zero if it is linked into the renderer's recorders.
+ */
+static void _gfx_recorder_destroy(GFXRecorder* recorder, bool link)
 {
 	assert(recorder != NULL);
-	assert(!recorder->renderer->recording);
 
 	GFXRenderer* renderer = recorder->renderer;
 
+	for (size_t h = 0; h < recorder->helpers.size; ++h)
+		_gfx_recorder_destroy(
+			*(GFXRecorder**)gfx_vec_at(&recorder->helpers, h), 0);
+
+	gfx_vec_clear(&recorder->helpers);
+
 	// Unlink itself from the renderer & undo subordinate.
 	// Locking for renderer and access to the pool!
 	_gfx_mutex_lock(&renderer->lock);
 
-	gfx_list_erase(&renderer->recorders, &recorder->list);
+	if (link) gfx_list_erase(&renderer->recorders, &recorder->list);
 	_gfx_pool_unsub(&renderer->pool, &recorder->sub);
 
-	// Stay locked; we need to make the command pools stale,
+	// Stay locked; we need to make the command & query pools stale,
 	// as its command buffers might still be in use by pending virtual frames!
 	// Still, NOT thread-safe with respect to gfx_renderer_(acquire|submit)!
-	for (unsigned int i = 0; i < renderer->numFrames; ++i)
+	for (unsigned int i = 0; i < renderer->numFrames * 2; ++i)
 	{
 		// Graphics & compute pools.
 		_gfx_push_stale(renderer,
 			VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE,
-			recorder->pools[i*2].vk.pool);
-		_gfx_push_stale(renderer,
-			VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE,
-			recorder->pools[i*2+1].vk.pool);
+			recorder->pools[i].vk.pool, VK_NULL_HANDLE, VK_NULL_HANDLE);
+
+		if (recorder->pools[i].vk.retained != VK_NULL_HANDLE)
+			_gfx_push_stale(renderer,
+				VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE,
+				recorder->pools[i].vk.retained, VK_NULL_HANDLE, VK_NULL_HANDLE);
+
+		for (unsigned int t = 0; t < 2; ++t)
+		{
+			GFXVec* pools = &recorder->pools[i].queries[t].vk.pools;
+			for (size_t q = 0; q < pools->size; ++q)
+				_gfx_push_stale(renderer,
+					VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE,
+					VK_NULL_HANDLE, *(VkQueryPool*)gfx_vec_at(pools, q), VK_NULL_HANDLE);
+		}
 	}
 
 	_gfx_mutex_unlock(&renderer->lock);
 
 	// Free all the memory.
-	for (unsigned int i = 0; i < renderer->numFrames; ++i)
+	for (unsigned int i = 0; i < renderer->numFrames * 2; ++i)
 	{
-		gfx_vec_clear(&recorder->pools[i*2].vk.cmds);
-		gfx_vec_clear(&recorder->pools[i*2+1].vk.cmds);
+		GFXVec* retained = &recorder->pools[i].retained;
+		for (size_t r = 0; r < retained->size; ++r)
+			gfx_vec_clear(&((_GFXRecorderRetained*)gfx_vec_at(retained, r))->sets);
+
+		gfx_vec_clear(retained);
+		gfx_vec_clear(&recorder->pools[i].vk.cmds);
+
+		for (unsigned int t = 0; t < 2; ++t)
+		{
+			gfx_vec_clear(&recorder->pools[i].queries[t].results);
+			gfx_vec_clear(&recorder->pools[i].queries[t].vk.pools);
+		}
 	}
 
+	gfx_vec_clear(&recorder->defer.draws);
+	gfx_vec_clear(&recorder->defer.keys);
+	gfx_vec_clear(&recorder->defer.states);
+	gfx_vec_clear(&recorder->defer.pushes);
+
+	for (size_t b = 0; b < recorder->out.cmds.size; ++b)
+		gfx_vec_clear(gfx_vec_at(&recorder->out.cmds, b));
+
 	gfx_vec_clear(&recorder->out.cmds);
 	free(recorder);
 }
 
+/****************************/
+GFX_API GFXRecorder* gfx_renderer_add_recorder(GFXRenderer* renderer)
+{
+	assert(renderer != NULL);
+	assert(!renderer->recording);
+
+	GFXRecorder* rec = _gfx_recorder_create(renderer, 1);
+	if (rec == NULL)
+		gfx_log_error("Could not add a new recorder to a renderer.");
+
+	return rec;
+}
+
+/****************************/
+GFX_API void gfx_erase_recorder(GFXRecorder* recorder)
+{
+	assert(recorder != NULL);
+	assert(!recorder->renderer->recording);
+
+	_gfx_recorder_destroy(recorder, 1);
+}
+
 /****************************/
 GFX_API void gfx_recorder_render(GFXRecorder* recorder, GFXPass* pass,
                                  void (*cb)(GFXRecorder*, unsigned int, void*),
@@ -457,20 +1844,51 @@ GFX_API void gfx_recorder_render(GFXRecorder* recorder, GFXPass* pass,
 	assert(pass->renderer == recorder->renderer);
 	assert(cb != NULL);
 
+	gfx_trace_begin(render, "gfx_recorder_render");
+
 	GFXRenderer* rend = recorder->renderer;
 	_GFXContext* context = recorder->context;
+	_GFXRecorderRetained* entry = NULL;
 
 	// The pass must be a render pass.
 	_GFXRenderPass* rPass = (_GFXRenderPass*)pass;
 	if (pass->type != GFX_PASS_RENDER) goto error;
 
+	// Culled passes are not submitted, nothing to record.
+	if (pass->culled) goto done;
+
 	// Check for the presence of a framebuffer.
 	VkFramebuffer framebuffer = _gfx_pass_framebuffer(rPass, rend->public);
 	if (framebuffer == VK_NULL_HANDLE) goto error;
 
-	// Then, claim a command buffer to use.
-	VkCommandBuffer cmd = _gfx_recorder_claim(recorder, pass->type);
-	if (cmd == NULL) goto error;
+	// Then, get a command buffer to use.
+	// When retained, re-execute the previous recording if still valid.
+	// Retained recordings do not know the framebuffer, as it may be
+	// a different swapchain image every time they are executed.
+	VkCommandBuffer cmd;
+
+	if (recorder->retain.enabled)
+	{
+		bool valid;
+		entry = _gfx_recorder_retain(recorder, pass, cb, ptr, &valid);
+		if (entry == NULL) goto error;
+
+		cmd = entry->vk.cmd;
+		framebuffer = VK_NULL_HANDLE;
+
+		if (valid)
+		{
+			if (!_gfx_recorder_output(recorder, pass->order, cmd))
+				goto error;
+
+			goto done;
+		}
+	}
+	else
+	{
+		cmd = _gfx_recorder_claim(recorder, pass);
+		if (cmd == NULL) goto error;
+	}
 
 	// Start recording with it.
 	VkCommandBufferBeginInfo cbbi = {
@@ -478,7 +1896,7 @@ GFX_API void gfx_recorder_render(GFXRecorder* recorder, GFXPass* pass,
 
 		.pNext = NULL,
 		.flags =
-			VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+			(entry == NULL ? VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT : 0) |
 			VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
 
 		.pInheritanceInfo = (VkCommandBufferInheritanceInfo[]){{
@@ -524,13 +1942,25 @@ GFX_API void gfx_recorder_render(GFXRecorder* recorder, GFXPass* pass,
 	// Set recording input, record, unset input.
 	recorder->inp.pass = &rPass->base;
 	recorder->inp.cmd = cmd;
-	recorder->bind.pipeline = NULL;
-	recorder->bind.primitive = NULL;
+	recorder->retain.current = entry;
+	_gfx_recorder_reset_bind(recorder);
+
+	// Defer draws in deferred mode, to be sorted when done.
+	recorder->defer.active = recorder->defer.enabled;
+	recorder->defer.depth = 0;
+
+	if (recorder->defer.active)
+		_gfx_recorder_undefer(recorder);
 
 	cb(recorder, recorder->current, ptr);
 
+	if (recorder->defer.active)
+		_gfx_recorder_flush(recorder, 0),
+		recorder->defer.active = 0;
+
 	recorder->inp.pass = NULL;
 	recorder->inp.cmd = NULL;
+	recorder->retain.current = NULL;
 
 	_GFX_VK_CHECK(
 		context->vk.EndCommandBuffer(cmd),
@@ -541,12 +1971,129 @@ GFX_API void gfx_recorder_render(GFXRecorder* recorder, GFXPass* pass,
 	if (!_gfx_recorder_output(recorder, pass->order, cmd))
 		goto error;
 
+done:
+	gfx_trace_end(render);
+
 	return;
 
 
 	// Error on failure.
 error:
+	// A failed retained recording must not be re-executed.
+	if (entry != NULL) entry->once = 1;
+
 	gfx_log_error("Recorder failed to record render commands.");
+	gfx_trace_end(render);
+}
+
+/****************************/
+GFX_API void gfx_recorder_render_parallel(GFXRecorder* recorder, GFXPass* pass,
+                                          size_t numItems,
+                                          void (*cb)(GFXRecorder*, unsigned int,
+                                                     size_t, size_t, void*),
+                                          void* ptr)
+{
+	assert(recorder != NULL);
+	assert(recorder->renderer->recording);
+	assert(recorder->inp.cmd == NULL);
+	assert(pass != NULL);
+	assert(pass->renderer == recorder->renderer);
+	assert(cb != NULL);
+
+	// The pass must be a render pass.
+	if (pass->type != GFX_PASS_RENDER) goto error;
+
+	// Culled passes are not submitted, nothing to record.
+	if (pass->culled || numItems == 0) return;
+
+	// Get a helper for each partition, creating new ones as necessary.
+	// If we cannot create enough, just use fewer partitions.
+	size_t numParts = GFX_MIN(numItems,
+		GFX_MIN(_GFX_RECORDER_MAX_HELPERS, _gfx_jobs_concurrency()));
+
+	while (recorder->helpers.size < numParts)
+	{
+		GFXRecorder* helper = _gfx_recorder_create(recorder->renderer, 0);
+		if (helper == NULL) break;
+
+		if (!gfx_vec_push(&recorder->helpers, 1, &helper))
+		{
+			_gfx_recorder_destroy(helper, 0);
+			break;
+		}
+	}
+
+	numParts = GFX_MIN(numParts, recorder->helpers.size);
+	if (numParts == 0) goto error;
+
+	// Partition the items as evenly as possible, then record each
+	// partition with its own helper, doing the first one ourselves.
+	bool success = 1;
+
+	{
+		const size_t share = numItems / numParts;
+		const size_t rem = numItems % numParts;
+
+		// Bounded by the maximum number of helpers.
+		_GFXRecorderPart parts[_GFX_RECORDER_MAX_HELPERS];
+		_GFXJob jobs[_GFX_RECORDER_MAX_HELPERS];
+
+		for (size_t p = 0, first = 0; p < numParts; ++p)
+		{
+			GFXRecorder* helper =
+				*(GFXRecorder**)gfx_vec_at(&recorder->helpers, p);
+
+			helper->defer.enabled = recorder->defer.enabled;
+
+			parts[p] = (_GFXRecorderPart){
+				.helper = helper,
+				.pass = pass,
+				.first = first,
+				.num = share + (p < rem ? 1 : 0),
+				.cb = cb,
+				.ptr = ptr
+			};
+
+			jobs[p] = (_GFXJob){
+				.func = _gfx_recorder_part,
+				.arg = parts + p
+			};
+
+			first += parts[p].num;
+		}
+
+		_GFXJobCounter counter;
+		_gfx_job_counter(&counter, NULL);
+
+		_gfx_jobs_submit(&counter, numParts - 1, jobs + 1);
+		_gfx_recorder_part(parts);
+		_gfx_jobs_wait(&counter);
+
+		// Merge all outputs in partition order, emptying the helpers.
+		// Helpers that failed have already logged & output nothing.
+		for (size_t p = 0; p < numParts; ++p)
+		{
+			GFXVec* out = &parts[p].helper->out.cmds;
+			if (pass->order >= out->size) continue;
+
+			GFXVec* bucket = gfx_vec_at(out, pass->order);
+			if (bucket->size == 0) continue;
+
+			success = success &&
+				_gfx_recorder_buckets(recorder, (size_t)pass->order + 1) &&
+				gfx_vec_push(gfx_vec_at(&recorder->out.cmds, pass->order),
+					bucket->size, gfx_vec_at(bucket, 0));
+
+			gfx_vec_release(bucket);
+		}
+	}
+
+	if (success) return;
+
+
+	// Error on failure.
+error:
+	gfx_log_error("Recorder failed to record render commands in parallel.");
 }
 
 /****************************/
@@ -561,21 +2108,47 @@ GFX_API void gfx_recorder_compute(GFXRecorder* recorder, GFXPass* pass,
 	assert(cb != NULL);
 
 	_GFXContext* context = recorder->context;
+	_GFXRecorderRetained* entry = NULL;
 
 	// The pass must be a compute pass.
 	_GFXComputePass* cPass = (_GFXComputePass*)pass;
 	if (pass->type == GFX_PASS_RENDER) goto error;
 
-	// Then, claim a command buffer to use.
-	VkCommandBuffer cmd = _gfx_recorder_claim(recorder, pass->type);
-	if (cmd == NULL) goto error;
+	// Culled passes are not submitted, nothing to record.
+	if (pass->culled) return;
+
+	// Then, get a command buffer to use.
+	// When retained, re-execute the previous recording if still valid.
+	VkCommandBuffer cmd;
+
+	if (recorder->retain.enabled)
+	{
+		bool valid;
+		entry = _gfx_recorder_retain(recorder, pass, cb, ptr, &valid);
+		if (entry == NULL) goto error;
+
+		cmd = entry->vk.cmd;
+
+		if (valid)
+		{
+			if (!_gfx_recorder_output(recorder, pass->order, cmd))
+				goto error;
+
+			return;
+		}
+	}
+	else
+	{
+		cmd = _gfx_recorder_claim(recorder, pass);
+		if (cmd == NULL) goto error;
+	}
 
 	// Start recording with it.
 	VkCommandBufferBeginInfo cbbi = {
 		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
 
 		.pNext = NULL,
-		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+		.flags = entry == NULL ? VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT : 0,
 
 		.pInheritanceInfo = (VkCommandBufferInheritanceInfo[]){{
 			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
@@ -598,13 +2171,14 @@ GFX_API void gfx_recorder_compute(GFXRecorder* recorder, GFXPass* pass,
 	// Set recording input, record, unset input.
 	recorder->inp.pass = &cPass->base;
 	recorder->inp.cmd = cmd;
-	recorder->bind.pipeline = NULL;
-	recorder->bind.primitive = NULL;
+	recorder->retain.current = entry;
+	_gfx_recorder_reset_bind(recorder);
 
 	cb(recorder, recorder->current, ptr);
 
 	recorder->inp.pass = NULL;
 	recorder->inp.cmd = NULL;
+	recorder->retain.current = NULL;
 
 	_GFX_VK_CHECK(
 		context->vk.EndCommandBuffer(cmd),
@@ -620,6 +2194,9 @@ GFX_API void gfx_recorder_compute(GFXRecorder* recorder, GFXPass* pass,
 
 	// Error on failure.
 error:
+	// A failed retained recording must not be re-executed.
+	if (entry != NULL) entry->once = 1;
+
 	gfx_log_error("Recorder failed to record compute commands.");
 }
 
@@ -645,6 +2222,95 @@ GFX_API void gfx_recorder_get_size(GFXRecorder* recorder,
 		*layers = 0;
 }
 
+/****************************/
+GFX_API void gfx_recorder_set_deferred(GFXRecorder* recorder, bool deferred)
+{
+	assert(recorder != NULL);
+	assert(recorder->inp.cmd == NULL);
+
+	recorder->defer.enabled = deferred;
+}
+
+/****************************/
+GFX_API bool gfx_recorder_is_deferred(GFXRecorder* recorder)
+{
+	assert(recorder != NULL);
+
+	return recorder->defer.enabled;
+}
+
+/****************************/
+GFX_API void gfx_recorder_set_retained(GFXRecorder* recorder, bool retained)
+{
+	assert(recorder != NULL);
+	assert(recorder->inp.cmd == NULL);
+
+	recorder->retain.enabled = retained;
+}
+
+/****************************/
+GFX_API bool gfx_recorder_is_retained(GFXRecorder* recorder)
+{
+	assert(recorder != NULL);
+
+	return recorder->retain.enabled;
+}
+
+/****************************/
+GFX_API void gfx_recorder_invalidate(GFXRecorder* recorder)
+{
+	assert(recorder != NULL);
+	assert(recorder->inp.cmd == NULL);
+
+	++recorder->retain.gen;
+}
+
+/****************************/
+GFX_API void gfx_recorder_get_stats(GFXRecorder* recorder, GFXRecorderStats* stats)
+{
+	assert(recorder != NULL);
+	assert(stats != NULL);
+
+	*stats = recorder->skipped;
+
+	// Include everything skipped by the parallel recording helpers.
+	for (size_t h = 0; h < recorder->helpers.size; ++h)
+	{
+		const GFXRecorder* helper =
+			*(GFXRecorder**)gfx_vec_at(&recorder->helpers, h);
+
+		stats->pipelines += helper->skipped.pipelines;
+		stats->primitives += helper->skipped.primitives;
+		stats->sets += helper->skipped.sets;
+		stats->pushes += helper->skipped.pushes;
+	}
+}
+
+/****************************/
+GFX_API bool gfx_recorder_get_query(GFXRecorder* recorder, uint32_t query,
+                                    GFXQueryResult* result)
+{
+	assert(recorder != NULL);
+	assert(result != NULL);
+
+	if (query == UINT32_MAX)
+		return 0;
+
+	// Results are resolved on reset, so they belong to the previous use
+	// of the current pools, i.e. the same virtual frame index.
+	const _GFXRecorderQueries* queries =
+		&_gfx_recorder_pool(recorder, _GFX_QUERY_COMPUTE(query))->
+			queries[_GFX_QUERY_TYPE(query)];
+
+	const uint32_t slot = _GFX_QUERY_SLOT(query);
+	if (slot >= queries->results.size)
+		return 0;
+
+	*result = *(GFXQueryResult*)gfx_vec_at(&queries->results, slot);
+
+	return result->available;
+}
+
 /****************************/
 GFX_API void gfx_pass_get_size(GFXPass* pass,
                                uint32_t* width, uint32_t* height, uint32_t* layers)
@@ -717,10 +2383,52 @@ GFX_API void gfx_cmd_bind(GFXRecorder* recorder, GFXTechnique* technique,
 		return;
 	}
 
+	const VkPipelineBindPoint bindPoint =
+		technique->shaders[_GFX_GET_SHADER_STAGE_INDEX(GFX_STAGE_COMPUTE)] == NULL ?
+		VK_PIPELINE_BIND_POINT_GRAPHICS :
+		VK_PIPELINE_BIND_POINT_COMPUTE;
+
+	// Push descriptor sets are recorded directly,
+	// split them off and bind the ranges inbetween as usual.
+	for (size_t s = 0; s < numSets; ++s)
+	{
+		VkDescriptorUpdateTemplate template =
+			_gfx_tech_get_push(technique, firstSet + s);
+
+		if (template == VK_NULL_HANDLE)
+			continue;
+
+		// Push sets cannot have dynamic offsets,
+		// so all offsets before it belong to the preceding range.
+		size_t preDyns = 0;
+		for (size_t p = 0; p < s; ++p)
+			preDyns += sets[p]->numDynamics;
+
+		preDyns = GFX_MIN(preDyns, numDynamics);
+
+		if (s > 0)
+			gfx_cmd_bind(recorder, technique,
+				firstSet, s, preDyns, sets, offsets);
+
+		_gfx_recorder_push_set(recorder, technique,
+			bindPoint, firstSet + s, sets[s], template);
+
+		if (s + 1 < numSets)
+			gfx_cmd_bind(recorder, technique,
+				firstSet + s + 1, numSets - s - 1,
+				numDynamics - preDyns, sets + s + 1,
+				numDynamics > preDyns ? offsets + preDyns : NULL);
+
+		return;
+	}
+
 	// Get all the Vulkan descriptor sets.
 	// And count the number of dynamic offsets.
 	VkDescriptorSet dSets[numSets];
+	size_t numDyns[numSets];
+	size_t firstOffsets[numSets];
 	size_t numOffsets = 0;
+	bool trackable = firstSet + numSets <= _GFX_RECORDER_SETS;
 
 	for (size_t s = 0; s < numSets; ++s)
 	{
@@ -734,38 +2442,78 @@ GFX_API void gfx_cmd_bind(GFXRecorder* recorder, GFXTechnique* technique,
 			return;
 		}
 
-		dSets[s] = elem->vk.set;
-		numOffsets += sets[s]->numDynamics;
+		// Remember the set to validate a retained recording.
+		if (recorder->retain.current != NULL)
+			_gfx_recorder_retain_set(recorder, sets[s], elem);
+
+		dSets[s] = elem->vk.set;
+		numDyns[s] = sets[s]->numDynamics;
+		firstOffsets[s] = numOffsets;
+		numOffsets += numDyns[s];
+		trackable = trackable && numDyns[s] <= _GFX_RECORDER_DYNAMICS;
+	}
+
+	// Set all trailing 'empty' offsets to 0.
+	uint32_t offs[numOffsets > 0 ? numOffsets : 1];
+
+	for (size_t d = 0; d < numOffsets; ++d)
+		offs[d] = d < numDynamics ? offsets[d] : 0;
+
+	size_t first, last;
+
+	// When deferred, only track the sets in issue order.
+	// If they cannot be tracked, flush all deferred draws & record directly.
+	if (recorder->defer.active)
+	{
+		if (trackable)
+		{
+			_GFXRecorderState* state = &recorder->defer.state;
+
+			if (_gfx_recorder_use_layout(state, technique->vk.layout))
+				recorder->defer.dirtySets = 1,
+				recorder->defer.dirtyPush = 1;
+
+			_gfx_recorder_track_sets(state, bindPoint,
+				firstSet, numSets, dSets, numDyns, offs, &first, &last);
+
+			if (first >= numSets)
+				recorder->skipped.sets += numSets;
+			else
+				recorder->skipped.sets += numSets - (last - first + 1),
+				recorder->defer.dirtySets = 1;
+
+			return;
+		}
+
+		_gfx_recorder_flush(recorder, 1);
 	}
 
-	// Record the bind command.
-	const VkPipelineBindPoint bindPoint =
-		technique->shaders[_GFX_GET_SHADER_STAGE_INDEX(GFX_STAGE_COMPUTE)] == NULL ?
-		VK_PIPELINE_BIND_POINT_GRAPHICS :
-		VK_PIPELINE_BIND_POINT_COMPUTE;
+	// Find the range of sets that are not bound yet & remember them.
+	_gfx_recorder_use_layout(&recorder->bind.state, technique->vk.layout);
+	_gfx_recorder_track_sets(&recorder->bind.state, bindPoint,
+		firstSet, numSets, dSets, numDyns, offs, &first, &last);
 
-	if (numDynamics >= numOffsets)
+	if (first >= numSets)
 	{
-		// If enough dynamic offsets are given, just pass that array.
-		context->vk.CmdBindDescriptorSets(recorder->inp.cmd,
-			bindPoint, technique->vk.layout,
-			(uint32_t)firstSet, (uint32_t)numSets, dSets,
-			(uint32_t)numOffsets, offsets);
+		// Everything is already bound.
+		recorder->skipped.sets += numSets;
 	}
 	else
 	{
-		// If not, create a new array,
-		// set all trailing 'empty' offsets to 0.
-		uint32_t offs[numOffsets > 0 ? numOffsets : 1];
+		recorder->skipped.sets += numSets - (last - first + 1);
 
-		for (size_t d = 0; d < numOffsets; ++d)
-			offs[d] = d < numDynamics ? offsets[d] : 0;
+		// Record the bind command.
+		const size_t bindOffsets =
+			firstOffsets[last] + numDyns[last] - firstOffsets[first];
 
 		context->vk.CmdBindDescriptorSets(recorder->inp.cmd,
 			bindPoint, technique->vk.layout,
-			(uint32_t)firstSet, (uint32_t)numSets, dSets,
-			(uint32_t)numOffsets, offs);
+			(uint32_t)(firstSet + first), (uint32_t)(last - first + 1), dSets + first,
+			(uint32_t)bindOffsets, offs + firstOffsets[first]);
 	}
+
+	if (recorder->defer.active)
+		_gfx_recorder_undefer(recorder);
 }
 
 /****************************/
@@ -800,11 +2548,58 @@ GFX_API void gfx_cmd_push(GFXRecorder* recorder, GFXTechnique* technique,
 	if (size == 0)
 		size = technique->pushSize - offset;
 
-	// Record the push command.
-	context->vk.CmdPushConstants(recorder->inp.cmd,
-		technique->vk.layout,
-		_GFX_GET_VK_SHADER_STAGE(technique->pushStages),
-		offset, size, data);
+	const VkShaderStageFlags stages =
+		_GFX_GET_VK_SHADER_STAGE(technique->pushStages);
+
+	// When deferred, only track the constants in issue order.
+	// If they cannot be tracked, flush all deferred draws & record directly.
+	if (recorder->defer.active)
+	{
+		if (offset + size <= _GFX_RECORDER_PUSH_SIZE)
+		{
+			_GFXRecorderState* state = &recorder->defer.state;
+
+			if (_gfx_recorder_use_layout(state, technique->vk.layout))
+				recorder->defer.dirtySets = 1;
+
+			if (_gfx_recorder_track_push(state, stages, offset, size, data))
+				recorder->defer.dirtyPush = 1;
+			else
+				++recorder->skipped.pushes;
+
+			return;
+		}
+
+		_gfx_recorder_flush(recorder, 1);
+	}
+
+	// Skip if the exact same bytes were already pushed with this layout.
+	_gfx_recorder_use_layout(&recorder->bind.state, technique->vk.layout);
+
+	if (!_gfx_recorder_track_push(
+		&recorder->bind.state, stages, offset, size, data))
+	{
+		++recorder->skipped.pushes;
+	}
+	else
+	{
+		// Record the push command.
+		context->vk.CmdPushConstants(recorder->inp.cmd,
+			technique->vk.layout, stages,
+			offset, size, data);
+	}
+
+	if (recorder->defer.active)
+		_gfx_recorder_undefer(recorder);
+}
+
+/****************************/
+GFX_API void gfx_cmd_sort(GFXRecorder* recorder, uint16_t depth)
+{
+	assert(recorder != NULL);
+	assert(recorder->inp.cmd != NULL);
+
+	recorder->defer.depth = depth;
 }
 
 /****************************/
@@ -825,29 +2620,33 @@ GFX_API void gfx_cmd_draw(GFXRecorder* recorder, GFXRenderable* renderable,
 		(firstVertex < renderable->primitive->numVertices &&
 		vertices <= renderable->primitive->numVertices - firstVertex));
 
-	_GFXContext* context = recorder->context;
-
 	// Take entire primitive if asked.
 	if (vertices == 0)
 		vertices = renderable->primitive->numVertices - firstVertex;
 
-	// Bind pipeline.
-	if (!_gfx_recorder_bind_renderable(recorder, renderable))
-	{
-		gfx_log_error(
-			"Failed to get Vulkan graphics pipeline during draw command; "
-			"command not recorded.");
+	// Bake the primitive's offset into its geometry.
+	const _GFXPrimitive* prim = (const _GFXPrimitive*)renderable->primitive;
+	if (prim != NULL) firstVertex += prim->baseVertex;
+
+	// Get pipeline & record the draw command.
+	_GFXRecorderDraw draw = {
+		.type      = _GFX_RECORDER_DRAW,
+		.primitive = renderable->primitive,
+		.baked     = 1,
+		.direct    = {
+			.count         = vertices,
+			.instances     = instances,
+			.first         = firstVertex,
+			.vertexOffset  = 0,
+			.firstInstance = firstInstance
+		}
+	};
 
+	if (!_gfx_recorder_pipeline(recorder, renderable, &draw.pipeline))
 		return;
-	}
-
-	// Bind primitive.
-	if (renderable->primitive != NULL)
-		_gfx_recorder_bind_primitive(recorder, renderable->primitive);
 
-	// Record the draw command.
-	context->vk.CmdDraw(recorder->inp.cmd,
-		vertices, instances, firstVertex, firstInstance);
+	_gfx_renderable_dynamic(renderable, &draw.dynamic);
+	_gfx_recorder_issue(recorder, &draw);
 }
 
 /****************************/
@@ -869,29 +2668,35 @@ GFX_API void gfx_cmd_draw_indexed(GFXRecorder* recorder, GFXRenderable* renderab
 		(firstIndex < renderable->primitive->numIndices &&
 		indices <= renderable->primitive->numIndices - firstIndex));
 
-	_GFXContext* context = recorder->context;
-
 	// Take entire primitive if asked.
 	if (indices == 0)
 		indices = renderable->primitive->numIndices - firstIndex;
 
-	// Bind pipeline.
-	if (!_gfx_recorder_bind_renderable(recorder, renderable))
-	{
-		gfx_log_error(
-			"Failed to get Vulkan graphics pipeline during draw command; "
-			"command not recorded.");
+	// Bake the primitive's offsets into its geometry.
+	const _GFXPrimitive* prim = (const _GFXPrimitive*)renderable->primitive;
+	if (prim != NULL)
+		firstIndex += prim->baseIndex,
+		vertexOffset += (int32_t)prim->baseVertex;
+
+	// Get pipeline & record the draw command.
+	_GFXRecorderDraw draw = {
+		.type      = _GFX_RECORDER_DRAW_INDEXED,
+		.primitive = renderable->primitive,
+		.baked     = 1,
+		.direct    = {
+			.count         = indices,
+			.instances     = instances,
+			.first         = firstIndex,
+			.vertexOffset  = vertexOffset,
+			.firstInstance = firstInstance
+		}
+	};
 
+	if (!_gfx_recorder_pipeline(recorder, renderable, &draw.pipeline))
 		return;
-	}
-
-	// Bind primitive.
-	if (renderable->primitive != NULL)
-		_gfx_recorder_bind_primitive(recorder, renderable->primitive);
 
-	// Record the draw command.
-	context->vk.CmdDrawIndexed(recorder->inp.cmd,
-		indices, instances, firstIndex, vertexOffset, firstInstance);
+	_gfx_renderable_dynamic(renderable, &draw.dynamic);
+	_gfx_recorder_issue(recorder, &draw);
 }
 
 /****************************/
@@ -904,6 +2709,44 @@ GFX_API void gfx_cmd_draw_from(GFXRecorder* recorder, GFXRenderable* renderable,
 		"sizeof(GFXDrawCmd) must be a multiple of 4 bytes.");
 
 	assert(GFX_REF_IS_BUFFER(ref));
+	assert(count <= 1 || stride == 0 ||
+		(stride % 4 == 0 && stride >= sizeof(GFXDrawCmd)));
+
+	// Tightly packed if asked.
+	if (stride == 0) stride = sizeof(GFXDrawCmd);
+
+	_gfx_recorder_indirect(recorder, renderable,
+		_GFX_RECORDER_DRAW_INDIRECT, count, stride, ref, 0);
+}
+
+/****************************/
+GFX_API void gfx_cmd_draw_indexed_from(GFXRecorder* recorder, GFXRenderable* renderable,
+                                       uint32_t count,
+                                       uint32_t stride, GFXBufferRef ref)
+{
+	static_assert(
+		sizeof(GFXDrawIndexedCmd) % 4 == 0,
+		"sizeof(GFXDrawIndexedCmd) must be a multiple of 4 bytes.");
+
+	assert(GFX_REF_IS_BUFFER(ref));
+	assert(count <= 1 || stride == 0 ||
+		(stride % 4 == 0 && stride >= sizeof(GFXDrawIndexedCmd)));
+
+	// Tightly packed if asked.
+	if (stride == 0) stride = sizeof(GFXDrawIndexedCmd);
+
+	_gfx_recorder_indirect(recorder, renderable,
+		_GFX_RECORDER_DRAW_INDEXED_INDIRECT, count, stride, ref, 0);
+}
+
+/****************************/
+GFX_API void gfx_cmd_draw_count_from(GFXRecorder* recorder, GFXRenderable* renderable,
+                                     uint32_t maxCount,
+                                     uint32_t stride, GFXBufferRef ref,
+                                     GFXBufferRef countRef)
+{
+	assert(GFX_REF_IS_BUFFER(ref));
+	assert(GFX_REF_IS_BUFFER(countRef));
 	assert(recorder != NULL);
 	assert(recorder->inp.pass != NULL);
 	assert(recorder->inp.pass->type == GFX_PASS_RENDER);
@@ -911,54 +2754,65 @@ GFX_API void gfx_cmd_draw_from(GFXRecorder* recorder, GFXRenderable* renderable,
 	assert(renderable != NULL);
 	assert(renderable->pass == recorder->inp.pass);
 	assert(renderable->technique != NULL);
-	assert(count <= 1 || stride == 0 ||
-		(stride % 4 == 0 && stride >= sizeof(GFXDrawCmd)));
+	assert(stride == 0 || (stride % 4 == 0 && stride >= sizeof(GFXDrawCmd)));
 
 	_GFXContext* context = recorder->context;
 
-	// Tightly packed if asked.
-	if (stride == 0) stride = sizeof(GFXDrawCmd);
-
-	// Unpack reference & validate.
-	_GFXUnpackRef unp = _gfx_ref_unpack(ref);
-	if (unp.obj.buffer == NULL)
+	// Check for support.
+	if (!(context->features & _GFX_SUPPORT_DRAW_INDIRECT_COUNT))
 	{
 		gfx_log_error(
-			"Failed to retrieve indirect buffer during draw command; "
+			"Indirect count draws are not supported by the device; "
 			"command not recorded.");
 
 		return;
 	}
 
-	// Bind pipeline.
-	if (!_gfx_recorder_bind_renderable(recorder, renderable))
+	// Tightly packed if asked.
+	if (stride == 0) stride = sizeof(GFXDrawCmd);
+
+	// Unpack references & validate.
+	_GFXUnpackRef unp = _gfx_ref_unpack(ref);
+	_GFXUnpackRef cUnp = _gfx_ref_unpack(countRef);
+
+	if (unp.obj.buffer == NULL || cUnp.obj.buffer == NULL)
 	{
 		gfx_log_error(
-			"Failed to get Vulkan graphics pipeline during draw command; "
+			"Failed to retrieve indirect (count) buffer during draw command; "
 			"command not recorded.");
 
 		return;
 	}
 
-	// Bind primitive.
-	if (renderable->primitive != NULL)
-		_gfx_recorder_bind_primitive(recorder, renderable->primitive);
+	// Get pipeline & record the draw command.
+	_GFXRecorderDraw draw = {
+		.type      = _GFX_RECORDER_DRAW_INDIRECT_COUNT,
+		.primitive = renderable->primitive,
+		.indirect  = {
+			.buffer      = unp.obj.buffer->vk.buffer,
+			.offset      = unp.value,
+			.countBuffer = cUnp.obj.buffer->vk.buffer,
+			.countOffset = cUnp.value,
+			.count       = maxCount,
+			.stride      = stride
+		}
+	};
 
-	// Record the draw command.
-	context->vk.CmdDrawIndirect(recorder->inp.cmd,
-		unp.obj.buffer->vk.buffer, unp.value, count, stride);
+	if (!_gfx_recorder_pipeline(recorder, renderable, &draw.pipeline))
+		return;
+
+	_gfx_renderable_dynamic(renderable, &draw.dynamic);
+	_gfx_recorder_issue(recorder, &draw);
 }
 
 /****************************/
-GFX_API void gfx_cmd_draw_indexed_from(GFXRecorder* recorder, GFXRenderable* renderable,
-                                       uint32_t count,
-                                       uint32_t stride, GFXBufferRef ref)
+GFX_API void gfx_cmd_draw_indexed_count_from(GFXRecorder* recorder, GFXRenderable* renderable,
+                                             uint32_t maxCount,
+                                             uint32_t stride, GFXBufferRef ref,
+                                             GFXBufferRef countRef)
 {
-	static_assert(
-		sizeof(GFXDrawIndexedCmd) % 4 == 0,
-		"sizeof(GFXDrawIndexedCmd) must be a multiple of 4 bytes.");
-
 	assert(GFX_REF_IS_BUFFER(ref));
+	assert(GFX_REF_IS_BUFFER(countRef));
 	assert(recorder != NULL);
 	assert(recorder->inp.pass != NULL);
 	assert(recorder->inp.pass->type == GFX_PASS_RENDER);
@@ -966,42 +2820,195 @@ GFX_API void gfx_cmd_draw_indexed_from(GFXRecorder* recorder, GFXRenderable* ren
 	assert(renderable != NULL);
 	assert(renderable->pass == recorder->inp.pass);
 	assert(renderable->technique != NULL);
-	assert(count <= 1 || stride == 0 ||
-		(stride % 4 == 0 && stride >= sizeof(GFXDrawIndexedCmd)));
+	assert(stride == 0 || (stride % 4 == 0 && stride >= sizeof(GFXDrawIndexedCmd)));
 
 	_GFXContext* context = recorder->context;
 
+	// Check for support.
+	if (!(context->features & _GFX_SUPPORT_DRAW_INDIRECT_COUNT))
+	{
+		gfx_log_error(
+			"Indirect count draws are not supported by the device; "
+			"command not recorded.");
+
+		return;
+	}
+
 	// Tightly packed if asked.
 	if (stride == 0) stride = sizeof(GFXDrawIndexedCmd);
 
-	// Unpack reference & validate.
+	// Unpack references & validate.
 	_GFXUnpackRef unp = _gfx_ref_unpack(ref);
-	if (unp.obj.buffer == NULL)
+	_GFXUnpackRef cUnp = _gfx_ref_unpack(countRef);
+
+	if (unp.obj.buffer == NULL || cUnp.obj.buffer == NULL)
 	{
 		gfx_log_error(
-			"Failed to retrieve indirect buffer during draw command; "
+			"Failed to retrieve indirect (count) buffer during draw command; "
 			"command not recorded.");
 
 		return;
 	}
 
-	// Bind pipeline.
-	if (!_gfx_recorder_bind_renderable(recorder, renderable))
+	// Get pipeline & record the draw command.
+	_GFXRecorderDraw draw = {
+		.type      = _GFX_RECORDER_DRAW_INDEXED_INDIRECT_COUNT,
+		.primitive = renderable->primitive,
+		.indirect  = {
+			.buffer      = unp.obj.buffer->vk.buffer,
+			.offset      = unp.value,
+			.countBuffer = cUnp.obj.buffer->vk.buffer,
+			.countOffset = cUnp.value,
+			.count       = maxCount,
+			.stride      = stride
+		}
+	};
+
+	if (!_gfx_recorder_pipeline(recorder, renderable, &draw.pipeline))
+		return;
+
+	_gfx_renderable_dynamic(renderable, &draw.dynamic);
+	_gfx_recorder_issue(recorder, &draw);
+}
+
+/****************************/
+GFX_API void gfx_cmd_draw_batch(GFXRecorder* recorder, GFXRenderable* renderable,
+                                size_t numDraws, const GFXDrawCmd* draws)
+{
+	assert(recorder != NULL);
+	assert(recorder->inp.pass != NULL);
+	assert(recorder->inp.pass->type == GFX_PASS_RENDER);
+	assert(recorder->inp.cmd != NULL);
+	assert(renderable != NULL);
+	assert(numDraws == 0 || draws != NULL);
+
+	if (numDraws == 0)
+		return;
+
+	const GFXDevice* device = &recorder->renderer->heap->allocator.device->base;
+
+	// Without multi-draw indirect, we'd need a command per draw anyway,
+	// might as well skip the indirect buffer.
+	if (numDraws == 1 || !device->features.multiDrawIndirect)
+	{
+		for (size_t d = 0; d < numDraws; ++d)
+			gfx_cmd_draw(recorder, renderable,
+				draws[d].vertices, draws[d].instances,
+				draws[d].firstVertex, draws[d].firstInstance);
+
+		return;
+	}
+
+	// Pack all draws into transient memory of the current frame.
+	// Which is only valid this frame, cannot be re-executed.
+	if (recorder->retain.current != NULL)
+		recorder->retain.current->once = 1;
+
+	GFXBufferRef ref;
+	void* ptr = gfx_frame_alloc(recorder->renderer->public,
+		sizeof(GFXDrawCmd) * numDraws, 4, &ref);
+
+	if (ptr == NULL)
 	{
 		gfx_log_error(
-			"Failed to get Vulkan graphics pipeline during draw command; "
-			"command not recorded.");
+			"Failed to allocate indirect buffer during batch draw command; "
+			"commands not recorded.");
 
 		return;
 	}
 
-	// Bind primitive.
-	if (renderable->primitive != NULL)
-		_gfx_recorder_bind_primitive(recorder, renderable->primitive);
+	memcpy(ptr, draws, sizeof(GFXDrawCmd) * numDraws);
 
-	// Record the draw command.
-	context->vk.CmdDrawIndexedIndirect(recorder->inp.cmd,
-		unp.obj.buffer->vk.buffer, unp.value, count, stride);
+	// Bake the primitive's offset into its geometry.
+	const _GFXPrimitive* prim = (const _GFXPrimitive*)renderable->primitive;
+	if (prim != NULL && prim->geometry != NULL)
+		for (size_t d = 0; d < numDraws; ++d)
+			((GFXDrawCmd*)ptr)[d].firstVertex += prim->baseVertex;
+
+	// Record a single draw for each chunk of at most maxDrawIndirectCount.
+	const uint32_t maxCount = device->limits.maxIndirectCount;
+
+	for (size_t d = 0; d < numDraws; d += maxCount)
+	{
+		GFXBufferRef sub = ref;
+		sub.offset += sizeof(GFXDrawCmd) * d;
+
+		_gfx_recorder_indirect(recorder, renderable,
+			_GFX_RECORDER_DRAW_INDIRECT,
+			(uint32_t)GFX_MIN(numDraws - d, maxCount),
+			sizeof(GFXDrawCmd), sub, 1);
+	}
+}
+
+/****************************/
+GFX_API void gfx_cmd_draw_indexed_batch(GFXRecorder* recorder, GFXRenderable* renderable,
+                                        size_t numDraws, const GFXDrawIndexedCmd* draws)
+{
+	assert(recorder != NULL);
+	assert(recorder->inp.pass != NULL);
+	assert(recorder->inp.pass->type == GFX_PASS_RENDER);
+	assert(recorder->inp.cmd != NULL);
+	assert(renderable != NULL);
+	assert(numDraws == 0 || draws != NULL);
+
+	if (numDraws == 0)
+		return;
+
+	const GFXDevice* device = &recorder->renderer->heap->allocator.device->base;
+
+	// Without multi-draw indirect, we'd need a command per draw anyway,
+	// might as well skip the indirect buffer.
+	if (numDraws == 1 || !device->features.multiDrawIndirect)
+	{
+		for (size_t d = 0; d < numDraws; ++d)
+			gfx_cmd_draw_indexed(recorder, renderable,
+				draws[d].indices, draws[d].instances,
+				draws[d].firstIndex, draws[d].vertexOffset,
+				draws[d].firstInstance);
+
+		return;
+	}
+
+	// Pack all draws into transient memory of the current frame.
+	// Which is only valid this frame, cannot be re-executed.
+	if (recorder->retain.current != NULL)
+		recorder->retain.current->once = 1;
+
+	GFXBufferRef ref;
+	void* ptr = gfx_frame_alloc(recorder->renderer->public,
+		sizeof(GFXDrawIndexedCmd) * numDraws, 4, &ref);
+
+	if (ptr == NULL)
+	{
+		gfx_log_error(
+			"Failed to allocate indirect buffer during batch draw command; "
+			"commands not recorded.");
+
+		return;
+	}
+
+	memcpy(ptr, draws, sizeof(GFXDrawIndexedCmd) * numDraws);
+
+	// Bake the primitive's offsets into its geometry.
+	const _GFXPrimitive* prim = (const _GFXPrimitive*)renderable->primitive;
+	if (prim != NULL && prim->geometry != NULL)
+		for (size_t d = 0; d < numDraws; ++d)
+			((GFXDrawIndexedCmd*)ptr)[d].firstIndex += prim->baseIndex,
+			((GFXDrawIndexedCmd*)ptr)[d].vertexOffset += (int32_t)prim->baseVertex;
+
+	// Record a single draw for each chunk of at most maxDrawIndirectCount.
+	const uint32_t maxCount = device->limits.maxIndirectCount;
+
+	for (size_t d = 0; d < numDraws; d += maxCount)
+	{
+		GFXBufferRef sub = ref;
+		sub.offset += sizeof(GFXDrawIndexedCmd) * d;
+
+		_gfx_recorder_indirect(recorder, renderable,
+			_GFX_RECORDER_DRAW_INDEXED_INDIRECT,
+			(uint32_t)GFX_MIN(numDraws - d, maxCount),
+			sizeof(GFXDrawIndexedCmd), sub, 1);
+	}
 }
 
 /****************************/
@@ -1108,3 +3115,138 @@ GFX_API void gfx_cmd_dispatch_from(GFXRecorder* recorder, GFXComputable* computa
 	context->vk.CmdDispatchIndirect(recorder->inp.cmd,
 		unp.obj.buffer->vk.buffer, unp.value);
 }
+
+/****************************/
+GFX_API uint32_t gfx_cmd_query_begin(GFXRecorder* recorder, GFXQueryType type)
+{
+	assert(recorder != NULL);
+	assert(recorder->inp.pass != NULL);
+	assert(recorder->inp.cmd != NULL);
+	assert(type == GFX_QUERY_OCCLUSION || type == GFX_QUERY_PIPELINE_STATISTICS);
+
+	// Helpers record in parallel & their queries are never resolved,
+	// no queries may be begun within gfx_recorder_render_parallel.
+	assert(!recorder->helper);
+
+	_GFXContext* context = recorder->context;
+	GFXPass* pass = recorder->inp.pass;
+
+	// Validate query type.
+	if (type == GFX_QUERY_OCCLUSION && pass->type != GFX_PASS_RENDER)
+	{
+		gfx_log_error(
+			"Occlusion queries can only be recorded in render passes; "
+			"query not begun.");
+
+		return UINT32_MAX;
+	}
+
+	if (
+		type == GFX_QUERY_PIPELINE_STATISTICS &&
+		!(context->features & _GFX_SUPPORT_PIPELINE_STATISTICS))
+	{
+		gfx_log_error(
+			"Pipeline statistics queries are not supported by the device; "
+			"query not begun.");
+
+		return UINT32_MAX;
+	}
+
+	// Queries are claimed per recording, cannot be re-executed.
+	if (recorder->retain.current != NULL)
+		recorder->retain.current->once = 1;
+
+	// Claim the next query of the current pool.
+	_GFXRecorderPool* pool = _gfx_recorder_pool(recorder, pass->async);
+	_GFXRecorderQueries* queries = &pool->queries[type];
+
+	const uint32_t slot = queries->used;
+	if (slot >= (UINT32_MAX >> 2))
+		goto error;
+
+	// Create a new Vulkan query pool if all are used.
+	// These are only reset when the frame is submitted,
+	// so we cannot grow existing pools.
+	if (slot >= queries->vk.pools.size * _GFX_RECORDER_QUERIES)
+	{
+		VkQueryPoolCreateInfo qpci = {
+			.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+
+			.pNext      = NULL,
+			.flags      = 0,
+			.queryCount = _GFX_RECORDER_QUERIES,
+
+			.queryType = (type == GFX_QUERY_OCCLUSION) ?
+				VK_QUERY_TYPE_OCCLUSION :
+				VK_QUERY_TYPE_PIPELINE_STATISTICS,
+
+			.pipelineStatistics = (type == GFX_QUERY_OCCLUSION) ? 0 :
+				_gfx_recorder_stats(recorder, pass->async)
+		};
+
+		if (!gfx_vec_push(&queries->vk.pools, 1, NULL))
+			goto error;
+
+		_GFX_VK_CHECK(
+			context->vk.CreateQueryPool(context->vk.device, &qpci, NULL,
+				gfx_vec_at(&queries->vk.pools, queries->vk.pools.size - 1)),
+			{
+				gfx_vec_pop(&queries->vk.pools, 1);
+				goto error;
+			});
+	}
+
+	// Queries enclose draws in issue order, flush all deferred draws.
+	if (recorder->defer.active)
+		_gfx_recorder_flush(recorder, 1);
+
+	// Record the begin command.
+	context->vk.CmdBeginQuery(recorder->inp.cmd,
+		*(VkQueryPool*)gfx_vec_at(
+			&queries->vk.pools, slot / _GFX_RECORDER_QUERIES),
+		slot % _GFX_RECORDER_QUERIES, 0);
+
+	++queries->used;
+
+	return _GFX_QUERY_ID(slot, type, pass->async);
+
+
+	// Error on failure.
+error:
+	gfx_log_error("Failed to claim a query; query not begun.");
+
+	return UINT32_MAX;
+}
+
+/****************************/
+GFX_API void gfx_cmd_query_end(GFXRecorder* recorder, uint32_t query)
+{
+	assert(recorder != NULL);
+	assert(recorder->inp.pass != NULL);
+	assert(recorder->inp.cmd != NULL);
+
+	_GFXContext* context = recorder->context;
+
+	// Silently ignore queries that failed to begin.
+	if (query == UINT32_MAX)
+		return;
+
+	assert(_GFX_QUERY_COMPUTE(query) == (recorder->inp.pass->async ? 1u : 0u));
+
+	const _GFXRecorderQueries* queries =
+		&_gfx_recorder_pool(recorder, _GFX_QUERY_COMPUTE(query))->
+			queries[_GFX_QUERY_TYPE(query)];
+
+	const uint32_t slot = _GFX_QUERY_SLOT(query);
+	assert(slot < queries->used);
+
+	// Queries enclose draws in issue order, flush all deferred draws.
+	if (recorder->defer.active)
+		_gfx_recorder_flush(recorder, 1);
+
+	// Record the end command.
+	context->vk.CmdEndQuery(recorder->inp.cmd,
+		*(VkQueryPool*)gfx_vec_at(
+			&queries->vk.pools, slot / _GFX_RECORDER_QUERIES),
+		slot % _GFX_RECORDER_QUERIES);
+}
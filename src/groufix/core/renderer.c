@@ -9,6 +9,7 @@
 #include "groufix/core/objects.h"
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 
 
 // Get pointer to a renderer from a pointer to one of its frames.
@@ -17,6 +18,20 @@
 		(sizeof(GFXFrame) * ((GFXFrame*)(frame))->index) - \
 		offsetof(GFXRenderer, frames)))
 
+// Minimum size of a transient memory chunk of a virtual frame (1 MiB).
+#define _GFX_FRAME_CHUNK_SIZE (1ull << 20)
+
+// Maximum size of a host visible device local heap that transient memory
+// chunks do not prefer, as they would starve it (256 MiB, i.e. no ReBAR).
+#define _GFX_FRAME_CHUNK_MAX_BAR_SIZE (256ull << 20)
+
+// Maximum #recycled descriptor sets kept around for reuse.
+#define _GFX_POOL_MAX_RECYCLED 4096
+
+// Maximum time to wait for a single presentation to be displayed (100ms),
+// so a window that is not being displayed never stalls the renderer.
+#define _GFX_PACING_TIMEOUT UINT64_C(100000000)
+
 
 /****************************
  * Stale resource (to be destroyed after acquisition).
@@ -33,6 +48,8 @@ typedef struct _GFXStale
 		VkImageView imageView;
 		VkBufferView bufferView;
 		VkCommandPool commandPool;
+		VkQueryPool queryPool;
+		VkDescriptorPool descriptorPool;
 
 	} vk;
 
@@ -139,6 +156,10 @@ static inline void _gfx_destroy_stale(GFXRenderer* renderer, _GFXStale* stale)
 		context->vk.device, stale->vk.bufferView, NULL);
 	context->vk.DestroyCommandPool(
 		context->vk.device, stale->vk.commandPool, NULL);
+	context->vk.DestroyQueryPool(
+		context->vk.device, stale->vk.queryPool, NULL);
+	context->vk.DestroyDescriptorPool(
+		context->vk.device, stale->vk.descriptorPool, NULL);
 }
 
 /****************************/
@@ -146,14 +167,18 @@ bool _gfx_push_stale(GFXRenderer* renderer,
                      VkFramebuffer framebuffer,
                      VkImageView imageView,
                      VkBufferView bufferView,
-                     VkCommandPool commandPool)
+                     VkCommandPool commandPool,
+                     VkQueryPool queryPool,
+                     VkDescriptorPool descriptorPool)
 {
 	assert(renderer != NULL);
 	assert(
 		framebuffer != VK_NULL_HANDLE ||
 		imageView != VK_NULL_HANDLE ||
 		bufferView != VK_NULL_HANDLE ||
-		commandPool != VK_NULL_HANDLE);
+		commandPool != VK_NULL_HANDLE ||
+		queryPool != VK_NULL_HANDLE ||
+		descriptorPool != VK_NULL_HANDLE);
 
 	// Get the last submitted frame's index.
 	const unsigned int index =
@@ -165,7 +190,9 @@ bool _gfx_push_stale(GFXRenderer* renderer,
 			.framebuffer = framebuffer,
 			.imageView = imageView,
 			.bufferView = bufferView,
-			.commandPool = commandPool
+			.commandPool = commandPool,
+			.queryPool = queryPool,
+			.descriptorPool = descriptorPool
 		}
 	};
 
@@ -199,7 +226,7 @@ bool _gfx_sync_frames(GFXRenderer* renderer)
 	// Skip if it is the public frame, as its fence is not awaitable
 	// inbetween _gfx_frame_Sync and _gfx_frame_submit!
 	uint32_t numFences =
-		(renderer->numFrames - (renderer->public != NULL) ? 1 : 0) * 2;
+		(renderer->numFrames - (renderer->public != NULL ? 1 : 0)) * 2;
 
 	// If none, we're done.
 	if (numFences == 0) return 1;
@@ -226,6 +253,132 @@ bool _gfx_sync_frames(GFXRenderer* renderer)
 	return 1;
 }
 
+/****************************
+ * Queries timestamp support of the picked queues of a renderer and
+ * initializes its profiling state, disabled by default.
+ * @param renderer Cannot be NULL, must have its queues picked.
+ * @param device   Cannot be NULL.
+ */
+static void _gfx_renderer_init_profile(GFXRenderer* renderer,
+                                       _GFXDevice* device)
+{
+	assert(renderer != NULL);
+	assert(device != NULL);
+
+	VkPhysicalDeviceProperties pdp;
+	_groufix.vk.GetPhysicalDeviceProperties(device->vk.device, &pdp);
+
+	uint32_t count;
+	_groufix.vk.GetPhysicalDeviceQueueFamilyProperties(
+		device->vk.device, &count, NULL);
+
+	VkQueueFamilyProperties props[count > 0 ? count : 1];
+	_groufix.vk.GetPhysicalDeviceQueueFamilyProperties(
+		device->vk.device, &count, props);
+
+	// Turn valid bits into masks, zero if not supported.
+	const uint32_t gBits = renderer->graphics.family < count ?
+		props[renderer->graphics.family].timestampValidBits : 0;
+	const uint32_t cBits = renderer->compute.family < count ?
+		props[renderer->compute.family].timestampValidBits : 0;
+
+	renderer->profile.enabled = 0;
+	renderer->profile.period = pdp.limits.timestampPeriod;
+
+	renderer->profile.graphics =
+		gBits >= 64 ? UINT64_MAX : (UINT64_C(1) << gBits) - 1;
+	renderer->profile.compute =
+		cBits >= 64 ? UINT64_MAX : (UINT64_C(1) << cBits) - 1;
+}
+
+/****************************
+ * Blocks until the GPU is no more than the latency limit of a renderer
+ * behind, both in execution and presentation (if supported).
+ * @param renderer Cannot be NULL, must have a latency limit.
+ *
+ * Must be called inbetween gfx_frame_submit and _gfx_frame_sync
+ * of the next frame, i.e. when there is no public frame.
+ */
+static void _gfx_renderer_pace(GFXRenderer* renderer)
+{
+	assert(renderer != NULL);
+	assert(renderer->pacing.latency > 0);
+	assert(renderer->public == NULL);
+
+	_GFXContext* context = renderer->cache.context;
+	const unsigned int latency = renderer->pacing.latency;
+
+	// Wait for the frame submitted `latency` frames ago, any frame before
+	// it was submitted after is waited for when acquired anyway.
+	if (latency < renderer->numFrames)
+		_gfx_frame_sync(renderer, renderer->frames +
+			(renderer->current + renderer->numFrames - latency) %
+			renderer->numFrames, 0);
+
+	// Then wait for the presentations of each window.
+	if (!(context->features & _GFX_SUPPORT_PRESENT_WAIT))
+		return;
+
+	GFXVec* attachs = &renderer->backing.attachs;
+
+	for (size_t i = 0; i < attachs->size; ++i)
+	{
+		_GFXAttach* at = gfx_vec_at(attachs, i);
+		if (at->type != _GFX_ATTACH_WINDOW) continue;
+
+		_GFXWindow* window = at->window.window;
+		if (
+			window->vk.swapchain == VK_NULL_HANDLE ||
+			window->frame.present <= latency)
+		{
+			continue;
+		}
+
+		const VkResult result = context->vk.WaitForPresentKHR(
+			context->vk.device, window->vk.swapchain,
+			window->frame.present - latency, _GFX_PACING_TIMEOUT);
+
+		// Out of date will be handled by acquisition, just continue.
+		if (
+			result != VK_SUCCESS && result != VK_TIMEOUT &&
+			result != VK_SUBOPTIMAL_KHR && result != VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			_GFX_VK_CHECK(result, {});
+			gfx_log_warn("Could not wait for a presentation of a window.");
+		}
+	}
+}
+
+/****************************
+ * Retrieves the memory flags to allocate transient memory chunks with.
+ * Only prefers device local memory if the host visible device local heap
+ * is large, otherwise it is left for the resources that need it.
+ * @param renderer Cannot be NULL.
+ */
+static GFXMemoryFlags _gfx_frame_chunk_flags(GFXRenderer* renderer)
+{
+	assert(renderer != NULL);
+
+	VkPhysicalDeviceMemoryProperties pdmp;
+	_groufix.vk.GetPhysicalDeviceMemoryProperties(
+		renderer->heap->allocator.device->vk.device, &pdmp);
+
+	const VkMemoryPropertyFlags bar =
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+		VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+	VkDeviceSize barSize = 0;
+	for (uint32_t t = 0; t < pdmp.memoryTypeCount; ++t)
+		if ((pdmp.memoryTypes[t].propertyFlags & bar) == bar)
+			barSize = GFX_MAX(barSize,
+				pdmp.memoryHeaps[pdmp.memoryTypes[t].heapIndex].size);
+
+	return GFX_MEMORY_HOST_VISIBLE | GFX_MEMORY_WRITE |
+		(barSize > _GFX_FRAME_CHUNK_MAX_BAR_SIZE ?
+			GFX_MEMORY_DEVICE_LOCAL : GFX_MEMORY_NONE);
+}
+
 /****************************/
 GFX_API GFXRenderer* gfx_create_renderer(GFXHeap* heap, unsigned int frames)
 {
@@ -249,17 +402,33 @@ GFX_API GFXRenderer* gfx_create_renderer(GFXHeap* heap, unsigned int frames)
 	_gfx_pick_queue(context, &rend->present, 0, 1);
 	_gfx_pick_queue(context, &rend->compute, VK_QUEUE_COMPUTE_BIT, 0);
 
-	// Initialize the technique/set lock first.
+	_gfx_renderer_init_profile(rend, device);
+
+	rend->pacing.latency = 0;
+	rend->pacing.time = 0;
+	rend->pacing.interval = 0;
+	rend->afr.enabled = 0;
+	rend->afr.next = 0;
+	rend->pacing.stats = (GFXPacingStats){ 0, 0, 0, 0 };
+
+	// Initialize the technique/set lock & compiler first.
 	if (!_gfx_mutex_init(&rend->lock))
 		goto clean;
 
+	if (!_gfx_render_compiler_init(rend))
+	{
+		_gfx_mutex_clear(&rend->lock);
+		goto clean;
+	}
+
 	// Initialize the cache and pool second.
 	if (!_gfx_cache_init(&rend->cache, device, sizeof(_GFXSetEntry)))
 		goto clean_lock;
 
 	// Keep descriptor sets 4x the amount of frames we have.
 	// Offset by 1 to account for the first frame using it.
-	if (!_gfx_pool_init(&rend->pool, device, (frames << 2) + 1))
+	if (!_gfx_pool_init(&rend->pool, device,
+		(frames << 2) + 1, _GFX_POOL_MAX_RECYCLED))
 	{
 		_gfx_cache_clear(&rend->cache);
 		goto clean_cache;
@@ -268,7 +437,13 @@ GFX_API GFXRenderer* gfx_create_renderer(GFXHeap* heap, unsigned int frames)
 	// Then initialize the render backing & graph.
 	// Technically it doesn't matter, but let's do it in dependency order.
 	_gfx_render_backing_init(rend);
-	_gfx_render_graph_init(rend);
+
+	if (!_gfx_render_graph_init(rend))
+	{
+		_gfx_render_backing_clear(rend);
+		_gfx_pool_clear(&rend->pool);
+		goto clean_cache;
+	}
 
 	// And lastly initialize the virtual frames,
 	// Note each index corresponds to their location in memory.
@@ -290,6 +465,8 @@ GFX_API GFXRenderer* gfx_create_renderer(GFXHeap* heap, unsigned int frames)
 	gfx_list_init(&rend->techniques);
 	gfx_list_init(&rend->sets);
 	gfx_deque_init(&rend->stales, sizeof(_GFXStale));
+	rend->staleReady = 0;
+	rend->staleBudget = 0;
 
 	return rend;
 
@@ -302,6 +479,7 @@ clean_renderer:
 clean_cache:
 	_gfx_cache_clear(&rend->cache);
 clean_lock:
+	_gfx_render_compiler_clear(rend);
 	_gfx_mutex_clear(&rend->lock);
 clean:
 	gfx_log_error("Could not create a new renderer.");
@@ -325,6 +503,9 @@ GFX_API void gfx_destroy_renderer(GFXRenderer* renderer)
 	for (size_t f = 0; f < renderer->numFrames; ++f)
 		_gfx_frame_clear(renderer, &renderer->frames[f]);
 
+	// Stop compiling pipelines, before anything gets erased.
+	_gfx_render_compiler_clear(renderer);
+
 	// Erase all recorders, techniques and sets.
 	while (renderer->recorders.head != NULL)
 		gfx_erase_recorder((GFXRecorder*)renderer->recorders.head);
@@ -404,16 +585,201 @@ GFX_API bool gfx_renderer_store_cache(GFXRenderer* renderer,
 	return _gfx_cache_store(&renderer->cache, dst);
 }
 
+/****************************/
+GFX_API bool gfx_renderer_save_cache(GFXRenderer* renderer, const char* path)
+{
+	assert(renderer != NULL);
+	assert(path != NULL);
+
+	return _gfx_cache_save(&renderer->cache, path);
+}
+
+/****************************/
+GFX_API void gfx_renderer_set_profiling(GFXRenderer* renderer, bool enabled)
+{
+	assert(renderer != NULL);
+	assert(!renderer->recording);
+
+	renderer->profile.enabled = enabled;
+}
+
+/****************************/
+GFX_API bool gfx_renderer_is_profiling(GFXRenderer* renderer)
+{
+	assert(renderer != NULL);
+
+	return renderer->profile.enabled;
+}
+
+/****************************/
+GFX_API void gfx_renderer_set_async(GFXRenderer* renderer, bool async)
+{
+	assert(renderer != NULL);
+	assert(!renderer->recording);
+
+	// Stop compiling in the background when disabled.
+	if (!async) _gfx_render_compiler_drain(renderer);
+
+	renderer->compiler.enabled = async;
+}
+
+/****************************/
+GFX_API bool gfx_renderer_is_async(GFXRenderer* renderer)
+{
+	assert(renderer != NULL);
+
+	return renderer->compiler.enabled;
+}
+
+/****************************/
+GFX_API void gfx_renderer_set_live_recreate(GFXRenderer* renderer, bool live)
+{
+	assert(renderer != NULL);
+	assert(!renderer->recording);
+
+	renderer->backing.live = live;
+}
+
+/****************************/
+GFX_API bool gfx_renderer_is_live_recreate(GFXRenderer* renderer)
+{
+	assert(renderer != NULL);
+
+	return renderer->backing.live;
+}
+
+/****************************/
+GFX_API void gfx_renderer_set_latency(GFXRenderer* renderer, unsigned int frames)
+{
+	assert(renderer != NULL);
+	assert(!renderer->recording);
+
+	renderer->pacing.latency = frames;
+}
+
+/****************************/
+GFX_API unsigned int gfx_renderer_get_latency(GFXRenderer* renderer)
+{
+	assert(renderer != NULL);
+
+	return renderer->pacing.latency;
+}
+
+/****************************/
+GFX_API void gfx_renderer_set_destroy_budget(GFXRenderer* renderer,
+                                             unsigned int num)
+{
+	assert(renderer != NULL);
+	assert(!renderer->recording);
+
+	renderer->staleBudget = num;
+}
+
+/****************************/
+GFX_API unsigned int gfx_renderer_get_destroy_budget(GFXRenderer* renderer)
+{
+	assert(renderer != NULL);
+
+	return renderer->staleBudget;
+}
+
+/****************************/
+GFX_API void gfx_renderer_set_interval(GFXRenderer* renderer, uint64_t interval)
+{
+	assert(renderer != NULL);
+	assert(!renderer->recording);
+
+	renderer->pacing.interval = interval;
+}
+
+/****************************/
+GFX_API uint64_t gfx_renderer_get_interval(GFXRenderer* renderer)
+{
+	assert(renderer != NULL);
+
+	return renderer->pacing.interval;
+}
+
+/****************************/
+GFX_API unsigned int gfx_renderer_get_num_devices(GFXRenderer* renderer)
+{
+	assert(renderer != NULL);
+
+	return (unsigned int)renderer->cache.context->numDevices;
+}
+
+/****************************/
+GFX_API void gfx_renderer_set_afr(GFXRenderer* renderer, bool afr)
+{
+	assert(renderer != NULL);
+	assert(!renderer->recording);
+
+	renderer->afr.enabled = afr;
+}
+
+/****************************/
+GFX_API bool gfx_renderer_is_afr(GFXRenderer* renderer)
+{
+	assert(renderer != NULL);
+
+	return renderer->afr.enabled;
+}
+
+/****************************/
+GFX_API void gfx_renderer_get_pacing(GFXRenderer* renderer, GFXPacingStats* stats)
+{
+	assert(renderer != NULL);
+	assert(!renderer->recording);
+	assert(stats != NULL);
+
+	*stats = renderer->pacing.stats;
+}
+
+/****************************/
+GFX_API void gfx_renderer_get_descriptor_stats(GFXRenderer* renderer,
+                                               GFXDescriptorStats* stats)
+{
+	assert(renderer != NULL);
+	assert(!renderer->recording);
+	assert(stats != NULL);
+
+	const _GFXPool* pool = &renderer->pool;
+	const uint32_t* sizes = pool->demand.sizes;
+
+	stats->pools =
+		atomic_load_explicit(&pool->blocks, memory_order_relaxed);
+	stats->maxSets = pool->demand.maxSets;
+
+	stats->samplers = sizes[VK_DESCRIPTOR_TYPE_SAMPLER];
+	stats->combinedImageSamplers = sizes[VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER];
+	stats->sampledImages = sizes[VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE];
+	stats->storageImages = sizes[VK_DESCRIPTOR_TYPE_STORAGE_IMAGE];
+	stats->uniformTexelBuffers = sizes[VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER];
+	stats->storageTexelBuffers = sizes[VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER];
+	stats->uniformBuffers = sizes[VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER];
+	stats->storageBuffers = sizes[VK_DESCRIPTOR_TYPE_STORAGE_BUFFER];
+	stats->dynamicUniformBuffers = sizes[VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC];
+	stats->dynamicStorageBuffers = sizes[VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC];
+	stats->inputAttachments = sizes[VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT];
+}
+
 /****************************/
 GFX_API GFXFrame* gfx_renderer_acquire(GFXRenderer* renderer)
 {
 	assert(renderer != NULL);
 
+	gfx_trace_begin(acquire, "gfx_renderer_acquire");
+
 	// If not submitted yet, force submit.
 	// gfx_frame_submit will also start for us :)
 	if (renderer->public != NULL)
 		gfx_frame_submit(renderer->public);
 
+	// Limit latency before acquiring, so recording and input sampling
+	// happen as late as possible.
+	if (renderer->pacing.latency > 0)
+		_gfx_renderer_pace(renderer);
+
 	// We set the next frame to submit as the publicly accessible frame.
 	// This makes it so _gfx_sync_frames does not block for it anymore!
 	renderer->public = &renderer->frames[renderer->current];
@@ -426,19 +792,44 @@ GFX_API GFXFrame* gfx_renderer_acquire(GFXRenderer* renderer)
 	// Which causes it to fail, as it will only destroy one per frame.
 	_gfx_render_backing_purge(renderer);
 
-	// Destroy all stale resources that were last used by this frame.
-	// All previous frames should have destroyed all indices before the ones
+	// Mark all stale resources that were last used by this frame as ready.
+	// All previous frames should have marked all indices before the ones
 	// with this frame's index.
 	// If they did not, it means a frame was lost, which is fatal anyway.
-	while (renderer->stales.size > 0)
+	while (renderer->staleReady < renderer->stales.size)
 	{
-		_GFXStale* stale = gfx_deque_at(&renderer->stales, 0);
+		_GFXStale* stale =
+			gfx_deque_at(&renderer->stales, renderer->staleReady);
+
 		if (stale->frame != renderer->current) break;
+		++renderer->staleReady;
+	}
+
+	// Then destroy ready stale resources, at most the budget per frame,
+	// the rest is left for the next frames to avoid hitches.
+	size_t destroy = renderer->staleReady;
+	if (renderer->staleBudget > 0)
+		destroy = GFX_MIN(destroy, renderer->staleBudget);
 
-		_gfx_destroy_stale(renderer, stale);
-		gfx_deque_pop_front(&renderer->stales, 1);
+	if (destroy > 0)
+	{
+		for (size_t s = 0; s < destroy; ++s)
+			_gfx_destroy_stale(renderer, gfx_deque_at(&renderer->stales, s));
+
+		gfx_deque_pop_front(&renderer->stales, destroy);
+		renderer->staleReady -= destroy;
+	}
+
+	// Same for swapchains retired while recreating live.
+	for (size_t i = 0; i < renderer->backing.attachs.size; ++i)
+	{
+		_GFXAttach* at = gfx_vec_at(&renderer->backing.attachs, i);
+		if (at->type == _GFX_ATTACH_WINDOW)
+			_gfx_swapchain_purge_frame(at->window.window, renderer->current);
 	}
 
+	gfx_trace_end(acquire);
+
 	return renderer->public;
 }
 
@@ -450,6 +841,19 @@ GFX_API unsigned int gfx_frame_get_index(GFXFrame* frame)
 	return frame->index;
 }
 
+/****************************/
+GFX_API const GFXTiming* gfx_frame_get_timings(GFXFrame* frame,
+                                               size_t* numTimings)
+{
+	assert(frame != NULL);
+	assert(numTimings != NULL);
+
+	*numTimings = frame->timer.timings.size;
+
+	return frame->timer.timings.size > 0 ?
+		gfx_vec_at(&frame->timer.timings, 0) : NULL;
+}
+
 /****************************/
 GFX_API void gfx_frame_start(GFXFrame* frame)
 {
@@ -470,6 +874,150 @@ GFX_API void gfx_frame_start(GFXFrame* frame)
 	}
 }
 
+/****************************/
+GFX_API void* gfx_frame_alloc(GFXFrame* frame,
+                              uint64_t size, uint64_t align, GFXBufferRef* ref)
+{
+	assert(frame != NULL);
+	assert(frame == _GFX_RENDERER_FROM_FRAME(frame)->public);
+	assert(size > 0);
+	assert(align == 0 || GFX_IS_POWER_OF_TWO(align));
+	assert(ref != NULL);
+
+	GFXRenderer* renderer =
+		_GFX_RENDERER_FROM_FRAME(frame);
+
+	align = GFX_MAX(align, 1);
+
+	_gfx_mutex_lock(&frame->ring.lock);
+
+	// Find the first chunk (from the current) that fits the allocation.
+	// Chunks we skip over are left unused until the frame is recycled.
+	_GFXFrameChunk* chunk = NULL;
+	uint64_t offset = 0;
+
+	while (frame->ring.current < frame->ring.chunks.size)
+	{
+		chunk = gfx_vec_at(&frame->ring.chunks, frame->ring.current);
+		offset = GFX_ALIGN_UP(frame->ring.offset, align);
+
+		if (offset + size <= chunk->buffer->size)
+			break;
+
+		chunk = NULL;
+		++frame->ring.current;
+		frame->ring.offset = 0;
+	}
+
+	// Ran out of chunks, allocate a new one.
+	if (chunk == NULL)
+	{
+		const uint64_t chunkSize = GFX_MAX(_GFX_FRAME_CHUNK_SIZE, size);
+
+		GFXBuffer* buffer = gfx_alloc_buffer(renderer->heap,
+			_gfx_frame_chunk_flags(renderer),
+			GFX_BUFFER_VERTEX | GFX_BUFFER_INDEX |
+			GFX_BUFFER_UNIFORM | GFX_BUFFER_STORAGE |
+			GFX_BUFFER_INDIRECT,
+			chunkSize);
+
+		if (buffer == NULL)
+			goto error;
+
+		void* ptr = gfx_map(gfx_ref_buffer(buffer));
+		if (ptr == NULL)
+		{
+			gfx_free_buffer(buffer);
+			goto error;
+		}
+
+		_GFXFrameChunk insert = { .buffer = buffer, .ptr = ptr };
+		if (!gfx_vec_push(&frame->ring.chunks, 1, &insert))
+		{
+			gfx_unmap(gfx_ref_buffer(buffer));
+			gfx_free_buffer(buffer);
+			goto error;
+		}
+
+		frame->ring.current = frame->ring.chunks.size - 1;
+		chunk = gfx_vec_at(&frame->ring.chunks, frame->ring.current);
+		offset = 0;
+	}
+
+	// Bump the ring offset.
+	frame->ring.offset = offset + size;
+
+	*ref = gfx_ref_buffer_at(chunk->buffer, offset);
+	void* ptr = (char*)chunk->ptr + offset;
+
+	_gfx_mutex_unlock(&frame->ring.lock);
+
+	return ptr;
+
+
+	// Error on failure.
+error:
+	_gfx_mutex_unlock(&frame->ring.lock);
+	gfx_log_error("Could not allocate transient memory from virtual frame.");
+
+	return NULL;
+}
+
+/****************************/
+GFX_API bool gfx_frame_read(GFXFrame* frame, size_t index, void* dst,
+                            size_t numDeps, const GFXInject* deps)
+{
+	assert(frame != NULL);
+	assert(frame == _GFX_RENDERER_FROM_FRAME(frame)->public);
+	assert(dst != NULL);
+	assert(numDeps == 0 || deps != NULL);
+
+	GFXRenderer* renderer =
+		_GFX_RENDERER_FROM_FRAME(frame);
+
+	// Check if it is an image attachment.
+	const GFXVec* attachs = &renderer->backing.attachs;
+	if (
+		index >= attachs->size ||
+		((_GFXAttach*)gfx_vec_at(attachs, index))->type != _GFX_ATTACH_IMAGE)
+	{
+		gfx_log_warn(
+			"Cannot read attachment at index %"GFX_PRIs" of a virtual frame, "
+			"it is not an image attachment.",
+			index);
+
+		return 0;
+	}
+
+	// Copy the injections, they must outlive this call.
+	_GFXFrameRead read = {
+		.index = index,
+		.dst = dst,
+		.numDeps = numDeps,
+		.deps = NULL
+	};
+
+	if (numDeps > 0)
+	{
+		read.deps = gfx_arena_alloc(&frame->arena, sizeof(GFXInject) * numDeps);
+		if (read.deps == NULL) goto error;
+
+		memcpy(read.deps, deps, sizeof(GFXInject) * numDeps);
+	}
+
+	if (!gfx_vec_push(&frame->reads.pending, 1, &read))
+		goto error;
+
+	return 1;
+
+
+	// Error on failure.
+error:
+	gfx_log_error("Could not read attachment of virtual frame.");
+
+	return 0;
+}
+
 /****************************/
 GFX_API void gfx_frame_submit(GFXFrame* frame)
 {
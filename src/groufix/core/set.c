@@ -79,7 +79,8 @@ static void _gfx_make_stale(GFXSet* set, bool lock,
 		if (lock) _gfx_mutex_lock(&renderer->lock);
 
 		_gfx_push_stale(renderer,
-			VK_NULL_HANDLE, imageView, bufferView, VK_NULL_HANDLE);
+			VK_NULL_HANDLE, imageView, bufferView,
+			VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE);
 
 		if (lock) _gfx_mutex_unlock(&renderer->lock);
 	}
@@ -163,6 +164,122 @@ static bool _gfx_make_view(_GFXContext* context,
 	return 1;
 }
 
+/****************************
+ * Writes the Vulkan update info of a single entry to the bindless
+ * descriptor set of a set, no-op if the set is not bindless.
+ * Skips the write if the update info still contains empty handles,
+ * bindless bindings are partially bound, so this is fine.
+ */
+static void _gfx_set_write(GFXSet* set,
+                           _GFXSetBinding* binding, _GFXSetEntry* entry)
+{
+	if (set->bindless.pool == VK_NULL_HANDLE)
+		return;
+
+	// Check if the update info is complete.
+	if (
+		(_GFX_DESCRIPTOR_IS_BUFFER(binding->type) &&
+			entry->vk.update.buffer.buffer == VK_NULL_HANDLE) ||
+		(_GFX_DESCRIPTOR_IS_IMAGE(binding->type) &&
+			entry->vk.update.image.imageView == VK_NULL_HANDLE) ||
+		(_GFX_DESCRIPTOR_IS_SAMPLER(binding->type) &&
+			entry->vk.update.image.sampler == VK_NULL_HANDLE) ||
+		(_GFX_DESCRIPTOR_IS_VIEW(binding->type) &&
+			entry->vk.update.view == VK_NULL_HANDLE))
+	{
+		return;
+	}
+
+	_GFXContext* context = set->renderer->cache.context;
+
+	// Bindings are sorted without gaps, so the binding number is its index.
+	VkWriteDescriptorSet wds = {
+		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+
+		.pNext            = NULL,
+		.dstSet           = set->bindless.elem.vk.set,
+		.dstBinding       = (uint32_t)(binding - set->bindings),
+		.dstArrayElement  = (uint32_t)(entry - binding->entries),
+		.descriptorCount  = 1,
+		.descriptorType   = binding->type,
+		.pImageInfo       = &entry->vk.update.image,
+		.pBufferInfo      = &entry->vk.update.buffer,
+		.pTexelBufferView = &entry->vk.update.view
+	};
+
+	context->vk.UpdateDescriptorSets(
+		context->vk.device, 1, &wds, 0, NULL);
+}
+
+/****************************
+ * Creates the Vulkan descriptor pool and allocates the one and only
+ * bindless (update-after-bind) descriptor set of a set.
+ * @return Zero on failure.
+ */
+static bool _gfx_set_alloc_bindless(GFXSet* set)
+{
+	_GFXContext* context = set->renderer->cache.context;
+
+	// Size the pool exactly to the set layout.
+	VkDescriptorPoolSize sizes[_GFX_NUM_DESCRIPTOR_TYPES];
+	uint32_t numSizes = 0;
+
+	for (uint32_t t = 0; t < _GFX_NUM_DESCRIPTOR_TYPES; ++t)
+		if (set->setLayout->descriptors[t] > 0)
+			sizes[numSizes++] = (VkDescriptorPoolSize){
+				.type = (VkDescriptorType)t,
+				.descriptorCount = set->setLayout->descriptors[t]
+			};
+
+	VkDescriptorPoolCreateInfo dpci = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+
+		.pNext         = NULL,
+		.flags         = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+		.maxSets       = 1,
+		.poolSizeCount = numSizes,
+		.pPoolSizes    = sizes
+	};
+
+	_GFX_VK_CHECK(
+		context->vk.CreateDescriptorPool(
+			context->vk.device, &dpci, NULL, &set->bindless.pool),
+		goto error);
+
+	VkDescriptorSetAllocateInfo dsai = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+
+		.pNext              = NULL,
+		.descriptorPool     = set->bindless.pool,
+		.descriptorSetCount = 1,
+		.pSetLayouts        = &set->setLayout->vk.setLayout
+	};
+
+	_GFX_VK_CHECK(
+		context->vk.AllocateDescriptorSets(
+			context->vk.device, &dsai, &set->bindless.elem.vk.set),
+		goto clean);
+
+	// Not part of any block, never recycled.
+	set->bindless.elem.list.next = NULL;
+	set->bindless.elem.list.prev = NULL;
+	set->bindless.elem.block = NULL;
+	atomic_store_explicit(&set->bindless.elem.flushes, 0, memory_order_relaxed);
+
+	return 1;
+
+
+	// Cleanup on failure.
+clean:
+	context->vk.DestroyDescriptorPool(
+		context->vk.device, set->bindless.pool, NULL);
+error:
+	gfx_log_error("Could not allocate a bindless Vulkan descriptor set.");
+	set->bindless.pool = VK_NULL_HANDLE;
+
+	return 0;
+}
+
 /****************************
  * Overwrites the Vulkan update info with the current groufix update info.
  * Assumes all relevant data is initialized and valid.
@@ -273,6 +390,9 @@ static void _gfx_set_update(GFXSet* set,
 			entry->vk.update.view = view;
 		}
 	}
+
+	// Write it to the bindless descriptor set.
+	_gfx_set_write(set, binding, entry);
 }
 
 /****************************
@@ -362,6 +482,9 @@ static void _gfx_set_update_attachs(GFXSet* set)
 				entry->vk.update.image.imageLayout = layout;
 			}
 
+			// Bindless sets are updated in-place.
+			_gfx_set_write(set, binding, entry);
+
 			_gfx_mutex_unlock(&renderer->lock);
 
 			// Early exit when all attachments are found!
@@ -379,6 +502,18 @@ static void _gfx_set_update_attachs(GFXSet* set)
  */
 static void _gfx_set_recycle(GFXSet* set)
 {
+	// Bindless sets are updated in-place, nothing to recycle.
+	// Nor do we invalidate retained recordings.
+	if (set->bindless.pool != VK_NULL_HANDLE)
+		return;
+
+	// Bump the modification generation, invalidating retained recordings.
+	atomic_fetch_add_explicit(&set->gen, 1, memory_order_relaxed);
+
+	// Push descriptor sets are never allocated, nothing to recycle.
+	if (set->push)
+		return;
+
 	// Only recycle if the set has been used & reset used flag.
 	if (atomic_exchange_explicit(&set->used, 0, memory_order_relaxed))
 	{
@@ -407,6 +542,20 @@ static void _gfx_set_recycle(GFXSet* set)
 	}
 }
 
+/****************************
+ * Removes the reference to all buffers referenced by the entries of a set.
+ * @see _gfx_buffer_refer.
+ */
+static void _gfx_set_unpin(GFXSet* set)
+{
+	for (size_t b = 0; b < set->numBindings; ++b)
+	{
+		const _GFXSetBinding* binding = &set->bindings[b];
+		if (binding->entries != NULL) for (size_t e = 0; e < binding->count; ++e)
+			_gfx_buffer_refer(binding->entries[e].ref, NULL, 1);
+	}
+}
+
 /****************************
  * Stand-in function for setting descriptor binding resources of the set.
  * @see gfx_set_resources.
@@ -516,7 +665,10 @@ static bool _gfx_set_resources(GFXSet* set, bool update, bool* changed,
 		if (res->ref.type == GFX_REF_ATTACHMENT) ++set->numAttachs;
 
 		// Set the new reference & update.
+		// Moving the pin on any referenced buffer along.
 		*changed = 1;
+		_gfx_buffer_refer(entry->ref, NULL, 1);
+		_gfx_buffer_refer(res->ref, NULL, 0);
 		entry->ref = res->ref;
 		atomic_store_explicit(&entry->gen, 0, memory_order_relaxed);
 
@@ -842,6 +994,7 @@ static bool _gfx_set_samplers(GFXSet* set, bool update,
 
 		if (update)
 			entry->vk.update.image.sampler = sampler->vk.sampler,
+			_gfx_set_write(set, binding, entry),
 			recycle = 1;
 	}
 
@@ -855,11 +1008,19 @@ static bool _gfx_set_samplers(GFXSet* set, bool update,
 _GFXPoolElem* _gfx_set_get(GFXSet* set, _GFXPoolSub* sub)
 {
 	assert(set != NULL);
+	assert(!set->push);
 	assert(sub != NULL);
 
 	// Update referenced renderer attachments!
 	_gfx_set_update_attachs(set);
 
+	// Bindless sets own their descriptor set.
+	if (set->bindless.pool != VK_NULL_HANDLE)
+	{
+		atomic_store_explicit(&set->used, 1, memory_order_relaxed);
+		return &set->bindless.elem;
+	}
+
 	// Create a set key.
 	_GFXSetKey key;
 	key.len = sizeof(key.bytes);
@@ -878,6 +1039,27 @@ _GFXPoolElem* _gfx_set_get(GFXSet* set, _GFXPoolSub* sub)
 	return elem;
 }
 
+/****************************/
+void _gfx_set_push(GFXSet* set, VkCommandBuffer cmd,
+                   VkDescriptorUpdateTemplate template,
+                   VkPipelineLayout layout, uint32_t index)
+{
+	assert(set != NULL);
+	assert(set->push);
+	assert(set->first != NULL);
+	assert(template != VK_NULL_HANDLE);
+
+	_GFXContext* context = set->renderer->cache.context;
+
+	// Update referenced renderer attachments!
+	_gfx_set_update_attachs(set);
+
+	// The descriptors are copied into the command buffer,
+	// no descriptor set or pool is involved whatsoever.
+	context->vk.CmdPushDescriptorSetWithTemplateKHR(
+		cmd, template, layout, index, &set->first->vk.update);
+}
+
 /****************************/
 GFX_API GFXSet* gfx_renderer_add_set(GFXRenderer* renderer,
                                      GFXTechnique* technique, size_t set,
@@ -925,7 +1107,10 @@ GFX_API GFXSet* gfx_renderer_add_set(GFXRenderer* renderer,
 	aset->numAttachs = 0;
 	aset->numDynamics = 0;
 	aset->numBindings = numBindings;
+	aset->push = _gfx_tech_get_push(technique, set) != VK_NULL_HANDLE;
+	aset->bindless.pool = VK_NULL_HANDLE;
 	atomic_store_explicit(&aset->used, 0, memory_order_relaxed);
+	atomic_store_explicit(&aset->gen, 0, memory_order_relaxed);
 
 	// Get all the bindings.
 	aset->first = numEntries > 0 ?
@@ -951,6 +1136,8 @@ GFX_API GFXSet* gfx_renderer_add_set(GFXRenderer* renderer,
 		}
 
 		binding->entries = entries > 0 ? entryPtr : NULL;
+		binding->next = 0;
+		gfx_vec_init(&binding->free, sizeof(size_t));
 		entryPtr += entries;
 
 		// Initialize entries to empty.
@@ -1014,6 +1201,16 @@ GFX_API GFXSet* gfx_renderer_add_set(GFXRenderer* renderer,
 	if (numSamplers > 0)
 		_gfx_set_samplers(aset, 0, numSamplers, samplers);
 
+	// If bindless, allocate its descriptor set before updating,
+	// so all initial descriptors get written to it.
+	if (_gfx_tech_is_bindless(technique, set))
+		if (!_gfx_set_alloc_bindless(aset))
+		{
+			_gfx_set_unpin(aset);
+			free(aset);
+			goto error;
+		}
+
 	// And then loop over all things to manually update them.
 	// Because all current handles are VK_NULL_HANDLE,
 	// we do not push stales and we're still thread-safe :)
@@ -1059,6 +1256,8 @@ GFX_API void gfx_erase_set(GFXSet* set)
 	for (size_t b = 0; b < set->numBindings; ++b)
 	{
 		_GFXSetBinding* binding = &set->bindings[b];
+		gfx_vec_clear(&binding->free);
+
 		if (binding->entries != NULL) for (size_t e = 0; e < binding->count; ++e)
 		{
 			_GFXSetEntry* entry = &binding->entries[e];
@@ -1069,11 +1268,19 @@ GFX_API void gfx_erase_set(GFXSet* set)
 		}
 	}
 
+	// Make the bindless descriptor pool (and thus its set) stale.
+	if (set->bindless.pool != VK_NULL_HANDLE)
+		_gfx_push_stale(renderer,
+			VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE,
+			VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE,
+			set->bindless.pool);
+
 	_gfx_mutex_unlock(&renderer->lock);
 
 	// And recycle all matching descriptor sets,
 	// none of the resources may be referenced anymore!
 	_gfx_set_recycle(set);
+	_gfx_set_unpin(set);
 
 	free(set);
 }
@@ -1186,3 +1393,85 @@ GFX_API bool gfx_set_samplers(GFXSet* set,
 
 	return _gfx_set_samplers(set, 1, numSamplers, samplers);
 }
+
+/****************************/
+GFX_API size_t gfx_set_claim(GFXSet* set, size_t binding)
+{
+	assert(set != NULL);
+	assert(binding < set->numBindings);
+
+	_GFXSetBinding* bind = &set->bindings[binding];
+
+	// Reuse the most recently released index first.
+	if (bind->free.size > 0)
+	{
+		size_t index = *(size_t*)gfx_vec_at(&bind->free, bind->free.size - 1);
+		gfx_vec_pop(&bind->free, 1);
+
+		return index;
+	}
+
+	// Otherwise take a never claimed index.
+	if (bind->entries == NULL || bind->next >= bind->count)
+	{
+		gfx_log_warn(
+			"Could not claim a descriptor index (binding=%"GFX_PRIs") "
+			"of a set, no indices left.",
+			binding);
+
+		return SIZE_MAX;
+	}
+
+	return bind->next++;
+}
+
+/****************************/
+GFX_API void gfx_set_release(GFXSet* set, size_t binding, size_t index)
+{
+	assert(set != NULL);
+	assert(!set->renderer->recording);
+	assert(binding < set->numBindings);
+	assert(index < set->bindings[binding].next);
+	assert(set->bindings[binding].entries != NULL);
+
+	_GFXSetBinding* bind = &set->bindings[binding];
+	_GFXSetEntry* entry = &bind->entries[index];
+
+	// Clear the entry, making its views stale.
+	// Note we do not write anything to a bindless descriptor set,
+	// the binding is partially bound, it may not be accessed anymore.
+	if (entry->ref.type == GFX_REF_ATTACHMENT) --set->numAttachs;
+
+	_gfx_buffer_refer(entry->ref, NULL, 1);
+	entry->ref = GFX_REF_NULL;
+	atomic_store_explicit(&entry->gen, 0, memory_order_relaxed);
+
+	if (_GFX_DESCRIPTOR_IS_BUFFER(bind->type))
+		entry->vk.update.buffer.buffer = VK_NULL_HANDLE;
+
+	else if (_GFX_DESCRIPTOR_IS_IMAGE(bind->type))
+	{
+		_gfx_make_stale(set, 1, entry->vk.update.image.imageView, VK_NULL_HANDLE);
+		entry->vk.update.image.imageView = VK_NULL_HANDLE;
+		entry->vk.update.image.imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	}
+
+	else if (_GFX_DESCRIPTOR_IS_VIEW(bind->type))
+	{
+		_gfx_make_stale(set, 1, VK_NULL_HANDLE, entry->vk.update.view);
+		entry->vk.update.view = VK_NULL_HANDLE;
+	}
+
+	// Give the index back, shrink the never claimed range if we can.
+	if (index + 1 == bind->next)
+		--bind->next;
+	else if (!gfx_vec_push(&bind->free, 1, &index))
+		gfx_log_warn(
+			"Could not release a descriptor index (binding=%"GFX_PRIs", "
+			"index=%"GFX_PRIs") of a set, index is lost.",
+			binding, index);
+
+	// Non-bindless sets must be recycled, we may not reference
+	// the view anymore.
+	_gfx_set_recycle(set);
+}
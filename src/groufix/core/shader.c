@@ -10,10 +10,32 @@
 #include "shaderc/shaderc.h"
 #include "spirv_cross_c.h"
 #include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 
+// Shader cache file magic & version, bump the version on format changes.
+#define _GFX_SHADER_CACHE_MAGIC "GFXSHDRC"
+#define _GFX_SHADER_CACHE_VERSION 1
+
+// Minimum number of shaders compiled by a single worker.
+#define _GFX_COMPILE_MIN_SHADERS 2
+
+// Maximum number of workers compiling a single batch.
+#define _GFX_COMPILE_MAX_WORKERS 64
+
+// Reflection blob magic & version, bump the version on format changes.
+#define _GFX_SHADER_REFLECT_MAGIC "GFXSHDRR"
+#define _GFX_SHADER_REFLECT_VERSION 1
+
+
+/****************************
+ * Next shader cache temporary file id (within this process).
+ */
+static atomic_uintmax_t _gfx_shader_cache_tmp = 0;
+
+
 #define _GFX_GET_LANGUAGE_STRING(language) \
 	((language) == GFX_GLSL ? "glsl" : \
 	(language) == GFX_HLSL ? "hlsl" : "*")
@@ -77,6 +99,36 @@
 	} while (0)
 
 
+/****************************
+ * Includer wrapper for shaderc, optionally records all resolved includes.
+ * Recorded as { uint32_t nameLen, name, uint64_t len, content }.
+ */
+typedef struct _GFXShaderIncluder
+{
+	const GFXIncluder* inc;
+	GFXVec*            record; // Stores char, may be NULL.
+	uint32_t           numIncludes;
+	bool               failed; // Failed to record.
+
+} _GFXShaderIncluder;
+
+
+/****************************
+ * Batch of shaders to compile in parallel, shared by all workers.
+ */
+typedef struct _GFXCompileBatch
+{
+	size_t            numShaders;
+	GFXShaderCompile* shaders;
+	bool              optimize;
+	const char*       cache;
+
+	atomic_size_t next; // Next shader to compile.
+	atomic_bool   success;
+
+} _GFXCompileBatch;
+
+
 /****************************
  * Default shaderc include error.
  */
@@ -106,7 +158,8 @@ static shaderc_include_result* _gfx_shaderc_resolve(void* ptr, const char* req,
                                                     int type, const char* src,
                                                     size_t depth)
 {
-	const GFXIncluder* inc = ptr;
+	_GFXShaderIncluder* sInc = ptr;
+	const GFXIncluder* inc = sInc->inc;
 
 	// Allocate new source name so we can return it.
 	const size_t sourceLen = strlen(req);
@@ -171,6 +224,24 @@ static shaderc_include_result* _gfx_shaderc_resolve(void* ptr, const char* req,
 	// Release the stream & output.
 	gfx_io_release(inc, str);
 
+	// Record it for the shader cache.
+	if (sInc->record != NULL && !sInc->failed)
+	{
+		const uint32_t nameLen = (uint32_t)sourceLen;
+		const uint64_t contentLen = (uint64_t)len;
+
+		if (
+			!gfx_vec_push(sInc->record, sizeof(nameLen), &nameLen) ||
+			!gfx_vec_push(sInc->record, sourceLen, sourceName) ||
+			!gfx_vec_push(sInc->record, sizeof(contentLen), &contentLen) ||
+			!gfx_vec_push(sInc->record, (size_t)len, content))
+		{
+			sInc->failed = 1;
+		}
+		else
+			++sInc->numIncludes;
+	}
+
 	result->source_name = sourceName;
 	result->source_name_length = sourceLen;
 	result->content = content;
@@ -226,9 +297,10 @@ static void _gfx_reflect_resource(GFXShader* shader, spvc_compiler compiler,
 	if (hasLocation)
 	{
 		// Get location of vertex input or fragment output.
-		// Leave binding undefined.
+		// Binding is meaningless, but zero it for serialization.
 		out->location = spvc_compiler_get_decoration(
 			compiler, in->id, SpvDecorationLocation);
+		out->binding = 0;
 	}
 	else
 	{
@@ -269,7 +341,9 @@ static void _gfx_reflect_resource(GFXShader* shader, spvc_compiler compiler,
 	const spvc_bool array = isImage ?
 		spvc_type_get_image_arrayed(hBaseType) : SPVC_FALSE;
 
-	// View type.
+	// View type, default for serialization.
+	out->viewType = GFX_VIEW_2D;
+
 	switch (imageDim)
 	{
 	case SpvDim1D:
@@ -509,7 +583,9 @@ static bool _gfx_shader_reflect(GFXShader* shader,
 		{
 			_GFXShaderResource* out = rList + (rInd++);
 			out->id = consts[i].constant_id;
+			out->binding = 0;
 			out->count = 1;
+			out->viewType = GFX_VIEW_2D;
 			out->type = _GFX_SHADER_CONSTANT;
 		}
 
@@ -563,12 +639,15 @@ error:
 /****************************
  * Creates a new shader module & metadata to actually use.
  * shader->vk.module must be NULL, no prior shader module must be created.
- * @param shader Cannot be NULL.
- * @param size   Must be a multiple of sizeof(uint32_t).
+ * @param shader  Cannot be NULL.
+ * @param size    Must be a multiple of sizeof(uint32_t).
+ * @param reflect Zero if shader->reflect.* is already populated.
  * @return Zero on failure.
+ *
+ * Reflection data is cleaned on failure, even if not reflected here.
  */
 static bool _gfx_shader_build(GFXShader* shader,
-                              size_t size, const uint32_t* code)
+                              size_t size, const uint32_t* code, bool reflect)
 {
 	static_assert(sizeof(uint32_t) == 4, "SPIR-V words must be 4 bytes.");
 
@@ -579,7 +658,7 @@ static bool _gfx_shader_build(GFXShader* shader,
 	_GFXContext* context = shader->context;
 
 	// First perform reflection.
-	if (!_gfx_shader_reflect(shader, size, code))
+	if (reflect && !_gfx_shader_reflect(shader, size, code))
 		goto clean_reflect;
 
 	// Then create the Vulkan shader module.
@@ -601,6 +680,10 @@ static bool _gfx_shader_build(GFXShader* shader,
 			goto clean_reflect;
 		});
 
+	// Remember what bytecode we built.
+	shader->codeSize = size;
+	shader->codeHash = (uint32_t)_gfx_hash_murmur3_bytes(size, code);
+
 	// Victory log!
 	gfx_log_debug(
 		"Successfully loaded %s shader:\n"
@@ -651,6 +734,464 @@ static inline uintptr_t _gfx_shader_handle(_GFXContext* context)
 	return handle;
 }
 
+/****************************
+ * Pulls a number of bytes from serialized data.
+ * @param ptr Current read position, advanced on success.
+ * @return Zero if out of bounds.
+ */
+static bool _gfx_shader_pull(const char** ptr, const char* end,
+                             void* out, size_t size)
+{
+	if ((size_t)(end - *ptr) < size)
+		return 0;
+
+	memcpy(out, *ptr, size);
+	*ptr += size;
+
+	return 1;
+}
+
+/****************************
+ * Serializes the reflection metadata of a shader into a vector.
+ * @param out Stores char, data is appended.
+ * @return Zero on failure.
+ */
+static bool _gfx_shader_push_reflect(GFXShader* shader, GFXVec* out)
+{
+	const uint64_t counts[] = {
+		shader->reflect.locations,
+		shader->reflect.sets,
+		shader->reflect.bindings,
+		shader->reflect.constants
+	};
+
+	if (
+		!gfx_vec_push(out, sizeof(uint32_t), &shader->reflect.push) ||
+		!gfx_vec_push(out, sizeof(counts), counts))
+	{
+		return 0;
+	}
+
+	const size_t numResources =
+		shader->reflect.locations +
+		shader->reflect.bindings +
+		shader->reflect.constants;
+
+	for (size_t r = 0; r < numResources; ++r)
+	{
+		const _GFXShaderResource* res = shader->reflect.resources + r;
+		const uint32_t fields[] = {
+			res->location, // Union with set & id.
+			res->binding,
+			(uint32_t)res->viewType,
+			(uint32_t)res->type
+		};
+
+		const uint64_t count = res->count;
+
+		if (
+			!gfx_vec_push(out, sizeof(fields), fields) ||
+			!gfx_vec_push(out, sizeof(count), &count))
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/****************************
+ * Deserializes reflection metadata into a shader.
+ * shader->reflect.* must be 0/NULL, no prior reflection must be performed.
+ * @param ptr Current read position, advanced on success.
+ * @return Zero on failure, shader->reflect is left untouched.
+ */
+static bool _gfx_shader_pull_reflect(GFXShader* shader,
+                                     const char** ptr, const char* end)
+{
+	assert(shader->reflect.resources == NULL);
+
+	uint32_t push;
+	uint64_t counts[4];
+
+	if (
+		!_gfx_shader_pull(ptr, end, &push, sizeof(push)) ||
+		!_gfx_shader_pull(ptr, end, counts, sizeof(counts)))
+	{
+		return 0;
+	}
+
+	// Validate against the remaining data before allocating anything.
+	const size_t resSize = sizeof(uint32_t) * 4 + sizeof(uint64_t);
+	const uint64_t numResources = counts[0] + counts[2] + counts[3];
+
+	if (
+		counts[0] > SIZE_MAX || counts[2] > SIZE_MAX || counts[3] > SIZE_MAX ||
+		numResources > (uint64_t)(end - *ptr) / resSize)
+	{
+		return 0;
+	}
+
+	_GFXShaderResource* rList = NULL;
+	if (numResources > 0)
+	{
+		rList = malloc(sizeof(_GFXShaderResource) * (size_t)numResources);
+		if (rList == NULL) return 0;
+	}
+
+	for (size_t r = 0; r < (size_t)numResources; ++r)
+	{
+		uint32_t fields[4];
+		uint64_t count;
+
+		_gfx_shader_pull(ptr, end, fields, sizeof(fields));
+		_gfx_shader_pull(ptr, end, &count, sizeof(count));
+
+		if (fields[3] > _GFX_SHADER_CONSTANT)
+		{
+			free(rList);
+			return 0;
+		}
+
+		rList[r].location = fields[0];
+		rList[r].binding = fields[1];
+		rList[r].viewType = (GFXViewType)fields[2];
+		rList[r].type = fields[3];
+		rList[r].count = (size_t)count;
+	}
+
+	shader->reflect.push = push;
+	shader->reflect.locations = (size_t)counts[0];
+	shader->reflect.sets = (size_t)counts[1];
+	shader->reflect.bindings = (size_t)counts[2];
+	shader->reflect.constants = (size_t)counts[3];
+	shader->reflect.resources = rList;
+
+	return 1;
+}
+
+/****************************
+ * Builds the shader cache key of a shader compilation, being everything
+ * that influences its output except for the includes.
+ * @param key Output vector, stores char, must be cleared on success.
+ * @return Zero on failure.
+ */
+static bool _gfx_shader_cache_key(GFXShader* shader, GFXShaderLanguage language,
+                                  bool optimize,
+                                  size_t len, const char* source, GFXVec* key)
+{
+	// Compiler version.
+	unsigned int spvVersion = 0, spvRevision = 0;
+	shaderc_get_spv_version(&spvVersion, &spvRevision);
+
+	// When optimizing, the GPU limits are used, so key on the GPU itself.
+	VkPhysicalDeviceProperties pdp = {
+		.vendorID = 0,
+		.deviceID = 0,
+		.driverVersion = 0
+	};
+
+	if (optimize)
+		_groufix.vk.GetPhysicalDeviceProperties(shader->device->vk.device, &pdp);
+
+	const uint32_t header[] = {
+		_GFX_SHADER_CACHE_VERSION,
+		(uint32_t)shader->stage,
+		(uint32_t)language,
+		optimize ? 1 : 0,
+		(uint32_t)spvVersion,
+		(uint32_t)spvRevision,
+		shader->device->api,
+#if defined (NDEBUG)
+		0,
+#else
+		1, // With debug info.
+#endif
+		pdp.vendorID,
+		pdp.deviceID,
+		pdp.driverVersion
+	};
+
+	gfx_vec_init(key, sizeof(char));
+
+	if (
+		!gfx_vec_push(key, sizeof(header), header) ||
+		!gfx_vec_push(key, len, source))
+	{
+		gfx_vec_clear(key);
+		return 0;
+	}
+
+	return 1;
+}
+
+/****************************
+ * Computes the shader cache file path of a shader cache key.
+ * @return Must call free() on success, NULL on failure.
+ */
+static char* _gfx_shader_cache_path(const char* cache, GFXVec* key)
+{
+	const uint32_t hash = (uint32_t)_gfx_hash_murmur3_bytes(
+		key->size, gfx_vec_at(key, 0));
+
+	// Room for a separator, the hash and the extension.
+	const size_t len = strlen(cache);
+	const bool sep =
+		len > 0 && cache[len-1] != '/' && cache[len-1] != '\\';
+
+	char* path = malloc(len + 1 + 8 + 5 + 1);
+	if (path == NULL) return NULL;
+
+	sprintf(path, "%s%s%08"PRIx32".gfxs", cache, sep ? "/" : "", hash);
+	return path;
+}
+
+/****************************
+ * Checks whether an include still resolves to the given content.
+ * @return Non-zero if it matches.
+ */
+static bool _gfx_shader_cache_match(const GFXIncluder* inc, const char* name,
+                                    uint64_t len, const char* content)
+{
+	if (inc == NULL)
+		return 0;
+
+	const GFXReader* str = gfx_io_resolve(inc, name);
+	if (str == NULL)
+		return 0;
+
+	bool match = 0;
+	const long long sLen = gfx_io_len(str);
+
+	if (sLen > 0 && (uint64_t)sLen == len)
+	{
+		// Read directly if we can.
+		const void* data = gfx_io_data(str);
+		if (data != NULL)
+			match = memcmp(data, content, (size_t)len) == 0;
+		else
+		{
+			void* buf = malloc((size_t)len);
+			if (buf != NULL)
+				match =
+					gfx_io_read(str, buf, (size_t)len) == sLen &&
+					memcmp(buf, content, (size_t)len) == 0;
+
+			free(buf);
+		}
+	}
+
+	gfx_io_release(inc, str);
+	return match;
+}
+
+/****************************
+ * Attempts to build a shader from a shader cache file.
+ * @param key Key as built by _gfx_shader_cache_key.
+ * @return Zero on a miss or failure, the shader is left untouched.
+ */
+static bool _gfx_shader_cache_load(GFXShader* shader, const char* path,
+                                   GFXVec* key, const GFXIncluder* inc,
+                                   const GFXWriter* out)
+{
+	GFXMappedFile file;
+	if (!gfx_mapped_file_init(&file, path))
+		return 0;
+
+	const char* ptr = gfx_io_data(&file.reader);
+	const char* end = ptr + file.len;
+
+	// Check the magic and the entire key.
+	char magic[sizeof(_GFX_SHADER_CACHE_MAGIC) - 1];
+	uint32_t keyLen;
+
+	if (
+		!_gfx_shader_pull(&ptr, end, magic, sizeof(magic)) ||
+		memcmp(magic, _GFX_SHADER_CACHE_MAGIC, sizeof(magic)) != 0 ||
+		!_gfx_shader_pull(&ptr, end, &keyLen, sizeof(keyLen)) ||
+		keyLen != key->size || (size_t)(end - ptr) < keyLen ||
+		memcmp(ptr, gfx_vec_at(key, 0), keyLen) != 0)
+	{
+		goto miss;
+	}
+
+	ptr += keyLen;
+
+	// Check that all includes are unmodified.
+	uint32_t numIncludes;
+	if (!_gfx_shader_pull(&ptr, end, &numIncludes, sizeof(numIncludes)))
+		goto miss;
+
+	for (uint32_t i = 0; i < numIncludes; ++i)
+	{
+		uint32_t nameLen;
+		uint64_t len;
+
+		if (
+			!_gfx_shader_pull(&ptr, end, &nameLen, sizeof(nameLen)) ||
+			(size_t)(end - ptr) < nameLen)
+		{
+			goto miss;
+		}
+
+		char* name = malloc((size_t)nameLen + 1);
+		if (name == NULL) goto miss;
+
+		memcpy(name, ptr, nameLen);
+		name[nameLen] = '\0';
+		ptr += nameLen;
+
+		const bool match =
+			_gfx_shader_pull(&ptr, end, &len, sizeof(len)) &&
+			(uint64_t)(end - ptr) >= len &&
+			_gfx_shader_cache_match(inc, name, len, ptr);
+
+		free(name);
+		if (!match) goto miss;
+
+		ptr += len;
+	}
+
+	// Get reflection metadata.
+	if (!_gfx_shader_pull_reflect(shader, &ptr, end))
+		goto miss;
+
+	// And lastly the SPIR-V bytecode, copy it so it is aligned.
+	uint64_t size;
+	if (
+		!_gfx_shader_pull(&ptr, end, &size, sizeof(size)) ||
+		(uint64_t)(end - ptr) < size || size == 0 ||
+		size % sizeof(uint32_t) != 0)
+	{
+		goto clean_reflect;
+	}
+
+	uint32_t* code = malloc((size_t)size);
+	if (code == NULL) goto clean_reflect;
+
+	memcpy(code, ptr, (size_t)size);
+	gfx_mapped_file_clear(&file);
+
+	// Stream out the SPIR-V bytecode, as if compiled.
+	if (out != NULL && gfx_io_write(out, code, (size_t)size) > 0)
+		gfx_log_info(
+			"Written SPIR-V to stream (%"PRIu64" bytes).",
+			size);
+
+	// Build the module without reflecting, cleans reflection on failure.
+	const bool built = _gfx_shader_build(shader, (size_t)size, code, 0);
+	free(code);
+
+	if (built) gfx_log_debug(
+		"Loaded %s shader from shader cache: %s.",
+		_GFX_GET_STAGE_STRING(shader->stage), path);
+
+	return built;
+
+
+	// Cleanup on miss.
+clean_reflect:
+	free(shader->reflect.resources);
+
+	shader->reflect.push = 0;
+	shader->reflect.locations = 0;
+	shader->reflect.sets = 0;
+	shader->reflect.bindings = 0;
+	shader->reflect.constants = 0;
+	shader->reflect.resources = NULL;
+miss:
+	gfx_mapped_file_clear(&file);
+
+	return 0;
+}
+
+/****************************
+ * Stores a built shader in a shader cache file.
+ * @param key  Key as built by _gfx_shader_cache_key.
+ * @param sInc Includer wrapper that recorded all includes.
+ *
+ * Failure is logged as a warning, the shader itself is fine.
+ */
+static void _gfx_shader_cache_store(GFXShader* shader, const char* path,
+                                    GFXVec* key, const _GFXShaderIncluder* sInc,
+                                    size_t size, const char* bytes)
+{
+	if (sInc->failed || key->size > UINT32_MAX)
+		goto error;
+
+	// Serialize everything in memory first.
+	GFXVec data;
+	gfx_vec_init(&data, sizeof(char));
+
+	const uint32_t keyLen = (uint32_t)key->size;
+	const uint64_t spvSize = size;
+
+	if (
+		!gfx_vec_push(&data,
+			sizeof(_GFX_SHADER_CACHE_MAGIC) - 1, _GFX_SHADER_CACHE_MAGIC) ||
+		!gfx_vec_push(&data, sizeof(keyLen), &keyLen) ||
+		!gfx_vec_push(&data, key->size, gfx_vec_at(key, 0)) ||
+		!gfx_vec_push(&data, sizeof(sInc->numIncludes), &sInc->numIncludes) ||
+		(sInc->record->size > 0 && !gfx_vec_push(&data,
+			sInc->record->size, gfx_vec_at(sInc->record, 0))) ||
+		!_gfx_shader_push_reflect(shader, &data) ||
+		!gfx_vec_push(&data, sizeof(spvSize), &spvSize) ||
+		!gfx_vec_push(&data, size, bytes))
+	{
+		gfx_vec_clear(&data);
+		goto error;
+	}
+
+	// Write to a temporary file first, then move it into place,
+	// so other processes never see a partially written file.
+	// Its name is unique to this process & save, so concurrent saves
+	// (from any process) never write to the same temporary file.
+	// We use a scope here so the gotos above are allowed.
+	{
+		char tmp[strlen(path) + 48];
+		sprintf(tmp, "%s.%"PRIuMAX".%"PRIuMAX".tmp",
+			path, _gfx_process_id(), atomic_fetch_add(&_gfx_shader_cache_tmp, 1));
+
+		GFXFile file;
+		bool written = gfx_file_init(&file, tmp, "wb");
+
+		if (written)
+			written =
+				gfx_io_write(&file.writer,
+					gfx_vec_at(&data, 0), data.size) == (long long)data.size;
+
+		gfx_file_clear(&file);
+		gfx_vec_clear(&data);
+
+		// Rename may not overwrite on all platforms,
+		// only remove the old file if it did not.
+		if (written && rename(tmp, path) != 0)
+		{
+			remove(path);
+			written = rename(tmp, path) == 0;
+		}
+
+		if (!written)
+		{
+			remove(tmp);
+			goto error;
+		}
+	}
+
+	gfx_log_debug(
+		"Written %s shader to shader cache: %s.",
+		_GFX_GET_STAGE_STRING(shader->stage), path);
+
+	return;
+
+
+	// Warn on failure.
+error:
+	gfx_log_warn(
+		"Could not write %s shader to shader cache: %s.",
+		_GFX_GET_STAGE_STRING(shader->stage), path);
+}
+
 /****************************/
 GFX_API GFXShader* gfx_create_shader(GFXShaderStage stage, GFXDevice* device)
 {
@@ -668,6 +1209,8 @@ GFX_API GFXShader* gfx_create_shader(GFXShaderStage stage, GFXDevice* device)
 
 	shader->handle = _gfx_shader_handle(shader->context);
 	shader->stage = stage;
+	shader->codeSize = 0;
+	shader->codeHash = 0;
 	shader->vk.module = VK_NULL_HANDLE;
 
 	shader->reflect.push = 0;
@@ -715,11 +1258,17 @@ GFX_API GFXDevice* gfx_shader_get_device(GFXShader* shader)
 	return (GFXDevice*)shader->device;
 }
 
-/****************************/
-GFX_API bool gfx_shader_compile(GFXShader* shader, GFXShaderLanguage language,
+/****************************
+ * Stand-in function for compiling a shader.
+ * @see gfx_shader_compile_cached.
+ * @param shared Compiler to (re)use, NULL to create one for this shader.
+ */
+static bool _gfx_shader_compile(GFXShader* shader, GFXShaderLanguage language,
                                 bool optimize,
                                 const GFXReader* src, const GFXIncluder* inc,
-                                const GFXWriter* out, const GFXWriter* err)
+                                const char* cache,
+                                const GFXWriter* out, const GFXWriter* err,
+                                shaderc_compiler_t shared)
 {
 	assert(shader != NULL);
 	assert(src != NULL);
@@ -762,11 +1311,38 @@ GFX_API bool gfx_shader_compile(GFXShader* shader, GFXShaderLanguage language,
 		goto clean;
 	}
 
+	// Try the shader cache first.
+	GFXVec key;
+	GFXVec record;
+	char* path = NULL;
+
+	gfx_vec_init(&key, sizeof(char));
+	gfx_vec_init(&record, sizeof(char));
+
+	if (cache != NULL)
+	{
+		if (_gfx_shader_cache_key(
+			shader, language, optimize, (size_t)len, source, &key))
+		{
+			path = _gfx_shader_cache_path(cache, &key);
+		}
+
+		if (path != NULL &&
+			_gfx_shader_cache_load(shader, path, &key, inc, out))
+		{
+			free(path);
+			gfx_vec_clear(&key);
+			free(source);
+
+			return 1;
+		}
+	}
+
 	// Create compiler and compile options.
-	// We create new resources for every shader,
+	// We create new resources for every shader (unless given a compiler),
 	// this presumably makes it pretty much thread-safe.
-	shaderc_compiler_t compiler =
-		shaderc_compiler_initialize();
+	shaderc_compiler_t compiler = shared != NULL ?
+		shared : shaderc_compiler_initialize();
 	shaderc_compile_options_t options =
 		shaderc_compile_options_initialize();
 
@@ -798,12 +1374,20 @@ GFX_API bool gfx_shader_compile(GFXShader* shader, GFXShaderLanguage language,
 #endif
 
 	// Set includer callbacks if an includer is given.
+	// Record all includes if we want to store it in the cache.
+	_GFXShaderIncluder sInc = {
+		.inc = inc,
+		.record = path != NULL ? &record : NULL,
+		.numIncludes = 0,
+		.failed = 0
+	};
+
 	if (inc != NULL)
 		shaderc_compile_options_set_include_callbacks(
 			options,
 			_gfx_shaderc_resolve,
 			_gfx_shaderc_release,
-			(GFXIncluder*)inc);
+			&sInc);
 
 	// Add all these options only if we compile for this specific platform.
 	// This will enable optimization for the target API and GPU limits.
@@ -916,7 +1500,7 @@ GFX_API bool gfx_shader_compile(GFXShader* shader, GFXShaderLanguage language,
 			size);
 
 	// Lastly, attempt to build the shader module.
-	if (!_gfx_shader_build(shader, wordSize, (const uint32_t*)bytes))
+	if (!_gfx_shader_build(shader, wordSize, (const uint32_t*)bytes, 1))
 	{
 		gfx_log_error(
 			"Failed to load compiled %s shader.",
@@ -925,11 +1509,18 @@ GFX_API bool gfx_shader_compile(GFXShader* shader, GFXShaderLanguage language,
 		goto clean_result;
 	}
 
+	// And store it in the cache for next time.
+	if (path != NULL)
+		_gfx_shader_cache_store(shader, path, &key, &sInc, wordSize, bytes);
+
 	// Get rid of the resources and return.
 	shaderc_result_release(result);
-	shaderc_compiler_release(compiler);
+	if (shared == NULL) shaderc_compiler_release(compiler);
 	shaderc_compile_options_release(options);
 
+	free(path);
+	gfx_vec_clear(&key);
+	gfx_vec_clear(&record);
 	free(source);
 
 	return 1;
@@ -939,16 +1530,194 @@ GFX_API bool gfx_shader_compile(GFXShader* shader, GFXShaderLanguage language,
 clean_result:
 	shaderc_result_release(result);
 clean_compiler:
-	shaderc_compiler_release(compiler);
+	if (shared == NULL) shaderc_compiler_release(compiler);
 	shaderc_compile_options_release(options);
+
+	free(path);
+	gfx_vec_clear(&key);
+	gfx_vec_clear(&record);
 clean:
 	free(source);
 
 	return 0;
 }
 
+/****************************/
+GFX_API bool gfx_shader_compile(GFXShader* shader, GFXShaderLanguage language,
+                                bool optimize,
+                                const GFXReader* src, const GFXIncluder* inc,
+                                const GFXWriter* out, const GFXWriter* err)
+{
+	// Relies on stand-in function for asserts.
+
+	return _gfx_shader_compile(
+		shader, language, optimize, src, inc, NULL, out, err, NULL);
+}
+
+/****************************/
+GFX_API bool gfx_shader_compile_cached(GFXShader* shader,
+                                       GFXShaderLanguage language,
+                                       bool optimize,
+                                       const GFXReader* src,
+                                       const GFXIncluder* inc,
+                                       const char* cache,
+                                       const GFXWriter* out,
+                                       const GFXWriter* err)
+{
+	// Relies on stand-in function for asserts.
+
+	return _gfx_shader_compile(
+		shader, language, optimize, src, inc, cache, out, err, NULL);
+}
+
+/****************************
+ * Job entry point, compiles shaders of a batch until none are left,
+ * sets `success` of the batch to zero on failure.
+ */
+static void _gfx_compile_worker(void* arg)
+{
+	_GFXCompileBatch* batch = arg;
+
+	// Initialize one compiler for the entire job,
+	// if this fails, each shader just creates its own.
+	shaderc_compiler_t compiler = shaderc_compiler_initialize();
+
+	// Keep grabbing the next shader, to balance the load.
+	while (1)
+	{
+		const size_t i =
+			atomic_fetch_add_explicit(&batch->next, 1, memory_order_relaxed);
+
+		if (i >= batch->numShaders)
+			break;
+
+		GFXShaderCompile* comp = batch->shaders + i;
+		comp->success = _gfx_shader_compile(
+			comp->shader, comp->language, batch->optimize,
+			comp->src, comp->inc, batch->cache,
+			comp->out, comp->err, compiler);
+
+		if (!comp->success)
+			atomic_store_explicit(&batch->success, 0, memory_order_relaxed);
+	}
+
+	if (compiler != NULL)
+		shaderc_compiler_release(compiler);
+}
+
+/****************************/
+GFX_API bool gfx_shader_compile_batch(size_t numShaders,
+                                      GFXShaderCompile* shaders,
+                                      bool optimize, const char* cache)
+{
+	assert(numShaders == 0 || shaders != NULL);
+
+	if (numShaders == 0) return 1;
+
+	// Compile all shaders, spread over all workers.
+	// This thread acts as the first worker.
+	_GFXCompileBatch batch = {
+		.numShaders = numShaders,
+		.shaders = shaders,
+		.optimize = optimize,
+		.cache = cache
+	};
+
+	atomic_store_explicit(&batch.next, 0, memory_order_relaxed);
+	atomic_store_explicit(&batch.success, 1, memory_order_relaxed);
+
+	const size_t numWorkers = GFX_MAX(1, GFX_MIN(
+		_gfx_jobs_concurrency(),
+		GFX_MIN(_GFX_COMPILE_MAX_WORKERS, numShaders / _GFX_COMPILE_MIN_SHADERS)));
+
+	_GFXJobCounter counter;
+	_gfx_job_counter(&counter, NULL);
+
+	_GFXJob jobs[numWorkers];
+
+	for (size_t w = 0; w < numWorkers; ++w)
+		jobs[w] = (_GFXJob){ .func = _gfx_compile_worker, .arg = &batch };
+
+	_gfx_jobs_submit(&counter, numWorkers - 1, jobs + 1);
+	_gfx_compile_worker(&batch);
+	_gfx_jobs_wait(&counter);
+
+	if (!atomic_load_explicit(&batch.success, memory_order_relaxed))
+	{
+		gfx_log_error("Could not compile batch; not all shaders compiled.");
+		return 0;
+	}
+
+	return 1;
+}
+
+/****************************
+ * Reads a reflection blob into a shader, validating it against the
+ * SPIR-V bytecode it is going to be built with.
+ * shader->reflect.* must be 0/NULL, no prior reflection must be performed.
+ * @return Zero on failure or mismatch, shader->reflect is left untouched.
+ */
+static bool _gfx_shader_read_reflect(GFXShader* shader, const GFXReader* src,
+                                     size_t size, const uint32_t* code)
+{
+	// Read the blob, directly if we can.
+	const long long len = gfx_io_len(src);
+	if (len <= 0) return 0;
+
+	const char* data = gfx_io_data(src);
+	char* buf = NULL;
+
+	if (data == NULL)
+	{
+		buf = malloc((size_t)len);
+		if (buf == NULL) return 0;
+
+		if (gfx_io_read(src, buf, (size_t)len) != len)
+		{
+			free(buf);
+			return 0;
+		}
+
+		data = buf;
+	}
+
+	const char* ptr = data;
+	const char* end = data + len;
+
+	// Check header & bytecode identity.
+	char magic[sizeof(_GFX_SHADER_REFLECT_MAGIC) - 1];
+	uint32_t version, stage, hash;
+	uint64_t codeSize;
+
+	const bool valid =
+		_gfx_shader_pull(&ptr, end, magic, sizeof(magic)) &&
+		memcmp(magic, _GFX_SHADER_REFLECT_MAGIC, sizeof(magic)) == 0 &&
+		_gfx_shader_pull(&ptr, end, &version, sizeof(version)) &&
+		version == _GFX_SHADER_REFLECT_VERSION &&
+		_gfx_shader_pull(&ptr, end, &stage, sizeof(stage)) &&
+		stage == (uint32_t)shader->stage &&
+		_gfx_shader_pull(&ptr, end, &codeSize, sizeof(codeSize)) &&
+		codeSize == size &&
+		_gfx_shader_pull(&ptr, end, &hash, sizeof(hash)) &&
+		hash == (uint32_t)_gfx_hash_murmur3_bytes(size, code) &&
+		_gfx_shader_pull_reflect(shader, &ptr, end);
+
+	free(buf);
+	return valid;
+}
+
 /****************************/
 GFX_API bool gfx_shader_load(GFXShader* shader, const GFXReader* src)
+{
+	// Relies on reflected function for asserts.
+
+	return gfx_shader_load_reflected(shader, src, NULL);
+}
+
+/****************************/
+GFX_API bool gfx_shader_load_reflected(GFXShader* shader,
+                                       const GFXReader* src,
+                                       const GFXReader* reflect)
 {
 	assert(shader != NULL);
 	assert(src != NULL);
@@ -995,7 +1764,20 @@ GFX_API bool gfx_shader_load(GFXShader* shader, const GFXReader* src)
 	const size_t wordSize =
 		((size_t)len / sizeof(uint32_t)) * sizeof(uint32_t);
 
-	bool built = _gfx_shader_build(shader, wordSize, source);
+	// If given reflection metadata, skip reflecting ourselves.
+	// Fall back to reflection if it does not match the bytecode.
+	bool reflected = 0;
+
+	if (reflect != NULL)
+	{
+		reflected = _gfx_shader_read_reflect(shader, reflect, wordSize, source);
+		if (!reflected) gfx_log_warn(
+			"Reflection metadata of %s shader does not match its "
+			"SPIR-V bytecode, reflecting again.",
+			_GFX_GET_STAGE_STRING(shader->stage));
+	}
+
+	bool built = _gfx_shader_build(shader, wordSize, source, !reflected);
 	if (!built)
 		gfx_log_error(
 			"Failed to load %s shader.",
@@ -1004,3 +1786,45 @@ GFX_API bool gfx_shader_load(GFXShader* shader, const GFXReader* src)
 	free(source);
 	return built;
 }
+
+/****************************/
+GFX_API bool gfx_shader_store_reflection(GFXShader* shader, const GFXWriter* dst)
+{
+	assert(shader != NULL);
+	assert(dst != NULL);
+
+	// Nothing to store.
+	if (shader->vk.module == VK_NULL_HANDLE)
+		return 0;
+
+	GFXVec data;
+	gfx_vec_init(&data, sizeof(char));
+
+	const uint32_t version = _GFX_SHADER_REFLECT_VERSION;
+	const uint32_t stage = (uint32_t)shader->stage;
+	const uint64_t codeSize = shader->codeSize;
+
+	bool success =
+		gfx_vec_push(&data,
+			sizeof(_GFX_SHADER_REFLECT_MAGIC) - 1, _GFX_SHADER_REFLECT_MAGIC) &&
+		gfx_vec_push(&data, sizeof(version), &version) &&
+		gfx_vec_push(&data, sizeof(stage), &stage) &&
+		gfx_vec_push(&data, sizeof(codeSize), &codeSize) &&
+		gfx_vec_push(&data, sizeof(shader->codeHash), &shader->codeHash) &&
+		_gfx_shader_push_reflect(shader, &data);
+
+	success = success &&
+		gfx_io_write(dst, gfx_vec_at(&data, 0), data.size) == (long long)data.size;
+
+	if (success)
+		gfx_log_info(
+			"Written reflection metadata to stream (%"GFX_PRIs" bytes).",
+			data.size);
+	else
+		gfx_log_error(
+			"Could not write reflection metadata of %s shader to stream.",
+			_GFX_GET_STAGE_STRING(shader->stage));
+
+	gfx_vec_clear(&data);
+	return success;
+}
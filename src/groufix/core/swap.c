@@ -8,6 +8,7 @@
 
 #include "groufix/core.h"
 #include <assert.h>
+#include <limits.h>
 #include <stdlib.h>
 
 
@@ -200,13 +201,15 @@ static bool _gfx_swapchain_recreate(_GFXWindow* window,
 
 		// Decide on the presentation mode.
 		// - single buffered: Immediate.
-		// - double buffered: FIFO.
+		// - double buffered: FIFO (relaxed if GFX_WINDOW_RELAXED).
 		// - triple buffered: Mailbox.
 		// These are based on expected behavior, not actual images allocated.
 		// Fallback to FIFO, as this is required to be supported.
 		VkPresentModeKHR mode =
 			(wFlags & GFX_WINDOW_TRIPLE_BUFFER) ? VK_PRESENT_MODE_MAILBOX_KHR :
-			(wFlags & GFX_WINDOW_DOUBLE_BUFFER) ? VK_PRESENT_MODE_FIFO_KHR :
+			(wFlags & GFX_WINDOW_DOUBLE_BUFFER) ?
+				((wFlags & GFX_WINDOW_RELAXED) ?
+					VK_PRESENT_MODE_FIFO_RELAXED_KHR : VK_PRESENT_MODE_FIFO_KHR) :
 			VK_PRESENT_MODE_IMMEDIATE_KHR;
 
 		uint32_t m;
@@ -264,12 +267,15 @@ static bool _gfx_swapchain_recreate(_GFXWindow* window,
 			goto clean);
 
 		// Must be VK_NULL_HANDLE if window->vk.swapchain is not.
+		// Present ids start anew for every swapchain.
 		window->vk.oldSwapchain = VK_NULL_HANDLE;
+		window->frame.present = 0;
 
 		// If we have an old swapchain, retire it now.
 		// If we can't retire it, destroy it :/
 		if (oldSwap != VK_NULL_HANDLE)
-			if (!gfx_vec_push(&window->vk.retired, 1, &oldSwap))
+			if (!gfx_vec_push(&window->vk.retired, 1,
+				&(_GFXRetired){ .swapchain = oldSwap, .frame = UINT_MAX }))
 			{
 				gfx_log_warn(
 					"[ %s ] could not retire an old swapchain and will "
@@ -432,12 +438,13 @@ error:
 void _gfx_swapchains_present(_GFXQueue present, VkSemaphore rendered,
                              size_t num,
                              _GFXWindow** windows, const uint32_t* indices,
-                             _GFXRecreateFlags* flags)
+                             uint64_t* ids, _GFXRecreateFlags* flags)
 {
 	assert(rendered != VK_NULL_HANDLE);
 	assert(num > 0);
 	assert(windows != NULL);
 	assert(indices != NULL);
+	assert(ids != NULL);
 	assert(flags != NULL);
 
 	// Just take a random context lol (they're required to be same anyway).
@@ -452,10 +459,26 @@ void _gfx_swapchains_present(_GFXQueue present, VkSemaphore rendered,
 	for (size_t i = 0; i < num; ++i)
 		swapchains[i] = windows[i]->vk.swapchain;
 
+	// If present waits are supported, identify each present,
+	// so the renderer can wait for them to be displayed.
+	VkPresentIdKHR pid = {
+		.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR,
+
+		.pNext          = NULL,
+		.swapchainCount = (uint32_t)num,
+		.pPresentIds    = ids
+	};
+
+	const bool wait = context->features & _GFX_SUPPORT_PRESENT_WAIT;
+
+	if (wait)
+		for (size_t i = 0; i < num; ++i)
+			ids[i] = ++windows[i]->frame.present;
+
 	VkPresentInfoKHR pi = {
 		.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
 
-		.pNext              = NULL,
+		.pNext              = wait ? &pid : NULL,
 		.waitSemaphoreCount = 1,
 		.pWaitSemaphores    = &rendered,
 		.swapchainCount     = (uint32_t)num,
@@ -523,8 +546,47 @@ void _gfx_swapchain_purge(_GFXWindow* window)
 	for (size_t i = 0; i < window->vk.retired.size; ++i)
 		context->vk.DestroySwapchainKHR(
 			context->vk.device,
-			*(VkSwapchainKHR*)gfx_vec_at(&window->vk.retired, i),
+			((_GFXRetired*)gfx_vec_at(&window->vk.retired, i))->swapchain,
 			NULL);
 
 	gfx_vec_clear(&window->vk.retired);
 }
+
+/****************************/
+void _gfx_swapchain_defer(_GFXWindow* window, unsigned int frame)
+{
+	assert(window != NULL);
+	assert(frame != UINT_MAX);
+
+	for (size_t i = 0; i < window->vk.retired.size; ++i)
+	{
+		_GFXRetired* retired = gfx_vec_at(&window->vk.retired, i);
+		if (retired->frame == UINT_MAX) retired->frame = frame;
+	}
+}
+
+/****************************/
+void _gfx_swapchain_purge_frame(_GFXWindow* window, unsigned int frame)
+{
+	assert(window != NULL);
+	assert(frame != UINT_MAX);
+
+	_GFXContext* context = window->context;
+
+	// Destroy matching swapchains, keep the rest in retirement order.
+	size_t kept = 0;
+
+	for (size_t i = 0; i < window->vk.retired.size; ++i)
+	{
+		_GFXRetired* retired = gfx_vec_at(&window->vk.retired, i);
+
+		if (retired->frame == frame)
+			context->vk.DestroySwapchainKHR(
+				context->vk.device, retired->swapchain, NULL);
+		else
+			*(_GFXRetired*)gfx_vec_at(&window->vk.retired, kept++) = *retired;
+	}
+
+	if (kept < window->vk.retired.size)
+		gfx_vec_pop(&window->vk.retired, window->vk.retired.size - kept);
+}
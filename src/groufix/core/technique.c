@@ -37,6 +37,10 @@
 		0) /* Should not happen. */
 
 
+// Maximum number of variants (permutations) of a single technique.
+#define _GFX_MAX_VARIANTS 4096
+
+
 /****************************
  * Technique constant element definition.
  */
@@ -72,6 +76,32 @@ typedef struct _GFXBindingElem
 } _GFXBindingElem;
 
 
+/****************************
+ * Technique bindless binding element definition.
+ */
+typedef struct _GFXBindlessElem
+{
+	size_t set;
+	size_t binding;
+	size_t count; // #descriptors in the binding.
+
+} _GFXBindlessElem;
+
+
+/****************************
+ * Technique variant dimension element definition.
+ */
+typedef struct _GFXVariantElem
+{
+	uint32_t       id;
+	GFXShaderStage stage;
+	size_t         size;
+	size_t         numValues;
+	GFXConstant*   values;
+
+} _GFXVariantElem;
+
+
 /****************************
  * Compares two shader resources, ignoring the location/set/id and binding.
  * @return Non-zero if equal.
@@ -179,6 +209,226 @@ static bool _gfx_find_binding_elem(GFXVec* vec, size_t set, size_t binding,
 	return 0;
 }
 
+/****************************
+ * Technique push descriptor set element definition.
+ */
+typedef struct _GFXPushElem
+{
+	size_t                     set;
+	VkDescriptorUpdateTemplate template; // VK_NULL_HANDLE until locked.
+
+} _GFXPushElem;
+
+
+/****************************
+ * Finds a _GFXPushElem in a vector, optionally inserts it at
+ * its correct sorted position.
+ * @param vec Assumed to be sorted and store _GFXPushElem.
+ * @return The (new) element, NULL if not found or failed to insert.
+ */
+static _GFXPushElem* _gfx_find_push_elem(GFXVec* vec, size_t set, bool insert)
+{
+	// Binary search to its position.
+	size_t l = 0;
+	size_t r = vec->size;
+
+	while (l < r)
+	{
+		const size_t p = (l + r) >> 1;
+		_GFXPushElem* e = gfx_vec_at(vec, p);
+
+		if (e->set < set) l = p + 1;
+		else if (e->set > set) r = p;
+		else return e;
+	}
+
+	if (insert)
+	{
+		// Insert anew.
+		_GFXPushElem elem = { .set = set, .template = VK_NULL_HANDLE };
+		if (gfx_vec_insert(vec, 1, &elem, l))
+			return gfx_vec_at(vec, l);
+	}
+
+	return NULL;
+}
+
+/****************************
+ * Destroys all push descriptor update templates of a technique.
+ */
+static void _gfx_tech_destroy_push(GFXTechnique* technique)
+{
+	_GFXContext* context = technique->renderer->cache.context;
+
+	for (size_t p = 0; p < technique->push.size; ++p)
+	{
+		_GFXPushElem* elem = gfx_vec_at(&technique->push, p);
+		context->vk.DestroyDescriptorUpdateTemplate(
+			context->vk.device, elem->template, NULL);
+
+		elem->template = VK_NULL_HANDLE;
+	}
+}
+
+/****************************
+ * Creates the push descriptor update template of a set of a technique.
+ * Its entries match the _GFXSetEntry's of a set as laid out by
+ * _gfx_tech_get_set_binding, the same way the cache builds templates.
+ * @param technique Cannot be NULL, must be locked (pipeline layout exists).
+ * @return Zero on failure.
+ */
+static bool _gfx_tech_create_push(GFXTechnique* technique, _GFXPushElem* elem)
+{
+	_GFXContext* context = technique->renderer->cache.context;
+	const size_t stride = technique->renderer->cache.templateStride;
+
+	size_t numBindings, numEntries;
+	_gfx_tech_get_set_size(technique, elem->set, &numBindings, &numEntries);
+
+	VkDescriptorUpdateTemplateEntry entries[numBindings > 0 ? numBindings : 1];
+	uint32_t count = 0;
+	size_t offset = 0;
+
+	for (size_t b = 0; b < numBindings; ++b)
+	{
+		_GFXSetBinding binding;
+		if (
+			!_gfx_tech_get_set_binding(technique, elem->set, b, &binding) ||
+			binding.count == 0)
+		{
+			continue;
+		}
+
+		entries[count++] = (VkDescriptorUpdateTemplateEntry){
+			.dstBinding      = (uint32_t)b,
+			.dstArrayElement = 0,
+			.descriptorCount = (uint32_t)binding.count,
+			.descriptorType  = binding.type,
+			.offset          = offset,
+			.stride          = stride
+		};
+
+		offset += stride * binding.count;
+	}
+
+	// Cannot push nothing.
+	if (count == 0)
+	{
+		gfx_log_error(
+			"Push descriptor set %"GFX_PRIs" of a technique "
+			"contains no descriptors to push.",
+			elem->set);
+
+		return 0;
+	}
+
+	VkDescriptorUpdateTemplateCreateInfo dutci = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO,
+
+		.pNext                      = NULL,
+		.flags                      = 0,
+		.descriptorUpdateEntryCount = count,
+		.pDescriptorUpdateEntries   = entries,
+		.descriptorSetLayout        = VK_NULL_HANDLE,
+		.pipelineLayout             = technique->vk.layout,
+		.set                        = (uint32_t)elem->set,
+
+		.templateType =
+			VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR,
+		.pipelineBindPoint =
+			technique->shaders[_GFX_GET_SHADER_STAGE_INDEX(GFX_STAGE_COMPUTE)] == NULL ?
+			VK_PIPELINE_BIND_POINT_GRAPHICS :
+			VK_PIPELINE_BIND_POINT_COMPUTE
+	};
+
+	_GFX_VK_CHECK(
+		context->vk.CreateDescriptorUpdateTemplate(
+			context->vk.device, &dutci, NULL, &elem->template),
+		{
+			elem->template = VK_NULL_HANDLE;
+			return 0;
+		});
+
+	return 1;
+}
+
+/****************************
+ * Finds a _GFXBindlessElem in a vector, optionally inserts it at
+ * its correct sorted position.
+ * @param vec Assumed to be sorted and store _GFXBindlessElem.
+ * @return The (new) element, NULL if not found or failed to insert.
+ */
+static _GFXBindlessElem* _gfx_find_bindless_elem(GFXVec* vec,
+                                                 size_t set, size_t binding,
+                                                 bool insert)
+{
+	// Binary search to its position.
+	size_t l = 0;
+	size_t r = vec->size;
+
+	while (l < r)
+	{
+		const size_t p = (l + r) >> 1;
+		_GFXBindlessElem* e = gfx_vec_at(vec, p);
+
+		const bool lesser = e->set < set ||
+			(e->set == set && e->binding < binding);
+		const bool greater = e->set > set ||
+			(e->set == set && e->binding > binding);
+
+		if (lesser) l = p + 1;
+		else if (greater) r = p;
+		else return e;
+	}
+
+	if (insert)
+	{
+		// Insert anew.
+		_GFXBindlessElem elem = { .set = set, .binding = binding, .count = 0 };
+		if (gfx_vec_insert(vec, 1, &elem, l))
+			return gfx_vec_at(vec, l);
+	}
+
+	return NULL;
+}
+
+/****************************
+ * Checks whether a set of a technique contains any bindless bindings.
+ * @param vec Assumed to be sorted and store _GFXBindlessElem.
+ */
+static bool _gfx_is_bindless_set(GFXVec* vec, size_t set)
+{
+	// Binary search for the left-most element of the set.
+	size_t l = 0;
+	size_t r = vec->size;
+
+	while (l < r)
+	{
+		const size_t p = (l + r) >> 1;
+		_GFXBindlessElem* e = gfx_vec_at(vec, p);
+
+		if (e->set < set) l = p + 1;
+		else r = p;
+	}
+
+	return
+		l < vec->size &&
+		((_GFXBindlessElem*)gfx_vec_at(vec, l))->set == set;
+}
+
+/****************************
+ * Retrieves the descriptor count of a shader resource within a technique,
+ * i.e. its shader array size, unless it is bindless.
+ */
+static size_t _gfx_tech_get_count(GFXTechnique* technique,
+                                  size_t set, const _GFXShaderResource* res)
+{
+	const _GFXBindlessElem* elem = _gfx_find_bindless_elem(
+		&technique->bindless, set, res->binding, 0);
+
+	return elem != NULL ? elem->count : res->count;
+}
+
 /****************************
  * Retrieves a shader resource from a technique by set/binding number.
  * Unknown what shader will be referenced, technique is assumed to be validated.
@@ -215,13 +465,89 @@ static _GFXShaderResource* _gfx_tech_get_resource(GFXTechnique* technique,
 	return NULL;
 }
 
+/****************************
+ * Computes the number of variants spanned by all variant dimensions.
+ * @param vec Assumed to store _GFXVariantElem.
+ */
+static size_t _gfx_tech_count_variants(GFXVec* vec)
+{
+	size_t count = 1;
+
+	for (size_t v = 0; v < vec->size; ++v)
+		count *= ((_GFXVariantElem*)gfx_vec_at(vec, v))->numValues;
+
+	return count;
+}
+
+/****************************
+ * Builds the variant table of a technique, which stores a full copy of all
+ * specialization constants for each variant, so pipelines of a variant can
+ * be built by indexing the table.
+ * @param technique Cannot be NULL.
+ * @return Zero on failure.
+ */
+static bool _gfx_tech_create_variants(GFXTechnique* technique)
+{
+	const size_t numConsts = technique->constants.size;
+	const size_t numVariants = _gfx_tech_count_variants(&technique->variants);
+
+	// No dimensions or no constants, every variant is the base technique.
+	if (technique->variants.size == 0 || numConsts == 0)
+	{
+		technique->numVariants = numVariants;
+		return 1;
+	}
+
+	_GFXConstantElem* table = malloc(
+		sizeof(_GFXConstantElem) * numConsts * numVariants);
+
+	if (table == NULL)
+	{
+		gfx_log_error("Could not allocate the variant table of a technique.");
+		return 0;
+	}
+
+	// Each variant index is a mixed-radix number of value indices,
+	// the first declared dimension varies fastest.
+	for (size_t v = 0; v < numVariants; ++v)
+	{
+		_GFXConstantElem* consts = table + v * numConsts;
+		memcpy(consts, gfx_vec_at(&technique->constants, 0),
+			sizeof(_GFXConstantElem) * numConsts);
+
+		size_t stride = 1;
+
+		for (size_t d = 0; d < technique->variants.size; ++d)
+		{
+			_GFXVariantElem* dim = gfx_vec_at(&technique->variants, d);
+			const size_t value = (v / stride) % dim->numValues;
+			stride *= dim->numValues;
+
+			for (size_t c = 0; c < numConsts; ++c)
+				if (
+					consts[c].id == dim->id &&
+					(dim->stage & ((uint32_t)1 << consts[c].stage)))
+				{
+					consts[c].size = dim->size;
+					consts[c].value = dim->values[value];
+				}
+		}
+	}
+
+	technique->numVariants = numVariants;
+	technique->variantTable = table;
+
+	return 1;
+}
+
 /****************************/
-void _gfx_tech_get_constants(GFXTechnique* technique,
+void _gfx_tech_get_constants(GFXTechnique* technique, size_t variant,
                              VkSpecializationInfo* infos,
                              VkSpecializationMapEntry* entries)
 {
 	assert(technique != NULL);
 	assert(technique->layout != NULL); // Must be locked.
+	assert(variant < technique->numVariants);
 	assert(infos != NULL);
 	assert(technique->constants.size == 0 || entries != NULL);
 
@@ -237,6 +563,12 @@ void _gfx_tech_get_constants(GFXTechnique* technique,
 	// No constants, done.
 	if (technique->constants.size == 0) return;
 
+	// Get the constants of the variant, the base technique if no table.
+	_GFXConstantElem* consts = (technique->variantTable == NULL) ?
+		gfx_vec_at(&technique->constants, 0) :
+		(_GFXConstantElem*)technique->variantTable +
+			variant * technique->constants.size;
+
 	// Loop over all constants, count & output them;
 	// They are already sorted correctly.
 	uint32_t currStage = UINT32_MAX;
@@ -244,7 +576,7 @@ void _gfx_tech_get_constants(GFXTechnique* technique,
 
 	for (size_t c = 0; c < technique->constants.size; ++c)
 	{
-		_GFXConstantElem* elem = gfx_vec_at(&technique->constants, c);
+		_GFXConstantElem* elem = consts + c;
 		infos[elem->stage].mapEntryCount += 1;
 		infos[elem->stage].dataSize += sizeof(_GFXConstantElem);
 
@@ -352,7 +684,7 @@ void _gfx_tech_get_set_size(GFXTechnique* technique,
 				// Note that we also check if the resource contains more
 				// than just an immutable sampler.
 				if (!isImmutable || res->type != _GFX_SHADER_SAMPLER)
-					*numEntries += res->count;
+					*numEntries += _gfx_tech_get_count(technique, set, res);
 
 				counted[res->binding] = 1;
 			}
@@ -385,12 +717,38 @@ bool _gfx_tech_get_set_binding(GFXTechnique* technique,
 
 	out->type = _GFX_GET_VK_DESCRIPTOR_TYPE(res->type, isDynamic);
 	out->viewType = res->viewType;
-	out->count = res->count;
+	out->count = _gfx_tech_get_count(technique, set, res);
 
 	// Just as above, check if it contains more than an immutable sampler.
 	return !isImmutable || res->type != _GFX_SHADER_SAMPLER;
 }
 
+/****************************/
+bool _gfx_tech_is_bindless(GFXTechnique* technique, size_t set)
+{
+	assert(technique != NULL);
+	assert(technique->layout != NULL); // Must be locked.
+	assert(set < technique->numSets);
+
+	return _gfx_is_bindless_set(&technique->bindless, set);
+}
+
+/****************************/
+VkDescriptorUpdateTemplate _gfx_tech_get_push(GFXTechnique* technique,
+                                              size_t set)
+{
+	assert(technique != NULL);
+	assert(technique->layout != NULL); // Must be locked.
+	assert(set < technique->numSets);
+
+	// Super early exit.
+	if (technique->push.size == 0)
+		return VK_NULL_HANDLE;
+
+	_GFXPushElem* elem = _gfx_find_push_elem(&technique->push, set, 0);
+	return elem != NULL ? elem->template : VK_NULL_HANDLE;
+}
+
 /****************************/
 GFX_API GFXTechnique* gfx_renderer_add_tech(GFXRenderer* renderer,
                                             size_t numShaders, GFXShader** shaders)
@@ -543,6 +901,8 @@ GFX_API GFXTechnique* gfx_renderer_add_tech(GFXRenderer* renderer,
 	tech->pushStages = pushStages;
 	tech->layout = NULL;
 	tech->vk.layout = VK_NULL_HANDLE;
+	tech->numVariants = 1;
+	tech->variantTable = NULL;
 	memcpy(tech->shaders, shads, sizeof(shads));
 
 	for (size_t l = 0; l < tech->numSets; ++l)
@@ -552,6 +912,9 @@ GFX_API GFXTechnique* gfx_renderer_add_tech(GFXRenderer* renderer,
 	gfx_vec_init(&tech->samplers, sizeof(_GFXSamplerElem));
 	gfx_vec_init(&tech->immutable, sizeof(_GFXBindingElem));
 	gfx_vec_init(&tech->dynamic, sizeof(_GFXBindingElem));
+	gfx_vec_init(&tech->bindless, sizeof(_GFXBindlessElem));
+	gfx_vec_init(&tech->push, sizeof(_GFXPushElem));
+	gfx_vec_init(&tech->variants, sizeof(_GFXVariantElem));
 
 	// Link the technique into the renderer.
 	// Modifying the renderer, lock!
@@ -582,11 +945,21 @@ GFX_API void gfx_erase_tech(GFXTechnique* technique)
 	_gfx_mutex_unlock(&renderer->lock);
 
 	// Destroy itself.
+	// Update templates are only read while recording, no need to wait.
+	_gfx_tech_destroy_push(technique);
+
 	gfx_vec_clear(&technique->constants);
 	gfx_vec_clear(&technique->samplers);
 	gfx_vec_clear(&technique->immutable);
 	gfx_vec_clear(&technique->dynamic);
+	gfx_vec_clear(&technique->bindless);
+	gfx_vec_clear(&technique->push);
 
+	for (size_t v = 0; v < technique->variants.size; ++v)
+		free(((_GFXVariantElem*)gfx_vec_at(&technique->variants, v))->values);
+
+	gfx_vec_clear(&technique->variants);
+	free(technique->variantTable);
 	free(technique);
 }
 
@@ -698,6 +1071,88 @@ GFX_API bool gfx_tech_constant(GFXTechnique* technique,
 	return success;
 }
 
+/****************************/
+GFX_API bool gfx_tech_variant(GFXTechnique* technique,
+                              uint32_t id, GFXShaderStage stage, size_t size,
+                              size_t numValues, const GFXConstant* values)
+{
+	assert(technique != NULL);
+	assert(stage != 0);
+	assert(numValues > 0);
+	assert(values != NULL);
+
+	// Skip if already locked.
+	if (technique->layout != NULL)
+		return 0;
+
+	// Find the dimension if it was already declared.
+	_GFXVariantElem* dim = NULL;
+	for (size_t v = 0; v < technique->variants.size; ++v)
+	{
+		_GFXVariantElem* e = gfx_vec_at(&technique->variants, v);
+		if (e->id == id && e->stage == stage) dim = e;
+	}
+
+	// Validate the number of variants, with the new dimension in place.
+	const size_t count =
+		_gfx_tech_count_variants(&technique->variants) /
+		(dim != NULL ? dim->numValues : 1);
+
+	if (count * numValues > _GFX_MAX_VARIANTS || count * numValues < count)
+	{
+		gfx_log_error(
+			"Could not declare technique variant; a technique cannot have "
+			"more than %u variants.",
+			(unsigned int)_GFX_MAX_VARIANTS);
+
+		return 0;
+	}
+
+	// The first value becomes the specialization constant of variant 0.
+	if (!gfx_tech_constant(technique, id, stage, size, values[0]))
+		return 0;
+
+	GFXConstant* copy = malloc(sizeof(GFXConstant) * numValues);
+	if (copy == NULL)
+		return 0;
+
+	memcpy(copy, values, sizeof(GFXConstant) * numValues);
+
+	if (dim != NULL)
+		// If found, just update.
+		free(dim->values),
+		dim->size = size,
+		dim->numValues = numValues,
+		dim->values = copy;
+	else
+	{
+		// Insert anew.
+		_GFXVariantElem elem = {
+			.id = id,
+			.stage = stage,
+			.size = size,
+			.numValues = numValues,
+			.values = copy
+		};
+
+		if (!gfx_vec_push(&technique->variants, 1, &elem))
+		{
+			free(copy);
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/****************************/
+GFX_API size_t gfx_tech_get_num_variants(GFXTechnique* technique)
+{
+	assert(technique != NULL);
+
+	return _gfx_tech_count_variants(&technique->variants);
+}
+
 /****************************/
 GFX_API bool gfx_tech_samplers(GFXTechnique* technique,
                                size_t set,
@@ -834,6 +1289,100 @@ GFX_API bool gfx_tech_dynamic(GFXTechnique* technique,
 	return _gfx_find_binding_elem(&technique->dynamic, set, binding, 1);
 }
 
+/****************************/
+GFX_API bool gfx_tech_bindless(GFXTechnique* technique,
+                               size_t set, size_t binding, size_t count)
+{
+	assert(technique != NULL);
+	assert(set < technique->numSets);
+
+	// Skip if already locked.
+	if (technique->layout != NULL)
+		return 0;
+
+	// Check if the device supports it at all.
+	if (!(technique->renderer->cache.context->features &
+		_GFX_SUPPORT_DESCRIPTOR_INDEXING))
+	{
+		gfx_log_warn(
+			"Could not set a bindless descriptor resource "
+			"(set=%"GFX_PRIs", binding=%"GFX_PRIs") of a technique, "
+			"descriptor indexing is not supported by the device.",
+			set, binding);
+
+		return 0;
+	}
+
+	// Check if we can make this resource bindless.
+	_GFXShaderResource* res =
+		_gfx_tech_get_resource(technique, set, binding);
+
+	if (res == NULL ||
+		(res->type != _GFX_SHADER_IMAGE_AND_SAMPLER &&
+		res->type != _GFX_SHADER_IMAGE_SAMPLED &&
+		res->type != _GFX_SHADER_BUFFER_STORAGE))
+	{
+		gfx_log_warn(
+			"Could not set a bindless descriptor resource "
+			"(set=%"GFX_PRIs", binding=%"GFX_PRIs") of a technique, "
+			"not a sampled image or storage buffer.",
+			set, binding);
+
+		return 0;
+	}
+
+	// Resolve the count.
+	if (count == 0) count = res->count;
+
+	if (count == 0 || count < res->count)
+	{
+		gfx_log_warn(
+			"Could not set a bindless descriptor resource "
+			"(set=%"GFX_PRIs", binding=%"GFX_PRIs") of a technique, "
+			"must be at least the shader array size of %"GFX_PRIs".",
+			set, binding, GFX_MAX(res->count, (size_t)1));
+
+		return 0;
+	}
+
+	// Insert the binding element & set its count.
+	_GFXBindlessElem* elem =
+		_gfx_find_bindless_elem(&technique->bindless, set, binding, 1);
+
+	if (elem == NULL)
+		return 0;
+
+	elem->count = count;
+	return 1;
+}
+
+/****************************/
+GFX_API bool gfx_tech_push(GFXTechnique* technique, size_t set)
+{
+	assert(technique != NULL);
+	assert(set < technique->numSets);
+
+	// Skip if already locked.
+	if (technique->layout != NULL)
+		return 0;
+
+	// Check if the device supports it at all.
+	if (!(technique->renderer->cache.context->features &
+		_GFX_SUPPORT_PUSH_DESCRIPTOR))
+	{
+		gfx_log_warn(
+			"Could not set a push descriptor set (set=%"GFX_PRIs") "
+			"of a technique, push descriptors are not supported by "
+			"the device.",
+			set);
+
+		return 0;
+	}
+
+	// Insert the push element.
+	return _gfx_find_push_elem(&technique->push, set, 1) != NULL;
+}
+
 /****************************/
 GFX_API bool gfx_tech_lock(GFXTechnique* technique)
 {
@@ -909,7 +1458,11 @@ GFX_API bool gfx_tech_lock(GFXTechnique* technique)
 			// Do not fret; this does not skip 'unsized' (i.e. variable sized)
 			// storage buffers. The _last element_ of this resource would have
 			// a count of zero, not the resource itself :)
-			if (cur == NULL || cur->count == 0) continue;
+			// Unsized arrays are skipped, unless they are bindless.
+			const size_t count =
+				cur != NULL ? _gfx_tech_get_count(technique, set, cur) : 0;
+
+			if (count == 0) continue;
 
 			// Push the resource as a binding.
 			const bool isDynamic =
@@ -918,7 +1471,7 @@ GFX_API bool gfx_tech_lock(GFXTechnique* technique)
 			VkDescriptorSetLayoutBinding dslb = {
 				.binding            = (uint32_t)binding,
 				.descriptorType     = _GFX_GET_VK_DESCRIPTOR_TYPE(cur->type, isDynamic),
-				.descriptorCount    = (uint32_t)cur->count,
+				.descriptorCount    = (uint32_t)count,
 				.stageFlags         = _GFX_GET_VK_SHADER_STAGE(stages),
 				.pImmutableSamplers = NULL
 			};
@@ -927,6 +1480,89 @@ GFX_API bool gfx_tech_lock(GFXTechnique* technique)
 				goto reset;
 		}
 
+		// If the set is bindless, all its bindings are updated after bind
+		// and may be partially bound. Validate that they can be.
+		const bool bindless = _gfx_is_bindless_set(&technique->bindless, set);
+		size_t vlaFlags = bindless && bindings.size > 0 ? bindings.size : 1;
+		VkDescriptorBindingFlags flags[vlaFlags];
+
+		if (bindless) for (size_t b = 0; b < bindings.size; ++b)
+		{
+			VkDescriptorSetLayoutBinding* dslb = gfx_vec_at(&bindings, b);
+
+			if (
+				dslb->descriptorType != VK_DESCRIPTOR_TYPE_SAMPLER &&
+				dslb->descriptorType != VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER &&
+				dslb->descriptorType != VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE &&
+				dslb->descriptorType != VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+			{
+				gfx_log_error(
+					"Bindless set %"GFX_PRIs" of a technique can only "
+					"contain samplers, sampled images and (non-dynamic) "
+					"storage buffers, found another resource at "
+					"binding=%"PRIu32".",
+					set, dslb->binding);
+
+				goto reset;
+			}
+
+			flags[b] =
+				VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+				VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT |
+				VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+		}
+
+		// If the set is pushed, it cannot be bindless, contain dynamic
+		// buffers or exceed the push descriptor limit.
+		const bool push = _gfx_find_push_elem(&technique->push, set, 0);
+
+		if (push)
+		{
+			uint32_t descriptors = 0;
+
+			for (size_t b = 0; b < bindings.size; ++b)
+			{
+				VkDescriptorSetLayoutBinding* dslb = gfx_vec_at(&bindings, b);
+				descriptors += dslb->descriptorCount;
+
+				if (
+					dslb->descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC ||
+					dslb->descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC)
+				{
+					gfx_log_error(
+						"Push descriptor set %"GFX_PRIs" of a technique "
+						"cannot contain dynamic buffers, found one at "
+						"binding=%"PRIu32".",
+						set, dslb->binding);
+
+					goto reset;
+				}
+			}
+
+			if (bindless)
+			{
+				gfx_log_error(
+					"Push descriptor set %"GFX_PRIs" of a technique "
+					"cannot be bindless.",
+					set);
+
+				goto reset;
+			}
+
+			if (descriptors >
+				renderer->cache.context->limits.maxPushDescriptors)
+			{
+				gfx_log_error(
+					"Push descriptor set %"GFX_PRIs" of a technique "
+					"contains %"PRIu32" descriptors, the device can only "
+					"push up to %"PRIu32".",
+					set, descriptors,
+					renderer->cache.context->limits.maxPushDescriptors);
+
+				goto reset;
+			}
+		}
+
 		// Loop over all bindings again to create immutable samplers.
 		size_t vlaBinds = bindings.size > 0 ? bindings.size : 1;
 		size_t samOffs[vlaBinds];
@@ -977,13 +1613,26 @@ GFX_API bool gfx_tech_lock(GFXTechnique* technique)
 			}
 
 		// Create the actual descriptor set layout.
+		VkDescriptorSetLayoutBindingFlagsCreateInfo dslbfci = {
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+
+			.pNext         = NULL,
+			.bindingCount  = (uint32_t)bindings.size,
+			.pBindingFlags = flags
+		};
+
 		VkDescriptorSetLayoutCreateInfo dslci = {
 			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
 
-			.pNext        = NULL,
-			.flags        = 0,
+			.pNext        = bindless ? &dslbfci : NULL,
 			.bindingCount = (uint32_t)bindings.size,
 
+			.flags =
+				(bindless ?
+					VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT : 0) |
+				(push ?
+					VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR : 0),
+
 			.pBindings = bindings.size > 0 ?
 				gfx_vec_at(&bindings, 0) : NULL
 		};
@@ -1044,6 +1693,22 @@ GFX_API bool gfx_tech_lock(GFXTechnique* technique)
 	// Set `vk.layout` for locality!
 	technique->vk.layout = technique->layout->vk.layout;
 
+	// Create all push descriptor update templates,
+	// these need the pipeline layout.
+	for (size_t p = 0; p < technique->push.size; ++p)
+		if (!_gfx_tech_create_push(technique, gfx_vec_at(&technique->push, p)))
+		{
+			_gfx_tech_destroy_push(technique);
+			goto reset;
+		}
+
+	// Build the variant table, so pipelines can index it.
+	if (!_gfx_tech_create_variants(technique))
+	{
+		_gfx_tech_destroy_push(technique);
+		goto reset;
+	}
+
 	// And finally, get rid of the samplers, once we've successfully locked
 	// we already created and used all samplers and cannot unlock.
 	gfx_vec_clear(&technique->samplers);
@@ -1054,6 +1719,7 @@ GFX_API bool gfx_tech_lock(GFXTechnique* technique)
 	// Reset on failure.
 reset:
 	technique->layout = NULL;
+	technique->vk.layout = VK_NULL_HANDLE;
 	gfx_vec_clear(&bindings);
 	gfx_vec_clear(&samplers);
 	gfx_vec_clear(&samplerHandles);
@@ -10,16 +10,39 @@
 #ifndef _GFX_CORE_THREADS_H
 #define _GFX_CORE_THREADS_H
 
+#include "groufix/core/log.h"
 #include "groufix/def.h"
 
 #if defined (GFX_UNIX)
+	#include <poll.h>
 	#include <pthread.h>
+	#include <sched.h>
+	#include <unistd.h>
 #elif defined (GFX_WIN32)
+	#include <limits.h>
 	#include <processthreadsapi.h>
 	#include <synchapi.h>
+	#include <sysinfoapi.h>
 #endif
 
 
+/**
+ * Thread handle & entry point.
+ * Entry points must be declared as `_GFXThreadRet _GFX_THREAD_CALL f(void*)`.
+ */
+#if defined (GFX_UNIX)
+	typedef pthread_t _GFXThread;
+	typedef void*     _GFXThreadRet;
+	#define _GFX_THREAD_CALL
+#elif defined (GFX_WIN32)
+	typedef HANDLE    _GFXThread;
+	typedef DWORD     _GFXThreadRet;
+	#define _GFX_THREAD_CALL WINAPI
+#endif
+
+typedef _GFXThreadRet (_GFX_THREAD_CALL *_GFXThreadFunc)(void*);
+
+
 /**
  * Thread local data key.
  */
@@ -40,6 +63,125 @@
 #endif
 
 
+/**
+ * Condition variable.
+ * Windows XP has no condition variables, so broadcasts release a semaphore
+ * once for each waiter and wait for all of them to have woken up.
+ */
+#if defined (GFX_UNIX)
+	typedef pthread_cond_t _GFXCond;
+#elif defined (GFX_WIN32)
+	typedef struct _GFXCond
+	{
+		HANDLE           sem;  // Released once for each waiter.
+		HANDLE           done; // Set by the last waiter of a broadcast.
+		CRITICAL_SECTION lock; // For waiters.
+		size_t           waiters;
+
+	} _GFXCond;
+#endif
+
+
+/****************************
+ * Thread handle.
+ ****************************/
+
+/**
+ * Creates a new thread, starting at func with the given argument.
+ * @return Non-zero on success.
+ */
+static inline bool _gfx_thread_create(_GFXThread* thread,
+                                      _GFXThreadFunc func, void* arg)
+{
+#if defined (GFX_UNIX)
+	return !pthread_create(thread, NULL, func, arg);
+
+#elif defined (GFX_WIN32)
+	*thread = CreateThread(NULL, 0, func, arg, 0, NULL);
+	return *thread != NULL;
+
+#endif
+}
+
+/**
+ * Blocks until a thread terminates and releases its resources.
+ * Must be called exactly once for each successfully created thread.
+ */
+static inline void _gfx_thread_join(_GFXThread thread)
+{
+#if defined (GFX_UNIX)
+	pthread_join(thread, NULL);
+
+#elif defined (GFX_WIN32)
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+
+#endif
+}
+
+/**
+ * Suspends the calling thread for (at least) a number of milliseconds.
+ */
+static inline void _gfx_thread_sleep(unsigned int ms)
+{
+#if defined (GFX_UNIX)
+	poll(NULL, 0, (int)ms);
+
+#elif defined (GFX_WIN32)
+	Sleep(ms);
+
+#endif
+}
+
+/**
+ * Yields the processor to other threads, if any are ready to run.
+ */
+static inline void _gfx_thread_yield(void)
+{
+#if defined (GFX_UNIX)
+	sched_yield();
+
+#elif defined (GFX_WIN32)
+	SwitchToThread();
+
+#endif
+}
+
+/**
+ * Retrieves the number of logical processors that are available.
+ * @return Always at least 1.
+ */
+static inline unsigned int _gfx_thread_concurrency(void)
+{
+#if defined (GFX_UNIX)
+	const long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (unsigned int)count : 1;
+
+#elif defined (GFX_WIN32)
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors > 0 ?
+		(unsigned int)info.dwNumberOfProcessors : 1;
+
+#endif
+}
+
+/**
+ * Retrieves the identifier of the calling process,
+ * unique among all running processes.
+ */
+static inline uintmax_t _gfx_process_id(void)
+{
+#if defined (GFX_UNIX)
+	return (uintmax_t)getpid();
+
+#elif defined (GFX_WIN32)
+	return (uintmax_t)GetCurrentProcessId();
+
+#endif
+}
+
+
 /****************************
  * Thread local data key.
  ****************************/
@@ -143,10 +285,10 @@ static inline void _gfx_mutex_clear(_GFXMutex* mutex)
 }
 
 /**
- * Blocks until the calling thread is granted ownership of the mutex.
- * Locking an already owned mutex is undefined behaviour.
+ * Same as _gfx_mutex_lock, except its wait is never traced.
+ * Must be used for locks taken by tracers themselves.
  */
-static inline void _gfx_mutex_lock(_GFXMutex* mutex)
+static inline void _gfx_mutex_lock_raw(_GFXMutex* mutex)
 {
 #if defined (GFX_UNIX)
 	pthread_mutex_lock(mutex);
@@ -172,6 +314,26 @@ static inline bool _gfx_mutex_try_lock(_GFXMutex* mutex)
 #endif
 }
 
+/**
+ * Blocks until the calling thread is granted ownership of the mutex.
+ * Locking an already owned mutex is undefined behaviour.
+ *
+ * When tracing, only contended locks emit a zone, spanning the wait.
+ */
+static inline void _gfx_mutex_lock(_GFXMutex* mutex)
+{
+#if defined (GFX_TRACE)
+	if (_gfx_mutex_try_lock(mutex))
+		return;
+
+	gfx_trace_begin(wait, "Mutex wait");
+	_gfx_mutex_lock_raw(mutex);
+	gfx_trace_end(wait);
+#else
+	_gfx_mutex_lock_raw(mutex);
+#endif
+}
+
 /**
  * Releases the mutex, making it available to other threads.
  * Unlocking an already unlocked mutex is undefined behaviour.
@@ -188,4 +350,115 @@ static inline void _gfx_mutex_unlock(_GFXMutex* mutex)
 }
 
 
+
+/****************************
+ * Condition variable.
+ ****************************/
+
+/**
+ * Initializes a condition variable.
+ * The object pointed to by cond cannot be moved or copied!
+ * @return Non-zero on success.
+ */
+static inline bool _gfx_cond_init(_GFXCond* cond)
+{
+#if defined (GFX_UNIX)
+	return !pthread_cond_init(cond, NULL);
+
+#elif defined (GFX_WIN32)
+	cond->sem = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+	if (cond->sem == NULL)
+		return 0;
+
+	cond->done = CreateEvent(NULL, FALSE, FALSE, NULL);
+	if (cond->done == NULL)
+	{
+		CloseHandle(cond->sem);
+		return 0;
+	}
+
+	InitializeCriticalSection(&cond->lock);
+	cond->waiters = 0;
+
+	return 1;
+
+#endif
+}
+
+/**
+ * Clears a condition variable.
+ * Clearing a condition variable that is waited upon is undefined behaviour.
+ */
+static inline void _gfx_cond_clear(_GFXCond* cond)
+{
+#if defined (GFX_UNIX)
+	pthread_cond_destroy(cond);
+
+#elif defined (GFX_WIN32)
+	DeleteCriticalSection(&cond->lock);
+	CloseHandle(cond->done);
+	CloseHandle(cond->sem);
+
+#endif
+}
+
+/**
+ * Atomically releases the mutex and blocks until woken up,
+ * the mutex is owned again when this returns.
+ * The calling thread must own the mutex, spurious wakeups may occur.
+ */
+static inline void _gfx_cond_wait(_GFXCond* cond, _GFXMutex* mutex)
+{
+#if defined (GFX_UNIX)
+	pthread_cond_wait(cond, mutex);
+
+#elif defined (GFX_WIN32)
+	EnterCriticalSection(&cond->lock);
+	++cond->waiters;
+	LeaveCriticalSection(&cond->lock);
+
+	LeaveCriticalSection(mutex);
+	WaitForSingleObject(cond->sem, INFINITE);
+
+	// The last waiter to wake up lets the broadcasting thread continue.
+	EnterCriticalSection(&cond->lock);
+	const bool last = (--cond->waiters == 0);
+	LeaveCriticalSection(&cond->lock);
+
+	if (last) SetEvent(cond->done);
+	EnterCriticalSection(mutex);
+
+#endif
+}
+
+/**
+ * Wakes up all threads blocked on a condition variable.
+ * The calling thread must own the mutex the threads are blocked with.
+ *
+ * On Windows this blocks until all woken threads are awake,
+ * so no thread that starts waiting afterwards can steal a wakeup.
+ */
+static inline void _gfx_cond_broadcast(_GFXCond* cond)
+{
+#if defined (GFX_UNIX)
+	pthread_cond_broadcast(cond);
+
+#elif defined (GFX_WIN32)
+	EnterCriticalSection(&cond->lock);
+
+	if (cond->waiters == 0)
+		LeaveCriticalSection(&cond->lock);
+	else
+	{
+		ReleaseSemaphore(cond->sem, (LONG)cond->waiters, NULL);
+		LeaveCriticalSection(&cond->lock);
+
+		WaitForSingleObject(cond->done, INFINITE);
+	}
+
+#endif
+}
+
+
+
 #endif
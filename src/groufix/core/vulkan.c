@@ -175,6 +175,14 @@ bool _gfx_vulkan_init(void)
 	const char** glfwExtensions =
 		glfwGetRequiredInstanceExtensions(&glfwCount);
 
+	// When headless, no surfaces are required, only swapchain support
+	// (VK_KHR_surface) so devices can still be initialized the same way.
+	static const char* headlessExtensions[] = { "VK_KHR_surface" };
+
+	if (glfwExtensions == NULL && _groufix.headlessDef)
+		glfwExtensions = headlessExtensions,
+		glfwCount = 1;
+
 	if (glfwExtensions == NULL)
 		goto clean;
 
@@ -317,9 +325,7 @@ bool _gfx_vulkan_init(void)
 #endif
 		_GFX_GET_INSTANCE_PROC_ADDR(CreateDevice);
 		_GFX_GET_INSTANCE_PROC_ADDR(DestroySurfaceKHR);
-#if defined (GFX_USE_VK_SUBSET_DEVICES)
 		_GFX_GET_INSTANCE_PROC_ADDR(EnumerateDeviceExtensionProperties);
-#endif
 		_GFX_GET_INSTANCE_PROC_ADDR(EnumeratePhysicalDeviceGroups);
 		_GFX_GET_INSTANCE_PROC_ADDR(EnumeratePhysicalDevices);
 		_GFX_GET_INSTANCE_PROC_ADDR(GetDeviceProcAddr);
@@ -327,6 +333,7 @@ bool _gfx_vulkan_init(void)
 		_GFX_GET_INSTANCE_PROC_ADDR(GetPhysicalDeviceFeatures2);
 		_GFX_GET_INSTANCE_PROC_ADDR(GetPhysicalDeviceFormatProperties);
 		_GFX_GET_INSTANCE_PROC_ADDR(GetPhysicalDeviceMemoryProperties);
+		_GFX_GET_INSTANCE_PROC_ADDR(GetPhysicalDeviceMemoryProperties2);
 		_GFX_GET_INSTANCE_PROC_ADDR(GetPhysicalDeviceProperties);
 		_GFX_GET_INSTANCE_PROC_ADDR(GetPhysicalDeviceProperties2);
 		_GFX_GET_INSTANCE_PROC_ADDR(GetPhysicalDeviceQueueFamilyProperties);
@@ -419,6 +419,7 @@ GFX_API GFXWindow* gfx_create_window(GFXWindowFlags flags, GFXDevice* device,
 	window->frame.format = VK_FORMAT_UNDEFINED;
 	window->frame.width = (uint32_t)width;
 	window->frame.height = (uint32_t)height;
+	window->frame.present = 0;
 
 	atomic_store_explicit(&window->frame.recreate, 0, memory_order_relaxed);
 	window->frame.rWidth = (uint32_t)width;
@@ -450,7 +451,7 @@ GFX_API GFXWindow* gfx_create_window(GFXWindowFlags flags, GFXDevice* device,
 	// eventually get created when an image is acquired.
 	window->vk.swapchain = VK_NULL_HANDLE;
 	window->vk.oldSwapchain = VK_NULL_HANDLE;
-	gfx_vec_init(&window->vk.retired, sizeof(VkSwapchainKHR));
+	gfx_vec_init(&window->vk.retired, sizeof(_GFXRetired));
 
 
 	// Holy moly :o
@@ -579,7 +580,8 @@ GFX_API void gfx_window_set_flags(GFXWindow* window, GFXWindowFlags flags)
 	// We lock such that setting the flags and signaling it
 	// are both in the same atomic operation.
 	GFXWindowFlags bufferBits =
-		GFX_WINDOW_DOUBLE_BUFFER | GFX_WINDOW_TRIPLE_BUFFER;
+		GFX_WINDOW_DOUBLE_BUFFER | GFX_WINDOW_TRIPLE_BUFFER |
+		GFX_WINDOW_RELAXED;
 
 	_gfx_mutex_lock(&win->frame.lock);
 
@@ -0,0 +1,276 @@
+/**
+ * This file is part of groufix.
+ * Copyright (c) Stef Velzel. All rights reserved.
+ *
+ * groufix : graphics engine produced by Stef Velzel.
+ * www     : <www.vuzzel.nl>
+ */
+
+#include <string.h>
+
+#define TEST_SKIP_INIT
+#include "test.h"
+#include "groufix/containers/alloc.h"
+#include "groufix/containers/map.h"
+
+
+#define NUM_KEYS 1000
+#define NUM_DUPLICATES 3
+
+
+/****************************
+ * Key hashing & comparison, keys are uint64_t.
+ */
+static uint64_t hash(const void* key)
+{
+	// splitmix64 finalizer.
+	uint64_t x = *(const uint64_t*)key;
+	x = (x ^ (x >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+	x = (x ^ (x >> 27)) * UINT64_C(0x94d049bb133111eb);
+
+	return x ^ (x >> 31);
+}
+
+static int cmp(const void* l, const void* r)
+{
+	return *(const uint64_t*)l != *(const uint64_t*)r;
+}
+
+
+/****************************
+ * Map test.
+ */
+TEST_DESCRIBE(map, t)
+{
+	GFXMap map;
+	gfx_map_init(&map, sizeof(uint64_t), hash, cmp);
+
+	// Insert all keys, storing their square as element.
+	for (uint64_t k = 0; k < NUM_KEYS; ++k)
+	{
+		const uint64_t elem = k * k;
+		if (!gfx_map_insert(&map, &elem, sizeof(uint64_t), &k))
+			goto fail;
+	}
+
+	// Insert duplicates of a single key, distinguished by their element.
+	const uint64_t dup = NUM_KEYS / 2;
+
+	for (uint64_t d = 1; d < NUM_DUPLICATES; ++d)
+	{
+		const uint64_t elem = NUM_KEYS * NUM_KEYS + d;
+		if (!gfx_map_insert(&map, &elem, sizeof(uint64_t), &dup))
+			goto fail;
+	}
+
+	if (map.size != NUM_KEYS + NUM_DUPLICATES - 1)
+		goto fail;
+
+	// Search all keys & check their element and key.
+	for (uint64_t k = 0; k < NUM_KEYS; ++k)
+	{
+		uint64_t* elem = gfx_map_search(&map, &k);
+		if (elem == NULL)
+			goto fail;
+
+		if (*(const uint64_t*)gfx_map_key(&map, elem) != k)
+			goto fail;
+
+		if (k != dup && *elem != k * k)
+			goto fail;
+	}
+
+	const uint64_t miss = NUM_KEYS;
+	if (gfx_map_search(&map, &miss) != NULL)
+		goto fail;
+
+	// Find all duplicates, no node should be visited twice.
+	uint64_t seen = 0;
+	size_t count = 0;
+
+	for (
+		uint64_t* elem = gfx_map_search(&map, &dup);
+		elem != NULL;
+		elem = gfx_map_next_equal(&map, elem))
+	{
+		const uint64_t d =
+			(*elem == dup * dup) ? 0 : *elem - NUM_KEYS * NUM_KEYS;
+
+		if (d >= NUM_DUPLICATES || (seen & ((uint64_t)1 << d)))
+			goto fail;
+
+		seen |= (uint64_t)1 << d;
+		++count;
+	}
+
+	if (count != NUM_DUPLICATES)
+		goto fail;
+
+	// Erase all even keys during iteration, must visit every node once.
+	count = 0;
+
+	for (uint64_t* elem = gfx_map_first(&map); elem != NULL; )
+	{
+		uint64_t* next = gfx_map_next(&map, elem);
+		const uint64_t k = *(const uint64_t*)gfx_map_key(&map, elem);
+
+		if (k % 2 == 0)
+			gfx_map_ferase(&map, elem);
+
+		elem = next;
+		++count;
+	}
+
+	if (count != NUM_KEYS + NUM_DUPLICATES - 1)
+		goto fail;
+
+	// Only odd keys should be left, also after shrinking.
+	gfx_map_shrink(&map);
+
+	if (map.size != NUM_KEYS / 2)
+		goto fail;
+
+	for (uint64_t k = 0; k < NUM_KEYS; ++k)
+	{
+		uint64_t* elem = gfx_map_search(&map, &k);
+		if ((elem != NULL) != (k % 2 != 0))
+			goto fail;
+	}
+
+	// Iterating after shrinking should still visit all nodes.
+	count = 0;
+
+	for (void* n = gfx_map_first(&map); n != NULL; n = gfx_map_next(&map, n))
+		++count;
+
+	if (count != NUM_KEYS / 2)
+		goto fail;
+
+	// Erase the remaining keys the regular way.
+	for (uint64_t k = 1; k < NUM_KEYS; k += 2)
+	{
+		uint64_t* elem = gfx_map_search(&map, &k);
+		if (elem == NULL)
+			goto fail;
+
+		gfx_map_erase(&map, elem);
+	}
+
+	if (map.size != 0 || gfx_map_first(&map) != NULL)
+		goto fail;
+
+	gfx_map_clear(&map);
+
+	return;
+
+
+	// Cleanup on failure.
+fail:
+	gfx_map_clear(&map);
+	TEST_FAIL();
+}
+
+
+/****************************
+ * Arena test.
+ */
+TEST_DESCRIBE(arena, t)
+{
+	GFXArena arena;
+	gfx_arena_init(&arena, 256);
+
+	// Allocate more than fits in a single block,
+	// fill each allocation and check alignment.
+	unsigned char* ptrs[64];
+
+	for (size_t i = 0; i < 64; ++i)
+	{
+		ptrs[i] = gfx_arena_alloc(&arena, 100);
+		if (ptrs[i] == NULL)
+			goto fail;
+
+		if ((uintptr_t)ptrs[i] % _Alignof(max_align_t) != 0)
+			goto fail;
+
+		memset(ptrs[i], (int)i, 100);
+	}
+
+	// Check no allocations overlap.
+	for (size_t i = 0; i < 64; ++i)
+		for (size_t b = 0; b < 100; ++b)
+			if (ptrs[i][b] != (unsigned char)i)
+				goto fail;
+
+	// The last allocation resizes in place.
+	unsigned char* last = gfx_arena_realloc(&arena, ptrs[63], 100, 120);
+	if (last != ptrs[63] || last[99] != 63)
+		goto fail;
+
+	// Any other allocation is copied.
+	unsigned char* copy = gfx_arena_realloc(&arena, ptrs[0], 100, 200);
+	if (copy == NULL || copy == ptrs[0])
+		goto fail;
+
+	for (size_t b = 0; b < 100; ++b)
+		if (copy[b] != 0)
+			goto fail;
+
+	// After a reset, all blocks are merged into one
+	// and the same allocations should not allocate a new block.
+	gfx_arena_reset(&arena);
+	void* block = arena.blocks;
+
+	if (block == NULL)
+		goto fail;
+
+	for (size_t r = 0; r < 2; ++r)
+	{
+		for (size_t i = 0; i < 63; ++i)
+			if (gfx_arena_alloc(&arena, 100) == NULL)
+				goto fail;
+
+		void* ptr = gfx_arena_alloc(&arena, 100);
+		if (ptr == NULL || gfx_arena_realloc(&arena, ptr, 100, 120) != ptr)
+			goto fail;
+
+		if (gfx_arena_alloc(&arena, 200) == NULL)
+			goto fail;
+
+		if (arena.blocks != block)
+			goto fail;
+
+		gfx_arena_reset(&arena);
+
+		if (arena.blocks != block)
+			goto fail;
+	}
+
+	gfx_arena_clear(&arena);
+
+	if (arena.blocks != NULL)
+		goto fail;
+
+	return;
+
+
+	// Cleanup on failure.
+fail:
+	gfx_arena_clear(&arena);
+	TEST_FAIL();
+}
+
+
+/****************************
+ * All container tests.
+ */
+TEST_DESCRIBE(containers, t)
+{
+	TEST_RUN(map);
+	TEST_RUN(arena);
+}
+
+
+/****************************
+ * Run the containers test.
+ */
+TEST_MAIN(containers);
@@ -0,0 +1,238 @@
+/**
+ * This file is part of groufix.
+ * Copyright (c) Stef Velzel. All rights reserved.
+ *
+ * groufix : graphics engine produced by Stef Velzel.
+ * www     : <www.vuzzel.nl>
+ */
+
+#include <string.h>
+
+#define TEST_SKIP_CREATE_WINDOW
+#define TEST_NUM_FRAMES 1
+#include "test.h"
+
+
+#define NUM_VALUES 16384
+#define STREAM_BUDGET 4096
+
+#define IMAGE_SIZE 64
+#define IMAGE_LAYERS 2
+
+
+/****************************
+ * Buffer streaming test.
+ */
+TEST_DESCRIBE(stream_buffer, t)
+{
+	bool success = 0;
+	GFXReadback* readback = NULL;
+
+	// Generate some values to upload.
+	const uint64_t size = sizeof(uint32_t) * NUM_VALUES;
+	const uint64_t half = size / 2;
+
+	uint32_t* values = malloc((size_t)size);
+	uint32_t* result = malloc((size_t)size);
+
+	if (values == NULL || result == NULL)
+		goto clean;
+
+	for (uint32_t v = 0; v < NUM_VALUES; ++v)
+		values[v] = v * 2654435761u;
+
+	memset(result, 0, (size_t)size);
+
+	// Allocate a device local buffer, so uploads need staging.
+	GFXBuffer* buffer = gfx_alloc_buffer(t->heap,
+		GFX_MEMORY_DEVICE_LOCAL | GFX_MEMORY_READ_WRITE,
+		GFX_BUFFER_NONE, size);
+
+	if (buffer == NULL)
+		goto clean;
+
+	// And one to free before streaming, dropping its uploads.
+	GFXBuffer* dropped = gfx_alloc_buffer(t->heap,
+		GFX_MEMORY_DEVICE_LOCAL | GFX_MEMORY_WRITE,
+		GFX_BUFFER_NONE, size);
+
+	if (dropped == NULL)
+		goto clean;
+
+	// Queue the second half with the lowest priority, so it completes
+	// last and can signal for everything to be read.
+	if (!gfx_heap_stream_write(t->heap, 0,
+		values, gfx_ref_buffer(buffer), 1, 1,
+		(GFXRegion[]){{ .offset = half, .size = half }},
+		(GFXRegion[]){{ .offset = half, .size = 0 }},
+		(GFXInject[]){
+			gfx_dep_sig(t->dep,
+				GFX_ACCESS_TRANSFER_READ, GFX_STAGE_ANY)
+		}))
+	{
+		goto clean;
+	}
+
+	if (!gfx_heap_stream_write(t->heap, 1,
+		values, gfx_ref_buffer(buffer), 1, 0,
+		(GFXRegion[]){{ .offset = 0, .size = half }},
+		(GFXRegion[]){{ .offset = 0, .size = 0 }},
+		NULL))
+	{
+		goto clean;
+	}
+
+	if (!gfx_heap_stream_write(t->heap, 2,
+		values, gfx_ref_buffer(dropped), 1, 0,
+		(GFXRegion[]){{ .offset = 0, .size = size }},
+		(GFXRegion[]){{ .offset = 0, .size = 0 }},
+		NULL))
+	{
+		goto clean;
+	}
+
+	gfx_free_buffer(dropped);
+
+	// Submit everything, spread over multiple calls.
+	// Calls with nothing queued should be no-ops.
+	for (uint64_t s = 0; s < size / STREAM_BUDGET + 2; ++s)
+		if (!gfx_heap_stream(t->heap, STREAM_BUDGET))
+			goto clean;
+
+	// Read it all back, waiting on the signal of the last upload.
+	readback = gfx_read_async(gfx_ref_buffer(buffer), result,
+		GFX_TRANSFER_NONE, 1, 1,
+		(GFXRegion[]){{ .offset = 0, .size = size }},
+		(GFXRegion[]){{ .offset = 0, .size = 0 }},
+		(GFXInject[]){ gfx_dep_wait(t->dep) });
+
+	if (readback == NULL)
+		goto clean;
+
+	// Polling may or may not be done already, but must not block.
+	if (!gfx_readback_poll(readback) && !gfx_readback_wait(readback))
+		goto clean;
+
+	// Once done, polling must keep returning done.
+	if (!gfx_readback_poll(readback))
+		goto clean;
+
+	// Check results.
+	if (memcmp(values, result, (size_t)size) != 0)
+		gfx_log_error("Streamed buffer contents are not as expected!");
+	else
+		success = 1;
+
+
+	// Cleanup.
+clean:
+	gfx_readback_free(readback);
+	free(values);
+	free(result);
+
+	if (!success) TEST_FAIL();
+}
+
+
+/****************************
+ * Image streaming test.
+ */
+TEST_DESCRIBE(stream_image, t)
+{
+	bool success = 0;
+	GFXReadback* readback = NULL;
+
+	// Generate some texels to upload, tightly packed.
+	const uint64_t size =
+		sizeof(uint32_t) * IMAGE_SIZE * IMAGE_SIZE * IMAGE_LAYERS;
+
+	uint32_t* texels = malloc((size_t)size);
+	uint32_t* result = malloc((size_t)size);
+
+	if (texels == NULL || result == NULL)
+		goto clean;
+
+	for (uint32_t v = 0; v < size / sizeof(uint32_t); ++v)
+		texels[v] = v * 2654435761u;
+
+	memset(result, 0, (size_t)size);
+
+	// Allocate a layered device local image, larger than the budget,
+	// so it must be split into rows of multiple layers.
+	GFXImage* image = gfx_alloc_image(t->heap,
+		GFX_IMAGE_2D, GFX_MEMORY_DEVICE_LOCAL | GFX_MEMORY_READ_WRITE,
+		GFX_IMAGE_SAMPLED, GFX_FORMAT_R8G8B8A8_UNORM,
+		1, IMAGE_LAYERS, IMAGE_SIZE, IMAGE_SIZE, 1);
+
+	if (image == NULL)
+		goto clean;
+
+	const GFXRegion region = {
+		.aspect = GFX_IMAGE_COLOR,
+		.mipmap = 0,
+		.layer = 0,
+		.numLayers = IMAGE_LAYERS,
+		.x = 0, .y = 0, .z = 0,
+		.width = IMAGE_SIZE,
+		.height = IMAGE_SIZE,
+		.depth = 1
+	};
+
+	if (!gfx_heap_stream_write(t->heap, 0,
+		texels, gfx_ref_image(image), 1, 1,
+		(GFXRegion[]){{ .offset = 0, .rowSize = 0, .numRows = 0 }},
+		&region,
+		(GFXInject[]){
+			gfx_dep_sig(t->dep,
+				GFX_ACCESS_TRANSFER_READ, GFX_STAGE_ANY)
+		}))
+	{
+		goto clean;
+	}
+
+	// Submit everything, spread over multiple calls.
+	for (uint64_t s = 0; s < size / STREAM_BUDGET + 2; ++s)
+		if (!gfx_heap_stream(t->heap, STREAM_BUDGET))
+			goto clean;
+
+	// Read it all back, waiting on the signal of the last part.
+	readback = gfx_read_async(gfx_ref_image(image), result,
+		GFX_TRANSFER_NONE, 1, 1,
+		&region,
+		(GFXRegion[]){{ .offset = 0, .rowSize = 0, .numRows = 0 }},
+		(GFXInject[]){ gfx_dep_wait(t->dep) });
+
+	if (readback == NULL || !gfx_readback_wait(readback))
+		goto clean;
+
+	// Check results.
+	if (memcmp(texels, result, (size_t)size) != 0)
+		gfx_log_error("Streamed image contents are not as expected!");
+	else
+		success = 1;
+
+
+	// Cleanup.
+clean:
+	gfx_readback_free(readback);
+	free(texels);
+	free(result);
+
+	if (!success) TEST_FAIL();
+}
+
+
+/****************************
+ * All streaming tests.
+ */
+TEST_DESCRIBE(streaming, t)
+{
+	TEST_RUN(stream_buffer);
+	TEST_RUN(stream_image);
+}
+
+
+/****************************
+ * Run the streaming test.
+ */
+TEST_MAIN(streaming);
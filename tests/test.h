@@ -41,6 +41,10 @@
  * default renderer setup. To override default behaviour you can disable some
  * building steps, define one of the following before includng this file:
  *
+ * TEST_SKIP_INIT
+ *   Do not initialize groufix at all, e.g. to test containers only.
+ *   Also skips opening a base window.
+ *
  * TEST_SKIP_CREATE_WINDOW
  *   Do not open a base window to render to.
  *   Also skips creating a render graph and scene.
@@ -79,6 +83,10 @@
 
 
 // Make disable defines cascade.
+#if defined (TEST_SKIP_INIT)
+	#define TEST_SKIP_CREATE_WINDOW
+#endif
+
 #if defined (TEST_SKIP_CREATE_WINDOW)
 	#define TEST_SKIP_CREATE_RENDER_GRAPH
 #endif
@@ -286,6 +294,7 @@ static const char* _test_glsl_fragment =
  */
 static void _test_clear(void)
 {
+#if !defined (TEST_SKIP_INIT)
 	gfx_destroy_renderer(_test_base.renderer);
 	gfx_destroy_shader(_test_base.vertex);
 	gfx_destroy_shader(_test_base.fragment);
@@ -293,6 +302,7 @@ static void _test_clear(void)
 	gfx_destroy_dep(_test_base.dep);
 	gfx_destroy_window(_test_base.window);
 	gfx_terminate();
+#endif
 
 	// Don't bother resetting _test_base as we will exit() anyway.
 }
@@ -403,6 +413,7 @@ static void _test_default_render(GFXRecorder* recorder,
  */
 static void _test_init(TestState* _test_state)
 {
+#if !defined (TEST_SKIP_INIT)
 	// Initialize.
 	if (!gfx_init())
 		TEST_FAIL();
@@ -669,6 +680,7 @@ static void _test_init(TestState* _test_state)
 #endif // TEST_SKIP_CREATE_SCENE
 #endif // TEST_SKIP_CREATE_RENDER_GRAPH
 #endif // TEST_SKIP_CREATE_WINDOW
+#endif // TEST_SKIP_INIT
 }
 
 